@@ -0,0 +1,247 @@
+#include "ArenaAllocator.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+
+namespace {
+	const uint8_t kAllocatedPattern = 0xCD;
+	const uint8_t kFreedPattern = 0xDD;
+
+	uintptr_t AlignUp(uintptr_t value, size_t alignment) {
+		assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+		return (value + alignment - 1) & ~uintptr_t(alignment - 1);
+	}
+
+	void Poison([[maybe_unused]] void* pointer, [[maybe_unused]] size_t size, [[maybe_unused]] uint8_t pattern) {
+#if ARENA_POISON
+		std::memset(pointer, pattern, size);
+#endif
+	}
+}
+
+LinearArena::LinearArena(size_t blockSize) : blockSize_(blockSize) {
+	assert(blockSize > 0);
+}
+
+void* LinearArena::Allocate(size_t size, size_t alignment) {
+	if (blocks_.empty()) {
+		blocks_.push_back({ std::make_unique<uint8_t[]>(blockSize_), blockSize_, 0 });
+	}
+	Block* block = &blocks_[currentBlock_];
+	uintptr_t base = reinterpret_cast<uintptr_t>(block->memory.get());
+	uintptr_t begin = AlignUp(base + offset_, alignment);
+	if (begin + size > base + block->size) {
+		NextBlock(size, alignment);
+		block = &blocks_[currentBlock_];
+		base = reinterpret_cast<uintptr_t>(block->memory.get());
+		begin = AlignUp(base, alignment);
+	}
+	offset_ = size_t(begin + size - base);
+	++allocationCount_;
+	void* pointer = reinterpret_cast<void*>(begin);
+	Poison(pointer, size, kAllocatedPattern);
+	return pointer;
+}
+
+void LinearArena::Deallocate(void* pointer, size_t size) {
+	if (blocks_.empty() || !pointer) {
+		return;
+	}
+	// 最後に確保したものだけは、次の確保で使い直せるように戻す。配列が伸びるときによくある
+	// 開いているScratchScopeより前のものを戻すと、Scopeが戻る位置より後ろへ次の確保が重なるので戻さない
+	uint8_t* memory = blocks_[currentBlock_].memory.get();
+	const bool aboveFloor = floor_.block < currentBlock_ || static_cast<uint8_t*>(pointer) >= memory + floor_.offset;
+	if (static_cast<uint8_t*>(pointer) + size == memory + offset_ && aboveFloor) {
+		peakBytes_ = (std::max)(peakBytes_, GetStats().usedBytes);
+		offset_ -= size;
+		Poison(pointer, size, kFreedPattern);
+	}
+}
+
+void LinearArena::Rewind(const Marker& marker) {
+	if (blocks_.empty()) {
+		return;
+	}
+	assert(marker.block < currentBlock_ || (marker.block == currentBlock_ && marker.offset <= offset_));
+	// 一番多く使ったのは戻す直前なので、ここで覚えておく
+	peakBytes_ = (std::max)(peakBytes_, GetStats().usedBytes);
+	// 戻す範囲を埋める
+	for (uint32_t block = marker.block; block <= currentBlock_; ++block) {
+		const size_t begin = block == marker.block ? marker.offset : 0;
+		const size_t end = block == currentBlock_ ? offset_ : blocks_[block].used;
+		Poison(blocks_[block].memory.get() + begin, end - begin, kFreedPattern);
+		blocks_[block].used = 0;
+	}
+	currentBlock_ = marker.block;
+	offset_ = marker.offset;
+	if (marker.block == 0 && marker.offset == 0) {
+		allocationCount_ = 0;
+	}
+}
+
+ArenaStats LinearArena::GetStats() const {
+	ArenaStats stats{};
+	for (uint32_t block = 0; block < blocks_.size(); ++block) {
+		stats.capacity += blocks_[block].size;
+		if (block < currentBlock_) {
+			stats.usedBytes += blocks_[block].used;
+		}
+	}
+	stats.usedBytes += offset_;
+	stats.peakBytes = (std::max)(peakBytes_, stats.usedBytes);
+	stats.allocationCount = allocationCount_;
+	stats.overflowCount = overflowCount_;
+	return stats;
+}
+
+void LinearArena::NextBlock(size_t size, size_t alignment) {
+	blocks_[currentBlock_].used = offset_;
+	++currentBlock_;
+	offset_ = 0;
+	// 次のブロックに入らなければ、入る大きさのものを間に作る
+	const size_t required = size + alignment - 1;
+	if (currentBlock_ == blocks_.size() || blocks_[currentBlock_].size < required) {
+		const size_t blockSize = (std::max)(blockSize_, required);
+		blocks_.insert(blocks_.begin() + currentBlock_, { std::make_unique<uint8_t[]>(blockSize), blockSize, 0 });
+		++overflowCount_;
+	}
+}
+
+void FrameArena::Initialize(size_t capacity) {
+	for (Buffer& buffer : buffers_) {
+		buffer.memory = std::make_unique<uint8_t[]>(capacity);
+		buffer.capacity = capacity;
+		buffer.offset = 0;
+	}
+	current_ = 0;
+}
+
+void FrameArena::BeginFrame() {
+	// 終わったフレームの使用量を残す
+	Buffer& finished = buffers_[current_];
+	const uint64_t usedBytes = (std::min)(finished.offset.load(), finished.capacity) + finished.overflowBytes;
+	peakBytes_ = (std::max)(peakBytes_, usedBytes);
+	lastFrameStats_.capacity = finished.capacity;
+	lastFrameStats_.usedBytes = usedBytes;
+	lastFrameStats_.peakBytes = peakBytes_;
+	lastFrameStats_.allocationCount = finished.allocationCount;
+	lastFrameStats_.overflowCount = finished.overflowBlocks.size();
+
+	// 2フレーム前の側を空にして使う
+	current_ ^= 1;
+	Buffer& buffer = buffers_[current_];
+	const uint64_t bufferUsedBytes = (std::min)(buffer.offset.load(), buffer.capacity) + buffer.overflowBytes;
+	if (!buffer.overflowBlocks.empty()) {
+		// 溢れたので次からは入るようにする
+		buffer.capacity = size_t(bufferUsedBytes + bufferUsedBytes / 2);
+		buffer.memory = std::make_unique<uint8_t[]>(buffer.capacity);
+		buffer.overflowBlocks.clear();
+	} else {
+		Poison(buffer.memory.get(), size_t(bufferUsedBytes), kFreedPattern);
+	}
+	buffer.offset = 0;
+	buffer.allocationCount = 0;
+	buffer.overflowBytes = 0;
+}
+
+void* FrameArena::Allocate(size_t size, size_t alignment) {
+	Buffer& buffer = buffers_[current_];
+	assert(buffer.memory && "FrameArena::Initializeを呼んでいない");
+	buffer.allocationCount.fetch_add(1, std::memory_order_relaxed);
+	// 揃えの分を見込んで確保し、その中で揃える
+	const size_t reserved = size + alignment - 1;
+	const size_t offset = buffer.offset.fetch_add(reserved, std::memory_order_relaxed);
+	if (offset + reserved <= buffer.capacity) {
+		void* pointer = reinterpret_cast<void*>(AlignUp(reinterpret_cast<uintptr_t>(buffer.memory.get()) + offset, alignment));
+		Poison(pointer, size, kAllocatedPattern);
+		return pointer;
+	}
+	// 容量を超えた。このフレームの間だけ別に確保して持っておく
+	std::lock_guard<std::mutex> lock(overflowMutex_);
+	buffer.overflowBlocks.push_back(std::make_unique<uint8_t[]>(reserved));
+	buffer.overflowBytes += reserved;
+	void* pointer = reinterpret_cast<void*>(AlignUp(reinterpret_cast<uintptr_t>(buffer.overflowBlocks.back().get()), alignment));
+	Poison(pointer, size, kAllocatedPattern);
+	return pointer;
+}
+
+FrameArena& GetFrameArena() {
+	static FrameArena frameArena;
+	return frameArena;
+}
+
+LinearArena& GetScratchArena() {
+	thread_local LinearArena scratchArena(256 * 1024);
+	return scratchArena;
+}
+
+namespace {
+	// 1フレームでよくある処理。描画ごとの配列を伸ばしながら詰め、表示用の文字列を組み立てる
+	template<typename Vector, typename String>
+	uint64_t RunFrameWorkload(uint32_t frame, const typename Vector::allocator_type& allocator) {
+		uint64_t checksum = 0;
+		for (uint32_t list = 0; list < 64; ++list) {
+			Vector values(allocator);
+			const uint32_t count = 16 + (frame * 7 + list * 13) % 240;
+			for (uint32_t index = 0; index < count; ++index) {
+				values.push_back(index * list + frame);
+			}
+			checksum += values.back();
+		}
+		for (uint32_t line = 0; line < 128; ++line) {
+			String text(allocator);
+			text += "pass:";
+			text += std::to_string(line);
+			text += " draws:";
+			text += std::to_string(frame + line);
+			text += " ms:0.000 name:RenderQueue";
+			checksum += text.size();
+		}
+		return checksum;
+	}
+}
+
+ArenaBenchmark MeasureArenaAllocators(uint32_t frameCount) {
+	using Clock = std::chrono::steady_clock;
+	ArenaBenchmark result{};
+	result.frameCount = (std::max)(frameCount, 1u);
+	uint64_t checksums[3] = {};
+
+	// 1フレームずつ測って平均と最大を出す
+	auto measure = [&](auto&& runFrame, double& averageMicroseconds, double& maxMicroseconds) {
+		double totalMicroseconds = 0.0;
+		for (uint32_t frame = 0; frame < result.frameCount; ++frame) {
+			const Clock::time_point start = Clock::now();
+			runFrame(frame);
+			const double microseconds = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+			totalMicroseconds += microseconds;
+			maxMicroseconds = (std::max)(maxMicroseconds, microseconds);
+		}
+		averageMicroseconds = totalMicroseconds / result.frameCount;
+	};
+
+	measure([&](uint32_t frame) {
+		checksums[0] += RunFrameWorkload<std::vector<uint32_t>, std::string>(frame, std::allocator<uint32_t>());
+	}, result.heapMicroseconds, result.heapMaxMicroseconds);
+
+	FrameArena frameArena;
+	frameArena.Initialize(64 * 1024);
+	measure([&](uint32_t frame) {
+		frameArena.BeginFrame();
+		checksums[1] += RunFrameWorkload<std::vector<uint32_t, ArenaAllocator<uint32_t, FrameArena>>,
+			std::basic_string<char, std::char_traits<char>, ArenaAllocator<char, FrameArena>>>(frame, ArenaAllocator<uint32_t, FrameArena>(frameArena));
+	}, result.frameArenaMicroseconds, result.frameArenaMaxMicroseconds);
+	frameArena.BeginFrame();
+	result.frameArenaBytes = frameArena.GetStats().peakBytes;
+
+	LinearArena scratchArena;
+	measure([&](uint32_t frame) {
+		scratchArena.Reset();
+		checksums[2] += RunFrameWorkload<ScratchVector<uint32_t>, ScratchString>(frame, ArenaAllocator<uint32_t, LinearArena>(scratchArena));
+	}, result.scratchMicroseconds, result.scratchMaxMicroseconds);
+
+	// 同じ処理をしたか
+	assert(checksums[0] == checksums[1] && checksums[0] == checksums[2]);
+	return result;
+}
\ No newline at end of file
@@ -0,0 +1,217 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// 1なら確保したメモリを0xCD、解放したメモリを0xDDで埋め、解放後に使っていると気付けるようにする
+#ifndef ARENA_POISON
+#ifdef _DEBUG
+#define ARENA_POISON 1
+#else
+#define ARENA_POISON 0
+#endif
+#endif
+
+/// <summary>
+/// アリーナの使用量
+/// </summary>
+struct ArenaStats {
+	uint64_t capacity; //!< 持っているメモリのバイト数
+	uint64_t usedBytes; //!< 使っているバイト数。揃えの余白を含む
+	uint64_t peakBytes; //!< 今までで一番多く使ったバイト数
+	uint64_t allocationCount; //!< 空にしてからの確保の回数
+	uint64_t overflowCount; //!< 用意したメモリに入らず、追加で確保した回数
+};
+
+/// <summary>
+/// 1つのスレッドから使う線形アロケーター。先頭から順に切り出し、Rewind/Resetでまとめて解放する
+/// ブロックを使い切ったら次のブロックを足す。足したブロックはResetしても持ったままで次に使い回す
+/// </summary>
+class LinearArena {
+public:
+	// 戻る位置
+	struct Marker {
+		uint32_t block;
+		size_t offset;
+	};
+
+	explicit LinearArena(size_t blockSize = 64 * 1024);
+	LinearArena(const LinearArena&) = delete;
+	LinearArena& operator=(const LinearArena&) = delete;
+
+	// alignmentは2のべき乗
+	void* Allocate(size_t size, size_t alignment);
+	// 最後に確保したもので、SetFloorの位置より後にあれば、その分を戻す。それ以外は何もしない
+	void Deallocate(void* pointer, size_t size);
+
+	Marker GetMarker() const { return { currentBlock_, offset_ }; }
+	// markerより後に確保したものを全て解放する
+	void Rewind(const Marker& marker);
+	void Reset() { Rewind({ 0, 0 }); }
+	// Deallocateで戻してよい一番前の位置。ScratchScopeが自分の開いた位置を設定し、外で確保したものを戻させない
+	Marker GetFloor() const { return floor_; }
+	void SetFloor(const Marker& floor) { floor_ = floor; }
+
+	ArenaStats GetStats() const;
+
+private:
+	struct Block {
+		std::unique_ptr<uint8_t[]> memory;
+		size_t size;
+		size_t used; //!< 次のブロックに移ったときの使用量
+	};
+
+	// sizeとalignmentが入るブロックに移る。無ければ作る
+	void NextBlock(size_t size, size_t alignment);
+
+	size_t blockSize_;
+	std::vector<Block> blocks_;
+	uint32_t currentBlock_ = 0;
+	size_t offset_ = 0;
+	Marker floor_{ 0, 0 };
+	uint64_t peakBytes_ = 0;
+	uint64_t allocationCount_ = 0;
+	uint64_t overflowCount_ = 0;
+};
+
+/// <summary>
+/// 1フレームだけ使うメモリの線形アロケーター。2つのバッファを交互に使い、BeginFrameで2フレーム前の側を空にする
+/// そのため前のフレームで確保したものは、今のフレームの終わりまで使える
+/// Allocateはどのスレッドからでも呼べる。容量を超えた分はロックして追加で確保し、次に空にするときに容量を増やす
+/// アプリ全体ではGetFrameArenaを使う
+/// </summary>
+class FrameArena {
+public:
+	FrameArena() = default;
+	FrameArena(const FrameArena&) = delete;
+	FrameArena& operator=(const FrameArena&) = delete;
+
+	// capacity: 1フレームで使う見込みのバイト数
+	void Initialize(size_t capacity);
+	// フレームの最初に呼ぶ。他のスレッドが確保していないときに呼ぶ
+	void BeginFrame();
+
+	// alignmentは2のべき乗
+	void* Allocate(size_t size, size_t alignment);
+	// まとめて解放するので何もしない
+	void Deallocate(void*, size_t) {}
+
+	// 直前に終わったフレームの使用量
+	const ArenaStats& GetStats() const { return lastFrameStats_; }
+
+private:
+	struct Buffer {
+		std::unique_ptr<uint8_t[]> memory;
+		size_t capacity = 0;
+		std::atomic<size_t> offset{ 0 };
+		std::atomic<uint64_t> allocationCount{ 0 };
+		// 容量を超えた分。overflowMutex_で守る
+		std::vector<std::unique_ptr<uint8_t[]>> overflowBlocks;
+		uint64_t overflowBytes = 0;
+	};
+
+	Buffer buffers_[2];
+	uint32_t current_ = 0;
+	std::mutex overflowMutex_;
+	uint64_t peakBytes_ = 0;
+	ArenaStats lastFrameStats_{};
+};
+
+// アプリ全体で使うFrameArena
+FrameArena& GetFrameArena();
+
+// 呼び出したスレッドの作業用のアリーナ。関数の中の一時的な配列に使い、ScratchScopeで戻す
+LinearArena& GetScratchArena();
+
+/// <summary>
+/// 作られたときのScratchArenaの位置を覚えておき、破棄されるときにそこまで戻す
+/// 開いている間は、それより前に確保したもの(外のScratchVectorなど)をDeallocateで戻さない
+/// </summary>
+class ScratchScope {
+public:
+	ScratchScope() : arena_(GetScratchArena()), marker_(arena_.GetMarker()), previousFloor_(arena_.GetFloor()) {
+		arena_.SetFloor(marker_);
+	}
+	~ScratchScope() {
+		arena_.Rewind(marker_);
+		arena_.SetFloor(previousFloor_);
+	}
+	ScratchScope(const ScratchScope&) = delete;
+	ScratchScope& operator=(const ScratchScope&) = delete;
+
+	LinearArena& GetArena() const { return arena_; }
+
+private:
+	LinearArena& arena_;
+	LinearArena::Marker marker_;
+	LinearArena::Marker previousFloor_;
+};
+
+/// <summary>
+/// アリーナから確保するSTLのアロケーター。Arenaは LinearArena か FrameArena
+/// 既定のコンストラクタは、ScratchArenaかGetFrameArenaを使う
+/// </summary>
+template<typename T, typename Arena>
+class ArenaAllocator {
+public:
+	using value_type = T;
+
+	ArenaAllocator() : arena_(&GetDefaultArena()) {}
+	explicit ArenaAllocator(Arena& arena) : arena_(&arena) {}
+	template<typename U>
+	ArenaAllocator(const ArenaAllocator<U, Arena>& other) : arena_(other.GetArena()) {}
+
+	T* allocate(size_t count) {
+		return static_cast<T*>(arena_->Allocate(count * sizeof(T), alignof(T)));
+	}
+	void deallocate(T* pointer, size_t count) {
+		arena_->Deallocate(pointer, count * sizeof(T));
+	}
+
+	Arena* GetArena() const { return arena_; }
+
+	template<typename U>
+	bool operator==(const ArenaAllocator<U, Arena>& other) const { return arena_ == other.GetArena(); }
+
+private:
+	static Arena& GetDefaultArena() {
+		if constexpr (std::is_same_v<Arena, FrameArena>) {
+			return GetFrameArena();
+		} else {
+			return GetScratchArena();
+		}
+	}
+
+	Arena* arena_;
+};
+
+// このフレームの間だけ使う配列と文字列
+template<typename T>
+using FrameVector = std::vector<T, ArenaAllocator<T, FrameArena>>;
+using FrameString = std::basic_string<char, std::char_traits<char>, ArenaAllocator<char, FrameArena>>;
+// ScratchScopeの間だけ使う配列と文字列。作ったスレッドで使う
+template<typename T>
+using ScratchVector = std::vector<T, ArenaAllocator<T, LinearArena>>;
+using ScratchString = std::basic_string<char, std::char_traits<char>, ArenaAllocator<char, LinearArena>>;
+
+/// <summary>
+/// MeasureArenaAllocatorsの結果。時間は1フレームあたり
+/// </summary>
+struct ArenaBenchmark {
+	uint32_t frameCount;
+	double heapMicroseconds; //!< std::allocator
+	double heapMaxMicroseconds; //!< 一番遅かったフレーム
+	double frameArenaMicroseconds;
+	double frameArenaMaxMicroseconds;
+	double scratchMicroseconds;
+	double scratchMaxMicroseconds;
+	uint64_t frameArenaBytes; //!< 1フレームで使ったバイト数
+};
+
+// 配列を伸ばしながら詰めて文字列を組み立てる、フレームでよくある処理をframeCountフレーム分行い、アロケーターごとに測る
+ArenaBenchmark MeasureArenaAllocators(uint32_t frameCount);
\ No newline at end of file
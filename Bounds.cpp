@@ -0,0 +1,63 @@
+#include "Bounds.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+MeshBounds ComputeMeshBounds(const VertexData* vertices, size_t vertexCount) {
+	MeshBounds bounds{};
+	if (vertexCount == 0) {
+		return bounds;
+	}
+	AABB& aabb = bounds.aabb;
+	aabb.min = { FLT_MAX,FLT_MAX,FLT_MAX };
+	aabb.max = { -FLT_MAX,-FLT_MAX,-FLT_MAX };
+	for (size_t index = 0; index < vertexCount; ++index) {
+		const Vector4& position = vertices[index].position;
+		aabb.min = { (std::min)(aabb.min.x, position.x), (std::min)(aabb.min.y, position.y), (std::min)(aabb.min.z, position.z) };
+		aabb.max = { (std::max)(aabb.max.x, position.x), (std::max)(aabb.max.y, position.y), (std::max)(aabb.max.z, position.z) };
+	}
+
+	// 中心から一番遠い頂点までを半径にする
+	BoundingSphere& sphere = bounds.sphere;
+	sphere.center = { (aabb.min.x + aabb.max.x) * 0.5f, (aabb.min.y + aabb.max.y) * 0.5f, (aabb.min.z + aabb.max.z) * 0.5f };
+	float radiusSquared = 0.0f;
+	for (size_t index = 0; index < vertexCount; ++index) {
+		const Vector4& position = vertices[index].position;
+		Vector3 offset = Vector3{ position.x, position.y, position.z } - sphere.center;
+		radiusSquared = (std::max)(radiusSquared, Dot(offset, offset));
+	}
+	sphere.radius = std::sqrt(radiusSquared);
+	return bounds;
+}
+
+AABB TransformAABB(const AABB& aabb, const mat4x4& matrix) {
+	const float center[3] = { (aabb.min.x + aabb.max.x) * 0.5f, (aabb.min.y + aabb.max.y) * 0.5f, (aabb.min.z + aabb.max.z) * 0.5f };
+	const float extent[3] = { (aabb.max.x - aabb.min.x) * 0.5f, (aabb.max.y - aabb.min.y) * 0.5f, (aabb.max.z - aabb.min.z) * 0.5f };
+	// 行ベクトルなので、変換後のj軸は各行のj列目を足し合わせたもの。幅は絶対値で足す
+	float newCenter[3];
+	float newExtent[3];
+	for (int column = 0; column < 3; ++column) {
+		newCenter[column] = matrix.m[3][column];
+		newExtent[column] = 0.0f;
+		for (int row = 0; row < 3; ++row) {
+			newCenter[column] += center[row] * matrix.m[row][column];
+			newExtent[column] += extent[row] * std::fabs(matrix.m[row][column]);
+		}
+	}
+	AABB result{};
+	result.min = { newCenter[0] - newExtent[0], newCenter[1] - newExtent[1], newCenter[2] - newExtent[2] };
+	result.max = { newCenter[0] + newExtent[0], newCenter[1] + newExtent[1], newCenter[2] + newExtent[2] };
+	return result;
+}
+
+BoundingSphere TransformBoundingSphere(const BoundingSphere& sphere, const mat4x4& matrix) {
+	float maxScaleSquared = 0.0f;
+	for (int row = 0; row < 3; ++row) {
+		Vector3 axis{ matrix.m[row][0], matrix.m[row][1], matrix.m[row][2] };
+		maxScaleSquared = (std::max)(maxScaleSquared, Dot(axis, axis));
+	}
+	BoundingSphere result{};
+	result.center = Transform(sphere.center, matrix);
+	result.radius = sphere.radius * std::sqrt(maxScaleSquared);
+	return result;
+}
\ No newline at end of file
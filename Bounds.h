@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include "VertexData.h"
+#include "mat4x4.h"
+
+/// <summary>
+/// 軸に沿った境界ボックス
+/// </summary>
+struct AABB {
+	Vector3 min;
+	Vector3 max;
+};
+
+/// <summary>
+/// 境界球
+/// </summary>
+struct BoundingSphere {
+	Vector3 center;
+	float radius;
+};
+
+/// <summary>
+/// メッシュのローカル座標での境界。読み込みや生成のときに1回だけ求める
+/// </summary>
+struct MeshBounds {
+	AABB aabb;
+	BoundingSphere sphere;
+};
+
+// 頂点を全て囲む境界を求める。球の中心はAABBの中心にする
+MeshBounds ComputeMeshBounds(const VertexData* vertices, size_t vertexCount);
+
+// AABBの8頂点を変換して囲み直したものと同じ結果を、中心と半分の幅から求める。matrixはアフィン変換
+AABB TransformAABB(const AABB& aabb, const mat4x4& matrix);
+// 拡大縮小は一番大きい軸の分だけ半径を広げる
+BoundingSphere TransformBoundingSphere(const BoundingSphere& sphere, const mat4x4& matrix);
\ No newline at end of file
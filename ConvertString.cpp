@@ -1,40 +1,25 @@
 #include "ConvertString.h"
-#include <Windows.h>
+#include "Logger.h"
+#include "Unicode.h"
 
+// 整形済みの文字列を出す。無効なら書き込まない
 void Log(const std::string& message) {
-	OutputDebugStringA(message.c_str());
+	LOG_INFO(LogCategory::General, std::string_view(message));
 }
 
 void Log(const std::wstring& message) {
-    OutputDebugStringW(message.c_str());
+    LOG_INFO(LogCategory::General, std::wstring_view(message));
 }
 
 std::wstring ConvertString(const std::string& str) {
-    if (str.empty()) {
-        return std::wstring();
-    }
-    auto sizeNeeded = MultiByteToWideChar(CP_UTF8, 0, reinterpret_cast<const char*>
-        (&str[0]), static_cast<int>(str.size()), NULL, 0);
-    if (sizeNeeded == 0) {
-        return std::wstring();
-    }
-    std::wstring result(sizeNeeded, 0);
-    MultiByteToWideChar(CP_UTF8, 0, reinterpret_cast<const char*>(&str[0]),
-        static_cast<int>(str.size()), &result[0], sizeNeeded);
+    // 長さを数えて1回だけ確保する。確保したくなければUtf16Textを使う
+    std::wstring result(GetUtf16Length(str), 0);
+    ConvertUtf8ToUtf16(str, result.data(), result.size());
     return result;
 }
 
 std::string ConvertString(const std::wstring& str) {
-    if (str.empty()) {
-        return std::string();
-    }
-    auto sizeNeeded = WideCharToMultiByte(CP_UTF8, 0, str.data(), static_cast<int>
-        (str.size()), NULL, 0, NULL, NULL);
-    if (sizeNeeded == 0) {
-        return std::string();
-    }
-    std::string result(sizeNeeded, 0);
-    WideCharToMultiByte(CP_UTF8, 0, str.data(), static_cast<int>(str.size()),
-        result.data(), sizeNeeded, NULL, NULL);
+    std::string result(GetUtf8Length(str), 0);
+    ConvertUtf16ToUtf8(str, result.data(), result.size());
     return result;
 }
@@ -0,0 +1,58 @@
+#include "D3D12CommandListBackend.h"
+#include <cassert>
+
+void D3D12CommandListBackend::Initialize(ID3D12Device* device, ID3D12CommandQueue* commandQueue) {
+	device_ = device;
+	commandQueue_ = commandQueue;
+}
+
+void D3D12CommandListBackend::Finalize() {
+	for (ID3D12GraphicsCommandList* commandList : commandLists_) {
+		commandList->Release();
+	}
+	commandLists_.clear();
+	for (ID3D12CommandAllocator* allocator : allocators_) {
+		allocator->Release();
+	}
+	allocators_.clear();
+}
+
+void D3D12CommandListBackend::CreateAllocator(uint32_t allocator) {
+	assert(allocator == allocators_.size());
+	ID3D12CommandAllocator* commandAllocator = nullptr;
+	HRESULT hr = device_->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&commandAllocator));
+	assert(SUCCEEDED(hr));
+	allocators_.push_back(commandAllocator);
+}
+
+void D3D12CommandListBackend::ResetAllocator(uint32_t allocator) {
+	HRESULT hr = allocators_[allocator]->Reset();
+	assert(SUCCEEDED(hr));
+}
+
+void D3D12CommandListBackend::OpenCommandList(uint32_t list, uint32_t allocator) {
+	if (list < commandLists_.size()) {
+		HRESULT hr = commandLists_[list]->Reset(allocators_[allocator], nullptr);
+		assert(SUCCEEDED(hr));
+		return;
+	}
+	// 作った直後のコマンドリストは開いている
+	assert(list == commandLists_.size());
+	ID3D12GraphicsCommandList* commandList = nullptr;
+	HRESULT hr = device_->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, allocators_[allocator], nullptr, IID_PPV_ARGS(&commandList));
+	assert(SUCCEEDED(hr));
+	commandLists_.push_back(commandList);
+}
+
+void D3D12CommandListBackend::CloseCommandList(uint32_t list) {
+	HRESULT hr = commandLists_[list]->Close();
+	assert(SUCCEEDED(hr));
+}
+
+void D3D12CommandListBackend::ExecuteCommandLists(const uint32_t* lists, uint32_t count) {
+	executeLists_.clear();
+	for (uint32_t index = 0; index < count; ++index) {
+		executeLists_.push_back(commandLists_[lists[index]]);
+	}
+	commandQueue_->ExecuteCommandLists(UINT(executeLists_.size()), executeLists_.data());
+}
\ No newline at end of file
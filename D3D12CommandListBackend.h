@@ -0,0 +1,30 @@
+#pragma once
+#include <d3d12.h>
+#include <vector>
+#include "ParallelCommandRecorder.h"
+
+/// <summary>
+/// ParallelCommandRecorderのリストとアロケーターをD3D12のものにする
+/// </summary>
+class D3D12CommandListBackend : public CommandListBackend {
+public:
+	void Initialize(ID3D12Device* device, ID3D12CommandQueue* commandQueue);
+	// GPUの完了を待ってから呼ぶ
+	void Finalize();
+
+	// 番号のコマンドリスト。開いている間だけ積める
+	ID3D12GraphicsCommandList* GetCommandList(uint32_t list) const { return commandLists_[list]; }
+
+	void CreateAllocator(uint32_t allocator) override;
+	void ResetAllocator(uint32_t allocator) override;
+	void OpenCommandList(uint32_t list, uint32_t allocator) override;
+	void CloseCommandList(uint32_t list) override;
+	void ExecuteCommandLists(const uint32_t* lists, uint32_t count) override;
+
+private:
+	ID3D12Device* device_ = nullptr;
+	ID3D12CommandQueue* commandQueue_ = nullptr;
+	std::vector<ID3D12CommandAllocator*> allocators_;
+	std::vector<ID3D12GraphicsCommandList*> commandLists_;
+	std::vector<ID3D12CommandList*> executeLists_;
+};
\ No newline at end of file
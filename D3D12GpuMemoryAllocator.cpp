@@ -0,0 +1,278 @@
+#include "D3D12GpuMemoryAllocator.h"
+#include <cassert>
+#include <chrono>
+#include "D3D12MemoryTracking.h"
+
+namespace {
+	const uint64_t kHeapAlignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+	const uint64_t kMsaaHeapAlignment = D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT;
+
+	bool IsRenderTarget(const D3D12_RESOURCE_DESC& desc) {
+		return (desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL)) != 0;
+	}
+
+	// ResourceHeapTier1ではバッファ、テクスチャ、RT・DSのテクスチャを別のヒープに置く
+	D3D12_HEAP_FLAGS GetHeapFlags(const D3D12_RESOURCE_DESC& desc, bool resourceHeapTier2) {
+		if (resourceHeapTier2) {
+			return D3D12_HEAP_FLAG_ALLOW_ALL_BUFFERS_AND_TEXTURES;
+		}
+		if (desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER) {
+			return D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+		}
+		return IsRenderTarget(desc) ? D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES : D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
+	}
+
+	// MemoryTrackerで数える用途。バッファやTier2のヒープは何が入るか決まらない
+	MemoryCategory GetHeapCategory(D3D12_HEAP_FLAGS flags) {
+		switch (flags) {
+		case D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES:
+			return MemoryCategory::RenderTarget;
+		case D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES:
+			return MemoryCategory::Texture;
+		default:
+			return MemoryCategory::Other;
+		}
+	}
+
+	bool IsSameHeapProperties(const D3D12_HEAP_PROPERTIES& a, const D3D12_HEAP_PROPERTIES& b) {
+		return a.Type == b.Type && a.CPUPageProperty == b.CPUPageProperty && a.MemoryPoolPreference == b.MemoryPoolPreference;
+	}
+}
+
+void D3D12GpuMemoryAllocator::Initialize(ID3D12Device* device, uint64_t heapSize) {
+	assert(device && heapSize > 0);
+	device_ = device;
+	heapSize_ = heapSize;
+	D3D12_FEATURE_DATA_D3D12_OPTIONS options{};
+	HRESULT hr = device_->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS, &options, sizeof(options));
+	assert(SUCCEEDED(hr));
+	resourceHeapTier2_ = options.ResourceHeapTier >= D3D12_RESOURCE_HEAP_TIER_2;
+	allocator_.Initialize(this);
+}
+
+void D3D12GpuMemoryAllocator::Finalize() {
+	for (Retired& retired : retired_) {
+		retired.resource->Release();
+	}
+	for (auto& [resource, record] : resources_) {
+		resource->Release();
+	}
+	retired_.clear();
+	resources_.clear();
+	allocationResources_.clear();
+	// リソースを全て解放してからヒープを破棄する
+	allocator_.Finalize();
+	pools_.clear();
+	heaps_.clear();
+}
+
+ID3D12Resource* D3D12GpuMemoryAllocator::CreateResource(const D3D12_RESOURCE_DESC& desc, const D3D12_HEAP_PROPERTIES& heapProperties,
+	D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE* clearValue, bool movable) {
+	assert(device_);
+	assert(!movable || heapProperties.Type == D3D12_HEAP_TYPE_DEFAULT);
+	Resource record{};
+	record.desc = desc;
+	record.state = initialState;
+	record.hasClearValue = clearValue != nullptr;
+	if (clearValue) {
+		record.clearValue = *clearValue;
+	}
+	const bool msaa = desc.SampleDesc.Count > 1;
+	// 小さいテクスチャは4KB単位で置けることがある。置けなければ普通の64KB単位にする
+	D3D12_RESOURCE_ALLOCATION_INFO allocationInfo{};
+	bool placed = false;
+	if (desc.Dimension != D3D12_RESOURCE_DIMENSION_BUFFER && !IsRenderTarget(desc) && !msaa) {
+		record.desc.Alignment = D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT;
+		allocationInfo = device_->GetResourceAllocationInfo(0, 1, &record.desc);
+		placed = allocationInfo.Alignment == D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT;
+	}
+	if (!placed) {
+		record.desc.Alignment = 0;
+		allocationInfo = device_->GetResourceAllocationInfo(0, 1, &record.desc);
+	}
+	assert(allocationInfo.SizeInBytes != UINT64_MAX);
+	record.pool = FindPool(heapProperties, GetHeapFlags(desc, resourceHeapTier2_), msaa);
+	record.allocation = allocator_.Allocate(record.pool, allocationInfo.SizeInBytes, allocationInfo.Alignment, movable);
+	ID3D12Resource* resource = CreatePlaced(record);
+	resources_.emplace(resource, record);
+	allocationResources_[record.allocation.id] = resource;
+	return resource;
+}
+
+void D3D12GpuMemoryAllocator::DestroyResource(ID3D12Resource* resource, uint64_t fenceValue) {
+	auto it = resources_.find(resource);
+	assert(it != resources_.end());
+	allocator_.Free(it->second.allocation, fenceValue);
+	allocationResources_.erase(it->second.allocation.id);
+	resources_.erase(it);
+	if (fenceValue == 0) {
+		resource->Release();
+	} else {
+		retired_.push_back({ resource, fenceValue });
+	}
+}
+
+void D3D12GpuMemoryAllocator::Update(uint64_t completedFenceValue) {
+	// ヒープが破棄される前に、その上のリソースを解放しておく
+	size_t kept = 0;
+	for (Retired& retired : retired_) {
+		if (retired.fenceValue <= completedFenceValue) {
+			retired.resource->Release();
+		} else {
+			retired_[kept++] = retired;
+		}
+	}
+	retired_.resize(kept);
+	allocator_.Update(completedFenceValue);
+}
+
+void D3D12GpuMemoryAllocator::SetResourceState(ID3D12Resource* resource, D3D12_RESOURCE_STATES state) {
+	auto it = resources_.find(resource);
+	assert(it != resources_.end());
+	it->second.state = state;
+}
+
+std::vector<D3D12Relocation> D3D12GpuMemoryAllocator::Defragment(ID3D12GraphicsCommandList* commandList, uint64_t maxBytes, uint64_t fenceValue) {
+	assert(commandList && fenceValue > 0);
+	std::vector<D3D12Relocation> relocations;
+	std::vector<D3D12_RESOURCE_BARRIER> beforeCopy;
+	std::vector<D3D12_RESOURCE_BARRIER> afterCopy;
+	uint64_t movedBytes = 0;
+	for (uint32_t pool = 0; pool < pools_.size() && movedBytes < maxBytes; ++pool) {
+		const std::vector<GpuMove> moves = allocator_.Defragment(pool, maxBytes - movedBytes, fenceValue);
+		for (const GpuMove& move : moves) {
+			movedBytes += move.size;
+			ID3D12Resource* oldResource = allocationResources_[move.allocation.id];
+			auto it = resources_.find(oldResource);
+			assert(it != resources_.end());
+			const Resource record = it->second;
+			resources_.erase(it);
+			// 新しいリソースはCOPY_DESTで作り、コピーしてから元の状態に戻す
+			Resource copyRecord = record;
+			copyRecord.state = D3D12_RESOURCE_STATE_COPY_DEST;
+			ID3D12Resource* newResource = CreatePlaced(copyRecord);
+			resources_.emplace(newResource, record);
+			allocationResources_[move.allocation.id] = newResource;
+			retired_.push_back({ oldResource, fenceValue });
+			relocations.push_back({ oldResource, newResource });
+
+			// 空いた場所に別のリソースが残っていたかもしれないので、使い始めを知らせる
+			D3D12_RESOURCE_BARRIER barrier{};
+			barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_ALIASING;
+			barrier.Aliasing.pResourceAfter = newResource;
+			beforeCopy.push_back(barrier);
+			barrier = {};
+			barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+			barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+			if (record.state != D3D12_RESOURCE_STATE_COPY_SOURCE) {
+				barrier.Transition.pResource = oldResource;
+				barrier.Transition.StateBefore = record.state;
+				barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_COPY_SOURCE;
+				beforeCopy.push_back(barrier);
+			}
+			// バッファは作ったときの状態を無視してCOMMONになり、コピーでCOPY_DESTに上がる
+			if (record.state != D3D12_RESOURCE_STATE_COPY_DEST) {
+				barrier.Transition.pResource = newResource;
+				barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_COPY_DEST;
+				barrier.Transition.StateAfter = record.state;
+				afterCopy.push_back(barrier);
+			}
+		}
+	}
+	if (relocations.empty()) {
+		return relocations;
+	}
+	commandList->ResourceBarrier(UINT(beforeCopy.size()), beforeCopy.data());
+	for (const D3D12Relocation& relocation : relocations) {
+		commandList->CopyResource(relocation.newResource, relocation.oldResource);
+	}
+	if (!afterCopy.empty()) {
+		commandList->ResourceBarrier(UINT(afterCopy.size()), afterCopy.data());
+	}
+	return relocations;
+}
+
+void D3D12GpuMemoryAllocator::CreateHeap(uint32_t heap, const GpuHeapDesc& desc) {
+	const Pool& pool = pools_[desc.pool];
+	D3D12_HEAP_DESC heapDesc{};
+	heapDesc.SizeInBytes = desc.size;
+	heapDesc.Properties = pool.properties;
+	heapDesc.Alignment = desc.alignment;
+	heapDesc.Flags = pool.flags;
+	if (heaps_.size() <= heap) {
+		heaps_.resize(heap + 1, nullptr);
+	}
+	assert(heaps_[heap] == nullptr);
+	HRESULT hr = device_->CreateHeap(&heapDesc, IID_PPV_ARGS(&heaps_[heap]));
+	assert(SUCCEEDED(hr));
+	TrackD3D12Heap(device_, heaps_[heap], GetHeapCategory(pool.flags), "GpuMemoryAllocator heap");
+}
+
+void D3D12GpuMemoryAllocator::DestroyHeap(uint32_t heap) {
+	assert(heap < heaps_.size() && heaps_[heap]);
+	GetMemoryTracker().Untrack(heaps_[heap]);
+	heaps_[heap]->Release();
+	heaps_[heap] = nullptr;
+}
+
+uint32_t D3D12GpuMemoryAllocator::FindPool(const D3D12_HEAP_PROPERTIES& properties, D3D12_HEAP_FLAGS flags, bool msaa) {
+	for (uint32_t pool = 0; pool < pools_.size(); ++pool) {
+		if (IsSameHeapProperties(pools_[pool].properties, properties) && pools_[pool].flags == flags && pools_[pool].msaa == msaa) {
+			return pool;
+		}
+	}
+	pools_.push_back({ properties, flags, msaa });
+	return allocator_.AddPool({ heapSize_, msaa ? kMsaaHeapAlignment : kHeapAlignment });
+}
+
+ID3D12Resource* D3D12GpuMemoryAllocator::CreatePlaced(const Resource& resource) {
+	const GpuAllocationInfo info = allocator_.GetInfo(resource.allocation);
+	ID3D12Resource* placed = nullptr;
+	HRESULT hr = device_->CreatePlacedResource(heaps_[info.heap], info.offset, &resource.desc, resource.state,
+		resource.hasClearValue ? &resource.clearValue : nullptr, IID_PPV_ARGS(&placed));
+	assert(SUCCEEDED(hr));
+	return placed;
+}
+
+D3D12ResourceCreationBenchmark MeasureD3D12ResourceCreation(ID3D12Device* device, uint32_t resourceCount) {
+	using Clock = std::chrono::steady_clock;
+	D3D12ResourceCreationBenchmark result{};
+	result.resourceCount = resourceCount;
+	D3D12_RESOURCE_DESC desc{};
+	desc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+	desc.Width = 64;
+	desc.Height = 64;
+	desc.DepthOrArraySize = 1;
+	desc.MipLevels = 1;
+	desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	desc.SampleDesc.Count = 1;
+	D3D12_HEAP_PROPERTIES heapProperties{};
+	heapProperties.Type = D3D12_HEAP_TYPE_DEFAULT;
+	std::vector<ID3D12Resource*> resources(resourceCount, nullptr);
+
+	const Clock::time_point committedStart = Clock::now();
+	for (ID3D12Resource*& resource : resources) {
+		HRESULT hr = device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &desc,
+			D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS(&resource));
+		assert(SUCCEEDED(hr));
+	}
+	result.committedMilliseconds = std::chrono::duration<double, std::milli>(Clock::now() - committedStart).count();
+	result.committedBytes = device->GetResourceAllocationInfo(0, 1, &desc).SizeInBytes * resourceCount;
+	for (ID3D12Resource* resource : resources) {
+		resource->Release();
+	}
+
+	D3D12GpuMemoryAllocator allocator;
+	allocator.Initialize(device);
+	const Clock::time_point placedStart = Clock::now();
+	for (ID3D12Resource*& resource : resources) {
+		resource = allocator.CreateResource(desc, heapProperties, D3D12_RESOURCE_STATE_COMMON, nullptr, false);
+	}
+	result.placedMilliseconds = std::chrono::duration<double, std::milli>(Clock::now() - placedStart).count();
+	result.placedBytes = allocator.GetAllocator().GetTotalStats().reservedBytes;
+	for (ID3D12Resource* resource : resources) {
+		allocator.DestroyResource(resource);
+	}
+	allocator.Finalize();
+	return result;
+}
\ No newline at end of file
@@ -0,0 +1,94 @@
+#pragma once
+#include <d3d12.h>
+#include <unordered_map>
+#include <vector>
+#include "GpuMemoryAllocator.h"
+
+/// <summary>
+/// Defragmentで作り直したリソース。oldResourceはD3D12GpuMemoryAllocatorがGPUの完了後に解放する
+/// </summary>
+struct D3D12Relocation {
+	ID3D12Resource* oldResource;
+	ID3D12Resource* newResource;
+};
+
+/// <summary>
+/// D3D12のヒープを大きく作ってGpuMemoryAllocatorで切り分け、PlacedResourceを置く
+/// CommittedResourceのようにリソースごとにヒープを作らないので、作るのが速く、小さいテクスチャを4KB単位で詰められる
+/// ヒープはヒープの種類、置けるリソースの種類(ResourceHeapTier1のとき)、MSAAかどうかでプールに分ける
+/// MemoryTrackerにはヒープ全体の大きさで数える。中に置いたリソースは数えない
+/// </summary>
+class D3D12GpuMemoryAllocator : public GpuHeapBackend {
+public:
+	// heapSize: 1つのヒープの大きさ
+	void Initialize(ID3D12Device* device, uint64_t heapSize = 64 * 1024 * 1024);
+	// GPUの完了を待ってから呼ぶ。残っているリソースとヒープを全て解放する
+	void Finalize();
+
+	// movable: Defragmentで作り直してよいか。GPUでコピーするので、DefaultHeapのものだけが動かせる
+	ID3D12Resource* CreateResource(const D3D12_RESOURCE_DESC& desc, const D3D12_HEAP_PROPERTIES& heapProperties,
+		D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE* clearValue, bool movable);
+	// fenceValue: GPUがこの値まで終えてから解放する。0ならすぐに解放する
+	void DestroyResource(ID3D12Resource* resource, uint64_t fenceValue = 0);
+	// completedFenceValueまで終わったものを解放する。毎フレーム呼ぶ
+	void Update(uint64_t completedFenceValue);
+	// 動かせるリソースをバリアで別の状態にしたら知らせる。Defragmentのコピーの前後のバリアに使う
+	void SetResourceState(ID3D12Resource* resource, D3D12_RESOURCE_STATES state);
+
+	// 動かせるリソースをmaxBytesまで詰め直す。新しい場所にリソースを作ってcommandListでコピーし、古いものはfenceValueの後で解放する
+	// リソースはcommandListのこの位置でSetResourceStateで最後に知らせた状態(無ければinitialState)にあるとみなし、コピーの後はその状態に戻す
+	// 呼び出し側は戻り値を見てビューやアドレスを差し替える
+	std::vector<D3D12Relocation> Defragment(ID3D12GraphicsCommandList* commandList, uint64_t maxBytes, uint64_t fenceValue);
+
+	const GpuMemoryAllocator& GetAllocator() const { return allocator_; }
+	uint32_t GetResourceCount() const { return uint32_t(resources_.size()); }
+
+	void CreateHeap(uint32_t heap, const GpuHeapDesc& desc) override;
+	void DestroyHeap(uint32_t heap) override;
+
+private:
+	struct Pool {
+		D3D12_HEAP_PROPERTIES properties;
+		D3D12_HEAP_FLAGS flags;
+		bool msaa;
+	};
+	struct Resource {
+		GpuAllocationHandle allocation;
+		uint32_t pool;
+		D3D12_RESOURCE_DESC desc; //!< Alignmentは置くときに決めたもの
+		D3D12_RESOURCE_STATES state; //!< 今の状態。SetResourceStateで更新する
+		bool hasClearValue;
+		D3D12_CLEAR_VALUE clearValue;
+	};
+	struct Retired {
+		ID3D12Resource* resource;
+		uint64_t fenceValue;
+	};
+
+	uint32_t FindPool(const D3D12_HEAP_PROPERTIES& properties, D3D12_HEAP_FLAGS flags, bool msaa);
+	ID3D12Resource* CreatePlaced(const Resource& resource);
+
+	ID3D12Device* device_ = nullptr;
+	uint64_t heapSize_ = 0;
+	bool resourceHeapTier2_ = false; //!< バッファとテクスチャを同じヒープに置ける
+	GpuMemoryAllocator allocator_;
+	std::vector<Pool> pools_;
+	std::vector<ID3D12Heap*> heaps_;
+	std::unordered_map<ID3D12Resource*, Resource> resources_;
+	std::unordered_map<uint32_t, ID3D12Resource*> allocationResources_; //!< GpuAllocationHandleからリソースを引く
+	std::vector<Retired> retired_;
+};
+
+/// <summary>
+/// MeasureD3D12ResourceCreationの結果
+/// </summary>
+struct D3D12ResourceCreationBenchmark {
+	uint32_t resourceCount;
+	double committedMilliseconds; //!< CreateCommittedResourceで全て作る時間
+	double placedMilliseconds; //!< D3D12GpuMemoryAllocatorで全て作る時間。ヒープを作る時間を含む
+	uint64_t committedBytes; //!< CommittedResourceは64KB単位で確保される
+	uint64_t placedBytes; //!< 作ったヒープの合計
+};
+
+// 64x64のテクスチャをresourceCount個、CommittedResourceとPlacedResourceで作って解放する時間と使うメモリを比べる
+D3D12ResourceCreationBenchmark MeasureD3D12ResourceCreation(ID3D12Device* device, uint32_t resourceCount);
\ No newline at end of file
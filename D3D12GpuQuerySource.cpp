@@ -0,0 +1,76 @@
+#include "D3D12GpuQuerySource.h"
+#include <Windows.h>
+#include <cassert>
+#include <cstring>
+
+void D3D12GpuQuerySource::Initialize(ID3D12Device* device, ID3D12CommandQueue* commandQueue, uint32_t queryCount) {
+	commandQueue_ = commandQueue;
+
+	D3D12_QUERY_HEAP_DESC queryHeapDesc{};
+	queryHeapDesc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+	queryHeapDesc.Count = queryCount;
+	HRESULT hr = device->CreateQueryHeap(&queryHeapDesc, IID_PPV_ARGS(&queryHeap_));
+	assert(SUCCEEDED(hr));
+
+	// CPUから読むのでReadbackHeapに置く
+	D3D12_HEAP_PROPERTIES heapProperties{};
+	heapProperties.Type = D3D12_HEAP_TYPE_READBACK;
+	D3D12_RESOURCE_DESC resourceDesc{};
+	resourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+	resourceDesc.Width = sizeof(uint64_t) * queryCount;
+	resourceDesc.Height = 1;
+	resourceDesc.DepthOrArraySize = 1;
+	resourceDesc.MipLevels = 1;
+	resourceDesc.SampleDesc.Count = 1;
+	resourceDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+	hr = device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &resourceDesc,
+		D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&readbackBuffer_));
+	assert(SUCCEEDED(hr));
+
+	hr = commandQueue_->GetTimestampFrequency(&frequency_);
+	assert(SUCCEEDED(hr));
+	LARGE_INTEGER cpuFrequency{};
+	QueryPerformanceFrequency(&cpuFrequency);
+	cpuFrequency_ = cpuFrequency.QuadPart;
+}
+
+void D3D12GpuQuerySource::Finalize() {
+	if (readbackBuffer_) {
+		readbackBuffer_->Release();
+		readbackBuffer_ = nullptr;
+	}
+	if (queryHeap_) {
+		queryHeap_->Release();
+		queryHeap_ = nullptr;
+	}
+}
+
+void D3D12GpuQuerySource::WriteTimestamp(uint32_t query) {
+	commandList_->EndQuery(queryHeap_, D3D12_QUERY_TYPE_TIMESTAMP, query);
+}
+
+void D3D12GpuQuerySource::ResolveTimestamps(uint32_t first, uint32_t count) {
+	commandList_->ResolveQueryData(queryHeap_, D3D12_QUERY_TYPE_TIMESTAMP, first, count, readbackBuffer_, sizeof(uint64_t) * first);
+}
+
+void D3D12GpuQuerySource::ReadTimestamps(uint32_t first, uint32_t count, uint64_t* timestamps) {
+	// 読む範囲だけをMapし、CPUからは何も書かない
+	const D3D12_RANGE readRange{ sizeof(uint64_t) * first, sizeof(uint64_t) * (first + count) };
+	void* data = nullptr;
+	HRESULT hr = readbackBuffer_->Map(0, &readRange, &data);
+	assert(SUCCEEDED(hr));
+	std::memcpy(timestamps, static_cast<const uint8_t*>(data) + readRange.Begin, sizeof(uint64_t) * count);
+	const D3D12_RANGE writtenRange{ 0, 0 };
+	readbackBuffer_->Unmap(0, &writtenRange);
+}
+
+bool D3D12GpuQuerySource::GetClockCalibration(uint64_t& gpuTimestamp, int64_t& cpuNanoseconds) {
+	// CPU側はQueryPerformanceCounterの値。steady_clockと同じ時計なのでナノ秒にすればそのまま並べられる
+	uint64_t cpuTimestamp = 0;
+	if (FAILED(commandQueue_->GetClockCalibration(&gpuTimestamp, &cpuTimestamp))) {
+		return false;
+	}
+	cpuNanoseconds = int64_t(cpuTimestamp / uint64_t(cpuFrequency_)) * 1000000000 +
+		int64_t(cpuTimestamp % uint64_t(cpuFrequency_)) * 1000000000 / cpuFrequency_;
+	return true;
+}
\ No newline at end of file
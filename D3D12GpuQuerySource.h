@@ -0,0 +1,32 @@
+#pragma once
+#include <d3d12.h>
+#include "GpuProfiler.h"
+
+/// <summary>
+/// GpuProfilerのクエリをD3D12のタイムスタンプクエリにする
+/// 結果は読み戻し用のバッファの同じ番号の位置に書き出す
+/// </summary>
+class D3D12GpuQuerySource : public GpuQuerySource {
+public:
+	// queryCount: 全フレーム分のクエリの数(GpuProfilerのframeCount * maxQueriesPerFrame)
+	void Initialize(ID3D12Device* device, ID3D12CommandQueue* commandQueue, uint32_t queryCount);
+	// GPUの完了を待ってから呼ぶ
+	void Finalize();
+
+	// クエリを積むコマンドリスト。区間の前後でリストが変わるなら、その都度設定する
+	void SetCommandList(ID3D12GraphicsCommandList* commandList) { commandList_ = commandList; }
+
+	void WriteTimestamp(uint32_t query) override;
+	void ResolveTimestamps(uint32_t first, uint32_t count) override;
+	void ReadTimestamps(uint32_t first, uint32_t count, uint64_t* timestamps) override;
+	uint64_t GetTimestampFrequency() const override { return frequency_; }
+	bool GetClockCalibration(uint64_t& gpuTimestamp, int64_t& cpuNanoseconds) override;
+
+private:
+	ID3D12CommandQueue* commandQueue_ = nullptr;
+	ID3D12GraphicsCommandList* commandList_ = nullptr;
+	ID3D12QueryHeap* queryHeap_ = nullptr;
+	ID3D12Resource* readbackBuffer_ = nullptr;
+	uint64_t frequency_ = 1;
+	int64_t cpuFrequency_ = 1; //!< QueryPerformanceCounterの1秒あたりの値
+};
\ No newline at end of file
@@ -0,0 +1,51 @@
+#include "D3D12MemoryTracking.h"
+#include <cassert>
+
+namespace {
+	// ヒープの設定から、GPUのメモリがどちらのセグメントにあるかを決める
+	MemorySegment GetSegment(ID3D12Device* device, const D3D12_HEAP_PROPERTIES& properties) {
+		// UMAではメモリは1つだけで、全てLocalとして報告される
+		D3D12_FEATURE_DATA_ARCHITECTURE architecture{};
+		HRESULT hr = device->CheckFeatureSupport(D3D12_FEATURE_ARCHITECTURE, &architecture, sizeof(architecture));
+		if (SUCCEEDED(hr) && architecture.UMA) {
+			return MemorySegment::Local;
+		}
+		switch (properties.Type) {
+		case D3D12_HEAP_TYPE_UPLOAD:
+		case D3D12_HEAP_TYPE_READBACK:
+			return MemorySegment::NonLocal;
+		case D3D12_HEAP_TYPE_CUSTOM:
+			return properties.MemoryPoolPreference == D3D12_MEMORY_POOL_L1 ? MemorySegment::Local : MemorySegment::NonLocal;
+		default:
+			return MemorySegment::Local;
+		}
+	}
+}
+
+void TrackD3D12Resource(ID3D12Device* device, ID3D12Resource* resource, MemoryCategory category, const std::string& name,
+	uint64_t cpuBytes, MemoryTracker& tracker) {
+	assert(resource);
+	const D3D12_RESOURCE_DESC resourceDesc = resource->GetDesc();
+	const D3D12_RESOURCE_ALLOCATION_INFO allocationInfo = device->GetResourceAllocationInfo(0, 1, &resourceDesc);
+	D3D12_HEAP_PROPERTIES heapProperties{};
+	D3D12_HEAP_FLAGS heapFlags{};
+	HRESULT hr = resource->GetHeapProperties(&heapProperties, &heapFlags);
+	assert(SUCCEEDED(hr));
+	tracker.Track(resource, category, name, cpuBytes, allocationInfo.SizeInBytes, GetSegment(device, heapProperties));
+}
+
+void TrackD3D12Heap(ID3D12Device* device, ID3D12Heap* heap, MemoryCategory category, const std::string& name, MemoryTracker& tracker) {
+	assert(heap);
+	const D3D12_HEAP_DESC heapDesc = heap->GetDesc();
+	tracker.Track(heap, category, name, 0, heapDesc.SizeInBytes, GetSegment(device, heapDesc.Properties));
+}
+
+void UpdateD3D12MemoryBudget(IDXGIAdapter3* adapter, MemoryTracker& tracker) {
+	const DXGI_MEMORY_SEGMENT_GROUP groups[] = { DXGI_MEMORY_SEGMENT_GROUP_LOCAL, DXGI_MEMORY_SEGMENT_GROUP_NON_LOCAL };
+	for (size_t segment = 0; segment < size_t(MemorySegment::Count); ++segment) {
+		DXGI_QUERY_VIDEO_MEMORY_INFO info{};
+		HRESULT hr = adapter->QueryVideoMemoryInfo(0, groups[segment], &info);
+		assert(SUCCEEDED(hr));
+		tracker.SetBudget(MemorySegment(segment), info.Budget, info.CurrentUsage);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,17 @@
+#pragma once
+#include <d3d12.h>
+#include <dxgi1_4.h>
+#include <string>
+#include "MemoryTracker.h"
+
+// resourceのGPUでの大きさをGetResourceAllocationInfoで求めてtrackerに追跡させる。置き場所はヒープの種類から決める
+// cpuBytes: 同じものをCPUでも持っているならそのバイト数(ScratchImageなど)
+void TrackD3D12Resource(ID3D12Device* device, ID3D12Resource* resource, MemoryCategory category, const std::string& name,
+	uint64_t cpuBytes = 0, MemoryTracker& tracker = GetMemoryTracker());
+
+// heapはヒープ全体の大きさで追跡する。中に置くリソースは追跡しない
+void TrackD3D12Heap(ID3D12Device* device, ID3D12Heap* heap, MemoryCategory category, const std::string& name,
+	MemoryTracker& tracker = GetMemoryTracker());
+
+// QueryVideoMemoryInfoでセグメントごとの予算と使用量を読み、trackerに渡す。毎フレーム呼んでもよい
+void UpdateD3D12MemoryBudget(IDXGIAdapter3* adapter, MemoryTracker& tracker = GetMemoryTracker());
\ No newline at end of file
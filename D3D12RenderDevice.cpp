@@ -0,0 +1,365 @@
+#include "D3D12RenderDevice.h"
+#include <cassert>
+#include <unordered_map>
+#include "D3D12MemoryTracking.h"
+
+namespace {
+	D3D12_HEAP_TYPE ToHeapType(RenderHeapType heapType) {
+		switch (heapType) {
+		case RenderHeapType::Upload:
+			return D3D12_HEAP_TYPE_UPLOAD;
+		case RenderHeapType::Readback:
+			return D3D12_HEAP_TYPE_READBACK;
+		default:
+			return D3D12_HEAP_TYPE_DEFAULT;
+		}
+	}
+
+	// ヒープごとに決まっている最初の状態
+	D3D12_RESOURCE_STATES GetInitialState(RenderHeapType heapType) {
+		switch (heapType) {
+		case RenderHeapType::Upload:
+			return D3D12_RESOURCE_STATE_GENERIC_READ;
+		case RenderHeapType::Readback:
+			return D3D12_RESOURCE_STATE_COPY_DEST;
+		default:
+			return D3D12_RESOURCE_STATE_COMMON;
+		}
+	}
+}
+
+void D3D12RenderDevice::Initialize(ID3D12Device* device, ID3D12RootSignature* rootSignature, ID3D12DescriptorHeap* srvDescriptorHeap,
+	uint32_t firstDescriptor, uint32_t descriptorCount, D3D12GpuMemoryAllocator* memoryAllocator) {
+	device_ = device;
+	rootSignature_ = rootSignature;
+	srvDescriptorHeap_ = srvDescriptorHeap;
+	memoryAllocator_ = memoryAllocator;
+	descriptorSize_ = device_->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+	// 若い番号から使うように逆順に積む
+	freeDescriptors_.clear();
+	for (uint32_t index = descriptorCount; index > 0; --index) {
+		freeDescriptors_.push_back(firstDescriptor + index - 1);
+	}
+}
+
+void D3D12RenderDevice::Finalize() {
+	buffers_.ForEach([this](Buffer& buffer) {
+		if (!buffer.imported) {
+			ReleaseResource(buffer.resource);
+		}
+	});
+	textures_.ForEach([this](Texture& texture) {
+		ReleaseResource(texture.resource);
+	});
+	pipelines_.ForEach([](Pipeline& pipeline) {
+		if (!pipeline.imported) {
+			pipeline.pipelineState->Release();
+		}
+	});
+	buffers_.Clear();
+	textures_.Clear();
+	descriptors_.Clear();
+	pipelines_.Clear();
+	freeDescriptors_.clear();
+	bufferBytes_ = 0;
+	textureBytes_ = 0;
+}
+
+RenderBufferHandle D3D12RenderDevice::ImportBuffer(ID3D12Resource* resource, RenderHeapType heapType) {
+	assert(resource);
+	const uint64_t size = resource->GetDesc().Width;
+	bufferBytes_ += size;
+	return { buffers_.Add({ resource, resource->GetGPUVirtualAddress(), size, heapType, MemoryCategory::Other, true }) };
+}
+
+RenderDescriptorHandle D3D12RenderDevice::ImportTextureView(D3D12_GPU_DESCRIPTOR_HANDLE handle) {
+	return { descriptors_.Add({ handle, UINT32_MAX }) };
+}
+
+RenderPipelineHandle D3D12RenderDevice::ImportPipeline(ID3D12PipelineState* pipelineState) {
+	return { pipelines_.Add({ pipelineState, true }) };
+}
+
+void D3D12RenderDevice::ReplacePipeline(RenderPipelineHandle pipeline, ID3D12PipelineState* pipelineState) {
+	Pipeline* record = pipelines_.Get(pipeline.id);
+	assert(record && record->imported);
+	record->pipelineState = pipelineState;
+}
+
+RenderBufferHandle D3D12RenderDevice::CreateBuffer(const RenderBufferDesc& desc) {
+	assert(desc.size > 0);
+	D3D12_HEAP_PROPERTIES heapProperties{};
+	heapProperties.Type = ToHeapType(desc.heapType);
+	D3D12_RESOURCE_DESC resourceDesc{};
+	resourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+	resourceDesc.Width = desc.size;
+	resourceDesc.Height = 1;
+	resourceDesc.DepthOrArraySize = 1;
+	resourceDesc.MipLevels = 1;
+	resourceDesc.SampleDesc.Count = 1;
+	resourceDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+	// Mapしたポインタを持ち続けられるので、動かすのはDefaultHeapのものだけにする
+	ID3D12Resource* resource = CreateResource(resourceDesc, heapProperties, GetInitialState(desc.heapType),
+		desc.heapType == RenderHeapType::Default, desc.category, "RenderDevice buffer");
+	bufferBytes_ += desc.size;
+	return { buffers_.Add({ resource, resource->GetGPUVirtualAddress(), desc.size, desc.heapType, desc.category, false }) };
+}
+
+void D3D12RenderDevice::DestroyBuffer(RenderBufferHandle buffer) {
+	Buffer* record = buffers_.Get(buffer.id);
+	assert(record);
+	if (!record->imported) {
+		ReleaseResource(record->resource);
+	}
+	bufferBytes_ -= record->size;
+	buffers_.Remove(buffer.id);
+}
+
+void* D3D12RenderDevice::Map(RenderBufferHandle buffer) {
+	Buffer* record = buffers_.Get(buffer.id);
+	assert(record && record->heapType != RenderHeapType::Default);
+	void* data = nullptr;
+	HRESULT hr = record->resource->Map(0, nullptr, &data);
+	assert(SUCCEEDED(hr));
+	return data;
+}
+
+void D3D12RenderDevice::Unmap(RenderBufferHandle buffer) {
+	Buffer* record = buffers_.Get(buffer.id);
+	assert(record);
+	record->resource->Unmap(0, nullptr);
+}
+
+RenderTextureHandle D3D12RenderDevice::CreateTexture(const RenderTextureDesc& desc) {
+	D3D12_RESOURCE_DESC resourceDesc{};
+	resourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+	resourceDesc.Width = desc.width;
+	resourceDesc.Height = desc.height;
+	resourceDesc.DepthOrArraySize = 1;
+	resourceDesc.MipLevels = UINT16(desc.mipLevels);
+	resourceDesc.Format = DXGI_FORMAT(desc.format);
+	resourceDesc.SampleDesc.Count = 1;
+	// WriteToSubresourceで書けるように、CPUから触れるメモリに置く
+	D3D12_HEAP_PROPERTIES heapProperties{};
+	heapProperties.Type = D3D12_HEAP_TYPE_CUSTOM;
+	heapProperties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_WRITE_BACK;
+	heapProperties.MemoryPoolPreference = D3D12_MEMORY_POOL_L0;
+	ID3D12Resource* resource = CreateResource(resourceDesc, heapProperties, D3D12_RESOURCE_STATE_GENERIC_READ, false,
+		MemoryCategory::Texture, "RenderDevice texture");
+	const uint64_t bytes = device_->GetResourceAllocationInfo(0, 1, &resourceDesc).SizeInBytes;
+	textureBytes_ += bytes;
+	return { textures_.Add({ resource, desc, bytes }) };
+}
+
+void D3D12RenderDevice::DestroyTexture(RenderTextureHandle texture) {
+	Texture* record = textures_.Get(texture.id);
+	assert(record);
+	ReleaseResource(record->resource);
+	textureBytes_ -= record->bytes;
+	textures_.Remove(texture.id);
+}
+
+void D3D12RenderDevice::WriteTexture(RenderTextureHandle texture, uint32_t mipLevel, const void* data, uint32_t rowPitch, uint32_t slicePitch) {
+	Texture* record = textures_.Get(texture.id);
+	assert(record && mipLevel < record->desc.mipLevels);
+	HRESULT hr = record->resource->WriteToSubresource(mipLevel, nullptr, data, rowPitch, slicePitch);
+	assert(SUCCEEDED(hr));
+}
+
+RenderDescriptorHandle D3D12RenderDevice::CreateTextureView(RenderTextureHandle texture) {
+	Texture* record = textures_.Get(texture.id);
+	assert(record);
+	assert(!freeDescriptors_.empty());
+	const uint32_t index = freeDescriptors_.back();
+	freeDescriptors_.pop_back();
+
+	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc{};
+	srvDesc.Format = DXGI_FORMAT(record->desc.format);
+	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+	srvDesc.Texture2D.MipLevels = record->desc.mipLevels;
+	D3D12_CPU_DESCRIPTOR_HANDLE cpuHandle = srvDescriptorHeap_->GetCPUDescriptorHandleForHeapStart();
+	cpuHandle.ptr += size_t(descriptorSize_) * index;
+	device_->CreateShaderResourceView(record->resource, &srvDesc, cpuHandle);
+	D3D12_GPU_DESCRIPTOR_HANDLE gpuHandle = srvDescriptorHeap_->GetGPUDescriptorHandleForHeapStart();
+	gpuHandle.ptr += uint64_t(descriptorSize_) * index;
+	return { descriptors_.Add({ gpuHandle, index }) };
+}
+
+void D3D12RenderDevice::DestroyDescriptor(RenderDescriptorHandle descriptor) {
+	Descriptor* record = descriptors_.Get(descriptor.id);
+	assert(record);
+	if (record->index != UINT32_MAX) {
+		freeDescriptors_.push_back(record->index);
+	}
+	descriptors_.Remove(descriptor.id);
+}
+
+RenderPipelineHandle D3D12RenderDevice::CreatePipeline(const RenderPipelineDesc& desc) {
+	// VertexDataと同じ並び
+	D3D12_INPUT_ELEMENT_DESC inputElementDescs[3] = {};
+	inputElementDescs[0].SemanticName = "POSITION";
+	inputElementDescs[0].Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+	inputElementDescs[0].AlignedByteOffset = D3D12_APPEND_ALIGNED_ELEMENT;
+	inputElementDescs[1].SemanticName = "TEXCOORD";
+	inputElementDescs[1].Format = DXGI_FORMAT_R32G32_FLOAT;
+	inputElementDescs[1].AlignedByteOffset = D3D12_APPEND_ALIGNED_ELEMENT;
+	inputElementDescs[2].SemanticName = "NORMAL";
+	inputElementDescs[2].Format = DXGI_FORMAT_R32G32B32_FLOAT;
+	inputElementDescs[2].AlignedByteOffset = D3D12_APPEND_ALIGNED_ELEMENT;
+
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC pipelineStateDesc{};
+	pipelineStateDesc.pRootSignature = rootSignature_;
+	pipelineStateDesc.InputLayout = { inputElementDescs, _countof(inputElementDescs) };
+	pipelineStateDesc.VS = { desc.vertexShader, desc.vertexShaderSize };
+	pipelineStateDesc.PS = { desc.pixelShader, desc.pixelShaderSize };
+	D3D12_RENDER_TARGET_BLEND_DESC& blendDesc = pipelineStateDesc.BlendState.RenderTarget[0];
+	blendDesc.RenderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_ALL;
+	if (desc.alphaBlend) {
+		blendDesc.BlendEnable = true;
+		blendDesc.SrcBlend = D3D12_BLEND_SRC_ALPHA;
+		blendDesc.DestBlend = D3D12_BLEND_INV_SRC_ALPHA;
+		blendDesc.BlendOp = D3D12_BLEND_OP_ADD;
+		blendDesc.SrcBlendAlpha = D3D12_BLEND_ONE;
+		blendDesc.DestBlendAlpha = D3D12_BLEND_ZERO;
+		blendDesc.BlendOpAlpha = D3D12_BLEND_OP_ADD;
+	}
+	pipelineStateDesc.RasterizerState.CullMode = desc.cullBack ? D3D12_CULL_MODE_BACK : D3D12_CULL_MODE_NONE;
+	pipelineStateDesc.RasterizerState.FillMode = D3D12_FILL_MODE_SOLID;
+	pipelineStateDesc.DepthStencilState.DepthEnable = desc.depthTest || desc.depthWrite;
+	pipelineStateDesc.DepthStencilState.DepthWriteMask = desc.depthWrite ? D3D12_DEPTH_WRITE_MASK_ALL : D3D12_DEPTH_WRITE_MASK_ZERO;
+	pipelineStateDesc.DepthStencilState.DepthFunc = desc.depthTest ? D3D12_COMPARISON_FUNC_LESS_EQUAL : D3D12_COMPARISON_FUNC_ALWAYS;
+	pipelineStateDesc.DSVFormat = DXGI_FORMAT(desc.depthStencilFormat);
+	pipelineStateDesc.NumRenderTargets = 1;
+	pipelineStateDesc.RTVFormats[0] = DXGI_FORMAT(desc.renderTargetFormat);
+	pipelineStateDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+	pipelineStateDesc.SampleDesc.Count = 1;
+	pipelineStateDesc.SampleMask = D3D12_DEFAULT_SAMPLE_MASK;
+
+	ID3D12PipelineState* pipelineState = nullptr;
+	HRESULT hr = device_->CreateGraphicsPipelineState(&pipelineStateDesc, IID_PPV_ARGS(&pipelineState));
+	assert(SUCCEEDED(hr));
+	return { pipelines_.Add({ pipelineState, false }) };
+}
+
+void D3D12RenderDevice::DestroyPipeline(RenderPipelineHandle pipeline) {
+	Pipeline* record = pipelines_.Get(pipeline.id);
+	assert(record);
+	if (!record->imported) {
+		record->pipelineState->Release();
+	}
+	pipelines_.Remove(pipeline.id);
+}
+
+RenderDeviceStats D3D12RenderDevice::GetStats() const {
+	RenderDeviceStats stats{};
+	stats.bufferCount = buffers_.GetCount();
+	stats.bufferBytes = bufferBytes_;
+	stats.textureCount = textures_.GetCount();
+	stats.textureBytes = textureBytes_;
+	stats.descriptorCount = descriptors_.GetCount();
+	stats.pipelineCount = pipelines_.GetCount();
+	return stats;
+}
+
+void D3D12RenderDevice::ApplyRelocations(const std::vector<D3D12Relocation>& relocations) {
+	if (relocations.empty()) {
+		return;
+	}
+	std::unordered_map<ID3D12Resource*, ID3D12Resource*> newResources;
+	for (const D3D12Relocation& relocation : relocations) {
+		newResources.emplace(relocation.oldResource, relocation.newResource);
+	}
+	// 動いたのはD3D12GpuMemoryAllocatorのヒープの中だけなので、MemoryTrackerの数は変わらない
+	buffers_.ForEach([&](Buffer& buffer) {
+		auto it = newResources.find(buffer.resource);
+		if (it == newResources.end() || buffer.imported) {
+			return;
+		}
+		buffer.resource = it->second;
+		buffer.address = buffer.resource->GetGPUVirtualAddress();
+	});
+}
+
+ID3D12Resource* D3D12RenderDevice::GetResource(RenderBufferHandle buffer) const {
+	const Buffer* record = buffers_.Get(buffer.id);
+	assert(record);
+	return record->resource;
+}
+
+D3D12_GPU_VIRTUAL_ADDRESS D3D12RenderDevice::GetGpuAddress(RenderBufferHandle buffer) const {
+	const Buffer* record = buffers_.Get(buffer.id);
+	assert(record);
+	return record->address;
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE D3D12RenderDevice::GetDescriptor(RenderDescriptorHandle descriptor) const {
+	const Descriptor* record = descriptors_.Get(descriptor.id);
+	assert(record);
+	return record->gpuHandle;
+}
+
+ID3D12PipelineState* D3D12RenderDevice::GetPipelineState(RenderPipelineHandle pipeline) const {
+	const Pipeline* record = pipelines_.Get(pipeline.id);
+	assert(record);
+	return record->pipelineState;
+}
+
+ID3D12Resource* D3D12RenderDevice::CreateResource(const D3D12_RESOURCE_DESC& desc, const D3D12_HEAP_PROPERTIES& heapProperties,
+	D3D12_RESOURCE_STATES initialState, bool movable, MemoryCategory category, const char* name) {
+	if (memoryAllocator_) {
+		// ヒープ全体をD3D12GpuMemoryAllocatorが数えているので、リソースを数えると二重になる
+		return memoryAllocator_->CreateResource(desc, heapProperties, initialState, nullptr, movable);
+	}
+	ID3D12Resource* resource = nullptr;
+	HRESULT hr = device_->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &desc,
+		initialState, nullptr, IID_PPV_ARGS(&resource));
+	assert(SUCCEEDED(hr));
+	TrackD3D12Resource(device_, resource, category, name);
+	return resource;
+}
+
+void D3D12RenderDevice::ReleaseResource(ID3D12Resource* resource) {
+	if (memoryAllocator_) {
+		memoryAllocator_->DestroyResource(resource);
+	} else {
+		GetMemoryTracker().Untrack(resource);
+		resource->Release();
+	}
+}
+
+void D3D12RenderCommandList::SetPipeline(RenderPipelineHandle pipeline) {
+	commandList_->SetPipelineState(device_.GetPipelineState(pipeline));
+}
+
+void D3D12RenderCommandList::SetConstantBuffer(uint32_t rootParameter, RenderBufferHandle buffer, uint64_t offset) {
+	commandList_->SetGraphicsRootConstantBufferView(rootParameter, device_.GetGpuAddress(buffer) + offset);
+}
+
+void D3D12RenderCommandList::SetTexture(uint32_t rootParameter, RenderDescriptorHandle descriptor) {
+	commandList_->SetGraphicsRootDescriptorTable(rootParameter, device_.GetDescriptor(descriptor));
+}
+
+void D3D12RenderCommandList::SetVertexBuffer(RenderBufferHandle buffer, uint64_t offset, uint32_t size, uint32_t stride) {
+	D3D12_VERTEX_BUFFER_VIEW vertexBufferView{};
+	vertexBufferView.BufferLocation = device_.GetGpuAddress(buffer) + offset;
+	vertexBufferView.SizeInBytes = size;
+	vertexBufferView.StrideInBytes = stride;
+	commandList_->IASetVertexBuffers(0, 1, &vertexBufferView);
+}
+
+void D3D12RenderCommandList::SetIndexBuffer(RenderBufferHandle buffer, uint64_t offset, uint32_t size) {
+	D3D12_INDEX_BUFFER_VIEW indexBufferView{};
+	indexBufferView.BufferLocation = device_.GetGpuAddress(buffer) + offset;
+	indexBufferView.SizeInBytes = size;
+	indexBufferView.Format = DXGI_FORMAT_R32_UINT;
+	commandList_->IASetIndexBuffer(&indexBufferView);
+}
+
+void D3D12RenderCommandList::Draw(uint32_t vertexCount, uint32_t instanceCount) {
+	commandList_->DrawInstanced(vertexCount, instanceCount, 0, 0);
+}
+
+void D3D12RenderCommandList::DrawIndexed(uint32_t indexCount, uint32_t instanceCount) {
+	commandList_->DrawIndexedInstanced(indexCount, instanceCount, 0, 0, 0);
+}
\ No newline at end of file
@@ -0,0 +1,118 @@
+#pragma once
+#include <d3d12.h>
+#include <vector>
+#include "RenderDevice.h"
+#include "D3D12GpuMemoryAllocator.h"
+
+/// <summary>
+/// RenderDeviceのD3D12の実装。リソースはCommittedResourceで作る。D3D12GpuMemoryAllocatorを渡せばその上にPlacedResourceで作る
+/// ディスクリプタは渡されたヒープの一部の範囲を使い、RootSignatureは全てのPSOで共通のものを使う
+/// 既に作ってあるD3D12のオブジェクトはImportで番号を付けて使える
+/// </summary>
+class D3D12RenderDevice : public RenderDevice {
+public:
+	// srvDescriptorHeapの[firstDescriptor, firstDescriptor + descriptorCount)をCreateTextureViewで使う
+	// memoryAllocator: 渡せばバッファとテクスチャをその上に作る。Finalizeより後まで残しておく
+	void Initialize(ID3D12Device* device, ID3D12RootSignature* rootSignature, ID3D12DescriptorHeap* srvDescriptorHeap,
+		uint32_t firstDescriptor, uint32_t descriptorCount, D3D12GpuMemoryAllocator* memoryAllocator = nullptr);
+	// GPUの完了を待ってから呼ぶ。作ったリソースを解放する。Importしたものは解放しない
+	void Finalize();
+
+	// 外で作ったオブジェクトに番号を付ける。解放は呼び出し側が行い、Destroyは番号を消すだけになる
+	RenderBufferHandle ImportBuffer(ID3D12Resource* resource, RenderHeapType heapType);
+	RenderDescriptorHandle ImportTextureView(D3D12_GPU_DESCRIPTOR_HANDLE handle);
+	RenderPipelineHandle ImportPipeline(ID3D12PipelineState* pipelineState);
+	// Importした番号のPSOを差し替える(シェーダーのホットリロード用)
+	void ReplacePipeline(RenderPipelineHandle pipeline, ID3D12PipelineState* pipelineState);
+
+	// Destroyはリソースをすぐに解放するので、GPUが使い終わってから呼ぶ
+	RenderBufferHandle CreateBuffer(const RenderBufferDesc& desc) override;
+	void DestroyBuffer(RenderBufferHandle buffer) override;
+	void* Map(RenderBufferHandle buffer) override;
+	void Unmap(RenderBufferHandle buffer) override;
+
+	RenderTextureHandle CreateTexture(const RenderTextureDesc& desc) override;
+	void DestroyTexture(RenderTextureHandle texture) override;
+	void WriteTexture(RenderTextureHandle texture, uint32_t mipLevel, const void* data, uint32_t rowPitch, uint32_t slicePitch) override;
+
+	RenderDescriptorHandle CreateTextureView(RenderTextureHandle texture) override;
+	void DestroyDescriptor(RenderDescriptorHandle descriptor) override;
+
+	RenderPipelineHandle CreatePipeline(const RenderPipelineDesc& desc) override;
+	void DestroyPipeline(RenderPipelineHandle pipeline) override;
+
+	RenderDeviceStats GetStats() const override;
+
+	// D3D12GpuMemoryAllocator::Defragmentで作り直されたバッファのリソースとアドレスを差し替える
+	void ApplyRelocations(const std::vector<D3D12Relocation>& relocations);
+
+	// D3D12RenderCommandListが使う。生成や破棄と同時でなければ複数のスレッドから呼べる
+	ID3D12Resource* GetResource(RenderBufferHandle buffer) const;
+	D3D12_GPU_VIRTUAL_ADDRESS GetGpuAddress(RenderBufferHandle buffer) const;
+	D3D12_GPU_DESCRIPTOR_HANDLE GetDescriptor(RenderDescriptorHandle descriptor) const;
+	ID3D12PipelineState* GetPipelineState(RenderPipelineHandle pipeline) const;
+
+private:
+	struct Buffer {
+		ID3D12Resource* resource;
+		D3D12_GPU_VIRTUAL_ADDRESS address;
+		uint64_t size;
+		RenderHeapType heapType;
+		MemoryCategory category;
+		bool imported;
+	};
+	struct Texture {
+		ID3D12Resource* resource;
+		RenderTextureDesc desc;
+		uint64_t bytes; //!< ヒープ上の大きさ
+	};
+	struct Descriptor {
+		D3D12_GPU_DESCRIPTOR_HANDLE gpuHandle;
+		uint32_t index; //!< ヒープの中の番号。ImportしたものはUINT32_MAX
+	};
+	struct Pipeline {
+		ID3D12PipelineState* pipelineState;
+		bool imported;
+	};
+
+	// memoryAllocator_があればそちらで作る。無ければCommittedResourceにしてMemoryTrackerにcategoryとnameで数える
+	ID3D12Resource* CreateResource(const D3D12_RESOURCE_DESC& desc, const D3D12_HEAP_PROPERTIES& heapProperties,
+		D3D12_RESOURCE_STATES initialState, bool movable, MemoryCategory category, const char* name);
+	// CreateResourceで作ったものを解放し、数えていればMemoryTrackerから外す
+	void ReleaseResource(ID3D12Resource* resource);
+
+	ID3D12Device* device_ = nullptr;
+	ID3D12RootSignature* rootSignature_ = nullptr;
+	ID3D12DescriptorHeap* srvDescriptorHeap_ = nullptr;
+	D3D12GpuMemoryAllocator* memoryAllocator_ = nullptr;
+	uint32_t descriptorSize_ = 0;
+	std::vector<uint32_t> freeDescriptors_; //!< 空いているヒープの中の番号
+	RenderHandlePool<Buffer> buffers_;
+	RenderHandlePool<Texture> textures_;
+	RenderHandlePool<Descriptor> descriptors_;
+	RenderHandlePool<Pipeline> pipelines_;
+	uint64_t bufferBytes_ = 0;
+	uint64_t textureBytes_ = 0;
+};
+
+/// <summary>
+/// D3D12RenderDeviceのリソースをD3D12のコマンドリストに積む
+/// 記録するだけなので、スレッドごとのコマンドリストに1つずつ作って使い捨てにしてよい
+/// </summary>
+class D3D12RenderCommandList : public RenderCommandList {
+public:
+	D3D12RenderCommandList(ID3D12GraphicsCommandList* commandList, const D3D12RenderDevice& device)
+		: commandList_(commandList), device_(device) {}
+
+	void SetPipeline(RenderPipelineHandle pipeline) override;
+	void SetConstantBuffer(uint32_t rootParameter, RenderBufferHandle buffer, uint64_t offset) override;
+	void SetTexture(uint32_t rootParameter, RenderDescriptorHandle descriptor) override;
+	void SetVertexBuffer(RenderBufferHandle buffer, uint64_t offset, uint32_t size, uint32_t stride) override;
+	void SetIndexBuffer(RenderBufferHandle buffer, uint64_t offset, uint32_t size) override;
+	void Draw(uint32_t vertexCount, uint32_t instanceCount) override;
+	void DrawIndexed(uint32_t indexCount, uint32_t instanceCount) override;
+
+private:
+	ID3D12GraphicsCommandList* commandList_;
+	const D3D12RenderDevice& device_;
+};
\ No newline at end of file
@@ -0,0 +1,313 @@
+#include "D3D12RenderGraphExecutor.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include "D3D12MemoryTracking.h"
+
+namespace {
+	// ヒープの種類。RTとDSのテクスチャはそれ以外のテクスチャと同じヒープに置けない(Resource Heap Tier1)
+	const uint32_t kHeapRenderTarget = 0;
+	const uint32_t kHeapTexture = 1;
+
+	const uint32_t kDepthUsage = kRenderGraphStateDepthWrite | kRenderGraphStateDepthRead;
+
+	D3D12_RESOURCE_STATES ToResourceState(uint32_t state) {
+		uint32_t result = D3D12_RESOURCE_STATE_COMMON;
+		if (state & kRenderGraphStateRenderTarget) {
+			result |= D3D12_RESOURCE_STATE_RENDER_TARGET;
+		}
+		if (state & kRenderGraphStateDepthWrite) {
+			result |= D3D12_RESOURCE_STATE_DEPTH_WRITE;
+		}
+		if (state & kRenderGraphStateDepthRead) {
+			result |= D3D12_RESOURCE_STATE_DEPTH_READ;
+		}
+		if (state & kRenderGraphStateShaderResource) {
+			result |= D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+		}
+		if (state & kRenderGraphStateUnorderedAccess) {
+			result |= D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+		}
+		if (state & kRenderGraphStateCopySource) {
+			result |= D3D12_RESOURCE_STATE_COPY_SOURCE;
+		}
+		if (state & kRenderGraphStateCopyDest) {
+			result |= D3D12_RESOURCE_STATE_COPY_DEST;
+		}
+		return D3D12_RESOURCE_STATES(result);
+	}
+
+	D3D12_RESOURCE_DESC MakeResourceDesc(const RenderGraphTextureDesc& desc, uint32_t usage) {
+		D3D12_RESOURCE_DESC resourceDesc{};
+		resourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+		resourceDesc.Width = desc.width;
+		resourceDesc.Height = desc.height;
+		resourceDesc.DepthOrArraySize = 1;
+		resourceDesc.MipLevels = 1;
+		resourceDesc.Format = DXGI_FORMAT(desc.format);
+		resourceDesc.SampleDesc.Count = 1;
+		uint32_t flags = D3D12_RESOURCE_FLAG_NONE;
+		if (usage & kRenderGraphStateRenderTarget) {
+			flags |= D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
+		}
+		if (usage & kDepthUsage) {
+			flags |= D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL;
+		}
+		if (usage & kRenderGraphStateUnorderedAccess) {
+			flags |= D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
+		}
+		resourceDesc.Flags = D3D12_RESOURCE_FLAGS(flags);
+		return resourceDesc;
+	}
+}
+
+void D3D12RenderGraphExecutor::Initialize(ID3D12Device* device, uint32_t maxTextureCount) {
+	device_ = device;
+	// RTV、DSVはShader内で触るものではないので、ShaderVisibleはfalse
+	D3D12_DESCRIPTOR_HEAP_DESC descriptorHeapDesc{};
+	descriptorHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
+	descriptorHeapDesc.NumDescriptors = maxTextureCount;
+	HRESULT hr = device_->CreateDescriptorHeap(&descriptorHeapDesc, IID_PPV_ARGS(&rtvDescriptorHeap_));
+	assert(SUCCEEDED(hr));
+	descriptorHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_DSV;
+	hr = device_->CreateDescriptorHeap(&descriptorHeapDesc, IID_PPV_ARGS(&dsvDescriptorHeap_));
+	assert(SUCCEEDED(hr));
+	rtvDescriptorSize_ = device_->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
+	dsvDescriptorSize_ = device_->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_DSV);
+	for (uint32_t descriptor = maxTextureCount; descriptor-- > 0;) {
+		freeDescriptors_.push_back(descriptor);
+	}
+}
+
+void D3D12RenderGraphExecutor::Finalize() {
+	for (Retired& retired : retired_) {
+		retired.object->Release();
+	}
+	retired_.clear();
+	for (Texture& texture : textures_) {
+		texture.resource->Release();
+	}
+	textures_.clear();
+	for (ID3D12Heap* heap : heaps_) {
+		if (heap) {
+			GetMemoryTracker().Untrack(heap);
+			heap->Release();
+		}
+	}
+	heaps_.clear();
+	bindings_.clear();
+	if (dsvDescriptorHeap_) {
+		dsvDescriptorHeap_->Release();
+		dsvDescriptorHeap_ = nullptr;
+	}
+	if (rtvDescriptorHeap_) {
+		rtvDescriptorHeap_->Release();
+		rtvDescriptorHeap_ = nullptr;
+	}
+}
+
+RenderGraphAllocationInfo D3D12RenderGraphExecutor::GetAllocationInfo(const RenderGraphTextureDesc& desc, uint32_t usage) const {
+	D3D12_RESOURCE_DESC resourceDesc = MakeResourceDesc(desc, usage);
+	D3D12_RESOURCE_ALLOCATION_INFO allocationInfo = device_->GetResourceAllocationInfo(0, 1, &resourceDesc);
+	RenderGraphAllocationInfo result{};
+	result.size = allocationInfo.SizeInBytes;
+	result.alignment = allocationInfo.Alignment;
+	result.heap = (usage & (kRenderGraphStateRenderTarget | kDepthUsage)) ? kHeapRenderTarget : kHeapTexture;
+	return result;
+}
+
+void D3D12RenderGraphExecutor::SetImportedTexture(uint32_t resource, ID3D12Resource* texture, D3D12_CPU_DESCRIPTOR_HANDLE renderTargetView) {
+	if (bindings_.size() <= resource) {
+		bindings_.resize(resource + 1, {});
+	}
+	bindings_[resource].texture = texture;
+	bindings_[resource].renderTargetView = renderTargetView;
+	bindings_[resource].depthStencilView = {};
+}
+
+void D3D12RenderGraphExecutor::Prepare(const RenderGraph& graph, uint64_t completedFenceValue, uint64_t submittedFenceValue) {
+	// GPUが使い終わったものを解放する
+	auto released = std::remove_if(retired_.begin(), retired_.end(), [&](const Retired& retired) {
+		if (retired.fenceValue <= completedFenceValue) {
+			retired.object->Release();
+			return true;
+		}
+		return false;
+	});
+	retired_.erase(released, retired_.end());
+
+	// ヒープが足りなければ作り直す。前のヒープに置いていたテクスチャも作り直しになる
+	if (heaps_.size() < graph.GetHeapCount()) {
+		heaps_.resize(graph.GetHeapCount(), nullptr);
+	}
+	for (uint32_t heap = 0; heap < graph.GetHeapCount(); ++heap) {
+		const uint64_t size = graph.GetHeapSize(heap);
+		if (size == 0 || (heaps_[heap] && heaps_[heap]->GetDesc().SizeInBytes >= size)) {
+			continue;
+		}
+		if (heaps_[heap]) {
+			for (Texture& texture : textures_) {
+				if (texture.heap == heap) {
+					RetireTexture(texture, submittedFenceValue);
+				}
+			}
+			GetMemoryTracker().Untrack(heaps_[heap]);
+			Retire(heaps_[heap], submittedFenceValue);
+		}
+		D3D12_HEAP_DESC heapDesc{};
+		heapDesc.SizeInBytes = size;
+		heapDesc.Properties.Type = D3D12_HEAP_TYPE_DEFAULT;
+		heapDesc.Alignment = 0;
+		heapDesc.Flags = (heap == kHeapRenderTarget) ? D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES : D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
+		HRESULT hr = device_->CreateHeap(&heapDesc, IID_PPV_ARGS(&heaps_[heap]));
+		assert(SUCCEEDED(hr));
+		TrackD3D12Heap(device_, heaps_[heap], heap == kHeapRenderTarget ? MemoryCategory::RenderTarget : MemoryCategory::Texture, "RenderGraph heap");
+	}
+	auto removed = std::remove_if(textures_.begin(), textures_.end(), [](const Texture& texture) { return texture.resource == nullptr; });
+	textures_.erase(removed, textures_.end());
+
+	if (bindings_.size() < graph.GetResourceCount()) {
+		bindings_.resize(graph.GetResourceCount(), {});
+	}
+	for (Texture& texture : textures_) {
+		texture.used = false;
+	}
+	for (uint32_t resource = 0; resource < graph.GetResourceCount(); ++resource) {
+		if (!graph.IsTransient(resource)) {
+			continue;
+		}
+		bindings_[resource] = {};
+		const uint32_t heap = graph.GetHeap(resource);
+		if (heap == kRenderGraphInvalid) {
+			continue;
+		}
+		const RenderGraphTextureDesc& desc = graph.GetTextureDesc(resource);
+		const uint32_t usage = graph.GetUsage(resource);
+		const uint32_t initialState = graph.GetInitialState(resource);
+		Texture* found = nullptr;
+		for (Texture& texture : textures_) {
+			if (!texture.used && texture.heap == heap && texture.heapOffset == graph.GetHeapOffset(resource) &&
+				texture.usage == usage && texture.initialState == initialState &&
+				std::memcmp(&texture.desc, &desc, sizeof(desc)) == 0) {
+				found = &texture;
+				break;
+			}
+		}
+		if (!found) {
+			Texture texture{};
+			texture.heap = heap;
+			texture.heapOffset = graph.GetHeapOffset(resource);
+			texture.desc = desc;
+			texture.usage = usage;
+			texture.initialState = initialState;
+			D3D12_RESOURCE_DESC resourceDesc = MakeResourceDesc(desc, usage);
+			// 最適化クリア値はRTとDSだけに設定できる
+			D3D12_CLEAR_VALUE clearValue{};
+			clearValue.Format = resourceDesc.Format;
+			const bool isRenderTarget = (usage & kRenderGraphStateRenderTarget) != 0;
+			const bool isDepthStencil = (usage & kDepthUsage) != 0;
+			if (isDepthStencil) {
+				clearValue.DepthStencil.Depth = desc.clearValue[0];
+			} else {
+				std::memcpy(clearValue.Color, desc.clearValue, sizeof(clearValue.Color));
+			}
+			HRESULT hr = device_->CreatePlacedResource(heaps_[heap], texture.heapOffset, &resourceDesc, ToResourceState(initialState),
+				(isRenderTarget || isDepthStencil) ? &clearValue : nullptr, IID_PPV_ARGS(&texture.resource));
+			assert(SUCCEEDED(hr));
+			texture.descriptor = kRenderGraphInvalid;
+			if (isRenderTarget || isDepthStencil) {
+				assert(!freeDescriptors_.empty());
+				texture.descriptor = freeDescriptors_.back();
+				freeDescriptors_.pop_back();
+			}
+			if (isRenderTarget) {
+				D3D12_CPU_DESCRIPTOR_HANDLE handle = rtvDescriptorHeap_->GetCPUDescriptorHandleForHeapStart();
+				handle.ptr += size_t(rtvDescriptorSize_) * texture.descriptor;
+				device_->CreateRenderTargetView(texture.resource, nullptr, handle);
+			}
+			if (isDepthStencil) {
+				D3D12_DEPTH_STENCIL_VIEW_DESC dsvDesc{};
+				dsvDesc.Format = resourceDesc.Format;
+				dsvDesc.ViewDimension = D3D12_DSV_DIMENSION_TEXTURE2D;
+				D3D12_CPU_DESCRIPTOR_HANDLE handle = dsvDescriptorHeap_->GetCPUDescriptorHandleForHeapStart();
+				handle.ptr += size_t(dsvDescriptorSize_) * texture.descriptor;
+				device_->CreateDepthStencilView(texture.resource, &dsvDesc, handle);
+			}
+			textures_.push_back(texture);
+			found = &textures_.back();
+		}
+		found->used = true;
+		Binding& binding = bindings_[resource];
+		binding.texture = found->resource;
+		if (usage & kRenderGraphStateRenderTarget) {
+			binding.renderTargetView = rtvDescriptorHeap_->GetCPUDescriptorHandleForHeapStart();
+			binding.renderTargetView.ptr += size_t(rtvDescriptorSize_) * found->descriptor;
+		}
+		if (usage & kDepthUsage) {
+			binding.depthStencilView = dsvDescriptorHeap_->GetCPUDescriptorHandleForHeapStart();
+			binding.depthStencilView.ptr += size_t(dsvDescriptorSize_) * found->descriptor;
+		}
+	}
+
+	// このフレームで使わなかったテクスチャは手放す
+	for (Texture& texture : textures_) {
+		if (!texture.used) {
+			RetireTexture(texture, submittedFenceValue);
+		}
+	}
+	removed = std::remove_if(textures_.begin(), textures_.end(), [](const Texture& texture) { return texture.resource == nullptr; });
+	textures_.erase(removed, textures_.end());
+}
+
+void D3D12RenderGraphExecutor::ResourceBarriers(const RenderGraphBarrier* barriers, uint32_t count) {
+	barriers_.clear();
+	for (uint32_t index = 0; index < count; ++index) {
+		const RenderGraphBarrier& barrier = barriers[index];
+		D3D12_RESOURCE_BARRIER resourceBarrier{};
+		resourceBarrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+		if (barrier.type == RenderGraphBarrier::Type::Aliasing) {
+			resourceBarrier.Type = D3D12_RESOURCE_BARRIER_TYPE_ALIASING;
+			// 前のリソースが分からなければnullptrで、同じメモリのどれからでも切り替える
+			resourceBarrier.Aliasing.pResourceBefore = (barrier.resourceBefore != kRenderGraphInvalid) ? bindings_[barrier.resourceBefore].texture : nullptr;
+			resourceBarrier.Aliasing.pResourceAfter = bindings_[barrier.resource].texture;
+		} else {
+			resourceBarrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+			resourceBarrier.Transition.pResource = bindings_[barrier.resource].texture;
+			resourceBarrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+			resourceBarrier.Transition.StateBefore = ToResourceState(barrier.stateBefore);
+			resourceBarrier.Transition.StateAfter = ToResourceState(barrier.stateAfter);
+		}
+		barriers_.push_back(resourceBarrier);
+	}
+	// 1つのパスの前のバリアは1回でまとめて張る
+	commandList_->ResourceBarrier(UINT(barriers_.size()), barriers_.data());
+}
+
+void D3D12RenderGraphExecutor::BeginPass(std::string_view name) {
+	if (gpuProfiler_) {
+		gpuQuerySource_->SetCommandList(commandList_);
+		gpuProfiler_->BeginZone(name);
+	}
+}
+
+void D3D12RenderGraphExecutor::EndPass() {
+	// パスの中で積むリストが変わっていれば、終わりの時刻は後のリストに積む
+	if (gpuProfiler_) {
+		gpuQuerySource_->SetCommandList(commandList_);
+		gpuProfiler_->EndZone();
+	}
+}
+
+void D3D12RenderGraphExecutor::Retire(IUnknown* object, uint64_t fenceValue) {
+	retired_.push_back({ object, fenceValue });
+}
+
+void D3D12RenderGraphExecutor::RetireTexture(Texture& texture, uint64_t fenceValue) {
+	Retire(texture.resource, fenceValue);
+	texture.resource = nullptr;
+	// RTV、DSVはコマンドを積んだ時点で読まれるので、番号はすぐに使い回してよい
+	if (texture.descriptor != kRenderGraphInvalid) {
+		freeDescriptors_.push_back(texture.descriptor);
+		texture.descriptor = kRenderGraphInvalid;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,84 @@
+#pragma once
+#include <d3d12.h>
+#include <vector>
+#include "D3D12GpuQuerySource.h"
+#include "GpuProfiler.h"
+#include "RenderGraph.h"
+
+/// <summary>
+/// RenderGraphの一時テクスチャをD3D12のヒープに置き、バリアをコマンドリストに積む
+/// 一時テクスチャはヒープ上の位置と設定が同じなら次のフレームでも使い回す
+/// </summary>
+class D3D12RenderGraphExecutor : public RenderGraphExecutor {
+public:
+	// maxTextureCount: 同時に使う一時テクスチャの最大数。RTVとDSVをこの数だけ用意する
+	void Initialize(ID3D12Device* device, uint32_t maxTextureCount);
+	// GPUの完了を待ってから呼ぶ
+	void Finalize();
+
+	void SetCommandList(ID3D12GraphicsCommandList* commandList) { commandList_ = commandList; }
+	// パスごとにGPUの時間を測る。nullptrなら測らない
+	void SetGpuProfiler(GpuProfiler* gpuProfiler, D3D12GpuQuerySource* gpuQuerySource) {
+		gpuProfiler_ = gpuProfiler;
+		gpuQuerySource_ = gpuQuerySource;
+	}
+
+	// RenderGraph::Compileに渡す。RTとDSのテクスチャとそれ以外でヒープを分ける
+	RenderGraphAllocationInfo GetAllocationInfo(const RenderGraphTextureDesc& desc, uint32_t usage) const;
+
+	// RenderGraph::ImportTextureで登録したリソースの実体。Prepareの前に毎フレーム設定する
+	void SetImportedTexture(uint32_t resource, ID3D12Resource* texture, D3D12_CPU_DESCRIPTOR_HANDLE renderTargetView);
+
+	// Compileの後、Executeの前に呼ぶ。ヒープと一時テクスチャを用意し、使わなくなったものはGPUが使い終わってから解放する
+	// completedFenceValue: GPUが終えたFenceの値、submittedFenceValue: 最後にSignalしたFenceの値
+	void Prepare(const RenderGraph& graph, uint64_t completedFenceValue, uint64_t submittedFenceValue);
+
+	ID3D12Resource* GetTexture(uint32_t resource) const { return bindings_[resource].texture; }
+	D3D12_CPU_DESCRIPTOR_HANDLE GetRenderTargetView(uint32_t resource) const { return bindings_[resource].renderTargetView; }
+	D3D12_CPU_DESCRIPTOR_HANDLE GetDepthStencilView(uint32_t resource) const { return bindings_[resource].depthStencilView; }
+
+	void ResourceBarriers(const RenderGraphBarrier* barriers, uint32_t count) override;
+	void BeginPass(std::string_view name) override;
+	void EndPass() override;
+
+private:
+	// RenderGraphのリソース番号ごとの実体
+	struct Binding {
+		ID3D12Resource* texture;
+		D3D12_CPU_DESCRIPTOR_HANDLE renderTargetView;
+		D3D12_CPU_DESCRIPTOR_HANDLE depthStencilView;
+	};
+	// ヒープに置いた一時テクスチャ。ヒープ上の位置と設定が同じなら使い回す
+	struct Texture {
+		uint32_t heap;
+		uint64_t heapOffset;
+		RenderGraphTextureDesc desc;
+		uint32_t usage;
+		uint32_t initialState;
+		ID3D12Resource* resource;
+		uint32_t descriptor; //!< RTVかDSVの番号
+		bool used; //!< このフレームで使ったか
+	};
+	struct Retired {
+		IUnknown* object;
+		uint64_t fenceValue; //!< この値までGPUが進めば解放できる
+	};
+
+	void Retire(IUnknown* object, uint64_t fenceValue);
+	void RetireTexture(Texture& texture, uint64_t fenceValue);
+
+	ID3D12Device* device_ = nullptr;
+	ID3D12GraphicsCommandList* commandList_ = nullptr;
+	GpuProfiler* gpuProfiler_ = nullptr;
+	D3D12GpuQuerySource* gpuQuerySource_ = nullptr;
+	ID3D12DescriptorHeap* rtvDescriptorHeap_ = nullptr;
+	ID3D12DescriptorHeap* dsvDescriptorHeap_ = nullptr;
+	uint32_t rtvDescriptorSize_ = 0;
+	uint32_t dsvDescriptorSize_ = 0;
+	std::vector<uint32_t> freeDescriptors_; //!< RTVとDSVは同じ番号を使う
+	std::vector<ID3D12Heap*> heaps_;
+	std::vector<Texture> textures_;
+	std::vector<Binding> bindings_;
+	std::vector<Retired> retired_;
+	std::vector<D3D12_RESOURCE_BARRIER> barriers_;
+};
\ No newline at end of file
@@ -0,0 +1,5 @@
+#pragma once
+#include <d3d12.h>
+
+// UploadHeapにバッファリソースを作る
+ID3D12Resource* CreateBufferResource(ID3D12Device* device, size_t sizeInBytes);
@@ -0,0 +1,209 @@
+#include "DeviceRenderQueueExecutor.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <random>
+#include "NullRenderDevice.h"
+#include "SortKey.h"
+#include "VertexData.h"
+
+uint32_t DeviceRenderQueueExecutor::AddPipeline(RenderPipelineHandle pipeline) {
+	pipelines_.push_back(pipeline);
+	return uint32_t(pipelines_.size() - 1);
+}
+
+uint32_t DeviceRenderQueueExecutor::AddMaterial(RenderBufferHandle buffer) {
+	materials_.push_back(buffer);
+	return uint32_t(materials_.size() - 1);
+}
+
+uint32_t DeviceRenderQueueExecutor::AddTexture(RenderDescriptorHandle descriptor) {
+	textures_.push_back(descriptor);
+	return uint32_t(textures_.size() - 1);
+}
+
+uint32_t DeviceRenderQueueExecutor::AddMesh(const RenderMesh& mesh) {
+	meshes_.push_back(mesh);
+	return uint32_t(meshes_.size() - 1);
+}
+
+void DeviceRenderQueueExecutor::UpdateMesh(uint32_t mesh, const RenderMesh& renderMesh) {
+	assert(mesh < meshes_.size());
+	meshes_[mesh] = renderMesh;
+}
+
+uint32_t DeviceRenderQueueExecutor::AddTransform(RenderBufferHandle buffer) {
+	transforms_.push_back(buffer);
+	return uint32_t(transforms_.size() - 1);
+}
+
+void DeviceRenderQueueExecutor::SetPipeline(uint32_t pipeline) {
+	assert(pipeline < pipelines_.size());
+	commandList_->SetPipeline(pipelines_[pipeline]);
+}
+
+void DeviceRenderQueueExecutor::SetMaterial(uint32_t material) {
+	assert(material < materials_.size());
+	commandList_->SetConstantBuffer(kMaterialRootParameter, materials_[material], 0);
+}
+
+void DeviceRenderQueueExecutor::SetTexture(uint32_t texture) {
+	assert(texture < textures_.size());
+	commandList_->SetTexture(kTextureRootParameter, textures_[texture]);
+}
+
+void DeviceRenderQueueExecutor::SetMesh(uint32_t mesh) {
+	assert(mesh < meshes_.size());
+	const RenderMesh& renderMesh = meshes_[mesh];
+	commandList_->SetVertexBuffer(renderMesh.vertexBuffer, renderMesh.vertexOffset, renderMesh.vertexSize, renderMesh.vertexStride);
+	if (renderMesh.indexBuffer.id != 0) {
+		commandList_->SetIndexBuffer(renderMesh.indexBuffer, renderMesh.indexOffset, renderMesh.indexSize);
+	}
+}
+
+void DeviceRenderQueueExecutor::SetTransform(uint32_t transform) {
+	assert(transform < transforms_.size());
+	commandList_->SetConstantBuffer(kTransformRootParameter, transforms_[transform], 0);
+}
+
+void DeviceRenderQueueExecutor::Draw(const DrawItem& item) {
+	const RenderMesh& renderMesh = meshes_[item.mesh];
+	if (renderMesh.indexBuffer.id != 0) {
+		commandList_->DrawIndexed(renderMesh.count, item.instanceCount);
+	}
+	else {
+		commandList_->Draw(renderMesh.count, item.instanceCount);
+	}
+}
+
+HeadlessRenderQueueBenchmark MeasureHeadlessRenderQueue(uint32_t drawCount, uint32_t iterations) {
+	using Clock = std::chrono::steady_clock;
+	auto microseconds = [](Clock::time_point begin, Clock::time_point end) {
+		return std::chrono::duration<double, std::micro>(end - begin).count();
+	};
+	// main.cppのシーンと同じくらいの種類の状態を用意する
+	const uint32_t kPipelineCount = 8;
+	const uint32_t kMaterialCount = 16;
+	const uint32_t kTextureCount = 16;
+	const uint32_t kMeshCount = 32;
+	const uint32_t kTransformCount = 256;
+	const uint32_t kConstantBufferSize = 256;
+	const uint32_t kVerticesPerMesh = 1536;
+	const uint32_t kIndicesPerMesh = 6144;
+	const uint32_t kR8G8B8A8UnormSrgb = 29;
+	const uint8_t kShaderBytecode[4] = {};
+
+	NullRenderDevice device;
+	DeviceRenderQueueExecutor executor;
+	std::vector<RenderPipelineHandle> pipelines;
+	std::vector<RenderBufferHandle> buffers;
+	std::vector<RenderTextureHandle> textures;
+	std::vector<RenderDescriptorHandle> descriptors;
+	for (uint32_t index = 0; index < kPipelineCount; ++index) {
+		RenderPipelineDesc desc{};
+		desc.vertexShader = kShaderBytecode;
+		desc.vertexShaderSize = sizeof(kShaderBytecode);
+		desc.pixelShader = kShaderBytecode;
+		desc.pixelShaderSize = sizeof(kShaderBytecode);
+		desc.cullBack = true;
+		desc.depthTest = true;
+		desc.depthWrite = true;
+		desc.renderTargetFormat = kR8G8B8A8UnormSrgb;
+		desc.depthStencilFormat = 45; // D24_UNORM_S8_UINT
+		pipelines.push_back(device.CreatePipeline(desc));
+		executor.AddPipeline(pipelines.back());
+	}
+	auto createConstantBuffer = [&]() {
+		buffers.push_back(device.CreateBuffer({ kConstantBufferSize, RenderHeapType::Upload, MemoryCategory::Constant }));
+		return buffers.back();
+	};
+	for (uint32_t index = 0; index < kMaterialCount; ++index) {
+		executor.AddMaterial(createConstantBuffer());
+	}
+	for (uint32_t index = 0; index < kTransformCount; ++index) {
+		executor.AddTransform(createConstantBuffer());
+	}
+	for (uint32_t index = 0; index < kTextureCount; ++index) {
+		textures.push_back(device.CreateTexture({ 512, 512, 10, kR8G8B8A8UnormSrgb }));
+		descriptors.push_back(device.CreateTextureView(textures.back()));
+		executor.AddTexture(descriptors.back());
+	}
+	// メッシュは1つのバッファに並べ、半分はインデックスなしにする
+	const uint32_t vertexSize = uint32_t(sizeof(VertexData)) * kVerticesPerMesh;
+	const uint32_t indexSize = uint32_t(sizeof(uint32_t)) * kIndicesPerMesh;
+	const RenderBufferHandle vertexBuffer = device.CreateBuffer({ uint64_t(vertexSize) * kMeshCount, RenderHeapType::Default, MemoryCategory::Mesh });
+	const RenderBufferHandle indexBuffer = device.CreateBuffer({ uint64_t(indexSize) * kMeshCount, RenderHeapType::Default, MemoryCategory::Mesh });
+	buffers.push_back(vertexBuffer);
+	buffers.push_back(indexBuffer);
+	for (uint32_t index = 0; index < kMeshCount; ++index) {
+		RenderMesh mesh{};
+		mesh.vertexBuffer = vertexBuffer;
+		mesh.vertexOffset = uint64_t(vertexSize) * index;
+		mesh.vertexSize = vertexSize;
+		mesh.vertexStride = uint32_t(sizeof(VertexData));
+		mesh.count = kVerticesPerMesh;
+		if (index % 2 == 0) {
+			mesh.indexBuffer = indexBuffer;
+			mesh.indexOffset = uint64_t(indexSize) * index;
+			mesh.indexSize = indexSize;
+			mesh.count = kIndicesPerMesh;
+		}
+		executor.AddMesh(mesh);
+	}
+
+	std::mt19937 randomEngine(12345);
+	std::uniform_real_distribution<float> depthDistribution(0.1f, 100.0f);
+	std::vector<DrawItem> items(drawCount);
+	for (DrawItem& item : items) {
+		item.pipeline = randomEngine() % kPipelineCount;
+		item.material = randomEngine() % kMaterialCount;
+		item.texture = randomEngine() % kTextureCount;
+		item.mesh = randomEngine() % kMeshCount;
+		item.transform = randomEngine() % kTransformCount;
+		item.instanceCount = 1;
+		item.sortKey = SortKey::Make(0, item.pipeline, (item.material << 8) | item.texture, depthDistribution(randomEngine));
+	}
+
+	HeadlessRenderQueueBenchmark result{};
+	iterations = (std::max)(iterations, 1u);
+	RenderQueue renderQueue;
+	NullRenderCommandList commandList(device);
+	executor.SetCommandList(&commandList);
+	double sortMicroseconds = 0.0;
+	double recordMicroseconds = 0.0;
+	for (uint32_t iteration = 0; iteration < iterations; ++iteration) {
+		renderQueue.Clear();
+		commandList.Reset();
+		for (const DrawItem& item : items) {
+			renderQueue.Push(item);
+		}
+		auto start = Clock::now();
+		renderQueue.Sort();
+		auto middle = Clock::now();
+		renderQueue.ExecuteRange(executor, 0, renderQueue.GetItemCount());
+		auto end = Clock::now();
+		sortMicroseconds += microseconds(start, middle);
+		recordMicroseconds += microseconds(middle, end);
+	}
+	result.drawCount = commandList.GetStats().drawCount;
+	result.stateChangeCount = commandList.GetStats().stateChangeCount;
+	result.sortMicroseconds = sortMicroseconds / iterations;
+	result.recordMicroseconds = recordMicroseconds / iterations;
+	result.nanosecondsPerDraw = drawCount > 0 ? (result.sortMicroseconds + result.recordMicroseconds) * 1000.0 / drawCount : 0.0;
+
+	for (RenderDescriptorHandle descriptor : descriptors) {
+		device.DestroyDescriptor(descriptor);
+	}
+	for (RenderTextureHandle texture : textures) {
+		device.DestroyTexture(texture);
+	}
+	for (RenderBufferHandle buffer : buffers) {
+		device.DestroyBuffer(buffer);
+	}
+	for (RenderPipelineHandle pipeline : pipelines) {
+		device.DestroyPipeline(pipeline);
+	}
+	result.peakBytes = device.GetPeakBytes();
+	result.validationErrorCount = device.GetStats().validationErrorCount;
+	return result;
+}
\ No newline at end of file
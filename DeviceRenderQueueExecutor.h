@@ -0,0 +1,73 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "RenderDevice.h"
+#include "RenderQueue.h"
+
+/// <summary>
+/// RenderQueueで使うメッシュ。indexBufferが無効ならインデックスなしで描画する
+/// </summary>
+struct RenderMesh {
+	RenderBufferHandle vertexBuffer;
+	uint64_t vertexOffset;
+	uint32_t vertexSize; //!< 使う範囲のバイト数
+	uint32_t vertexStride;
+	RenderBufferHandle indexBuffer;
+	uint64_t indexOffset;
+	uint32_t indexSize;
+	uint32_t count; //!< 頂点数(インデックスありならインデックス数)
+};
+
+/// <summary>
+/// RenderQueueの描画をRenderCommandListに積む。描画APIには依存しない
+/// </summary>
+class DeviceRenderQueueExecutor : public RenderQueueExecutor {
+public:
+	// RootSignatureのパラメータ番号
+	static const uint32_t kMaterialRootParameter = 0;
+	static const uint32_t kTransformRootParameter = 1;
+	static const uint32_t kTextureRootParameter = 2;
+
+	void SetCommandList(RenderCommandList* commandList) { commandList_ = commandList; }
+
+	// 各状態を登録してDrawItemで使う番号を返す
+	uint32_t AddPipeline(RenderPipelineHandle pipeline);
+	uint32_t AddMaterial(RenderBufferHandle buffer);
+	uint32_t AddTexture(RenderDescriptorHandle descriptor);
+	uint32_t AddMesh(const RenderMesh& mesh);
+	uint32_t AddTransform(RenderBufferHandle buffer);
+	// AddMeshで返した番号のメッシュを差し替える。前のメッシュを積んだ描画が終わってから呼ぶ
+	void UpdateMesh(uint32_t mesh, const RenderMesh& renderMesh);
+
+	void SetPipeline(uint32_t pipeline) override;
+	void SetMaterial(uint32_t material) override;
+	void SetTexture(uint32_t texture) override;
+	void SetMesh(uint32_t mesh) override;
+	void SetTransform(uint32_t transform) override;
+	void Draw(const DrawItem& item) override;
+
+private:
+	RenderCommandList* commandList_ = nullptr;
+	std::vector<RenderPipelineHandle> pipelines_;
+	std::vector<RenderBufferHandle> materials_;
+	std::vector<RenderDescriptorHandle> textures_;
+	std::vector<RenderMesh> meshes_;
+	std::vector<RenderBufferHandle> transforms_;
+};
+
+/// <summary>
+/// MeasureHeadlessRenderQueueの結果
+/// </summary>
+struct HeadlessRenderQueueBenchmark {
+	uint32_t drawCount; //!< 1回で積んだ描画の数
+	uint32_t stateChangeCount; //!< 1回で積んだ状態変更の数
+	double sortMicroseconds; //!< 1回あたりの並べ替えの時間
+	double recordMicroseconds; //!< 1回あたりのコマンドリストに積む時間
+	double nanosecondsPerDraw; //!< 並べ替えと積むのを合わせた描画1つあたりの時間
+	uint64_t peakBytes; //!< NullRenderDeviceで作ったリソースのバイト数の最大
+	uint64_t validationErrorCount;
+};
+
+// NullRenderDeviceにメッシュとテクスチャなどを作り、drawCount個の描画をRenderQueueで並べ替えてNullRenderCommandListに積む
+// これをiterations回繰り返し、GPUを使わずにCPU側の時間を測る
+HeadlessRenderQueueBenchmark MeasureHeadlessRenderQueue(uint32_t drawCount, uint32_t iterations);
\ No newline at end of file
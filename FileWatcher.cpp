@@ -0,0 +1,35 @@
+#include "FileWatcher.h"
+#include <filesystem>
+
+FileWatcher::FileWatcher()
+	: getTime_([](const std::wstring& path) -> int64_t {
+		std::error_code error;
+		auto time = std::filesystem::last_write_time(std::filesystem::path(path), error);
+		if (error) {
+			return -1;
+		}
+		return int64_t(time.time_since_epoch().count());
+	}) {
+}
+
+FileWatcher::FileWatcher(TimeFunction getTime)
+	: getTime_(std::move(getTime)) {
+}
+
+void FileWatcher::Watch(const std::wstring& path) {
+	if (!IsWatching(path)) {
+		times_[path] = getTime_(path);
+	}
+}
+
+std::vector<std::wstring> FileWatcher::Poll() {
+	std::vector<std::wstring> changedFiles;
+	for (auto& [path, time] : times_) {
+		int64_t currentTime = getTime_(path);
+		if (currentTime != time) {
+			time = currentTime;
+			changedFiles.push_back(path);
+		}
+	}
+	return changedFiles;
+}
\ No newline at end of file
@@ -0,0 +1,32 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// <summary>
+/// ファイルの更新時刻を定期的に見て、変わったファイルを返す。
+/// OSの通知は使わないので、どの環境でも同じように動く
+/// </summary>
+class FileWatcher {
+public:
+	// ファイルの更新時刻を返す。ファイルが無ければ-1
+	using TimeFunction = std::function<int64_t(const std::wstring& path)>;
+
+	// std::filesystemで更新時刻を調べる
+	FileWatcher();
+	// 更新時刻の取得方法を差し替える。実際のファイルを使わずに動作を確かめられる
+	explicit FileWatcher(TimeFunction getTime);
+
+	// 監視を始める。今の更新時刻を覚えておき、これより後の変更を検出する
+	void Watch(const std::wstring& path);
+	bool IsWatching(const std::wstring& path) const { return times_.count(path) != 0; }
+
+	// 前回から更新時刻が変わったファイルを返す。消えたファイルも変更として扱う
+	std::vector<std::wstring> Poll();
+
+private:
+	TimeFunction getTime_;
+	std::unordered_map<std::wstring, int64_t> times_;
+};
\ No newline at end of file
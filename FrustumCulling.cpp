@@ -0,0 +1,223 @@
+#include "FrustumCulling.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <xmmintrin.h>
+
+Frustum ExtractFrustum(const mat4x4& viewProjection) {
+	// 行ベクトルなのでクリップ座標の各成分は列との内積になる。-w<=x<=w, -w<=y<=w, 0<=z<=w の各不等式が1枚の平面
+	auto column = [&](int index) {
+		return std::array<float, 4>{ viewProjection.m[0][index], viewProjection.m[1][index], viewProjection.m[2][index], viewProjection.m[3][index] };
+	};
+	const std::array<float, 4> x = column(0);
+	const std::array<float, 4> y = column(1);
+	const std::array<float, 4> z = column(2);
+	const std::array<float, 4> w = column(3);
+	const std::array<float, 4> planes[6] = {
+		{ w[0] + x[0], w[1] + x[1], w[2] + x[2], w[3] + x[3] },
+		{ w[0] - x[0], w[1] - x[1], w[2] - x[2], w[3] - x[3] },
+		{ w[0] + y[0], w[1] + y[1], w[2] + y[2], w[3] + y[3] },
+		{ w[0] - y[0], w[1] - y[1], w[2] - y[2], w[3] - y[3] },
+		z,
+		{ w[0] - z[0], w[1] - z[1], w[2] - z[2], w[3] - z[3] },
+	};
+
+	Frustum frustum{};
+	for (int index = 0; index < 6; ++index) {
+		// 距離をワールドの単位で比べられるように正規化する
+		const std::array<float, 4>& plane = planes[index];
+		float length = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+		assert(length > 0.0f);
+		frustum.planes[index].normal = { plane[0] / length, plane[1] / length, plane[2] / length };
+		frustum.planes[index].distance = plane[3] / length;
+	}
+	return frustum;
+}
+
+bool TestFrustumAABB(const Frustum& frustum, const AABB& aabb, bool* inside) {
+	// CullingBounds::Addと同じ式で中心と幅を求め、FrustumCullと同じ結果にする
+	const Vector3 extent{ (aabb.max.x - aabb.min.x) * 0.5f, (aabb.max.y - aabb.min.y) * 0.5f, (aabb.max.z - aabb.min.z) * 0.5f };
+	const Vector3 center{ aabb.min.x + extent.x, aabb.min.y + extent.y, aabb.min.z + extent.z };
+	// 外で途中で抜けたときに前の値が残らないように、先に書いておく
+	if (inside) {
+		*inside = false;
+	}
+	bool allInside = true;
+	for (const Plane& plane : frustum.planes) {
+		float signedDistance = plane.normal.x * center.x + plane.normal.y * center.y + (plane.normal.z * center.z + plane.distance);
+		float reach = std::fabs(plane.normal.x) * extent.x + std::fabs(plane.normal.y) * extent.y + std::fabs(plane.normal.z) * extent.z;
+		if (signedDistance + reach < 0.0f) {
+			return false;
+		}
+		allInside = allInside && signedDistance - reach >= 0.0f;
+	}
+	if (inside) {
+		*inside = allInside;
+	}
+	return true;
+}
+
+void CullingBounds::Clear() {
+	centerX_.clear();
+	centerY_.clear();
+	centerZ_.clear();
+	extentX_.clear();
+	extentY_.clear();
+	extentZ_.clear();
+	radius_.clear();
+}
+
+uint32_t CullingBounds::Add(const AABB& aabb) {
+	const uint32_t index = GetCount();
+	Vector3 extent{ (aabb.max.x - aabb.min.x) * 0.5f, (aabb.max.y - aabb.min.y) * 0.5f, (aabb.max.z - aabb.min.z) * 0.5f };
+	centerX_.push_back(aabb.min.x + extent.x);
+	centerY_.push_back(aabb.min.y + extent.y);
+	centerZ_.push_back(aabb.min.z + extent.z);
+	extentX_.push_back(extent.x);
+	extentY_.push_back(extent.y);
+	extentZ_.push_back(extent.z);
+	radius_.push_back(std::sqrt(Dot(extent, extent)));
+	return index;
+}
+
+uint32_t CullingBounds::Add(const BoundingSphere& sphere) {
+	const uint32_t index = GetCount();
+	centerX_.push_back(sphere.center.x);
+	centerY_.push_back(sphere.center.y);
+	centerZ_.push_back(sphere.center.z);
+	extentX_.push_back(sphere.radius);
+	extentY_.push_back(sphere.radius);
+	extentZ_.push_back(sphere.radius);
+	radius_.push_back(sphere.radius);
+	return index;
+}
+
+bool CullingBounds::IsVisible(const Frustum& frustum, CullingShape shape, uint32_t index) const {
+	for (const Plane& plane : frustum.planes) {
+		// FrustumCullと同じ順に足して、境界上の判定を揃える
+		float signedDistance = plane.normal.x * centerX_[index] + plane.normal.y * centerY_[index] + (plane.normal.z * centerZ_[index] + plane.distance);
+		float reach = radius_[index];
+		if (shape == CullingShape::Box) {
+			reach = std::fabs(plane.normal.x) * extentX_[index] + std::fabs(plane.normal.y) * extentY_[index] + std::fabs(plane.normal.z) * extentZ_[index];
+		}
+		if (signedDistance + reach < 0.0f) {
+			return false;
+		}
+	}
+	return true;
+}
+
+uint32_t FrustumCull(const Frustum& frustum, const CullingBounds& bounds, CullingShape shape, std::vector<uint32_t>& visibleIndices) {
+	const uint32_t count = bounds.GetCount();
+	visibleIndices.resize(count);
+	uint32_t visibleCount = 0;
+
+	// 平面の成分を4つに複製しておく。箱は法線の絶対値と半分の幅の内積を、中心までの距離に足して判定する
+	__m128 normalX[6], normalY[6], normalZ[6], absNormalX[6], absNormalY[6], absNormalZ[6], distance[6];
+	for (int plane = 0; plane < 6; ++plane) {
+		const Plane& source = frustum.planes[plane];
+		normalX[plane] = _mm_set1_ps(source.normal.x);
+		normalY[plane] = _mm_set1_ps(source.normal.y);
+		normalZ[plane] = _mm_set1_ps(source.normal.z);
+		absNormalX[plane] = _mm_set1_ps(std::fabs(source.normal.x));
+		absNormalY[plane] = _mm_set1_ps(std::fabs(source.normal.y));
+		absNormalZ[plane] = _mm_set1_ps(std::fabs(source.normal.z));
+		distance[plane] = _mm_set1_ps(source.distance);
+	}
+	const __m128 zero = _mm_setzero_ps();
+
+	uint32_t index = 0;
+	for (; index + 4 <= count; index += 4) {
+		const __m128 centerX = _mm_loadu_ps(&bounds.centerX_[index]);
+		const __m128 centerY = _mm_loadu_ps(&bounds.centerY_[index]);
+		const __m128 centerZ = _mm_loadu_ps(&bounds.centerZ_[index]);
+		__m128 extentX = zero, extentY = zero, extentZ = zero, radius = zero;
+		if (shape == CullingShape::Box) {
+			extentX = _mm_loadu_ps(&bounds.extentX_[index]);
+			extentY = _mm_loadu_ps(&bounds.extentY_[index]);
+			extentZ = _mm_loadu_ps(&bounds.extentZ_[index]);
+		} else {
+			radius = _mm_loadu_ps(&bounds.radius_[index]);
+		}
+
+		// どれかの平面の完全に裏側にあるものを外す
+		__m128 outside = zero;
+		for (int plane = 0; plane < 6; ++plane) {
+			__m128 signedDistance = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(normalX[plane], centerX), _mm_mul_ps(normalY[plane], centerY)),
+				_mm_add_ps(_mm_mul_ps(normalZ[plane], centerZ), distance[plane]));
+			__m128 reach = radius;
+			if (shape == CullingShape::Box) {
+				reach = _mm_add_ps(
+					_mm_add_ps(_mm_mul_ps(absNormalX[plane], extentX), _mm_mul_ps(absNormalY[plane], extentY)),
+					_mm_mul_ps(absNormalZ[plane], extentZ));
+			}
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(signedDistance, reach), zero));
+		}
+
+		uint32_t visibleMask = uint32_t(~_mm_movemask_ps(outside)) & 0xF;
+		while (visibleMask != 0) {
+			visibleIndices[visibleCount++] = index + uint32_t(std::countr_zero(visibleMask));
+			visibleMask &= visibleMask - 1;
+		}
+	}
+
+	// 4つに満たない残りは1つずつ判定する
+	for (; index < count; ++index) {
+		if (bounds.IsVisible(frustum, shape, index)) {
+			visibleIndices[visibleCount++] = index;
+		}
+	}
+	visibleIndices.resize(visibleCount);
+	return visibleCount;
+}
+
+uint32_t FrustumCullScalar(const Frustum& frustum, const CullingBounds& bounds, CullingShape shape, std::vector<uint32_t>& visibleIndices) {
+	visibleIndices.clear();
+	for (uint32_t index = 0; index < bounds.GetCount(); ++index) {
+		if (bounds.IsVisible(frustum, shape, index)) {
+			visibleIndices.push_back(index);
+		}
+	}
+	return uint32_t(visibleIndices.size());
+}
+
+FrustumCullingBenchmark MeasureFrustumCulling(const Frustum& frustum, const Vector3& cameraPosition, uint32_t objectCount, uint32_t iterations, CullingShape shape) {
+	// 毎回同じ配置になるように種を固定する
+	std::mt19937 randomEngine(12345);
+	std::uniform_real_distribution<float> positionDistribution(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> sizeDistribution(0.1f, 2.0f);
+	CullingBounds bounds;
+	for (uint32_t index = 0; index < objectCount; ++index) {
+		Vector3 center{ cameraPosition.x + positionDistribution(randomEngine), cameraPosition.y + positionDistribution(randomEngine), cameraPosition.z + positionDistribution(randomEngine) };
+		float size = sizeDistribution(randomEngine);
+		bounds.Add(AABB{ { center.x - size, center.y - size, center.z - size }, { center.x + size, center.y + size, center.z + size } });
+	}
+
+	FrustumCullingBenchmark result{};
+	result.objectCount = objectCount;
+	iterations = (std::max)(iterations, 1u);
+	std::vector<uint32_t> scalarVisible;
+	std::vector<uint32_t> simdVisible;
+	scalarVisible.reserve(objectCount);
+	simdVisible.reserve(objectCount);
+
+	auto start = std::chrono::steady_clock::now();
+	for (uint32_t iteration = 0; iteration < iterations; ++iteration) {
+		FrustumCullScalar(frustum, bounds, shape, scalarVisible);
+	}
+	auto middle = std::chrono::steady_clock::now();
+	for (uint32_t iteration = 0; iteration < iterations; ++iteration) {
+		result.visibleCount = FrustumCull(frustum, bounds, shape, simdVisible);
+	}
+	auto end = std::chrono::steady_clock::now();
+	assert(scalarVisible == simdVisible);
+
+	result.scalarMilliseconds = std::chrono::duration<double, std::milli>(middle - start).count() / iterations;
+	result.simdMilliseconds = std::chrono::duration<double, std::milli>(end - middle).count() / iterations;
+	return result;
+}
\ No newline at end of file
@@ -0,0 +1,76 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "Bounds.h"
+
+/// <summary>
+/// 平面。Dot(normal, p) + distance が0以上の側を表とする
+/// </summary>
+struct Plane {
+	Vector3 normal;
+	float distance;
+};
+
+/// <summary>
+/// 視錐台。6枚の平面は全て内側を向く
+/// </summary>
+struct Frustum {
+	Plane planes[6]; //!< 左、右、下、上、近、遠
+};
+
+// 行ベクトルのビュープロジェクション行列から視錐台を取り出す。深度は0〜1の範囲とする
+Frustum ExtractFrustum(const mat4x4& viewProjection);
+
+// 1つのAABBが視錐台と重なるか。insideには完全に中に入っているかを書く。重ならなければfalse
+bool TestFrustumAABB(const Frustum& frustum, const AABB& aabb, bool* inside = nullptr);
+
+// カリングに使う境界の形
+enum class CullingShape : uint32_t {
+	Box, //!< AABB。球より正確
+	Sphere, //!< 境界球。AABBより計算が少し少ない
+};
+
+/// <summary>
+/// カリングするワールド座標の境界。SIMDで4つずつ読めるように成分ごとの配列で持つ
+/// </summary>
+class CullingBounds {
+public:
+	void Clear();
+	// 追加した番号を返す。球の半径はAABBを囲む球にする
+	uint32_t Add(const AABB& aabb);
+	// AABBは球を囲む立方体にする
+	uint32_t Add(const BoundingSphere& sphere);
+
+	uint32_t GetCount() const { return uint32_t(centerX_.size()); }
+	// index番目を1つだけ判定する
+	bool IsVisible(const Frustum& frustum, CullingShape shape, uint32_t index) const;
+
+private:
+	friend uint32_t FrustumCull(const Frustum& frustum, const CullingBounds& bounds, CullingShape shape, std::vector<uint32_t>& visibleIndices);
+
+	std::vector<float> centerX_;
+	std::vector<float> centerY_;
+	std::vector<float> centerZ_;
+	std::vector<float> extentX_; //!< AABBの半分の幅
+	std::vector<float> extentY_;
+	std::vector<float> extentZ_;
+	std::vector<float> radius_;
+};
+
+// 視錐台と重なる境界の番号を小さい順にvisibleIndicesへ入れ、その数を返す。SSEで4つずつ判定する
+uint32_t FrustumCull(const Frustum& frustum, const CullingBounds& bounds, CullingShape shape, std::vector<uint32_t>& visibleIndices);
+// 1つずつ判定する。FrustumCullと同じ結果になる
+uint32_t FrustumCullScalar(const Frustum& frustum, const CullingBounds& bounds, CullingShape shape, std::vector<uint32_t>& visibleIndices);
+
+/// <summary>
+/// MeasureFrustumCullingの結果
+/// </summary>
+struct FrustumCullingBenchmark {
+	uint32_t objectCount;
+	uint32_t visibleCount;
+	double scalarMilliseconds; //!< 1回あたりの時間
+	double simdMilliseconds;
+};
+
+// カメラの周りにランダムに置いたobjectCount個の境界をiterations回ずつカリングして、スカラー版とSIMD版の時間を比べる
+FrustumCullingBenchmark MeasureFrustumCulling(const Frustum& frustum, const Vector3& cameraPosition, uint32_t objectCount, uint32_t iterations, CullingShape shape);
\ No newline at end of file
@@ -0,0 +1,557 @@
+#include "GpuMemoryAllocator.h"
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <chrono>
+#include <unordered_set>
+
+namespace {
+	uint64_t AlignUp(uint64_t value, uint64_t alignment) {
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	bool IsPowerOfTwo(uint64_t value) {
+		return value != 0 && (value & (value - 1)) == 0;
+	}
+}
+
+void TlsfAllocator::Initialize(uint64_t capacity) {
+	assert(capacity > 0);
+	blocks_.clear();
+	unusedBlocks_.clear();
+	firstLevelBitmap_ = 0;
+	std::fill(secondLevelBitmaps_, secondLevelBitmaps_ + kFirstLevelCount, 0u);
+	capacity_ = capacity;
+	usedBytes_ = 0;
+	allocationCount_ = 0;
+	freeBlockCount_ = 0;
+	const uint32_t block = NewBlock();
+	blocks_[block] = { 0, capacity, kInvalidBlock, kInvalidBlock, kInvalidBlock, kInvalidBlock, true };
+	InsertFree(block);
+}
+
+uint32_t TlsfAllocator::Allocate(uint64_t size, uint64_t alignment) {
+	assert(size > 0 && IsPowerOfTwo(alignment));
+	// 揃っている空きが多いので、まずはそのままの大きさで探す。揃えると入らなければ揃えの分を足して探し直す
+	uint32_t block = FindFreeBlock(size);
+	if (block == kInvalidBlock || AlignUp(blocks_[block].offset, alignment) + size > blocks_[block].offset + blocks_[block].size) {
+		block = FindFreeBlock(size + alignment - 1);
+	}
+	if (block == kInvalidBlock) {
+		// 切り上げたリストに無くても、sizeと同じリストに入る空きがあるかもしれない。ヒープの残りとほぼ同じ大きさのときに起きる
+		block = FindFreeBlockLinear(size, alignment);
+		if (block == kInvalidBlock) {
+			return kInvalidBlock;
+		}
+	}
+	RemoveFree(block);
+	const uint64_t padding = AlignUp(blocks_[block].offset, alignment) - blocks_[block].offset;
+	if (padding > 0) {
+		// 前の余りは空きのまま残す。前の区画は使っているので、つなげるものは無い
+		const uint32_t aligned = Split(block, padding);
+		InsertFree(block);
+		block = aligned;
+	}
+	if (blocks_[block].size > size) {
+		InsertFree(Split(block, size));
+	}
+	blocks_[block].free = false;
+	usedBytes_ += size;
+	++allocationCount_;
+	return block;
+}
+
+uint32_t TlsfAllocator::AllocateAll() {
+	assert(IsEmpty());
+	// 空なら先頭の区画が全体になっている
+	const uint32_t block = 0;
+	assert(blocks_[block].free && blocks_[block].size == capacity_);
+	RemoveFree(block);
+	blocks_[block].free = false;
+	usedBytes_ = capacity_;
+	++allocationCount_;
+	return block;
+}
+
+void TlsfAllocator::Free(uint32_t block) {
+	assert(block < blocks_.size() && !blocks_[block].free);
+	usedBytes_ -= blocks_[block].size;
+	--allocationCount_;
+	blocks_[block].free = true;
+	// 前後の空きとつなげる
+	const uint32_t next = blocks_[block].nextPhysical;
+	if (next != kInvalidBlock && blocks_[next].free) {
+		RemoveFree(next);
+		MergeNext(block);
+	}
+	const uint32_t prev = blocks_[block].prevPhysical;
+	if (prev != kInvalidBlock && blocks_[prev].free) {
+		RemoveFree(prev);
+		MergeNext(prev);
+		block = prev;
+	}
+	InsertFree(block);
+}
+
+uint64_t TlsfAllocator::GetLargestFreeBytes() const {
+	if (firstLevelBitmap_ == 0) {
+		return 0;
+	}
+	// 一番大きいリストの中で一番大きいもの
+	const uint32_t firstLevel = 63 - uint32_t(std::countl_zero(firstLevelBitmap_));
+	const uint32_t secondLevel = 31 - uint32_t(std::countl_zero(secondLevelBitmaps_[firstLevel]));
+	uint64_t largest = 0;
+	for (uint32_t block = freeLists_[firstLevel][secondLevel]; block != kInvalidBlock; block = blocks_[block].nextFree) {
+		largest = (std::max)(largest, blocks_[block].size);
+	}
+	return largest;
+}
+
+bool TlsfAllocator::Validate() const {
+	// 先頭から並びをたどり、隙間なく続いていて、空きが隣り合っていないこと
+	uint64_t offset = 0;
+	uint64_t usedBytes = 0;
+	uint32_t freeCount = 0;
+	bool prevFree = false;
+	uint32_t prev = kInvalidBlock;
+	for (uint32_t block = 0; block != kInvalidBlock; block = blocks_[block].nextPhysical) {
+		const Block& entry = blocks_[block];
+		if (entry.offset != offset || entry.prevPhysical != prev || entry.size == 0 || (entry.free && prevFree)) {
+			return false;
+		}
+		if (entry.free) {
+			++freeCount;
+			// 自分の大きさのリストに入っている
+			uint32_t firstLevel = 0;
+			uint32_t secondLevel = 0;
+			Mapping(entry.size, firstLevel, secondLevel);
+			bool found = false;
+			for (uint32_t other = freeLists_[firstLevel][secondLevel]; other != kInvalidBlock; other = blocks_[other].nextFree) {
+				found |= other == block;
+			}
+			if (!found) {
+				return false;
+			}
+		} else {
+			usedBytes += entry.size;
+		}
+		offset += entry.size;
+		prevFree = entry.free;
+		prev = block;
+	}
+	return offset == capacity_ && usedBytes == usedBytes_ && freeCount == freeBlockCount_;
+}
+
+void TlsfAllocator::Mapping(uint64_t size, uint32_t& firstLevel, uint32_t& secondLevel) {
+	if (size < kSecondLevelCount) {
+		firstLevel = 0;
+		secondLevel = uint32_t(size);
+		return;
+	}
+	// 2のべき乗ごとに分け、その中をさらにkSecondLevelCount個に分ける
+	const uint32_t bit = uint32_t(std::bit_width(size)) - 1;
+	firstLevel = bit - kSecondLevelLog2 + 1;
+	secondLevel = uint32_t(size >> (bit - kSecondLevelLog2)) - kSecondLevelCount;
+}
+
+uint32_t TlsfAllocator::FindFreeBlock(uint64_t size) const {
+	// 次の区切りまで切り上げ、そのリストより大きいリストのものならどれでも入るようにする
+	if (size >= kSecondLevelCount) {
+		const uint32_t bit = uint32_t(std::bit_width(size)) - 1;
+		size += (uint64_t(1) << (bit - kSecondLevelLog2)) - 1;
+	}
+	uint32_t firstLevel = 0;
+	uint32_t secondLevel = 0;
+	Mapping(size, firstLevel, secondLevel);
+	if (firstLevel >= kFirstLevelCount) {
+		return kInvalidBlock;
+	}
+	uint32_t secondLevelMap = secondLevelBitmaps_[firstLevel] & (~0u << secondLevel);
+	if (secondLevelMap == 0) {
+		const uint64_t firstLevelMap = firstLevel + 1 < kFirstLevelCount ? firstLevelBitmap_ & (~uint64_t(0) << (firstLevel + 1)) : 0;
+		if (firstLevelMap == 0) {
+			return kInvalidBlock;
+		}
+		firstLevel = uint32_t(std::countr_zero(firstLevelMap));
+		secondLevelMap = secondLevelBitmaps_[firstLevel];
+	}
+	return freeLists_[firstLevel][std::countr_zero(secondLevelMap)];
+}
+
+uint32_t TlsfAllocator::FindFreeBlockLinear(uint64_t size, uint64_t alignment) const {
+	// sizeのリストから、揃えの分を足したときのリストまで。それより上のリストはFindFreeBlockで探してある
+	uint32_t firstLevel = 0;
+	uint32_t secondLevel = 0;
+	Mapping(size, firstLevel, secondLevel);
+	const uint32_t first = firstLevel * kSecondLevelCount + secondLevel;
+	Mapping(size + alignment - 1, firstLevel, secondLevel);
+	const uint32_t last = (std::min)(firstLevel * kSecondLevelCount + secondLevel, kFirstLevelCount * kSecondLevelCount - 1);
+	for (uint32_t list = first; list <= last; ++list) {
+		firstLevel = list / kSecondLevelCount;
+		secondLevel = list % kSecondLevelCount;
+		if ((secondLevelBitmaps_[firstLevel] & (1u << secondLevel)) == 0) {
+			continue;
+		}
+		for (uint32_t block = freeLists_[firstLevel][secondLevel]; block != kInvalidBlock; block = blocks_[block].nextFree) {
+			const Block& entry = blocks_[block];
+			if (AlignUp(entry.offset, alignment) + size <= entry.offset + entry.size) {
+				return block;
+			}
+		}
+	}
+	return kInvalidBlock;
+}
+
+void TlsfAllocator::InsertFree(uint32_t block) {
+	uint32_t firstLevel = 0;
+	uint32_t secondLevel = 0;
+	Mapping(blocks_[block].size, firstLevel, secondLevel);
+	uint32_t& head = freeLists_[firstLevel][secondLevel];
+	if (secondLevelBitmaps_[firstLevel] & (1u << secondLevel)) {
+		blocks_[head].prevFree = block;
+	} else {
+		head = kInvalidBlock;
+	}
+	blocks_[block].prevFree = kInvalidBlock;
+	blocks_[block].nextFree = head;
+	head = block;
+	firstLevelBitmap_ |= uint64_t(1) << firstLevel;
+	secondLevelBitmaps_[firstLevel] |= 1u << secondLevel;
+	++freeBlockCount_;
+}
+
+void TlsfAllocator::RemoveFree(uint32_t block) {
+	uint32_t firstLevel = 0;
+	uint32_t secondLevel = 0;
+	Mapping(blocks_[block].size, firstLevel, secondLevel);
+	const Block& entry = blocks_[block];
+	if (entry.prevFree != kInvalidBlock) {
+		blocks_[entry.prevFree].nextFree = entry.nextFree;
+	} else {
+		freeLists_[firstLevel][secondLevel] = entry.nextFree;
+	}
+	if (entry.nextFree != kInvalidBlock) {
+		blocks_[entry.nextFree].prevFree = entry.prevFree;
+	}
+	if (freeLists_[firstLevel][secondLevel] == kInvalidBlock) {
+		secondLevelBitmaps_[firstLevel] &= ~(1u << secondLevel);
+		if (secondLevelBitmaps_[firstLevel] == 0) {
+			firstLevelBitmap_ &= ~(uint64_t(1) << firstLevel);
+		}
+	}
+	--freeBlockCount_;
+}
+
+uint32_t TlsfAllocator::Split(uint32_t block, uint64_t size) {
+	assert(size < blocks_[block].size);
+	const uint32_t rest = NewBlock();
+	Block& entry = blocks_[block];
+	blocks_[rest] = { entry.offset + size, entry.size - size, block, entry.nextPhysical, kInvalidBlock, kInvalidBlock, true };
+	if (entry.nextPhysical != kInvalidBlock) {
+		blocks_[entry.nextPhysical].prevPhysical = rest;
+	}
+	entry.size = size;
+	entry.nextPhysical = rest;
+	return rest;
+}
+
+void TlsfAllocator::MergeNext(uint32_t block) {
+	const uint32_t next = blocks_[block].nextPhysical;
+	blocks_[block].size += blocks_[next].size;
+	blocks_[block].nextPhysical = blocks_[next].nextPhysical;
+	if (blocks_[next].nextPhysical != kInvalidBlock) {
+		blocks_[blocks_[next].nextPhysical].prevPhysical = block;
+	}
+	unusedBlocks_.push_back(next);
+}
+
+uint32_t TlsfAllocator::NewBlock() {
+	if (!unusedBlocks_.empty()) {
+		const uint32_t block = unusedBlocks_.back();
+		unusedBlocks_.pop_back();
+		return block;
+	}
+	blocks_.push_back({});
+	return uint32_t(blocks_.size() - 1);
+}
+
+void GpuMemoryAllocator::Initialize(GpuHeapBackend* backend) {
+	assert(backend);
+	backend_ = backend;
+}
+
+void GpuMemoryAllocator::Finalize() {
+	for (uint32_t heap = 0; heap < heaps_.size(); ++heap) {
+		if (heaps_[heap].alive) {
+			backend_->DestroyHeap(heap);
+		}
+	}
+	heaps_.clear();
+	freeHeaps_.clear();
+	allocations_.Clear();
+	retired_.clear();
+	pools_.clear();
+}
+
+uint32_t GpuMemoryAllocator::AddPool(const GpuPoolDesc& desc) {
+	assert(desc.heapSize > 0 && IsPowerOfTwo(desc.heapAlignment));
+	pools_.push_back(desc);
+	pools_.back().heapSize = AlignUp(desc.heapSize, desc.heapAlignment);
+	return uint32_t(pools_.size() - 1);
+}
+
+GpuAllocationHandle GpuMemoryAllocator::Allocate(uint32_t pool, uint64_t size, uint64_t alignment, bool movable) {
+	assert(pool < pools_.size() && size > 0);
+	const GpuPoolDesc& poolDesc = pools_[pool];
+	assert(IsPowerOfTwo(alignment) && alignment <= poolDesc.heapAlignment);
+	uint32_t heap = TlsfAllocator::kInvalidBlock;
+	uint32_t block = TlsfAllocator::kInvalidBlock;
+	if (size > poolDesc.heapSize) {
+		// 大きいものはそれだけのヒープにする。ヒープの先頭はheapAlignmentで揃っているので、全体をそのまま使う
+		heap = CreateHeap(pool, AlignUp(size, poolDesc.heapAlignment), true);
+		block = heaps_[heap].allocator.AllocateAll();
+	} else {
+		for (uint32_t index = 0; index < heaps_.size() && block == TlsfAllocator::kInvalidBlock; ++index) {
+			if (heaps_[index].alive && heaps_[index].pool == pool && !heaps_[index].dedicated) {
+				heap = index;
+				block = heaps_[index].allocator.Allocate(size, alignment);
+			}
+		}
+		if (block == TlsfAllocator::kInvalidBlock) {
+			heap = CreateHeap(pool, poolDesc.heapSize, false);
+			block = heaps_[heap].allocator.Allocate(size, alignment);
+		}
+	}
+	assert(block != TlsfAllocator::kInvalidBlock);
+	const uint32_t id = allocations_.Add({ 0, heap, block, size, alignment, movable });
+	allocations_.Get(id)->id = id;
+	return { id };
+}
+
+void GpuMemoryAllocator::Free(GpuAllocationHandle allocation, uint64_t fenceValue) {
+	const Allocation* record = allocations_.Get(allocation.id);
+	assert(record);
+	if (fenceValue == 0) {
+		FreeBlock(record->heap, record->block);
+	} else {
+		retired_.push_back({ record->heap, record->block, fenceValue });
+	}
+	allocations_.Remove(allocation.id);
+}
+
+void GpuMemoryAllocator::Update(uint64_t completedFenceValue) {
+	auto released = std::remove_if(retired_.begin(), retired_.end(), [&](const Retired& retired) {
+		if (retired.fenceValue <= completedFenceValue) {
+			FreeBlock(retired.heap, retired.block);
+			return true;
+		}
+		return false;
+	});
+	retired_.erase(released, retired_.end());
+}
+
+GpuAllocationInfo GpuMemoryAllocator::GetInfo(GpuAllocationHandle allocation) const {
+	const Allocation* record = allocations_.Get(allocation.id);
+	assert(record);
+	const Heap& heap = heaps_[record->heap];
+	return { heap.pool, record->heap, heap.allocator.GetOffset(record->block), record->size };
+}
+
+std::vector<GpuMove> GpuMemoryAllocator::Defragment(uint32_t pool, uint64_t maxBytes, uint64_t fenceValue) {
+	assert(fenceValue > 0);
+	std::vector<GpuMove> moves;
+	// 使っているバイト数の多い順。後ろのヒープから前のヒープへ移し、後ろのヒープを空にする
+	std::vector<uint32_t> order;
+	for (uint32_t heap = 0; heap < heaps_.size(); ++heap) {
+		if (heaps_[heap].alive && heaps_[heap].pool == pool && !heaps_[heap].dedicated) {
+			order.push_back(heap);
+		}
+	}
+	std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+		return heaps_[a].allocator.GetUsedBytes() > heaps_[b].allocator.GetUsedBytes();
+	});
+
+	uint64_t movedBytes = 0;
+	std::vector<Allocation*> candidates;
+	std::unordered_set<uint32_t> moved; //!< 1回のDefragmentで同じものを2回動かさない
+	for (size_t source = order.size(); source-- > 0;) {
+		const uint32_t sourceHeap = order[source];
+		// 大きいものから動かす
+		candidates.clear();
+		allocations_.ForEach([&](Allocation& allocation) {
+			if (allocation.heap == sourceHeap && allocation.movable && !moved.contains(allocation.id)) {
+				candidates.push_back(&allocation);
+			}
+		});
+		std::sort(candidates.begin(), candidates.end(), [](const Allocation* a, const Allocation* b) { return a->size > b->size; });
+		for (Allocation* allocation : candidates) {
+			if (movedBytes + allocation->size > maxBytes) {
+				return moves;
+			}
+			const uint64_t sourceOffset = heaps_[sourceHeap].allocator.GetOffset(allocation->block);
+			for (size_t destination = 0; destination <= source; ++destination) {
+				const uint32_t destinationHeap = order[destination];
+				TlsfAllocator& allocator = heaps_[destinationHeap].allocator;
+				const uint32_t block = allocator.Allocate(allocation->size, allocation->alignment);
+				if (block == TlsfAllocator::kInvalidBlock) {
+					continue;
+				}
+				// 同じヒープの中では前に動くときだけ
+				if (destinationHeap == sourceHeap && allocator.GetOffset(block) >= sourceOffset) {
+					allocator.Free(block);
+					continue;
+				}
+				retired_.push_back({ sourceHeap, allocation->block, fenceValue });
+				moves.push_back({ { allocation->id }, sourceHeap, sourceOffset, destinationHeap, allocator.GetOffset(block), allocation->size });
+				moved.insert(allocation->id);
+				allocation->heap = destinationHeap;
+				allocation->block = block;
+				movedBytes += allocation->size;
+				break;
+			}
+		}
+	}
+	return moves;
+}
+
+GpuMemoryStats GpuMemoryAllocator::GetStats(uint32_t pool) const {
+	GpuMemoryStats stats{};
+	uint64_t contiguousFreeBytes = 0;
+	for (const Heap& heap : heaps_) {
+		if (heap.alive && heap.pool == pool) {
+			AddStats(stats, contiguousFreeBytes, heap);
+		}
+	}
+	stats.fragmentation = stats.freeBytes > 0 ? 1.0f - float(double(contiguousFreeBytes) / double(stats.freeBytes)) : 0.0f;
+	return stats;
+}
+
+GpuMemoryStats GpuMemoryAllocator::GetTotalStats() const {
+	GpuMemoryStats stats{};
+	uint64_t contiguousFreeBytes = 0;
+	for (const Heap& heap : heaps_) {
+		if (heap.alive) {
+			AddStats(stats, contiguousFreeBytes, heap);
+		}
+	}
+	stats.fragmentation = stats.freeBytes > 0 ? 1.0f - float(double(contiguousFreeBytes) / double(stats.freeBytes)) : 0.0f;
+	return stats;
+}
+
+uint32_t GpuMemoryAllocator::CreateHeap(uint32_t pool, uint64_t size, bool dedicated) {
+	uint32_t heap = 0;
+	if (freeHeaps_.empty()) {
+		heap = uint32_t(heaps_.size());
+		heaps_.emplace_back();
+	} else {
+		heap = freeHeaps_.back();
+		freeHeaps_.pop_back();
+	}
+	Heap& entry = heaps_[heap];
+	entry.allocator.Initialize(size);
+	entry.pool = pool;
+	entry.dedicated = dedicated;
+	entry.alive = true;
+	backend_->CreateHeap(heap, { pool, size, pools_[pool].heapAlignment });
+	return heap;
+}
+
+void GpuMemoryAllocator::FreeBlock(uint32_t heap, uint32_t block) {
+	Heap& entry = heaps_[heap];
+	entry.allocator.Free(block);
+	if (!entry.allocator.IsEmpty()) {
+		return;
+	}
+	// 空いたヒープは破棄する。プールの最後の1つは、次の確保のために残しておく
+	bool lastHeap = !entry.dedicated;
+	for (uint32_t other = 0; other < heaps_.size() && lastHeap; ++other) {
+		lastHeap = !(other != heap && heaps_[other].alive && heaps_[other].pool == entry.pool && !heaps_[other].dedicated);
+	}
+	if (!lastHeap) {
+		backend_->DestroyHeap(heap);
+		entry.alive = false;
+		freeHeaps_.push_back(heap);
+	}
+}
+
+void GpuMemoryAllocator::AddStats(GpuMemoryStats& stats, uint64_t& contiguousFreeBytes, const Heap& heap) const {
+	const TlsfAllocator& allocator = heap.allocator;
+	const uint64_t largestFreeBytes = allocator.GetLargestFreeBytes();
+	++stats.heapCount;
+	stats.allocationCount += allocator.GetAllocationCount();
+	stats.reservedBytes += allocator.GetCapacity();
+	stats.usedBytes += allocator.GetUsedBytes();
+	stats.freeBytes += allocator.GetCapacity() - allocator.GetUsedBytes();
+	stats.largestFreeBytes = (std::max)(stats.largestFreeBytes, largestFreeBytes);
+	contiguousFreeBytes += largestFreeBytes;
+	stats.freeBlockCount += allocator.GetFreeBlockCount();
+}
+
+namespace {
+	// ヒープを作らずに数だけ数えるバックエンド
+	class CountingHeapBackend : public GpuHeapBackend {
+	public:
+		void CreateHeap(uint32_t, const GpuHeapDesc&) override { ++heapCount; }
+		void DestroyHeap(uint32_t) override { --heapCount; }
+		uint32_t heapCount = 0;
+	};
+}
+
+GpuAllocatorBenchmark MeasureGpuMemoryAllocator(uint32_t allocationCount) {
+	using Clock = std::chrono::steady_clock;
+	GpuAllocatorBenchmark result{};
+	result.allocationCount = (std::max)(allocationCount, 2u);
+	const uint64_t kSmallAlignment = 4 * 1024;
+	const uint64_t kDefaultAlignment = 64 * 1024;
+
+	CountingHeapBackend backend;
+	GpuMemoryAllocator allocator;
+	allocator.Initialize(&backend);
+	const uint32_t pool = allocator.AddPool({ 64 * 1024 * 1024, kDefaultAlignment });
+
+	// 小さいテクスチャが多く、大きいものが少ない分布
+	std::vector<GpuAllocationHandle> allocations(result.allocationCount);
+	uint32_t random = 12345;
+	auto nextRandom = [&random]() {
+		random = random * 1664525u + 1013904223u;
+		return random >> 8;
+	};
+	const Clock::time_point allocateStart = Clock::now();
+	for (GpuAllocationHandle& allocation : allocations) {
+		const uint32_t kind = nextRandom() % 16;
+		const uint64_t size = kind < 10 ? (1 + nextRandom() % 16) * kSmallAlignment : kind < 15 ? (1 + nextRandom() % 16) * kDefaultAlignment : (1 + nextRandom() % 4) * 1024 * 1024;
+		const uint64_t alignment = size <= 64 * 1024 ? kSmallAlignment : kDefaultAlignment;
+		allocation = allocator.Allocate(pool, size, alignment, true);
+		result.dedicatedBytes += AlignUp(size, kDefaultAlignment);
+	}
+	result.allocateNanoseconds = std::chrono::duration<double, std::nano>(Clock::now() - allocateStart).count() / result.allocationCount;
+	result.reservedBytes = allocator.GetStats(pool).reservedBytes;
+
+	// 読み込んだものの半分を捨てた状態にする
+	uint32_t freeCount = 0;
+	const Clock::time_point freeStart = Clock::now();
+	for (uint32_t index = 0; index < result.allocationCount; ++index) {
+		if (nextRandom() % 2 == 0) {
+			allocator.Free(allocations[index]);
+			++freeCount;
+		}
+	}
+	result.freeNanoseconds = std::chrono::duration<double, std::nano>(Clock::now() - freeStart).count() / (std::max)(freeCount, 1u);
+	const GpuMemoryStats before = allocator.GetStats(pool);
+	result.heapCountBefore = before.heapCount;
+	result.fragmentationBefore = before.fragmentation;
+
+	const Clock::time_point defragmentStart = Clock::now();
+	const std::vector<GpuMove> moves = allocator.Defragment(pool, UINT64_MAX, 1);
+	allocator.Update(1);
+	result.defragmentMilliseconds = std::chrono::duration<double, std::milli>(Clock::now() - defragmentStart).count();
+	for (const GpuMove& move : moves) {
+		result.movedBytes += move.size;
+	}
+	const GpuMemoryStats after = allocator.GetStats(pool);
+	result.heapCountAfter = after.heapCount;
+	result.fragmentationAfter = after.fragmentation;
+	allocator.Finalize();
+	assert(backend.heapCount == 0);
+	return result;
+}
\ No newline at end of file
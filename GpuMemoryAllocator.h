@@ -0,0 +1,232 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "RenderDevice.h"
+
+/// <summary>
+/// 1つの範囲を切り分けるTLSF(Two-Level Segregated Fit)のアロケーター。確保も解放も定数時間で、隣の空きとはすぐにつなげる
+/// 範囲の中の位置と大きさだけを扱い、メモリには触らない
+/// </summary>
+class TlsfAllocator {
+public:
+	static const uint32_t kInvalidBlock = UINT32_MAX;
+
+	// [0, capacity)を1つの空きにする
+	void Initialize(uint64_t capacity);
+
+	// alignmentは2のべき乗。入らなければkInvalidBlock
+	uint32_t Allocate(uint64_t size, uint64_t alignment);
+	// 空のときに全体を1つの確保にする。大きさのリストは探さないので、capacityがリストの区切りに無くても入る
+	uint32_t AllocateAll();
+	void Free(uint32_t block);
+
+	uint64_t GetOffset(uint32_t block) const { return blocks_[block].offset; }
+	uint64_t GetSize(uint32_t block) const { return blocks_[block].size; }
+	uint64_t GetCapacity() const { return capacity_; }
+	uint64_t GetUsedBytes() const { return usedBytes_; }
+	uint32_t GetAllocationCount() const { return allocationCount_; }
+	uint32_t GetFreeBlockCount() const { return freeBlockCount_; }
+	bool IsEmpty() const { return allocationCount_ == 0; }
+	// 一番大きい空きのバイト数
+	uint64_t GetLargestFreeBytes() const;
+
+	// 並びと空きのリストが食い違っていないか。確かめるためのもので遅い
+	bool Validate() const;
+
+private:
+	static const uint32_t kSecondLevelLog2 = 4;
+	static const uint32_t kSecondLevelCount = 1 << kSecondLevelLog2;
+	static const uint32_t kFirstLevelCount = 64;
+
+	struct Block {
+		uint64_t offset;
+		uint64_t size;
+		uint32_t prevPhysical; //!< 前にある区画。無ければkInvalidBlock
+		uint32_t nextPhysical;
+		uint32_t prevFree; //!< 同じ空きのリストの前後
+		uint32_t nextFree;
+		bool free;
+	};
+
+	// 大きさから空きのリストの番号を求める
+	static void Mapping(uint64_t size, uint32_t& firstLevel, uint32_t& secondLevel);
+	// size以上が必ず入る空きを探す。リストからは外さない
+	uint32_t FindFreeBlock(uint64_t size) const;
+	// FindFreeBlockが切り上げて飛ばすリストを1つずつたどり、揃えてsizeが入る空きを探す。遅いので見つからなかったときだけ使う
+	uint32_t FindFreeBlockLinear(uint64_t size, uint64_t alignment) const;
+	void InsertFree(uint32_t block);
+	void RemoveFree(uint32_t block);
+	// blockを先頭のsizeと残りに分け、残りの番号を返す
+	uint32_t Split(uint32_t block, uint64_t size);
+	// blockに後ろの区画をつなげる
+	void MergeNext(uint32_t block);
+	uint32_t NewBlock();
+
+	std::vector<Block> blocks_;
+	std::vector<uint32_t> unusedBlocks_; //!< 使い回せるblocks_の番号
+	uint64_t firstLevelBitmap_ = 0;
+	uint32_t secondLevelBitmaps_[kFirstLevelCount]{};
+	uint32_t freeLists_[kFirstLevelCount][kSecondLevelCount]{};
+	uint64_t capacity_ = 0;
+	uint64_t usedBytes_ = 0;
+	uint32_t allocationCount_ = 0;
+	uint32_t freeBlockCount_ = 0;
+};
+
+// GpuMemoryAllocatorの確保を指す番号。0は無効
+struct GpuAllocationHandle {
+	uint32_t id = 0;
+};
+
+/// <summary>
+/// 同じ種類のヒープをまとめたもの。描画APIのヒープの種類やフラグごとに作る
+/// </summary>
+struct GpuPoolDesc {
+	uint64_t heapSize; //!< 1つのヒープの大きさ。これより大きい確保にはそれだけのヒープを作り、全体を1つの確保にする
+	uint64_t heapAlignment; //!< 64KB。MSAAのテクスチャを置くなら4MB
+};
+
+/// <summary>
+/// GpuHeapBackendに作らせるヒープ
+/// </summary>
+struct GpuHeapDesc {
+	uint32_t pool;
+	uint64_t size;
+	uint64_t alignment;
+};
+
+/// <summary>
+/// GpuMemoryAllocatorがヒープを描画APIで作るためのインターフェース
+/// </summary>
+class GpuHeapBackend {
+public:
+	virtual ~GpuHeapBackend() = default;
+	// heapはGpuMemoryAllocatorが決める番号。DestroyHeapの後は同じ番号を別のヒープに使う
+	virtual void CreateHeap(uint32_t heap, const GpuHeapDesc& desc) = 0;
+	virtual void DestroyHeap(uint32_t heap) = 0;
+};
+
+/// <summary>
+/// 確保した場所
+/// </summary>
+struct GpuAllocationInfo {
+	uint32_t pool;
+	uint32_t heap;
+	uint64_t offset;
+	uint64_t size;
+};
+
+/// <summary>
+/// Defragmentで動かした確保。呼び出し側がsourceからdestinationへデータをコピーし、リソースを作り直す
+/// </summary>
+struct GpuMove {
+	GpuAllocationHandle allocation;
+	uint32_t sourceHeap;
+	uint64_t sourceOffset;
+	uint32_t destinationHeap;
+	uint64_t destinationOffset;
+	uint64_t size;
+};
+
+/// <summary>
+/// プールのメモリの使い方
+/// </summary>
+struct GpuMemoryStats {
+	uint32_t heapCount;
+	uint32_t allocationCount;
+	uint64_t reservedBytes; //!< ヒープの大きさの合計
+	uint64_t usedBytes;
+	uint64_t freeBytes;
+	uint64_t largestFreeBytes; //!< 1つのヒープの中で続いている一番大きい空き
+	uint32_t freeBlockCount;
+	float fragmentation; //!< 1 - (ヒープごとの一番大きい空きの合計) / freeBytes。0ならどのヒープも空きが1つにまとまっている
+};
+
+/// <summary>
+/// 大きなヒープをプールごとに作り、その中をTLSFで切り分けてリソースを置く場所を決める。描画APIには依存しない
+/// ヒープの生成と破棄だけをGpuHeapBackendに任せるので、偽のバックエンドで確保の仕方だけを確かめられる
+/// 1つのスレッドから使う
+/// </summary>
+class GpuMemoryAllocator {
+public:
+	void Initialize(GpuHeapBackend* backend);
+	// 全てのヒープを破棄する。GPUの完了を待ってから呼ぶ
+	void Finalize();
+
+	// プールを追加して番号を返す
+	uint32_t AddPool(const GpuPoolDesc& desc);
+	uint32_t GetPoolCount() const { return uint32_t(pools_.size()); }
+
+	// 入るヒープが無ければ作る。alignmentはプールのheapAlignment以下の2のべき乗
+	// movable: Defragmentで動かしてよいか。位置を覚えて使い続けるものはfalseにする
+	GpuAllocationHandle Allocate(uint32_t pool, uint64_t size, uint64_t alignment, bool movable);
+	// fenceValue: GPUがこの値まで終えてから使い回す。0ならすぐに使い回す
+	void Free(GpuAllocationHandle allocation, uint64_t fenceValue = 0);
+	// completedFenceValueまで終わった解放を反映し、空いたヒープを破棄する。毎フレーム呼ぶ
+	void Update(uint64_t completedFenceValue);
+
+	GpuAllocationInfo GetInfo(GpuAllocationHandle allocation) const;
+
+	// 使っているバイト数の少ないヒープから多いヒープへ、またはヒープの前の方へ、動かせる確保を詰める。合計maxBytesまで動かす
+	// 戻り値の確保は既に新しい位置を指している。古い位置はfenceValueまで残すので、その間にGPUでコピーする
+	std::vector<GpuMove> Defragment(uint32_t pool, uint64_t maxBytes, uint64_t fenceValue);
+
+	GpuMemoryStats GetStats(uint32_t pool) const;
+	GpuMemoryStats GetTotalStats() const;
+
+private:
+	struct Heap {
+		TlsfAllocator allocator;
+		uint32_t pool = 0;
+		bool dedicated = false; //!< 大きな確保1つのためのもの
+		bool alive = false;
+	};
+	struct Allocation {
+		uint32_t id; //!< この確保のGpuAllocationHandle
+		uint32_t heap;
+		uint32_t block;
+		uint64_t size;
+		uint64_t alignment;
+		bool movable;
+	};
+	// 使い終わったがGPUが読んでいるかもしれない場所
+	struct Retired {
+		uint32_t heap;
+		uint32_t block;
+		uint64_t fenceValue;
+	};
+
+	uint32_t CreateHeap(uint32_t pool, uint64_t size, bool dedicated);
+	// heapの区画を解放し、ヒープが空いたら破棄する
+	void FreeBlock(uint32_t heap, uint32_t block);
+	// contiguousFreeBytesにはヒープごとの一番大きい空きを足す
+	void AddStats(GpuMemoryStats& stats, uint64_t& contiguousFreeBytes, const Heap& heap) const;
+
+	GpuHeapBackend* backend_ = nullptr;
+	std::vector<GpuPoolDesc> pools_;
+	std::vector<Heap> heaps_;
+	std::vector<uint32_t> freeHeaps_; //!< 使い回せるheaps_の番号
+	RenderHandlePool<Allocation> allocations_;
+	std::vector<Retired> retired_;
+};
+
+/// <summary>
+/// MeasureGpuMemoryAllocatorの結果
+/// </summary>
+struct GpuAllocatorBenchmark {
+	uint32_t allocationCount;
+	double allocateNanoseconds; //!< 1回の確保の平均
+	double freeNanoseconds;
+	uint64_t dedicatedBytes; //!< 1つずつヒープを作った(CommittedResourceの)ときのバイト数
+	uint64_t reservedBytes; //!< ヒープを切り分けたときのバイト数
+	uint32_t heapCountBefore; //!< 半分を解放した後
+	float fragmentationBefore;
+	uint32_t heapCountAfter; //!< Defragmentの後
+	float fragmentationAfter;
+	uint64_t movedBytes;
+	double defragmentMilliseconds;
+};
+
+// 4KBから4MBのテクスチャやバッファを想定した確保をallocationCount個行い、半分を解放してからDefragmentする
+// ヒープは作らずに数えるだけなので、描画APIが無くても測れる
+GpuAllocatorBenchmark MeasureGpuMemoryAllocator(uint32_t allocationCount);
\ No newline at end of file
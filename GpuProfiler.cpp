@@ -0,0 +1,139 @@
+#include "GpuProfiler.h"
+#include <algorithm>
+#include <cassert>
+
+void GpuProfiler::Initialize(GpuQuerySource* source, uint32_t frameCount, uint32_t maxQueriesPerFrame) {
+	assert(frameCount > 0 && maxQueriesPerFrame >= 2);
+	source_ = source;
+	maxQueriesPerFrame_ = maxQueriesPerFrame;
+	frames_.assign(frameCount, Frame{ {}, 0, 0, false });
+	currentFrame_ = 0;
+}
+
+void GpuProfiler::BeginFrame(uint64_t completedFenceValue) {
+	// 古いフレームから順に読む。今回使うフレームが一番古い
+	const uint32_t frameCount = uint32_t(frames_.size());
+	for (uint32_t offset = 0; offset < frameCount; ++offset) {
+		const uint32_t frameIndex = (currentFrame_ + offset) % frameCount;
+		if (frames_[frameIndex].pending && frames_[frameIndex].fenceValue <= completedFenceValue) {
+			ReadFrame(frameIndex);
+		}
+	}
+	Frame& frame = frames_[currentFrame_];
+	recording_ = !frame.pending;
+	if (recording_) {
+		frame.zones.clear();
+		frame.queryCount = 0;
+	}
+	openZones_.clear();
+}
+
+void GpuProfiler::BeginZone(std::string_view name) {
+	Frame& frame = frames_[currentFrame_];
+	if (!recording_ || frame.queryCount + 2 > maxQueriesPerFrame_) {
+		// EndZoneと対にするため、測らない区間も積んでおく
+		openZones_.push_back(UINT32_MAX);
+		++droppedCount_;
+		return;
+	}
+	// 名前は結果を読むまで残るように持っておく。探すときは確保しないので、毎フレーム同じ名前なら確保は最初だけ
+	auto it = names_.find(name);
+	if (it == names_.end()) {
+		it = names_.emplace(name).first;
+	}
+	// 始まりと終わりのクエリをまとめて取る
+	const uint32_t parent = openZones_.empty() ? UINT32_MAX : openZones_.back();
+	frame.zones.push_back({ it->c_str(), frame.queryCount, frame.queryCount + 1, parent });
+	frame.queryCount += 2;
+	openZones_.push_back(uint32_t(frame.zones.size() - 1));
+	source_->WriteTimestamp(currentFrame_ * maxQueriesPerFrame_ + frame.zones.back().beginQuery);
+}
+
+void GpuProfiler::EndZone() {
+	assert(!openZones_.empty());
+	const uint32_t zone = openZones_.back();
+	openZones_.pop_back();
+	if (zone != UINT32_MAX) {
+		source_->WriteTimestamp(currentFrame_ * maxQueriesPerFrame_ + frames_[currentFrame_].zones[zone].endQuery);
+	}
+}
+
+void GpuProfiler::EndFrame(uint64_t fenceValue) {
+	assert(openZones_.empty());
+	Frame& frame = frames_[currentFrame_];
+	if (recording_ && frame.queryCount > 0) {
+		source_->ResolveTimestamps(currentFrame_ * maxQueriesPerFrame_, frame.queryCount);
+		frame.fenceValue = fenceValue;
+		frame.pending = true;
+	}
+	recording_ = false;
+	currentFrame_ = (currentFrame_ + 1) % uint32_t(frames_.size());
+}
+
+void GpuProfiler::ReadFrame(uint32_t frameIndex) {
+	Frame& frame = frames_[frameIndex];
+	frame.pending = false;
+	timestamps_.resize(frame.queryCount);
+	source_->ReadTimestamps(frameIndex * maxQueriesPerFrame_, frame.queryCount, timestamps_.data());
+
+	const double frequency = double(source_->GetTimestampFrequency());
+	const double millisecondsPerTick = 1000.0 / frequency;
+	// CPUのタイムラインに合わせるための基準。GPUの時刻との差をナノ秒にして足す
+	uint64_t calibrationGpu = 0;
+	int64_t calibrationCpu = 0;
+	const bool calibrated = source_->GetClockCalibration(calibrationGpu, calibrationCpu);
+	auto toCpuNanoseconds = [&](uint64_t timestamp) {
+		return calibrationCpu + int64_t((double(timestamp) - double(calibrationGpu)) * 1000000000.0 / frequency);
+	};
+
+	// 区間は始まった順に並び、外側の区間が先に来る
+	const uint64_t frameBegin = frame.zones.empty() ? 0 : timestamps_[frame.zones.front().beginQuery];
+	lastResults_.clear();
+	childMilliseconds_.assign(frame.zones.size(), 0.0);
+	for (const Zone& zone : frame.zones) {
+		const uint64_t begin = timestamps_[zone.beginQuery];
+		const uint64_t end = timestamps_[zone.endQuery];
+		GpuZoneResult result{};
+		result.name = zone.name;
+		result.depth = zone.parent == UINT32_MAX ? 0 : lastResults_[zone.parent].depth + 1;
+		result.beginMilliseconds = begin > frameBegin ? double(begin - frameBegin) * millisecondsPerTick : 0.0;
+		// 読めなかったときなど、前後が入れ替わっていれば0にする
+		result.milliseconds = end > begin ? double(end - begin) * millisecondsPerTick : 0.0;
+		lastResults_.push_back(result);
+		if (zone.parent != UINT32_MAX) {
+			childMilliseconds_[zone.parent] += result.milliseconds;
+		}
+		if (calibrated && end > begin) {
+			GetProfiler().AddGpuZone(zone.name, toCpuNanoseconds(begin), toCpuNanoseconds(end));
+		}
+	}
+
+	// 名前は同じ文字列を指すので、ポインタで突き合わせる
+	for (size_t index = 0; index < lastResults_.size(); ++index) {
+		const GpuZoneResult& result = lastResults_[index];
+		auto it = std::find_if(accumulators_.begin(), accumulators_.end(), [&](const ZoneAccumulator& accumulator) {
+			return accumulator.name == result.name;
+		});
+		if (it == accumulators_.end()) {
+			accumulators_.push_back({ result.name, 0.0, 0.0, 0.0, 0 });
+			it = accumulators_.end() - 1;
+		}
+		it->milliseconds += result.milliseconds;
+		it->selfMilliseconds += (std::max)(result.milliseconds - childMilliseconds_[index], 0.0);
+		it->maxMilliseconds = (std::max)(it->maxMilliseconds, result.milliseconds);
+		++it->callCount;
+	}
+	if (++accumulatedFrameCount_ >= Profiler::kStatsFrameCount) {
+		const double frameCount = double(accumulatedFrameCount_);
+		zoneStats_.clear();
+		for (const ZoneAccumulator& accumulator : accumulators_) {
+			zoneStats_.push_back({ accumulator.name, accumulator.milliseconds / frameCount, accumulator.selfMilliseconds / frameCount,
+				accumulator.maxMilliseconds, double(accumulator.callCount) / frameCount });
+		}
+		std::sort(zoneStats_.begin(), zoneStats_.end(), [](const ProfileZoneStats& a, const ProfileZoneStats& b) {
+			return a.milliseconds > b.milliseconds;
+		});
+		accumulators_.clear();
+		accumulatedFrameCount_ = 0;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,109 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+#include "Profiler.h"
+
+/// <summary>
+/// GpuProfilerがGPUの時刻を取るためのインターフェース
+/// クエリは番号で指定し、実体は描画API側で持つ。テストでは決まった時刻を返すものを使える
+/// </summary>
+class GpuQuerySource {
+public:
+	virtual ~GpuQuerySource() = default;
+	// query番目のクエリに、GPUがここまで進んだ時刻を書くコマンドを積む
+	virtual void WriteTimestamp(uint32_t query) = 0;
+	// [first, first + count)のクエリの結果を読み戻し用の場所へ書き出すコマンドを積む
+	virtual void ResolveTimestamps(uint32_t first, uint32_t count) = 0;
+	// 書き出した結果を読む。GPUがResolveTimestampsを終えた後に呼ぶ
+	virtual void ReadTimestamps(uint32_t first, uint32_t count, uint64_t* timestamps) = 0;
+	// 時刻の1秒あたりの値
+	virtual uint64_t GetTimestampFrequency() const = 0;
+	// 同じ瞬間のGPUの時刻とCPUの時刻(steady_clockのナノ秒)。取れなければfalse
+	virtual bool GetClockCalibration(uint64_t& gpuTimestamp, int64_t& cpuNanoseconds) = 0;
+};
+
+/// <summary>
+/// 1フレーム分のGPUの区間の結果
+/// </summary>
+struct GpuZoneResult {
+	const char* name;
+	uint32_t depth;
+	double beginMilliseconds; //!< フレームの最初の区間の始まりから
+	double milliseconds;
+};
+
+/// <summary>
+/// コマンドリストの名前付きの区間の前後にタイムスタンプを書き、GPUでかかった時間を測る
+/// クエリはframeCountフレーム分を輪番で使い、GPUが終えたフレームから結果を読む。描画APIには依存しない
+/// 読んだ区間はProfilerのタイムラインにも送り、CPUの区間と同じトレースに出す
+/// </summary>
+class GpuProfiler {
+public:
+	// frameCount: 同時にGPUに積むフレームの最大数、maxQueriesPerFrame: 1フレームで使うクエリの最大数(区間1つで2つ)
+	void Initialize(GpuQuerySource* source, uint32_t frameCount, uint32_t maxQueriesPerFrame);
+
+	// フレームの最初に呼び、GPUが終えたフレームの結果を読む。completedFenceValue: GPUが終えたFenceの値
+	// 今回使うクエリの結果がまだ読めなければ、このフレームは測らない
+	void BeginFrame(uint64_t completedFenceValue);
+	// 区間を始める、終える。必ず対にし、間のコマンドは同じキューで実行する
+	void BeginZone(std::string_view name);
+	void EndZone();
+	// フレームの最後のコマンドリストを閉じる前に呼び、結果を読み戻すコマンドを積む
+	// fenceValue: この後Signalする値。GPUがここまで進めば結果を読む
+	void EndFrame(uint64_t fenceValue);
+
+	// 最後に読めたフレームの区間。始まった順
+	const std::vector<GpuZoneResult>& GetLastResults() const { return lastResults_; }
+	// 数フレーム分の平均。時間の長い順
+	const std::vector<ProfileZoneStats>& GetZoneStats() const { return zoneStats_; }
+	// クエリが足りないか、前の結果が読めずに測らなかった区間の数
+	uint64_t GetDroppedCount() const { return droppedCount_; }
+
+private:
+	struct Zone {
+		const char* name;
+		uint32_t beginQuery; //!< フレームの中の番号。測らない区間はUINT32_MAX
+		uint32_t endQuery;
+		uint32_t parent; //!< 外側の区間。無ければUINT32_MAX
+	};
+	struct Frame {
+		std::vector<Zone> zones;
+		uint32_t queryCount;
+		uint64_t fenceValue;
+		bool pending; //!< 結果をまだ読んでいない
+	};
+	// 名前をstd::stringにせずに探せるようにする
+	struct NameHash {
+		using is_transparent = void;
+		size_t operator()(std::string_view name) const { return std::hash<std::string_view>{}(name); }
+	};
+	struct ZoneAccumulator {
+		const char* name;
+		double milliseconds;
+		double selfMilliseconds;
+		double maxMilliseconds;
+		uint64_t callCount;
+	};
+
+	// GPUが終えたフレームの結果を読んで集計する
+	void ReadFrame(uint32_t frameIndex);
+
+	GpuQuerySource* source_ = nullptr;
+	uint32_t maxQueriesPerFrame_ = 0;
+	std::vector<Frame> frames_;
+	uint32_t currentFrame_ = 0;
+	bool recording_ = false; //!< このフレームで測っている
+	std::vector<uint32_t> openZones_;
+	std::unordered_set<std::string, NameHash, std::equal_to<>> names_; //!< 結果を読むまで名前を残しておく
+	std::vector<uint64_t> timestamps_;
+	std::vector<double> childMilliseconds_;
+	std::vector<GpuZoneResult> lastResults_;
+	std::vector<ZoneAccumulator> accumulators_;
+	uint32_t accumulatedFrameCount_ = 0;
+	std::vector<ProfileZoneStats> zoneStats_;
+	uint64_t droppedCount_ = 0;
+};
\ No newline at end of file
@@ -0,0 +1,112 @@
+#include "IndirectDraw.h"
+#include <algorithm>
+#include <cassert>
+
+namespace {
+	// 容量を分けていないPSO。全て書き込む
+	const uint32_t kUnassignedQuota = UINT32_MAX;
+}
+
+uint32_t IndirectDrawBuilder::AddMesh(const IndirectMesh& mesh) {
+	meshes_.push_back(mesh);
+	return uint32_t(meshes_.size() - 1);
+}
+
+void IndirectDrawBuilder::Clear() {
+	objects_.clear();
+	culledCount_ = 0;
+	overflowCount_ = 0;
+}
+
+void IndirectDrawBuilder::Add(const IndirectDrawObject& object) {
+	assert(object.mesh < meshes_.size());
+	objects_.push_back(object);
+}
+
+uint32_t IndirectDrawBuilder::Build(IndirectCommand* commands, size_t capacity, std::vector<IndirectBatch>& batches) {
+	batches.clear();
+	sortItems_.clear();
+	// 同じフレームで何度Buildしても数が積み上がらないようにする
+	culledCount_ = 0;
+	overflowCount_ = 0;
+	// カリングで残ったものだけソート対象にする
+	for (uint32_t index = 0; index < objects_.size(); ++index) {
+		const IndirectDrawObject& object = objects_[index];
+		if (!object.visible) {
+			++culledCount_;
+			continue;
+		}
+		sortItems_.push_back({ SortKey::Make(0, object.pipeline, object.mesh, object.depth), index });
+	}
+	// PSO -> メッシュ -> 手前から の順に並べる
+	sortScratch_.resize(sortItems_.size());
+	SortKey::RadixSort(sortItems_.data(), sortScratch_.data(), sortItems_.size());
+
+	// PSOごとの範囲を数える。commandOffsetはまずsortItems_の位置として使う
+	for (uint32_t position = 0; position < sortItems_.size(); ++position) {
+		uint32_t pipeline = SortKey::GetPipeline(sortItems_[position].key);
+		if (batches.empty() || batches.back().pipeline != pipeline) {
+			batches.push_back({ pipeline, position, 0 });
+		}
+		++batches.back().commandCount;
+	}
+
+	// 入りきらなければPSOごとに容量を分け、どのPSOも描画されるようにする
+	// 各PSOの中ではソート順の後ろ(大きいメッシュ番号、同じメッシュなら奥のもの)から落ちる
+	batchQuotas_.assign(batches.size(), kUnassignedQuota);
+	if (sortItems_.size() > capacity) {
+		size_t remaining = capacity;
+		size_t openCount = batches.size();
+		// 均等な取り分に収まるPSOは全て入れ、余った分を残りのPSOで分け直す
+		bool assigned = true;
+		while (openCount > 0 && assigned) {
+			assigned = false;
+			const size_t share = remaining / openCount;
+			for (size_t index = 0; index < batches.size(); ++index) {
+				if (batchQuotas_[index] == kUnassignedQuota && batches[index].commandCount <= share) {
+					batchQuotas_[index] = batches[index].commandCount;
+					remaining -= batches[index].commandCount;
+					--openCount;
+					assigned = true;
+				}
+			}
+		}
+		// 残りは均等に分け、割り切れない分は先のPSOに1つずつ足す
+		for (size_t index = 0; index < batches.size() && openCount > 0; ++index) {
+			if (batchQuotas_[index] == kUnassignedQuota) {
+				const size_t quota = (remaining + openCount - 1) / openCount;
+				batchQuotas_[index] = uint32_t(quota);
+				remaining -= quota;
+				--openCount;
+			}
+		}
+	}
+
+	uint32_t commandCount = 0;
+	size_t batchCount = 0;
+	for (size_t batchIndex = 0; batchIndex < batches.size(); ++batchIndex) {
+		const IndirectBatch source = batches[batchIndex];
+		const uint32_t writeCount = (std::min)(source.commandCount, batchQuotas_[batchIndex]);
+		if (writeCount == 0) {
+			continue;
+		}
+		batches[batchCount++] = { source.pipeline, commandCount, writeCount };
+		for (uint32_t position = source.commandOffset; position < source.commandOffset + writeCount; ++position) {
+			const IndirectDrawObject& object = objects_[sortItems_[position].index];
+			const IndirectMesh& mesh = meshes_[object.mesh];
+			IndirectCommand& command = commands[commandCount];
+			command.objectIndex = object.objectIndex;
+			command.drawArguments.indexCountPerInstance = mesh.indexCount;
+			command.drawArguments.instanceCount = 1;
+			command.drawArguments.startIndexLocation = mesh.startIndex;
+			command.drawArguments.baseVertexLocation = mesh.baseVertex;
+			command.drawArguments.startInstanceLocation = 0;
+			++commandCount;
+		}
+	}
+	batches.resize(batchCount);
+	assert(commandCount <= capacity);
+	// 呼び出し側が数を見てバッファを大きくする
+	overflowCount_ = sortItems_.size() - commandCount;
+	return commandCount;
+}
\ No newline at end of file
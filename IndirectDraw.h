@@ -0,0 +1,87 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "SortKey.h"
+
+/// <summary>
+/// D3D12_DRAW_INDEXED_ARGUMENTSと同じレイアウト
+/// </summary>
+struct DrawIndexedArguments {
+	uint32_t indexCountPerInstance;
+	uint32_t instanceCount;
+	uint32_t startIndexLocation;
+	int32_t baseVertexLocation;
+	uint32_t startInstanceLocation;
+};
+
+/// <summary>
+/// ExecuteIndirectに渡す1コマンド分のデータ
+/// CommandSignatureの並び(ルート定数 -> DrawIndexed)と一致させる
+/// </summary>
+struct IndirectCommand {
+	uint32_t objectIndex; //!< ルート定数としてVertexShaderに渡すオブジェクト番号
+	DrawIndexedArguments drawArguments;
+};
+static_assert(sizeof(IndirectCommand) == 24, "IndirectCommand must match the command signature stride");
+
+/// <summary>
+/// 共有バッファ内のメッシュの範囲
+/// </summary>
+struct IndirectMesh {
+	uint32_t indexCount;
+	uint32_t startIndex;
+	int32_t baseVertex;
+};
+
+/// <summary>
+/// 描画したいオブジェクト1つ分の情報
+/// </summary>
+struct IndirectDrawObject {
+	uint32_t pipeline; //!< 使用するPSOの番号
+	uint32_t mesh; //!< IndirectDrawBuilderに登録したメッシュの番号
+	uint32_t objectIndex; //!< インスタンスデータの番号
+	float depth; //!< カメラからの距離。手前から描画する
+	bool visible; //!< カリング結果
+};
+
+/// <summary>
+/// PSOごとのExecuteIndirectの範囲
+/// </summary>
+struct IndirectBatch {
+	uint32_t pipeline;
+	uint32_t commandOffset; //!< 引数バッファ先頭からのコマンド数
+	uint32_t commandCount;
+};
+
+/// <summary>
+/// カリング・ソートしたオブジェクトをExecuteIndirect用の引数バッファに詰める
+/// </summary>
+class IndirectDrawBuilder {
+public:
+	// メッシュを登録して番号を返す
+	uint32_t AddMesh(const IndirectMesh& mesh);
+	// 毎フレームの最初に呼ぶ
+	void Clear();
+	void Add(const IndirectDrawObject& object);
+
+	// 可視オブジェクトをソートしてcommandsへ書き込み、PSOごとの範囲をbatchesに返す
+	// 戻り値は書き込んだコマンド数。capacityに入らなかった分はGetOverflowCountで返す
+	// 入りきらないときはPSOごとに容量を分け、各PSOの中ではソート順の後ろから落とす
+	uint32_t Build(IndirectCommand* commands, size_t capacity, std::vector<IndirectBatch>& batches);
+
+	size_t GetObjectCount() const { return objects_.size(); }
+	// 直前のBuildでカリングされた数
+	size_t GetCulledCount() const { return culledCount_; }
+	// 直前のBuildでcapacityを超えて書き込めなかった可視オブジェクトの数。0でなければ引数バッファを大きくする
+	size_t GetOverflowCount() const { return overflowCount_; }
+
+private:
+	std::vector<IndirectMesh> meshes_;
+	std::vector<IndirectDrawObject> objects_;
+	std::vector<SortKey::Item> sortItems_; //!< ソートキーとobjects_の番号
+	std::vector<SortKey::Item> sortScratch_; //!< 基数ソートの作業領域
+	std::vector<uint32_t> batchQuotas_; //!< 溢れたときにPSOごとに書き込む数
+	size_t culledCount_ = 0;
+	size_t overflowCount_ = 0;
+};
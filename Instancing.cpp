@@ -0,0 +1,54 @@
+#include "Instancing.h"
+#include <cmath>
+
+void UpdateInstanceData(
+	const WorldTransform* transforms,
+	const uint32_t* materialIndices,
+	size_t count,
+	const mat4x4& viewProjection,
+	InstanceData* instanceData) {
+	const mat4x4& vp = viewProjection;
+	for (size_t i = 0; i < count; ++i) {
+		const WorldTransform& t = transforms[i];
+		// MakeAffineMatrixと同じ X*Y*Z の回転を行列積なしで直接求める
+		float sx = std::sin(t.rotate.x), cx = std::cos(t.rotate.x);
+		float sy = std::sin(t.rotate.y), cy = std::cos(t.rotate.y);
+		float sz = std::sin(t.rotate.z), cz = std::cos(t.rotate.z);
+
+		float r[3][3];
+		r[0][0] = cy * cz;
+		r[0][1] = cy * sz;
+		r[0][2] = -sy;
+		r[1][0] = sx * sy * cz - cx * sz;
+		r[1][1] = sx * sy * sz + cx * cz;
+		r[1][2] = sx * cy;
+		r[2][0] = cx * sy * cz + sx * sz;
+		r[2][1] = cx * sy * sz - sx * cz;
+		r[2][2] = cx * cy;
+
+		const float scale[3] = { t.scale.x,t.scale.y,t.scale.z };
+		mat4x4& world = instanceData[i].World;
+		for (int row = 0; row < 3; ++row) {
+			world.m[row][0] = scale[row] * r[row][0];
+			world.m[row][1] = scale[row] * r[row][1];
+			world.m[row][2] = scale[row] * r[row][2];
+			world.m[row][3] = 0.0f;
+		}
+		world.m[3][0] = t.translate.x;
+		world.m[3][1] = t.translate.y;
+		world.m[3][2] = t.translate.z;
+		world.m[3][3] = 1.0f;
+
+		// Worldはアフィン行列なので4列目を省いてWVPを計算する
+		mat4x4& wvp = instanceData[i].WVP;
+		for (int row = 0; row < 4; ++row) {
+			const float w0 = world.m[row][0], w1 = world.m[row][1], w2 = world.m[row][2];
+			const float w3 = (row == 3) ? 1.0f : 0.0f;
+			for (int column = 0; column < 4; ++column) {
+				wvp.m[row][column] =
+					w0 * vp.m[0][column] + w1 * vp.m[1][column] + w2 * vp.m[2][column] + w3 * vp.m[3][column];
+			}
+		}
+		instanceData[i].materialIndex = materialIndices ? materialIndices[i] : 0;
+	}
+}
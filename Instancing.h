@@ -0,0 +1,24 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "mat4x4.h"
+#include "Transform.h"
+
+/// <summary>
+/// インスタンス1つ分のデータ。StructuredBufferとしてGPUに渡す
+/// </summary>
+struct InstanceData {
+	mat4x4 WVP;
+	mat4x4 World;
+	uint32_t materialIndex; //!< 参照するマテリアルの番号
+	float padding[3];
+};
+
+// WorldTransformの配列からまとめてWorld/WVPを計算し、instanceDataへ書き込む
+// materialIndicesがnullptrの場合は全て0を書き込む
+void UpdateInstanceData(
+	const WorldTransform* transforms,
+	const uint32_t* materialIndices,
+	size_t count,
+	const mat4x4& viewProjection,
+	InstanceData* instanceData);
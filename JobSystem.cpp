@@ -0,0 +1,348 @@
+#include "JobSystem.h"
+#include <chrono>
+#include <cmath>
+#include "Profiler.h"
+
+namespace {
+	// ジョブが無いときに眠るまでに探し直す回数
+	const uint32_t kSpinCount = 64;
+
+	/// <summary>
+	/// ワーカーのスレッドがどのJobSystemの何番かを覚えておく
+	/// </summary>
+	struct CurrentWorker {
+		const JobSystem* system;
+		uint32_t index;
+	};
+	thread_local CurrentWorker currentWorker{ nullptr, JobSystem::kInvalidWorker };
+}
+
+bool JobSystem::WorkStealingQueue::Push(Job* job) {
+	const int64_t bottom = bottom_.load(std::memory_order_relaxed);
+	const int64_t top = top_.load(std::memory_order_acquire);
+	if (bottom - top >= int64_t(kMaxJobsPerWorker)) {
+		return false;
+	}
+	jobs_[bottom & (kMaxJobsPerWorker - 1)].store(job, std::memory_order_relaxed);
+	// 盗むスレッドがbottom_を読んだら、ジョブの中身まで見えるようにする
+	bottom_.store(bottom + 1, std::memory_order_release);
+	return true;
+}
+
+JobSystem::Job* JobSystem::WorkStealingQueue::Pop() {
+	const int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+	bottom_.store(bottom, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t top = top_.load(std::memory_order_relaxed);
+	if (top > bottom) {
+		// 空だった
+		bottom_.store(bottom + 1, std::memory_order_relaxed);
+		return nullptr;
+	}
+	Job* job = jobs_[bottom & (kMaxJobsPerWorker - 1)].load(std::memory_order_relaxed);
+	if (top == bottom) {
+		// 最後の1つは盗みに来たスレッドと取り合う
+		if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+			job = nullptr;
+		}
+		bottom_.store(bottom + 1, std::memory_order_relaxed);
+	}
+	return job;
+}
+
+JobSystem::Job* JobSystem::WorkStealingQueue::Steal() {
+	int64_t top = top_.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	const int64_t bottom = bottom_.load(std::memory_order_acquire);
+	if (top >= bottom) {
+		return nullptr;
+	}
+	Job* job = jobs_[top & (kMaxJobsPerWorker - 1)].load(std::memory_order_relaxed);
+	if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+		return nullptr;
+	}
+	return job;
+}
+
+bool JobSystem::WorkStealingQueue::IsEmpty() const {
+	return bottom_.load(std::memory_order_relaxed) <= top_.load(std::memory_order_relaxed);
+}
+
+JobSystem::~JobSystem() {
+	if (running_) {
+		Stop();
+	}
+}
+
+void JobSystem::Start(uint32_t workerCount) {
+	assert(!running_);
+	if (workerCount == 0) {
+		workerCount = (std::max)(1u, std::thread::hardware_concurrency());
+	}
+	ownerThread_ = std::this_thread::get_id();
+	workers_.clear();
+	for (uint32_t index = 0; index < workerCount; ++index) {
+		std::unique_ptr<Worker> worker = std::make_unique<Worker>();
+		worker->jobs = std::make_unique<Job[]>(kMaxJobsPerWorker);
+		workers_.push_back(std::move(worker));
+	}
+	externalJobPool_ = std::make_unique<Job[]>(kMaxJobsPerWorker);
+	nextExternalJob_ = 0;
+	readExternalJob_ = 0;
+	externalExecutedCount_ = 0;
+	running_ = true;
+	for (uint32_t index = 1; index < workerCount; ++index) {
+		threads_.emplace_back(&JobSystem::WorkerMain, this, index);
+	}
+}
+
+void JobSystem::Stop() {
+	assert(std::this_thread::get_id() == ownerThread_);
+	{
+		// 眠ろうとしているワーカーが見逃さないようにロックを取ってから止める
+		std::lock_guard<std::mutex> lock(sleepMutex_);
+		running_ = false;
+	}
+	sleepCondition_.notify_all();
+	for (std::thread& thread : threads_) {
+		thread.join();
+	}
+	threads_.clear();
+	// 0番に残ったジョブは呼び出したスレッドで片付ける
+	while (Job* job = FindJob(0)) {
+		Execute(job, 0);
+	}
+}
+
+uint32_t JobSystem::GetCurrentWorker() const {
+	if (currentWorker.system == this) {
+		return currentWorker.index;
+	}
+	if (!workers_.empty() && std::this_thread::get_id() == ownerThread_) {
+		return 0;
+	}
+	return kInvalidWorker;
+}
+
+void JobSystem::Push(JobCounter& counter, JobFunction function, const void* data, size_t size) {
+	assert(running_);
+	counter.count_.fetch_add(1, std::memory_order_relaxed);
+	const uint32_t workerIndex = GetCurrentWorker();
+	if (workerIndex != kInvalidWorker) {
+		Worker& worker = *workers_[workerIndex];
+		Job& job = worker.jobs[worker.nextJob & (kMaxJobsPerWorker - 1)];
+		if (job.queued.load(std::memory_order_acquire)) {
+			// 置き場が一周しても前のジョブが終わっていない。積まずにここで実行する
+			function(data, workerIndex);
+			counter.count_.fetch_sub(1, std::memory_order_release);
+			return;
+		}
+		++worker.nextJob;
+		job.function = function;
+		job.counter = &counter;
+		job.queued.store(true, std::memory_order_relaxed);
+		std::memcpy(job.data, data, size);
+		if (!worker.queue.Push(&job)) {
+			// dequeが満杯
+			Execute(&job, workerIndex);
+			return;
+		}
+	} else {
+		std::lock_guard<std::mutex> lock(externalMutex_);
+		Job& job = externalJobPool_[nextExternalJob_++ & (kMaxJobsPerWorker - 1)];
+		assert(!job.queued.load(std::memory_order_acquire) && "ワーカーでないスレッドから積んだジョブが多すぎる");
+		job.function = function;
+		job.counter = &counter;
+		job.queued.store(true, std::memory_order_relaxed);
+		std::memcpy(job.data, data, size);
+		externalCount_.fetch_add(1);
+	}
+	queuedCount_.fetch_add(1);
+	WakeWorkers();
+}
+
+void JobSystem::Wait(JobCounter& counter) {
+	const uint32_t workerIndex = GetCurrentWorker();
+	while (!counter.IsDone()) {
+		// ワーカーでないスレッドは、ワーカーのdequeにあるジョブをワーカーの番号無しでは実行できない
+		Job* job = workerIndex != kInvalidWorker ? FindJob(workerIndex) : PopExternalJob();
+		if (job) {
+			Execute(job, workerIndex);
+		} else {
+			std::this_thread::yield();
+		}
+	}
+}
+
+JobSystemStats JobSystem::GetStats() const {
+	JobSystemStats stats{};
+	stats.workerCount = GetWorkerCount();
+	stats.executedCount = externalExecutedCount_.load(std::memory_order_relaxed);
+	for (const std::unique_ptr<Worker>& worker : workers_) {
+		stats.executedCount += worker->executedCount.load(std::memory_order_relaxed);
+		stats.stealCount += worker->stealCount.load(std::memory_order_relaxed);
+		stats.sleepCount += worker->sleepCount.load(std::memory_order_relaxed);
+	}
+	return stats;
+}
+
+JobSystem::Job* JobSystem::FindJob(uint32_t workerIndex) {
+	Worker& worker = *workers_[workerIndex];
+	if (Job* job = worker.queue.Pop()) {
+		queuedCount_.fetch_sub(1);
+		return job;
+	}
+	// 隣から順に盗む
+	const uint32_t workerCount = GetWorkerCount();
+	for (uint32_t offset = 1; offset < workerCount; ++offset) {
+		if (Job* job = workers_[(workerIndex + offset) % workerCount]->queue.Steal()) {
+			queuedCount_.fetch_sub(1);
+			worker.stealCount.fetch_add(1, std::memory_order_relaxed);
+			return job;
+		}
+	}
+	return PopExternalJob();
+}
+
+JobSystem::Job* JobSystem::PopExternalJob() {
+	if (externalCount_.load(std::memory_order_acquire) == 0) {
+		return nullptr;
+	}
+	std::lock_guard<std::mutex> lock(externalMutex_);
+	if (readExternalJob_ == nextExternalJob_) {
+		return nullptr;
+	}
+	// 置き場は積まれた順に並んでいるので、読む位置を進めるだけでよい
+	Job* job = &externalJobPool_[readExternalJob_++ & (kMaxJobsPerWorker - 1)];
+	externalCount_.fetch_sub(1);
+	queuedCount_.fetch_sub(1);
+	return job;
+}
+
+void JobSystem::Execute(Job* job, uint32_t workerIndex) {
+	JobCounter* counter = job->counter;
+	job->function(job->data, workerIndex);
+	job->queued.store(false, std::memory_order_release);
+	std::atomic<uint64_t>& executedCount = workerIndex != kInvalidWorker ? workers_[workerIndex]->executedCount : externalExecutedCount_;
+	executedCount.fetch_add(1, std::memory_order_relaxed);
+	// 0になるとWaitしているスレッドがcounterを捨てることがあるので、最後に触る
+	counter->count_.fetch_sub(1, std::memory_order_release);
+}
+
+void JobSystem::WorkerMain(uint32_t workerIndex) {
+	currentWorker = { this, workerIndex };
+	GetProfiler().SetThreadName("Job Worker");
+	Worker& worker = *workers_[workerIndex];
+	uint32_t spin = 0;
+	for (;;) {
+		if (Job* job = FindJob(workerIndex)) {
+			Execute(job, workerIndex);
+			spin = 0;
+			continue;
+		}
+		if (++spin < kSpinCount) {
+			std::this_thread::yield();
+			continue;
+		}
+		spin = 0;
+		// 積まれるか止められるまで眠る
+		std::unique_lock<std::mutex> lock(sleepMutex_);
+		if (!running_ && queuedCount_.load() <= 0) {
+			break;
+		}
+		sleepingCount_.fetch_add(1);
+		if (queuedCount_.load() <= 0 && running_) {
+			worker.sleepCount.fetch_add(1, std::memory_order_relaxed);
+			sleepCondition_.wait(lock, [&] { return queuedCount_.load() > 0 || !running_; });
+		}
+		sleepingCount_.fetch_sub(1);
+	}
+	currentWorker = { nullptr, kInvalidWorker };
+}
+
+void JobSystem::WakeWorkers() {
+	// 眠ろうとしているワーカーはロックの中でqueuedCount_を見直すので、ロックを取ってから起こせば見逃さない
+	if (sleepingCount_.load() > 0) {
+		std::lock_guard<std::mutex> lock(sleepMutex_);
+		sleepCondition_.notify_one();
+	}
+}
+
+JobSystem& GetJobSystem() {
+	static JobSystem jobSystem;
+	return jobSystem;
+}
+
+JobSystemBenchmark MeasureJobSystem(uint32_t workerCount, uint32_t jobCount) {
+	using Clock = std::chrono::steady_clock;
+	JobSystemBenchmark result{};
+	result.workerCount = workerCount == 0 ? (std::max)(1u, std::thread::hardware_concurrency()) : workerCount;
+	jobCount = (std::max)(jobCount, 1u);
+
+	// 空のジョブを積んで待つ時間
+	{
+		JobSystem jobSystem;
+		jobSystem.Start(result.workerCount);
+		std::atomic<uint32_t> executedCount{ 0 };
+		JobCounter counter;
+		const Clock::time_point start = Clock::now();
+		for (uint32_t job = 0; job < jobCount; ++job) {
+			jobSystem.Run(counter, [&executedCount](uint32_t) { executedCount.fetch_add(1, std::memory_order_relaxed); });
+		}
+		jobSystem.Wait(counter);
+		result.runNanoseconds = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / jobCount;
+		assert(executedCount == jobCount);
+		jobSystem.Stop();
+	}
+	// 同じことをスレッドを作って行う。作るのが遅いので数を減らす
+	{
+		const uint32_t threadCount = (std::min)(jobCount, 256u);
+		std::atomic<uint32_t> executedCount{ 0 };
+		const Clock::time_point start = Clock::now();
+		for (uint32_t thread = 0; thread < threadCount; thread += result.workerCount) {
+			std::vector<std::thread> threads;
+			for (uint32_t index = thread; index < (std::min)(thread + result.workerCount, threadCount); ++index) {
+				threads.emplace_back([&executedCount]() { executedCount.fetch_add(1, std::memory_order_relaxed); });
+			}
+			for (std::thread& worker : threads) {
+				worker.join();
+			}
+		}
+		result.threadNanoseconds = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / threadCount;
+	}
+
+	// 重さの偏った処理をワーカーの数を変えて並列に行う
+	const uint32_t kItemCount = 1u << 20;
+	for (uint32_t workers = 1; result.scalingStepCount < JobSystemBenchmark::kMaxScalingSteps; workers *= 2) {
+		workers = (std::min)(workers, result.workerCount);
+		JobSystem jobSystem;
+		jobSystem.Start(workers);
+		// ワーカーごとの合計。同じキャッシュラインを書かないように離す
+		std::vector<double> sums(size_t(workers) * 8, 0.0);
+		double bestMilliseconds = 0.0;
+		for (uint32_t iteration = 0; iteration < 3; ++iteration) {
+			const Clock::time_point start = Clock::now();
+			jobSystem.ParallelFor(kItemCount, 256, [&sums](uint32_t begin, uint32_t end, uint32_t workerIndex) {
+				double sum = 0.0;
+				for (uint32_t item = begin; item < end; ++item) {
+					// 後ろの項目ほど重くする
+					const uint32_t steps = 1 + item / (kItemCount / 16);
+					for (uint32_t step = 0; step < steps; ++step) {
+						sum += std::sqrt(double(item + step));
+					}
+				}
+				sums[size_t(workerIndex) * 8] += sum;
+			});
+			const double milliseconds = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+			bestMilliseconds = iteration == 0 ? milliseconds : (std::min)(bestMilliseconds, milliseconds);
+		}
+		jobSystem.Stop();
+		result.scalingWorkerCounts[result.scalingStepCount] = workers;
+		result.scalingMilliseconds[result.scalingStepCount] = bestMilliseconds;
+		++result.scalingStepCount;
+		if (workers == result.workerCount) {
+			break;
+		}
+	}
+	return result;
+}
\ No newline at end of file
@@ -0,0 +1,213 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/// <summary>
+/// 終わっていないジョブの数。JobSystem::Runで増え、ジョブが終わると減る。0になればWaitが戻る
+/// </summary>
+class JobCounter {
+public:
+	bool IsDone() const { return count_.load(std::memory_order_acquire) == 0; }
+
+private:
+	friend class JobSystem;
+	std::atomic<uint32_t> count_{ 0 };
+};
+
+/// <summary>
+/// JobSystemの統計。Startからの合計
+/// </summary>
+struct JobSystemStats {
+	uint32_t workerCount;
+	uint64_t executedCount; //!< 実行したジョブの数
+	uint64_t stealCount; //!< 他のワーカーから取ったジョブの数
+	uint64_t sleepCount; //!< ジョブが無くてワーカーが眠った回数
+};
+
+/// <summary>
+/// コアごとに1つのワーカーでジョブを実行する。ワーカーはChase-Levのdequeを持ち、空いたワーカーは他から盗む
+/// Startを呼んだスレッドが0番のワーカーになり、Waitの間は自分でもジョブを実行する
+/// ワーカーでないスレッドも、Waitの間はワーカーでないスレッドが積んだジョブを実行する
+/// ジョブは関数と小さな値を固定長の領域にコピーしたもので、積むときにメモリを確保しない
+/// 並列の処理はスレッドを作らずにここへジョブを積む。アプリ全体ではGetJobSystemを使う
+/// </summary>
+class JobSystem {
+public:
+	// ジョブにコピーできる値の大きさ
+	static const uint32_t kJobDataSize = 48;
+	// 1つのワーカーが同時に積んでおけるジョブの数。2のべき乗
+	static const uint32_t kMaxJobsPerWorker = 4096;
+	// ワーカーではないスレッド
+	static const uint32_t kInvalidWorker = ~0u;
+
+	JobSystem() = default;
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+	~JobSystem();
+
+	// workerCount: 呼び出したスレッドを含むワーカーの数。0ならコアの数
+	void Start(uint32_t workerCount);
+	// 積んだジョブが全て終わってからワーカーを止める。Startと同じスレッドで呼ぶ
+	void Stop();
+
+	uint32_t GetWorkerCount() const { return uint32_t(workers_.size()); }
+	// 呼び出したスレッドのワーカー番号。ワーカーでなければkInvalidWorker
+	uint32_t GetCurrentWorker() const;
+
+	// functionをコピーしてジョブにし、counterを1増やして積む。functionは(uint32_t workerIndex)で呼ばれる
+	// ワーカーでないスレッドが積んだものは、ワーカーでないスレッドがWaitの間に実行することがあり、そのときはkInvalidWorkerが渡る
+	// functionはkJobDataSize以下でmemcpyできるもの(参照や値をキャプチャしたラムダ)
+	template<typename Function>
+	void Run(JobCounter& counter, const Function& function) {
+		static_assert(sizeof(Function) <= kJobDataSize && alignof(Function) <= alignof(std::max_align_t) && std::is_trivially_copyable_v<Function>,
+			"ジョブの関数は小さくmemcpyできるものにする");
+		Push(counter, [](const void* data, uint32_t workerIndex) {
+			(*static_cast<const Function*>(data))(workerIndex);
+		}, &function, sizeof(Function));
+	}
+
+	// counterが0になるまで待つ。待つ間に他のジョブを実行する。ワーカーでないスレッドはワーカーでないスレッドが積んだものだけを実行する
+	void Wait(JobCounter& counter);
+
+	// [0, count)を範囲に分けて function(begin, end, workerIndex) を並列に呼び、全て終わるまで待つ
+	// 範囲は空いているワーカーがいる間だけ半分に分けて渡すので、偏りがあっても分け方を調整しなくてよい
+	// minGrain: これより小さくは分けない。ワーカーのスレッドから呼ぶ
+	template<typename Function>
+	void ParallelFor(uint32_t count, uint32_t minGrain, const Function& function) {
+		const uint32_t workerIndex = GetCurrentWorker();
+		assert(workerIndex != kInvalidWorker);
+		if (count == 0) {
+			return;
+		}
+		JobCounter counter;
+		const ParallelForJob<Function> job{ this, &function, &counter, 0, count, (std::max)(minGrain, 1u) };
+		if (workers_.size() <= 1 || count <= job.grain) {
+			function(0u, count, workerIndex);
+			return;
+		}
+		Run(counter, job);
+		Wait(counter);
+	}
+
+	JobSystemStats GetStats() const;
+
+private:
+	using JobFunction = void (*)(const void* data, uint32_t workerIndex);
+
+	struct Job {
+		JobFunction function;
+		JobCounter* counter;
+		std::atomic<bool> queued{ false }; //!< 積まれてから実行し終わるまでtrue。使い回す前に確かめる
+		alignas(std::max_align_t) uint8_t data[kJobDataSize];
+	};
+
+	/// <summary>
+	/// Chase-Levのdeque。持ち主は後ろから積んで取り、他のスレッドは前から盗む
+	/// </summary>
+	class WorkStealingQueue {
+	public:
+		// 持ち主だけが呼ぶ。満杯ならfalse
+		bool Push(Job* job);
+		Job* Pop();
+		// どのスレッドからでも呼べる。他と取り合って負けたらnullptr
+		Job* Steal();
+		bool IsEmpty() const;
+
+	private:
+		alignas(64) std::atomic<int64_t> top_{ 0 };
+		alignas(64) std::atomic<int64_t> bottom_{ 0 };
+		std::atomic<Job*> jobs_[kMaxJobsPerWorker];
+	};
+
+	struct alignas(64) Worker {
+		WorkStealingQueue queue;
+		std::unique_ptr<Job[]> jobs; //!< このワーカーが積むジョブの置き場。順に使い回す
+		uint32_t nextJob = 0;
+		std::atomic<uint64_t> executedCount{ 0 };
+		std::atomic<uint64_t> stealCount{ 0 };
+		std::atomic<uint64_t> sleepCount{ 0 };
+	};
+
+	// ParallelForの1つの範囲
+	template<typename Function>
+	struct ParallelForJob {
+		JobSystem* system;
+		const Function* function;
+		JobCounter* counter;
+		uint32_t begin;
+		uint32_t end;
+		uint32_t grain;
+
+		void operator()(uint32_t workerIndex) const {
+			uint32_t current = begin;
+			uint32_t last = end;
+			while (current < last) {
+				// 自分のdequeが空なら、空いているワーカーが盗めるように残りの後ろ半分を別のジョブにする
+				if (last - current > grain * 2 && system->workers_[workerIndex]->queue.IsEmpty()) {
+					const uint32_t middle = current + (last - current) / 2;
+					system->Run(*counter, ParallelForJob{ system, function, counter, middle, last, grain });
+					last = middle;
+				}
+				const uint32_t next = (std::min)(current + grain, last);
+				(*function)(current, next, workerIndex);
+				current = next;
+			}
+		}
+	};
+
+	void Push(JobCounter& counter, JobFunction function, const void* data, size_t size);
+	// 自分のdeque、他のワーカー、ワーカーでないスレッドが積んだものの順に探す
+	Job* FindJob(uint32_t workerIndex);
+	// ワーカーでないスレッドが積んだものを積まれた順に取る。無ければnullptr
+	Job* PopExternalJob();
+	// workerIndexはkInvalidWorkerでもよい
+	void Execute(Job* job, uint32_t workerIndex);
+	void WorkerMain(uint32_t workerIndex);
+	void WakeWorkers();
+
+	std::vector<std::unique_ptr<Worker>> workers_;
+	std::vector<std::thread> threads_;
+	std::thread::id ownerThread_;
+	std::atomic<bool> running_{ false };
+	// 積まれて誰も取っていないジョブのおよその数。ワーカーを眠らせるかに使う
+	alignas(64) std::atomic<int64_t> queuedCount_{ 0 };
+	std::atomic<uint32_t> sleepingCount_{ 0 };
+	std::mutex sleepMutex_;
+	std::condition_variable sleepCondition_;
+	// ワーカーでないスレッドが積んだジョブ。[readExternalJob_, nextExternalJob_)が取られていないもの
+	std::mutex externalMutex_;
+	std::atomic<uint32_t> externalCount_{ 0 };
+	std::unique_ptr<Job[]> externalJobPool_;
+	uint32_t nextExternalJob_ = 0;
+	uint32_t readExternalJob_ = 0;
+	std::atomic<uint64_t> externalExecutedCount_{ 0 }; //!< ワーカーでないスレッドが実行したジョブの数
+};
+
+// アプリ全体で使うJobSystem
+JobSystem& GetJobSystem();
+
+/// <summary>
+/// MeasureJobSystemの結果
+/// </summary>
+struct JobSystemBenchmark {
+	static const uint32_t kMaxScalingSteps = 8;
+	uint32_t workerCount;
+	double runNanoseconds; //!< 空のジョブ1つを積んで実行し終えるまでの平均
+	double threadNanoseconds; //!< 同じ仕事のためにstd::threadを作って待つときの平均
+	uint32_t scalingStepCount;
+	uint32_t scalingWorkerCounts[kMaxScalingSteps]; //!< 1, 2, 4, ... workerCount
+	double scalingMilliseconds[kMaxScalingSteps]; //!< 同じParallelForにかかった時間
+};
+
+// 空のジョブをjobCount個積む時間と、ワーカーの数を1からworkerCountまで変えたParallelForの時間を測る
+JobSystemBenchmark MeasureJobSystem(uint32_t workerCount, uint32_t jobCount);
\ No newline at end of file
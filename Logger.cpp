@@ -0,0 +1,288 @@
+#include "Logger.h"
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+
+namespace {
+	int64_t GetNanoseconds() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	// 何も書かない出力先。MeasureLoggerで使う
+	class NullLogSink : public LogSink {
+	public:
+		void Write(const char*, size_t) override {}
+	};
+}
+
+const char* GetLogLevelName(LogLevel level) {
+	const char* names[] = { "Trace", "Debug", "Info", "Warning", "Error", "Off" };
+	return names[size_t(level)];
+}
+
+const char* GetLogCategoryName(LogCategory category) {
+	const char* names[] = { "General", "Graphics", "Shader", "Asset" };
+	return names[size_t(category)];
+}
+
+void DebuggerLogSink::Write(const char* line, size_t length) {
+#ifdef _WIN32
+	(void)length;
+	OutputDebugStringA(line);
+#else
+	std::fwrite(line, 1, length, stderr);
+#endif
+}
+
+void ConsoleLogSink::Write(const char* line, size_t length) {
+	std::fwrite(line, 1, length, stdout);
+}
+
+void ConsoleLogSink::Flush() {
+	std::fflush(stdout);
+}
+
+FileLogSink::FileLogSink(const char* filePath) {
+#ifdef _WIN32
+	if (fopen_s(&file_, filePath, "wb") != 0) {
+		file_ = nullptr;
+	}
+#else
+	file_ = std::fopen(filePath, "wb");
+#endif
+}
+
+FileLogSink::~FileLogSink() {
+	if (file_) {
+		std::fclose(file_);
+	}
+}
+
+void FileLogSink::Write(const char* line, size_t length) {
+	if (file_) {
+		std::fwrite(line, 1, length, file_);
+	}
+}
+
+void FileLogSink::Flush() {
+	if (file_) {
+		std::fflush(file_);
+	}
+}
+
+Logger::Logger() : records_(new Record[kCapacity]) {
+	static_assert((kCapacity & (kCapacity - 1)) == 0, "kCapacity must be a power of two");
+	// 最初の周回はposition番目の場所がpositionで書き込める
+	for (uint32_t index = 0; index < kCapacity; ++index) {
+		records_[index].sequence.store(index, std::memory_order_relaxed);
+	}
+	for (std::atomic<uint8_t>& minLevel : minLevels_) {
+		minLevel.store(uint8_t(LogLevel::Trace), std::memory_order_relaxed);
+	}
+	// 時刻、重要度、分類の前置きの分を足しておく
+	line_.resize(kMaxMessageLength + 64);
+	startTime_ = GetNanoseconds();
+}
+
+Logger::~Logger() {
+	Stop();
+}
+
+void Logger::AddSink(std::unique_ptr<LogSink> sink) {
+	assert(!running_);
+	sinks_.push_back(std::move(sink));
+}
+
+void Logger::Start() {
+	assert(!running_);
+	running_ = true;
+	thread_ = std::thread([this]() { ThreadMain(); });
+}
+
+void Logger::Stop() {
+	if (!running_) {
+		return;
+	}
+	running_ = false;
+	thread_.join();
+	// 止める直前に積まれた分も書き出す
+	Drain();
+	for (std::unique_ptr<LogSink>& sink : sinks_) {
+		sink->Flush();
+	}
+}
+
+void Logger::Flush() {
+	const uint64_t target = writePosition_.load(std::memory_order_acquire);
+	if (!running_) {
+		Drain();
+		return;
+	}
+	while (readPosition_.load(std::memory_order_acquire) < target) {
+		std::this_thread::yield();
+	}
+}
+
+void Logger::SetLevel(LogLevel level) {
+	for (std::atomic<uint8_t>& minLevel : minLevels_) {
+		minLevel.store(uint8_t(level), std::memory_order_relaxed);
+	}
+}
+
+void Logger::SetLevel(LogCategory category, LogLevel level) {
+	minLevels_[size_t(category)].store(uint8_t(level), std::memory_order_relaxed);
+}
+
+void Logger::Write(LogLevel level, LogCategory category, std::string_view message) {
+	// シェーダーのエラーなど長いものは、UTF-8の文字の途中で切らないようにして何件かに分ける
+	do {
+		size_t length = message.size();
+		if (length > kMaxMessageLength) {
+			length = kMaxMessageLength;
+			while (length > 0 && (uint8_t(message[length]) & 0xC0) == 0x80) {
+				--length;
+			}
+			if (length == 0) {
+				// UTF-8として正しくないので、そのまま切る
+				length = kMaxMessageLength;
+			}
+		}
+		Record* record = Reserve(level, category);
+		if (!record) {
+			return;
+		}
+		std::memcpy(record->text, message.data(), length);
+		Commit(record, length);
+		message.remove_prefix(length);
+	} while (!message.empty());
+}
+
+void Logger::Write(LogLevel level, LogCategory category, Utf16StringView message) {
+	// UTF-8で1要素は3バイトを超えないので、それで入るなら確保した場所へ直接UTF-8にする
+	if (message.size() * 3 <= kMaxMessageLength) {
+		Record* record = Reserve(level, category);
+		if (record) {
+			Commit(record, ConvertUtf16ToUtf8(message, record->text, kMaxMessageLength));
+		}
+		return;
+	}
+	// 長いものは全てUTF-8にしてから、文字の途中で切らないように分ける
+	Utf8Text<kMaxMessageLength> text(message);
+	Write(level, category, text.view());
+}
+
+Logger::Record* Logger::Reserve(LogLevel level, LogCategory category) {
+	// Vyukovの有界キュー。場所の番号が書き込み位置と一致していれば、その位置を取り合う
+	uint64_t position = writePosition_.load(std::memory_order_relaxed);
+	while (true) {
+		Record& record = records_[position & (kCapacity - 1)];
+		const uint64_t sequence = record.sequence.load(std::memory_order_acquire);
+		const int64_t difference = int64_t(sequence) - int64_t(position);
+		if (difference == 0) {
+			if (writePosition_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+				record.position = position;
+				record.timestamp = uint64_t(GetNanoseconds() - startTime_);
+				record.level = level;
+				record.category = category;
+				return &record;
+			}
+		} else if (difference < 0) {
+			// 書き出しが追いついていないので捨てる。フレームを止めないことを優先する
+			droppedCount_.fetch_add(1, std::memory_order_relaxed);
+			return nullptr;
+		} else {
+			position = writePosition_.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+void Logger::Commit(Record* record, size_t length) {
+	record->length = uint32_t((std::min)(length, size_t(kMaxMessageLength)));
+	record->sequence.store(record->position + 1, std::memory_order_release);
+	// エラーの直後はassertで止まることが多いので、書き出し終えるまで待つ
+	if (record->level >= LogLevel::Error && running_.load(std::memory_order_acquire)) {
+		Flush();
+	}
+}
+
+uint32_t Logger::Drain() {
+	// キューは読み出す側が1つであることを前提にしているので、書き出しスレッド以外から呼ばれても同時には読まない
+	std::lock_guard<std::mutex> lock(drainMutex_);
+	uint32_t count = 0;
+	uint64_t position = readPosition_.load(std::memory_order_relaxed);
+	while (true) {
+		Record& record = records_[position & (kCapacity - 1)];
+		if (record.sequence.load(std::memory_order_acquire) != position + 1) {
+			// 空か、確保した側がまだ書き終えていない
+			break;
+		}
+		// [秒.ミリ秒][重要度][分類] 本文
+		const uint64_t milliseconds = record.timestamp / 1000000;
+		auto prefix = std::format_to_n(line_.data(), ptrdiff_t(line_.size() - record.length - 1), "[{}.{:03}][{}][{}] ",
+			milliseconds / 1000, milliseconds % 1000, GetLogLevelName(record.level), GetLogCategoryName(record.category));
+		size_t length = (std::min)(size_t(prefix.size), line_.size() - record.length - 1);
+		std::memcpy(line_.data() + length, record.text, record.length);
+		length += record.length;
+		line_[length] = '\0';
+		for (std::unique_ptr<LogSink>& sink : sinks_) {
+			sink->Write(line_.data(), length);
+		}
+		// 次の周回で書き込めるようにする
+		record.sequence.store(position + kCapacity, std::memory_order_release);
+		++position;
+		++count;
+		readPosition_.store(position, std::memory_order_release);
+	}
+	writtenCount_.fetch_add(count, std::memory_order_relaxed);
+	return count;
+}
+
+void Logger::ThreadMain() {
+	while (running_.load(std::memory_order_acquire)) {
+		if (Drain() == 0) {
+			// 積む側に通知させると待ちが生まれるので、空の間は少し眠って見に行く
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+}
+
+Logger& GetLogger() {
+	static Logger logger;
+	return logger;
+}
+
+LoggerBenchmark MeasureLogger(uint32_t threadCount, uint32_t messagesPerThread) {
+	Logger logger;
+	logger.AddSink(std::make_unique<NullLogSink>());
+	logger.Start();
+
+	LoggerBenchmark result{};
+	result.threadCount = (std::max)(threadCount, 1u);
+	result.messageCount = uint64_t(result.threadCount) * messagesPerThread;
+	std::vector<std::thread> threads;
+	std::atomic<int64_t> totalNanoseconds{ 0 };
+	const int64_t start = GetNanoseconds();
+	for (uint32_t thread = 0; thread < result.threadCount; ++thread) {
+		threads.emplace_back([&, thread]() {
+			const int64_t threadStart = GetNanoseconds();
+			for (uint32_t index = 0; index < messagesPerThread; ++index) {
+				logger.Write(LogLevel::Info, LogCategory::General, "thread:{} message:{} value:{:.3f}\n", thread, index, float(index) * 0.5f);
+			}
+			totalNanoseconds.fetch_add(GetNanoseconds() - threadStart, std::memory_order_relaxed);
+		});
+	}
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+	const int64_t elapsed = GetNanoseconds() - start;
+	logger.Stop();
+
+	result.writtenCount = logger.GetWrittenCount();
+	result.droppedCount = logger.GetDroppedCount();
+	result.nanosecondsPerMessage = result.messageCount > 0 ? double(totalNanoseconds.load()) / double(result.messageCount) : 0.0;
+	result.messagesPerSecond = elapsed > 0 ? double(result.messageCount) * 1e9 / double(elapsed) : 0.0;
+	return result;
+}
\ No newline at end of file
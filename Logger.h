@@ -0,0 +1,202 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <format>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "Unicode.h"
+
+// この重要度より低いログはコンパイル時に消える。0:Trace 1:Debug 2:Info 3:Warning 4:Error
+#ifndef LOG_COMPILE_LEVEL
+#ifdef _DEBUG
+#define LOG_COMPILE_LEVEL 0
+#else
+#define LOG_COMPILE_LEVEL 2
+#endif
+#endif
+
+// ログの重要度
+enum class LogLevel : uint8_t {
+	Trace,
+	Debug,
+	Info,
+	Warning,
+	Error,
+	Off, //!< SetLevelに渡すと全て出さない
+};
+
+// ログの分類。分類ごとに出す重要度を変えられる
+enum class LogCategory : uint8_t {
+	General,
+	Graphics,
+	Shader,
+	Asset,
+	Count,
+};
+
+const char* GetLogLevelName(LogLevel level);
+const char* GetLogCategoryName(LogCategory category);
+
+/// <summary>
+/// ログの出力先。Loggerの書き出しスレッドからだけ呼ばれる
+/// </summary>
+class LogSink {
+public:
+	virtual ~LogSink() = default;
+	// lineは改行まで含む1件分の文字列。line[length]は'\0'
+	virtual void Write(const char* line, size_t length) = 0;
+	virtual void Flush() {}
+};
+
+// デバッガの出力ウィンドウ(OutputDebugStringA)。Windows以外では標準エラー出力
+class DebuggerLogSink : public LogSink {
+public:
+	void Write(const char* line, size_t length) override;
+};
+
+// 標準出力
+class ConsoleLogSink : public LogSink {
+public:
+	void Write(const char* line, size_t length) override;
+	void Flush() override;
+};
+
+// ファイル。開けなければ何も書かない
+class FileLogSink : public LogSink {
+public:
+	explicit FileLogSink(const char* filePath);
+	~FileLogSink() override;
+	void Write(const char* line, size_t length) override;
+	void Flush() override;
+
+private:
+	std::FILE* file_ = nullptr;
+};
+
+/// <summary>
+/// ログを固定長のリングバッファに積み、別スレッドで出力先に書き出す
+/// 積む側はロックせず、書き込む場所を確保した後はその場で整形するので確保も待ちも無い。満杯なら捨てて数える
+/// </summary>
+class Logger {
+public:
+	// 1件の最大の長さ。超えた分は切り捨てる
+	static const uint32_t kMaxMessageLength = 512;
+	// リングバッファに入る件数。2のべき乗
+	static const uint32_t kCapacity = 4096;
+
+	Logger();
+	~Logger();
+
+	// Startの前に呼ぶ
+	void AddSink(std::unique_ptr<LogSink> sink);
+	// 書き出しスレッドを動かす。Startより前に積んだログもここから書き出す
+	void Start();
+	// 残りを全て書き出してからスレッドを止める
+	void Stop();
+	// ここまでに積んだログを書き出し終えるまで待つ
+	void Flush();
+
+	void SetLevel(LogLevel level);
+	void SetLevel(LogCategory category, LogLevel level);
+	bool IsEnabled(LogLevel level, LogCategory category) const {
+		return uint8_t(level) >= minLevels_[size_t(category)].load(std::memory_order_relaxed);
+	}
+
+	// 整形済みの文字列を積む。kMaxMessageLengthより長ければ何件かに分ける
+	void Write(LogLevel level, LogCategory category, std::string_view message);
+	// UTF-8にして積む。kMaxMessageLengthより長ければ何件かに分ける
+	void Write(LogLevel level, LogCategory category, Utf16StringView message);
+	// 整形して積む。kMaxMessageLengthに入らない分は切り捨てる
+	template<class... Args>
+	void Write(LogLevel level, LogCategory category, std::format_string<Args...> format, Args&&... args) {
+		Record* record = Reserve(level, category);
+		if (record) {
+			auto result = std::format_to_n(record->text, kMaxMessageLength, format, std::forward<Args>(args)...);
+			Commit(record, size_t(result.size));
+		}
+	}
+#ifdef _WIN32
+	// wchar_tがUTF-16なのはWindowsだけなので、ワイド文字列の整形はWindowsでだけ使える
+	template<class... Args>
+	void Write(LogLevel level, LogCategory category, std::wformat_string<Args...> format, Args&&... args) {
+		// 一旦スタック上で整形してからUTF-8にする。入らない分は切り捨てる
+		wchar_t buffer[kMaxMessageLength];
+		auto result = std::format_to_n(buffer, kMaxMessageLength, format, std::forward<Args>(args)...);
+		Write(level, category, std::wstring_view(buffer, (std::min)(size_t(result.size), size_t(kMaxMessageLength))));
+	}
+#endif
+
+	uint64_t GetWrittenCount() const { return writtenCount_.load(std::memory_order_relaxed); }
+	// バッファが満杯で捨てた件数
+	uint64_t GetDroppedCount() const { return droppedCount_.load(std::memory_order_relaxed); }
+
+private:
+	struct Record {
+		std::atomic<uint64_t> sequence; //!< 書き込めるか、読み出せるかを表す番号
+		uint64_t position; //!< 確保したときの書き込み位置
+		uint64_t timestamp; //!< Loggerを作ってからのナノ秒
+		LogLevel level;
+		LogCategory category;
+		uint32_t length;
+		char text[kMaxMessageLength];
+	};
+
+	// 書き込む場所を確保する。満杯ならnullptr
+	Record* Reserve(LogLevel level, LogCategory category);
+	// 確保した場所に書き終えたことを知らせる。lengthは切り捨てる前の長さでもよい。Error以上は書き出されるまで待つ
+	void Commit(Record* record, size_t length);
+	// 読み出せるものを全て出力先に書き出し、書き出した件数を返す。drainMutex_で読み出す側を1つにする
+	uint32_t Drain();
+	void ThreadMain();
+
+	std::unique_ptr<Record[]> records_;
+	alignas(64) std::atomic<uint64_t> writePosition_{ 0 };
+	alignas(64) std::atomic<uint64_t> readPosition_{ 0 };
+	std::atomic<uint8_t> minLevels_[size_t(LogCategory::Count)];
+	std::atomic<uint64_t> writtenCount_{ 0 };
+	std::atomic<uint64_t> droppedCount_{ 0 };
+	std::vector<std::unique_ptr<LogSink>> sinks_;
+	std::mutex drainMutex_; //!< 書き出しスレッドと、スレッドが無いときにFlushを呼んだスレッドが同時に読み出さないようにする
+	std::thread thread_;
+	std::atomic<bool> running_{ false };
+	std::vector<char> line_; //!< 書き出しスレッドで1件を組み立てる場所
+	int64_t startTime_ = 0;
+};
+
+// アプリ全体で使うLogger
+Logger& GetLogger();
+
+// 重要度がLOG_COMPILE_LEVEL以上ならIsEnabledを確かめてから整形する。無効なら引数も評価しない
+#define LOG_WRITE(level, category, ...) \
+	do { \
+		if constexpr (int(level) >= LOG_COMPILE_LEVEL) { \
+			if (GetLogger().IsEnabled(level, category)) { \
+				GetLogger().Write(level, category, __VA_ARGS__); \
+			} \
+		} \
+	} while (0)
+#define LOG_TRACE(category, ...) LOG_WRITE(LogLevel::Trace, category, __VA_ARGS__)
+#define LOG_DEBUG(category, ...) LOG_WRITE(LogLevel::Debug, category, __VA_ARGS__)
+#define LOG_INFO(category, ...) LOG_WRITE(LogLevel::Info, category, __VA_ARGS__)
+#define LOG_WARNING(category, ...) LOG_WRITE(LogLevel::Warning, category, __VA_ARGS__)
+#define LOG_ERROR(category, ...) LOG_WRITE(LogLevel::Error, category, __VA_ARGS__)
+
+/// <summary>
+/// MeasureLoggerの結果
+/// </summary>
+struct LoggerBenchmark {
+	uint32_t threadCount;
+	uint64_t messageCount; //!< 積もうとした件数
+	uint64_t writtenCount; //!< 出力先に届いた件数
+	uint64_t droppedCount;
+	double nanosecondsPerMessage; //!< 積む側の1件あたりの時間
+	double messagesPerSecond; //!< 全スレッド合わせた積む速さ
+};
+
+// threadCount個のスレッドから何も出力しない出力先へ messagesPerThread 件ずつ積んで速さを測る
+LoggerBenchmark MeasureLogger(uint32_t threadCount, uint32_t messagesPerThread);
\ No newline at end of file
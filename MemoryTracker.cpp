@@ -0,0 +1,153 @@
+#include "MemoryTracker.h"
+#include <algorithm>
+#include <cassert>
+#include "Logger.h"
+
+const char* GetMemoryCategoryName(MemoryCategory category) {
+	const char* names[] = { "Mesh", "Texture", "Constant", "Staging", "RenderTarget", "Other" };
+	return names[size_t(category)];
+}
+
+const char* GetMemorySegmentName(MemorySegment segment) {
+	const char* names[] = { "Local", "NonLocal" };
+	return names[size_t(segment)];
+}
+
+void MemoryTracker::Track(const void* key, MemoryCategory category, const std::string& name, uint64_t cpuBytes, uint64_t gpuBytes,
+	MemorySegment segment) {
+	assert(key && category < MemoryCategory::Count && segment < MemorySegment::Count);
+	std::lock_guard<std::mutex> lock(mutex_);
+	const bool inserted = allocations_.emplace(key, MemoryAllocationInfo{ name, category, segment, cpuBytes, gpuBytes }).second;
+	assert(inserted && "同じkeyを2回追跡している");
+	if (!inserted) {
+		return;
+	}
+	Add(categories_[size_t(category)], 1, int64_t(cpuBytes), int64_t(gpuBytes));
+	Add(total_, 1, int64_t(cpuBytes), int64_t(gpuBytes));
+	MemoryBudget& budget = budgets_[size_t(segment)];
+	budget.trackedBytes += gpuBytes;
+	budget.trackedPeakBytes = (std::max)(budget.trackedPeakBytes, budget.trackedBytes);
+	CheckBudget(segment);
+}
+
+bool MemoryTracker::Untrack(const void* key) {
+	std::lock_guard<std::mutex> lock(mutex_);
+	auto found = allocations_.find(key);
+	if (found == allocations_.end()) {
+		return false;
+	}
+	const MemoryAllocationInfo& info = found->second;
+	Add(categories_[size_t(info.category)], -1, -int64_t(info.cpuBytes), -int64_t(info.gpuBytes));
+	Add(total_, -1, -int64_t(info.cpuBytes), -int64_t(info.gpuBytes));
+	budgets_[size_t(info.segment)].trackedBytes -= info.gpuBytes;
+	const MemorySegment segment = info.segment;
+	allocations_.erase(found);
+	CheckBudget(segment);
+	return true;
+}
+
+void MemoryTracker::SetBudget(MemorySegment segment, uint64_t budget, uint64_t usage) {
+	std::lock_guard<std::mutex> lock(mutex_);
+	MemoryBudget& entry = budgets_[size_t(segment)];
+	entry.budget = budget;
+	entry.usage = usage;
+	entry.peakUsage = (std::max)(entry.peakUsage, usage);
+	CheckBudget(segment);
+}
+
+void MemoryTracker::ResetPeaks() {
+	std::lock_guard<std::mutex> lock(mutex_);
+	auto reset = [](MemoryCategoryStats& stats) {
+		stats.peakAllocationCount = stats.allocationCount;
+		stats.cpuPeakBytes = stats.cpuBytes;
+		stats.gpuPeakBytes = stats.gpuBytes;
+	};
+	for (MemoryCategoryStats& stats : categories_) {
+		reset(stats);
+	}
+	reset(total_);
+	for (MemoryBudget& budget : budgets_) {
+		budget.peakUsage = budget.usage;
+		budget.trackedPeakBytes = budget.trackedBytes;
+	}
+}
+
+MemoryCategoryStats MemoryTracker::GetCategoryStats(MemoryCategory category) const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return categories_[size_t(category)];
+}
+
+MemoryCategoryStats MemoryTracker::GetTotalStats() const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return total_;
+}
+
+MemoryBudget MemoryTracker::GetBudget(MemorySegment segment) const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return budgets_[size_t(segment)];
+}
+
+bool MemoryTracker::IsNearBudget(MemorySegment segment) const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return IsOverBudgetPercent(budgets_[size_t(segment)], kWarningPercent);
+}
+
+std::vector<MemoryAllocationInfo> MemoryTracker::GetLargestAllocations(uint32_t count) const {
+	std::vector<MemoryAllocationInfo> result;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		result.reserve(allocations_.size());
+		for (const auto& [key, info] : allocations_) {
+			result.push_back(info);
+		}
+	}
+	const size_t resultCount = (std::min)(result.size(), size_t(count));
+	std::partial_sort(result.begin(), result.begin() + resultCount, result.end(), [](const MemoryAllocationInfo& a, const MemoryAllocationInfo& b) {
+		return a.cpuBytes + a.gpuBytes > b.cpuBytes + b.gpuBytes;
+	});
+	result.resize(resultCount);
+	return result;
+}
+
+void MemoryTracker::Add(MemoryCategoryStats& stats, int64_t countDelta, int64_t cpuDelta, int64_t gpuDelta) {
+	stats.allocationCount = uint32_t(int64_t(stats.allocationCount) + countDelta);
+	stats.cpuBytes = uint64_t(int64_t(stats.cpuBytes) + cpuDelta);
+	stats.gpuBytes = uint64_t(int64_t(stats.gpuBytes) + gpuDelta);
+	stats.peakAllocationCount = (std::max)(stats.peakAllocationCount, stats.allocationCount);
+	stats.cpuPeakBytes = (std::max)(stats.cpuPeakBytes, stats.cpuBytes);
+	stats.gpuPeakBytes = (std::max)(stats.gpuPeakBytes, stats.gpuBytes);
+}
+
+void MemoryTracker::CheckBudget(MemorySegment segment) {
+	MemoryBudget& budget = budgets_[size_t(segment)];
+	bool& warned = warned_[size_t(segment)];
+	if (warned) {
+		// 少し下がっただけで戻すと、境目で確保と解放を繰り返すたびに警告が出る
+		warned = IsOverBudgetPercent(budget, kWarningResetPercent);
+		return;
+	}
+	if (IsOverBudgetPercent(budget, kWarningPercent)) {
+		warned = true;
+		++budget.warningCount;
+		// どの用途が使っているかを一緒に出す
+		LOG_WARNING(LogCategory::Graphics, "MemoryTracker: {} memory {} MB of {} MB budget (tracked {} MB)\n",
+			GetMemorySegmentName(segment), budget.usage >> 20, budget.budget >> 20, budget.trackedBytes >> 20);
+		for (size_t category = 0; category < size_t(MemoryCategory::Count); ++category) {
+			const MemoryCategoryStats& stats = categories_[category];
+			if (stats.allocationCount > 0) {
+				LOG_WARNING(LogCategory::Graphics, "MemoryTracker:   {}: {} allocations, gpu {} KB, cpu {} KB\n",
+					GetMemoryCategoryName(MemoryCategory(category)), stats.allocationCount, stats.gpuBytes >> 10, stats.cpuBytes >> 10);
+			}
+		}
+	}
+}
+
+bool MemoryTracker::IsOverBudgetPercent(const MemoryBudget& budget, uint32_t percent) {
+	const uint64_t used = (std::max)(budget.usage, budget.trackedBytes);
+	return budget.budget > 0 && used > budget.budget / 100 * percent;
+}
+
+MemoryTracker& GetMemoryTracker() {
+	static MemoryTracker memoryTracker;
+	return memoryTracker;
+}
\ No newline at end of file
@@ -0,0 +1,110 @@
+#pragma once
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// メモリの用途
+enum class MemoryCategory : uint8_t {
+	Mesh, //!< 頂点とインデックス
+	Texture,
+	Constant, //!< 定数バッファとインスタンスのデータ
+	Staging, //!< 転送と読み戻し
+	RenderTarget, //!< レンダーターゲットと深度
+	Other,
+	Count,
+};
+
+// GPUメモリの置き場所。QueryVideoMemoryInfoのセグメントグループと同じ分け方
+enum class MemorySegment : uint8_t {
+	Local, //!< GPUの近く。UMAなら全てここ
+	NonLocal, //!< CPUの近く。UploadやReadbackのヒープ
+	Count,
+};
+
+const char* GetMemoryCategoryName(MemoryCategory category);
+const char* GetMemorySegmentName(MemorySegment segment);
+
+/// <summary>
+/// 用途ごとの使用量
+/// </summary>
+struct MemoryCategoryStats {
+	uint32_t allocationCount;
+	uint32_t peakAllocationCount;
+	uint64_t cpuBytes;
+	uint64_t gpuBytes;
+	uint64_t cpuPeakBytes; //!< 一番多く使ったときのバイト数。ResetPeaksで今の値に戻る
+	uint64_t gpuPeakBytes;
+};
+
+/// <summary>
+/// セグメントの予算と使用量。budgetとusageはOSが報告したもので、SetBudgetで更新する
+/// </summary>
+struct MemoryBudget {
+	uint64_t budget; //!< これを超えるとOSがメモリを退避させる。0なら分からない
+	uint64_t usage; //!< このプロセスが使っているバイト数
+	uint64_t peakUsage;
+	uint64_t trackedBytes; //!< MemoryTrackerが追跡しているこのセグメントのGPUのバイト数
+	uint64_t trackedPeakBytes;
+	uint32_t warningCount; //!< 予算に近づいたと警告した回数
+};
+
+/// <summary>
+/// 追跡している1つの確保
+/// </summary>
+struct MemoryAllocationInfo {
+	std::string name;
+	MemoryCategory category;
+	MemorySegment segment;
+	uint64_t cpuBytes;
+	uint64_t gpuBytes;
+};
+
+/// <summary>
+/// 確保したメモリを用途ごとに数え、一番多く使ったときの値とOSの予算を持つ。描画APIには依存しない
+/// GPUの大きさは描画APIの側で求めて渡す。どのスレッドからでも呼べる。アプリ全体ではGetMemoryTrackerを使う
+/// </summary>
+class MemoryTracker {
+public:
+	// 予算に対してこの割合を超えたら警告のログを出す
+	static const uint32_t kWarningPercent = 90;
+	// 警告した後、この割合を下回るまでは次の警告を出さない。境目を行き来するたびに出さないようにする
+	static const uint32_t kWarningResetPercent = 80;
+
+	// keyは確保したものを指すもの(リソースのポインタなど)。追跡中のkeyは渡さない
+	void Track(const void* key, MemoryCategory category, const std::string& name, uint64_t cpuBytes, uint64_t gpuBytes,
+		MemorySegment segment = MemorySegment::Local);
+	// 追跡していなければfalse
+	bool Untrack(const void* key);
+	// OSが報告した予算と使用量
+	void SetBudget(MemorySegment segment, uint64_t budget, uint64_t usage);
+	// 一番多く使ったときの値を今の値にする
+	void ResetPeaks();
+
+	MemoryCategoryStats GetCategoryStats(MemoryCategory category) const;
+	MemoryCategoryStats GetTotalStats() const;
+	MemoryBudget GetBudget(MemorySegment segment) const;
+	// usageか追跡している量が、予算のkWarningPercentを超えているか
+	bool IsNearBudget(MemorySegment segment) const;
+	// CPUとGPUを合わせて大きい順にcount個
+	std::vector<MemoryAllocationInfo> GetLargestAllocations(uint32_t count) const;
+
+private:
+	// 使用量と一番多く使ったときの値を更新する。mutex_を持って呼ぶ
+	void Add(MemoryCategoryStats& stats, int64_t countDelta, int64_t cpuDelta, int64_t gpuDelta);
+	// 予算に近づいたら警告する。kWarningResetPercentを下回るまでは1回だけ。mutex_を持って呼ぶ
+	void CheckBudget(MemorySegment segment);
+	// usageか追跡している量が予算のpercentを超えているか。予算が分からなければfalse
+	static bool IsOverBudgetPercent(const MemoryBudget& budget, uint32_t percent);
+
+	mutable std::mutex mutex_;
+	std::unordered_map<const void*, MemoryAllocationInfo> allocations_;
+	MemoryCategoryStats categories_[size_t(MemoryCategory::Count)]{};
+	MemoryCategoryStats total_{};
+	MemoryBudget budgets_[size_t(MemorySegment::Count)]{};
+	bool warned_[size_t(MemorySegment::Count)]{}; //!< 警告した後、まだkWarningResetPercentを下回っていない
+};
+
+// アプリ全体で使うMemoryTracker
+MemoryTracker& GetMemoryTracker();
\ No newline at end of file
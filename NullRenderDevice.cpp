@@ -0,0 +1,318 @@
+#include "NullRenderDevice.h"
+#include <algorithm>
+#include "Logger.h"
+
+namespace {
+	// CBVの先頭は256バイトに揃える
+	const uint64_t kConstantBufferAlignment = 256;
+}
+
+NullRenderDevice::~NullRenderDevice() {
+	// 破棄し忘れたリソースを出す
+	const RenderDeviceStats stats = GetStats();
+	if (stats.bufferCount + stats.textureCount + stats.descriptorCount + stats.pipelineCount > 0) {
+		LOG_WARNING(LogCategory::Graphics, "NullRenderDevice: leaked {} buffers ({} bytes), {} textures ({} bytes), {} descriptors, {} pipelines\n",
+			stats.bufferCount, stats.bufferBytes, stats.textureCount, stats.textureBytes, stats.descriptorCount, stats.pipelineCount);
+	}
+}
+
+RenderBufferHandle NullRenderDevice::CreateBuffer(const RenderBufferDesc& desc) {
+	if (desc.size == 0) {
+		ReportError("CreateBuffer: size is 0");
+		return {};
+	}
+	Buffer buffer{ desc, {}, false };
+	if (desc.heapType != RenderHeapType::Default) {
+		buffer.memory.resize(size_t(desc.size));
+	}
+	AddBytes(desc.size);
+	bufferBytes_ += desc.size;
+	return { buffers_.Add(std::move(buffer)) };
+}
+
+void NullRenderDevice::DestroyBuffer(RenderBufferHandle buffer) {
+	Buffer* record = buffers_.Get(buffer.id);
+	if (!record) {
+		ReportError("DestroyBuffer: invalid buffer");
+		return;
+	}
+	if (record->mapped) {
+		ReportError("DestroyBuffer: buffer is still mapped");
+	}
+	bufferBytes_ -= record->desc.size;
+	buffers_.Remove(buffer.id);
+}
+
+void* NullRenderDevice::Map(RenderBufferHandle buffer) {
+	Buffer* record = buffers_.Get(buffer.id);
+	if (!record) {
+		ReportError("Map: invalid buffer");
+		return nullptr;
+	}
+	if (record->desc.heapType == RenderHeapType::Default) {
+		ReportError("Map: default heap buffers cannot be mapped");
+		return nullptr;
+	}
+	if (record->mapped) {
+		ReportError("Map: buffer is already mapped");
+	}
+	record->mapped = true;
+	return record->memory.data();
+}
+
+void NullRenderDevice::Unmap(RenderBufferHandle buffer) {
+	Buffer* record = buffers_.Get(buffer.id);
+	if (!record) {
+		ReportError("Unmap: invalid buffer");
+		return;
+	}
+	if (!record->mapped) {
+		ReportError("Unmap: buffer is not mapped");
+	}
+	record->mapped = false;
+}
+
+RenderTextureHandle NullRenderDevice::CreateTexture(const RenderTextureDesc& desc) {
+	if (desc.width == 0 || desc.height == 0 || desc.mipLevels == 0) {
+		ReportError("CreateTexture: size or mip level count is 0");
+		return {};
+	}
+	// Mipは1x1より小さくならない
+	uint32_t maxMipLevels = 1;
+	for (uint32_t size = (std::max)(desc.width, desc.height); size > 1; size /= 2) {
+		++maxMipLevels;
+	}
+	if (desc.mipLevels > maxMipLevels) {
+		ReportError("CreateTexture: too many mip levels");
+		return {};
+	}
+	if (GetRenderFormatBytesPerPixel(desc.format) == 0.0) {
+		ReportError("CreateTexture: unknown format");
+		return {};
+	}
+	const uint64_t bytes = GetRenderTextureBytes(desc);
+	AddBytes(bytes);
+	textureBytes_ += bytes;
+	return { textures_.Add({ desc, bytes, 0 }) };
+}
+
+void NullRenderDevice::DestroyTexture(RenderTextureHandle texture) {
+	Texture* record = textures_.Get(texture.id);
+	if (!record) {
+		ReportError("DestroyTexture: invalid texture");
+		return;
+	}
+	if (record->viewCount > 0) {
+		ReportError("DestroyTexture: texture still has views");
+	}
+	textureBytes_ -= record->bytes;
+	textures_.Remove(texture.id);
+}
+
+void NullRenderDevice::WriteTexture(RenderTextureHandle texture, uint32_t mipLevel, const void* data, uint32_t rowPitch, uint32_t slicePitch) {
+	const Texture* record = textures_.Get(texture.id);
+	if (!record) {
+		ReportError("WriteTexture: invalid texture");
+		return;
+	}
+	if (mipLevel >= record->desc.mipLevels) {
+		ReportError("WriteTexture: mip level out of range");
+		return;
+	}
+	// 1行と1枚が少なくともMipの大きさ分あるか確かめる。ブロック圧縮なら1行は4ピクセル分
+	const uint32_t width = (std::max)(record->desc.width >> mipLevel, 1u);
+	const uint32_t height = (std::max)(record->desc.height >> mipLevel, 1u);
+	const uint32_t rowHeight = IsRenderFormatBlockCompressed(record->desc.format) ? 4 : 1;
+	const uint32_t rowCount = (height + rowHeight - 1) / rowHeight;
+	const uint64_t imageBytes = GetRenderImageBytes(record->desc.format, width, height);
+	if (!data || uint64_t(rowPitch) * rowCount < imageBytes || slicePitch < imageBytes) {
+		ReportError("WriteTexture: data is smaller than the mip level");
+	}
+}
+
+RenderDescriptorHandle NullRenderDevice::CreateTextureView(RenderTextureHandle texture) {
+	Texture* record = textures_.Get(texture.id);
+	if (!record) {
+		ReportError("CreateTextureView: invalid texture");
+		return {};
+	}
+	++record->viewCount;
+	return { descriptors_.Add(texture) };
+}
+
+void NullRenderDevice::DestroyDescriptor(RenderDescriptorHandle descriptor) {
+	const RenderTextureHandle* texture = descriptors_.Get(descriptor.id);
+	if (!texture) {
+		ReportError("DestroyDescriptor: invalid descriptor");
+		return;
+	}
+	// テクスチャを先に破棄していれば、そちらで出している
+	if (Texture* record = textures_.Get(texture->id)) {
+		--record->viewCount;
+	}
+	descriptors_.Remove(descriptor.id);
+}
+
+RenderPipelineHandle NullRenderDevice::CreatePipeline(const RenderPipelineDesc& desc) {
+	if (!desc.vertexShader || desc.vertexShaderSize == 0) {
+		ReportError("CreatePipeline: vertex shader is missing");
+		return {};
+	}
+	if ((desc.depthTest || desc.depthWrite) && desc.depthStencilFormat == 0) {
+		ReportError("CreatePipeline: depth is used without a depth stencil format");
+		return {};
+	}
+	// シェーダーのアドレスは呼び出しの後に無くなってよいので持たない
+	RenderPipelineDesc record = desc;
+	record.vertexShader = nullptr;
+	record.pixelShader = nullptr;
+	return { pipelines_.Add(record) };
+}
+
+void NullRenderDevice::DestroyPipeline(RenderPipelineHandle pipeline) {
+	if (!pipelines_.Remove(pipeline.id)) {
+		ReportError("DestroyPipeline: invalid pipeline");
+	}
+}
+
+RenderDeviceStats NullRenderDevice::GetStats() const {
+	RenderDeviceStats stats{};
+	stats.bufferCount = buffers_.GetCount();
+	stats.bufferBytes = bufferBytes_;
+	stats.textureCount = textures_.GetCount();
+	stats.textureBytes = textureBytes_;
+	stats.descriptorCount = descriptors_.GetCount();
+	stats.pipelineCount = pipelines_.GetCount();
+	stats.validationErrorCount = errorCount_.load(std::memory_order_relaxed);
+	return stats;
+}
+
+const RenderBufferDesc* NullRenderDevice::FindBuffer(RenderBufferHandle buffer) const {
+	const Buffer* record = buffers_.Get(buffer.id);
+	return record ? &record->desc : nullptr;
+}
+
+void NullRenderDevice::ReportError(const char* message) {
+	errorCount_.fetch_add(1, std::memory_order_relaxed);
+	LOG_WARNING(LogCategory::Graphics, "NullRenderDevice: {}\n", message);
+}
+
+void NullRenderDevice::AddBytes(uint64_t bytes) {
+	peakBytes_ = (std::max)(peakBytes_, bufferBytes_ + textureBytes_ + bytes);
+}
+
+void NullRenderCommandList::Reset() {
+	stats_ = {};
+	hasPipeline_ = false;
+	hasVertexBuffer_ = false;
+	hasIndexBuffer_ = false;
+	vertexCapacity_ = 0;
+	indexCapacity_ = 0;
+}
+
+void NullRenderCommandList::SetPipeline(RenderPipelineHandle pipeline) {
+	++stats_.stateChangeCount;
+	hasPipeline_ = device_.IsValid(pipeline);
+	if (!hasPipeline_) {
+		device_.ReportError("SetPipeline: invalid pipeline");
+	}
+}
+
+void NullRenderCommandList::SetConstantBuffer(uint32_t, RenderBufferHandle buffer, uint64_t offset) {
+	++stats_.stateChangeCount;
+	const RenderBufferDesc* desc = device_.FindBuffer(buffer);
+	if (!desc) {
+		device_.ReportError("SetConstantBuffer: invalid buffer");
+	} else if (offset % kConstantBufferAlignment != 0) {
+		device_.ReportError("SetConstantBuffer: offset is not 256 byte aligned");
+	} else if (offset >= desc->size) {
+		device_.ReportError("SetConstantBuffer: offset is out of range");
+	}
+}
+
+void NullRenderCommandList::SetTexture(uint32_t, RenderDescriptorHandle descriptor) {
+	++stats_.stateChangeCount;
+	if (!device_.IsValid(descriptor)) {
+		device_.ReportError("SetTexture: invalid descriptor");
+	}
+}
+
+void NullRenderCommandList::SetVertexBuffer(RenderBufferHandle buffer, uint64_t offset, uint32_t size, uint32_t stride) {
+	++stats_.stateChangeCount;
+	hasVertexBuffer_ = false;
+	vertexCapacity_ = 0;
+	const RenderBufferDesc* desc = device_.FindBuffer(buffer);
+	if (!desc) {
+		device_.ReportError("SetVertexBuffer: invalid buffer");
+	} else if (stride == 0) {
+		device_.ReportError("SetVertexBuffer: stride is 0");
+	} else if (offset + size > desc->size) {
+		device_.ReportError("SetVertexBuffer: range is out of the buffer");
+	} else {
+		hasVertexBuffer_ = true;
+		vertexCapacity_ = size / stride;
+	}
+}
+
+void NullRenderCommandList::SetIndexBuffer(RenderBufferHandle buffer, uint64_t offset, uint32_t size) {
+	++stats_.stateChangeCount;
+	hasIndexBuffer_ = false;
+	indexCapacity_ = 0;
+	const RenderBufferDesc* desc = device_.FindBuffer(buffer);
+	if (!desc) {
+		device_.ReportError("SetIndexBuffer: invalid buffer");
+	} else if (offset % sizeof(uint32_t) != 0 || size % sizeof(uint32_t) != 0) {
+		device_.ReportError("SetIndexBuffer: range is not aligned to uint32_t");
+	} else if (offset + size > desc->size) {
+		device_.ReportError("SetIndexBuffer: range is out of the buffer");
+	} else {
+		hasIndexBuffer_ = true;
+		indexCapacity_ = size / uint32_t(sizeof(uint32_t));
+	}
+}
+
+void NullRenderCommandList::Draw(uint32_t vertexCount, uint32_t instanceCount) {
+	if (!ValidateDraw(instanceCount)) {
+		return;
+	}
+	if (vertexCount > vertexCapacity_) {
+		device_.ReportError("Draw: vertex count exceeds the vertex buffer");
+		return;
+	}
+	++stats_.drawCount;
+	stats_.instanceCount += instanceCount;
+	stats_.vertexCount += uint64_t(vertexCount) * instanceCount;
+}
+
+void NullRenderCommandList::DrawIndexed(uint32_t indexCount, uint32_t instanceCount) {
+	if (!ValidateDraw(instanceCount)) {
+		return;
+	}
+	if (!hasIndexBuffer_) {
+		device_.ReportError("DrawIndexed: no index buffer");
+		return;
+	}
+	if (indexCount > indexCapacity_) {
+		device_.ReportError("DrawIndexed: index count exceeds the index buffer");
+		return;
+	}
+	++stats_.drawCount;
+	stats_.instanceCount += instanceCount;
+	stats_.vertexCount += uint64_t(indexCount) * instanceCount;
+}
+
+bool NullRenderCommandList::ValidateDraw(uint32_t instanceCount) {
+	if (!hasPipeline_) {
+		device_.ReportError("Draw: no pipeline");
+		return false;
+	}
+	if (!hasVertexBuffer_) {
+		device_.ReportError("Draw: no vertex buffer");
+		return false;
+	}
+	if (instanceCount == 0) {
+		device_.ReportError("Draw: instance count is 0");
+		return false;
+	}
+	return true;
+}
\ No newline at end of file
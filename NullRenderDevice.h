@@ -0,0 +1,108 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include "RenderDevice.h"
+
+/// <summary>
+/// GPUを使わないRenderDevice。呼び出しを検証してリソースの数とメモリを数えるだけで、何も描画しない
+/// GPUの無い環境でフレームの処理を動かし、CPU側の時間を測るのに使う
+/// 誤った呼び出しはLOG_WARNINGで出して数える
+/// </summary>
+class NullRenderDevice : public RenderDevice {
+public:
+	~NullRenderDevice() override;
+
+	RenderBufferHandle CreateBuffer(const RenderBufferDesc& desc) override;
+	void DestroyBuffer(RenderBufferHandle buffer) override;
+	void* Map(RenderBufferHandle buffer) override;
+	void Unmap(RenderBufferHandle buffer) override;
+
+	RenderTextureHandle CreateTexture(const RenderTextureDesc& desc) override;
+	void DestroyTexture(RenderTextureHandle texture) override;
+	void WriteTexture(RenderTextureHandle texture, uint32_t mipLevel, const void* data, uint32_t rowPitch, uint32_t slicePitch) override;
+
+	RenderDescriptorHandle CreateTextureView(RenderTextureHandle texture) override;
+	void DestroyDescriptor(RenderDescriptorHandle descriptor) override;
+
+	RenderPipelineHandle CreatePipeline(const RenderPipelineDesc& desc) override;
+	void DestroyPipeline(RenderPipelineHandle pipeline) override;
+
+	RenderDeviceStats GetStats() const override;
+	// 今までで一番多かった時のバイト数
+	uint64_t GetPeakBytes() const { return peakBytes_; }
+
+	// NullRenderCommandListが検証に使う。無効な番号ならnullptr
+	const RenderBufferDesc* FindBuffer(RenderBufferHandle buffer) const;
+	bool IsValid(RenderDescriptorHandle descriptor) const { return descriptors_.Get(descriptor.id) != nullptr; }
+	bool IsValid(RenderPipelineHandle pipeline) const { return pipelines_.Get(pipeline.id) != nullptr; }
+
+	// 誤った呼び出しを出して数える。どのスレッドからでも呼べる
+	void ReportError(const char* message);
+
+private:
+	struct Buffer {
+		RenderBufferDesc desc;
+		std::vector<uint8_t> memory; //!< Mapで返す場所。UploadとReadbackだけ持つ
+		bool mapped;
+	};
+	struct Texture {
+		RenderTextureDesc desc;
+		uint64_t bytes;
+		uint32_t viewCount; //!< このテクスチャを指すディスクリプタの数
+	};
+
+	void AddBytes(uint64_t bytes);
+
+	RenderHandlePool<Buffer> buffers_;
+	RenderHandlePool<Texture> textures_;
+	RenderHandlePool<RenderTextureHandle> descriptors_;
+	RenderHandlePool<RenderPipelineDesc> pipelines_;
+	uint64_t bufferBytes_ = 0;
+	uint64_t textureBytes_ = 0;
+	uint64_t peakBytes_ = 0;
+	std::atomic<uint64_t> errorCount_{ 0 };
+};
+
+/// <summary>
+/// NullRenderCommandListで記録した数
+/// </summary>
+struct NullRenderCommandListStats {
+	uint32_t drawCount;
+	uint64_t instanceCount;
+	uint64_t vertexCount; //!< 全インスタンス分の頂点数(インデックスありならインデックス数)
+	uint32_t stateChangeCount; //!< Set系の呼び出し数
+};
+
+/// <summary>
+/// NullRenderDeviceのリソースを使うコマンドリスト。描画の前に必要な状態が揃っているかと範囲を検証して数える
+/// 1つのリストは1つのスレッドから使う。リストを分ければ並列に記録できる
+/// </summary>
+class NullRenderCommandList : public RenderCommandList {
+public:
+	explicit NullRenderCommandList(NullRenderDevice& device) : device_(device) {}
+
+	// 設定した状態と数を消す
+	void Reset();
+	const NullRenderCommandListStats& GetStats() const { return stats_; }
+
+	void SetPipeline(RenderPipelineHandle pipeline) override;
+	void SetConstantBuffer(uint32_t rootParameter, RenderBufferHandle buffer, uint64_t offset) override;
+	void SetTexture(uint32_t rootParameter, RenderDescriptorHandle descriptor) override;
+	void SetVertexBuffer(RenderBufferHandle buffer, uint64_t offset, uint32_t size, uint32_t stride) override;
+	void SetIndexBuffer(RenderBufferHandle buffer, uint64_t offset, uint32_t size) override;
+	void Draw(uint32_t vertexCount, uint32_t instanceCount) override;
+	void DrawIndexed(uint32_t indexCount, uint32_t instanceCount) override;
+
+private:
+	// 描画の前に共通で確かめる。足りなければfalse
+	bool ValidateDraw(uint32_t instanceCount);
+
+	NullRenderDevice& device_;
+	NullRenderCommandListStats stats_{};
+	bool hasPipeline_ = false;
+	uint32_t vertexCapacity_ = 0; //!< 設定した頂点バッファに入る頂点数。未設定なら0
+	uint32_t indexCapacity_ = 0; //!< 設定したインデックスバッファに入るインデックス数。未設定なら0
+	bool hasVertexBuffer_ = false;
+	bool hasIndexBuffer_ = false;
+};
\ No newline at end of file
@@ -5,11 +5,17 @@ SamplerState gSampler : register(s0);
 struct Material
 {
     float4 color;
-    int enableLighting;
+    int enableLighting; // CPU側でPSOを選ぶのに使う。シェーダーでは分岐しない
+    float3 padding; // StructuredBufferは詰めて並ぶので、ConstantBufferと同じ位置になるように空ける
     float4x4 uvTransform;
 };
 
+#ifdef INSTANCING
+// インスタンスごとのマテリアル。VSから受け取った番号で引く
+StructuredBuffer<Material> gMaterials : register(t1);
+#else
 ConstantBuffer<Material> gMaterial : register(b0);
+#endif
 
 struct DirectionalLight
 {
@@ -25,20 +31,31 @@ struct PixelShaderOutput
     float4 color : SV_TARGET0;
 };
 
+// LIGHTING: half lambertで照らす
+// TEXTURE: テクスチャを貼る。無ければマテリアルの色だけ
+// INSTANCING: マテリアルをStructuredBufferから読む
 PixelShaderOutput main(VertexShaderOutput input)
 {
     PixelShaderOutput output;
-    float4 transformedUV = mul(float4(input.texcoord, 0.0f, 1.0f), gMaterial.uvTransform);
+#ifdef INSTANCING
+    Material material = gMaterials[input.materialIndex];
+#else
+    Material material = gMaterial;
+#endif
+#ifdef TEXTURE
+    float4 transformedUV = mul(float4(input.texcoord, 0.0f, 1.0f), material.uvTransform);
     float4 textureColor = gTexture.Sample(gSampler, transformedUV.xy);
-    if (gMaterial.enableLighting != 0)
-    { // half lambert
-        float Ndotl = dot(normalize(input.normal), -gDirectionalLight.direction);
-        float cos = pow(Ndotl * 0.5f + 0.5f, 2.0f);
-        output.color = gMaterial.color * textureColor * gDirectionalLight.color * cos * gDirectionalLight.intensiy;
-    }
-    else
-    { // Lighingしない場合、前回までと同じ演算
-        output.color = gMaterial.color * textureColor;
-    }
+#else
+    float4 textureColor = float4(1.0f, 1.0f, 1.0f, 1.0f);
+#endif
+#ifdef LIGHTING
+    // half lambert
+    float Ndotl = dot(normalize(input.normal), -gDirectionalLight.direction);
+    float cos = pow(Ndotl * 0.5f + 0.5f, 2.0f);
+    output.color = material.color * textureColor * gDirectionalLight.color * cos * gDirectionalLight.intensiy;
+#else
+    // Lighingしない場合、前回までと同じ演算
+    output.color = material.color * textureColor;
+#endif
     return output;
 }
\ No newline at end of file
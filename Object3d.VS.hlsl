@@ -1,23 +1,60 @@
 #include "Object3d.hlsli"
+// INSTANCING: StructuredBufferから行列を読む
+// VERTEX_TEXCOORD: 頂点からtexcoordを読む。無ければ0を出力する
+#ifdef INSTANCING
+struct InstanceData {
+    matrix WVP;
+    matrix World;
+    uint materialIndex;
+    float3 padding;
+};
+
+StructuredBuffer<InstanceData> gInstanceData : register(t0);
+
+// ExecuteIndirectのルート定数で渡されるオブジェクト番号。通常のインスタンシングでは0
+struct ObjectIndex {
+    uint value;
+};
+
+ConstantBuffer<ObjectIndex> gObjectIndex : register(b1);
+#else
 struct TransformationMatrix {
     matrix WVP;
     matrix World;
 };
 
 ConstantBuffer<TransformationMatrix> gTransformationMatrix:register(b0);
+#endif
 
 struct VertexShaderInput
 {
     float4 position : POSITION0;
+#ifdef VERTEX_TEXCOORD
     float2 texcoord : TEXCOORD0;
+#endif
     float3 normal : NORMAL0;
 };
 
-VertexShaderOutput main(VertexShaderInput input)
+VertexShaderOutput main(VertexShaderInput input, uint instanceId : SV_InstanceID)
 {
     VertexShaderOutput output;
-    output.position = mul(input.position,gTransformationMatrix.WVP);
+#ifdef INSTANCING
+    InstanceData instance = gInstanceData[gObjectIndex.value + instanceId];
+    matrix wvp = instance.WVP;
+    matrix world = instance.World;
+#else
+    matrix wvp = gTransformationMatrix.WVP;
+    matrix world = gTransformationMatrix.World;
+#endif
+    output.position = mul(input.position, wvp);
+#ifdef VERTEX_TEXCOORD
     output.texcoord = input.texcoord;
-    output.normal = normalize(mul(input.normal, (float3x3) gTransformationMatrix.World));
+#else
+    output.texcoord = float2(0.0f, 0.0f);
+#endif
+    output.normal = normalize(mul(input.normal, (float3x3) world));
+#ifdef INSTANCING
+    output.materialIndex = instance.materialIndex;
+#endif
     return output;
 }
\ No newline at end of file
@@ -2,4 +2,7 @@ struct VertexShaderOutput {
 	float4 position : SV_POSITION;
 	float2 texcoord : TEXCOORD0;
 	float3 normal : NORMAL0;
+#ifdef INSTANCING
+	nointerpolation uint materialIndex : MATERIAL0; //!< PSで読むマテリアルの番号
+#endif
 };
\ No newline at end of file
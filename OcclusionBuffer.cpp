@@ -0,0 +1,303 @@
+#include "OcclusionBuffer.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <xmmintrin.h>
+
+namespace {
+	// 辺の両端の位置をビット列にしたもの。同じ位置の頂点を使う辺を、頂点の番号が違っても同じ辺として扱う
+	std::array<uint32_t, 6> MakeOccluderEdge(const Vector4& from, const Vector4& to) {
+		const float values[6] = { from.x, from.y, from.z, to.x, to.y, to.z };
+		std::array<uint32_t, 6> edge;
+		std::memcpy(edge.data(), values, sizeof(values));
+		return edge;
+	}
+
+	// 近クリップ面で切った多角形の辺が、元の三角形のどの辺か。近クリップ面に沿う辺はkClipEdge
+	const uint32_t kClipEdge = 3;
+}
+
+void OcclusionBuffer::Initialize(uint32_t width, uint32_t height) {
+	assert(width > 0 && height > 0);
+	// 4ピクセルずつ書くので幅を4の倍数にそろえる
+	width_ = (width + 3) & ~3u;
+	height_ = height;
+	levels_.clear();
+	uint32_t levelWidth = width_;
+	uint32_t levelHeight = height_;
+	while (true) {
+		levels_.push_back({ levelWidth, levelHeight, std::vector<float>(size_t(levelWidth) * levelHeight, 1.0f) });
+		if (levelWidth == 1 && levelHeight == 1) {
+			break;
+		}
+		levelWidth = (levelWidth + 1) / 2;
+		levelHeight = (levelHeight + 1) / 2;
+	}
+}
+
+void OcclusionBuffer::Begin(const mat4x4& viewProjection) {
+	viewProjection_ = viewProjection;
+	std::fill(levels_[0].depth.begin(), levels_[0].depth.end(), 1.0f);
+	stats_ = {};
+}
+
+void OcclusionBuffer::DrawOccluder(const VertexData* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount, const mat4x4& world) {
+	const mat4x4 worldViewProjection = Mul(world, viewProjection_);
+	const float(*m)[4] = worldViewProjection.m;
+	std::vector<ClipVertex>& clipVertices = clipVertices_;
+	clipVertices.resize(vertexCount);
+	for (uint32_t index = 0; index < vertexCount; ++index) {
+		const Vector4& p = vertices[index].position;
+		clipVertices[index] = {
+			p.x * m[0][0] + p.y * m[1][0] + p.z * m[2][0] + p.w * m[3][0],
+			p.x * m[0][1] + p.y * m[1][1] + p.z * m[2][1] + p.w * m[3][1],
+			p.x * m[0][2] + p.y * m[1][2] + p.z * m[2][2] + p.w * m[3][2],
+			p.x * m[0][3] + p.y * m[1][3] + p.z * m[2][3] + p.w * m[3][3],
+		};
+	}
+	const uint32_t triangleIndexCount = indices ? indexCount : vertexCount;
+	stats_.occluderTriangleCount += triangleIndexCount / 3;
+	auto vertexIndex = [&](uint32_t corner) { return indices ? indices[corner] : corner; };
+
+	// 表の三角形の辺を集める。逆向きの同じ辺を持つ表の三角形があれば、その辺は遮蔽物の面の中の継ぎ目で、
+	// 辺をまたぐピクセルの残りは隣の三角形が覆う。それ以外の辺は輪郭なので、またぐピクセルは覆ったとしない
+	frontEdges_.clear();
+	for (uint32_t index = 0; index + 2 < triangleIndexCount; index += 3) {
+		const uint32_t corners[3] = { vertexIndex(index), vertexIndex(index + 1), vertexIndex(index + 2) };
+		if (IsFrontFacing(clipVertices[corners[0]], clipVertices[corners[1]], clipVertices[corners[2]])) {
+			for (uint32_t edge = 0; edge < 3; ++edge) {
+				frontEdges_.push_back(MakeOccluderEdge(vertices[corners[edge]].position, vertices[corners[(edge + 1) % 3]].position));
+			}
+		}
+	}
+	std::sort(frontEdges_.begin(), frontEdges_.end());
+
+	for (uint32_t index = 0; index + 2 < triangleIndexCount; index += 3) {
+		const uint32_t corners[3] = { vertexIndex(index), vertexIndex(index + 1), vertexIndex(index + 2) };
+		const ClipVertex& v0 = clipVertices[corners[0]];
+		const ClipVertex& v1 = clipVertices[corners[1]];
+		const ClipVertex& v2 = clipVertices[corners[2]];
+		uint32_t sharedEdges = 0;
+		if (IsFrontFacing(v0, v1, v2)) {
+			for (uint32_t edge = 0; edge < 3; ++edge) {
+				const std::array<uint32_t, 6> reversed = MakeOccluderEdge(vertices[corners[(edge + 1) % 3]].position, vertices[corners[edge]].position);
+				if (std::binary_search(frontEdges_.begin(), frontEdges_.end(), reversed)) {
+					sharedEdges |= 1u << edge;
+				}
+			}
+		}
+		DrawClippedTriangle(v0, v1, v2, sharedEdges);
+	}
+}
+
+bool OcclusionBuffer::IsFrontFacing(const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2) const {
+	// 近クリップ面で切るものや、全て遠クリップ面の奥にあって描かないものは継ぎ目として扱わない
+	if (v0.w <= 0.0f || v1.w <= 0.0f || v2.w <= 0.0f || v0.z < 0.0f || v1.z < 0.0f || v2.z < 0.0f ||
+		(v0.z > v0.w && v1.z > v1.w && v2.z > v2.w)) {
+		return false;
+	}
+	const ScreenVertex s0 = ToScreen(v0);
+	const ScreenVertex s1 = ToScreen(v1);
+	const ScreenVertex s2 = ToScreen(v2);
+	return (s1.x - s0.x) * (s2.y - s0.y) - (s2.x - s0.x) * (s1.y - s0.y) > 0.0f;
+}
+
+void OcclusionBuffer::DrawClippedTriangle(const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2, uint32_t sharedEdges) {
+	// 全ての頂点が同じ平面の外にあれば捨てる
+	const ClipVertex* triangle[3] = { &v0, &v1, &v2 };
+	auto allOutside = [&](auto outside) {
+		return outside(*triangle[0]) && outside(*triangle[1]) && outside(*triangle[2]);
+	};
+	if (allOutside([](const ClipVertex& v) { return v.x < -v.w; }) || allOutside([](const ClipVertex& v) { return v.x > v.w; }) ||
+		allOutside([](const ClipVertex& v) { return v.y < -v.w; }) || allOutside([](const ClipVertex& v) { return v.y > v.w; }) ||
+		allOutside([](const ClipVertex& v) { return v.z < 0.0f; }) || allOutside([](const ClipVertex& v) { return v.z > v.w; })) {
+		return;
+	}
+
+	// 近クリップ面(z=0)でだけ切る。他の面は画面の範囲で切り詰めるので切らなくてよい
+	// polygonEdges[i]はpolygon[i]から次の頂点への辺が元の三角形のどの辺か
+	ClipVertex polygon[4];
+	uint32_t polygonEdges[4];
+	uint32_t polygonCount = 0;
+	for (uint32_t index = 0; index < 3; ++index) {
+		const ClipVertex& current = *triangle[index];
+		const ClipVertex& next = *triangle[(index + 1) % 3];
+		if (current.z >= 0.0f) {
+			polygonEdges[polygonCount] = index;
+			polygon[polygonCount++] = current;
+		}
+		if ((current.z >= 0.0f) != (next.z >= 0.0f)) {
+			const float t = current.z / (current.z - next.z);
+			// 面から出る点の後ろは近クリップ面に沿う辺、入る点の後ろは元の辺の続き
+			polygonEdges[polygonCount] = current.z >= 0.0f ? kClipEdge : index;
+			polygon[polygonCount++] = {
+				current.x + (next.x - current.x) * t,
+				current.y + (next.y - current.y) * t,
+				0.0f,
+				current.w + (next.w - current.w) * t,
+			};
+		}
+	}
+	if (polygonCount < 3) {
+		return;
+	}
+	auto isShared = [&](uint32_t edge) {
+		return polygonEdges[edge] != kClipEdge && (sharedEdges & (1u << polygonEdges[edge])) != 0;
+	};
+	// 4角形を2つに分けた対角線は、2つの三角形で覆うので共有する辺として扱う
+	const ScreenVertex screen0 = ToScreen(polygon[0]);
+	for (uint32_t index = 1; index + 1 < polygonCount; ++index) {
+		uint32_t fanEdges = isShared(index) ? 2u : 0u;
+		fanEdges |= (index == 1 ? isShared(0) : true) ? 1u : 0u;
+		fanEdges |= (index + 2 == polygonCount ? isShared(polygonCount - 1) : true) ? 4u : 0u;
+		RasterizeTriangle(screen0, ToScreen(polygon[index]), ToScreen(polygon[index + 1]), fanEdges);
+	}
+}
+
+OcclusionBuffer::ScreenVertex OcclusionBuffer::ToScreen(const ClipVertex& vertex) const {
+	const float inverseW = 1.0f / vertex.w;
+	return {
+		(vertex.x * inverseW * 0.5f + 0.5f) * float(width_),
+		(0.5f - vertex.y * inverseW * 0.5f) * float(height_),
+		vertex.z * inverseW,
+	};
+}
+
+void OcclusionBuffer::RasterizeTriangle(const ScreenVertex& v0, const ScreenVertex& v1, const ScreenVertex& v2, uint32_t sharedEdges) {
+	// 画面はyが下向きなので、時計回りの表の三角形は面積が正になる
+	const float area = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+	if (!(area > 0.0f)) {
+		return;
+	}
+
+	// ピクセルの中心が入る範囲。整数にする前に画面の少し外までに切り詰める
+	const float minX = (std::max)((std::min)({ v0.x, v1.x, v2.x }), -1.0f);
+	const float maxX = (std::min)((std::max)({ v0.x, v1.x, v2.x }), float(width_) + 1.0f);
+	const float minY = (std::max)((std::min)({ v0.y, v1.y, v2.y }), -1.0f);
+	const float maxY = (std::min)((std::max)({ v0.y, v1.y, v2.y }), float(height_) + 1.0f);
+	const int32_t beginX = (std::max)(int32_t(std::floor(minX - 0.5f)) + 1, 0) & ~3;
+	const int32_t endX = (std::min)(int32_t(std::ceil(maxX - 0.5f)), int32_t(width_));
+	const int32_t beginY = (std::max)(int32_t(std::floor(minY - 0.5f)) + 1, 0);
+	const int32_t endY = (std::min)(int32_t(std::ceil(maxY - 0.5f)), int32_t(height_));
+	if (beginX >= endX || beginY >= endY) {
+		return;
+	}
+	++stats_.rasterizedTriangleCount;
+
+	// 辺の関数 E(x, y) = a * x + b * y + c。3つとも0以上なら中にある。E12, E20, E01はそれぞれv0, v1, v2の重みに比例する
+	const float a12 = v1.y - v2.y, b12 = v2.x - v1.x, c12 = v1.x * v2.y - v1.y * v2.x;
+	const float a20 = v2.y - v0.y, b20 = v0.x - v2.x, c20 = v2.x * v0.y - v2.y * v0.x;
+	const float a01 = v0.y - v1.y, b01 = v1.x - v0.x, c01 = v0.x * v1.y - v0.y * v1.x;
+	// 深度も画面上で線形なので同じ形の式で求める
+	const float inverseArea = 1.0f / area;
+	const float depthA = (v0.z * a12 + v1.z * a20 + v2.z * a01) * inverseArea;
+	const float depthB = (v0.z * b12 + v1.z * b20 + v2.z * b01) * inverseArea;
+	const float depthC = (v0.z * c12 + v1.z * c20 + v2.z * c01) * inverseArea;
+
+	// 輪郭の辺は、ピクセルの中心から辺に一番近い角までの分だけ内側で判定し、ピクセル全体が入るものだけを覆ったとする
+	// 一部だけを覆うピクセルを覆ったとすると、残りの部分から見える物体を隠れていると判定してしまう
+	// 共有する辺は隣の三角形が残りを覆うので、中心で判定して継ぎ目に穴を開けない
+	const float inset12 = (sharedEdges & 2) ? 0.0f : (std::fabs(a12) + std::fabs(b12)) * 0.5f;
+	const float inset20 = (sharedEdges & 4) ? 0.0f : (std::fabs(a20) + std::fabs(b20)) * 0.5f;
+	const float inset01 = (sharedEdges & 1) ? 0.0f : (std::fabs(a01) + std::fabs(b01)) * 0.5f;
+	// 深度はピクセルの中で一番奥の値にする。三角形の中なので頂点の一番奥の深度は超えない
+	const float depthSlope = (std::fabs(depthA) + std::fabs(depthB)) * 0.5f;
+	const float farthestDepth = (std::max)({ v0.z, v1.z, v2.z });
+
+	const __m128 pixelOffset = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+	float* depthBuffer = levels_[0].depth.data();
+	for (int32_t y = beginY; y < endY; ++y) {
+		const float centerY = float(y) + 0.5f;
+		float* row = depthBuffer + size_t(y) * width_;
+		for (int32_t x = beginX; x < endX; x += 4) {
+			const __m128 centerX = _mm_add_ps(_mm_set1_ps(float(x)), pixelOffset);
+			const __m128 edge12 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a12), centerX), _mm_set1_ps(b12 * centerY + c12));
+			const __m128 edge20 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a20), centerX), _mm_set1_ps(b20 * centerY + c20));
+			const __m128 edge01 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a01), centerX), _mm_set1_ps(b01 * centerY + c01));
+			const __m128 inside = _mm_and_ps(_mm_cmpge_ps(edge12, _mm_set1_ps(inset12)),
+				_mm_and_ps(_mm_cmpge_ps(edge20, _mm_set1_ps(inset20)), _mm_cmpge_ps(edge01, _mm_set1_ps(inset01))));
+			if (_mm_movemask_ps(inside) == 0) {
+				continue;
+			}
+			const __m128 centerDepth = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(depthA), centerX), _mm_set1_ps(depthB * centerY + depthC));
+			const __m128 depth = _mm_min_ps(_mm_add_ps(centerDepth, _mm_set1_ps(depthSlope)), _mm_set1_ps(farthestDepth));
+			const __m128 previous = _mm_loadu_ps(row + x);
+			const __m128 write = _mm_and_ps(inside, _mm_cmplt_ps(depth, previous));
+			_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(write, depth), _mm_andnot_ps(write, previous)));
+		}
+	}
+}
+
+void OcclusionBuffer::BuildHierarchy() {
+	for (size_t level = 1; level < levels_.size(); ++level) {
+		const Level& source = levels_[level - 1];
+		Level& destination = levels_[level];
+		for (uint32_t y = 0; y < destination.height; ++y) {
+			const uint32_t y0 = y * 2;
+			const uint32_t y1 = (std::min)(y0 + 1, source.height - 1);
+			for (uint32_t x = 0; x < destination.width; ++x) {
+				const uint32_t x0 = x * 2;
+				const uint32_t x1 = (std::min)(x0 + 1, source.width - 1);
+				destination.depth[size_t(y) * destination.width + x] = (std::max)(
+					(std::max)(source.depth[size_t(y0) * source.width + x0], source.depth[size_t(y0) * source.width + x1]),
+					(std::max)(source.depth[size_t(y1) * source.width + x0], source.depth[size_t(y1) * source.width + x1]));
+			}
+		}
+	}
+}
+
+bool OcclusionBuffer::TestAABB(const AABB& aabb) {
+	++stats_.testedCount;
+	// 8頂点を射影して、画面上の範囲と一番手前の深度を求める
+	float minX = 1.0f, maxX = -1.0f, minY = 1.0f, maxY = -1.0f, minDepth = 1.0f;
+	for (uint32_t corner = 0; corner < 8; ++corner) {
+		const Vector3 p{ (corner & 1) ? aabb.max.x : aabb.min.x, (corner & 2) ? aabb.max.y : aabb.min.y, (corner & 4) ? aabb.max.z : aabb.min.z };
+		const float(*m)[4] = viewProjection_.m;
+		const float w = p.x * m[0][3] + p.y * m[1][3] + p.z * m[2][3] + m[3][3];
+		const float z = p.x * m[0][2] + p.y * m[1][2] + p.z * m[2][2] + m[3][2];
+		if (z < 0.0f || w <= 0.0f) {
+			// 近クリップ面をまたぐものはカメラに近すぎるので見えるものとする
+			return true;
+		}
+		const float x = (p.x * m[0][0] + p.y * m[1][0] + p.z * m[2][0] + m[3][0]) / w;
+		const float y = (p.x * m[0][1] + p.y * m[1][1] + p.z * m[2][1] + m[3][1]) / w;
+		minX = (std::min)(minX, x);
+		maxX = (std::max)(maxX, x);
+		minY = (std::min)(minY, y);
+		maxY = (std::max)(maxY, y);
+		minDepth = (std::min)(minDepth, z / w);
+	}
+	if (minX > 1.0f || maxX < -1.0f || minY > 1.0f || maxY < -1.0f || minDepth > 1.0f) {
+		++stats_.occludedCount;
+		return false;
+	}
+
+	// 画面上の範囲を深度バッファのピクセルにする。yは下向き
+	const float screenMinX = (std::max)((minX * 0.5f + 0.5f) * float(width_), 0.0f);
+	const float screenMaxX = (std::min)((maxX * 0.5f + 0.5f) * float(width_), float(width_ - 1));
+	const float screenMinY = (std::max)((0.5f - maxY * 0.5f) * float(height_), 0.0f);
+	const float screenMaxY = (std::min)((0.5f - minY * 0.5f) * float(height_), float(height_ - 1));
+	uint32_t beginX = uint32_t(screenMinX), endX = uint32_t(screenMaxX);
+	uint32_t beginY = uint32_t(screenMinY), endY = uint32_t(screenMaxY);
+
+	// 範囲が2x2ピクセル以下になる段まで縮小した深度で比べる
+	uint32_t level = 0;
+	while (level + 1 < levels_.size() && (endX - beginX > 1 || endY - beginY > 1)) {
+		++level;
+		beginX /= 2;
+		endX /= 2;
+		beginY /= 2;
+		endY /= 2;
+	}
+	const Level& source = levels_[level];
+	for (uint32_t y = beginY; y <= endY; ++y) {
+		for (uint32_t x = beginX; x <= endX; ++x) {
+			if (minDepth <= source.depth[size_t(y) * source.width + x]) {
+				return true;
+			}
+		}
+	}
+	++stats_.occludedCount;
+	return false;
+}
\ No newline at end of file
@@ -0,0 +1,81 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <vector>
+#include "Bounds.h"
+
+/// <summary>
+/// OcclusionBufferの1フレーム分の統計
+/// </summary>
+struct OcclusionStats {
+	uint32_t occluderTriangleCount; //!< DrawOccluderに渡した三角形の数
+	uint32_t rasterizedTriangleCount; //!< 裏向きや画面外で捨てずに描いた三角形の数
+	uint32_t testedCount; //!< TestAABBを呼んだ数
+	uint32_t occludedCount; //!< そのうち隠れていると判定した数
+};
+
+/// <summary>
+/// 遮蔽物をCPUで低解像度の深度バッファに描き、AABBが完全に隠れているかを判定する
+/// 深度はD3Dと同じく0が手前、1が奥。描画APIには依存しないので、同じ入力なら同じ深度バッファになる
+/// 遮蔽物はピクセル全体を覆うところだけを、そのピクセルの中で一番奥の深度で描く。見える物体を隠れていると判定しないため
+/// </summary>
+class OcclusionBuffer {
+public:
+	// widthは4の倍数に切り上げる
+	void Initialize(uint32_t width, uint32_t height);
+
+	// フレームの最初に呼び、深度を1でクリアする。viewProjectionは行ベクトルの行列
+	void Begin(const mat4x4& viewProjection);
+	// 遮蔽物を描く。indicesがnullptrなら頂点を3つずつ三角形にする。表は画面上で時計回り
+	// 同じ位置の頂点で逆向きに辺を共有する表の三角形同士は、継ぎ目に穴を開けずに描く
+	void DrawOccluder(const VertexData* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount, const mat4x4& world);
+	// 遮蔽物を描き終えたら呼び、縮小した深度バッファを作る
+	void BuildHierarchy();
+	// ワールド座標のAABBが見える可能性があればtrue。完全に遮蔽物の奥にあるか画面外ならfalse
+	bool TestAABB(const AABB& aabb);
+
+	uint32_t GetWidth() const { return width_; }
+	uint32_t GetHeight() const { return height_; }
+	// level 0が描いた深度、それより上は2x2の一番奥の深度
+	uint32_t GetLevelCount() const { return uint32_t(levels_.size()); }
+	uint32_t GetLevelWidth(uint32_t level) const { return levels_[level].width; }
+	uint32_t GetLevelHeight(uint32_t level) const { return levels_[level].height; }
+	const float* GetDepth(uint32_t level) const { return levels_[level].depth.data(); }
+
+	const OcclusionStats& GetStats() const { return stats_; }
+
+private:
+	struct Level {
+		uint32_t width;
+		uint32_t height;
+		std::vector<float> depth;
+	};
+	// 画面座標の頂点。zは0〜1の深度
+	struct ScreenVertex {
+		float x;
+		float y;
+		float z;
+	};
+	// クリップ座標
+	struct ClipVertex {
+		float x;
+		float y;
+		float z;
+		float w;
+	};
+
+	// sharedEdges: 隣の表の三角形と共有する辺。ビット0がv0→v1、1がv1→v2、2がv2→v0
+	void DrawClippedTriangle(const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2, uint32_t sharedEdges);
+	void RasterizeTriangle(const ScreenVertex& v0, const ScreenVertex& v1, const ScreenVertex& v2, uint32_t sharedEdges);
+	ScreenVertex ToScreen(const ClipVertex& vertex) const;
+	// 近クリップ面の手前にあり、画面上で表を向く三角形か
+	bool IsFrontFacing(const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2) const;
+
+	uint32_t width_ = 0;
+	uint32_t height_ = 0;
+	mat4x4 viewProjection_;
+	std::vector<Level> levels_;
+	std::vector<ClipVertex> clipVertices_; //!< DrawOccluderで頂点を変換した結果
+	std::vector<std::array<uint32_t, 6>> frontEdges_; //!< DrawOccluderで表の三角形の辺の両端の位置のビット列を並べたもの
+	OcclusionStats stats_{};
+};
\ No newline at end of file
@@ -0,0 +1,113 @@
+#include "ParallelCommandRecorder.h"
+#include "ArenaAllocator.h"
+#include <algorithm>
+#include <cassert>
+
+std::vector<WorkRange> PartitionWork(uint32_t itemCount, uint32_t maxRangeCount, uint32_t minItemsPerRange) {
+	std::vector<WorkRange> ranges;
+	if (itemCount == 0) {
+		return ranges;
+	}
+	const uint32_t rangeCount = (std::min)((std::max)(maxRangeCount, 1u), (std::max)(itemCount / (std::max)(minItemsPerRange, 1u), 1u));
+	// 割り切れない分は前の範囲に1つずつ足す
+	const uint32_t base = itemCount / rangeCount;
+	const uint32_t remainder = itemCount % rangeCount;
+	uint32_t begin = 0;
+	for (uint32_t range = 0; range < rangeCount; ++range) {
+		const uint32_t count = base + (range < remainder ? 1 : 0);
+		ranges.push_back({ begin, begin + count });
+		begin += count;
+	}
+	assert(begin == itemCount);
+	return ranges;
+}
+
+void ParallelCommandRecorder::Initialize(CommandListBackend* backend, JobSystem* jobSystem, uint32_t minItemsPerList) {
+	backend_ = backend;
+	jobSystem_ = jobSystem;
+	workerCount_ = (std::max)(jobSystem->GetWorkerCount(), 1u);
+	minItemsPerList_ = (std::max)(minItemsPerList, 1u);
+}
+
+uint32_t ParallelCommandRecorder::Begin(uint64_t completedFenceValue) {
+	assert(frameLists_.empty());
+	completedFenceValue_ = completedFenceValue;
+	stats_.commandListCount = 0;
+	stats_.parallelListCount = 0;
+	stats_.createdAllocatorCount = 0;
+	currentList_ = OpenList();
+	return currentList_;
+}
+
+void ParallelCommandRecorder::RecordParallel(uint32_t itemCount, const SetupFunction& setup, const RecordFunction& record) {
+	std::vector<WorkRange> ranges = PartitionWork(itemCount, workerCount_, minItemsPerList_);
+	if (ranges.size() <= 1) {
+		// 分けるほどの量が無いので今のリストに積む
+		if (itemCount > 0) {
+			record(currentList_, 0, itemCount);
+		}
+		return;
+	}
+
+	// リストとアロケーターは呼び出したスレッドで用意し、積むのだけを並列に行う
+	backend_->CloseCommandList(currentList_);
+	FrameVector<uint32_t> lists(ranges.size());
+	for (uint32_t range = 0; range < ranges.size(); ++range) {
+		lists[range] = OpenList();
+	}
+	JobCounter counter;
+	for (uint32_t range = 0; range < ranges.size(); ++range) {
+		jobSystem_->Run(counter, [&, range](uint32_t) {
+			setup(lists[range]);
+			record(lists[range], ranges[range].begin, ranges[range].end);
+		});
+	}
+	jobSystem_->Wait(counter);
+	for (uint32_t list : lists) {
+		backend_->CloseCommandList(list);
+	}
+	stats_.parallelListCount += uint32_t(lists.size());
+
+	// 続きは新しいリストに積む
+	currentList_ = OpenList();
+	setup(currentList_);
+}
+
+void ParallelCommandRecorder::Submit(uint64_t fenceValue) {
+	backend_->CloseCommandList(currentList_);
+	backend_->ExecuteCommandLists(frameLists_.data(), uint32_t(frameLists_.size()));
+	for (uint32_t allocator : frameAllocators_) {
+		allocators_[allocator].fenceValue = fenceValue;
+		allocators_[allocator].inUse = false;
+	}
+	stats_.commandListCount = uint32_t(frameLists_.size());
+	frameAllocators_.clear();
+	frameLists_.clear();
+}
+
+uint32_t ParallelCommandRecorder::AcquireAllocator() {
+	for (uint32_t allocator = 0; allocator < allocators_.size(); ++allocator) {
+		Allocator& entry = allocators_[allocator];
+		if (!entry.inUse && entry.fenceValue <= completedFenceValue_) {
+			backend_->ResetAllocator(allocator);
+			entry.inUse = true;
+			frameAllocators_.push_back(allocator);
+			return allocator;
+		}
+	}
+	const uint32_t allocator = uint32_t(allocators_.size());
+	backend_->CreateAllocator(allocator);
+	allocators_.push_back({ 0, true });
+	frameAllocators_.push_back(allocator);
+	stats_.allocatorCount = uint32_t(allocators_.size());
+	++stats_.createdAllocatorCount;
+	return allocator;
+}
+
+uint32_t ParallelCommandRecorder::OpenList() {
+	// リストはExecuteCommandListsに渡した後ならすぐに開き直せるので、フレームの中で何番目かをそのまま番号にする
+	const uint32_t list = uint32_t(frameLists_.size());
+	backend_->OpenCommandList(list, AcquireAllocator());
+	frameLists_.push_back(list);
+	return list;
+}
\ No newline at end of file
@@ -0,0 +1,96 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "JobSystem.h"
+
+/// <summary>
+/// 連続した番号の範囲 [begin, end)
+/// </summary>
+struct WorkRange {
+	uint32_t begin;
+	uint32_t end;
+};
+
+// itemCount個をmaxRangeCount個以下の連続した範囲にほぼ均等に分ける。1つの範囲はminItemsPerRange個以上にする(足りなければ1つにまとめる)
+std::vector<WorkRange> PartitionWork(uint32_t itemCount, uint32_t maxRangeCount, uint32_t minItemsPerRange);
+
+/// <summary>
+/// ParallelCommandRecorderがコマンドリストとアロケーターを扱うためのインターフェース
+/// リストとアロケーターは番号で指定し、実体は描画API側で持つ。テストでは呼び出しを記録するだけのものを使える
+/// </summary>
+class CommandListBackend {
+public:
+	virtual ~CommandListBackend() = default;
+	// allocator番目のアロケーターを新しく作る
+	virtual void CreateAllocator(uint32_t allocator) = 0;
+	// GPUが使い終わったアロケーターを使い回せるようにする
+	virtual void ResetAllocator(uint32_t allocator) = 0;
+	// list番目のコマンドリストをallocatorで開く。まだ無ければ作る
+	virtual void OpenCommandList(uint32_t list, uint32_t allocator) = 0;
+	virtual void CloseCommandList(uint32_t list) = 0;
+	// listsを並んだ順に1回で実行する
+	virtual void ExecuteCommandLists(const uint32_t* lists, uint32_t count) = 0;
+};
+
+/// <summary>
+/// ParallelCommandRecorderの1フレーム分の統計
+/// </summary>
+struct CommandRecorderStats {
+	uint32_t commandListCount; //!< 実行したコマンドリストの数
+	uint32_t parallelListCount; //!< そのうち他のスレッドで積んだものの数
+	uint32_t allocatorCount; //!< 作ったアロケーターの合計
+	uint32_t createdAllocatorCount; //!< このフレームで新しく作ったアロケーターの数
+};
+
+/// <summary>
+/// 描画をスレッドごとのコマンドリストに分けて積み、積んだ順に1回で実行する
+/// アロケーターはGPUが使い終わるまで使い回さない。描画APIには依存しない
+/// </summary>
+class ParallelCommandRecorder {
+public:
+	// list: 積むコマンドリストの番号、[begin, end): 積む項目の範囲
+	using RecordFunction = std::function<void(uint32_t list, uint32_t begin, uint32_t end)>;
+	// 新しく開いたリストに、描画先などリストをまたいで引き継がれない状態を設定する
+	using SetupFunction = std::function<void(uint32_t list)>;
+
+	// jobSystem: 積むのに使う。リストはワーカーの数まで分ける、minItemsPerList: 1つのリストに積む項目の最小数
+	void Initialize(CommandListBackend* backend, JobSystem* jobSystem, uint32_t minItemsPerList);
+
+	// フレームの最初に呼び、呼び出したスレッドで積むリストを開いてその番号を返す
+	// completedFenceValue: GPUが終えたFenceの値
+	uint32_t Begin(uint64_t completedFenceValue);
+	// 呼び出したスレッドで今積んでいるリスト
+	uint32_t GetCurrentList() const { return currentList_; }
+
+	// itemCount個をスレッドに分けて積む。今のリストを閉じてスレッドごとのリストを後ろに並べ、
+	// 続きを積む新しいリストを開く。1つのリストで足りる量なら今のリストにそのまま積む
+	void RecordParallel(uint32_t itemCount, const SetupFunction& setup, const RecordFunction& record);
+
+	// 全てのリストを閉じて順に実行する。fenceValue: この後Signalする値。GPUがここまで進めば今回のアロケーターを使い回す
+	void Submit(uint64_t fenceValue);
+
+	const CommandRecorderStats& GetStats() const { return stats_; }
+
+private:
+	struct Allocator {
+		uint64_t fenceValue; //!< この値までGPUが進めば使い回せる
+		bool inUse; //!< このフレームで使っている
+	};
+
+	// 使い回せるアロケーターを探し、無ければ作る
+	uint32_t AcquireAllocator();
+	// リストを開いてフレームの実行順に加える
+	uint32_t OpenList();
+
+	CommandListBackend* backend_ = nullptr;
+	JobSystem* jobSystem_ = nullptr;
+	uint32_t workerCount_ = 1;
+	uint32_t minItemsPerList_ = 1;
+	uint64_t completedFenceValue_ = 0;
+	std::vector<Allocator> allocators_;
+	std::vector<uint32_t> frameAllocators_; //!< このフレームで使っているアロケーター
+	std::vector<uint32_t> frameLists_; //!< このフレームで実行するリスト。実行順
+	uint32_t currentList_ = 0;
+	CommandRecorderStats stats_{};
+};
\ No newline at end of file
@@ -0,0 +1,143 @@
+#include "PipelineStateCache.h"
+#include <cassert>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include "Logger.h"
+#include "PipelineStateKey.h"
+#include "ShaderCache.h"
+
+void PipelineStateCache::Initialize(ID3D12Device* device, const std::wstring& libraryPath) {
+	device_ = device;
+	libraryPath_ = libraryPath;
+
+	// ID3D12PipelineLibraryはID3D12Device1から使える。使えない環境では重複排除だけ行う
+	if (FAILED(device_->QueryInterface(IID_PPV_ARGS(&device1_)))) {
+		device1_ = nullptr;
+		return;
+	}
+
+	std::ifstream file(std::filesystem::path(libraryPath_), std::ios::binary);
+	if (file.is_open()) {
+		libraryBlob_.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	}
+	HRESULT hr = E_FAIL;
+	if (!libraryBlob_.empty()) {
+		hr = device1_->CreatePipelineLibrary(libraryBlob_.data(), libraryBlob_.size(), IID_PPV_ARGS(&library_));
+		if (FAILED(hr)) {
+			// ドライバの更新などで読めなくなったライブラリは捨てて作り直す
+			LOG_WARNING(LogCategory::Graphics, "PipelineLibrary discarded, hr:{:#x}\n", uint32_t(hr));
+			libraryBlob_.clear();
+			libraryDirty_ = true;
+		}
+	}
+	if (FAILED(hr)) {
+		hr = device1_->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(&library_));
+		if (FAILED(hr)) {
+			library_ = nullptr;
+		}
+	}
+}
+
+void PipelineStateCache::Finalize() {
+	if (library_ != nullptr && libraryDirty_) {
+		std::vector<uint8_t> serialized(library_->GetSerializedSize());
+		if (!serialized.empty() && SUCCEEDED(library_->Serialize(serialized.data(), serialized.size()))) {
+			// 一時ファイルに書いてから置き換え、書き込み中に終了しても壊れたライブラリが残らないようにする
+			std::filesystem::path path = libraryPath_;
+			std::filesystem::path tempPath = path;
+			tempPath += L".tmp";
+			std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+			file.write(reinterpret_cast<const char*>(serialized.data()), std::streamsize(serialized.size()));
+			file.close();
+			if (file) {
+				std::error_code error;
+				std::filesystem::rename(tempPath, path, error);
+			}
+		}
+	}
+
+	for (auto& [key, chain] : entries_) {
+		for (Entry& entry : chain) {
+			if (entry.pipelineState) {
+				entry.pipelineState->Release();
+			}
+		}
+	}
+	entries_.clear();
+	rootSignatureHashes_.clear();
+	if (library_) {
+		library_->Release();
+		library_ = nullptr;
+	}
+	libraryBlob_.clear();
+	if (device1_) {
+		device1_->Release();
+		device1_ = nullptr;
+	}
+	libraryDirty_ = false;
+}
+
+void PipelineStateCache::RegisterRootSignature(ID3D12RootSignature* rootSignature, const void* blob, size_t size) {
+	std::lock_guard<std::mutex> lock(mutex_);
+	rootSignatureHashes_[rootSignature] = HashFnv1a(blob, size);
+}
+
+ID3D12PipelineState* PipelineStateCache::GetGraphicsPipelineState(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc) {
+	std::unique_lock<std::mutex> lock(mutex_);
+	++requestCount_;
+	auto rootSignature = rootSignatureHashes_.find(desc.pRootSignature);
+	// 登録されていないRootSignatureでは起動をまたいで同じキーにならない
+	assert(rootSignature != rootSignatureHashes_.end());
+	std::vector<uint8_t> keyBytes;
+	WriteGraphicsPipelineStateKey(desc, rootSignature->second, keyBytes);
+	const uint64_t key = HashFnv1a(keyBytes.data(), keyBytes.size());
+
+	// ハッシュが同じでも設定が違えば別のPSOにする。追加で配列が動くので添字で持つ
+	std::vector<Entry>& chain = entries_[key];
+	for (size_t index = 0; index < chain.size(); ++index) {
+		if (chain[index].keyBytes == keyBytes) {
+			condition_.wait(lock, [&] { return entries_[key][index].ready; });
+			++dedupeCount_;
+			return entries_[key][index].pipelineState;
+		}
+	}
+	const size_t index = chain.size();
+	if (index > 0) {
+		++collisionCount_;
+		LOG_WARNING(LogCategory::Graphics, "PipelineState hash collision, key:{:016x} index:{}\n", key, index);
+	}
+	chain.push_back({ std::move(keyBytes), nullptr, false });
+	lock.unlock();
+
+	// ライブラリの読み込みとドライバのコンパイルはロックの外で行う
+	const std::wstring name = index == 0 ? std::format(L"{:016x}", key) : std::format(L"{:016x}_{}", key, index);
+	ID3D12PipelineState* pipelineState = nullptr;
+	bool loaded = false;
+	if (library_ != nullptr) {
+		loaded = SUCCEEDED(library_->LoadGraphicsPipeline(name.c_str(), &desc, IID_PPV_ARGS(&pipelineState)));
+	}
+	bool stored = false;
+	if (!loaded) {
+		HRESULT hr = device_->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&pipelineState));
+		assert(SUCCEEDED(hr));
+		if (library_ != nullptr) {
+			// 同じ名前が既にある(ライブラリの中身と設定が食い違う)場合は失敗するが、そのときは保存しないだけ
+			stored = SUCCEEDED(library_->StorePipeline(name.c_str(), pipelineState));
+		}
+	}
+
+	lock.lock();
+	if (loaded) {
+		++libraryLoadCount_;
+	} else {
+		++createCount_;
+	}
+	libraryDirty_ = libraryDirty_ || stored;
+	Entry& entry = entries_[key][index];
+	entry.pipelineState = pipelineState;
+	entry.ready = true;
+	condition_.notify_all();
+	return pipelineState;
+}
\ No newline at end of file
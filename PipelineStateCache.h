@@ -0,0 +1,60 @@
+#pragma once
+#include <d3d12.h>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// <summary>
+/// PSOを正規化した設定で重複排除して使い回す。ハッシュで探し、正規化したバイト列が一致したものだけを使う。
+/// 作ったPSOはID3D12PipelineLibraryに入れ、終了時にファイルへ書き出して次の起動で読み込む
+/// </summary>
+class PipelineStateCache {
+public:
+	// libraryPathからライブラリを読む。無い、壊れている、ドライバやGPUが変わった場合は空から作り直す
+	void Initialize(ID3D12Device* device, const std::wstring& libraryPath);
+	// 新しいPSOがあればライブラリを書き出し、全てのPSOを解放する
+	void Finalize();
+
+	// RootSignatureをシリアライズしたデータから識別値を作って登録する。ポインタと違い起動をまたいでも同じになる
+	void RegisterRootSignature(ID3D12RootSignature* rootSignature, const void* blob, size_t size);
+
+	// 同じ設定なら同じPSOを返す。戻り値はキャッシュが持っているので解放しないこと
+	// 複数スレッドから呼んでよい。同じ設定を同時に要求した場合は1つだけ作って残りは待つ
+	ID3D12PipelineState* GetGraphicsPipelineState(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc);
+
+	uint32_t GetRequestCount() const { return requestCount_; }
+	uint32_t GetDedupeCount() const { return dedupeCount_; } //!< 作成済みのPSOを返した数
+	uint32_t GetLibraryLoadCount() const { return libraryLoadCount_; } //!< ライブラリから読めた数
+	uint32_t GetCreateCount() const { return createCount_; } //!< ドライバでコンパイルした数
+	uint32_t GetCollisionCount() const { return collisionCount_; } //!< ハッシュが同じで設定が違った数
+
+private:
+	struct Entry {
+		std::vector<uint8_t> keyBytes; //!< WriteGraphicsPipelineStateKeyのバイト列
+		ID3D12PipelineState* pipelineState;
+		bool ready; //!< falseの間は他のスレッドが作っている
+	};
+
+	ID3D12Device* device_ = nullptr;
+	ID3D12Device1* device1_ = nullptr;
+	ID3D12PipelineLibrary* library_ = nullptr;
+	// CreatePipelineLibraryに渡したデータ。ライブラリを解放するまで残しておく必要がある
+	std::vector<uint8_t> libraryBlob_;
+	std::wstring libraryPath_;
+	bool libraryDirty_ = false;
+
+	std::mutex mutex_;
+	std::condition_variable condition_;
+	// ハッシュごとに、設定が違うものを作った順に持つ。ライブラリでの名前は2つ目から添字を付ける
+	std::unordered_map<uint64_t, std::vector<Entry>> entries_;
+	std::unordered_map<ID3D12RootSignature*, uint64_t> rootSignatureHashes_;
+
+	uint32_t requestCount_ = 0;
+	uint32_t dedupeCount_ = 0;
+	uint32_t libraryLoadCount_ = 0;
+	uint32_t createCount_ = 0;
+	uint32_t collisionCount_ = 0;
+};
\ No newline at end of file
@@ -0,0 +1,243 @@
+#include "PipelineStateKey.h"
+#include <cassert>
+#include <cctype>
+#include <cstring>
+#include <type_traits>
+#include "ShaderCache.h"
+
+namespace {
+	/// <summary>
+	/// 値を1つずつバイト列の後ろに足す。構造体を丸ごと足すとパディングが入るので使わない
+	/// </summary>
+	struct PipelineHasher {
+		std::vector<uint8_t>& bytes;
+
+		template<typename T>
+		void Add(const T& value) {
+			static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>);
+			const size_t offset = bytes.size();
+			bytes.resize(offset + sizeof(value));
+			std::memcpy(bytes.data() + offset, &value, sizeof(value));
+		}
+
+		void AddBytes(const void* data, size_t size) {
+			Add(uint64_t(size));
+			if (size > 0) {
+				const uint8_t* begin = static_cast<const uint8_t*>(data);
+				bytes.insert(bytes.end(), begin, begin + size);
+			}
+		}
+
+		// セマンティクス名は大文字小文字を区別しないので大文字にそろえる
+		void AddSemanticName(const char* name) {
+			if (name == nullptr) {
+				Add(uint8_t(0));
+				return;
+			}
+			for (const char* c = name; *c != '\0'; ++c) {
+				Add(char(std::toupper(static_cast<unsigned char>(*c))));
+			}
+			Add(uint8_t(0));
+		}
+
+		void AddShader(const D3D12_SHADER_BYTECODE& shader) {
+			AddBytes(shader.pShaderBytecode, shader.pShaderBytecode ? shader.BytecodeLength : 0);
+		}
+	};
+
+	void AddBlend(PipelineHasher& hasher, const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc) {
+		const D3D12_BLEND_DESC& blend = desc.BlendState;
+		hasher.Add(blend.AlphaToCoverageEnable != 0);
+		// IndependentBlendEnableがfalseならRenderTarget[0]が全てのRTに使われる
+		const bool independent = blend.IndependentBlendEnable != 0 && desc.NumRenderTargets > 1;
+		hasher.Add(independent);
+		const uint32_t count = independent ? desc.NumRenderTargets : 1;
+		for (uint32_t index = 0; index < count; ++index) {
+			const D3D12_RENDER_TARGET_BLEND_DESC& target = blend.RenderTarget[index];
+			hasher.Add(target.BlendEnable != 0);
+			if (target.BlendEnable) {
+				hasher.Add(target.SrcBlend);
+				hasher.Add(target.DestBlend);
+				hasher.Add(target.BlendOp);
+				hasher.Add(target.SrcBlendAlpha);
+				hasher.Add(target.DestBlendAlpha);
+				hasher.Add(target.BlendOpAlpha);
+			}
+			hasher.Add(target.LogicOpEnable != 0);
+			if (target.LogicOpEnable) {
+				hasher.Add(target.LogicOp);
+			}
+			hasher.Add(target.RenderTargetWriteMask);
+		}
+	}
+
+	void AddRasterizer(PipelineHasher& hasher, const D3D12_RASTERIZER_DESC& rasterizer) {
+		hasher.Add(rasterizer.FillMode);
+		hasher.Add(rasterizer.CullMode);
+		hasher.Add(rasterizer.FrontCounterClockwise != 0);
+		hasher.Add(rasterizer.DepthBias);
+		hasher.Add(rasterizer.DepthBiasClamp);
+		hasher.Add(rasterizer.SlopeScaledDepthBias);
+		hasher.Add(rasterizer.DepthClipEnable != 0);
+		hasher.Add(rasterizer.MultisampleEnable != 0);
+		hasher.Add(rasterizer.AntialiasedLineEnable != 0);
+		hasher.Add(rasterizer.ForcedSampleCount);
+		hasher.Add(rasterizer.ConservativeRaster);
+	}
+
+	void AddStencilOp(PipelineHasher& hasher, const D3D12_DEPTH_STENCILOP_DESC& op) {
+		hasher.Add(op.StencilFailOp);
+		hasher.Add(op.StencilDepthFailOp);
+		hasher.Add(op.StencilPassOp);
+		hasher.Add(op.StencilFunc);
+	}
+
+	void AddDepthStencil(PipelineHasher& hasher, const D3D12_DEPTH_STENCIL_DESC& depthStencil) {
+		hasher.Add(depthStencil.DepthEnable != 0);
+		if (depthStencil.DepthEnable) {
+			hasher.Add(depthStencil.DepthWriteMask);
+			hasher.Add(depthStencil.DepthFunc);
+		}
+		hasher.Add(depthStencil.StencilEnable != 0);
+		if (depthStencil.StencilEnable) {
+			hasher.Add(depthStencil.StencilReadMask);
+			hasher.Add(depthStencil.StencilWriteMask);
+			AddStencilOp(hasher, depthStencil.FrontFace);
+			AddStencilOp(hasher, depthStencil.BackFace);
+		}
+	}
+
+	void AddInputLayout(PipelineHasher& hasher, const D3D12_INPUT_LAYOUT_DESC& inputLayout) {
+		// スロットごとに次の要素のオフセットを追う
+		const uint32_t kMaxInputSlot = 32;
+		uint32_t slotOffsets[kMaxInputSlot] = {};
+		hasher.Add(inputLayout.NumElements);
+		for (uint32_t index = 0; index < inputLayout.NumElements; ++index) {
+			const D3D12_INPUT_ELEMENT_DESC& element = inputLayout.pInputElementDescs[index];
+			uint32_t offset = element.AlignedByteOffset;
+			if (element.InputSlot < kMaxInputSlot) {
+				if (offset == D3D12_APPEND_ALIGNED_ELEMENT) {
+					offset = slotOffsets[element.InputSlot];
+				}
+				const uint32_t size = GetFormatByteSize(element.Format);
+				// サイズが分からない形式の後ろはAPPENDを解決できないので、元の値のまま混ぜる
+				slotOffsets[element.InputSlot] = size > 0 ? offset + size : D3D12_APPEND_ALIGNED_ELEMENT;
+			}
+			hasher.AddSemanticName(element.SemanticName);
+			hasher.Add(element.SemanticIndex);
+			hasher.Add(element.Format);
+			hasher.Add(element.InputSlot);
+			hasher.Add(offset);
+			hasher.Add(element.InputSlotClass);
+			hasher.Add(element.InstanceDataStepRate);
+		}
+	}
+
+	void AddStreamOutput(PipelineHasher& hasher, const D3D12_STREAM_OUTPUT_DESC& streamOutput) {
+		hasher.Add(streamOutput.NumEntries);
+		for (uint32_t index = 0; index < streamOutput.NumEntries; ++index) {
+			const D3D12_SO_DECLARATION_ENTRY& entry = streamOutput.pSODeclaration[index];
+			hasher.Add(entry.Stream);
+			hasher.AddSemanticName(entry.SemanticName);
+			hasher.Add(entry.SemanticIndex);
+			hasher.Add(entry.StartComponent);
+			hasher.Add(entry.ComponentCount);
+			hasher.Add(entry.OutputSlot);
+		}
+		if (streamOutput.NumEntries > 0) {
+			hasher.Add(streamOutput.NumStrides);
+			for (uint32_t index = 0; index < streamOutput.NumStrides; ++index) {
+				hasher.Add(streamOutput.pBufferStrides[index]);
+			}
+			hasher.Add(streamOutput.RasterizedStream);
+		}
+	}
+}
+
+uint32_t GetFormatByteSize(DXGI_FORMAT format) {
+	switch (format) {
+	case DXGI_FORMAT_R32G32B32A32_FLOAT:
+	case DXGI_FORMAT_R32G32B32A32_UINT:
+	case DXGI_FORMAT_R32G32B32A32_SINT:
+		return 16;
+	case DXGI_FORMAT_R32G32B32_FLOAT:
+	case DXGI_FORMAT_R32G32B32_UINT:
+	case DXGI_FORMAT_R32G32B32_SINT:
+		return 12;
+	case DXGI_FORMAT_R32G32_FLOAT:
+	case DXGI_FORMAT_R32G32_UINT:
+	case DXGI_FORMAT_R32G32_SINT:
+	case DXGI_FORMAT_R16G16B16A16_FLOAT:
+	case DXGI_FORMAT_R16G16B16A16_UNORM:
+	case DXGI_FORMAT_R16G16B16A16_SNORM:
+	case DXGI_FORMAT_R16G16B16A16_UINT:
+	case DXGI_FORMAT_R16G16B16A16_SINT:
+		return 8;
+	case DXGI_FORMAT_R32_FLOAT:
+	case DXGI_FORMAT_R32_UINT:
+	case DXGI_FORMAT_R32_SINT:
+	case DXGI_FORMAT_R16G16_FLOAT:
+	case DXGI_FORMAT_R16G16_UNORM:
+	case DXGI_FORMAT_R16G16_SNORM:
+	case DXGI_FORMAT_R16G16_UINT:
+	case DXGI_FORMAT_R16G16_SINT:
+	case DXGI_FORMAT_R8G8B8A8_UNORM:
+	case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+	case DXGI_FORMAT_R8G8B8A8_SNORM:
+	case DXGI_FORMAT_R8G8B8A8_UINT:
+	case DXGI_FORMAT_R8G8B8A8_SINT:
+	case DXGI_FORMAT_B8G8R8A8_UNORM:
+	case DXGI_FORMAT_R10G10B10A2_UNORM:
+	case DXGI_FORMAT_R10G10B10A2_UINT:
+	case DXGI_FORMAT_R11G11B10_FLOAT:
+		return 4;
+	case DXGI_FORMAT_R16_FLOAT:
+	case DXGI_FORMAT_R16_UNORM:
+	case DXGI_FORMAT_R16_UINT:
+	case DXGI_FORMAT_R16_SINT:
+	case DXGI_FORMAT_R8G8_UNORM:
+	case DXGI_FORMAT_R8G8_UINT:
+		return 2;
+	case DXGI_FORMAT_R8_UNORM:
+	case DXGI_FORMAT_R8_UINT:
+		return 1;
+	default:
+		// 頂点の形式を足したらここにも足す。0のままだと後ろのAPPENDを解決できない
+		assert(false);
+		return 0;
+	}
+}
+
+void WriteGraphicsPipelineStateKey(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureHash, std::vector<uint8_t>& bytes) {
+	bytes.clear();
+	PipelineHasher hasher{ bytes };
+	hasher.Add(rootSignatureHash);
+	hasher.AddShader(desc.VS);
+	hasher.AddShader(desc.PS);
+	hasher.AddShader(desc.DS);
+	hasher.AddShader(desc.HS);
+	hasher.AddShader(desc.GS);
+	AddStreamOutput(hasher, desc.StreamOutput);
+	AddBlend(hasher, desc);
+	hasher.Add(desc.SampleMask);
+	AddRasterizer(hasher, desc.RasterizerState);
+	AddDepthStencil(hasher, desc.DepthStencilState);
+	AddInputLayout(hasher, desc.InputLayout);
+	hasher.Add(desc.IBStripCutValue);
+	hasher.Add(desc.PrimitiveTopologyType);
+	hasher.Add(desc.NumRenderTargets);
+	for (uint32_t index = 0; index < desc.NumRenderTargets && index < 8; ++index) {
+		hasher.Add(desc.RTVFormats[index]);
+	}
+	hasher.Add(desc.DSVFormat);
+	hasher.Add(desc.SampleDesc.Count);
+	hasher.Add(desc.SampleDesc.Quality);
+	hasher.Add(desc.NodeMask);
+	hasher.Add(desc.Flags);
+}
+
+uint64_t HashGraphicsPipelineStateDesc(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureHash) {
+	std::vector<uint8_t> bytes;
+	WriteGraphicsPipelineStateKey(desc, rootSignatureHash, bytes);
+	return HashFnv1a(bytes.data(), bytes.size());
+}
\ No newline at end of file
@@ -0,0 +1,19 @@
+#pragma once
+#include <d3d12.h>
+#include <cstdint>
+#include <vector>
+
+// DXGI_FORMATの1要素のバイト数。InputLayoutのD3D12_APPEND_ALIGNED_ELEMENTを解決するのに使う
+// 頂点に使わない形式や知らない形式はassertする。Releaseでは0
+uint32_t GetFormatByteSize(DXGI_FORMAT format);
+
+// PSOの設定を正規化したバイト列をbytesに書く。バイト列が同じならPSOを使い回せる
+// 正規化の規則はHashGraphicsPipelineStateDescと同じ
+void WriteGraphicsPipelineStateKey(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureHash, std::vector<uint8_t>& bytes);
+
+// PSOの設定を正規化してハッシュにする。WriteGraphicsPipelineStateKeyのバイト列のFNV-1a
+// ・シェーダーはポインタではなく中身を見る
+// ・InputLayoutのD3D12_APPEND_ALIGNED_ELEMENTは実際のオフセットに直す。セマンティクス名は大文字小文字を区別しない
+// ・無効になっている機能の設定(BlendEnableがfalseのときのブレンド係数など)と、使わないRTの設定は無視する
+// ・pRootSignatureとCachedPSOは見ない。RootSignatureはrootSignatureHashで区別する
+uint64_t HashGraphicsPipelineStateDesc(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureHash);
\ No newline at end of file
@@ -0,0 +1,297 @@
+#include "PrimitiveMesh.h"
+#define _USE_MATH_DEFINES
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace {
+	/// <summary>
+	/// start + step * i (i = 0..count-1) のsin/cosを前計算したもの
+	/// </summary>
+	struct SinCosTable {
+		std::vector<float> sin;
+		std::vector<float> cos;
+	};
+
+	SinCosTable MakeSinCosTable(uint32_t count, float start, float step) {
+		SinCosTable table;
+		table.sin.resize(count);
+		table.cos.resize(count);
+		for (uint32_t i = 0; i < count; ++i) {
+			float angle = start + step * float(i);
+			table.sin[i] = std::sin(angle);
+			table.cos[i] = std::cos(angle);
+		}
+		// 最後の点は最初の点と一致させ、継ぎ目に隙間ができないようにする
+		if (count > 1 && std::abs(step * float(count - 1) - 2.0f * float(M_PI)) < 1e-4f) {
+			table.sin[count - 1] = table.sin[0];
+			table.cos[count - 1] = table.cos[0];
+		}
+		return table;
+	}
+
+	/// <summary>
+	/// 頂点とインデックスを先頭から順に書き込む
+	/// </summary>
+	struct MeshWriter {
+		VertexData* vertices;
+		uint32_t* indices;
+		uint32_t vertexCount = 0;
+		uint32_t indexCount = 0;
+
+		void Vertex(float x, float y, float z, float u, float v, float nx, float ny, float nz) {
+			vertices[vertexCount++] = { { x,y,z,1.0f },{ u,v },{ nx,ny,nz } };
+		}
+
+		// (columns+1) x (rows+1) の格子状の頂点をbaseから並べたものに三角形を張る
+		// 表から見てcolumn方向が右、row方向が上になるように頂点を並べておくこと
+		void Grid(uint32_t base, uint32_t columns, uint32_t rows) {
+			const uint32_t stride = columns + 1;
+			for (uint32_t row = 0; row < rows; ++row) {
+				for (uint32_t column = 0; column < columns; ++column) {
+					uint32_t a = base + row * stride + column;
+					uint32_t b = a + stride;
+					uint32_t c = a + 1;
+					uint32_t d = b + 1;
+					indices[indexCount++] = a;
+					indices[indexCount++] = b;
+					indices[indexCount++] = c;
+					indices[indexCount++] = c;
+					indices[indexCount++] = b;
+					indices[indexCount++] = d;
+				}
+			}
+		}
+	};
+
+	void WriteSphere(uint32_t subdivision, MeshWriter& writer) {
+		const float kPi = float(M_PI);
+		// 緯度 -π/2 ~ π/2 と 経度 0 ~ 2π をそれぞれ(分割数+1)点だけ計算しておく
+		SinCosTable lat = MakeSinCosTable(subdivision + 1, -kPi / 2.0f, kPi / float(subdivision));
+		SinCosTable lon = MakeSinCosTable(subdivision + 1, 0.0f, 2.0f * kPi / float(subdivision));
+		for (uint32_t latIndex = 0; latIndex <= subdivision; ++latIndex) {
+			// 極の頂点は全て同じ位置なので、uは接する三角形の真ん中にする
+			const bool pole = latIndex == 0 || latIndex == subdivision;
+			for (uint32_t lonIndex = 0; lonIndex <= subdivision; ++lonIndex) {
+				float x = pole ? 0.0f : lat.cos[latIndex] * lon.cos[lonIndex];
+				float y = pole ? (latIndex == 0 ? -1.0f : 1.0f) : lat.sin[latIndex];
+				float z = pole ? 0.0f : lat.cos[latIndex] * lon.sin[lonIndex];
+				float u = (float(lonIndex) + (pole ? 0.5f : 0.0f)) / float(subdivision);
+				writer.Vertex(x, y, z,
+					u, 1.0f - float(latIndex) / float(subdivision),
+					x, y, z);
+			}
+		}
+		// 極に接する行は格子の片方の三角形が潰れるので、1区間に1つだけ張る
+		const uint32_t stride = subdivision + 1;
+		for (uint32_t row = 0; row < subdivision; ++row) {
+			for (uint32_t column = 0; column < subdivision; ++column) {
+				uint32_t a = row * stride + column;
+				uint32_t b = a + stride;
+				uint32_t c = a + 1;
+				uint32_t d = b + 1;
+				if (row != 0) {
+					writer.indices[writer.indexCount++] = a;
+					writer.indices[writer.indexCount++] = b;
+					writer.indices[writer.indexCount++] = c;
+				}
+				if (row != subdivision - 1) {
+					writer.indices[writer.indexCount++] = c;
+					writer.indices[writer.indexCount++] = b;
+					writer.indices[writer.indexCount++] = d;
+				}
+			}
+		}
+	}
+
+	// originからright方向、up方向に広がる平面を書き込む
+	void WriteFace(uint32_t subdivision, const Vector3& origin, const Vector3& right, const Vector3& up, const Vector3& normal, MeshWriter& writer) {
+		uint32_t base = writer.vertexCount;
+		for (uint32_t row = 0; row <= subdivision; ++row) {
+			float v = float(row) / float(subdivision);
+			for (uint32_t column = 0; column <= subdivision; ++column) {
+				float u = float(column) / float(subdivision);
+				writer.Vertex(
+					origin.x + right.x * u + up.x * v,
+					origin.y + right.y * u + up.y * v,
+					origin.z + right.z * u + up.z * v,
+					u, 1.0f - v,
+					normal.x, normal.y, normal.z);
+			}
+		}
+		writer.Grid(base, subdivision, subdivision);
+	}
+
+	void WriteCube(uint32_t subdivision, MeshWriter& writer) {
+		// 各面を外側から見て、right x up が内向き(左手系で時計回りが表)になるように並べる
+		WriteFace(subdivision, { -1.0f,-1.0f,-1.0f }, { 2.0f,0.0f,0.0f }, { 0.0f,2.0f,0.0f }, { 0.0f,0.0f,-1.0f }, writer); // 前(-Z)
+		WriteFace(subdivision, { 1.0f,-1.0f,1.0f }, { -2.0f,0.0f,0.0f }, { 0.0f,2.0f,0.0f }, { 0.0f,0.0f,1.0f }, writer); // 後(+Z)
+		WriteFace(subdivision, { 1.0f,-1.0f,-1.0f }, { 0.0f,0.0f,2.0f }, { 0.0f,2.0f,0.0f }, { 1.0f,0.0f,0.0f }, writer); // 右(+X)
+		WriteFace(subdivision, { -1.0f,-1.0f,1.0f }, { 0.0f,0.0f,-2.0f }, { 0.0f,2.0f,0.0f }, { -1.0f,0.0f,0.0f }, writer); // 左(-X)
+		WriteFace(subdivision, { -1.0f,1.0f,-1.0f }, { 2.0f,0.0f,0.0f }, { 0.0f,0.0f,2.0f }, { 0.0f,1.0f,0.0f }, writer); // 上(+Y)
+		WriteFace(subdivision, { -1.0f,-1.0f,1.0f }, { 2.0f,0.0f,0.0f }, { 0.0f,0.0f,-2.0f }, { 0.0f,-1.0f,0.0f }, writer); // 下(-Y)
+	}
+
+	void WritePlane(uint32_t subdivision, MeshWriter& writer) {
+		WriteFace(subdivision, { -1.0f,0.0f,-1.0f }, { 2.0f,0.0f,0.0f }, { 0.0f,0.0f,2.0f }, { 0.0f,1.0f,0.0f }, writer);
+	}
+
+	void WriteCylinder(uint32_t subdivision, MeshWriter& writer) {
+		SinCosTable lon = MakeSinCosTable(subdivision + 1, 0.0f, 2.0f * float(M_PI) / float(subdivision));
+		// 側面。下の輪 -> 上の輪の順に並べる
+		for (uint32_t row = 0; row <= 1; ++row) {
+			float y = row == 0 ? -1.0f : 1.0f;
+			for (uint32_t lonIndex = 0; lonIndex <= subdivision; ++lonIndex) {
+				writer.Vertex(lon.cos[lonIndex], y, lon.sin[lonIndex],
+					float(lonIndex) / float(subdivision), 1.0f - float(row),
+					lon.cos[lonIndex], 0.0f, lon.sin[lonIndex]);
+			}
+		}
+		writer.Grid(0, subdivision, 1);
+
+		// 上下の蓋。中心点から扇状に張る
+		for (uint32_t cap = 0; cap < 2; ++cap) {
+			float y = cap == 0 ? 1.0f : -1.0f;
+			uint32_t center = writer.vertexCount;
+			writer.Vertex(0.0f, y, 0.0f, 0.5f, 0.5f, 0.0f, y, 0.0f);
+			for (uint32_t lonIndex = 0; lonIndex <= subdivision; ++lonIndex) {
+				writer.Vertex(lon.cos[lonIndex], y, lon.sin[lonIndex],
+					0.5f + lon.cos[lonIndex] * 0.5f, 0.5f - lon.sin[lonIndex] * 0.5f,
+					0.0f, y, 0.0f);
+			}
+			for (uint32_t lonIndex = 0; lonIndex < subdivision; ++lonIndex) {
+				uint32_t current = center + 1 + lonIndex;
+				writer.indices[writer.indexCount++] = center;
+				// 上から見ると角度が増える向きは反時計回りなので、上の蓋は逆順に張る
+				writer.indices[writer.indexCount++] = cap == 0 ? current + 1 : current;
+				writer.indices[writer.indexCount++] = cap == 0 ? current : current + 1;
+			}
+		}
+	}
+
+	void WriteTorus(uint32_t subdivision, float innerRadius, MeshWriter& writer) {
+		const float kOuterRadius = 1.0f;
+		SinCosTable major = MakeSinCosTable(subdivision + 1, 0.0f, 2.0f * float(M_PI) / float(subdivision));
+		SinCosTable minor = MakeSinCosTable(subdivision + 1, 0.0f, 2.0f * float(M_PI) / float(subdivision));
+		// 管の周方向を行、円環の周方向を列にする
+		for (uint32_t minorIndex = 0; minorIndex <= subdivision; ++minorIndex) {
+			for (uint32_t majorIndex = 0; majorIndex <= subdivision; ++majorIndex) {
+				float nx = minor.cos[minorIndex] * major.cos[majorIndex];
+				float ny = minor.sin[minorIndex];
+				float nz = minor.cos[minorIndex] * major.sin[majorIndex];
+				float ring = kOuterRadius + innerRadius * minor.cos[minorIndex];
+				writer.Vertex(ring * major.cos[majorIndex], innerRadius * ny, ring * major.sin[majorIndex],
+					float(majorIndex) / float(subdivision), 1.0f - float(minorIndex) / float(subdivision),
+					nx, ny, nz);
+			}
+		}
+		writer.Grid(0, subdivision, subdivision);
+	}
+}
+
+uint32_t GetPrimitiveVertexCount(const PrimitiveDesc& desc) {
+	const uint32_t gridVertexCount = (desc.subdivision + 1) * (desc.subdivision + 1);
+	switch (desc.type) {
+	case PrimitiveType::Sphere:
+	case PrimitiveType::Plane:
+	case PrimitiveType::Torus:
+		return gridVertexCount;
+	case PrimitiveType::Cube:
+		return gridVertexCount * 6;
+	case PrimitiveType::Cylinder:
+		return (desc.subdivision + 1) * 2 + (desc.subdivision + 2) * 2;
+	default:
+		assert(false);
+		return 0;
+	}
+}
+
+uint32_t GetPrimitiveIndexCount(const PrimitiveDesc& desc) {
+	const uint32_t gridIndexCount = desc.subdivision * desc.subdivision * 6;
+	switch (desc.type) {
+	case PrimitiveType::Sphere:
+		// 南北の極に接する行は1区間に三角形1つ
+		return gridIndexCount - desc.subdivision * 3 * 2;
+	case PrimitiveType::Plane:
+	case PrimitiveType::Torus:
+		return gridIndexCount;
+	case PrimitiveType::Cube:
+		return gridIndexCount * 6;
+	case PrimitiveType::Cylinder:
+		return desc.subdivision * 6 + desc.subdivision * 3 * 2;
+	default:
+		assert(false);
+		return 0;
+	}
+}
+
+void WritePrimitive(const PrimitiveDesc& desc, VertexData* vertices, uint32_t* indices) {
+	assert(desc.subdivision > 0);
+	// 分割数1の球は極どうしを結ぶだけで面が無い
+	assert(desc.type != PrimitiveType::Sphere || desc.subdivision >= 2);
+	MeshWriter writer{ vertices, indices };
+	switch (desc.type) {
+	case PrimitiveType::Sphere:
+		WriteSphere(desc.subdivision, writer);
+		break;
+	case PrimitiveType::Cube:
+		WriteCube(desc.subdivision, writer);
+		break;
+	case PrimitiveType::Plane:
+		WritePlane(desc.subdivision, writer);
+		break;
+	case PrimitiveType::Cylinder:
+		WriteCylinder(desc.subdivision, writer);
+		break;
+	case PrimitiveType::Torus:
+		WriteTorus(desc.subdivision, desc.innerRadius, writer);
+		break;
+	default:
+		assert(false);
+		break;
+	}
+	assert(writer.vertexCount == GetPrimitiveVertexCount(desc));
+	assert(writer.indexCount == GetPrimitiveIndexCount(desc));
+}
+
+MeshBounds GetPrimitiveBounds(const PrimitiveDesc& desc) {
+	MeshBounds bounds{};
+	switch (desc.type) {
+	case PrimitiveType::Sphere:
+		bounds.aabb = { { -1.0f,-1.0f,-1.0f },{ 1.0f,1.0f,1.0f } };
+		bounds.sphere = { { 0.0f,0.0f,0.0f }, 1.0f };
+		break;
+	case PrimitiveType::Cube:
+		bounds.aabb = { { -1.0f,-1.0f,-1.0f },{ 1.0f,1.0f,1.0f } };
+		bounds.sphere = { { 0.0f,0.0f,0.0f }, std::sqrt(3.0f) };
+		break;
+	case PrimitiveType::Cylinder:
+		// 球は上下の縁の円までの距離
+		bounds.aabb = { { -1.0f,-1.0f,-1.0f },{ 1.0f,1.0f,1.0f } };
+		bounds.sphere = { { 0.0f,0.0f,0.0f }, std::sqrt(2.0f) };
+		break;
+	case PrimitiveType::Plane:
+		bounds.aabb = { { -1.0f,0.0f,-1.0f },{ 1.0f,0.0f,1.0f } };
+		bounds.sphere = { { 0.0f,0.0f,0.0f }, std::sqrt(2.0f) };
+		break;
+	case PrimitiveType::Torus: {
+		const float outer = 1.0f + desc.innerRadius;
+		bounds.aabb = { { -outer,-desc.innerRadius,-outer },{ outer,desc.innerRadius,outer } };
+		bounds.sphere = { { 0.0f,0.0f,0.0f }, outer };
+		break;
+	}
+	default:
+		assert(false);
+		break;
+	}
+	return bounds;
+}
+
+uint64_t GetPrimitiveKey(const PrimitiveDesc& desc) {
+	uint32_t radiusBits = 0;
+	if (desc.type == PrimitiveType::Torus) {
+		std::memcpy(&radiusBits, &desc.innerRadius, sizeof(radiusBits));
+	}
+	return (uint64_t(desc.type) << 56) | (uint64_t(desc.subdivision & 0xFFFFFF) << 32) | radiusBits;
+}
\ No newline at end of file
@@ -0,0 +1,39 @@
+#pragma once
+#include <cstdint>
+#include "Bounds.h"
+#include "VertexData.h"
+
+/// <summary>
+/// 生成できる形状の種類
+/// </summary>
+enum class PrimitiveType : uint32_t {
+	Sphere, //!< 半径1の球
+	Cube, //!< 一辺2の立方体
+	Plane, //!< XZ平面上の一辺2の正方形。+Yを向く
+	Cylinder, //!< 半径1、高さ2の円柱
+	Torus, //!< 中心半径1の円環
+	Count,
+};
+
+/// <summary>
+/// 生成する形状の設定
+/// </summary>
+struct PrimitiveDesc {
+	PrimitiveType type;
+	uint32_t subdivision; //!< 分割数。Sphereは2以上
+	float innerRadius; //!< Torusの管の半径
+};
+
+// 生成に必要な頂点数とインデックス数
+uint32_t GetPrimitiveVertexCount(const PrimitiveDesc& desc);
+uint32_t GetPrimitiveIndexCount(const PrimitiveDesc& desc);
+
+// 頂点とインデックスをそのまま書き込む。UploadHeapをMapしたアドレスを渡してよい
+// 三角形は表面から見て時計回り(PSOのCULL_MODE_BACKで表が残る向き)
+void WritePrimitive(const PrimitiveDesc& desc, VertexData* vertices, uint32_t* indices);
+
+// 頂点を書き込まずに、生成される形状のローカル座標での境界を求める
+MeshBounds GetPrimitiveBounds(const PrimitiveDesc& desc);
+
+// キャッシュのキーに使う値
+uint64_t GetPrimitiveKey(const PrimitiveDesc& desc);
\ No newline at end of file
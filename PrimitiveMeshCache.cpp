@@ -0,0 +1,108 @@
+#include "PrimitiveMeshCache.h"
+#include <algorithm>
+#include <cassert>
+
+void PrimitiveMeshCache::Initialize(RenderDevice* device, DeviceRenderQueueExecutor* executor, uint32_t maxMeshCount) {
+	device_ = device;
+	executor_ = executor;
+	maxMeshCount_ = (std::max)(maxMeshCount, 1u);
+}
+
+void PrimitiveMeshCache::Finalize() {
+	// GPUの完了を待ってから呼ぶ
+	for (auto& [key, entry] : entries_) {
+		device_->DestroyBuffer(entry.vertexBuffer);
+		device_->DestroyBuffer(entry.indexBuffer);
+	}
+	for (const Retired& retired : retired_) {
+		device_->DestroyBuffer(retired.vertexBuffer);
+		device_->DestroyBuffer(retired.indexBuffer);
+	}
+	entries_.clear();
+	lru_.clear();
+	retired_.clear();
+	freeMeshes_.clear();
+}
+
+void PrimitiveMeshCache::Update(uint64_t completedFenceValue, uint64_t submittedFenceValue) {
+	frameFenceValue_ = submittedFenceValue + 1;
+	auto released = std::remove_if(retired_.begin(), retired_.end(), [&](const Retired& retired) {
+		if (retired.fenceValue <= completedFenceValue) {
+			device_->DestroyBuffer(retired.vertexBuffer);
+			device_->DestroyBuffer(retired.indexBuffer);
+			// 積んだ描画も終わっているので、番号を別の形状に使える
+			freeMeshes_.push_back(retired.mesh);
+			return true;
+		}
+		return false;
+	});
+	retired_.erase(released, retired_.end());
+	// 前のフレームで超えた分を外す
+	EvictUnused();
+}
+
+void PrimitiveMeshCache::EvictUnused() {
+	while (entries_.size() > maxMeshCount_ && !lru_.empty()) {
+		auto it = entries_.find(lru_.back());
+		assert(it != entries_.end());
+		Entry& entry = it->second;
+		// このフレームで使ったものは既にRenderQueueに積まれているので外さない
+		if (entry.lastUsedFenceValue >= frameFenceValue_) {
+			break;
+		}
+		retired_.push_back({ entry.vertexBuffer, entry.indexBuffer, entry.mesh, entry.lastUsedFenceValue });
+		lru_.pop_back();
+		entries_.erase(it);
+		++evictedCount_;
+	}
+}
+
+uint32_t PrimitiveMeshCache::GetMesh(const PrimitiveDesc& desc) {
+	const uint64_t key = GetPrimitiveKey(desc);
+	auto it = entries_.find(key);
+	if (it != entries_.end()) {
+		Entry& entry = it->second;
+		entry.lastUsedFenceValue = frameFenceValue_;
+		lru_.splice(lru_.begin(), lru_, entry.lruPosition);
+		return entry.mesh;
+	}
+
+	const uint32_t vertexCount = GetPrimitiveVertexCount(desc);
+	const uint32_t indexCount = GetPrimitiveIndexCount(desc);
+	assert(vertexCount > 0 && indexCount > 0);
+
+	Entry entry{};
+	const uint32_t vertexSize = uint32_t(sizeof(VertexData) * vertexCount);
+	const uint32_t indexSize = uint32_t(sizeof(uint32_t) * indexCount);
+	entry.vertexBuffer = device_->CreateBuffer({ vertexSize, RenderHeapType::Upload, MemoryCategory::Mesh });
+	entry.indexBuffer = device_->CreateBuffer({ indexSize, RenderHeapType::Upload, MemoryCategory::Mesh });
+
+	// Mapしたアドレスに直接生成する。一時的なCPU側の配列は作らない
+	VertexData* vertexData = static_cast<VertexData*>(device_->Map(entry.vertexBuffer));
+	uint32_t* indexData = static_cast<uint32_t*>(device_->Map(entry.indexBuffer));
+	WritePrimitive(desc, vertexData, indexData);
+	device_->Unmap(entry.vertexBuffer);
+	device_->Unmap(entry.indexBuffer);
+
+	RenderMesh mesh{};
+	mesh.vertexBuffer = entry.vertexBuffer;
+	mesh.vertexSize = vertexSize;
+	mesh.vertexStride = uint32_t(sizeof(VertexData));
+	mesh.indexBuffer = entry.indexBuffer;
+	mesh.indexSize = indexSize;
+	mesh.count = indexCount;
+	if (freeMeshes_.empty()) {
+		entry.mesh = executor_->AddMesh(mesh);
+	} else {
+		entry.mesh = freeMeshes_.back();
+		freeMeshes_.pop_back();
+		executor_->UpdateMesh(entry.mesh, mesh);
+	}
+	entry.lastUsedFenceValue = frameFenceValue_;
+	lru_.push_front(key);
+	entry.lruPosition = lru_.begin();
+
+	entries_.emplace(key, entry);
+	EvictUnused();
+	return entry.mesh;
+}
\ No newline at end of file
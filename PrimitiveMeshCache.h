@@ -0,0 +1,59 @@
+#pragma once
+#include <list>
+#include <unordered_map>
+#include <vector>
+#include "DeviceRenderQueueExecutor.h"
+#include "PrimitiveMesh.h"
+#include "RenderDevice.h"
+
+/// <summary>
+/// PrimitiveMeshで生成したメッシュを形状と分割数ごとに1つだけ作って使い回す
+/// maxMeshCountを超えたら最も長く使っていないものを外し、GPUが使い終わってからバッファを破棄する
+/// </summary>
+class PrimitiveMeshCache {
+public:
+	// maxMeshCount: 持っておくメッシュの数。このフレームで使ったものは外さないので、一時的に超えることがある
+	void Initialize(RenderDevice* device, DeviceRenderQueueExecutor* executor, uint32_t maxMeshCount = 64);
+	void Finalize();
+
+	// フレームの最初に呼ぶ。GPUが終えた分の外したメッシュを破棄する
+	// completedFenceValue: GPUが終えたFenceの値、submittedFenceValue: 最後にSignalしたFenceの値
+	void Update(uint64_t completedFenceValue, uint64_t submittedFenceValue);
+
+	// 初めての形状ならバッファを作ってexecutorに登録し、DrawItem::meshに使う番号を返す
+	// 番号は外されるまで同じで、外した後はGPUが使い終わってから別の形状に使い回す
+	uint32_t GetMesh(const PrimitiveDesc& desc);
+
+	uint32_t GetMeshCount() const { return uint32_t(entries_.size()); }
+	// 外したがまだ破棄していないメッシュの数
+	uint32_t GetRetiredCount() const { return uint32_t(retired_.size()); }
+	uint32_t GetEvictedCount() const { return evictedCount_; }
+
+private:
+	struct Entry {
+		RenderBufferHandle vertexBuffer;
+		RenderBufferHandle indexBuffer;
+		uint32_t mesh;
+		uint64_t lastUsedFenceValue; //!< 最後に使ったフレームが終わるとSignalされるFenceの値
+		std::list<uint64_t>::iterator lruPosition;
+	};
+	struct Retired {
+		RenderBufferHandle vertexBuffer;
+		RenderBufferHandle indexBuffer;
+		uint32_t mesh;
+		uint64_t fenceValue; //!< この値までGPUが進めば破棄できる
+	};
+
+	// 最も長く使っていないものから、このフレームで使っていないものを外す
+	void EvictUnused();
+
+	RenderDevice* device_ = nullptr;
+	DeviceRenderQueueExecutor* executor_ = nullptr;
+	uint32_t maxMeshCount_ = 0;
+	uint64_t frameFenceValue_ = 1; //!< このフレームの描画が終わるとSignalされるFenceの値
+	std::unordered_map<uint64_t, Entry> entries_;
+	std::list<uint64_t> lru_; //!< 先頭が最近使ったもの
+	std::vector<Retired> retired_;
+	std::vector<uint32_t> freeMeshes_; //!< 使い回せるexecutorのメッシュの番号
+	uint32_t evictedCount_ = 0;
+};
\ No newline at end of file
@@ -0,0 +1,243 @@
+#include "Profiler.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <format>
+#include <fstream>
+#include <iterator>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#include "Logger.h"
+
+namespace {
+	int64_t GetNanoseconds() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	// steady_clockより軽いので区間の時刻にはrdtscを使う。ミリ秒への換算はEndFrameで測り直す
+	uint64_t GetTicks() {
+		return __rdtsc();
+	}
+
+	// JSONの文字列に入れられるようにする
+	void AppendEscaped(std::string& output, const char* text) {
+		for (const char* character = text; *character != '\0'; ++character) {
+			if (*character == '"' || *character == '\\') {
+				output.push_back('\\');
+			}
+			output.push_back(*character);
+		}
+	}
+}
+
+/// <summary>
+/// スレッドが終わるときにバッファを手放す
+/// </summary>
+class ProfilerThreadHandle {
+public:
+	~ProfilerThreadHandle() {
+		if (buffer) {
+			buffer->owned.store(false, std::memory_order_release);
+		}
+	}
+	Profiler::ThreadBuffer* buffer = nullptr;
+};
+
+namespace {
+	thread_local ProfilerThreadHandle threadHandle;
+}
+
+Profiler::Profiler() {
+	static_assert((kCapacity & (kCapacity - 1)) == 0, "kCapacity must be a power of two");
+	startTicks_ = GetTicks();
+	startNanoseconds_ = GetNanoseconds();
+	frameBeginTicks_ = startTicks_;
+}
+
+void Profiler::BeginZone(const char* name) {
+	ThreadBuffer& buffer = GetThreadBuffer();
+	if (buffer.depth < kMaxDepth) {
+		buffer.openNames[buffer.depth] = name;
+		buffer.openBegins[buffer.depth] = GetTicks();
+	}
+	++buffer.depth;
+}
+
+void Profiler::EndZone() {
+	const uint64_t end = GetTicks();
+	ThreadBuffer& buffer = GetThreadBuffer();
+	assert(buffer.depth > 0);
+	--buffer.depth;
+	const uint64_t position = buffer.writePosition.load(std::memory_order_relaxed);
+	if (buffer.depth >= kMaxDepth || position - buffer.readPosition.load(std::memory_order_acquire) >= kCapacity) {
+		droppedCount_.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	buffer.events[position & (kCapacity - 1)] = { buffer.openNames[buffer.depth], buffer.openBegins[buffer.depth], end, buffer.depth };
+	buffer.writePosition.store(position + 1, std::memory_order_release);
+}
+
+void Profiler::SetThreadName(const char* name) {
+	GetThreadBuffer().threadName.store(name, std::memory_order_relaxed);
+}
+
+void Profiler::EndFrame() {
+	const uint64_t now = GetTicks();
+	// 起動からの経過時間でrdtscの速さを求める。長く測るほど正確になる
+	const int64_t elapsedNanoseconds = GetNanoseconds() - startNanoseconds_;
+	if (elapsedNanoseconds > 0 && now > startTicks_) {
+		ticksPerMillisecond_ = double(now - startTicks_) * 1000000.0 / double(elapsedNanoseconds);
+	}
+	frameMilliseconds_ = TicksToMilliseconds(now - frameBeginTicks_);
+	const uint32_t threadIndex = GetThreadBuffer().threadIndex;
+
+	{
+		// 区間を積むのはロックしないが、バッファの登録とは排他にする
+		std::lock_guard<std::mutex> lock(mutex_);
+		for (std::unique_ptr<ThreadBuffer>& buffer : buffers_) {
+			const uint64_t writePosition = buffer->writePosition.load(std::memory_order_acquire);
+			for (uint64_t position = buffer->readPosition.load(std::memory_order_relaxed); position < writePosition; ++position) {
+				const Event& event = buffer->events[position & (kCapacity - 1)];
+				const uint64_t ticks = event.end - event.begin;
+				// 中の区間は先に終わっているので、その合計を引けば自分だけの時間になる
+				const uint64_t selfTicks = ticks - (std::min)(ticks, buffer->childTicks[event.depth + 1]);
+				buffer->childTicks[event.depth + 1] = 0;
+				if (event.depth > 0) {
+					buffer->childTicks[event.depth] += ticks;
+				}
+				auto [it, inserted] = accumulators_.try_emplace(event.name, ZoneAccumulator{ event.name, 0, 0, 0, 0 });
+				ZoneAccumulator& accumulator = it->second;
+				accumulator.ticks += ticks;
+				accumulator.selfTicks += selfTicks;
+				accumulator.maxTicks = (std::max)(accumulator.maxTicks, ticks);
+				++accumulator.callCount;
+				if (captureFrameCount_ > 0) {
+					capturedEvents_.push_back({ event.name, event.begin, event.end, buffer->threadIndex });
+				}
+			}
+			buffer->readPosition.store(writePosition, std::memory_order_release);
+		}
+	}
+
+	if (captureFrameCount_ > 0) {
+		capturedFrames_.push_back({ "Frame", frameBeginTicks_, now, threadIndex });
+		if (--captureFrameCount_ == 0) {
+			WriteChromeTrace();
+		}
+	}
+	frameBeginTicks_ = now;
+
+	// 数フレーム分を平均して、時間の長い順に並べる
+	if (++accumulatedFrameCount_ >= kStatsFrameCount) {
+		const double frameCount = double(accumulatedFrameCount_);
+		zoneStats_.clear();
+		for (const auto& [name, accumulator] : accumulators_) {
+			zoneStats_.push_back({ accumulator.name, TicksToMilliseconds(accumulator.ticks) / frameCount,
+				TicksToMilliseconds(accumulator.selfTicks) / frameCount, TicksToMilliseconds(accumulator.maxTicks),
+				double(accumulator.callCount) / frameCount });
+		}
+		std::sort(zoneStats_.begin(), zoneStats_.end(), [](const ProfileZoneStats& a, const ProfileZoneStats& b) {
+			return a.milliseconds > b.milliseconds;
+		});
+		accumulators_.clear();
+		accumulatedFrameCount_ = 0;
+	}
+}
+
+void Profiler::AddGpuZone(const char* name, int64_t beginNanoseconds, int64_t endNanoseconds) {
+	if (captureFrameCount_ == 0 || beginNanoseconds < startNanoseconds_) {
+		return;
+	}
+	// 今の換算でrdtscの値にして、CPUの区間と同じ時間軸に置く
+	auto toTicks = [&](int64_t nanoseconds) {
+		return startTicks_ + uint64_t(double(nanoseconds - startNanoseconds_) * ticksPerMillisecond_ / 1000000.0);
+	};
+	capturedEvents_.push_back({ name, toTicks(beginNanoseconds), toTicks(endNanoseconds), kGpuThreadIndex });
+}
+
+void Profiler::CaptureFrames(uint32_t frameCount, const std::string& filePath) {
+	captureFrameCount_ = frameCount;
+	captureFilePath_ = filePath;
+	capturedEvents_.clear();
+	capturedFrames_.clear();
+}
+
+Profiler::ThreadBuffer* Profiler::AcquireThreadBuffer() {
+	std::lock_guard<std::mutex> lock(mutex_);
+	// 終わったスレッドのバッファは、残りを集め終えていれば使い回す
+	for (std::unique_ptr<ThreadBuffer>& buffer : buffers_) {
+		if (!buffer->owned.load(std::memory_order_acquire) &&
+			buffer->readPosition.load(std::memory_order_acquire) == buffer->writePosition.load(std::memory_order_relaxed)) {
+			buffer->owned.store(true, std::memory_order_relaxed);
+			buffer->threadName.store(nullptr, std::memory_order_relaxed);
+			buffer->depth = 0;
+			return buffer.get();
+		}
+	}
+	buffers_.push_back(std::make_unique<ThreadBuffer>());
+	buffers_.back()->threadIndex = uint32_t(buffers_.size() - 1);
+	return buffers_.back().get();
+}
+
+Profiler::ThreadBuffer& Profiler::GetThreadBuffer() {
+	if (!threadHandle.buffer) {
+		threadHandle.buffer = AcquireThreadBuffer();
+	}
+	return *threadHandle.buffer;
+}
+
+double Profiler::TicksToMilliseconds(uint64_t ticks) const {
+	return double(ticks) / ticksPerMillisecond_;
+}
+
+void Profiler::WriteChromeTrace() {
+	// 時刻はマイクロ秒。完了イベント(ph:X)は開始時刻と長さだけで入れ子が決まる
+	std::string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	auto appendEvent = [&](const CapturedEvent& event) {
+		json += "{\"name\":\"";
+		AppendEscaped(json, event.name);
+		std::format_to(std::back_inserter(json), "\",\"ph\":\"X\",\"pid\":1,\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}}},\n",
+			event.threadIndex, TicksToMilliseconds(event.begin - startTicks_) * 1000.0, TicksToMilliseconds(event.end - event.begin) * 1000.0);
+	};
+	for (const CapturedEvent& frame : capturedFrames_) {
+		appendEvent(frame);
+	}
+	for (const CapturedEvent& event : capturedEvents_) {
+		appendEvent(event);
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		for (const std::unique_ptr<ThreadBuffer>& buffer : buffers_) {
+			const char* threadName = buffer->threadName.load(std::memory_order_relaxed);
+			json += std::format("{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":{},\"args\":{{\"name\":\"", buffer->threadIndex);
+			if (threadName) {
+				AppendEscaped(json, threadName);
+			} else {
+				std::format_to(std::back_inserter(json), "Thread {}", buffer->threadIndex);
+			}
+			json += "\"}},\n";
+		}
+	}
+	json += std::format("{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":{},\"args\":{{\"name\":\"GPU\"}}}},\n", kGpuThreadIndex);
+	// 最後の要素の後ろの,を取る
+	json.resize(json.size() - 2);
+	json += "\n]}\n";
+
+	std::ofstream file(captureFilePath_, std::ios::binary);
+	if (!file) {
+		LOG_ERROR(LogCategory::General, "Profiler: failed to open {}\n", captureFilePath_);
+		return;
+	}
+	file.write(json.data(), std::streamsize(json.size()));
+	LOG_INFO(LogCategory::General, "Profiler: wrote {} events to {}\n", capturedEvents_.size() + capturedFrames_.size(), captureFilePath_);
+	capturedEvents_.clear();
+	capturedFrames_.clear();
+}
+
+Profiler& GetProfiler() {
+	static Profiler profiler;
+	return profiler;
+}
\ No newline at end of file
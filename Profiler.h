@@ -0,0 +1,157 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// 0にするとPROFILE_で始まるマクロが全て消える
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED 1
+#endif
+
+/// <summary>
+/// 区間(ゾーン)ごとの集計。数フレーム分の平均
+/// </summary>
+struct ProfileZoneStats {
+	const char* name;
+	double milliseconds; //!< 1フレームあたりの合計時間
+	double selfMilliseconds; //!< そのうち中の区間を除いた時間
+	double maxMilliseconds; //!< 1回の最大
+	double callCount; //!< 1フレームあたりの回数
+};
+
+/// <summary>
+/// 区間の計測。区間の名前は文字列リテラルなど、Profilerより長く生きるものを渡す
+/// 区間の記録はスレッドごとのバッファにロックせずに積み、EndFrameで呼び出したスレッドが集める
+/// アプリに1つだけ作り、GetProfilerから使う
+/// </summary>
+class Profiler {
+public:
+	// 1スレッドのバッファに入る区間の数。2のべき乗。EndFrameまでに溢れた分は捨てて数える
+	static const uint32_t kCapacity = 8192;
+	// 入れ子の深さの上限。これより深い区間は記録しない
+	static const uint32_t kMaxDepth = 64;
+	// 集計を平均するフレーム数
+	static const uint32_t kStatsFrameCount = 30;
+
+	Profiler();
+
+	// 呼び出したスレッドで区間を始める、終える。必ず対にする
+	void BeginZone(const char* name);
+	void EndZone();
+	// Chromeのトレースに出すスレッド名。呼び出したスレッドのものを設定する
+	void SetThreadName(const char* name);
+
+	// フレームの最後にメインスレッドで呼ぶ。全スレッドの記録を集めて集計とキャプチャに回す
+	void EndFrame();
+
+	// GPUの区間をキャプチャのタイムラインに加える。時刻はsteady_clockのナノ秒。EndFrameと同じスレッドで呼ぶ
+	void AddGpuZone(const char* name, int64_t beginNanoseconds, int64_t endNanoseconds);
+
+	// 次のEndFrameからframeCountフレーム分の記録を、Chromeのトレース(chrome://tracing, Perfetto)のJSONでfilePathに書き出す
+	void CaptureFrames(uint32_t frameCount, const std::string& filePath);
+	bool IsCapturing() const { return captureFrameCount_ > 0; }
+
+	double GetFrameMilliseconds() const { return frameMilliseconds_; }
+	// 時間の長い順
+	const std::vector<ProfileZoneStats>& GetZoneStats() const { return zoneStats_; }
+	// バッファが溢れたか深すぎて捨てた区間の数
+	uint64_t GetDroppedCount() const { return droppedCount_.load(std::memory_order_relaxed); }
+
+private:
+	struct Event {
+		const char* name;
+		uint64_t begin; //!< rdtscの値
+		uint64_t end;
+		uint32_t depth;
+	};
+	// 1スレッド分のバッファ。スレッドが終わったら、集め終えた後に別のスレッドが使い回す
+	struct ThreadBuffer {
+		Event events[kCapacity];
+		alignas(64) std::atomic<uint64_t> writePosition{ 0 };
+		alignas(64) std::atomic<uint64_t> readPosition{ 0 };
+		std::atomic<bool> owned{ true }; //!< 使っているスレッドがある
+		uint32_t threadIndex = 0;
+		std::atomic<const char*> threadName{ nullptr }; //!< SetThreadNameで設定した名前
+		// ここからは使っているスレッドだけが触る
+		const char* openNames[kMaxDepth];
+		uint64_t openBegins[kMaxDepth];
+		uint32_t depth = 0;
+		// ここからはEndFrameだけが触る。区間は終わった順に並ぶので、中の区間の合計を深さごとに足しておく
+		uint64_t childTicks[kMaxDepth + 1]{};
+	};
+	struct CapturedEvent {
+		const char* name;
+		uint64_t begin;
+		uint64_t end;
+		uint32_t threadIndex;
+	};
+	struct ZoneAccumulator {
+		const char* name;
+		uint64_t ticks;
+		uint64_t selfTicks;
+		uint64_t maxTicks;
+		uint64_t callCount;
+	};
+
+	// トレースでGPUの区間を並べるスレッド番号
+	static constexpr uint32_t kGpuThreadIndex = 0xFFFF;
+
+	friend class ProfilerThreadHandle;
+	ThreadBuffer* AcquireThreadBuffer();
+	ThreadBuffer& GetThreadBuffer();
+	double TicksToMilliseconds(uint64_t ticks) const;
+	void WriteChromeTrace();
+
+	std::mutex mutex_; //!< バッファの登録だけに使う
+	std::vector<std::unique_ptr<ThreadBuffer>> buffers_;
+	std::atomic<uint64_t> droppedCount_{ 0 };
+
+	// rdtscの値をミリ秒にするための基準。EndFrameごとに測り直す
+	uint64_t startTicks_ = 0;
+	int64_t startNanoseconds_ = 0;
+	double ticksPerMillisecond_ = 1.0;
+
+	uint64_t frameBeginTicks_ = 0;
+	double frameMilliseconds_ = 0.0;
+	std::unordered_map<std::string_view, ZoneAccumulator> accumulators_;
+	uint32_t accumulatedFrameCount_ = 0;
+	std::vector<ProfileZoneStats> zoneStats_;
+
+	uint32_t captureFrameCount_ = 0; //!< 残りのキャプチャするフレーム数
+	std::string captureFilePath_;
+	std::vector<CapturedEvent> capturedEvents_;
+	std::vector<CapturedEvent> capturedFrames_;
+};
+
+// アプリ全体で使うProfiler
+Profiler& GetProfiler();
+
+/// <summary>
+/// 作ってから壊れるまでを1つの区間として記録する
+/// </summary>
+class ProfileScope {
+public:
+	explicit ProfileScope(const char* name) { GetProfiler().BeginZone(name); }
+	~ProfileScope() { GetProfiler().EndZone(); }
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#if PROFILER_ENABLED
+// スコープの終わりまでを区間にする
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+// スコープに収まらない区間。PROFILE_BEGINとPROFILE_ENDを対にする
+#define PROFILE_BEGIN(name) GetProfiler().BeginZone(name)
+#define PROFILE_END() GetProfiler().EndZone()
+#else
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_BEGIN(name) ((void)0)
+#define PROFILE_END() ((void)0)
+#endif
\ No newline at end of file
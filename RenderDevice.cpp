@@ -0,0 +1,62 @@
+#include "RenderDevice.h"
+#include <algorithm>
+
+double GetRenderFormatBytesPerPixel(uint32_t format) {
+	// DXGI_FORMATの値。よく使うものだけ持つ
+	switch (format) {
+	case 2: // R32G32B32A32_FLOAT
+		return 16.0;
+	case 6: // R32G32B32_FLOAT
+		return 12.0;
+	case 10: // R16G16B16A16_FLOAT
+	case 16: // R32G32_FLOAT
+		return 8.0;
+	case 24: // R10G10B10A2_UNORM
+	case 28: // R8G8B8A8_UNORM
+	case 29: // R8G8B8A8_UNORM_SRGB
+	case 40: // D32_FLOAT
+	case 41: // R32_FLOAT
+	case 45: // D24_UNORM_S8_UINT
+	case 87: // B8G8R8A8_UNORM
+	case 91: // B8G8R8A8_UNORM_SRGB
+		return 4.0;
+	case 54: // R16_FLOAT
+		return 2.0;
+	case 61: // R8_UNORM
+		return 1.0;
+	case 71: // BC1_UNORM
+	case 72: // BC1_UNORM_SRGB
+		return 0.5;
+	case 77: // BC3_UNORM
+	case 78: // BC3_UNORM_SRGB
+	case 98: // BC7_UNORM
+	case 99: // BC7_UNORM_SRGB
+		return 1.0;
+	default:
+		return 0.0;
+	}
+}
+
+bool IsRenderFormatBlockCompressed(uint32_t format) {
+	return (format >= 70 && format <= 84) || (format >= 94 && format <= 99);
+}
+
+uint64_t GetRenderImageBytes(uint32_t format, uint32_t width, uint32_t height) {
+	if (IsRenderFormatBlockCompressed(format)) {
+		width = (width + 3) & ~3u;
+		height = (height + 3) & ~3u;
+	}
+	return uint64_t(double(width) * double(height) * GetRenderFormatBytesPerPixel(format));
+}
+
+uint64_t GetRenderTextureBytes(const RenderTextureDesc& desc) {
+	uint64_t bytes = 0;
+	uint32_t width = desc.width;
+	uint32_t height = desc.height;
+	for (uint32_t mipLevel = 0; mipLevel < desc.mipLevels; ++mipLevel) {
+		bytes += GetRenderImageBytes(desc.format, width, height);
+		width = (std::max)(width / 2, 1u);
+		height = (std::max)(height / 2, 1u);
+	}
+	return bytes;
+}
\ No newline at end of file
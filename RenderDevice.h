@@ -0,0 +1,220 @@
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <utility>
+#include <vector>
+#include "MemoryTracker.h"
+
+// 描画APIのリソースを指す番号。0は無効。破棄した番号は使い回されるまで無効として扱う
+struct RenderBufferHandle {
+	uint32_t id = 0;
+};
+struct RenderTextureHandle {
+	uint32_t id = 0;
+};
+struct RenderDescriptorHandle {
+	uint32_t id = 0;
+};
+struct RenderPipelineHandle {
+	uint32_t id = 0;
+};
+
+/// <summary>
+/// バッファを置くメモリの種類
+/// </summary>
+enum class RenderHeapType : uint8_t {
+	Upload, //!< CPUから書いてGPUで読む。Mapできる
+	Default, //!< GPUだけが使う。Mapできない
+	Readback, //!< GPUが書いてCPUで読む。Mapできる
+};
+
+/// <summary>
+/// バッファの設定
+/// </summary>
+struct RenderBufferDesc {
+	uint64_t size;
+	RenderHeapType heapType;
+	MemoryCategory category; //!< MemoryTrackerで数える用途
+};
+
+/// <summary>
+/// 2Dテクスチャの設定。CPUから書けるメモリに置き、WriteTextureでMipごとに書く
+/// </summary>
+struct RenderTextureDesc {
+	uint32_t width;
+	uint32_t height;
+	uint32_t mipLevels;
+	uint32_t format; //!< 描画APIのフォーマットの値(DXGI_FORMAT)
+};
+
+/// <summary>
+/// PSOの設定。頂点はVertexData、RootSignatureはデバイスが持つものを使う
+/// </summary>
+struct RenderPipelineDesc {
+	const void* vertexShader;
+	size_t vertexShaderSize;
+	const void* pixelShader;
+	size_t pixelShaderSize;
+	bool alphaBlend;
+	bool cullBack; //!< 裏面を描画しない
+	bool depthTest;
+	bool depthWrite;
+	uint32_t renderTargetFormat; //!< DXGI_FORMAT
+	uint32_t depthStencilFormat; //!< DXGI_FORMAT。0なら深度を使わない
+};
+
+/// <summary>
+/// デバイスが持っているリソースの数と大きさ
+/// </summary>
+struct RenderDeviceStats {
+	uint32_t bufferCount;
+	uint64_t bufferBytes;
+	uint32_t textureCount;
+	uint64_t textureBytes;
+	uint32_t descriptorCount;
+	uint32_t pipelineCount;
+	uint64_t validationErrorCount; //!< 検証で見つかった誤った呼び出しの数。検証しないデバイスは0
+};
+
+/// <summary>
+/// フレームの処理が使うリソースの生成と破棄。D3D12などの描画APIごとに実装する
+/// 生成と破棄は1つのスレッドから行う。コマンドリストへの記録はその間でなければ並列に行ってよい
+/// </summary>
+class RenderDevice {
+public:
+	virtual ~RenderDevice() = default;
+
+	virtual RenderBufferHandle CreateBuffer(const RenderBufferDesc& desc) = 0;
+	virtual void DestroyBuffer(RenderBufferHandle buffer) = 0;
+	// UploadかReadbackのバッファの先頭のアドレスを返す。Unmapと対にする
+	virtual void* Map(RenderBufferHandle buffer) = 0;
+	virtual void Unmap(RenderBufferHandle buffer) = 0;
+
+	virtual RenderTextureHandle CreateTexture(const RenderTextureDesc& desc) = 0;
+	virtual void DestroyTexture(RenderTextureHandle texture) = 0;
+	// mipLevel番目のMipの全体を書く。rowPitch: 1行のバイト数、slicePitch: 1枚のバイト数
+	virtual void WriteTexture(RenderTextureHandle texture, uint32_t mipLevel, const void* data, uint32_t rowPitch, uint32_t slicePitch) = 0;
+
+	// テクスチャをシェーダーから読むためのディスクリプタ(SRV)
+	virtual RenderDescriptorHandle CreateTextureView(RenderTextureHandle texture) = 0;
+	virtual void DestroyDescriptor(RenderDescriptorHandle descriptor) = 0;
+
+	virtual RenderPipelineHandle CreatePipeline(const RenderPipelineDesc& desc) = 0;
+	virtual void DestroyPipeline(RenderPipelineHandle pipeline) = 0;
+
+	virtual RenderDeviceStats GetStats() const = 0;
+};
+
+/// <summary>
+/// 描画コマンドの記録。RenderDeviceで作ったリソースを番号で指定する
+/// </summary>
+class RenderCommandList {
+public:
+	virtual ~RenderCommandList() = default;
+
+	virtual void SetPipeline(RenderPipelineHandle pipeline) = 0;
+	// RootSignatureのrootParameter番目にCBVを設定する。offsetは256の倍数
+	virtual void SetConstantBuffer(uint32_t rootParameter, RenderBufferHandle buffer, uint64_t offset) = 0;
+	// RootSignatureのrootParameter番目のDescriptorTableにSRVを設定する
+	virtual void SetTexture(uint32_t rootParameter, RenderDescriptorHandle descriptor) = 0;
+	virtual void SetVertexBuffer(RenderBufferHandle buffer, uint64_t offset, uint32_t size, uint32_t stride) = 0;
+	// インデックスはuint32_t
+	virtual void SetIndexBuffer(RenderBufferHandle buffer, uint64_t offset, uint32_t size) = 0;
+
+	virtual void Draw(uint32_t vertexCount, uint32_t instanceCount) = 0;
+	virtual void DrawIndexed(uint32_t indexCount, uint32_t instanceCount) = 0;
+};
+
+// テクスチャの1ピクセルのバイト数。ブロック圧縮は4x4の1ブロックのバイト数を16で割った値。知らないフォーマットは0
+double GetRenderFormatBytesPerPixel(uint32_t format);
+// 4x4ピクセルのブロックで圧縮するフォーマットか
+bool IsRenderFormatBlockCompressed(uint32_t format);
+// width x heightの1枚のバイト数。ブロック圧縮なら4x4に切り上げる
+uint64_t GetRenderImageBytes(uint32_t format, uint32_t width, uint32_t height);
+// Mipをすべて含めたテクスチャのバイト数。行の揃えなど描画API固有の余白は含めない
+uint64_t GetRenderTextureBytes(const RenderTextureDesc& desc);
+
+/// <summary>
+/// RenderDeviceの実装がリソースを番号で持つための入れ物
+/// 番号は下位20ビットが場所+1、上位12ビットが世代で、破棄した後の古い番号はGetでnullptrになる
+/// 空いた場所は古く空いたものから使い回すので、古い番号が再び通るのは同じ場所を4096回使い回した後になる
+/// </summary>
+template<typename T>
+class RenderHandlePool {
+public:
+	uint32_t Add(T value) {
+		uint32_t index = 0;
+		if (freeSlots_.empty()) {
+			index = uint32_t(slots_.size());
+			slots_.push_back({ std::move(value), 0, true });
+		} else {
+			index = freeSlots_.front();
+			freeSlots_.pop_front();
+			slots_[index].value = std::move(value);
+			slots_[index].used = true;
+		}
+		assert(index < kIndexMask);
+		++count_;
+		return (slots_[index].generation << kIndexBits) | (index + 1);
+	}
+
+	// 無効な番号ならnullptr
+	T* Get(uint32_t id) {
+		const uint32_t index = (id & kIndexMask) - 1;
+		if (id == 0 || index >= slots_.size() || !slots_[index].used || slots_[index].generation != (id >> kIndexBits)) {
+			return nullptr;
+		}
+		return &slots_[index].value;
+	}
+	const T* Get(uint32_t id) const {
+		return const_cast<RenderHandlePool*>(this)->Get(id);
+	}
+
+	// 無効な番号ならfalse
+	bool Remove(uint32_t id) {
+		if (!Get(id)) {
+			return false;
+		}
+		const uint32_t index = (id & kIndexMask) - 1;
+		slots_[index].value = T{};
+		slots_[index].used = false;
+		slots_[index].generation = (slots_[index].generation + 1) & kGenerationMask;
+		freeSlots_.push_back(index);
+		--count_;
+		return true;
+	}
+
+	uint32_t GetCount() const { return count_; }
+
+	// 使っている要素を全て呼ぶ
+	template<typename Function>
+	void ForEach(Function&& function) {
+		for (Slot& slot : slots_) {
+			if (slot.used) {
+				function(slot.value);
+			}
+		}
+	}
+
+	void Clear() {
+		slots_.clear();
+		freeSlots_.clear();
+		count_ = 0;
+	}
+
+private:
+	static const uint32_t kIndexBits = 20;
+	static const uint32_t kIndexMask = (1u << kIndexBits) - 1;
+	static const uint32_t kGenerationMask = (1u << (32 - kIndexBits)) - 1;
+
+	struct Slot {
+		T value;
+		uint32_t generation;
+		bool used;
+	};
+	std::vector<Slot> slots_;
+	std::deque<uint32_t> freeSlots_; //!< 空いた順
+	uint32_t count_ = 0;
+};
\ No newline at end of file
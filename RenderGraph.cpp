@@ -0,0 +1,335 @@
+#include "RenderGraph.h"
+#include "ArenaAllocator.h"
+#include <algorithm>
+#include <cassert>
+
+namespace {
+	uint64_t AlignUp(uint64_t value, uint64_t alignment) {
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	// 書き込みを含まない読み取りだけの状態か
+	bool IsReadState(uint32_t state) {
+		return state != kRenderGraphStateCommon && (state & kRenderGraphReadStates) == state;
+	}
+}
+
+void RenderGraph::Reset() {
+	resources_.clear();
+	passes_.clear();
+	passOrder_.clear();
+	barriers_.clear();
+	finalBarrierOffset_ = 0;
+	heapSizes_.clear();
+	stats_ = {};
+}
+
+uint32_t RenderGraph::ImportTexture(std::string_view name, uint32_t initialState, uint32_t finalState) {
+	Resource resource{};
+	resource.name = name;
+	resource.transient = false;
+	resource.initialState = initialState;
+	resource.finalState = finalState;
+	resource.heap = kRenderGraphInvalid;
+	resources_.push_back(resource);
+	return uint32_t(resources_.size() - 1);
+}
+
+uint32_t RenderGraph::CreateTexture(std::string_view name, const RenderGraphTextureDesc& desc) {
+	Resource resource{};
+	resource.name = name;
+	resource.transient = true;
+	resource.desc = desc;
+	resource.heap = kRenderGraphInvalid;
+	resources_.push_back(resource);
+	return uint32_t(resources_.size() - 1);
+}
+
+uint32_t RenderGraph::AddPass(std::string_view name, PassFunction function) {
+	Pass pass{};
+	pass.name = name;
+	pass.function = std::move(function);
+	passes_.push_back(std::move(pass));
+	return uint32_t(passes_.size() - 1);
+}
+
+void RenderGraph::Read(uint32_t pass, uint32_t resource, uint32_t state) {
+	assert(pass < passes_.size() && resource < resources_.size());
+	assert(IsReadState(state));
+	for (Access& access : passes_[pass].accesses) {
+		if (access.resource == resource) {
+			// 同じパスで何通りかに読むなら状態を合わせる
+			access.state |= state;
+			return;
+		}
+	}
+	passes_[pass].accesses.push_back({ resource, state, false });
+}
+
+void RenderGraph::Write(uint32_t pass, uint32_t resource, uint32_t state) {
+	assert(pass < passes_.size() && resource < resources_.size());
+	assert(state != kRenderGraphStateCommon && !IsReadState(state));
+	for (Access& access : passes_[pass].accesses) {
+		if (access.resource == resource) {
+			// 書き込みと他の状態は同時に取れない
+			assert(access.state == state);
+			access.write = true;
+			return;
+		}
+	}
+	passes_[pass].accesses.push_back({ resource, state, true });
+}
+
+void RenderGraph::SetSideEffect(uint32_t pass) {
+	assert(pass < passes_.size());
+	passes_[pass].sideEffect = true;
+}
+
+void RenderGraph::Compile(const std::function<RenderGraphAllocationInfo(const RenderGraphTextureDesc& desc, uint32_t usage)>& getAllocationInfo) {
+	CullPasses();
+	// 読むリソースは宣言順で前のパスが書いたものなので、依存は常に前のパスに向かう
+	// そのため省かなかったパスを宣言順に並べたものがそのまま実行順になる
+	passOrder_.clear();
+	for (uint32_t pass = 0; pass < passes_.size(); ++pass) {
+		if (!passes_[pass].culled) {
+			passOrder_.push_back(pass);
+		}
+	}
+	ComputeLifetimes();
+	AllocateTransients(getAllocationInfo);
+	BuildBarriers();
+
+	stats_.passCount = uint32_t(passOrder_.size());
+	stats_.culledPassCount = uint32_t(passes_.size() - passOrder_.size());
+	stats_.barrierCount = uint32_t(barriers_.size());
+	stats_.barrierBatchCount = 0;
+	for (uint32_t pass : passOrder_) {
+		if (passes_[pass].barrierCount > 0) {
+			++stats_.barrierBatchCount;
+		}
+	}
+	if (finalBarrierOffset_ < barriers_.size()) {
+		++stats_.barrierBatchCount;
+	}
+}
+
+void RenderGraph::Execute(RenderGraphExecutor& executor) {
+	for (uint32_t order = 0; order < passOrder_.size(); ++order) {
+		const Pass& pass = passes_[passOrder_[order]];
+		executor.BeginPass(pass.name);
+		const RenderGraphBarrier* barriers = nullptr;
+		uint32_t count = 0;
+		GetPassBarriers(order, barriers, count);
+		if (count > 0) {
+			executor.ResourceBarriers(barriers, count);
+		}
+		if (pass.function) {
+			pass.function();
+		}
+		executor.EndPass();
+	}
+	const RenderGraphBarrier* barriers = nullptr;
+	uint32_t count = 0;
+	GetFinalBarriers(barriers, count);
+	if (count > 0) {
+		executor.ResourceBarriers(barriers, count);
+	}
+}
+
+void RenderGraph::GetPassBarriers(uint32_t order, const RenderGraphBarrier*& barriers, uint32_t& count) const {
+	const Pass& pass = passes_[passOrder_[order]];
+	barriers = barriers_.data() + pass.barrierOffset;
+	count = pass.barrierCount;
+}
+
+void RenderGraph::GetFinalBarriers(const RenderGraphBarrier*& barriers, uint32_t& count) const {
+	barriers = barriers_.data() + finalBarrierOffset_;
+	count = uint32_t(barriers_.size() - finalBarrierOffset_);
+}
+
+void RenderGraph::CullPasses() {
+	// 後ろのパスから、結果が使われるリソースを書くパスだけを残していく
+	// 書き込みは前の内容に重ねることがあるので、残したパスが触るリソースは前のパスの書き込みも必要とみなす
+	ScratchScope scratch;
+	ScratchVector<bool> needed(resources_.size(), false);
+	for (uint32_t pass = uint32_t(passes_.size()); pass-- > 0;) {
+		Pass& entry = passes_[pass];
+		bool keep = entry.sideEffect;
+		for (const Access& access : entry.accesses) {
+			if (access.write && (!resources_[access.resource].transient || needed[access.resource])) {
+				keep = true;
+			}
+		}
+		entry.culled = !keep;
+		if (keep) {
+			for (const Access& access : entry.accesses) {
+				needed[access.resource] = true;
+			}
+		}
+	}
+}
+
+void RenderGraph::ComputeLifetimes() {
+	for (Resource& resource : resources_) {
+		resource.usage = 0;
+		resource.firstOrder = kRenderGraphInvalid;
+		resource.lastOrder = kRenderGraphInvalid;
+	}
+	for (uint32_t order = 0; order < passOrder_.size(); ++order) {
+		for (const Access& access : passes_[passOrder_[order]].accesses) {
+			Resource& resource = resources_[access.resource];
+			resource.usage |= access.state;
+			if (resource.firstOrder == kRenderGraphInvalid) {
+				resource.firstOrder = order;
+			}
+			resource.lastOrder = order;
+		}
+	}
+}
+
+void RenderGraph::AllocateTransients(const std::function<RenderGraphAllocationInfo(const RenderGraphTextureDesc& desc, uint32_t usage)>& getAllocationInfo) {
+	// 作業用の配列はScratchArenaから取り、関数を出るときにまとめて戻す
+	ScratchScope scratch;
+	ScratchVector<uint32_t> transients;
+	for (uint32_t index = 0; index < resources_.size(); ++index) {
+		Resource& resource = resources_[index];
+		if (!resource.transient || resource.firstOrder == kRenderGraphInvalid) {
+			continue;
+		}
+		resource.allocation = getAllocationInfo(resource.desc, resource.usage);
+		assert(resource.allocation.alignment > 0);
+		if (heapSizes_.size() <= resource.allocation.heap) {
+			heapSizes_.resize(resource.allocation.heap + 1, 0);
+		}
+		stats_.unaliasedTransientMemory += AlignUp(resource.allocation.size, resource.allocation.alignment);
+		transients.push_back(index);
+	}
+
+	// 大きいものから順に、寿命が重なるテクスチャと重ならない一番低い位置に置く
+	std::stable_sort(transients.begin(), transients.end(), [&](uint32_t a, uint32_t b) {
+		return resources_[a].allocation.size > resources_[b].allocation.size;
+	});
+	ScratchVector<uint32_t> placed;
+	ScratchVector<uint64_t> candidates;
+	for (uint32_t index : transients) {
+		Resource& resource = resources_[index];
+		const uint64_t alignment = resource.allocation.alignment;
+		const uint64_t size = resource.allocation.size;
+		candidates.assign(1, 0);
+		for (uint32_t other : placed) {
+			const Resource& otherResource = resources_[other];
+			if (otherResource.heap == resource.allocation.heap) {
+				candidates.push_back(AlignUp(otherResource.heapOffset + otherResource.allocation.size, alignment));
+			}
+		}
+		std::sort(candidates.begin(), candidates.end());
+		uint64_t offset = 0;
+		for (uint64_t candidate : candidates) {
+			bool fits = true;
+			for (uint32_t other : placed) {
+				const Resource& otherResource = resources_[other];
+				bool sameHeap = otherResource.heap == resource.allocation.heap;
+				bool liveTogether = otherResource.firstOrder <= resource.lastOrder && resource.firstOrder <= otherResource.lastOrder;
+				bool overlaps = candidate < otherResource.heapOffset + otherResource.allocation.size && otherResource.heapOffset < candidate + size;
+				if (sameHeap && liveTogether && overlaps) {
+					fits = false;
+					break;
+				}
+			}
+			if (fits) {
+				offset = candidate;
+				break;
+			}
+		}
+		resource.heap = resource.allocation.heap;
+		resource.heapOffset = offset;
+		heapSizes_[resource.heap] = (std::max)(heapSizes_[resource.heap], offset + size);
+		placed.push_back(index);
+	}
+	for (uint64_t heapSize : heapSizes_) {
+		stats_.transientMemory += heapSize;
+	}
+}
+
+void RenderGraph::BuildBarriers() {
+	// 実行順ごとのバリア。最後の要素は全てのパスの後に張るもの
+	// 使い終わったテクスチャを最初の状態に戻すもの、Aliasing、Transitionの順に張る
+	ScratchScope scratch;
+	ScratchVector<ScratchVector<RenderGraphBarrier>> restoreBarriers(passOrder_.size() + 1);
+	ScratchVector<ScratchVector<RenderGraphBarrier>> aliasingBarriers(passOrder_.size() + 1);
+	ScratchVector<ScratchVector<RenderGraphBarrier>> orderBarriers(passOrder_.size() + 1);
+
+	// ヒープに置いたテクスチャは全て、最初に使う前にAliasingバリアを張る
+	// このフレームで重なるものが無くても、前のフレームの別の配置のテクスチャが同じメモリを使っていたかもしれない
+	// 直前に使っていたリソースは前のフレームを含めると決められないので、resourceBeforeは指定しない
+	for (uint32_t index = 0; index < resources_.size(); ++index) {
+		const Resource& resource = resources_[index];
+		if (resource.heap != kRenderGraphInvalid) {
+			aliasingBarriers[resource.firstOrder].push_back({ RenderGraphBarrier::Type::Aliasing, index, kRenderGraphInvalid, 0, 0 });
+		}
+	}
+
+	// リソースごとに使う順に状態を追い、変わるところでTransitionバリアを張る
+	ScratchVector<ScratchVector<std::pair<uint32_t, Access>>> resourceAccesses(resources_.size());
+	for (uint32_t order = 0; order < passOrder_.size(); ++order) {
+		for (const Access& access : passes_[passOrder_[order]].accesses) {
+			resourceAccesses[access.resource].push_back({ order, access });
+		}
+	}
+	for (uint32_t index = 0; index < resources_.size(); ++index) {
+		Resource& resource = resources_[index];
+		const ScratchVector<std::pair<uint32_t, Access>>& accesses = resourceAccesses[index];
+		if (accesses.empty()) {
+			continue;
+		}
+		// 続けて読むパスの状態をまとめたもの
+		auto readRunState = [&](size_t begin) {
+			uint32_t state = 0;
+			for (size_t i = begin; i < accesses.size() && !accesses[i].second.write; ++i) {
+				state |= accesses[i].second.state;
+			}
+			return state;
+		};
+		if (resource.transient) {
+			// 一時テクスチャは最初に使う状態で作っておく
+			const Access& first = accesses.front().second;
+			resource.initialState = first.write ? first.state : readRunState(0);
+			resource.finalState = resource.initialState;
+		}
+		uint32_t current = resource.initialState;
+		for (size_t i = 0; i < accesses.size(); ++i) {
+			const Access& access = accesses[i].second;
+			uint32_t target = access.state;
+			if (!access.write) {
+				if (IsReadState(current) && (current & access.state) == access.state) {
+					continue;
+				}
+				target = readRunState(i);
+			}
+			if (current != target) {
+				orderBarriers[accesses[i].first].push_back({ RenderGraphBarrier::Type::Transition, index, kRenderGraphInvalid, current, target });
+				current = target;
+			}
+		}
+		if (current != resource.finalState) {
+			// メモリを共有するテクスチャは、次のテクスチャがメモリを使い始める前に戻しておく
+			const uint32_t order = resource.heap != kRenderGraphInvalid ? resource.lastOrder + 1 : uint32_t(passOrder_.size());
+			restoreBarriers[order].push_back({ RenderGraphBarrier::Type::Transition, index, kRenderGraphInvalid, current, resource.finalState });
+		}
+	}
+
+	barriers_.clear();
+	for (uint32_t order = 0; order <= passOrder_.size(); ++order) {
+		const uint32_t offset = uint32_t(barriers_.size());
+		barriers_.insert(barriers_.end(), restoreBarriers[order].begin(), restoreBarriers[order].end());
+		barriers_.insert(barriers_.end(), aliasingBarriers[order].begin(), aliasingBarriers[order].end());
+		barriers_.insert(barriers_.end(), orderBarriers[order].begin(), orderBarriers[order].end());
+		if (order < passOrder_.size()) {
+			Pass& pass = passes_[passOrder_[order]];
+			pass.barrierOffset = offset;
+			pass.barrierCount = uint32_t(barriers_.size() - offset);
+		} else {
+			finalBarrierOffset_ = offset;
+		}
+	}
+}
\ No newline at end of file
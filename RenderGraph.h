@@ -0,0 +1,179 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string_view>
+#include <vector>
+#include "ArenaAllocator.h"
+
+// リソースの状態のビット。読み取りの状態は続けて読むパスの分をまとめて1回で遷移する
+enum RenderGraphState : uint32_t {
+	kRenderGraphStateCommon = 0, //!< Presentと同じ
+	kRenderGraphStateRenderTarget = 1 << 0,
+	kRenderGraphStateDepthWrite = 1 << 1,
+	kRenderGraphStateDepthRead = 1 << 2,
+	kRenderGraphStateShaderResource = 1 << 3, //!< PixelShaderから読む
+	kRenderGraphStateUnorderedAccess = 1 << 4,
+	kRenderGraphStateCopySource = 1 << 5,
+	kRenderGraphStateCopyDest = 1 << 6,
+};
+// 他の読み取りとまとめられる状態
+const uint32_t kRenderGraphReadStates = kRenderGraphStateDepthRead | kRenderGraphStateShaderResource | kRenderGraphStateCopySource;
+// リソースが無いことを表す番号
+const uint32_t kRenderGraphInvalid = UINT32_MAX;
+
+/// <summary>
+/// RenderGraphが作るテクスチャの設定。フレームの中だけで使い、寿命が重ならないもの同士でメモリを共有する
+/// </summary>
+struct RenderGraphTextureDesc {
+	uint32_t width;
+	uint32_t height;
+	uint32_t format; //!< 描画APIのフォーマットの値(DXGI_FORMAT)
+	float clearValue[4]; //!< 最適化クリア値。深度はclearValue[0]
+};
+
+/// <summary>
+/// テクスチャを置くのに必要なメモリ。描画APIごとにRenderGraph::Compileへ渡す関数で求める
+/// </summary>
+struct RenderGraphAllocationInfo {
+	uint64_t size;
+	uint64_t alignment;
+	uint32_t heap; //!< 置けるヒープの種類。同じ種類のテクスチャだけで1つのヒープを共有する
+};
+
+/// <summary>
+/// パスの前に張るバリア
+/// </summary>
+struct RenderGraphBarrier {
+	enum class Type : uint32_t {
+		Transition,
+		Aliasing, //!< 同じメモリを使っていたリソースからresourceに切り替える。ヒープに置いたテクスチャを最初に使う前に張る
+	};
+	Type type;
+	uint32_t resource; //!< Transitionの対象。Aliasingでは切り替え先
+	uint32_t resourceBefore; //!< Aliasingで前にメモリを使っていたリソース。RenderGraphは常にkRenderGraphInvalid(どれでも)にする
+	uint32_t stateBefore;
+	uint32_t stateAfter;
+};
+
+/// <summary>
+/// RenderGraphがバリアを実際の描画APIで張るためのインターフェース
+/// </summary>
+class RenderGraphExecutor {
+public:
+	virtual ~RenderGraphExecutor() = default;
+	// 1つのパスの前に張るバリアをまとめて渡す。countは1以上
+	virtual void ResourceBarriers(const RenderGraphBarrier* barriers, uint32_t count) = 0;
+	// パスの前後に呼ぶ。パスの前のバリアはパスに含める。GPUの時間を測るときなどに使う
+	virtual void BeginPass(std::string_view name) { (void)name; }
+	virtual void EndPass() {}
+};
+
+/// <summary>
+/// RenderGraphのCompile結果の統計
+/// </summary>
+struct RenderGraphStats {
+	uint32_t passCount; //!< 実行するパスの数
+	uint32_t culledPassCount; //!< 結果がどこにも使われないので省いたパスの数
+	uint32_t barrierCount;
+	uint32_t barrierBatchCount; //!< ResourceBarriersを呼ぶ回数
+	uint64_t transientMemory; //!< メモリを共有した後のヒープの合計サイズ
+	uint64_t unaliasedTransientMemory; //!< 共有しなかった場合のサイズの合計
+};
+
+/// <summary>
+/// 描画のパスと、パスが読み書きするリソースを宣言して、実行順とバリア、一時テクスチャのメモリ配置を決める
+/// 毎フレームReset、宣言、Compile、Executeの順に呼ぶ。描画APIには依存しない
+/// 名前とパスごとの配列は毎フレーム作り直すのでFrameArenaから確保する。宣言したフレームの次のフレームまでにResetすること
+/// </summary>
+class RenderGraph {
+public:
+	using PassFunction = std::function<void()>;
+
+	// 前のフレームの宣言を消す
+	void Reset();
+
+	// 外から持ち込むリソース(バックバッファなど)。フレームの最後にfinalStateへ戻す
+	uint32_t ImportTexture(std::string_view name, uint32_t initialState, uint32_t finalState);
+	// フレームの中だけで使うテクスチャ。メモリは他の一時テクスチャと共有されるので、最初に書くパスでClearすること
+	uint32_t CreateTexture(std::string_view name, const RenderGraphTextureDesc& desc);
+
+	// パスを追加する。パスは宣言順に並び、読むリソースはそれより前のパスが書いたものを読む
+	uint32_t AddPass(std::string_view name, PassFunction function);
+	void Read(uint32_t pass, uint32_t resource, uint32_t state);
+	void Write(uint32_t pass, uint32_t resource, uint32_t state);
+	// 結果がリソースに残らない処理(Presentの準備やCPUへの読み戻しなど)をするパスは省かない
+	void SetSideEffect(uint32_t pass);
+
+	// 実行順、バリア、一時テクスチャの配置を決める。getAllocationInfoでテクスチャのサイズを求める
+	void Compile(const std::function<RenderGraphAllocationInfo(const RenderGraphTextureDesc& desc, uint32_t usage)>& getAllocationInfo);
+	// バリアを張りながらパスを実行順に呼ぶ
+	void Execute(RenderGraphExecutor& executor);
+
+	// Compileの結果
+	uint32_t GetResourceCount() const { return uint32_t(resources_.size()); }
+	std::string_view GetResourceName(uint32_t resource) const { return resources_[resource].name; }
+	bool IsTransient(uint32_t resource) const { return resources_[resource].transient; }
+	const RenderGraphTextureDesc& GetTextureDesc(uint32_t resource) const { return resources_[resource].desc; }
+	// 全てのパスで使う状態を合わせたもの。テクスチャを作るときのフラグに使う
+	uint32_t GetUsage(uint32_t resource) const { return resources_[resource].usage; }
+	// フレームの最初の状態。一時テクスチャはこの状態で作り、フレームの最後にこの状態へ戻す
+	uint32_t GetInitialState(uint32_t resource) const { return resources_[resource].initialState; }
+	// 一時テクスチャの配置。使われなかったテクスチャのheapはkRenderGraphInvalid
+	uint32_t GetHeap(uint32_t resource) const { return resources_[resource].heap; }
+	uint64_t GetHeapOffset(uint32_t resource) const { return resources_[resource].heapOffset; }
+	uint32_t GetHeapCount() const { return uint32_t(heapSizes_.size()); }
+	uint64_t GetHeapSize(uint32_t heap) const { return heapSizes_[heap]; }
+
+	uint32_t GetPassCount() const { return uint32_t(passes_.size()); }
+	std::string_view GetPassName(uint32_t pass) const { return passes_[pass].name; }
+	const std::vector<uint32_t>& GetPassOrder() const { return passOrder_; }
+	// 実行順でorder番目のパスの前に張るバリア
+	void GetPassBarriers(uint32_t order, const RenderGraphBarrier*& barriers, uint32_t& count) const;
+	// 全てのパスの後に張るバリア
+	void GetFinalBarriers(const RenderGraphBarrier*& barriers, uint32_t& count) const;
+
+	const RenderGraphStats& GetStats() const { return stats_; }
+
+private:
+	struct Resource {
+		FrameString name;
+		bool transient;
+		RenderGraphTextureDesc desc;
+		uint32_t initialState;
+		uint32_t finalState;
+		uint32_t usage;
+		// 実行するパスの中で最初と最後に使う実行順。使われなければfirstOrderがkRenderGraphInvalid
+		uint32_t firstOrder;
+		uint32_t lastOrder;
+		RenderGraphAllocationInfo allocation;
+		uint32_t heap;
+		uint64_t heapOffset;
+	};
+	struct Access {
+		uint32_t resource;
+		uint32_t state;
+		bool write;
+	};
+	struct Pass {
+		FrameString name;
+		PassFunction function;
+		FrameVector<Access> accesses;
+		bool sideEffect;
+		bool culled;
+		uint32_t barrierOffset;
+		uint32_t barrierCount;
+	};
+
+	void CullPasses();
+	void ComputeLifetimes();
+	void AllocateTransients(const std::function<RenderGraphAllocationInfo(const RenderGraphTextureDesc& desc, uint32_t usage)>& getAllocationInfo);
+	void BuildBarriers();
+
+	std::vector<Resource> resources_;
+	std::vector<Pass> passes_;
+	std::vector<uint32_t> passOrder_;
+	std::vector<RenderGraphBarrier> barriers_;
+	uint32_t finalBarrierOffset_ = 0;
+	std::vector<uint64_t> heapSizes_;
+	RenderGraphStats stats_{};
+};
\ No newline at end of file
@@ -0,0 +1,65 @@
+#include "RenderQueue.h"
+#include <cassert>
+
+namespace {
+	// まだ何も設定されていないことを表す番号
+	const uint32_t kInvalidState = UINT32_MAX;
+}
+
+void RenderQueue::Push(const DrawItem& item) {
+	sortItems_.push_back({ item.sortKey, uint32_t(items_.size()) });
+	items_.push_back(item);
+}
+
+void RenderQueue::Clear() {
+	items_.clear();
+	sortItems_.clear();
+}
+
+void RenderQueue::Execute(RenderQueueExecutor& executor) {
+	Sort();
+	ExecuteRange(executor, 0, GetItemCount());
+}
+
+void RenderQueue::Sort() {
+	stats_ = {};
+	sortScratch_.resize(sortItems_.size());
+	SortKey::RadixSort(sortItems_.data(), sortScratch_.data(), sortItems_.size());
+}
+
+void RenderQueue::ExecuteRange(RenderQueueExecutor& executor, uint32_t begin, uint32_t end) {
+	assert(begin <= end && end <= sortItems_.size());
+	// 統計は範囲ごとに数えてから最後に足す
+	RenderQueueStats stats{};
+	uint32_t pipeline = kInvalidState;
+	uint32_t material = kInvalidState;
+	uint32_t texture = kInvalidState;
+	uint32_t mesh = kInvalidState;
+	uint32_t transform = kInvalidState;
+	// 前回と同じ値なら省き、違えば設定する
+	auto apply = [&stats](uint32_t& current, uint32_t next, auto&& set) {
+		if (current == next) {
+			++stats.elidedStateChangeCount;
+			return;
+		}
+		current = next;
+		set(next);
+		++stats.stateChangeCount;
+	};
+
+	for (uint32_t index = begin; index < end; ++index) {
+		const DrawItem& item = items_[sortItems_[index].index];
+		apply(pipeline, item.pipeline, [&](uint32_t value) { executor.SetPipeline(value); });
+		apply(material, item.material, [&](uint32_t value) { executor.SetMaterial(value); });
+		apply(texture, item.texture, [&](uint32_t value) { executor.SetTexture(value); });
+		apply(mesh, item.mesh, [&](uint32_t value) { executor.SetMesh(value); });
+		apply(transform, item.transform, [&](uint32_t value) { executor.SetTransform(value); });
+		executor.Draw(item);
+		++stats.drawCount;
+	}
+
+	std::lock_guard<std::mutex> lock(statsMutex_);
+	stats_.drawCount += stats.drawCount;
+	stats_.stateChangeCount += stats.stateChangeCount;
+	stats_.elidedStateChangeCount += stats.elidedStateChangeCount;
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include "SortKey.h"
+
+/// <summary>
+/// 描画1回分のデータ。状態はすべて番号で持ち、実際のリソースはExecutor側で引く
+/// </summary>
+struct DrawItem {
+	uint64_t sortKey; //!< SortKey::Makeで作ったキー
+	uint32_t pipeline; //!< PSOの番号
+	uint32_t material; //!< マテリアルCBVの番号
+	uint32_t texture; //!< テクスチャ(SRV)の番号
+	uint32_t mesh; //!< 頂点/インデックスバッファの番号
+	uint32_t transform; //!< 変換行列CBVの番号
+	uint32_t instanceCount;
+};
+
+/// <summary>
+/// RenderQueueが実際の描画APIを呼ぶためのインターフェース
+/// 状態が前の描画と変わった時だけSet系が呼ばれる
+/// </summary>
+class RenderQueueExecutor {
+public:
+	virtual ~RenderQueueExecutor() = default;
+	virtual void SetPipeline(uint32_t pipeline) = 0;
+	virtual void SetMaterial(uint32_t material) = 0;
+	virtual void SetTexture(uint32_t texture) = 0;
+	virtual void SetMesh(uint32_t mesh) = 0;
+	virtual void SetTransform(uint32_t transform) = 0;
+	virtual void Draw(const DrawItem& item) = 0;
+};
+
+/// <summary>
+/// RenderQueueの1フレーム分の統計
+/// </summary>
+struct RenderQueueStats {
+	uint32_t drawCount;
+	uint32_t stateChangeCount; //!< 実際に発行した状態変更の数
+	uint32_t elidedStateChangeCount; //!< 前の描画と同じだったので省いた状態変更の数
+};
+
+/// <summary>
+/// 描画をソートキー順に並べ替え、冗長な状態変更を省いて発行する
+/// </summary>
+class RenderQueue {
+public:
+	void Push(const DrawItem& item);
+	// 毎フレーム、Pushの前に呼ぶ
+	void Clear();
+	// ソートキー順に並べ替えてexecutorに発行する
+	void Execute(RenderQueueExecutor& executor);
+
+	// 複数スレッドで発行する場合は、Sortしてから並べ替えた後の範囲ごとにExecuteRangeを呼ぶ
+	void Sort();
+	uint32_t GetItemCount() const { return uint32_t(items_.size()); }
+	// 並べ替えた後の[begin, end)番目を発行する。状態は範囲の最初で全て設定し直す
+	// 別々のexecutorを使えば別スレッドから同時に呼んでよい
+	void ExecuteRange(RenderQueueExecutor& executor, uint32_t begin, uint32_t end);
+
+	// 直前のSortからの合計
+	const RenderQueueStats& GetStats() const { return stats_; }
+
+private:
+	std::vector<DrawItem> items_;
+	std::vector<SortKey::Item> sortItems_;
+	std::vector<SortKey::Item> sortScratch_;
+	std::mutex statsMutex_;
+	RenderQueueStats stats_{};
+};
@@ -0,0 +1,660 @@
+#include "SceneBVH.h"
+#include "ArenaAllocator.h"
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <xmmintrin.h>
+
+namespace {
+	// 葉に入れる物体の最大数
+	const uint32_t kMaxLeafObjects = 4;
+	// SAHで分割位置を探すときのビンの数
+	const uint32_t kBinCount = 16;
+
+	AABB EmptyAABB() {
+		return { { FLT_MAX,FLT_MAX,FLT_MAX },{ -FLT_MAX,-FLT_MAX,-FLT_MAX } };
+	}
+
+	void Grow(AABB& aabb, const AABB& other) {
+		aabb.min = { (std::min)(aabb.min.x, other.min.x), (std::min)(aabb.min.y, other.min.y), (std::min)(aabb.min.z, other.min.z) };
+		aabb.max = { (std::max)(aabb.max.x, other.max.x), (std::max)(aabb.max.y, other.max.y), (std::max)(aabb.max.z, other.max.z) };
+	}
+
+	float SurfaceArea(const AABB& aabb) {
+		Vector3 size = aabb.max - aabb.min;
+		if (size.x < 0.0f || size.y < 0.0f || size.z < 0.0f) {
+			return 0.0f;
+		}
+		return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+	}
+
+	bool Overlaps(const AABB& a, const AABB& b) {
+		return a.min.x <= b.max.x && a.max.x >= b.min.x &&
+			a.min.y <= b.max.y && a.max.y >= b.min.y &&
+			a.min.z <= b.max.z && a.max.z >= b.min.z;
+	}
+
+	// スラブ法。当たればAABBに入る距離をdistanceに入れる
+	bool IntersectRayAABB(const Vector3& origin, const Vector3& inverseDirection, const AABB& aabb, float maxDistance, float& distance) {
+		float t1 = (aabb.min.x - origin.x) * inverseDirection.x;
+		float t2 = (aabb.max.x - origin.x) * inverseDirection.x;
+		float tNear = (std::min)(t1, t2);
+		float tFar = (std::max)(t1, t2);
+		t1 = (aabb.min.y - origin.y) * inverseDirection.y;
+		t2 = (aabb.max.y - origin.y) * inverseDirection.y;
+		tNear = (std::max)(tNear, (std::min)(t1, t2));
+		tFar = (std::min)(tFar, (std::max)(t1, t2));
+		t1 = (aabb.min.z - origin.z) * inverseDirection.z;
+		t2 = (aabb.max.z - origin.z) * inverseDirection.z;
+		tNear = (std::max)(tNear, (std::min)(t1, t2));
+		tFar = (std::min)(tFar, (std::max)(t1, t2));
+		tNear = (std::max)(tNear, 0.0f);
+		if (tNear > tFar || tNear > maxDistance) {
+			return false;
+		}
+		distance = tNear;
+		return true;
+	}
+
+	Vector3 InverseDirection(const Vector3& direction) {
+		// 0の成分は無限大になり、その軸のスラブは常に通るか常に外れる
+		return { 1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z };
+	}
+}
+
+uint32_t SceneBVH::AddObject(const AABB& bounds) {
+	uint32_t object = 0;
+	if (!freeObjects_.empty()) {
+		object = freeObjects_.back();
+		freeObjects_.pop_back();
+		objectBounds_[object] = bounds;
+		objectAlive_[object] = 1;
+	} else {
+		object = uint32_t(objectBounds_.size());
+		objectBounds_.push_back(bounds);
+		objectAlive_.push_back(1);
+	}
+	structureDirty_ = true;
+	return object;
+}
+
+void SceneBVH::RemoveObject(uint32_t object) {
+	assert(objectAlive_[object]);
+	objectAlive_[object] = 0;
+	freeObjects_.push_back(object);
+	structureDirty_ = true;
+}
+
+void SceneBVH::UpdateObject(uint32_t object, const AABB& bounds) {
+	assert(objectAlive_[object]);
+	if (std::memcmp(&objectBounds_[object], &bounds, sizeof(AABB)) == 0) {
+		return;
+	}
+	objectBounds_[object] = bounds;
+	boundsDirty_ = true;
+}
+
+void SceneBVH::SetRebuildPolicy(float maxCostRatio, uint32_t maxRefitCount) {
+	maxCostRatio_ = maxCostRatio;
+	maxRefitCount_ = maxRefitCount;
+}
+
+void SceneBVH::Build() {
+	objectOrder_.clear();
+	for (uint32_t object = 0; object < objectBounds_.size(); ++object) {
+		if (objectAlive_[object]) {
+			objectOrder_.push_back(object);
+		}
+	}
+	buildNodes_.clear();
+	nodes_.clear();
+	leaves_.clear();
+	depth_ = 0;
+	structureDirty_ = false;
+	boundsDirty_ = false;
+	refitsSinceBuild_ = 0;
+	++stats_.buildCount;
+	stats_.objectCount = uint32_t(objectOrder_.size());
+
+	if (!objectOrder_.empty()) {
+		// 分割は物体の中心で決める
+		for (std::vector<float>& centroids : centroids_) {
+			centroids.resize(objectBounds_.size());
+		}
+		for (uint32_t object : objectOrder_) {
+			const AABB& bounds = objectBounds_[object];
+			centroids_[0][object] = (bounds.min.x + bounds.max.x) * 0.5f;
+			centroids_[1][object] = (bounds.min.y + bounds.max.y) * 0.5f;
+			centroids_[2][object] = (bounds.min.z + bounds.max.z) * 0.5f;
+		}
+		const uint32_t root = BuildBinary(0, uint32_t(objectOrder_.size()));
+		if (buildNodes_[root].count > 0) {
+			// 物体が少なく根が葉になったときは、子が1つだけのノードにする
+			Node node{};
+			node.child[0] = kLeafBit | uint32_t(leaves_.size());
+			node.childCount = 1;
+			leaves_.push_back({ buildNodes_[root].first, buildNodes_[root].count });
+			nodes_.push_back(node);
+			depth_ = 1;
+		} else {
+			Flatten(root, 1);
+		}
+	}
+	buildNodes_.clear();
+	// 走査は1つ取り出して子を最大4つ積む。根から1段降りるごとに兄弟が最大3つ残り、一番下の段では4つ積む
+	// 走査のスタックはこの大きさでScratchArenaに取るので、偏った木でも溢れない
+	traversalStackSize_ = depth_ * 3 + 1;
+
+	stats_.nodeCount = uint32_t(nodes_.size());
+	stats_.leafCount = uint32_t(leaves_.size());
+	stats_.depth = depth_;
+	stats_.cost = Refit();
+	stats_.buildCost = stats_.cost;
+}
+
+void SceneBVH::Update() {
+	if (structureDirty_) {
+		Build();
+		return;
+	}
+	if (!boundsDirty_) {
+		return;
+	}
+	boundsDirty_ = false;
+	stats_.cost = Refit();
+	++stats_.refitCount;
+	++refitsSinceBuild_;
+	if (stats_.cost > stats_.buildCost * maxCostRatio_ || refitsSinceBuild_ >= maxRefitCount_) {
+		Build();
+	}
+}
+
+uint32_t SceneBVH::BuildBinary(uint32_t first, uint32_t count) {
+	const uint32_t nodeIndex = uint32_t(buildNodes_.size());
+	buildNodes_.push_back({});
+	AABB bounds = EmptyAABB();
+	float centroidMin[3] = { FLT_MAX,FLT_MAX,FLT_MAX };
+	float centroidMax[3] = { -FLT_MAX,-FLT_MAX,-FLT_MAX };
+	for (uint32_t index = first; index < first + count; ++index) {
+		const uint32_t object = objectOrder_[index];
+		Grow(bounds, objectBounds_[object]);
+		for (uint32_t axis = 0; axis < 3; ++axis) {
+			centroidMin[axis] = (std::min)(centroidMin[axis], centroids_[axis][object]);
+			centroidMax[axis] = (std::max)(centroidMax[axis], centroids_[axis][object]);
+		}
+	}
+	buildNodes_[nodeIndex].bounds = bounds;
+
+	// 3軸それぞれでビンに分け、SAHコストが一番小さい境目を探す
+	float bestCost = FLT_MAX;
+	uint32_t bestAxis = 0;
+	uint32_t bestSplit = 0;
+	for (uint32_t axis = 0; axis < 3 && count > 1; ++axis) {
+		const float axisMin = centroidMin[axis];
+		const float axisExtent = centroidMax[axis] - axisMin;
+		if (axisExtent <= 0.0f) {
+			continue;
+		}
+		const float binScale = float(kBinCount) / axisExtent;
+		const std::vector<float>& centroids = centroids_[axis];
+		AABB binBounds[kBinCount];
+		uint32_t binCounts[kBinCount] = {};
+		for (AABB& binBound : binBounds) {
+			binBound = EmptyAABB();
+		}
+		for (uint32_t index = first; index < first + count; ++index) {
+			uint32_t object = objectOrder_[index];
+			uint32_t bin = (std::min)(uint32_t((centroids[object] - axisMin) * binScale), kBinCount - 1);
+			Grow(binBounds[bin], objectBounds_[object]);
+			++binCounts[bin];
+		}
+		// 右側の面積と数を後ろから積み上げておき、左側を前から積みながら比べる
+		float rightAreas[kBinCount];
+		uint32_t rightCounts[kBinCount];
+		AABB rightBounds = EmptyAABB();
+		uint32_t rightCount = 0;
+		for (uint32_t bin = kBinCount - 1; bin > 0; --bin) {
+			Grow(rightBounds, binBounds[bin]);
+			rightCount += binCounts[bin];
+			rightAreas[bin] = SurfaceArea(rightBounds);
+			rightCounts[bin] = rightCount;
+		}
+		AABB leftBounds = EmptyAABB();
+		uint32_t leftCount = 0;
+		for (uint32_t split = 1; split < kBinCount; ++split) {
+			Grow(leftBounds, binBounds[split - 1]);
+			leftCount += binCounts[split - 1];
+			if (leftCount == 0 || rightCounts[split] == 0) {
+				continue;
+			}
+			float cost = SurfaceArea(leftBounds) * float(leftCount) + rightAreas[split] * float(rightCounts[split]);
+			if (cost < bestCost) {
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = split;
+			}
+		}
+	}
+
+	// 走査のコストを1、物体1つの判定を1として、分けない場合と比べる
+	const float area = SurfaceArea(bounds);
+	const float splitCost = area > 0.0f ? 1.0f + bestCost / area : FLT_MAX;
+	const bool canSplit = bestCost < FLT_MAX;
+	if (count <= 1 || (count <= kMaxLeafObjects && (!canSplit || float(count) <= splitCost))) {
+		buildNodes_[nodeIndex].first = first;
+		buildNodes_[nodeIndex].count = count;
+		return nodeIndex;
+	}
+
+	uint32_t middle = first + count / 2;
+	if (canSplit) {
+		const float axisMin = centroidMin[bestAxis];
+		const float binScale = float(kBinCount) / (centroidMax[bestAxis] - axisMin);
+		const std::vector<float>& centroids = centroids_[bestAxis];
+		uint32_t* splitPoint = std::partition(objectOrder_.data() + first, objectOrder_.data() + first + count, [&](uint32_t object) {
+			uint32_t bin = (std::min)(uint32_t((centroids[object] - axisMin) * binScale), kBinCount - 1);
+			return bin < bestSplit;
+		});
+		middle = uint32_t(splitPoint - objectOrder_.data());
+	}
+	// 中心が全て同じ位置にあって分けられないときは、数で半分に分ける
+	const uint32_t left = BuildBinary(first, middle - first);
+	const uint32_t right = BuildBinary(middle, first + count - middle);
+	buildNodes_[nodeIndex].left = left;
+	buildNodes_[nodeIndex].right = right;
+	buildNodes_[nodeIndex].count = 0;
+	return nodeIndex;
+}
+
+uint32_t SceneBVH::Flatten(uint32_t buildNode, uint32_t depth) {
+	// 2分木の孫を引き上げて子を4つまで集める。面積が一番大きい内部ノードから開く
+	uint32_t children[4] = { buildNodes_[buildNode].left, buildNodes_[buildNode].right };
+	uint32_t childCount = 2;
+	while (childCount < 4) {
+		int32_t largest = -1;
+		float largestArea = -1.0f;
+		for (uint32_t index = 0; index < childCount; ++index) {
+			const BuildNode& child = buildNodes_[children[index]];
+			if (child.count == 0 && SurfaceArea(child.bounds) > largestArea) {
+				largestArea = SurfaceArea(child.bounds);
+				largest = int32_t(index);
+			}
+		}
+		if (largest < 0) {
+			break;
+		}
+		const BuildNode& opened = buildNodes_[children[largest]];
+		children[largest] = opened.left;
+		children[childCount++] = opened.right;
+	}
+
+	// 子は親より後ろに並ぶので、後ろから順に計算すれば下から境界を求められる
+	const uint32_t nodeIndex = uint32_t(nodes_.size());
+	nodes_.push_back({});
+	nodes_[nodeIndex].childCount = childCount;
+	depth_ = (std::max)(depth_, depth);
+	for (uint32_t index = 0; index < childCount; ++index) {
+		const BuildNode& child = buildNodes_[children[index]];
+		uint32_t childReference = 0;
+		if (child.count > 0) {
+			childReference = kLeafBit | uint32_t(leaves_.size());
+			leaves_.push_back({ child.first, child.count });
+		} else {
+			childReference = Flatten(children[index], depth + 1);
+		}
+		nodes_[nodeIndex].child[index] = childReference;
+	}
+	return nodeIndex;
+}
+
+AABB SceneBVH::GetChildBounds(uint32_t child) const {
+	AABB bounds = EmptyAABB();
+	if (child & kLeafBit) {
+		const Leaf& leaf = leaves_[child & ~kLeafBit];
+		for (uint32_t index = leaf.first; index < leaf.first + leaf.count; ++index) {
+			Grow(bounds, objectBounds_[objectOrder_[index]]);
+		}
+	} else {
+		const Node& node = nodes_[child];
+		for (uint32_t slot = 0; slot < node.childCount; ++slot) {
+			Grow(bounds, { { node.minX[slot], node.minY[slot], node.minZ[slot] },{ node.maxX[slot], node.maxY[slot], node.maxZ[slot] } });
+		}
+	}
+	return bounds;
+}
+
+float SceneBVH::Refit() {
+	float weightedArea = 0.0f;
+	for (size_t nodeIndex = nodes_.size(); nodeIndex-- > 0;) {
+		Node& node = nodes_[nodeIndex];
+		for (uint32_t slot = 0; slot < node.childCount; ++slot) {
+			AABB bounds = GetChildBounds(node.child[slot]);
+			node.minX[slot] = bounds.min.x;
+			node.minY[slot] = bounds.min.y;
+			node.minZ[slot] = bounds.min.z;
+			node.maxX[slot] = bounds.max.x;
+			node.maxY[slot] = bounds.max.y;
+			node.maxZ[slot] = bounds.max.z;
+			// 子に入る確率は面積に比例する。葉は中の物体の数だけ判定する
+			const uint32_t child = node.child[slot];
+			weightedArea += SurfaceArea(bounds) * float((child & kLeafBit) ? leaves_[child & ~kLeafBit].count : 1);
+		}
+	}
+	if (nodes_.empty()) {
+		rootBounds_ = EmptyAABB();
+		return 0.0f;
+	}
+	rootBounds_ = GetChildBounds(0);
+	const float rootArea = SurfaceArea(rootBounds_);
+	return rootArea > 0.0f ? weightedArea / rootArea : 0.0f;
+}
+
+void SceneBVH::CollectAll(uint32_t child, std::vector<uint32_t>& objects) const {
+	if (child & kLeafBit) {
+		const Leaf& leaf = leaves_[child & ~kLeafBit];
+		objects.insert(objects.end(), objectOrder_.begin() + leaf.first, objectOrder_.begin() + leaf.first + leaf.count);
+		return;
+	}
+	const Node& node = nodes_[child];
+	for (uint32_t slot = 0; slot < node.childCount; ++slot) {
+		CollectAll(node.child[slot], objects);
+	}
+}
+
+void SceneBVH::QueryFrustum(const Frustum& frustum, std::vector<uint32_t>& visibleObjects) const {
+	visibleObjects.clear();
+	if (nodes_.empty()) {
+		return;
+	}
+	__m128 normalX[6], normalY[6], normalZ[6], absNormalX[6], absNormalY[6], absNormalZ[6], distance[6];
+	for (int plane = 0; plane < 6; ++plane) {
+		const Plane& source = frustum.planes[plane];
+		normalX[plane] = _mm_set1_ps(source.normal.x);
+		normalY[plane] = _mm_set1_ps(source.normal.y);
+		normalZ[plane] = _mm_set1_ps(source.normal.z);
+		absNormalX[plane] = _mm_set1_ps(std::fabs(source.normal.x));
+		absNormalY[plane] = _mm_set1_ps(std::fabs(source.normal.y));
+		absNormalZ[plane] = _mm_set1_ps(std::fabs(source.normal.z));
+		distance[plane] = _mm_set1_ps(source.distance);
+	}
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 half = _mm_set1_ps(0.5f);
+
+	ScratchScope scratch;
+	ScratchVector<uint32_t> stack(traversalStackSize_);
+	uint32_t stackSize = 0;
+	stack[stackSize++] = 0;
+	while (stackSize > 0) {
+		const Node& node = nodes_[stack[--stackSize]];
+		// 4つの子をまとめて判定する。outsideはどれかの平面の裏、insideは全ての平面の表に完全に入っている
+		const __m128 minX = _mm_load_ps(node.minX), maxX = _mm_load_ps(node.maxX);
+		const __m128 minY = _mm_load_ps(node.minY), maxY = _mm_load_ps(node.maxY);
+		const __m128 minZ = _mm_load_ps(node.minZ), maxZ = _mm_load_ps(node.maxZ);
+		const __m128 centerX = _mm_mul_ps(_mm_add_ps(minX, maxX), half), extentX = _mm_mul_ps(_mm_sub_ps(maxX, minX), half);
+		const __m128 centerY = _mm_mul_ps(_mm_add_ps(minY, maxY), half), extentY = _mm_mul_ps(_mm_sub_ps(maxY, minY), half);
+		const __m128 centerZ = _mm_mul_ps(_mm_add_ps(minZ, maxZ), half), extentZ = _mm_mul_ps(_mm_sub_ps(maxZ, minZ), half);
+		__m128 outside = zero;
+		__m128 partial = zero;
+		for (int plane = 0; plane < 6; ++plane) {
+			__m128 signedDistance = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(normalX[plane], centerX), _mm_mul_ps(normalY[plane], centerY)),
+				_mm_add_ps(_mm_mul_ps(normalZ[plane], centerZ), distance[plane]));
+			__m128 reach = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(absNormalX[plane], extentX), _mm_mul_ps(absNormalY[plane], extentY)),
+				_mm_mul_ps(absNormalZ[plane], extentZ));
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(signedDistance, reach), zero));
+			partial = _mm_or_ps(partial, _mm_cmplt_ps(_mm_sub_ps(signedDistance, reach), zero));
+		}
+		const uint32_t validMask = (1u << node.childCount) - 1;
+		const uint32_t outsideMask = uint32_t(_mm_movemask_ps(outside));
+		const uint32_t partialMask = uint32_t(_mm_movemask_ps(partial));
+		for (uint32_t slot = 0; slot < node.childCount; ++slot) {
+			const uint32_t bit = 1u << slot;
+			if ((validMask & bit) == 0 || (outsideMask & bit) != 0) {
+				continue;
+			}
+			const uint32_t child = node.child[slot];
+			if ((partialMask & bit) == 0) {
+				// 完全に中にあるので下は全て見える
+				CollectAll(child, visibleObjects);
+			} else if (child & kLeafBit) {
+				const Leaf& leaf = leaves_[child & ~kLeafBit];
+				for (uint32_t index = leaf.first; index < leaf.first + leaf.count; ++index) {
+					if (TestFrustumAABB(frustum, objectBounds_[objectOrder_[index]])) {
+						visibleObjects.push_back(objectOrder_[index]);
+					}
+				}
+			} else {
+				assert(stackSize < traversalStackSize_);
+				stack[stackSize++] = child;
+			}
+		}
+	}
+}
+
+bool SceneBVH::RayCast(const Ray& ray, float maxDistance, RayHit& hit) const {
+	if (nodes_.empty()) {
+		return false;
+	}
+	const Vector3 inverseDirection = InverseDirection(ray.direction);
+	const __m128 originX = _mm_set1_ps(ray.origin.x), inverseX = _mm_set1_ps(inverseDirection.x);
+	const __m128 originY = _mm_set1_ps(ray.origin.y), inverseY = _mm_set1_ps(inverseDirection.y);
+	const __m128 originZ = _mm_set1_ps(ray.origin.z), inverseZ = _mm_set1_ps(inverseDirection.z);
+
+	bool found = false;
+	float bestDistance = maxDistance;
+	// 手前の子から先に調べ、今の一番近い当たりより遠い子は開かずに捨てる
+	struct Entry {
+		uint32_t node;
+		float distance;
+	};
+	ScratchScope scratch;
+	ScratchVector<Entry> stack(traversalStackSize_);
+	uint32_t stackSize = 0;
+	stack[stackSize++] = { 0, 0.0f };
+	while (stackSize > 0) {
+		const Entry entry = stack[--stackSize];
+		if (entry.distance > bestDistance) {
+			continue;
+		}
+		const Node& node = nodes_[entry.node];
+		__m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.minX), originX), inverseX);
+		__m128 t2 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.maxX), originX), inverseX);
+		__m128 tNear = _mm_min_ps(t1, t2);
+		__m128 tFar = _mm_max_ps(t1, t2);
+		t1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.minY), originY), inverseY);
+		t2 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.maxY), originY), inverseY);
+		tNear = _mm_max_ps(tNear, _mm_min_ps(t1, t2));
+		tFar = _mm_min_ps(tFar, _mm_max_ps(t1, t2));
+		t1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.minZ), originZ), inverseZ);
+		t2 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.maxZ), originZ), inverseZ);
+		tNear = _mm_max_ps(_mm_max_ps(tNear, _mm_min_ps(t1, t2)), _mm_setzero_ps());
+		tFar = _mm_min_ps(tFar, _mm_max_ps(t1, t2));
+		const __m128 hitMask = _mm_and_ps(_mm_cmple_ps(tNear, tFar), _mm_cmple_ps(tNear, _mm_set1_ps(bestDistance)));
+		const uint32_t mask = uint32_t(_mm_movemask_ps(hitMask)) & ((1u << node.childCount) - 1);
+		alignas(16) float nearDistances[4];
+		_mm_store_ps(nearDistances, tNear);
+
+		// 内部ノードは遠い順に積み、近いものから取り出す
+		Entry pending[4];
+		uint32_t pendingCount = 0;
+		for (uint32_t slot = 0; slot < node.childCount; ++slot) {
+			if ((mask & (1u << slot)) == 0) {
+				continue;
+			}
+			const uint32_t child = node.child[slot];
+			if (child & kLeafBit) {
+				const Leaf& leaf = leaves_[child & ~kLeafBit];
+				for (uint32_t index = leaf.first; index < leaf.first + leaf.count; ++index) {
+					float distance = 0.0f;
+					if (IntersectRayAABB(ray.origin, inverseDirection, objectBounds_[objectOrder_[index]], bestDistance, distance) &&
+						(!found || distance < bestDistance)) {
+						found = true;
+						bestDistance = distance;
+						hit = { objectOrder_[index], distance };
+					}
+				}
+			} else {
+				// 4つしかないので挿入ソートで遠い順に並べる
+				uint32_t position = pendingCount++;
+				while (position > 0 && pending[position - 1].distance < nearDistances[slot]) {
+					pending[position] = pending[position - 1];
+					--position;
+				}
+				pending[position] = { child, nearDistances[slot] };
+			}
+		}
+		for (uint32_t index = 0; index < pendingCount; ++index) {
+			assert(stackSize < traversalStackSize_);
+			stack[stackSize++] = pending[index];
+		}
+	}
+	return found;
+}
+
+void SceneBVH::QueryOverlap(const AABB& bounds, std::vector<uint32_t>& objects) const {
+	objects.clear();
+	if (nodes_.empty()) {
+		return;
+	}
+	const __m128 queryMinX = _mm_set1_ps(bounds.min.x), queryMaxX = _mm_set1_ps(bounds.max.x);
+	const __m128 queryMinY = _mm_set1_ps(bounds.min.y), queryMaxY = _mm_set1_ps(bounds.max.y);
+	const __m128 queryMinZ = _mm_set1_ps(bounds.min.z), queryMaxZ = _mm_set1_ps(bounds.max.z);
+	ScratchScope scratch;
+	ScratchVector<uint32_t> stack(traversalStackSize_);
+	uint32_t stackSize = 0;
+	stack[stackSize++] = 0;
+	while (stackSize > 0) {
+		const Node& node = nodes_[stack[--stackSize]];
+		__m128 overlap = _mm_and_ps(_mm_cmple_ps(_mm_load_ps(node.minX), queryMaxX), _mm_cmpge_ps(_mm_load_ps(node.maxX), queryMinX));
+		overlap = _mm_and_ps(overlap, _mm_and_ps(_mm_cmple_ps(_mm_load_ps(node.minY), queryMaxY), _mm_cmpge_ps(_mm_load_ps(node.maxY), queryMinY)));
+		overlap = _mm_and_ps(overlap, _mm_and_ps(_mm_cmple_ps(_mm_load_ps(node.minZ), queryMaxZ), _mm_cmpge_ps(_mm_load_ps(node.maxZ), queryMinZ)));
+		const uint32_t mask = uint32_t(_mm_movemask_ps(overlap)) & ((1u << node.childCount) - 1);
+		for (uint32_t slot = 0; slot < node.childCount; ++slot) {
+			if ((mask & (1u << slot)) == 0) {
+				continue;
+			}
+			const uint32_t child = node.child[slot];
+			if (child & kLeafBit) {
+				const Leaf& leaf = leaves_[child & ~kLeafBit];
+				for (uint32_t index = leaf.first; index < leaf.first + leaf.count; ++index) {
+					if (Overlaps(objectBounds_[objectOrder_[index]], bounds)) {
+						objects.push_back(objectOrder_[index]);
+					}
+				}
+			} else {
+				assert(stackSize < traversalStackSize_);
+				stack[stackSize++] = child;
+			}
+		}
+	}
+}
+
+SceneBVHBenchmark MeasureSceneBVH(const Frustum& frustum, const Vector3& cameraPosition, uint32_t objectCount, uint32_t iterations) {
+	using Clock = std::chrono::steady_clock;
+	auto milliseconds = [](Clock::time_point begin, Clock::time_point end) {
+		return std::chrono::duration<double, std::milli>(end - begin).count();
+	};
+	std::mt19937 randomEngine(12345);
+	std::uniform_real_distribution<float> positionDistribution(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> sizeDistribution(0.1f, 2.0f);
+	std::uniform_real_distribution<float> unitDistribution(-1.0f, 1.0f);
+	std::vector<AABB> objects(objectCount);
+	for (AABB& object : objects) {
+		Vector3 center{ cameraPosition.x + positionDistribution(randomEngine), cameraPosition.y + positionDistribution(randomEngine), cameraPosition.z + positionDistribution(randomEngine) };
+		float size = sizeDistribution(randomEngine);
+		object = { { center.x - size, center.y - size, center.z - size },{ center.x + size, center.y + size, center.z + size } };
+	}
+
+	SceneBVHBenchmark result{};
+	result.objectCount = objectCount;
+	iterations = (std::max)(iterations, 1u);
+	SceneBVH bvh;
+	for (const AABB& object : objects) {
+		bvh.AddObject(object);
+	}
+	auto start = Clock::now();
+	for (uint32_t iteration = 0; iteration < iterations; ++iteration) {
+		bvh.Build();
+	}
+	result.buildMilliseconds = milliseconds(start, Clock::now()) / iterations;
+
+	// 少しずつ動かしてrefitだけを測る
+	bvh.SetRebuildPolicy(FLT_MAX, UINT32_MAX);
+	double refitMilliseconds = 0.0;
+	for (uint32_t iteration = 0; iteration < iterations; ++iteration) {
+		for (uint32_t object = 0; object < objectCount; ++object) {
+			AABB moved = bvh.GetObjectBounds(object);
+			moved.min.y += 0.01f;
+			moved.max.y += 0.01f;
+			bvh.UpdateObject(object, moved);
+		}
+		start = Clock::now();
+		bvh.Update();
+		refitMilliseconds += milliseconds(start, Clock::now());
+	}
+	result.refitMilliseconds = refitMilliseconds / iterations;
+
+	CullingBounds cullingBounds;
+	for (uint32_t object = 0; object < objectCount; ++object) {
+		cullingBounds.Add(bvh.GetObjectBounds(object));
+	}
+	std::vector<uint32_t> bvhVisible;
+	std::vector<uint32_t> flatVisible;
+	start = Clock::now();
+	for (uint32_t iteration = 0; iteration < iterations; ++iteration) {
+		bvh.QueryFrustum(frustum, bvhVisible);
+	}
+	auto middle = Clock::now();
+	for (uint32_t iteration = 0; iteration < iterations; ++iteration) {
+		FrustumCull(frustum, cullingBounds, CullingShape::Box, flatVisible);
+	}
+	auto end = Clock::now();
+	result.frustumMilliseconds = milliseconds(start, middle) / iterations;
+	result.flatFrustumMilliseconds = milliseconds(middle, end) / iterations;
+	result.visibleCount = uint32_t(bvhVisible.size());
+	std::sort(bvhVisible.begin(), bvhVisible.end());
+	if (bvhVisible != flatVisible) {
+		++result.mismatchCount;
+	}
+
+	// カメラからランダムな向きに飛ばす。総当たりは一番近い距離だけを比べる
+	const uint32_t kRayCount = 1000;
+	std::vector<Ray> rays(kRayCount);
+	for (Ray& ray : rays) {
+		ray = { cameraPosition, { unitDistribution(randomEngine), unitDistribution(randomEngine), unitDistribution(randomEngine) } };
+	}
+	std::vector<float> bvhDistances(kRayCount, -1.0f);
+	std::vector<float> bruteForceDistances(kRayCount, -1.0f);
+	start = Clock::now();
+	for (uint32_t index = 0; index < kRayCount; ++index) {
+		RayHit hit{};
+		if (bvh.RayCast(rays[index], FLT_MAX, hit)) {
+			bvhDistances[index] = hit.distance;
+		}
+	}
+	middle = Clock::now();
+	for (uint32_t index = 0; index < kRayCount; ++index) {
+		const Vector3 inverseDirection = InverseDirection(rays[index].direction);
+		for (uint32_t object = 0; object < objectCount; ++object) {
+			float distance = 0.0f;
+			float bestDistance = bruteForceDistances[index] < 0.0f ? FLT_MAX : bruteForceDistances[index];
+			if (IntersectRayAABB(rays[index].origin, inverseDirection, bvh.GetObjectBounds(object), bestDistance, distance)) {
+				bruteForceDistances[index] = distance;
+			}
+		}
+	}
+	end = Clock::now();
+	result.rayMicroseconds = milliseconds(start, middle) * 1000.0 / kRayCount;
+	result.bruteForceRayMicroseconds = milliseconds(middle, end) * 1000.0 / kRayCount;
+	for (uint32_t index = 0; index < kRayCount; ++index) {
+		if (bvhDistances[index] != bruteForceDistances[index]) {
+			++result.mismatchCount;
+		}
+	}
+	return result;
+}
\ No newline at end of file
@@ -0,0 +1,140 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "Bounds.h"
+#include "FrustumCulling.h"
+
+/// <summary>
+/// 半直線。directionは正規化しなくてよく、距離はdirectionの長さを1とした値になる
+/// </summary>
+struct Ray {
+	Vector3 origin;
+	Vector3 direction;
+};
+
+/// <summary>
+/// SceneBVH::RayCastの結果
+/// </summary>
+struct RayHit {
+	uint32_t object;
+	float distance; //!< AABBに入る位置までの距離。原点がAABBの中なら0
+};
+
+/// <summary>
+/// SceneBVHの統計
+/// </summary>
+struct SceneBVHStats {
+	uint32_t objectCount;
+	uint32_t nodeCount;
+	uint32_t leafCount;
+	uint32_t depth; //!< 根を1とした4分木の段数
+	uint32_t buildCount; //!< 作り直した回数
+	uint32_t refitCount; //!< 木の形を変えずに境界だけ更新した回数
+	float buildCost; //!< 作った直後のSAHコスト
+	float cost; //!< 今のSAHコスト。refitを重ねると大きくなる
+};
+
+/// <summary>
+/// 物体のワールド座標のAABBをまとめたBVH。SAHで作り、1つのノードに4つの子の境界を並べて持つ
+/// 物体が動いたら境界だけを更新(refit)し、品質が落ちたら作り直す。描画APIには依存しない
+/// </summary>
+class SceneBVH {
+public:
+	// 物体を追加して番号を返す。番号は削除するまで変わらない。木にはUpdateかBuildの後に入る
+	uint32_t AddObject(const AABB& bounds);
+	void RemoveObject(uint32_t object);
+	// 物体の境界を変える。変わっていなければ何もしない
+	void UpdateObject(uint32_t object, const AABB& bounds);
+	const AABB& GetObjectBounds(uint32_t object) const { return objectBounds_[object]; }
+
+	// 全ての物体からSAHで作り直す
+	void Build();
+	// 毎フレーム呼ぶ。追加や削除があれば作り直し、境界が変わっただけならrefitする
+	// refitでSAHコストが作った直後のmaxCostRatio倍を超えるか、refitがmaxRefitCount回続いたら作り直す
+	void Update();
+	void SetRebuildPolicy(float maxCostRatio, uint32_t maxRefitCount);
+
+	// 視錐台と重なる物体の番号をvisibleObjectsに入れる。順番は決まっていない
+	// 視錐台に完全に入ったノードの下はそれ以上判定しない
+	void QueryFrustum(const Frustum& frustum, std::vector<uint32_t>& visibleObjects) const;
+	// AABBが一番手前で当たる物体を探す。maxDistanceより遠いものは無視する
+	bool RayCast(const Ray& ray, float maxDistance, RayHit& hit) const;
+	// boundsと重なる物体の番号をobjectsに入れる
+	void QueryOverlap(const AABB& bounds, std::vector<uint32_t>& objects) const;
+
+	const SceneBVHStats& GetStats() const { return stats_; }
+
+private:
+	// 子を4つ並べたノード。SSEでまとめて判定できるように成分ごとに並べる
+	struct alignas(16) Node {
+		float minX[4];
+		float minY[4];
+		float minZ[4];
+		float maxX[4];
+		float maxY[4];
+		float maxZ[4];
+		uint32_t child[4]; //!< 内部ノードの番号か、kLeafBitと葉の番号。childCount個だけ前から詰める
+		uint32_t childCount;
+	};
+	// 葉の物体はobjectOrder_の[first, first + count)
+	struct Leaf {
+		uint32_t first;
+		uint32_t count;
+	};
+	// 作るときに使う2分木のノード。countが0でなければ葉
+	struct BuildNode {
+		AABB bounds;
+		uint32_t left;
+		uint32_t right;
+		uint32_t first;
+		uint32_t count;
+	};
+
+	uint32_t BuildBinary(uint32_t first, uint32_t count);
+	// depth: buildNodeから作るノードの段。根が1
+	uint32_t Flatten(uint32_t buildNode, uint32_t depth);
+	// 子の境界を下から計算し直し、SAHコストを返す
+	float Refit();
+	AABB GetChildBounds(uint32_t child) const;
+	void CollectAll(uint32_t child, std::vector<uint32_t>& objects) const;
+
+	static const uint32_t kLeafBit = 0x80000000u;
+
+	std::vector<AABB> objectBounds_;
+	std::vector<uint8_t> objectAlive_;
+	std::vector<uint32_t> freeObjects_;
+	bool structureDirty_ = false; //!< 物体の追加や削除があった
+	bool boundsDirty_ = false; //!< 物体の境界が変わった
+
+	std::vector<BuildNode> buildNodes_;
+	std::vector<float> centroids_[3]; //!< 作るときに使う物体の中心。軸ごとに並べる
+	std::vector<Node> nodes_;
+	std::vector<Leaf> leaves_;
+	std::vector<uint32_t> objectOrder_;
+	AABB rootBounds_{};
+	uint32_t depth_ = 0; //!< 4分木の段数
+	uint32_t traversalStackSize_ = 1; //!< 走査で同時に積むノードの最大数。depth_から求める
+
+	float maxCostRatio_ = 1.5f;
+	uint32_t maxRefitCount_ = 600;
+	uint32_t refitsSinceBuild_ = 0;
+	SceneBVHStats stats_{};
+};
+
+/// <summary>
+/// MeasureSceneBVHの結果。時間は1回あたり
+/// </summary>
+struct SceneBVHBenchmark {
+	uint32_t objectCount;
+	uint32_t visibleCount;
+	double buildMilliseconds;
+	double refitMilliseconds;
+	double frustumMilliseconds; //!< QueryFrustum
+	double flatFrustumMilliseconds; //!< 全ての物体をFrustumCullした場合
+	double rayMicroseconds; //!< RayCast
+	double bruteForceRayMicroseconds; //!< 全ての物体と判定した場合
+	uint32_t mismatchCount; //!< 総当たりと結果が違ったクエリの数。0になるはず
+};
+
+// カメラの周りにランダムに置いたobjectCount個でBVHを作り、総当たりと時間と結果を比べる
+SceneBVHBenchmark MeasureSceneBVH(const Frustum& frustum, const Vector3& cameraPosition, uint32_t objectCount, uint32_t iterations);
\ No newline at end of file
@@ -0,0 +1,209 @@
+#include "ShaderCache.h"
+#include <cassert>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iterator>
+
+namespace {
+	// キャッシュファイルの先頭に置く。形式を変えたらkVersionを上げる
+	struct ShaderCacheFileHeader {
+		uint32_t magic;
+		uint32_t version;
+		uint64_t key;
+		uint64_t size;
+		uint64_t checksum; //!< 本体のHashFnv1a。壊れたファイルを読まないようにする
+	};
+	const uint32_t kMagic = 0x43535844; // 'DXSC'
+	const uint32_t kVersion = 2;
+
+	uint64_t HashString(const std::wstring& str, uint64_t hash) {
+		// 区切りも混ぜて、引数の境界が変わったときに同じキーにならないようにする
+		hash = HashFnv1a(str.data(), str.size() * sizeof(wchar_t), hash);
+		const wchar_t separator = L'\0';
+		return HashFnv1a(&separator, sizeof(separator), hash);
+	}
+}
+
+uint64_t HashFnv1a(const void* data, size_t size, uint64_t hash) {
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	for (size_t i = 0; i < size; ++i) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+std::vector<std::string> FindShaderIncludes(const std::string& source) {
+	std::vector<std::string> includes;
+	size_t lineStart = 0;
+	while (lineStart < source.size()) {
+		size_t lineEnd = source.find('\n', lineStart);
+		if (lineEnd == std::string::npos) {
+			lineEnd = source.size();
+		}
+		// "#include"、"# include"、"#\tinclude"のどれも同じ指示として読む
+		size_t pos = source.find_first_not_of(" \t", lineStart);
+		if (pos != std::string::npos && pos < lineEnd && source[pos] == '#') {
+			pos = source.find_first_not_of(" \t", pos + 1);
+			if (pos != std::string::npos && pos < lineEnd && source.compare(pos, 7, "include") == 0) {
+				size_t open = source.find_first_not_of(" \t", pos + 7);
+				if (open != std::string::npos && open < lineEnd && (source[open] == '"' || source[open] == '<')) {
+					const char closeChar = source[open] == '"' ? '"' : '>';
+					size_t close = source.find(closeChar, open + 1);
+					if (close != std::string::npos && close < lineEnd) {
+						includes.push_back(source.substr(open + 1, close - open - 1));
+					}
+				}
+			}
+		}
+		lineStart = lineEnd + 1;
+	}
+	return includes;
+}
+
+std::wstring ResolveShaderIncludePath(const std::wstring& includerPath, const std::string& include) {
+	std::filesystem::path directory = std::filesystem::path(includerPath).parent_path();
+	std::filesystem::path includePath = directory / std::filesystem::path(std::u8string(include.begin(), include.end()));
+	return includePath.lexically_normal().wstring();
+}
+
+FileShaderCacheStorage::FileShaderCacheStorage(const std::wstring& directory)
+	: directory_(directory) {
+	std::error_code error;
+	std::filesystem::create_directories(directory_, error);
+}
+
+bool FileShaderCacheStorage::ReadSource(const std::wstring& filePath, std::string& source) {
+	std::ifstream file(std::filesystem::path(filePath), std::ios::binary);
+	if (!file.is_open()) {
+		return false;
+	}
+	source.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	return true;
+}
+
+bool FileShaderCacheStorage::Load(uint64_t key, std::vector<uint8_t>& blob) {
+	std::ifstream file(std::filesystem::path(GetCachePath(key)), std::ios::binary);
+	if (!file.is_open()) {
+		return false;
+	}
+	ShaderCacheFileHeader header{};
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+	// 途中で書き込みが止まったファイルや古い形式は無かったことにする
+	if (!file || header.magic != kMagic || header.version != kVersion || header.key != key || header.size == 0) {
+		return false;
+	}
+	blob.resize(size_t(header.size));
+	file.read(reinterpret_cast<char*>(blob.data()), std::streamsize(header.size));
+	// 本体が途中で切れていたり書き換わっていたら使わない
+	if (!file || HashFnv1a(blob.data(), blob.size()) != header.checksum) {
+		blob.clear();
+		return false;
+	}
+	return true;
+}
+
+void FileShaderCacheStorage::Store(uint64_t key, const void* blob, size_t size) {
+	// 一時ファイルに書いてから置き換え、読み込み側が書きかけのファイルを見ないようにする
+	std::filesystem::path path = GetCachePath(key);
+	std::filesystem::path tempPath = path;
+	tempPath += L".tmp";
+	bool written = false;
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) {
+			return;
+		}
+		ShaderCacheFileHeader header{ kMagic, kVersion, key, uint64_t(size), HashFnv1a(blob, size) };
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(static_cast<const char*>(blob), std::streamsize(size));
+		file.flush();
+		written = bool(file);
+	}
+	std::error_code error;
+	if (written) {
+		std::filesystem::rename(tempPath, path, error);
+	}
+	// 書き込みか置き換えに失敗した一時ファイルは残さない
+	if (!written || error) {
+		std::filesystem::remove(tempPath, error);
+	}
+}
+
+std::wstring FileShaderCacheStorage::GetCachePath(uint64_t key) const {
+	return (std::filesystem::path(directory_) / std::format(L"{:016x}.dxil", key)).wstring();
+}
+
+void ShaderCache::Initialize(ShaderCacheStorage* storage, uint64_t salt) {
+	assert(storage != nullptr);
+	storage_ = storage;
+	salt_ = salt;
+	hitCount_ = 0;
+	missCount_ = 0;
+}
+
+uint64_t ShaderCache::ComputeKey(const std::wstring& filePath, const wchar_t* profile, const wchar_t* entryPoint,
+	const wchar_t* const* arguments, size_t argumentCount) {
+	uint64_t hash = HashFnv1a(&salt_, sizeof(salt_));
+	std::unordered_set<std::wstring> visited;
+	hash = HashSourceRecursive(filePath, hash, visited);
+	hash = HashString(profile, hash);
+	hash = HashString(entryPoint, hash);
+	for (size_t i = 0; i < argumentCount; ++i) {
+		hash = HashString(arguments[i], hash);
+	}
+	return hash;
+}
+
+bool ShaderCache::Load(uint64_t key, std::vector<uint8_t>& blob) {
+	if (storage_->Load(key, blob)) {
+		++hitCount_;
+		return true;
+	}
+	++missCount_;
+	return false;
+}
+
+void ShaderCache::Store(uint64_t key, const void* blob, size_t size) {
+	storage_->Store(key, blob, size);
+}
+
+uint64_t ShaderCache::HashSourceRecursive(const std::wstring& filePath, uint64_t hash, std::unordered_set<std::wstring>& visited) {
+	// #pragma onceや相互includeで無限に辿らないよう、1ファイル1回だけ混ぜる
+	if (!visited.insert(filePath).second) {
+		return hash;
+	}
+	hash = HashString(filePath, hash);
+	std::string source;
+	if (!storage_->ReadSource(filePath, source)) {
+		// 読めないファイルはDXCがエラーにするので、名前だけ混ぜておく
+		return hash;
+	}
+	hash = HashFnv1a(source.data(), source.size(), hash);
+
+	for (const std::string& include : FindShaderIncludes(source)) {
+		hash = HashSourceRecursive(ResolveShaderIncludePath(filePath, include), hash, visited);
+	}
+	return hash;
+}
+
+std::vector<std::wstring> ShaderCache::CollectSourceFiles(const std::wstring& filePath) {
+	std::vector<std::wstring> files{ filePath };
+	std::unordered_set<std::wstring> visited{ filePath };
+	// filesの後ろに見つけたincludeを足しながら先頭から順に読んでいく
+	for (size_t index = 0; index < files.size(); ++index) {
+		std::string source;
+		if (!storage_->ReadSource(files[index], source)) {
+			continue;
+		}
+		for (const std::string& include : FindShaderIncludes(source)) {
+			std::wstring includePath = ResolveShaderIncludePath(files[index], include);
+			if (visited.insert(includePath).second) {
+				files.push_back(includePath);
+			}
+		}
+	}
+	return files;
+}
\ No newline at end of file
@@ -0,0 +1,78 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+/// <summary>
+/// ShaderCacheの読み書き先。DXCに依存しないので差し替えて使える
+/// 起動時は複数スレッドから別々のキーで呼ばれる
+/// </summary>
+class ShaderCacheStorage {
+public:
+	virtual ~ShaderCacheStorage() = default;
+
+	// キーの計算に使うシェーダーのソースを読む
+	virtual bool ReadSource(const std::wstring& filePath, std::string& source) = 0;
+	// keyに対応するDXILを読む。無ければfalse
+	virtual bool Load(uint64_t key, std::vector<uint8_t>& blob) = 0;
+	virtual void Store(uint64_t key, const void* blob, size_t size) = 0;
+};
+
+/// <summary>
+/// directory以下に1シェーダー1ファイルでDXILを保存する
+/// ヘッダーに本体のチェックサムを持ち、合わないファイルは無かったことにする
+/// </summary>
+class FileShaderCacheStorage : public ShaderCacheStorage {
+public:
+	explicit FileShaderCacheStorage(const std::wstring& directory);
+
+	bool ReadSource(const std::wstring& filePath, std::string& source) override;
+	bool Load(uint64_t key, std::vector<uint8_t>& blob) override;
+	void Store(uint64_t key, const void* blob, size_t size) override;
+
+private:
+	std::wstring GetCachePath(uint64_t key) const;
+
+	std::wstring directory_;
+};
+
+/// <summary>
+/// コンパイル済みシェーダーのキャッシュ。
+/// キーはソースと#includeしているファイル(再帰的に)、プロファイル、エントリーポイント、引数から作る
+/// </summary>
+class ShaderCache {
+public:
+	// salt: コンパイラのバージョンなど、変わったら全て作り直したい値
+	void Initialize(ShaderCacheStorage* storage, uint64_t salt);
+
+	uint64_t ComputeKey(const std::wstring& filePath, const wchar_t* profile, const wchar_t* entryPoint,
+		const wchar_t* const* arguments, size_t argumentCount);
+
+	// filePathと、そこから#includeしているファイルを再帰的に集める。ホットリロードの監視対象に使う
+	std::vector<std::wstring> CollectSourceFiles(const std::wstring& filePath);
+
+	bool Load(uint64_t key, std::vector<uint8_t>& blob);
+	void Store(uint64_t key, const void* blob, size_t size);
+
+	uint32_t GetHitCount() const { return hitCount_.load(); }
+	uint32_t GetMissCount() const { return missCount_.load(); }
+
+private:
+	// ファイルの内容と、そこから#includeしているファイルの内容をhashに混ぜる
+	uint64_t HashSourceRecursive(const std::wstring& filePath, uint64_t hash, std::unordered_set<std::wstring>& visited);
+
+	ShaderCacheStorage* storage_ = nullptr;
+	uint64_t salt_ = 0;
+	std::atomic<uint32_t> hitCount_ = 0;
+	std::atomic<uint32_t> missCount_ = 0;
+};
+
+// FNV-1a (64bit)
+uint64_t HashFnv1a(const void* data, size_t size, uint64_t hash = 14695981039346656037ull);
+
+// sourceに書かれた #include "..." と #include <...> のファイル名を順に取り出す。#とincludeの間の空白も許す
+std::vector<std::string> FindShaderIncludes(const std::string& source);
+// includeは書いたファイルからの相対パスで探す。<...>も同じように探す
+std::wstring ResolveShaderIncludePath(const std::wstring& includerPath, const std::string& include);
\ No newline at end of file
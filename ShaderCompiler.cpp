@@ -0,0 +1,110 @@
+#include "ShaderCompiler.h"
+#include <cassert>
+#include "Logger.h"
+#include "Profiler.h"
+#include "ShaderPermutation.h"
+
+IDxcBlob* CompileShader(
+	//ConpilerするShaderファイルへのパス
+	const std::wstring& filePath,
+	//Compilerに使用するProfile
+	const wchar_t* profile,
+	//-Dで渡すdefine。シェーダーの組み合わせを切り替える
+	const std::vector<std::wstring>& defines,
+	//初期化で生成したのもを3つ
+	IDxcUtils* dxcUtils,
+	IDxcCompiler3* dxcCompiler,
+	IDxcIncludeHandler* includeHandler,
+	//コンパイル結果のキャッシュ。nullptrなら毎回コンパイルする
+	ShaderCache* shaderCache
+)
+{
+	PROFILE_SCOPE("CompileShader");
+	//最適化とデバッグ情報はビルド構成に合わせる。ReleaseではDebugの設定のままだとGPUが遅くなる
+	const std::vector<std::wstring> buildArguments = GetShaderBuildArguments(GetDefaultShaderBuildConfig());
+	std::vector<LPCWSTR> arguments = {
+		filePath.c_str(),//コンパイル対象のhlslファイル名
+		L"-E",L"main",//エントリーポイントの指定。基本的にmain以外はしない
+		L"-T",profile,//ShaderProfileの設定
+		L"-Zpr",//メモリレイアウトは行優先
+	};
+	for (const std::wstring& argument : buildArguments) {
+		arguments.push_back(argument.c_str());
+	}
+	for (const std::wstring& define : defines) {
+		arguments.push_back(L"-D");
+		arguments.push_back(define.c_str());
+	}
+
+	//ソースとinclude、引数が前回と同じならDXCを通さずに保存済みのDXILを使う
+	uint64_t cacheKey = 0;
+	if (shaderCache != nullptr) {
+		cacheKey = shaderCache->ComputeKey(filePath, profile, L"main", arguments.data(), arguments.size());
+		std::vector<uint8_t> cachedBlob;
+		if (shaderCache->Load(cacheKey, cachedBlob)) {
+			IDxcBlobEncoding* shaderBlob = nullptr;
+			HRESULT hr = dxcUtils->CreateBlob(cachedBlob.data(), uint32_t(cachedBlob.size()), DXC_CP_ACP, &shaderBlob);
+			assert(SUCCEEDED(hr));
+			LOG_INFO(LogCategory::Shader, L"Shader Cache Hit,path:{},profile:{}\n", filePath, profile);
+			return shaderBlob;
+		}
+	}
+
+	//これからシェーダーをコンパイルする旨をログに出す
+	LOG_INFO(LogCategory::Shader, L"Begin CompilerShader, Path:{},profile:{}\n", filePath, profile);
+	//hlslファイルを読み込む
+	IDxcBlobEncoding* shaderSource = nullptr;
+	HRESULT hr = dxcUtils->LoadFile(filePath.c_str(), nullptr, &shaderSource);
+	//読めなかったらnullptrを返す。ホットリロードではエディタが保存中のこともある
+	if (FAILED(hr)) {
+		LOG_ERROR(LogCategory::Shader, L"Failed to load shader, path:{}\n", filePath);
+		return nullptr;
+	}
+	//読み込んだファイルの内容を設定する
+	DxcBuffer shaderSourceBuffer;
+	shaderSourceBuffer.Ptr = shaderSource->GetBufferPointer();
+	shaderSourceBuffer.Size = shaderSource->GetBufferSize();
+	shaderSourceBuffer.Encoding = DXC_CP_UTF8;//UTF8の文字コード
+
+	//実際にShaderをコンパイルする
+	IDxcResult* shaderResult = nullptr;
+	hr = dxcCompiler->Compile(
+		&shaderSourceBuffer,//読み込んだファイル
+		arguments.data(),//コンパイラオプション
+		uint32_t(arguments.size()),//コンパイラオプションの数
+		includeHandler,//includeが含まれた諸々
+		IID_PPV_ARGS(&shaderResult)//コンパイラ結果
+	);
+	//コンパイルエラーではなくdxcが起動できないなど致命的な状況
+	assert(SUCCEEDED(hr));
+
+	//警告、エラーが出たらログを出してnullptrを返す。起動時は呼び出し側で止める
+	IDxcBlobUtf8* shaderError = nullptr;
+	shaderResult->GetOutput(DXC_OUT_ERRORS, IID_PPV_ARGS(&shaderError), nullptr);
+	if (shaderError != nullptr && shaderError->GetStringLength() != 0) {
+		LOG_ERROR(LogCategory::Shader, std::string_view(shaderError->GetStringPointer(), shaderError->GetStringLength()));
+		//警告、エラーダメ
+		shaderError->Release();
+		shaderSource->Release();
+		shaderResult->Release();
+		return nullptr;
+	}
+	if (shaderError != nullptr) {
+		shaderError->Release();
+	}
+	//コンパイル結果から実行用のバイナリ部分を取得
+	IDxcBlob* shaderBlob = nullptr;
+	hr = shaderResult->GetOutput(DXC_OUT_OBJECT, IID_PPV_ARGS(&shaderBlob), nullptr);
+	assert(SUCCEEDED(hr));
+	//成功したログを出す
+	LOG_INFO(LogCategory::Shader, L"Compile Succeeded,path:{},profile:{}\n", filePath, profile);
+	//次回の起動ではコンパイルしなくて済むように保存しておく
+	if (shaderCache != nullptr) {
+		shaderCache->Store(cacheKey, shaderBlob->GetBufferPointer(), shaderBlob->GetBufferSize());
+	}
+	//もう使わないリソースを解放
+	shaderSource->Release();
+	shaderResult->Release();
+	//実行用のバイナリを返却
+	return shaderBlob;
+}
\ No newline at end of file
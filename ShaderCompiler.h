@@ -0,0 +1,23 @@
+#pragma once
+#include <Windows.h>
+#include <dxcapi.h>
+#include <string>
+#include <vector>
+#include "ShaderCache.h"
+
+// hlslをDXCでコンパイルしてDXILを返す。警告やエラーが出た場合はログを出してnullptrを返す
+// DXCのインスタンスはスレッドをまたいで使えないので、呼び出すスレッドごとに用意したものを渡すこと
+IDxcBlob* CompileShader(
+	//ConpilerするShaderファイルへのパス
+	const std::wstring& filePath,
+	//Compilerに使用するProfile
+	const wchar_t* profile,
+	//-Dで渡すdefine。シェーダーの組み合わせを切り替える
+	const std::vector<std::wstring>& defines,
+	//初期化で生成したのもを3つ
+	IDxcUtils* dxcUtils,
+	IDxcCompiler3* dxcCompiler,
+	IDxcIncludeHandler* includeHandler,
+	//コンパイル結果のキャッシュ。nullptrなら毎回コンパイルする
+	ShaderCache* shaderCache
+);
\ No newline at end of file
@@ -0,0 +1,41 @@
+#include "ShaderDependencyGraph.h"
+#include <algorithm>
+
+void ShaderDependencyGraph::SetDependencies(uint32_t shader, const std::vector<std::wstring>& files) {
+	// 前の依存を逆引きから消してから登録し直す
+	auto it = dependencies_.find(shader);
+	if (it != dependencies_.end()) {
+		for (const std::wstring& file : it->second) {
+			auto dependent = dependents_.find(file);
+			if (dependent != dependents_.end()) {
+				dependent->second.erase(shader);
+				if (dependent->second.empty()) {
+					dependents_.erase(dependent);
+				}
+			}
+		}
+	}
+	dependencies_[shader] = files;
+	for (const std::wstring& file : files) {
+		dependents_[file].insert(shader);
+	}
+}
+
+std::vector<uint32_t> ShaderDependencyGraph::GetDependentShaders(const std::vector<std::wstring>& changedFiles) const {
+	std::unordered_set<uint32_t> shaders;
+	for (const std::wstring& file : changedFiles) {
+		auto dependent = dependents_.find(file);
+		if (dependent != dependents_.end()) {
+			shaders.insert(dependent->second.begin(), dependent->second.end());
+		}
+	}
+	std::vector<uint32_t> result(shaders.begin(), shaders.end());
+	std::sort(result.begin(), result.end());
+	return result;
+}
+
+const std::vector<std::wstring>& ShaderDependencyGraph::GetDependencies(uint32_t shader) const {
+	static const std::vector<std::wstring> kEmpty;
+	auto it = dependencies_.find(shader);
+	return it != dependencies_.end() ? it->second : kEmpty;
+}
\ No newline at end of file
@@ -0,0 +1,24 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/// <summary>
+/// シェーダーとそれが読むファイル(本体とinclude)の対応。
+/// ファイルが変わったときにコンパイルし直すシェーダーを引く
+/// </summary>
+class ShaderDependencyGraph {
+public:
+	// shaderが読むファイルを置き換える。includeが増減したらコンパイルし直した後に呼ぶ
+	void SetDependencies(uint32_t shader, const std::vector<std::wstring>& files);
+
+	// changedFilesのどれかを読んでいるシェーダーを番号順に返す
+	std::vector<uint32_t> GetDependentShaders(const std::vector<std::wstring>& changedFiles) const;
+	const std::vector<std::wstring>& GetDependencies(uint32_t shader) const;
+
+private:
+	std::unordered_map<uint32_t, std::vector<std::wstring>> dependencies_;
+	std::unordered_map<std::wstring, std::unordered_set<uint32_t>> dependents_;
+};
\ No newline at end of file
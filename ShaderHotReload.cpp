@@ -0,0 +1,192 @@
+#include "ShaderHotReload.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include "Logger.h"
+#include "ShaderCompiler.h"
+
+namespace {
+	// ファイルの更新を確かめる間隔
+	const std::chrono::milliseconds kPollInterval(500);
+}
+
+void ShaderHotReload::Initialize(ID3D12Device* device, ShaderCache* shaderCache) {
+	device_ = device;
+	shaderCache_ = shaderCache;
+	// 監視スレッド専用のDXC
+	HRESULT hr = DxcCreateInstance(CLSID_DxcUtils, IID_PPV_ARGS(&dxcUtils_));
+	assert(SUCCEEDED(hr));
+	hr = DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&dxcCompiler_));
+	assert(SUCCEEDED(hr));
+	hr = dxcUtils_->CreateDefaultIncludeHandler(&includeHandler_);
+	assert(SUCCEEDED(hr));
+}
+
+void ShaderHotReload::Finalize() {
+	if (thread_.joinable()) {
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			stopRequested_ = true;
+		}
+		condition_.notify_all();
+		thread_.join();
+	}
+	// Finalizeの前にGPUの完了を待っている前提で全て解放する
+	for (PendingPipeline& pending : pendingPipelines_) {
+		pending.pipelineState->Release();
+	}
+	pendingPipelines_.clear();
+	for (RetiredPipeline& retired : retiredPipelines_) {
+		retired.pipelineState->Release();
+	}
+	retiredPipelines_.clear();
+	for (Pipeline& pipeline : pipelines_) {
+		if (pipeline.ownedPipelineState) {
+			pipeline.ownedPipelineState->Release();
+		}
+	}
+	pipelines_.clear();
+	for (Shader& shader : shaders_) {
+		if (shader.blob) {
+			shader.blob->Release();
+		}
+	}
+	shaders_.clear();
+	if (includeHandler_) {
+		includeHandler_->Release();
+		includeHandler_ = nullptr;
+	}
+	if (dxcCompiler_) {
+		dxcCompiler_->Release();
+		dxcCompiler_ = nullptr;
+	}
+	if (dxcUtils_) {
+		dxcUtils_->Release();
+		dxcUtils_ = nullptr;
+	}
+}
+
+uint32_t ShaderHotReload::AddShader(const std::wstring& filePath, const wchar_t* profile, const std::vector<std::wstring>& defines, IDxcBlob* blob) {
+	assert(!thread_.joinable());
+	blob->AddRef();
+	shaders_.push_back({ filePath, profile, defines, blob });
+	const uint32_t shader = uint32_t(shaders_.size() - 1);
+	std::vector<std::wstring> files = shaderCache_->CollectSourceFiles(filePath);
+	for (const std::wstring& file : files) {
+		watcher_.Watch(file);
+	}
+	dependencies_.SetDependencies(shader, files);
+	return shader;
+}
+
+void ShaderHotReload::AddPipeline(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint32_t vertexShader, uint32_t pixelShader, PipelineCallback onReload) {
+	assert(!thread_.joinable());
+	assert(vertexShader < shaders_.size() && pixelShader < shaders_.size());
+	Pipeline pipeline{};
+	pipeline.desc = desc;
+	pipeline.inputElements.assign(desc.InputLayout.pInputElementDescs, desc.InputLayout.pInputElementDescs + desc.InputLayout.NumElements);
+	pipeline.vertexShader = vertexShader;
+	pipeline.pixelShader = pixelShader;
+	pipeline.onReload = std::move(onReload);
+	pipeline.ownedPipelineState = nullptr;
+	pipelines_.push_back(std::move(pipeline));
+}
+
+void ShaderHotReload::Start() {
+	assert(!thread_.joinable());
+	stopRequested_ = false;
+	thread_ = std::thread(&ShaderHotReload::ThreadMain, this);
+}
+
+void ShaderHotReload::Update(uint64_t completedFenceValue, uint64_t submittedFenceValue) {
+	std::vector<PendingPipeline> pendingPipelines;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		pendingPipelines.swap(pendingPipelines_);
+	}
+	for (const PendingPipeline& pending : pendingPipelines) {
+		Pipeline& pipeline = pipelines_[pending.pipeline];
+		pipeline.onReload(pending.pipelineState);
+		// 直前に作り直したPSOは、既に積んだコマンドが使っているかもしれないので後で解放する
+		if (pipeline.ownedPipelineState) {
+			retiredPipelines_.push_back({ pipeline.ownedPipelineState, submittedFenceValue });
+		}
+		pipeline.ownedPipelineState = pending.pipelineState;
+	}
+
+	auto released = std::remove_if(retiredPipelines_.begin(), retiredPipelines_.end(), [&](const RetiredPipeline& retired) {
+		if (retired.fenceValue <= completedFenceValue) {
+			retired.pipelineState->Release();
+			return true;
+		}
+		return false;
+	});
+	retiredPipelines_.erase(released, retiredPipelines_.end());
+}
+
+void ShaderHotReload::ThreadMain() {
+	std::unique_lock<std::mutex> lock(mutex_);
+	while (!stopRequested_) {
+		condition_.wait_for(lock, kPollInterval, [&] { return stopRequested_; });
+		if (stopRequested_) {
+			break;
+		}
+		lock.unlock();
+		std::vector<std::wstring> changedFiles = watcher_.Poll();
+		if (!changedFiles.empty()) {
+			ReloadChangedShaders(changedFiles);
+		}
+		lock.lock();
+	}
+}
+
+void ShaderHotReload::ReloadChangedShaders(const std::vector<std::wstring>& changedFiles) {
+	std::vector<uint32_t> changedShaders;
+	for (uint32_t shader : dependencies_.GetDependentShaders(changedFiles)) {
+		Shader& entry = shaders_[shader];
+		IDxcBlob* blob = CompileShader(entry.filePath, entry.profile.c_str(), entry.defines,
+			dxcUtils_, dxcCompiler_, includeHandler_, shaderCache_);
+		if (blob == nullptr) {
+			// エラーの内容はCompileShaderがログに出している。前のシェーダーを使い続ける
+			LOG_WARNING(LogCategory::Shader, L"ShaderHotReload: keep previous shader, path:{}\n", entry.filePath);
+			++errorCount_;
+			continue;
+		}
+		entry.blob->Release();
+		entry.blob = blob;
+		changedShaders.push_back(shader);
+
+		// includeが増減しているかもしれないので依存と監視対象を更新する
+		std::vector<std::wstring> files = shaderCache_->CollectSourceFiles(entry.filePath);
+		for (const std::wstring& file : files) {
+			watcher_.Watch(file);
+		}
+		dependencies_.SetDependencies(shader, files);
+	}
+
+	for (uint32_t index = 0; index < pipelines_.size(); ++index) {
+		Pipeline& pipeline = pipelines_[index];
+		bool changed = std::find(changedShaders.begin(), changedShaders.end(), pipeline.vertexShader) != changedShaders.end() ||
+			std::find(changedShaders.begin(), changedShaders.end(), pipeline.pixelShader) != changedShaders.end();
+		if (!changed) {
+			continue;
+		}
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = pipeline.desc;
+		desc.InputLayout = { pipeline.inputElements.data(), uint32_t(pipeline.inputElements.size()) };
+		IDxcBlob* vertexShaderBlob = shaders_[pipeline.vertexShader].blob;
+		IDxcBlob* pixelShaderBlob = shaders_[pipeline.pixelShader].blob;
+		desc.VS = { vertexShaderBlob->GetBufferPointer(), vertexShaderBlob->GetBufferSize() };
+		desc.PS = { pixelShaderBlob->GetBufferPointer(), pixelShaderBlob->GetBufferSize() };
+		ID3D12PipelineState* pipelineState = nullptr;
+		HRESULT hr = device_->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&pipelineState));
+		if (FAILED(hr)) {
+			// VSとPSの入出力が合わなくなったときなど。前のPSOを使い続ける
+			LOG_WARNING(LogCategory::Graphics, "ShaderHotReload: failed to create pipeline state, hr:{:#x}\n", uint32_t(hr));
+			++errorCount_;
+			continue;
+		}
+		std::lock_guard<std::mutex> lock(mutex_);
+		pendingPipelines_.push_back({ index, pipelineState });
+		++reloadCount_;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,93 @@
+#pragma once
+#include <Windows.h>
+#include <d3d12.h>
+#include <dxcapi.h>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "FileWatcher.h"
+#include "ShaderCache.h"
+#include "ShaderDependencyGraph.h"
+
+/// <summary>
+/// シェーダーのファイル(includeを含む)を監視し、変更されたら別スレッドでコンパイルし直してPSOを作り直す。
+/// 新しいPSOはUpdateでフレームの境界に差し替え、古いPSOはGPUが使い終わってから解放する。
+/// コンパイルに失敗した場合は前のPSOを使い続ける
+/// </summary>
+class ShaderHotReload {
+public:
+	// PSOが差し替わったときに呼ばれる。PSOを持っている変数を書き換える
+	using PipelineCallback = std::function<void(ID3D12PipelineState* pipelineState)>;
+
+	void Initialize(ID3D12Device* device, ShaderCache* shaderCache);
+	// 監視スレッドを止め、作り直したPSOとシェーダーを解放する
+	void Finalize();
+
+	// 起動時にコンパイルしたシェーダーを登録して番号を返す。blobは参照を増やして持っておく
+	uint32_t AddShader(const std::wstring& filePath, const wchar_t* profile, const std::vector<std::wstring>& defines, IDxcBlob* blob);
+	// descのVS、PSを登録したシェーダーに差し替えて作り直すPSOを登録する
+	void AddPipeline(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint32_t vertexShader, uint32_t pixelShader, PipelineCallback onReload);
+
+	// 登録が終わったら監視を始める
+	void Start();
+
+	// フレームの境界で呼ぶ。作り直したPSOを差し替え、GPUが使い終わった古いPSOを解放する
+	// completedFenceValue: GPUが終えたFenceの値、submittedFenceValue: 最後にSignalしたFenceの値
+	void Update(uint64_t completedFenceValue, uint64_t submittedFenceValue);
+
+	uint32_t GetReloadCount() const { return reloadCount_; }
+	uint32_t GetErrorCount() const { return errorCount_; }
+
+private:
+	struct Shader {
+		std::wstring filePath;
+		std::wstring profile;
+		std::vector<std::wstring> defines;
+		IDxcBlob* blob;
+	};
+	struct Pipeline {
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC desc;
+		std::vector<D3D12_INPUT_ELEMENT_DESC> inputElements; //!< descが指すInputLayoutのコピー
+		uint32_t vertexShader;
+		uint32_t pixelShader;
+		PipelineCallback onReload;
+		ID3D12PipelineState* ownedPipelineState; //!< 作り直したPSO。起動時のPSOはPipelineStateCacheが持つ
+	};
+	struct PendingPipeline {
+		uint32_t pipeline;
+		ID3D12PipelineState* pipelineState;
+	};
+	struct RetiredPipeline {
+		ID3D12PipelineState* pipelineState;
+		uint64_t fenceValue; //!< この値までGPUが進めば解放できる
+	};
+
+	void ThreadMain();
+	void ReloadChangedShaders(const std::vector<std::wstring>& changedFiles);
+
+	ID3D12Device* device_ = nullptr;
+	ShaderCache* shaderCache_ = nullptr;
+	IDxcUtils* dxcUtils_ = nullptr;
+	IDxcCompiler3* dxcCompiler_ = nullptr;
+	IDxcIncludeHandler* includeHandler_ = nullptr;
+
+	// shaders_、pipelines_のdescとシェーダー番号、watcher_、dependencies_はStart後は監視スレッドだけが触る
+	std::vector<Shader> shaders_;
+	std::vector<Pipeline> pipelines_;
+	FileWatcher watcher_;
+	ShaderDependencyGraph dependencies_;
+
+	std::thread thread_;
+	std::mutex mutex_;
+	std::condition_variable condition_;
+	bool stopRequested_ = false;
+	std::vector<PendingPipeline> pendingPipelines_; //!< mutex_で守る
+
+	std::vector<RetiredPipeline> retiredPipelines_;
+	std::atomic<uint32_t> reloadCount_ = 0;
+	std::atomic<uint32_t> errorCount_ = 0;
+};
\ No newline at end of file
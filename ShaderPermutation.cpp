@@ -0,0 +1,65 @@
+#include "ShaderPermutation.h"
+
+ShaderBuildConfig GetDefaultShaderBuildConfig() {
+#ifdef _DEBUG
+	return ShaderBuildConfig::Debug;
+#else
+	return ShaderBuildConfig::Release;
+#endif
+}
+
+std::vector<std::wstring> GetShaderBuildArguments(ShaderBuildConfig config) {
+	if (config == ShaderBuildConfig::Debug) {
+		return {
+			L"-Zi",L"-Qembed_debug",//デバック用の情報を埋め込む
+			L"-Od",//最適化を外しておく
+		};
+	}
+	return {
+		L"-O3",
+		L"-Qstrip_debug",L"-Qstrip_reflect",//実行に要らない情報を取り除いてDXILを小さくする
+	};
+}
+
+VertexFormat GetVertexFormat(uint32_t features) {
+	return (features & kShaderFeatureTexture) ? VertexFormat::PositionTexcoordNormal : VertexFormat::PositionNormal;
+}
+
+std::vector<std::wstring> GetVertexShaderDefines(uint32_t features) {
+	std::vector<std::wstring> defines;
+	if (features & kShaderFeatureInstancing) {
+		defines.push_back(L"INSTANCING=1");
+	}
+	if (GetVertexFormat(features) == VertexFormat::PositionTexcoordNormal) {
+		defines.push_back(L"VERTEX_TEXCOORD=1");
+	}
+	return defines;
+}
+
+std::vector<std::wstring> GetPixelShaderDefines(uint32_t features) {
+	std::vector<std::wstring> defines;
+	if (features & kShaderFeatureLighting) {
+		defines.push_back(L"LIGHTING=1");
+	}
+	if (features & kShaderFeatureTexture) {
+		defines.push_back(L"TEXTURE=1");
+	}
+	if (features & kShaderFeatureInstancing) {
+		defines.push_back(L"INSTANCING=1");
+	}
+	return defines;
+}
+
+uint32_t SelectShaderFeatures(bool enableLighting, bool useTexture, bool instancing) {
+	uint32_t features = 0;
+	if (enableLighting) {
+		features |= kShaderFeatureLighting;
+	}
+	if (useTexture) {
+		features |= kShaderFeatureTexture;
+	}
+	if (instancing) {
+		features |= kShaderFeatureInstancing;
+	}
+	return features;
+}
\ No newline at end of file
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Object3dのシェーダーを切り替える機能のビット。組み合わせごとに別のシェーダーとPSOを作る
+enum ShaderFeature : uint32_t {
+	kShaderFeatureLighting = 1 << 0, //!< half lambertで照らす
+	kShaderFeatureTexture = 1 << 1, //!< テクスチャを貼る
+	kShaderFeatureInstancing = 1 << 2, //!< StructuredBufferから行列とマテリアルを読む
+};
+// 機能の組み合わせの数。PSOの配列はfeaturesをそのまま番号に使う
+const uint32_t kShaderPermutationCount = 1 << 3;
+// VS、PSそれぞれの結果を変える機能。それ以外のビットは同じシェーダーを使い回す
+const uint32_t kVertexShaderFeatureMask = kShaderFeatureInstancing | kShaderFeatureTexture;
+const uint32_t kPixelShaderFeatureMask = kShaderFeatureLighting | kShaderFeatureTexture | kShaderFeatureInstancing;
+
+/// <summary>
+/// VertexShaderが読む頂点の形式。どちらもVertexDataのバッファを使い、読まない要素は飛ばす
+/// </summary>
+enum class VertexFormat : uint32_t {
+	PositionTexcoordNormal,
+	PositionNormal, //!< テクスチャを使わないのでtexcoordを読まない
+};
+
+/// <summary>
+/// シェーダーのビルド設定
+/// </summary>
+enum class ShaderBuildConfig : uint32_t {
+	Debug, //!< 最適化なし、デバッグ情報埋め込み
+	Release, //!< -O3、デバッグ情報とリフレクションを取り除く
+};
+
+// 実行ファイルの構成に合わせたビルド設定
+ShaderBuildConfig GetDefaultShaderBuildConfig();
+// DXCに渡す最適化とデバッグ情報の引数
+std::vector<std::wstring> GetShaderBuildArguments(ShaderBuildConfig config);
+
+VertexFormat GetVertexFormat(uint32_t features);
+// DXCに-Dで渡すdefine
+std::vector<std::wstring> GetVertexShaderDefines(uint32_t features);
+std::vector<std::wstring> GetPixelShaderDefines(uint32_t features);
+
+// マテリアルの設定から使う組み合わせを選ぶ
+uint32_t SelectShaderFeatures(bool enableLighting, bool useTexture, bool instancing);
\ No newline at end of file
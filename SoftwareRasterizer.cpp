@@ -0,0 +1,728 @@
+#include "SoftwareRasterizer.h"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <emmintrin.h>
+#include "ArenaAllocator.h"
+#include "PrimitiveMesh.h"
+#include "Profiler.h"
+
+namespace {
+	// 1つのまとまりで変換する頂点と三角形の数
+	const uint32_t kVertexChunkSize = 4096;
+	const uint32_t kTriangleChunkSize = 1024;
+	// ガードバンド。画面の何倍の範囲までは切らずにそのまま描くか
+	const float kGuardBand = 8.0f;
+	// 頂点の位置はGPUと同じく1/256ピクセルに揃える
+	const float kSubpixelScale = 256.0f;
+	// 切った多角形の頂点の最大数。三角形を6つの平面で切ると最大で9つになる
+	const uint32_t kMaxClipVertices = 9;
+
+	/// <summary>
+	/// sRGBとリニアの変換表
+	/// </summary>
+	struct ColorTables {
+		static const uint32_t kEncodeSize = 4096;
+		float srgbToLinear[256];
+		uint8_t linearToSrgb[kEncodeSize];
+
+		ColorTables() {
+			for (uint32_t index = 0; index < 256; ++index) {
+				const float value = float(index) / 255.0f;
+				srgbToLinear[index] = value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+			}
+			for (uint32_t index = 0; index < kEncodeSize; ++index) {
+				const float value = float(index) / float(kEncodeSize - 1);
+				const float encoded = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+				linearToSrgb[index] = uint8_t(std::lround(std::clamp(encoded, 0.0f, 1.0f) * 255.0f));
+			}
+		}
+	};
+
+	const ColorTables& GetColorTables() {
+		static const ColorTables tables;
+		return tables;
+	}
+
+	// リニアの色をR8G8B8A8_UNORM_SRGBのピクセルにする。αはリニアのまま
+	uint32_t EncodeColor(const Vector4& color) {
+		const ColorTables& tables = GetColorTables();
+		auto encode = [&](float value) {
+			return uint32_t(tables.linearToSrgb[uint32_t(std::clamp(value, 0.0f, 1.0f) * float(ColorTables::kEncodeSize - 1) + 0.5f)]);
+		};
+		const uint32_t alpha = uint32_t(std::lround(std::clamp(color.w, 0.0f, 1.0f) * 255.0f));
+		return encode(color.x) | (encode(color.y) << 8) | (encode(color.z) << 16) | (alpha << 24);
+	}
+
+	// 1段のMipをバイリニアで読む。UVはラップする
+	Vector4 SampleBilinear(const SoftwareTextureMip& mip, bool srgb, float u, float v) {
+		const ColorTables& tables = GetColorTables();
+		const float x = (u - std::floor(u)) * float(mip.width) - 0.5f;
+		const float y = (v - std::floor(v)) * float(mip.height) - 0.5f;
+		const float floorX = std::floor(x);
+		const float floorY = std::floor(y);
+		const float fractionX = x - floorX;
+		const float fractionY = y - floorY;
+		const int32_t width = int32_t(mip.width);
+		const int32_t height = int32_t(mip.height);
+		const int32_t x0 = (int32_t(floorX) + width) % width;
+		const int32_t y0 = (int32_t(floorY) + height) % height;
+		const int32_t x1 = (x0 + 1) % width;
+		const int32_t y1 = (y0 + 1) % height;
+		auto texel = [&](int32_t texelX, int32_t texelY) {
+			const uint8_t* pixel = mip.pixels + size_t(texelY) * mip.rowPitch + size_t(texelX) * 4;
+			if (srgb) {
+				return Vector4{ tables.srgbToLinear[pixel[0]], tables.srgbToLinear[pixel[1]], tables.srgbToLinear[pixel[2]], float(pixel[3]) / 255.0f };
+			}
+			return Vector4{ float(pixel[0]) / 255.0f, float(pixel[1]) / 255.0f, float(pixel[2]) / 255.0f, float(pixel[3]) / 255.0f };
+		};
+		const Vector4 t00 = texel(x0, y0);
+		const Vector4 t10 = texel(x1, y0);
+		const Vector4 t01 = texel(x0, y1);
+		const Vector4 t11 = texel(x1, y1);
+		auto lerp2 = [&](float a00, float a10, float a01, float a11) {
+			const float top = a00 + (a10 - a00) * fractionX;
+			const float bottom = a01 + (a11 - a01) * fractionX;
+			return top + (bottom - top) * fractionY;
+		};
+		return { lerp2(t00.x, t10.x, t01.x, t11.x), lerp2(t00.y, t10.y, t01.y, t11.y),
+			lerp2(t00.z, t10.z, t01.z, t11.z), lerp2(t00.w, t10.w, t01.w, t11.w) };
+	}
+
+	// MIN_MAG_MIP_LINEARのサンプラーと同じく、UVの画面上の変化からMipを選んで2段を線形に補間する
+	Vector4 SampleTexture(const SoftwareTexture& texture, float u, float v, float dudx, float dvdx, float dudy, float dvdy) {
+		const SoftwareTextureMip& top = texture.mips[0];
+		const float lengthX = std::sqrt(dudx * dudx * float(top.width) * float(top.width) + dvdx * dvdx * float(top.height) * float(top.height));
+		const float lengthY = std::sqrt(dudy * dudy * float(top.width) * float(top.width) + dvdy * dvdy * float(top.height) * float(top.height));
+		const float maxLod = float(texture.mips.size() - 1);
+		const float lod = std::clamp(std::log2((std::max)((std::max)(lengthX, lengthY), 1e-8f)), 0.0f, maxLod);
+		const uint32_t mip0 = uint32_t(lod);
+		const float fraction = lod - float(mip0);
+		const Vector4 color0 = SampleBilinear(texture.mips[mip0], texture.srgb, u, v);
+		if (fraction <= 0.0f || mip0 + 1 >= texture.mips.size()) {
+			return color0;
+		}
+		const Vector4 color1 = SampleBilinear(texture.mips[mip0 + 1], texture.srgb, u, v);
+		return { color0.x + (color1.x - color0.x) * fraction, color0.y + (color1.y - color0.y) * fraction,
+			color0.z + (color1.z - color0.z) * fraction, color0.w + (color1.w - color0.w) * fraction };
+	}
+
+	// クリップ空間の平面。dot(plane, position) >= 0 が内側
+	struct ClipPlane {
+		float x, y, z, w;
+	};
+	// 近平面、遠平面、ガードバンドの左右上下
+	const ClipPlane kClipPlanes[] = {
+		{ 0.0f, 0.0f, 1.0f, 0.0f },
+		{ 0.0f, 0.0f, -1.0f, 1.0f },
+		{ 1.0f, 0.0f, 0.0f, kGuardBand },
+		{ -1.0f, 0.0f, 0.0f, kGuardBand },
+		{ 0.0f, 1.0f, 0.0f, kGuardBand },
+		{ 0.0f, -1.0f, 0.0f, kGuardBand },
+	};
+	const uint32_t kClipPlaneCount = uint32_t(std::size(kClipPlanes));
+	// 視錐台の左右上下。全ての頂点が同じ平面の外なら描かない
+	const ClipPlane kViewportPlanes[] = {
+		{ 1.0f, 0.0f, 0.0f, 1.0f },
+		{ -1.0f, 0.0f, 0.0f, 1.0f },
+		{ 0.0f, 1.0f, 0.0f, 1.0f },
+		{ 0.0f, -1.0f, 0.0f, 1.0f },
+	};
+
+	float PlaneDistance(const ClipPlane& plane, const Vector4& position) {
+		return plane.x * position.x + plane.y * position.y + plane.z * position.z + plane.w * position.w;
+	}
+
+	// 頂点の位置を1/256ピクセルに揃える
+	float Snap(float value) {
+		return std::round(value * kSubpixelScale) / kSubpixelScale;
+	}
+}
+
+void SoftwareRasterizer::Initialize(uint32_t width, uint32_t height, JobSystem* jobSystem) {
+	assert(width > 0 && height > 0);
+	width_ = width;
+	height_ = height;
+	stride_ = (width + 3) & ~3u;
+	tileCountX_ = (width + kTileSize - 1) / kTileSize;
+	tileCountY_ = (height + kTileSize - 1) / kTileSize;
+	jobSystem_ = jobSystem;
+	colorBuffer_.assign(size_t(stride_) * height_, 0);
+	depthBuffer_.assign(size_t(stride_) * height_, 1.0f);
+	GetColorTables();
+}
+
+void SoftwareRasterizer::SetDirectionalLight(const Vector4& color, const Vector3& direction, float intensity) {
+	lightColor_ = color;
+	lightDirection_ = direction;
+	lightIntensity_ = intensity;
+}
+
+void SoftwareRasterizer::Clear(const Vector4& color, float depth) {
+	std::fill(colorBuffer_.begin(), colorBuffer_.end(), EncodeColor(color));
+	std::fill(depthBuffer_.begin(), depthBuffer_.end(), depth);
+}
+
+void SoftwareRasterizer::Draw(const SoftwareDrawDesc& desc) {
+	assert(desc.vertices && (!desc.texture || !desc.texture->mips.empty()));
+	draws_.push_back(desc);
+}
+
+void SoftwareRasterizer::Execute() {
+	PROFILE_SCOPE("SoftwareRasterizer");
+	using Clock = std::chrono::steady_clock;
+	const Clock::time_point start = Clock::now();
+	stats_ = {};
+	stats_.drawCount = uint32_t(draws_.size());
+
+	// 描画ごとに三角形をまとまりに分ける。まとまりの並びがそのまま描画の順になる
+	uint32_t chunkCount = 0;
+	for (uint32_t draw = 0; draw < draws_.size(); ++draw) {
+		const SoftwareDrawDesc& desc = draws_[draw];
+		const uint32_t triangleCount = (desc.indices ? desc.indexCount : desc.vertexCount) / 3;
+		stats_.triangleCount += triangleCount;
+		for (uint32_t first = 0; first < triangleCount; first += kTriangleChunkSize) {
+			if (chunkCount == chunks_.size()) {
+				chunks_.emplace_back();
+			}
+			Chunk& chunk = chunks_[chunkCount++];
+			chunk.draw = draw;
+			chunk.firstTriangle = first;
+			chunk.triangleCount = (std::min)(kTriangleChunkSize, triangleCount - first);
+		}
+	}
+	clipVertices_.resize(draws_.size());
+
+	// 頂点の変換 -> 三角形の設定と振り分け -> タイルごとのラスタライズの順に、TaskGraphで並列に行う
+	taskGraph_.Clear();
+	Clock::time_point geometryEnd = start;
+	const uint32_t binTask = taskGraph_.AddTask("SoftwareRasterizer Bin", [&](uint32_t) { geometryEnd = Clock::now(); });
+	uint32_t chunk = 0;
+	for (uint32_t draw = 0; draw < draws_.size(); ++draw) {
+		const uint32_t vertexCount = draws_[draw].vertexCount;
+		clipVertices_[draw].resize(vertexCount);
+		const uint32_t verticesReady = taskGraph_.AddTask("SoftwareRasterizer Vertices", nullptr);
+		for (uint32_t first = 0; first < vertexCount; first += kVertexChunkSize) {
+			const uint32_t count = (std::min)(kVertexChunkSize, vertexCount - first);
+			const uint32_t vertexTask = taskGraph_.AddTask("SoftwareRasterizer Vertex", [this, draw, first, count](uint32_t) {
+				TransformVertices(draw, first, count);
+			});
+			taskGraph_.AddDependency(vertexTask, verticesReady);
+		}
+		for (; chunk < chunkCount && chunks_[chunk].draw == draw; ++chunk) {
+			const uint32_t setupTask = taskGraph_.AddTask("SoftwareRasterizer Setup", [this, chunk](uint32_t) {
+				SetupTriangles(chunks_[chunk]);
+			});
+			taskGraph_.AddDependency(verticesReady, setupTask);
+			taskGraph_.AddDependency(setupTask, binTask);
+		}
+	}
+	// タイルごとの重さは偏るので、ParallelForで空いたワーカーに少しずつ渡す
+	std::atomic<uint64_t> shadedPixelCount{ 0 };
+	const uint32_t tileCount = tileCountX_ * tileCountY_;
+	const uint32_t rasterTask = taskGraph_.AddTask("SoftwareRasterizer Raster", [&](uint32_t) {
+		jobSystem_->ParallelFor(tileCount, 1, [&](uint32_t begin, uint32_t end, uint32_t) {
+			uint64_t shaded = 0;
+			for (uint32_t tile = begin; tile < end; ++tile) {
+				RasterizeTile(tile, shaded);
+			}
+			shadedPixelCount.fetch_add(shaded, std::memory_order_relaxed);
+		});
+	});
+	taskGraph_.AddDependency(binTask, rasterTask);
+	// 前のExecuteで使ったまとまりが残っていれば、RasterizeTileが飛ばすように空にしておく
+	for (uint32_t index = chunkCount; index < chunks_.size(); ++index) {
+		chunks_[index].triangleCount = 0;
+	}
+	taskGraph_.Execute(*jobSystem_);
+	const Clock::time_point end = Clock::now();
+
+	for (uint32_t index = 0; index < chunkCount; ++index) {
+		const SoftwareRasterizerStats& chunkStats = chunks_[index].stats;
+		stats_.culledTriangleCount += chunkStats.culledTriangleCount;
+		stats_.clippedTriangleCount += chunkStats.clippedTriangleCount;
+		stats_.rasterizedTriangleCount += chunkStats.rasterizedTriangleCount;
+		stats_.binnedTriangleCount += chunkStats.binnedTriangleCount;
+	}
+	stats_.shadedPixelCount = shadedPixelCount.load();
+	stats_.geometryMilliseconds = std::chrono::duration<double, std::milli>(geometryEnd - start).count();
+	stats_.rasterMilliseconds = std::chrono::duration<double, std::milli>(end - geometryEnd).count();
+	draws_.clear();
+}
+
+void SoftwareRasterizer::TransformVertices(uint32_t draw, uint32_t first, uint32_t count) {
+	// Object3d.VS.hlslと同じ計算。行列は行ベクトルに右から掛ける
+	const SoftwareDrawDesc& desc = draws_[draw];
+	const float (*wvp)[4] = desc.wvp.m;
+	const float (*world)[4] = desc.world.m;
+	ClipVertex* output = clipVertices_[draw].data();
+	for (uint32_t index = first; index < first + count; ++index) {
+		const VertexData& vertex = desc.vertices[index];
+		const Vector4& position = vertex.position;
+		ClipVertex& clipVertex = output[index];
+		clipVertex.position = {
+			position.x * wvp[0][0] + position.y * wvp[1][0] + position.z * wvp[2][0] + position.w * wvp[3][0],
+			position.x * wvp[0][1] + position.y * wvp[1][1] + position.z * wvp[2][1] + position.w * wvp[3][1],
+			position.x * wvp[0][2] + position.y * wvp[1][2] + position.z * wvp[2][2] + position.w * wvp[3][2],
+			position.x * wvp[0][3] + position.y * wvp[1][3] + position.z * wvp[2][3] + position.w * wvp[3][3],
+		};
+		// TEXCOORDを使わない組み合わせでも、テクスチャが無ければUVは色に影響しない
+		clipVertex.texcoord[0] = vertex.texcoord.u;
+		clipVertex.texcoord[1] = vertex.texcoord.v;
+		const Vector3& normal = vertex.normal;
+		float transformed[3] = {
+			normal.x * world[0][0] + normal.y * world[1][0] + normal.z * world[2][0],
+			normal.x * world[0][1] + normal.y * world[1][1] + normal.z * world[2][1],
+			normal.x * world[0][2] + normal.y * world[1][2] + normal.z * world[2][2],
+		};
+		const float length = std::sqrt(transformed[0] * transformed[0] + transformed[1] * transformed[1] + transformed[2] * transformed[2]);
+		const float inverseLength = length > 0.0f ? 1.0f / length : 0.0f;
+		for (uint32_t axis = 0; axis < 3; ++axis) {
+			clipVertex.normal[axis] = transformed[axis] * inverseLength;
+		}
+	}
+}
+
+void SoftwareRasterizer::SetupTriangles(Chunk& chunk) {
+	const SoftwareDrawDesc& desc = draws_[chunk.draw];
+	const ClipVertex* vertices = clipVertices_[chunk.draw].data();
+	chunk.triangles.clear();
+	chunk.binEntries.clear();
+	chunk.stats = {};
+	for (uint32_t triangle = chunk.firstTriangle; triangle < chunk.firstTriangle + chunk.triangleCount; ++triangle) {
+		ClipVertex polygon[kMaxClipVertices];
+		for (uint32_t corner = 0; corner < 3; ++corner) {
+			const uint32_t index = desc.indices ? desc.indices[triangle * 3 + corner] : triangle * 3 + corner;
+			assert(index < desc.vertexCount);
+			polygon[corner] = vertices[index];
+		}
+
+		// 全ての頂点が同じ平面の外にあれば描かない
+		bool outside = false;
+		for (const ClipPlane& plane : kViewportPlanes) {
+			outside = outside || (PlaneDistance(plane, polygon[0].position) < 0.0f &&
+				PlaneDistance(plane, polygon[1].position) < 0.0f && PlaneDistance(plane, polygon[2].position) < 0.0f);
+		}
+		for (uint32_t plane = 0; plane < 2; ++plane) {
+			outside = outside || (PlaneDistance(kClipPlanes[plane], polygon[0].position) < 0.0f &&
+				PlaneDistance(kClipPlanes[plane], polygon[1].position) < 0.0f && PlaneDistance(kClipPlanes[plane], polygon[2].position) < 0.0f);
+		}
+		if (outside) {
+			++chunk.stats.culledTriangleCount;
+			continue;
+		}
+
+		// 近平面、遠平面、ガードバンドの外にはみ出していれば切る。属性はクリップ空間で線形に補間する
+		uint32_t vertexCount = 3;
+		bool clipped = false;
+		for (const ClipPlane& plane : kClipPlanes) {
+			float distances[kMaxClipVertices];
+			bool anyOutside = false;
+			for (uint32_t index = 0; index < vertexCount; ++index) {
+				distances[index] = PlaneDistance(plane, polygon[index].position);
+				anyOutside = anyOutside || distances[index] < 0.0f;
+			}
+			if (!anyOutside) {
+				continue;
+			}
+			clipped = true;
+			ClipVertex result[kMaxClipVertices];
+			uint32_t resultCount = 0;
+			for (uint32_t index = 0; index < vertexCount; ++index) {
+				const uint32_t next = (index + 1) % vertexCount;
+				const ClipVertex& current = polygon[index];
+				const ClipVertex& following = polygon[next];
+				if (distances[index] >= 0.0f) {
+					result[resultCount++] = current;
+				}
+				if ((distances[index] >= 0.0f) != (distances[next] >= 0.0f)) {
+					const float t = distances[index] / (distances[index] - distances[next]);
+					ClipVertex& vertex = result[resultCount++];
+					vertex.position = { current.position.x + (following.position.x - current.position.x) * t,
+						current.position.y + (following.position.y - current.position.y) * t,
+						current.position.z + (following.position.z - current.position.z) * t,
+						current.position.w + (following.position.w - current.position.w) * t };
+					for (uint32_t axis = 0; axis < 2; ++axis) {
+						vertex.texcoord[axis] = current.texcoord[axis] + (following.texcoord[axis] - current.texcoord[axis]) * t;
+					}
+					for (uint32_t axis = 0; axis < 3; ++axis) {
+						vertex.normal[axis] = current.normal[axis] + (following.normal[axis] - current.normal[axis]) * t;
+					}
+				}
+			}
+			std::copy(result, result + resultCount, polygon);
+			vertexCount = resultCount;
+			if (vertexCount < 3) {
+				break;
+			}
+		}
+		if (clipped) {
+			++chunk.stats.clippedTriangleCount;
+		}
+		const size_t before = chunk.triangles.size();
+		if (vertexCount >= 3) {
+			AddPolygon(chunk, polygon, vertexCount);
+		}
+		if (chunk.triangles.size() == before) {
+			++chunk.stats.culledTriangleCount;
+		}
+	}
+	chunk.stats.rasterizedTriangleCount = uint32_t(chunk.triangles.size());
+	BinTriangles(chunk);
+}
+
+void SoftwareRasterizer::AddPolygon(Chunk& chunk, const ClipVertex* vertices, uint32_t vertexCount) {
+	// 画面の座標にする。yは下向き、深度はビューポートの0から1
+	struct ScreenVertex {
+		float x, y, z, invW;
+	};
+	ScreenVertex screen[kMaxClipVertices];
+	for (uint32_t index = 0; index < vertexCount; ++index) {
+		const Vector4& position = vertices[index].position;
+		const float invW = 1.0f / position.w;
+		screen[index].x = Snap((position.x * invW * 0.5f + 0.5f) * float(width_));
+		screen[index].y = Snap((0.5f - position.y * invW * 0.5f) * float(height_));
+		screen[index].z = position.z * invW;
+		screen[index].invW = invW;
+	}
+
+	for (uint32_t fan = 1; fan + 1 < vertexCount; ++fan) {
+		const uint32_t corners[3] = { 0, fan, fan + 1 };
+		const ScreenVertex& v0 = screen[corners[0]];
+		const ScreenVertex& v1 = screen[corners[1]];
+		const ScreenVertex& v2 = screen[corners[2]];
+		// 画面上で時計回りなら正になる。裏面(反時計回り)と面積の無いものは描かない
+		const float area = (v2.x - v1.x) * (v0.y - v1.y) - (v2.y - v1.y) * (v0.x - v1.x);
+		if (!(area > 0.0f)) {
+			continue;
+		}
+		// ピクセルの中心(+0.5)が入りうる範囲
+		const float minX = (std::min)({ v0.x, v1.x, v2.x });
+		const float maxX = (std::max)({ v0.x, v1.x, v2.x });
+		const float minY = (std::min)({ v0.y, v1.y, v2.y });
+		const float maxY = (std::max)({ v0.y, v1.y, v2.y });
+		Triangle triangle{};
+		triangle.minX = (std::max)(int32_t(std::ceil(minX - 0.5f)), 0);
+		triangle.minY = (std::max)(int32_t(std::ceil(minY - 0.5f)), 0);
+		triangle.maxX = (std::min)(int32_t(std::floor(maxX - 0.5f)) + 1, int32_t(width_));
+		triangle.maxY = (std::min)(int32_t(std::floor(maxY - 0.5f)) + 1, int32_t(height_));
+		if (triangle.minX >= triangle.maxX || triangle.minY >= triangle.maxY) {
+			continue;
+		}
+		triangle.draw = chunk.draw;
+		triangle.originX = v0.x;
+		triangle.originY = v0.y;
+		triangle.inverseArea = 1.0f / area;
+		// i番の辺は(i+1)番から(i+2)番の頂点へ向かう。0番の頂点を通らないのは0番の辺だけ
+		for (uint32_t edge = 0; edge < 3; ++edge) {
+			const ScreenVertex& from = screen[corners[(edge + 1) % 3]];
+			const ScreenVertex& to = screen[corners[(edge + 2) % 3]];
+			const float dx = to.x - from.x;
+			const float dy = to.y - from.y;
+			triangle.edgeA[edge] = -dy;
+			triangle.edgeB[edge] = dx;
+			triangle.edgeC[edge] = edge == 0 ? area : 0.0f;
+			// 時計回りでは、上の辺は右向き、左の辺は上向き
+			triangle.topLeft[edge] = dy < 0.0f || (dy == 0.0f && dx > 0.0f);
+		}
+		for (uint32_t corner = 0; corner < 3; ++corner) {
+			const ClipVertex& vertex = vertices[corners[corner]];
+			const ScreenVertex& screenVertex = screen[corners[corner]];
+			triangle.z[corner] = screenVertex.z;
+			triangle.invW[corner] = screenVertex.invW;
+			for (uint32_t axis = 0; axis < 2; ++axis) {
+				triangle.texcoord[corner][axis] = vertex.texcoord[axis] * screenVertex.invW;
+			}
+			for (uint32_t axis = 0; axis < 3; ++axis) {
+				triangle.normal[corner][axis] = vertex.normal[axis] * screenVertex.invW;
+			}
+		}
+		// 重みの変化はA/area, B/areaなので、u/w, v/w, 1/wの変化もそこから求まる
+		const float values[3][3] = {
+			{ triangle.texcoord[0][0], triangle.texcoord[1][0], triangle.texcoord[2][0] },
+			{ triangle.texcoord[0][1], triangle.texcoord[1][1], triangle.texcoord[2][1] },
+			{ triangle.invW[0], triangle.invW[1], triangle.invW[2] },
+		};
+		for (uint32_t attribute = 0; attribute < 3; ++attribute) {
+			float gradientX = 0.0f;
+			float gradientY = 0.0f;
+			for (uint32_t corner = 0; corner < 3; ++corner) {
+				gradientX += triangle.edgeA[corner] * values[attribute][corner];
+				gradientY += triangle.edgeB[corner] * values[attribute][corner];
+			}
+			triangle.gradients[attribute][0] = gradientX * triangle.inverseArea;
+			triangle.gradients[attribute][1] = gradientY * triangle.inverseArea;
+		}
+		chunk.triangles.push_back(triangle);
+	}
+}
+
+void SoftwareRasterizer::BinTriangles(Chunk& chunk) {
+	const uint32_t tileCount = tileCountX_ * tileCountY_;
+	// 三角形の範囲に重なるタイルに入れる
+	for (uint32_t index = 0; index < chunk.triangles.size(); ++index) {
+		const Triangle& triangle = chunk.triangles[index];
+		const uint32_t tileMinX = uint32_t(triangle.minX) / kTileSize;
+		const uint32_t tileMinY = uint32_t(triangle.minY) / kTileSize;
+		const uint32_t tileMaxX = uint32_t(triangle.maxX - 1) / kTileSize;
+		const uint32_t tileMaxY = uint32_t(triangle.maxY - 1) / kTileSize;
+		for (uint32_t tileY = tileMinY; tileY <= tileMaxY; ++tileY) {
+			for (uint32_t tileX = tileMinX; tileX <= tileMaxX; ++tileX) {
+				chunk.binEntries.push_back((uint64_t(tileY * tileCountX_ + tileX) << 32) | index);
+			}
+		}
+	}
+	chunk.stats.binnedTriangleCount = chunk.binEntries.size();
+
+	// タイルごとに数えてから並べる。同じタイルの中では三角形の順のまま
+	chunk.binOffsets.assign(size_t(tileCount) + 1, 0);
+	for (uint64_t entry : chunk.binEntries) {
+		++chunk.binOffsets[(entry >> 32) + 1];
+	}
+	for (uint32_t tile = 0; tile < tileCount; ++tile) {
+		chunk.binOffsets[tile + 1] += chunk.binOffsets[tile];
+	}
+	chunk.binTriangles.resize(chunk.binEntries.size());
+	ScratchScope scratch;
+	ScratchVector<uint32_t> positions(chunk.binOffsets.begin(), chunk.binOffsets.end() - 1);
+	for (uint64_t entry : chunk.binEntries) {
+		chunk.binTriangles[positions[entry >> 32]++] = uint32_t(entry);
+	}
+}
+
+void SoftwareRasterizer::RasterizeTile(uint32_t tile, uint64_t& shadedPixelCount) {
+	const int32_t tileMinX = int32_t((tile % tileCountX_) * kTileSize);
+	const int32_t tileMinY = int32_t((tile / tileCountX_) * kTileSize);
+	const int32_t tileMaxX = (std::min)(tileMinX + int32_t(kTileSize), int32_t(width_));
+	const int32_t tileMaxY = (std::min)(tileMinY + int32_t(kTileSize), int32_t(height_));
+	// まとまりの順に、まとまりの中は三角形の順に描く。スレッドの数に関係なく同じ順になる
+	for (const Chunk& chunk : chunks_) {
+		if (chunk.triangleCount == 0) {
+			continue;
+		}
+		for (uint32_t entry = chunk.binOffsets[tile]; entry < chunk.binOffsets[tile + 1]; ++entry) {
+			RasterizeTriangle(chunk.triangles[chunk.binTriangles[entry]], tileMinX, tileMinY, tileMaxX, tileMaxY, shadedPixelCount);
+		}
+	}
+}
+
+void SoftwareRasterizer::RasterizeTriangle(const Triangle& triangle, int32_t tileMinX, int32_t tileMinY, int32_t tileMaxX, int32_t tileMaxY, uint64_t& shadedPixelCount) {
+	const int32_t minX = (std::max)(triangle.minX, tileMinX) & ~3;
+	const int32_t minY = (std::max)(triangle.minY, tileMinY);
+	const int32_t maxX = (std::min)(triangle.maxX, tileMaxX);
+	const int32_t maxY = (std::min)(triangle.maxY, tileMaxY);
+	if (minX >= maxX || minY >= maxY) {
+		return;
+	}
+
+	// 4ピクセルずつ辺の式を計算する。値は三角形の0番の頂点からの差で、タイルの位置によらず同じになる
+	const __m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+	const __m128i laneIndices = _mm_setr_epi32(0, 1, 2, 3);
+	const __m128 zero = _mm_setzero_ps();
+	__m128 edgeA[3];
+	__m128 edgeB[3];
+	__m128 edgeC[3];
+	for (uint32_t edge = 0; edge < 3; ++edge) {
+		edgeA[edge] = _mm_set1_ps(triangle.edgeA[edge]);
+		edgeB[edge] = _mm_set1_ps(triangle.edgeB[edge]);
+		edgeC[edge] = _mm_set1_ps(triangle.edgeC[edge]);
+	}
+	const __m128 inverseArea = _mm_set1_ps(triangle.inverseArea);
+	const __m128 z0 = _mm_set1_ps(triangle.z[0]);
+	const __m128 z10 = _mm_set1_ps(triangle.z[1] - triangle.z[0]);
+	const __m128 z20 = _mm_set1_ps(triangle.z[2] - triangle.z[0]);
+	const __m128i end = _mm_set1_epi32(maxX);
+
+	for (int32_t y = minY; y < maxY; ++y) {
+		const __m128 dy = _mm_set1_ps(float(y) + 0.5f - triangle.originY);
+		__m128 rowEdges[3];
+		for (uint32_t edge = 0; edge < 3; ++edge) {
+			rowEdges[edge] = _mm_add_ps(_mm_mul_ps(edgeB[edge], dy), edgeC[edge]);
+		}
+		float* depthRow = depthBuffer_.data() + size_t(y) * stride_;
+		uint32_t* colorRow = colorBuffer_.data() + size_t(y) * stride_;
+		for (int32_t x = minX; x < maxX; x += 4) {
+			const __m128 dx = _mm_add_ps(_mm_set1_ps(float(x) - triangle.originX), laneOffsets);
+			__m128 edges[3];
+			// タイルの右端より先のピクセルは含めない
+			__m128 mask = _mm_castsi128_ps(_mm_cmplt_epi32(_mm_add_epi32(_mm_set1_epi32(x), laneIndices), end));
+			for (uint32_t edge = 0; edge < 3; ++edge) {
+				edges[edge] = _mm_add_ps(_mm_mul_ps(edgeA[edge], dx), rowEdges[edge]);
+				mask = _mm_and_ps(mask, triangle.topLeft[edge] ? _mm_cmpge_ps(edges[edge], zero) : _mm_cmpgt_ps(edges[edge], zero));
+			}
+			if (_mm_movemask_ps(mask) == 0) {
+				continue;
+			}
+			const __m128 b1 = _mm_mul_ps(edges[1], inverseArea);
+			const __m128 b2 = _mm_mul_ps(edges[2], inverseArea);
+			const __m128 depth = _mm_add_ps(z0, _mm_add_ps(_mm_mul_ps(b1, z10), _mm_mul_ps(b2, z20)));
+			// 深度テストはLESS_EQUAL。4ピクセルとも同じタイルの中なので、まとめて書き戻してよい
+			const __m128 oldDepth = _mm_loadu_ps(depthRow + x);
+			mask = _mm_and_ps(mask, _mm_cmple_ps(depth, oldDepth));
+			const int32_t laneMask = _mm_movemask_ps(mask);
+			if (laneMask == 0) {
+				continue;
+			}
+			_mm_storeu_ps(depthRow + x, _mm_or_ps(_mm_and_ps(mask, depth), _mm_andnot_ps(mask, oldDepth)));
+			alignas(16) float weights1[4];
+			alignas(16) float weights2[4];
+			_mm_store_ps(weights1, b1);
+			_mm_store_ps(weights2, b2);
+			for (int32_t lane = 0; lane < 4; ++lane) {
+				if (laneMask & (1 << lane)) {
+					const Vector4 color = ShadePixel(triangle, 1.0f - weights1[lane] - weights2[lane], weights1[lane], weights2[lane]);
+					colorRow[x + lane] = EncodeColor(color);
+					++shadedPixelCount;
+				}
+			}
+		}
+	}
+}
+
+Vector4 SoftwareRasterizer::ShadePixel(const Triangle& triangle, float b0, float b1, float b2) const {
+	const SoftwareDrawDesc& desc = draws_[triangle.draw];
+	// 1/wで割ってパースペクティブ補正する
+	const float invW = b0 * triangle.invW[0] + b1 * triangle.invW[1] + b2 * triangle.invW[2];
+	const float w = 1.0f / invW;
+	auto interpolate = [&](float a0, float a1, float a2) {
+		return (b0 * a0 + b1 * a1 + b2 * a2) * w;
+	};
+
+	Vector4 textureColor{ 1.0f, 1.0f, 1.0f, 1.0f };
+	if (desc.texture) {
+		const float u = interpolate(triangle.texcoord[0][0], triangle.texcoord[1][0], triangle.texcoord[2][0]);
+		const float v = interpolate(triangle.texcoord[0][1], triangle.texcoord[1][1], triangle.texcoord[2][1]);
+		// u = (u/w) / (1/w) の画面上の変化
+		const float dudx = (triangle.gradients[0][0] - u * triangle.gradients[2][0]) * w;
+		const float dudy = (triangle.gradients[0][1] - u * triangle.gradients[2][1]) * w;
+		const float dvdx = (triangle.gradients[1][0] - v * triangle.gradients[2][0]) * w;
+		const float dvdy = (triangle.gradients[1][1] - v * triangle.gradients[2][1]) * w;
+		// mul(float4(uv, 0, 1), uvTransform)
+		const float (*uvTransform)[4] = desc.uvTransform.m;
+		const float transformedU = u * uvTransform[0][0] + v * uvTransform[1][0] + uvTransform[3][0];
+		const float transformedV = u * uvTransform[0][1] + v * uvTransform[1][1] + uvTransform[3][1];
+		textureColor = SampleTexture(*desc.texture, transformedU, transformedV,
+			dudx * uvTransform[0][0] + dvdx * uvTransform[1][0], dudx * uvTransform[0][1] + dvdx * uvTransform[1][1],
+			dudy * uvTransform[0][0] + dvdy * uvTransform[1][0], dudy * uvTransform[0][1] + dvdy * uvTransform[1][1]);
+	}
+
+	Vector4 color{ desc.color.x * textureColor.x, desc.color.y * textureColor.y, desc.color.z * textureColor.z, desc.color.w * textureColor.w };
+	if (desc.lighting) {
+		// half lambert
+		float normal[3] = {
+			interpolate(triangle.normal[0][0], triangle.normal[1][0], triangle.normal[2][0]),
+			interpolate(triangle.normal[0][1], triangle.normal[1][1], triangle.normal[2][1]),
+			interpolate(triangle.normal[0][2], triangle.normal[1][2], triangle.normal[2][2]),
+		};
+		const float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		const float inverseLength = length > 0.0f ? 1.0f / length : 0.0f;
+		const float nDotL = -(normal[0] * lightDirection_.x + normal[1] * lightDirection_.y + normal[2] * lightDirection_.z) * inverseLength;
+		const float halfLambert = nDotL * 0.5f + 0.5f;
+		const float scale = halfLambert * halfLambert * lightIntensity_;
+		color = { color.x * lightColor_.x * scale, color.y * lightColor_.y * scale, color.z * lightColor_.z * scale, color.w * lightColor_.w * scale };
+	}
+	return color;
+}
+
+uint32_t CountDifferentPixels(const uint32_t* pixels, uint32_t rowPitch, const uint32_t* expectedPixels, uint32_t expectedRowPitch,
+	uint32_t width, uint32_t height, uint32_t tolerance) {
+	uint32_t count = 0;
+	for (uint32_t y = 0; y < height; ++y) {
+		for (uint32_t x = 0; x < width; ++x) {
+			const uint32_t pixel = pixels[size_t(y) * rowPitch + x];
+			const uint32_t expected = expectedPixels[size_t(y) * expectedRowPitch + x];
+			for (uint32_t shift = 0; shift < 32; shift += 8) {
+				const int32_t difference = int32_t((pixel >> shift) & 0xFF) - int32_t((expected >> shift) & 0xFF);
+				if (uint32_t(std::abs(difference)) > tolerance) {
+					++count;
+					break;
+				}
+			}
+		}
+	}
+	return count;
+}
+
+SoftwareRasterizerBenchmark MeasureSoftwareRasterizer(uint32_t width, uint32_t height, uint32_t threadCount, uint32_t iterations) {
+	using Clock = std::chrono::steady_clock;
+	// 球を格子状に並べ、手前から奥まで重なるようにする
+	const PrimitiveDesc sphereDesc{ PrimitiveType::Sphere, 32, 0.0f };
+	std::vector<VertexData> vertices(GetPrimitiveVertexCount(sphereDesc));
+	std::vector<uint32_t> indices(GetPrimitiveIndexCount(sphereDesc));
+	WritePrimitive(sphereDesc, vertices.data(), indices.data());
+	// チェック柄のテクスチャとMip
+	std::vector<std::vector<uint8_t>> mipPixels;
+	SoftwareTexture texture{ {}, true };
+	for (uint32_t size = 256; size > 0; size /= 2) {
+		std::vector<uint8_t>& pixels = mipPixels.emplace_back(size_t(size) * size * 4);
+		for (uint32_t y = 0; y < size; ++y) {
+			for (uint32_t x = 0; x < size; ++x) {
+				const uint8_t value = ((x * 256 / size / 32 + y * 256 / size / 32) % 2) ? 255 : 64;
+				uint8_t* pixel = &pixels[(size_t(y) * size + x) * 4];
+				pixel[0] = value;
+				pixel[1] = uint8_t(255 - value);
+				pixel[2] = 128;
+				pixel[3] = 255;
+			}
+		}
+	}
+	for (uint32_t mip = 0, size = 256; size > 0; ++mip, size /= 2) {
+		texture.mips.push_back({ mipPixels[mip].data(), size, size, size * 4 });
+	}
+
+	const mat4x4 projection = MakePerspectiveFovMatrix(0.45f, float(width) / float(height), 0.1f, 100.0f);
+	auto render = [&](SoftwareRasterizer& rasterizer) {
+		rasterizer.Clear({ 0.1f, 0.25f, 0.5f, 1.0f }, 1.0f);
+		rasterizer.SetDirectionalLight({ 1.0f, 1.0f, 1.0f, 1.0f }, { 0.0f, -1.0f, 0.0f }, 1.0f);
+		for (int32_t z = 0; z < 8; ++z) {
+			for (int32_t y = -3; y <= 3; ++y) {
+				for (int32_t x = -4; x <= 4; ++x) {
+					const mat4x4 world = MakeAffineMatrix({ 1.0f, 1.0f, 1.0f }, { 0.0f, float(x + y), 0.0f },
+						{ float(x) * 1.5f, float(y) * 1.5f, 10.0f + float(z) * 3.0f });
+					SoftwareDrawDesc desc{};
+					desc.vertices = vertices.data();
+					desc.vertexCount = uint32_t(vertices.size());
+					desc.indices = indices.data();
+					desc.indexCount = uint32_t(indices.size());
+					desc.wvp = Mul(world, projection);
+					desc.world = world;
+					desc.color = { 1.0f, 1.0f, 1.0f, 1.0f };
+					desc.uvTransform = MakeIdentity4x4();
+					desc.texture = &texture;
+					desc.lighting = true;
+					rasterizer.Draw(desc);
+				}
+			}
+		}
+		rasterizer.Execute();
+	};
+
+	SoftwareRasterizerBenchmark result{};
+	result.threadCount = (std::max)(threadCount, 1u);
+	iterations = (std::max)(iterations, 1u);
+	// ワーカーの数だけを変えたJobSystemで比べる
+	JobSystem singleThreadJobSystem;
+	singleThreadJobSystem.Start(1);
+	JobSystem multiThreadJobSystem;
+	multiThreadJobSystem.Start(result.threadCount);
+	SoftwareRasterizer singleThread;
+	singleThread.Initialize(width, height, &singleThreadJobSystem);
+	SoftwareRasterizer multiThread;
+	multiThread.Initialize(width, height, &multiThreadJobSystem);
+	auto measure = [&](SoftwareRasterizer& rasterizer) {
+		const Clock::time_point start = Clock::now();
+		for (uint32_t iteration = 0; iteration < iterations; ++iteration) {
+			render(rasterizer);
+		}
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count() / iterations;
+	};
+	result.singleThreadMilliseconds = measure(singleThread);
+	result.multiThreadMilliseconds = measure(multiThread);
+	result.triangleCount = singleThread.GetStats().triangleCount;
+	// スレッドの数が違っても同じ画像になる
+	result.mismatchCount = CountDifferentPixels(singleThread.GetPixels(), singleThread.GetRowPitch(),
+		multiThread.GetPixels(), multiThread.GetRowPitch(), width, height, 0);
+	return result;
+}
\ No newline at end of file
@@ -0,0 +1,170 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "TaskGraph.h"
+#include "VertexData.h"
+#include "mat4x4.h"
+
+/// <summary>
+/// SoftwareRasterizerが読むテクスチャの1段のMip。ピクセルはR8G8B8A8
+/// </summary>
+struct SoftwareTextureMip {
+	const uint8_t* pixels;
+	uint32_t width;
+	uint32_t height;
+	uint32_t rowPitch; //!< 1行のバイト数
+};
+
+/// <summary>
+/// SoftwareRasterizerが読むテクスチャ。ピクセルは呼び出し側が持つ
+/// </summary>
+struct SoftwareTexture {
+	std::vector<SoftwareTextureMip> mips; //!< 0番が一番大きい
+	bool srgb; //!< R8G8B8A8_UNORM_SRGBならtrue。読むときにリニアにする
+};
+
+/// <summary>
+/// Object3dの1回の描画。定数バッファとシェーダーの組み合わせに当たるものを直接渡す
+/// </summary>
+struct SoftwareDrawDesc {
+	const VertexData* vertices;
+	uint32_t vertexCount;
+	const uint32_t* indices; //!< nullptrならインデックスなしで頂点を3つずつ使う
+	uint32_t indexCount;
+	mat4x4 wvp;
+	mat4x4 world;
+	Vector4 color; //!< Material::color
+	mat4x4 uvTransform; //!< Material::uvTransform
+	const SoftwareTexture* texture; //!< nullptrならTEXTUREなしの組み合わせと同じく白
+	bool lighting; //!< LIGHTINGありの組み合わせと同じくhalf lambertで照らす
+};
+
+/// <summary>
+/// SoftwareRasterizerの1回のExecuteの統計
+/// </summary>
+struct SoftwareRasterizerStats {
+	uint32_t drawCount;
+	uint32_t triangleCount; //!< 入力された三角形の数
+	uint32_t culledTriangleCount; //!< 視錐台の外か裏面で捨てた数
+	uint32_t clippedTriangleCount; //!< 近/遠平面かガードバンドで切った数
+	uint32_t rasterizedTriangleCount; //!< 切った後に画面に描いた三角形の数
+	uint64_t binnedTriangleCount; //!< タイルに振り分けた延べ数
+	uint64_t shadedPixelCount; //!< 深度テストを通って色を書いた数
+	double geometryMilliseconds; //!< 頂点の変換から振り分けまで
+	double rasterMilliseconds;
+};
+
+/// <summary>
+/// Object3d.VS.hlsl/Object3d.PS.hlsl と同じ処理をCPUで行うタイル単位のラスタライザ
+/// WVPの変換、パースペクティブ補正したUV、Mip間も線形に補間したラップのサンプリング、
+/// DirectionalLightのhalf lambert、LESS_EQUALの深度テストを行い、R8G8B8A8_UNORM_SRGBの画像に描く
+/// GPUの無い環境で描画結果を確かめるのに使う。描画はDrawの順に重なり、同じ入力なら同じ画像になる
+/// </summary>
+class SoftwareRasterizer {
+public:
+	// タイルの一辺のピクセル数。4の倍数
+	static const uint32_t kTileSize = 32;
+
+	// jobSystem: Executeで使う
+	void Initialize(uint32_t width, uint32_t height, JobSystem* jobSystem);
+
+	// DirectionalLightと同じ値
+	void SetDirectionalLight(const Vector4& color, const Vector3& direction, float intensity);
+	// colorはリニアの値。書くときにsRGBにする
+	void Clear(const Vector4& color, float depth);
+	// 描画を積む。頂点などのデータはExecuteが終わるまで残しておく
+	void Draw(const SoftwareDrawDesc& desc);
+	// 積んだ描画を全て描いて、積んだものを消す
+	void Execute();
+
+	uint32_t GetWidth() const { return width_; }
+	uint32_t GetHeight() const { return height_; }
+	// R8G8B8A8_UNORM_SRGBのピクセル。1行はGetRowPitch()要素
+	const uint32_t* GetPixels() const { return colorBuffer_.data(); }
+	uint32_t GetRowPitch() const { return stride_; }
+	const SoftwareRasterizerStats& GetStats() const { return stats_; }
+
+private:
+	// 変換後の頂点。位置はクリップ空間
+	struct ClipVertex {
+		Vector4 position;
+		float texcoord[2];
+		float normal[3];
+	};
+	// 画面に描く三角形。属性は1/wを掛けてあり、画面上で線形に補間できる
+	struct Triangle {
+		float originX; //!< 0番の頂点の位置。辺の式はここからの差で計算する
+		float originY;
+		float edgeA[3]; //!< i番の辺の式 E = A*(x - originX) + B*(y - originY) + C。向かいのi番の頂点の重みになる
+		float edgeB[3];
+		float edgeC[3];
+		bool topLeft[3]; //!< 辺の上に中心があるピクセルを含むか
+		float inverseArea;
+		float z[3];
+		float invW[3];
+		float texcoord[3][2]; //!< uv/w
+		float normal[3][3]; //!< normal/w
+		float gradients[3][2]; //!< u/w, v/w, 1/wの画面のx, yに対する変化。Mipを選ぶのに使う
+		int32_t minX, minY, maxX, maxY; //!< 中心が含まれうるピクセルの範囲。maxは含まない
+		uint32_t draw;
+	};
+	// 振り分けのまとまり。まとまりの中と、まとまりの間でDrawの順を保つ
+	struct Chunk {
+		uint32_t draw;
+		uint32_t firstTriangle;
+		uint32_t triangleCount;
+		std::vector<Triangle> triangles;
+		std::vector<uint64_t> binEntries; //!< タイル番号を上位32ビット、trianglesの番号を下位32ビットに詰めたもの
+		std::vector<uint32_t> binOffsets; //!< タイルごとのbinTrianglesの範囲。タイルの数+1要素
+		std::vector<uint32_t> binTriangles;
+		SoftwareRasterizerStats stats;
+	};
+
+	void TransformVertices(uint32_t draw, uint32_t first, uint32_t count);
+	void SetupTriangles(Chunk& chunk);
+	// クリップ空間で切った多角形を扇状に三角形にして、画面に描くものを加える
+	void AddPolygon(Chunk& chunk, const ClipVertex* vertices, uint32_t vertexCount);
+	// タイルごとに三角形の番号を並べる。まとまりの中の順は保つ
+	void BinTriangles(Chunk& chunk);
+	void RasterizeTile(uint32_t tile, uint64_t& shadedPixelCount);
+	void RasterizeTriangle(const Triangle& triangle, int32_t tileMinX, int32_t tileMinY, int32_t tileMaxX, int32_t tileMaxY, uint64_t& shadedPixelCount);
+	// Object3d.PS.hlslと同じ計算をする。b0, b1, b2は画面上の重み
+	Vector4 ShadePixel(const Triangle& triangle, float b0, float b1, float b2) const;
+
+	uint32_t width_ = 0;
+	uint32_t height_ = 0;
+	uint32_t stride_ = 0; //!< 1行の要素数。4の倍数に揃える
+	uint32_t tileCountX_ = 0;
+	uint32_t tileCountY_ = 0;
+	JobSystem* jobSystem_ = nullptr;
+	std::vector<uint32_t> colorBuffer_;
+	std::vector<float> depthBuffer_;
+	Vector4 lightColor_{ 1.0f, 1.0f, 1.0f, 1.0f };
+	Vector3 lightDirection_{ 0.0f, -1.0f, 0.0f };
+	float lightIntensity_ = 1.0f;
+
+	std::vector<SoftwareDrawDesc> draws_;
+	std::vector<std::vector<ClipVertex>> clipVertices_; //!< Drawごとの変換後の頂点
+	std::vector<Chunk> chunks_;
+	TaskGraph taskGraph_;
+	SoftwareRasterizerStats stats_{};
+};
+
+// 2枚のR8G8B8A8の画像で、どれかの成分の差がtoleranceより大きいピクセルの数を返す。ゴールデンイメージとの比較に使う
+// rowPitch: 1行の要素数
+uint32_t CountDifferentPixels(const uint32_t* pixels, uint32_t rowPitch, const uint32_t* expectedPixels, uint32_t expectedRowPitch,
+	uint32_t width, uint32_t height, uint32_t tolerance);
+
+/// <summary>
+/// MeasureSoftwareRasterizerの結果
+/// </summary>
+struct SoftwareRasterizerBenchmark {
+	uint32_t threadCount;
+	uint32_t triangleCount;
+	double singleThreadMilliseconds; //!< 1スレッドでの1フレームの時間
+	double multiThreadMilliseconds; //!< threadCountスレッドでの1フレームの時間
+	uint32_t mismatchCount; //!< 1スレッドと結果が違ったピクセルの数。0でなければならない
+};
+
+// 球を並べたシーンをwidth x heightに、ワーカーが1つとthreadCount個のJobSystemでiterations回描き、時間と結果を比べる
+SoftwareRasterizerBenchmark MeasureSoftwareRasterizer(uint32_t width, uint32_t height, uint32_t threadCount, uint32_t iterations);
\ No newline at end of file
@@ -0,0 +1,75 @@
+#include "SortKey.h"
+#include <cassert>
+#include <cstring>
+#include <utility>
+
+namespace SortKey {
+	namespace {
+		uint64_t Mask(uint32_t bits) { return (uint64_t(1) << bits) - 1; }
+	}
+
+	uint32_t DepthToBits(float depth) {
+		uint32_t bits = 0;
+		std::memcpy(&bits, &depth, sizeof(bits));
+		// 負の数は全bitを反転、正の数は符号bitを立てると整数の大小とfloatの大小が一致する
+		return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+	}
+
+	uint64_t Make(uint32_t pass, uint32_t pipeline, uint32_t material, float depth) {
+		assert(pass <= Mask(kPassBits));
+		assert(pipeline <= Mask(kPipelineBits));
+		assert(material <= Mask(kMaterialBits));
+		return (uint64_t(pass) << kPassShift) |
+			(uint64_t(pipeline) << kPipelineShift) |
+			(uint64_t(material) << kMaterialShift) |
+			(uint64_t(DepthToBits(depth)) << kDepthShift);
+	}
+
+	uint32_t GetPass(uint64_t key) { return uint32_t((key >> kPassShift) & Mask(kPassBits)); }
+	uint32_t GetPipeline(uint64_t key) { return uint32_t((key >> kPipelineShift) & Mask(kPipelineBits)); }
+	uint32_t GetMaterial(uint64_t key) { return uint32_t((key >> kMaterialShift) & Mask(kMaterialBits)); }
+	uint32_t GetDepthBits(uint64_t key) { return uint32_t((key >> kDepthShift) & Mask(kDepthBits)); }
+
+	void RadixSort(Item* items, Item* scratch, size_t count) {
+		const uint32_t kRadixBits = 8;
+		const uint32_t kRadix = 1 << kRadixBits;
+		const uint32_t kPassCount = 64 / kRadixBits;
+		if (count < 2) {
+			return;
+		}
+		// 全桁のヒストグラムを1回の走査でまとめて作る
+		size_t histograms[kPassCount][kRadix] = {};
+		for (size_t i = 0; i < count; ++i) {
+			uint64_t key = items[i].key;
+			for (uint32_t pass = 0; pass < kPassCount; ++pass) {
+				++histograms[pass][(key >> (pass * kRadixBits)) & (kRadix - 1)];
+			}
+		}
+
+		Item* src = items;
+		Item* dst = scratch;
+		for (uint32_t pass = 0; pass < kPassCount; ++pass) {
+			size_t* histogram = histograms[pass];
+			uint32_t shift = pass * kRadixBits;
+			// 全要素がこの桁で同じ値なら並べ替える必要がない
+			if (histogram[(src[0].key >> shift) & (kRadix - 1)] == count) {
+				continue;
+			}
+			// ヒストグラムを書き込み先の開始位置に変換する
+			size_t offset = 0;
+			for (uint32_t digit = 0; digit < kRadix; ++digit) {
+				size_t digitCount = histogram[digit];
+				histogram[digit] = offset;
+				offset += digitCount;
+			}
+			for (size_t i = 0; i < count; ++i) {
+				dst[histogram[(src[i].key >> shift) & (kRadix - 1)]++] = src[i];
+			}
+			std::swap(src, dst);
+		}
+		// 最終結果がscratch側にあればitemsへ戻す
+		if (src != items) {
+			std::memcpy(items, src, sizeof(Item) * count);
+		}
+	}
+}
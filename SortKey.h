@@ -0,0 +1,39 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// 描画順を決める64bitのソートキー。上位bitほど優先される
+// | pass(4bit) | pipeline(12bit) | material(16bit) | depth(32bit) |
+namespace SortKey {
+	const uint32_t kPassBits = 4;
+	const uint32_t kPipelineBits = 12;
+	const uint32_t kMaterialBits = 16;
+	const uint32_t kDepthBits = 32;
+
+	const uint32_t kDepthShift = 0;
+	const uint32_t kMaterialShift = kDepthShift + kDepthBits;
+	const uint32_t kPipelineShift = kMaterialShift + kMaterialBits;
+	const uint32_t kPassShift = kPipelineShift + kPipelineBits;
+
+	// floatの大小関係を保ったままuint32_tに変換する
+	uint32_t DepthToBits(float depth);
+
+	// ソートキーを作る。depthは小さいほど先に描画される
+	uint64_t Make(uint32_t pass, uint32_t pipeline, uint32_t material, float depth);
+
+	uint32_t GetPass(uint64_t key);
+	uint32_t GetPipeline(uint64_t key);
+	uint32_t GetMaterial(uint64_t key);
+	uint32_t GetDepthBits(uint64_t key);
+
+	/// <summary>
+	/// ソート対象。keyで並べ替え、indexで元の描画データを引く
+	/// </summary>
+	struct Item {
+		uint64_t key;
+		uint32_t index;
+	};
+
+	// 8bitずつのLSD基数ソート。安定ソートで、scratchはcount個以上必要
+	void RadixSort(Item* items, Item* scratch, size_t count);
+}
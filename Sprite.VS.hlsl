@@ -0,0 +1,22 @@
+#include "Sprite.hlsli"
+struct SpriteConstant {
+    matrix projection;
+};
+
+ConstantBuffer<SpriteConstant> gSpriteConstant : register(b0);
+
+struct VertexShaderInput
+{
+    float2 position : POSITION0;
+    float2 texcoord : TEXCOORD0;
+    float4 color : COLOR0;
+};
+
+VertexShaderOutput main(VertexShaderInput input)
+{
+    VertexShaderOutput output;
+    output.position = mul(float4(input.position, 0.0f, 1.0f), gSpriteConstant.projection);
+    output.texcoord = input.texcoord;
+    output.color = input.color;
+    return output;
+}
@@ -0,0 +1,113 @@
+#include "SpriteBatch.h"
+#include <cassert>
+#include "D3D12MemoryTracking.h"
+#include "D3D12Util.h"
+
+void SpriteBatch::Initialize(ID3D12Device* device, uint32_t maxSprites, uint32_t frameCount) {
+	maxSprites_ = maxSprites;
+	frameCount_ = frameCount;
+
+	// 頂点はフレーム数分の領域を持つリングバッファ。GPUが読んでいるフレームの領域には書き込まない
+	const size_t vertexCount = size_t(maxSprites) * 4 * frameCount;
+	vertexResource_ = CreateBufferResource(device, sizeof(SpriteVertex) * vertexCount);
+	TrackD3D12Resource(device, vertexResource_, MemoryCategory::Mesh, "SpriteBatch vertices");
+	vertexResource_->Map(0, nullptr, reinterpret_cast<void**>(&vertexData_));
+	vertexBufferView_.BufferLocation = vertexResource_->GetGPUVirtualAddress();
+	vertexBufferView_.SizeInBytes = UINT(sizeof(SpriteVertex) * vertexCount);
+	vertexBufferView_.StrideInBytes = sizeof(SpriteVertex);
+
+	// インデックスは全スプライト共通なので最初に一度だけ書き込む。BaseVertexLocationでずらして使う
+	const size_t indexCount = size_t(maxSprites) * 6;
+	indexResource_ = CreateBufferResource(device, sizeof(uint32_t) * indexCount);
+	TrackD3D12Resource(device, indexResource_, MemoryCategory::Mesh, "SpriteBatch indices");
+	uint32_t* indexData = nullptr;
+	indexResource_->Map(0, nullptr, reinterpret_cast<void**>(&indexData));
+	for (uint32_t sprite = 0; sprite < maxSprites; ++sprite) {
+		uint32_t base = sprite * 4;
+		indexData[sprite * 6 + 0] = base + 0;
+		indexData[sprite * 6 + 1] = base + 1;
+		indexData[sprite * 6 + 2] = base + 2;
+		indexData[sprite * 6 + 3] = base + 1;
+		indexData[sprite * 6 + 4] = base + 3;
+		indexData[sprite * 6 + 5] = base + 2;
+	}
+	indexResource_->Unmap(0, nullptr);
+	indexBufferView_.BufferLocation = indexResource_->GetGPUVirtualAddress();
+	indexBufferView_.SizeInBytes = UINT(sizeof(uint32_t) * indexCount);
+	indexBufferView_.Format = DXGI_FORMAT_R32_UINT;
+
+	quads_.reserve(maxSprites);
+	sortItems_.reserve(maxSprites);
+	sortScratch_.reserve(maxSprites);
+}
+
+void SpriteBatch::Finalize() {
+	if (indexResource_) {
+		GetMemoryTracker().Untrack(indexResource_);
+		indexResource_->Release();
+		indexResource_ = nullptr;
+	}
+	if (vertexResource_) {
+		GetMemoryTracker().Untrack(vertexResource_);
+		vertexResource_->Release();
+		vertexResource_ = nullptr;
+	}
+	vertexData_ = nullptr;
+}
+
+void SpriteBatch::Begin(uint32_t frameIndex) {
+	assert(frameIndex < frameCount_);
+	frameIndex_ = frameIndex;
+	quads_.clear();
+	sortItems_.clear();
+	drawCallCount_ = 0;
+}
+
+void SpriteBatch::Draw(const Sprite& sprite) {
+	// 1フレームで積める数を超えたら捨てる
+	if (quads_.size() >= maxSprites_) {
+		assert(false);
+		return;
+	}
+	// layer -> テクスチャの順に並べる。基数ソートは安定なので同じキーの中では積んだ順が保たれる
+	sortItems_.push_back({ MakeSpriteSortKey(sprite), uint32_t(quads_.size()) });
+	quads_.push_back(MakeSpriteQuad(sprite));
+}
+
+void SpriteBatch::End(ID3D12GraphicsCommandList* commandList, const D3D12_GPU_DESCRIPTOR_HANDLE* textures, uint32_t textureCount, UINT textureRootParameter) {
+	const size_t spriteCount = quads_.size();
+	if (spriteCount == 0) {
+		return;
+	}
+	sortScratch_.resize(spriteCount);
+	SortKey::RadixSort(sortItems_.data(), sortScratch_.data(), spriteCount);
+
+	// このフレームの領域へ展開する
+	const uint32_t frameBaseVertex = frameIndex_ * maxSprites_ * 4;
+	ExpandSpriteQuads(quads_.data(), sortItems_.data(), spriteCount, vertexData_ + frameBaseVertex);
+
+	commandList->IASetVertexBuffers(0, 1, &vertexBufferView_);
+	commandList->IASetIndexBuffer(&indexBufferView_);
+	// 同じキーが続く範囲を1回で描画する
+	size_t runStart = 0;
+	uint32_t currentTexture = UINT32_MAX;
+	for (size_t i = 1; i <= spriteCount; ++i) {
+		if (i < spriteCount && sortItems_[i].key == sortItems_[runStart].key) {
+			continue;
+		}
+		// キーの下位32bitがテクスチャ番号
+		uint32_t texture = uint32_t(sortItems_[runStart].key);
+		assert(texture < textureCount);
+		if (texture >= textureCount) {
+			texture = 0;
+		}
+		if (texture != currentTexture) {
+			commandList->SetGraphicsRootDescriptorTable(textureRootParameter, textures[texture]);
+			currentTexture = texture;
+		}
+		commandList->DrawIndexedInstanced(
+			UINT((i - runStart) * 6), 1, 0, INT(frameBaseVertex + runStart * 4), 0);
+		++drawCallCount_;
+		runStart = i;
+	}
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <d3d12.h>
+#include <cstdint>
+#include <vector>
+#include "SpriteQuad.h"
+
+/// <summary>
+/// スプライトをまとめて描画する。頂点はフレームごとのリングバッファに書き込み、
+/// インデックスバッファは全スプライトで共有する
+/// </summary>
+class SpriteBatch {
+public:
+	void Initialize(ID3D12Device* device, uint32_t maxSprites, uint32_t frameCount);
+	void Finalize();
+
+	// frameIndexのフレーム用の領域に書き込みを始める。GPUがその領域を使い終わっていること
+	void Begin(uint32_t frameIndex);
+	void Draw(const Sprite& sprite);
+	// ソートして頂点を書き込み、同じテクスチャが続く範囲を1回のDrawCallで描画する
+	// texturesはtextureCount個。Sprite::textureIndexがtextureCount以上ならassertし、Releaseでは0番のテクスチャで描く
+	void End(ID3D12GraphicsCommandList* commandList, const D3D12_GPU_DESCRIPTOR_HANDLE* textures, uint32_t textureCount, UINT textureRootParameter);
+
+	uint32_t GetSpriteCount() const { return uint32_t(quads_.size()); }
+	uint32_t GetDrawCallCount() const { return drawCallCount_; }
+
+private:
+	ID3D12Resource* vertexResource_ = nullptr;
+	ID3D12Resource* indexResource_ = nullptr;
+	SpriteVertex* vertexData_ = nullptr;
+	D3D12_VERTEX_BUFFER_VIEW vertexBufferView_{};
+	D3D12_INDEX_BUFFER_VIEW indexBufferView_{};
+	uint32_t maxSprites_ = 0;
+	uint32_t frameCount_ = 0;
+	uint32_t frameIndex_ = 0;
+	uint32_t drawCallCount_ = 0;
+
+	std::vector<SpriteQuad> quads_;
+	std::vector<SortKey::Item> sortItems_;
+	std::vector<SortKey::Item> sortScratch_;
+};
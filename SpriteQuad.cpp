@@ -0,0 +1,196 @@
+#include "SpriteQuad.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define SPRITE_QUAD_USE_SSE
+#endif
+#include "mat4x4.h"
+
+namespace {
+	// 0.0~1.0のfloatを0~255に変換する
+	uint32_t ToUnorm8(float value) {
+		value = std::clamp(value, 0.0f, 1.0f);
+		return uint32_t(value * 255.0f + 0.5f);
+	}
+
+	// R8G8B8A8_UNORMの並び(下位バイトがR)に詰める
+	uint32_t PackColor(const Vector4& color) {
+		return ToUnorm8(color.x) | (ToUnorm8(color.y) << 8) | (ToUnorm8(color.z) << 16) | (ToUnorm8(color.w) << 24);
+	}
+
+	// 1枚分の4頂点を書く。頂点の並びは 左下, 左上, 右下, 右上
+	void ExpandSpriteQuad(const SpriteQuad& quad, SpriteVertex* vertex) {
+		const float signX[4] = { -1.0f, -1.0f, 1.0f, 1.0f };
+		const float signY[4] = { 1.0f, -1.0f, 1.0f, -1.0f };
+		float positionX[4];
+		float positionY[4];
+		for (int corner = 0; corner < 4; ++corner) {
+			float localX = signX[corner] * quad.halfWidth;
+			float localY = signY[corner] * quad.halfHeight;
+			positionX[corner] = quad.x + localX * quad.cos - localY * quad.sin;
+			positionY[corner] = quad.y + localX * quad.sin + localY * quad.cos;
+		}
+		vertex[0] = { positionX[0], positionY[0], quad.uvLeft, quad.uvBottom, quad.color };
+		vertex[1] = { positionX[1], positionY[1], quad.uvLeft, quad.uvTop, quad.color };
+		vertex[2] = { positionX[2], positionY[2], quad.uvRight, quad.uvBottom, quad.color };
+		vertex[3] = { positionX[3], positionY[3], quad.uvRight, quad.uvTop, quad.color };
+	}
+
+	// 元の描画と同じく、スプライトごとにCBへ書く行列
+	struct SpriteTransformation {
+		mat4x4 WVP;
+		mat4x4 World;
+	};
+}
+
+SpriteQuad MakeSpriteQuad(const Sprite& sprite) {
+	SpriteQuad quad{};
+	quad.x = sprite.x;
+	quad.y = sprite.y;
+	quad.halfWidth = sprite.width * 0.5f;
+	quad.halfHeight = sprite.height * 0.5f;
+	quad.cos = std::cos(sprite.rotation);
+	quad.sin = std::sin(sprite.rotation);
+	quad.uvLeft = sprite.uvLeft;
+	quad.uvTop = sprite.uvTop;
+	quad.uvRight = sprite.uvRight;
+	quad.uvBottom = sprite.uvBottom;
+	quad.color = PackColor(sprite.color);
+	return quad;
+}
+
+uint64_t MakeSpriteSortKey(const Sprite& sprite) {
+	return (uint64_t(sprite.layer) << 32) | sprite.textureIndex;
+}
+
+void ExpandSpriteQuads(const SpriteQuad* quads, const SortKey::Item* order, size_t count, SpriteVertex* vertices) {
+	size_t i = 0;
+#ifdef SPRITE_QUAD_USE_SSE
+	// 4枚をレーンに並べ、1命令で4枚分の同じ隅を求める
+	for (; i + 4 <= count; i += 4) {
+		const SpriteQuad& quad0 = quads[order[i + 0].index];
+		const SpriteQuad& quad1 = quads[order[i + 1].index];
+		const SpriteQuad& quad2 = quads[order[i + 2].index];
+		const SpriteQuad& quad3 = quads[order[i + 3].index];
+		// 1枚ずつ読んだ行を転置して、要素ごとに4枚分が並んだレジスタにする
+		__m128 x = _mm_loadu_ps(&quad0.x);
+		__m128 y = _mm_loadu_ps(&quad1.x);
+		__m128 halfWidth = _mm_loadu_ps(&quad2.x);
+		__m128 halfHeight = _mm_loadu_ps(&quad3.x);
+		_MM_TRANSPOSE4_PS(x, y, halfWidth, halfHeight);
+		__m128 cos = _mm_loadu_ps(&quad0.cos);
+		__m128 sin = _mm_loadu_ps(&quad1.cos);
+		__m128 unusedU = _mm_loadu_ps(&quad2.cos);
+		__m128 unusedV = _mm_loadu_ps(&quad3.cos);
+		_MM_TRANSPOSE4_PS(cos, sin, unusedU, unusedV);
+
+		// 隅の符号は±halfWidth, ±halfHeightなので、4つの積を足し引きするだけで済む
+		const __m128 widthCos = _mm_mul_ps(halfWidth, cos);
+		const __m128 heightSin = _mm_mul_ps(halfHeight, sin);
+		const __m128 widthSin = _mm_mul_ps(halfWidth, sin);
+		const __m128 heightCos = _mm_mul_ps(halfHeight, cos);
+		const __m128 leftX = _mm_sub_ps(x, widthCos);
+		const __m128 rightX = _mm_add_ps(x, widthCos);
+		const __m128 leftY = _mm_sub_ps(y, widthSin);
+		const __m128 rightY = _mm_add_ps(y, widthSin);
+		float positionX[4][4];
+		float positionY[4][4];
+		_mm_storeu_ps(positionX[0], _mm_sub_ps(leftX, heightSin));
+		_mm_storeu_ps(positionY[0], _mm_add_ps(leftY, heightCos));
+		_mm_storeu_ps(positionX[1], _mm_add_ps(leftX, heightSin));
+		_mm_storeu_ps(positionY[1], _mm_sub_ps(leftY, heightCos));
+		_mm_storeu_ps(positionX[2], _mm_sub_ps(rightX, heightSin));
+		_mm_storeu_ps(positionY[2], _mm_add_ps(rightY, heightCos));
+		_mm_storeu_ps(positionX[3], _mm_add_ps(rightX, heightSin));
+		_mm_storeu_ps(positionY[3], _mm_sub_ps(rightY, heightCos));
+
+		const SpriteQuad* lanes[4] = { &quad0, &quad1, &quad2, &quad3 };
+		SpriteVertex* vertex = vertices + i * 4;
+		for (int lane = 0; lane < 4; ++lane) {
+			const SpriteQuad& quad = *lanes[lane];
+			vertex[0] = { positionX[0][lane], positionY[0][lane], quad.uvLeft, quad.uvBottom, quad.color };
+			vertex[1] = { positionX[1][lane], positionY[1][lane], quad.uvLeft, quad.uvTop, quad.color };
+			vertex[2] = { positionX[2][lane], positionY[2][lane], quad.uvRight, quad.uvBottom, quad.color };
+			vertex[3] = { positionX[3][lane], positionY[3][lane], quad.uvRight, quad.uvTop, quad.color };
+			vertex += 4;
+		}
+	}
+#endif
+	for (; i < count; ++i) {
+		ExpandSpriteQuad(quads[order[i].index], vertices + i * 4);
+	}
+}
+
+SpriteBatchBenchmark MeasureSpriteBatch(uint32_t spriteCount, uint32_t textureCount, uint32_t iterations) {
+	// 毎回同じ配置になるように種を固定する
+	std::mt19937 randomEngine(12345);
+	std::uniform_real_distribution<float> positionDistribution(0.0f, 1280.0f);
+	std::uniform_real_distribution<float> sizeDistribution(8.0f, 64.0f);
+	std::uniform_real_distribution<float> rotationDistribution(0.0f, 6.28f);
+	textureCount = (std::max)(textureCount, 1u);
+	std::vector<Sprite> sprites(spriteCount);
+	for (uint32_t index = 0; index < spriteCount; ++index) {
+		Sprite& sprite = sprites[index];
+		sprite.x = positionDistribution(randomEngine);
+		sprite.y = positionDistribution(randomEngine);
+		sprite.width = sizeDistribution(randomEngine);
+		sprite.height = sizeDistribution(randomEngine);
+		sprite.rotation = rotationDistribution(randomEngine);
+		sprite.uvLeft = 0.0f;
+		sprite.uvTop = 0.0f;
+		sprite.uvRight = 1.0f;
+		sprite.uvBottom = 1.0f;
+		sprite.color = { 1.0f, 1.0f, 1.0f, 1.0f };
+		sprite.textureIndex = index % textureCount;
+		sprite.layer = 0;
+	}
+	const mat4x4 projection = MakeOrthographicMatrix(0.0f, 0.0f, 1280.0f, 720.0f, 0.0f, 100.0f);
+
+	SpriteBatchBenchmark result{};
+	result.spriteCount = spriteCount;
+	iterations = (std::max)(iterations, 1u);
+
+	// 元の描画: スプライトごとに行列を作ってCBに書き、1枚ずつDrawCallを積む
+	std::vector<SpriteTransformation> transformations(spriteCount);
+	auto start = std::chrono::steady_clock::now();
+	for (uint32_t iteration = 0; iteration < iterations; ++iteration) {
+		result.perSpriteDrawCallCount = 0;
+		for (uint32_t index = 0; index < spriteCount; ++index) {
+			const Sprite& sprite = sprites[index];
+			SpriteTransformation& transformation = transformations[index];
+			transformation.World = MakeAffineMatrix({ sprite.width, sprite.height, 1.0f }, { 0.0f, 0.0f, sprite.rotation }, { sprite.x, sprite.y, 0.0f });
+			transformation.WVP = Mul(transformation.World, projection);
+			++result.perSpriteDrawCallCount;
+		}
+	}
+	auto middle = std::chrono::steady_clock::now();
+
+	// SpriteBatch: 前計算してテクスチャで並べ、頂点を展開して同じテクスチャの範囲ごとにDrawCallを積む
+	std::vector<SpriteQuad> quads(spriteCount);
+	std::vector<SortKey::Item> sortItems(spriteCount);
+	std::vector<SortKey::Item> sortScratch(spriteCount);
+	std::vector<SpriteVertex> vertices(size_t(spriteCount) * 4);
+	for (uint32_t iteration = 0; iteration < iterations; ++iteration) {
+		for (uint32_t index = 0; index < spriteCount; ++index) {
+			quads[index] = MakeSpriteQuad(sprites[index]);
+			sortItems[index] = { MakeSpriteSortKey(sprites[index]), index };
+		}
+		SortKey::RadixSort(sortItems.data(), sortScratch.data(), spriteCount);
+		ExpandSpriteQuads(quads.data(), sortItems.data(), spriteCount, vertices.data());
+		result.batchDrawCallCount = 0;
+		for (uint32_t index = 0; index < spriteCount; ++index) {
+			if (index == 0 || sortItems[index].key != sortItems[index - 1].key) {
+				++result.batchDrawCallCount;
+			}
+		}
+	}
+	auto end = std::chrono::steady_clock::now();
+
+	result.perSpriteMilliseconds = std::chrono::duration<double, std::milli>(middle - start).count() / iterations;
+	result.batchMilliseconds = std::chrono::duration<double, std::milli>(end - middle).count() / iterations;
+	return result;
+}
\ No newline at end of file
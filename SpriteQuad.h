@@ -0,0 +1,64 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "SortKey.h"
+#include "VertexData.h"
+
+/// <summary>
+/// Sprite.VS.hlslに渡す頂点データ
+/// </summary>
+struct SpriteVertex {
+	float x, y; //!< スクリーン座標(ピクセル)
+	float u, v;
+	uint32_t color; //!< RGBA8
+};
+
+/// <summary>
+/// SpriteBatchに積むスプライト1枚分
+/// </summary>
+struct Sprite {
+	float x, y; //!< 中心座標(ピクセル)
+	float width, height;
+	float rotation; //!< 中心周りの回転(ラジアン)
+	float uvLeft, uvTop, uvRight, uvBottom;
+	Vector4 color;
+	uint32_t textureIndex; //!< Endに渡すテクスチャ配列の番号
+	uint32_t layer; //!< 小さいほど先に描画される。同じlayer内はテクスチャでまとめる
+};
+
+/// <summary>
+/// 頂点展開用に前計算したスプライト
+/// x, y, halfWidth, halfHeightとcos, sin, uvLeft, uvTopはそれぞれ16バイトで読めるように並べる
+/// </summary>
+struct SpriteQuad {
+	float x, y;
+	float halfWidth, halfHeight;
+	float cos, sin;
+	float uvLeft, uvTop, uvRight, uvBottom;
+	uint32_t color;
+};
+
+// 回転のsin/cosと色を前計算する
+SpriteQuad MakeSpriteQuad(const Sprite& sprite);
+// layer -> テクスチャの順に並べるソートキー。下位32bitがテクスチャ番号
+uint64_t MakeSpriteSortKey(const Sprite& sprite);
+
+// orderの順にquadsを4頂点ずつ展開してverticesへ書き込む
+// SSEが使えるときは4枚ずつSIMDの4レーンに並べて展開し、端数の枚数は1枚ずつ展開する
+// verticesはUploadHeap(書き込み結合メモリ)を想定しているので、先頭から順に書くだけで読み戻さない
+void ExpandSpriteQuads(const SpriteQuad* quads, const SortKey::Item* order, size_t count, SpriteVertex* vertices);
+
+/// <summary>
+/// MeasureSpriteBatchの結果
+/// </summary>
+struct SpriteBatchBenchmark {
+	uint32_t spriteCount;
+	uint32_t perSpriteDrawCallCount; //!< 1枚ずつ描画したときのDrawCall数
+	uint32_t batchDrawCallCount; //!< SpriteBatchのDrawCall数
+	double perSpriteMilliseconds; //!< 1枚ずつ行列を作ってCBに書く時間。1回あたり
+	double batchMilliseconds; //!< 前計算、ソート、頂点展開の時間。1回あたり
+};
+
+// spriteCount枚のスプライトをtextureCount枚のテクスチャに振り分け、iterations回ずつ
+// 1枚ずつWVPを作ってDrawCallを積む元の描画とSpriteBatchのCPU側の処理を比べる。DrawCallは数だけ数える
+SpriteBatchBenchmark MeasureSpriteBatch(uint32_t spriteCount, uint32_t textureCount, uint32_t iterations);
\ No newline at end of file
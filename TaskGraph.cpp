@@ -0,0 +1,84 @@
+#include "TaskGraph.h"
+#include <cassert>
+#include <chrono>
+#include <memory>
+#include "Profiler.h"
+
+uint32_t TaskGraph::AddTask(const std::string& name, TaskFunction function) {
+	Task task;
+	task.name = name;
+	task.function = std::move(function);
+	tasks_.push_back(std::move(task));
+	return uint32_t(tasks_.size() - 1);
+}
+
+void TaskGraph::AddDependency(uint32_t before, uint32_t after) {
+	assert(before < tasks_.size() && after < tasks_.size() && before != after);
+	tasks_[before].successors.push_back(after);
+	++tasks_[after].predecessorCount;
+}
+
+struct TaskGraph::ExecuteContext {
+	JobSystem* jobSystem;
+	JobCounter counter;
+	std::unique_ptr<std::atomic<uint32_t>[]> pendingCounts; //!< 残りの依存数。0になったタスクから積む
+	std::atomic<uint32_t> executedCount{ 0 };
+};
+
+void TaskGraph::Execute(JobSystem& jobSystem) {
+	const auto start = std::chrono::steady_clock::now();
+	executionOrder_.assign(tasks_.size(), 0);
+
+	ExecuteContext context;
+	context.jobSystem = &jobSystem;
+	context.pendingCounts = std::make_unique<std::atomic<uint32_t>[]>(tasks_.size());
+	std::vector<uint32_t> readyTasks;
+	for (uint32_t index = 0; index < tasks_.size(); ++index) {
+		context.pendingCounts[index].store(tasks_[index].predecessorCount, std::memory_order_relaxed);
+		if (tasks_[index].predecessorCount == 0) {
+			readyTasks.push_back(index);
+		}
+	}
+	// 循環していると終わらないので、始められるタスクが無いのはおかしい
+	assert(tasks_.empty() || !readyTasks.empty());
+
+	ExecuteContext* contextPointer = &context;
+	for (uint32_t index : readyTasks) {
+		jobSystem.Run(context.counter, [this, contextPointer, index](uint32_t workerIndex) {
+			RunTask(*contextPointer, index, workerIndex);
+		});
+	}
+	jobSystem.Wait(context.counter);
+	assert(context.executedCount == tasks_.size());
+
+	totalMilliseconds_ = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void TaskGraph::RunTask(ExecuteContext& context, uint32_t index, uint32_t workerIndex) {
+	executionOrder_[context.executedCount.fetch_add(1)] = index;
+	Task& task = tasks_[index];
+	const auto taskStart = std::chrono::steady_clock::now();
+	if (task.function) {
+		// タスク名は実行後に消えることがあるので、区間の名前は共通にする
+		PROFILE_SCOPE("Task");
+		task.function(workerIndex);
+	}
+	task.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - taskStart).count();
+	task.workerIndex = workerIndex;
+
+	// 最後の依存だったタスクを積む。積むのは終わる前なので、Waitはその分も待つ
+	ExecuteContext* contextPointer = &context;
+	for (uint32_t successor : task.successors) {
+		if (context.pendingCounts[successor].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			context.jobSystem->Run(context.counter, [this, contextPointer, successor](uint32_t successorWorker) {
+				RunTask(*contextPointer, successor, successorWorker);
+			});
+		}
+	}
+}
+
+void TaskGraph::Clear() {
+	tasks_.clear();
+	executionOrder_.clear();
+	totalMilliseconds_ = 0.0;
+}
\ No newline at end of file
@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "JobSystem.h"
+
+/// <summary>
+/// 依存関係のあるタスクをJobSystemのジョブとして実行する。前のタスクが全て終わったタスクから積んでいく
+/// プラットフォームに依存しないので、偽のタスクを積んで順序だけを確かめることもできる
+/// </summary>
+class TaskGraph {
+public:
+	// workerIndexは0からJobSystem::GetWorkerCount()-1まで。スレッドごとの資源を選ぶのに使う
+	using TaskFunction = std::function<void(uint32_t workerIndex)>;
+
+	// タスクを追加して番号を返す
+	uint32_t AddTask(const std::string& name, TaskFunction function);
+	// afterはbeforeが終わってから実行される
+	void AddDependency(uint32_t before, uint32_t after);
+
+	// jobSystemで全タスクを実行し、終わるまで待つ。呼び出したスレッドがワーカーなら待つ間も働く
+	void Execute(JobSystem& jobSystem = GetJobSystem());
+	void Clear();
+
+	uint32_t GetTaskCount() const { return uint32_t(tasks_.size()); }
+	const std::string& GetTaskName(uint32_t task) const { return tasks_[task].name; }
+	// 直前のExecuteでの計測結果
+	double GetTaskMilliseconds(uint32_t task) const { return tasks_[task].milliseconds; }
+	uint32_t GetTaskWorker(uint32_t task) const { return tasks_[task].workerIndex; }
+	// 実行順。依存関係を満たしていることを確かめるのに使う
+	const std::vector<uint32_t>& GetExecutionOrder() const { return executionOrder_; }
+	double GetTotalMilliseconds() const { return totalMilliseconds_; }
+
+private:
+	struct Task {
+		std::string name;
+		TaskFunction function;
+		std::vector<uint32_t> successors;
+		uint32_t predecessorCount = 0;
+		double milliseconds = 0.0;
+		uint32_t workerIndex = 0;
+	};
+
+	// Executeの間だけある状態
+	struct ExecuteContext;
+	void RunTask(ExecuteContext& context, uint32_t index, uint32_t workerIndex);
+
+	std::vector<Task> tasks_;
+	std::vector<uint32_t> executionOrder_;
+	double totalMilliseconds_ = 0.0;
+};
\ No newline at end of file
@@ -0,0 +1,277 @@
+#include "Unicode.h"
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include <emmintrin.h>
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+
+namespace {
+
+const uint32_t kReplacementCharacter = 0xFFFD;
+
+// 先頭の1文字を読み、読んだバイト数を返す。不正なら正しく始まった部分までを1文字としてU+FFFDを返す
+size_t DecodeUtf8(const uint8_t* source, size_t length, uint32_t& codePoint) {
+	const uint8_t lead = source[0];
+	if (lead < 0x80) {
+		codePoint = lead;
+		return 1;
+	}
+	codePoint = kReplacementCharacter;
+	if (lead < 0xC2 || lead > 0xF4) {
+		// 続きのバイト、長すぎる表現になる0xC0と0xC1、U+10FFFFを超える0xF5以降
+		return 1;
+	}
+	if (lead < 0xE0) {
+		if (length < 2 || (source[1] & 0xC0) != 0x80) {
+			return 1;
+		}
+		codePoint = (uint32_t(lead & 0x1F) << 6) | (source[1] & 0x3F);
+		return 2;
+	}
+	// 2バイト目の範囲で長すぎる表現とサロゲートとU+10FFFFを超えるものを除く
+	uint8_t lower = 0x80;
+	uint8_t upper = 0xBF;
+	if (lead == 0xE0) {
+		lower = 0xA0;
+	} else if (lead == 0xED) {
+		upper = 0x9F;
+	} else if (lead == 0xF0) {
+		lower = 0x90;
+	} else if (lead == 0xF4) {
+		upper = 0x8F;
+	}
+	if (length < 2 || source[1] < lower || source[1] > upper) {
+		return 1;
+	}
+	if (length < 3 || (source[2] & 0xC0) != 0x80) {
+		return 2;
+	}
+	if (lead < 0xF0) {
+		codePoint = (uint32_t(lead & 0x0F) << 12) | (uint32_t(source[1] & 0x3F) << 6) | (source[2] & 0x3F);
+		return 3;
+	}
+	if (length < 4 || (source[3] & 0xC0) != 0x80) {
+		return 3;
+	}
+	codePoint = (uint32_t(lead & 0x07) << 18) | (uint32_t(source[1] & 0x3F) << 12) | (uint32_t(source[2] & 0x3F) << 6) | (source[3] & 0x3F);
+	return 4;
+}
+
+// kWriteがfalseなら書かずに要素数だけ数える
+template<bool kWrite>
+size_t Utf8ToUtf16(const uint8_t* source, size_t length, uint16_t* destination, size_t capacity) {
+	size_t read = 0;
+	size_t written = 0;
+	while (read < length) {
+		// ASCIIの間は16バイトずつ0を挟んで広げる
+		if (length - read >= 16 && (!kWrite || capacity - written >= 16)) {
+			const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + read));
+			const uint32_t nonAscii = uint32_t(_mm_movemask_epi8(bytes));
+			if constexpr (kWrite) {
+				const __m128i zero = _mm_setzero_si128();
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + written), _mm_unpacklo_epi8(bytes, zero));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + written + 8), _mm_unpackhi_epi8(bytes, zero));
+			}
+			// ASCIIでないバイトがあれば、その手前までを使って残りは1文字ずつ読む
+			const size_t asciiCount = nonAscii == 0 ? 16 : size_t(std::countr_zero(nonAscii));
+			read += asciiCount;
+			written += asciiCount;
+			if (asciiCount == 16) {
+				continue;
+			}
+		}
+		uint32_t codePoint = 0;
+		const size_t sourceLength = DecodeUtf8(source + read, length - read, codePoint);
+		const size_t unitCount = codePoint >= 0x10000 ? 2 : 1;
+		if constexpr (kWrite) {
+			if (capacity - written < unitCount) {
+				break;
+			}
+			if (unitCount == 2) {
+				destination[written] = uint16_t(0xD800 + ((codePoint - 0x10000) >> 10));
+				destination[written + 1] = uint16_t(0xDC00 + (codePoint & 0x3FF));
+			} else {
+				destination[written] = uint16_t(codePoint);
+			}
+		}
+		read += sourceLength;
+		written += unitCount;
+	}
+	return written;
+}
+
+template<bool kWrite>
+size_t Utf16ToUtf8(const uint16_t* source, size_t length, uint8_t* destination, size_t capacity) {
+	size_t read = 0;
+	size_t written = 0;
+	while (read < length) {
+		// ASCIIの間は16要素ずつ詰めて1バイトにする
+		if (length - read >= 16 && (!kWrite || capacity - written >= 16)) {
+			const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + read));
+			const __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + read + 8));
+			// 0x80以上の要素は0xFF80のどこかのビットが立つ
+			const __m128i mask = _mm_set1_epi16(int16_t(0xFF80));
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i asciiLow = _mm_cmpeq_epi16(_mm_and_si128(low, mask), zero);
+			const __m128i asciiHigh = _mm_cmpeq_epi16(_mm_and_si128(high, mask), zero);
+			const uint32_t ascii = uint32_t(_mm_movemask_epi8(_mm_packs_epi16(asciiLow, asciiHigh)));
+			if constexpr (kWrite) {
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + written), _mm_packus_epi16(low, high));
+			}
+			const size_t asciiCount = size_t(std::countr_one(ascii));
+			read += asciiCount;
+			written += asciiCount;
+			if (asciiCount == 16) {
+				continue;
+			}
+		}
+		uint32_t codePoint = source[read];
+		size_t sourceLength = 1;
+		if (codePoint >= 0xD800 && codePoint < 0xE000) {
+			if (codePoint < 0xDC00 && length - read >= 2 && source[read + 1] >= 0xDC00 && source[read + 1] < 0xE000) {
+				codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (source[read + 1] - 0xDC00);
+				sourceLength = 2;
+			} else {
+				// 対になっていないサロゲート
+				codePoint = kReplacementCharacter;
+			}
+		}
+		const size_t byteCount = codePoint < 0x80 ? 1 : codePoint < 0x800 ? 2 : codePoint < 0x10000 ? 3 : 4;
+		if constexpr (kWrite) {
+			if (capacity - written < byteCount) {
+				break;
+			}
+			uint8_t* output = destination + written;
+			switch (byteCount) {
+			case 1:
+				output[0] = uint8_t(codePoint);
+				break;
+			case 2:
+				output[0] = uint8_t(0xC0 | (codePoint >> 6));
+				output[1] = uint8_t(0x80 | (codePoint & 0x3F));
+				break;
+			case 3:
+				output[0] = uint8_t(0xE0 | (codePoint >> 12));
+				output[1] = uint8_t(0x80 | ((codePoint >> 6) & 0x3F));
+				output[2] = uint8_t(0x80 | (codePoint & 0x3F));
+				break;
+			default:
+				output[0] = uint8_t(0xF0 | (codePoint >> 18));
+				output[1] = uint8_t(0x80 | ((codePoint >> 12) & 0x3F));
+				output[2] = uint8_t(0x80 | ((codePoint >> 6) & 0x3F));
+				output[3] = uint8_t(0x80 | (codePoint & 0x3F));
+				break;
+			}
+		}
+		read += sourceLength;
+		written += byteCount;
+	}
+	return written;
+}
+
+} // namespace
+
+size_t GetUtf16Length(std::string_view source) {
+	return Utf8ToUtf16<false>(reinterpret_cast<const uint8_t*>(source.data()), source.size(), nullptr, 0);
+}
+
+size_t GetUtf8Length(Utf16StringView source) {
+	return Utf16ToUtf8<false>(reinterpret_cast<const uint16_t*>(source.data()), source.size(), nullptr, 0);
+}
+
+size_t ConvertUtf8ToUtf16(std::string_view source, Utf16Char* destination, size_t capacity) {
+	return Utf8ToUtf16<true>(reinterpret_cast<const uint8_t*>(source.data()), source.size(), reinterpret_cast<uint16_t*>(destination), capacity);
+}
+
+size_t ConvertUtf16ToUtf8(Utf16StringView source, char* destination, size_t capacity) {
+	return Utf16ToUtf8<true>(reinterpret_cast<const uint16_t*>(source.data()), source.size(), reinterpret_cast<uint8_t*>(destination), capacity);
+}
+
+UnicodeConversionBenchmark MeasureUnicodeConversion(uint32_t caseCount) {
+	UnicodeConversionBenchmark result{};
+	result.caseCount = caseCount;
+	std::mt19937 random(12345);
+	// 1文字ずつ選んでUTF-16で組み立てる。種類は0:ASCIIのみ 1:多言語混在 2:不正な並びを含む
+	std::vector<std::u16string> utf16Cases(caseCount);
+	std::vector<std::string> utf8Cases(caseCount);
+	for (uint32_t index = 0; index < caseCount; ++index) {
+		const uint32_t kind = index % 3;
+		const uint32_t length = random() % 256;
+		std::u16string& text = utf16Cases[index];
+		for (uint32_t character = 0; character < length; ++character) {
+			const uint32_t choice = kind == 0 ? 0 : random() % 8;
+			if (choice < 4) {
+				text.push_back(char16_t(0x20 + random() % 0x5F));
+			} else if (choice == 4) {
+				text.push_back(char16_t(0x80 + random() % 0x780));
+			} else if (choice == 5) {
+				// サロゲートの範囲は飛ばす
+				const uint32_t codePoint = 0x800 + random() % (0xF800 - 0x800);
+				text.push_back(char16_t(codePoint < 0xD800 ? codePoint : codePoint + 0x800));
+			} else if (choice == 6) {
+				const uint32_t codePoint = 0x10000 + random() % 0x100000;
+				text.push_back(char16_t(0xD800 + ((codePoint - 0x10000) >> 10)));
+				text.push_back(char16_t(0xDC00 + (codePoint & 0x3FF)));
+			} else if (kind == 2) {
+				// 対になっていないサロゲート
+				text.push_back(char16_t(0xD800 + random() % 0x800));
+			}
+		}
+		std::string& bytes = utf8Cases[index];
+		bytes.resize(GetUtf8Length(Utf16StringView(reinterpret_cast<const Utf16Char*>(text.data()), text.size())));
+		ConvertUtf16ToUtf8(Utf16StringView(reinterpret_cast<const Utf16Char*>(text.data()), text.size()), bytes.data(), bytes.size());
+		if (kind == 2) {
+			// UTF-8側にも不正なバイトを混ぜる
+			for (uint32_t corrupt = 0; corrupt < 4 && !bytes.empty(); ++corrupt) {
+				bytes[random() % bytes.size()] = char(0x80 + random() % 0x80);
+			}
+		}
+	}
+
+	std::vector<Utf16Char> utf16Buffer(1024);
+	std::vector<char> utf8Buffer(1024);
+	auto start = std::chrono::steady_clock::now();
+	for (uint32_t index = 0; index < caseCount; ++index) {
+		ConvertUtf8ToUtf16(utf8Cases[index], utf16Buffer.data(), utf16Buffer.size());
+		ConvertUtf16ToUtf8(Utf16StringView(reinterpret_cast<const Utf16Char*>(utf16Cases[index].data()), utf16Cases[index].size()), utf8Buffer.data(), utf8Buffer.size());
+	}
+	auto end = std::chrono::steady_clock::now();
+	result.convertMicroseconds = std::chrono::duration<double, std::micro>(end - start).count() / (std::max)(caseCount, 1u);
+
+#ifdef _WIN32
+	std::vector<wchar_t> win32Utf16Buffer(1024);
+	std::vector<char> win32Utf8Buffer(1024);
+	start = std::chrono::steady_clock::now();
+	for (uint32_t index = 0; index < caseCount; ++index) {
+		const std::string& bytes = utf8Cases[index];
+		const std::u16string& text = utf16Cases[index];
+		MultiByteToWideChar(CP_UTF8, 0, bytes.data(), int(bytes.size()), win32Utf16Buffer.data(), int(win32Utf16Buffer.size()));
+		WideCharToMultiByte(CP_UTF8, 0, reinterpret_cast<const wchar_t*>(text.data()), int(text.size()), win32Utf8Buffer.data(), int(win32Utf8Buffer.size()), nullptr, nullptr);
+	}
+	end = std::chrono::steady_clock::now();
+	result.win32Microseconds = std::chrono::duration<double, std::micro>(end - start).count() / (std::max)(caseCount, 1u);
+
+	// 長さと中身の両方を比べる
+	for (uint32_t index = 0; index < caseCount; ++index) {
+		const std::string& bytes = utf8Cases[index];
+		const Utf16StringView text(reinterpret_cast<const Utf16Char*>(utf16Cases[index].data()), utf16Cases[index].size());
+		const int win32Utf16Length = MultiByteToWideChar(CP_UTF8, 0, bytes.data(), int(bytes.size()), win32Utf16Buffer.data(), int(win32Utf16Buffer.size()));
+		const size_t utf16Length = ConvertUtf8ToUtf16(bytes, utf16Buffer.data(), utf16Buffer.size());
+		const int win32Utf8Length = WideCharToMultiByte(CP_UTF8, 0, text.data(), int(text.size()), win32Utf8Buffer.data(), int(win32Utf8Buffer.size()), nullptr, nullptr);
+		const size_t utf8Length = ConvertUtf16ToUtf8(text, utf8Buffer.data(), utf8Buffer.size());
+		if (size_t(win32Utf16Length) != utf16Length || GetUtf16Length(bytes) != utf16Length ||
+			std::memcmp(win32Utf16Buffer.data(), utf16Buffer.data(), utf16Length * sizeof(Utf16Char)) != 0 ||
+			size_t(win32Utf8Length) != utf8Length || GetUtf8Length(text) != utf8Length ||
+			std::memcmp(win32Utf8Buffer.data(), utf8Buffer.data(), utf8Length) != 0) {
+			++result.mismatchCount;
+		}
+	}
+#endif
+	return result;
+}
\ No newline at end of file
@@ -0,0 +1,110 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+
+// UTF-16の1要素。WindowsのAPIにそのまま渡せるようにWindowsではwchar_tにする
+#ifdef _WIN32
+using Utf16Char = wchar_t;
+#else
+using Utf16Char = char16_t;
+#endif
+static_assert(sizeof(Utf16Char) == 2, "Utf16Char must be a 16-bit code unit");
+using Utf16StringView = std::basic_string_view<Utf16Char>;
+
+// UTF-8とUTF-16の相互変換。メモリを確保せず、呼び出し側のバッファに書く
+// 不正な並びはU+FFFDに置き換える。UTF-8は正しく始まった部分ごとに1つ、UTF-16は対になっていないサロゲートごとに1つ
+
+// 変換後の要素数。終端の'\0'は含まない
+size_t GetUtf16Length(std::string_view source);
+size_t GetUtf8Length(Utf16StringView source);
+// destinationにcapacity要素まで書き、書いた要素数を返す。終端の'\0'は書かない
+// 入りきらない文字は途中で切らず、その手前で止める
+size_t ConvertUtf8ToUtf16(std::string_view source, Utf16Char* destination, size_t capacity);
+size_t ConvertUtf16ToUtf8(Utf16StringView source, char* destination, size_t capacity);
+
+/// <summary>
+/// UTF-8から変換したUTF-16の文字列。N要素までは確保せずに中に持つ
+/// ファイルパスをWindowsのAPIに渡すときなど、変換した文字列を短い間だけ使う
+/// </summary>
+template<size_t N>
+class Utf16Text {
+public:
+	explicit Utf16Text(std::string_view source) {
+		// UTF-16の要素数はUTF-8のバイト数を超えないので、それで入るなら長さを数えずに変換する
+		size_t capacity = N;
+		Utf16Char* data = buffer_;
+		if (source.size() > N) {
+			capacity = GetUtf16Length(source);
+			if (capacity > N) {
+				heap_ = std::make_unique<Utf16Char[]>(capacity + 1);
+				data = heap_.get();
+			}
+		}
+		data_ = data;
+		length_ = ConvertUtf8ToUtf16(source, data, capacity);
+		data[length_] = 0;
+	}
+	Utf16Text(const Utf16Text&) = delete;
+	Utf16Text& operator=(const Utf16Text&) = delete;
+
+	const Utf16Char* c_str() const { return data_; }
+	size_t size() const { return length_; }
+	Utf16StringView view() const { return Utf16StringView(data_, length_); }
+
+private:
+	Utf16Char buffer_[N + 1];
+	std::unique_ptr<Utf16Char[]> heap_; //!< Nに入らなかったときだけ使う
+	Utf16Char* data_ = nullptr;
+	size_t length_ = 0;
+};
+
+/// <summary>
+/// UTF-16から変換したUTF-8の文字列。Nバイトまでは確保せずに中に持つ
+/// </summary>
+template<size_t N>
+class Utf8Text {
+public:
+	explicit Utf8Text(Utf16StringView source) {
+		// UTF-8のバイト数はUTF-16の要素数の3倍を超えない
+		size_t capacity = N;
+		char* data = buffer_;
+		if (source.size() * 3 > N) {
+			capacity = GetUtf8Length(source);
+			if (capacity > N) {
+				heap_ = std::make_unique<char[]>(capacity + 1);
+				data = heap_.get();
+			}
+		}
+		data_ = data;
+		length_ = ConvertUtf16ToUtf8(source, data, capacity);
+		data[length_] = '\0';
+	}
+	Utf8Text(const Utf8Text&) = delete;
+	Utf8Text& operator=(const Utf8Text&) = delete;
+
+	const char* c_str() const { return data_; }
+	size_t size() const { return length_; }
+	std::string_view view() const { return std::string_view(data_, length_); }
+
+private:
+	char buffer_[N + 1];
+	std::unique_ptr<char[]> heap_; //!< Nに入らなかったときだけ使う
+	char* data_ = nullptr;
+	size_t length_ = 0;
+};
+
+/// <summary>
+/// MeasureUnicodeConversionの結果
+/// </summary>
+struct UnicodeConversionBenchmark {
+	uint32_t caseCount; //!< 比べた文字列の数
+	uint32_t mismatchCount; //!< Win32のAPIと結果が違った数
+	double convertMicroseconds; //!< 1件あたりの時間。UTF-8からUTF-16とその逆を合わせたもの
+	double win32Microseconds; //!< MultiByteToWideCharとWideCharToMultiByteで同じことをした時間
+};
+
+// ランダムな文字列(ASCIIのみ、多言語混在、不正な並びを含むもの)をcaseCount個作って両方向に変換し、Win32のAPIと結果と時間を比べる
+// Windows以外ではWin32との比較を行わずmismatchCountは0になる
+UnicodeConversionBenchmark MeasureUnicodeConversion(uint32_t caseCount);
\ No newline at end of file
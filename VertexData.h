@@ -0,0 +1,23 @@
+#pragma once
+#include "Vector3.h"
+
+struct Vector4 {
+	float x;
+	float y;
+	float z;
+	float w;
+};
+
+struct Vector2 {
+	float u;
+	float v;
+};
+
+/// <summary>
+/// Object3d.VS.hlslに渡す頂点データ
+/// </summary>
+struct VertexData {
+	Vector4 position;
+	Vector2 texcoord;
+	Vector3 normal;
+};
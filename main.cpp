@@ -1,6 +1,7 @@
 // CComPtr
 #include <atlbase.h>
 #include <cassert>
+#include <charconv>
 #include <cstdint>
 #include <dxcapi.h>
 #include <dxgidebug.h>
@@ -10,15 +11,49 @@
 #define _USE_MATH_DEFINES
 #include <Math.h> 
 #include <string>
-#include <sstream>
 #include <Windows.h>
 #include <format>
+#include <thread>
+#include <algorithm>
 
 #include "DirectXTex.h"
 
 #include "ConvertString.h"
 #include "mat4x4.h"
 #include "Transform.h"
+#include "VertexData.h"
+#include "D3D12Util.h"
+#include "Instancing.h"
+#include "IndirectDraw.h"
+#include "RenderQueue.h"
+#include "D3D12RenderDevice.h"
+#include "DeviceRenderQueueExecutor.h"
+#include "ParallelCommandRecorder.h"
+#include "D3D12CommandListBackend.h"
+#include "RenderGraph.h"
+#include "D3D12RenderGraphExecutor.h"
+#include "GpuProfiler.h"
+#include "D3D12GpuQuerySource.h"
+#include "SpriteBatch.h"
+#include "PrimitiveMesh.h"
+#include "PrimitiveMeshCache.h"
+#include "FrustumCulling.h"
+#include "SceneBVH.h"
+#include "OcclusionBuffer.h"
+#include "SoftwareRasterizer.h"
+#include "ShaderCache.h"
+#include "ShaderCompiler.h"
+#include "ShaderPermutation.h"
+#include "JobSystem.h"
+#include "ArenaAllocator.h"
+#include "D3D12MemoryTracking.h"
+#include "D3D12GpuMemoryAllocator.h"
+#include "TaskGraph.h"
+#include "PipelineStateCache.h"
+#include "ShaderHotReload.h"
+#include "Logger.h"
+#include "Unicode.h"
+#include "Profiler.h"
 
 #include "imgui.h"
 #include "imgui_impl_dx12.h"
@@ -34,24 +69,6 @@ extern IMGUI_IMPL_API LRESULT ImGui_ImplWin32_WndProcHandler(HWND hwnd, UINT msg
 #pragma comment(lib,"dxcompiler.lib")
 
 
-struct Vector4 {
-	float x;
-	float y;
-	float z;
-	float w;
-};
-
-struct Vector2 {
-	float u;
-	float v;
-};
-
-struct VertexData {
-	Vector4 position;
-	Vector2 texcoord;
-	Vector3 normal;
-};
-
 struct Matrix3x3 {
 	float m[3][3];
 };
@@ -85,6 +102,7 @@ struct MaterialData {
 struct ModelData {
 	std::vector<VertexData> vertices;
 	MaterialData material;
+	MeshBounds bounds; //!< ローカル座標での境界。カリングに使う
 };
 
 
@@ -117,106 +135,6 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT msg, WPARAM wparam, LPARAM lparam) {
 }
 #pragma endregion WindowProc
 
-#pragma region CompileShader関数
-IDxcBlob* CompileShader(
-	//ConpilerするShaderファイルへのパス
-	const std::wstring& filePath,
-	//Compilerに使用するProfile
-	const wchar_t* profile,
-	//初期化で生成したのもを3つ
-	IDxcUtils* dxcUtils,
-	IDxcCompiler3* dxcCompiler,
-	IDxcIncludeHandler* includeHandler
-)
-{
-	//これからシェーダーをコンパイルする旨をログに出す
-	Log(ConvertString(std::format(L"Begin CompilerShader, Path:{},profile:{}\n", filePath, profile)));
-	//hlslファイルを読み込む
-	IDxcBlobEncoding* shaderSource = nullptr;
-	HRESULT hr = dxcUtils->LoadFile(filePath.c_str(), nullptr, &shaderSource);
-	//読めなかったら止める
-	assert(SUCCEEDED(hr));
-	//読み込んだファイルの内容を設定する
-	DxcBuffer shaderSourceBuffer;
-	shaderSourceBuffer.Ptr = shaderSource->GetBufferPointer();
-	shaderSourceBuffer.Size = shaderSource->GetBufferSize();
-	shaderSourceBuffer.Encoding = DXC_CP_UTF8;//UTF8の文字コード
-
-	LPCWSTR arguments[] = {
-		filePath.c_str(),//コンパイル対象のhlslファイル名
-		L"-E",L"main",//エントリーポイントの指定。基本的にmain以外はしない
-		L"-T",profile,//ShaderProfileの設定
-		L"-Zi",L"-Qembed_debug",//デバック用の情報を埋め込む
-		L"-Od",//最適化を外しておく
-		L"-Zpr",//メモリレイアウトは行優先
-	};
-	//実際にShaderをコンパイルする
-	IDxcResult* shaderResult = nullptr;
-	hr = dxcCompiler->Compile(
-		&shaderSourceBuffer,//読み込んだファイル
-		arguments,//コンパイラオプション
-		_countof(arguments),//コンパイラオプションの数
-		includeHandler,//includeが含まれた諸々
-		IID_PPV_ARGS(&shaderResult)//コンパイラ結果
-	);
-	//コンパイルエラーではなくdxcが起動できないなど致命的な状況
-	assert(SUCCEEDED(hr));
-
-	//警告、エラーが出たらログを出して止める
-	IDxcBlobUtf8* shaderError = nullptr;
-	shaderResult->GetOutput(DXC_OUT_ERRORS, IID_PPV_ARGS(&shaderError), nullptr);
-	if (shaderError != nullptr && shaderError->GetStringLength() != 0) {
-		Log(shaderError->GetStringPointer());
-		//警告、エラーダメ
-		assert(false);
-	}
-	//コンパイル結果から実行用のバイナリ部分を取得
-	IDxcBlob* shaderBlob = nullptr;
-	hr = shaderResult->GetOutput(DXC_OUT_OBJECT, IID_PPV_ARGS(&shaderBlob), nullptr);
-	assert(SUCCEEDED(hr));
-	//成功したログを出す
-	Log(ConvertString(std::format(L"Compile Succeeded,path:{},profile:{}\n", filePath, profile)));
-	//もう使わないリソースを解放
-	shaderSource->Release();
-	shaderResult->Release();
-	//実行用のバイナリを返却
-	return shaderBlob;
-}
-#pragma endregion CompileShader関数
-
-#pragma region CreateBufferResource関数
-ID3D12Resource* CreateBufferResource(ID3D12Device* device, size_t sizeInBytes) {
-	ID3D12Resource* resource = nullptr;
-	//頂点リソース用のヒープの設定
-	D3D12_HEAP_PROPERTIES uploadHeapProperties{};
-	uploadHeapProperties.Type = D3D12_HEAP_TYPE_UPLOAD;//UploadHeapを使う
-	//頂点リソースの設定
-	D3D12_RESOURCE_DESC resourceDesc{};
-	//バッファリソース、テクスチャの場合はまた罰の設定をする
-	resourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
-	resourceDesc.Width = sizeInBytes;//リソースのサイズ。今回はvector4を3頂点文
-	//バッファリソースの設定
-	resourceDesc.Height = 1;
-	resourceDesc.DepthOrArraySize = 1;
-	resourceDesc.MipLevels = 1;
-	resourceDesc.SampleDesc.Count = 1;
-	//バッファの場合はこれにする決まり
-	resourceDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
-	//実際に頂点リソースを作る
-	HRESULT hr = device->CreateCommittedResource(
-		&uploadHeapProperties,
-		D3D12_HEAP_FLAG_NONE,
-		&resourceDesc,
-		D3D12_RESOURCE_STATE_GENERIC_READ,
-		nullptr,
-		IID_PPV_ARGS(&resource));
-	assert(SUCCEEDED(hr));
-
-	return resource;
-}
-
-#pragma endregion CreateBufferResource関数
-
 #pragma region DescriptorHeap関数
 ID3D12DescriptorHeap* CreateDescriptorHeap(
 	ID3D12Device* device, D3D12_DESCRIPTOR_HEAP_TYPE heapType, UINT numDescriptors, bool shaderVisible) {
@@ -233,9 +151,11 @@ ID3D12DescriptorHeap* CreateDescriptorHeap(
 
 #pragma region LoadTexture関数
 DirectX::ScratchImage LoadTexture(const std::string& filePath) {
+	PROFILE_SCOPE("LoadTexture");
 	// テクスチャを読み込んでプログラムで扱えるようにする
 	DirectX::ScratchImage image{};
-	std::wstring filePathW = ConvertString(filePath);
+	// パスはスタック上でUTF-16にする
+	Utf16Text<MAX_PATH> filePathW(filePath);
 	HRESULT hr = DirectX::LoadFromWICFile(filePathW.c_str(), DirectX::WIC_FLAGS_FORCE_SRGB, nullptr, image);
 	assert(SUCCEEDED(hr));
 
@@ -301,40 +221,34 @@ void UploadTextureData(ID3D12Resource* texture, const DirectX::ScratchImage& mip
 }
 #pragma endregion UploadTextureData関数
 
-#pragma region CreateDepthStencilTexture関数
-ID3D12Resource* CreateDepthStencilTextureResource(ID3D12Device* device, int32_t width, int32_t height) {
-	D3D12_RESOURCE_DESC resourceDesc{};
-	resourceDesc.Width = width;// Textureの幅
-	resourceDesc.Height = height;// Textureの高さ
-	resourceDesc.MipLevels = 1;// mipmapの数
-	resourceDesc.DepthOrArraySize = 1;// 奥行き or 配列Textureの配列数
-	resourceDesc.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;// DepthStencilとして利用可能なフォーマット
-	resourceDesc.SampleDesc.Count = 1;// サンプリングカウント。1固定
-	resourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;// 2次元
-	resourceDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL;// DepthStencilとして使う通知
-
-	// 利用するHeapの設定
-	D3D12_HEAP_PROPERTIES heapProperties{};
-	heapProperties.Type = D3D12_HEAP_TYPE_DEFAULT;// VRAM上に作る
-
-	// 深度値のクリア設定
-	D3D12_CLEAR_VALUE depthClearValue{};
-	depthClearValue.DepthStencil.Depth = 1.0f;// 1.0f(最大値)でクリア
-	depthClearValue.Format = DXGI_FORMAT_D24_UNORM_S8_UINT; // フォーマット。Resourceと合わせる
-	ID3D12Resource* resource = nullptr;
-	HRESULT hr = device->CreateCommittedResource(
-		&heapProperties, // Heapの設定
-		D3D12_HEAP_FLAG_NONE, // Heapの特殊な設定
-		&resourceDesc, // Resourceの設定
-		D3D12_RESOURCE_STATE_DEPTH_WRITE, // 深度値を書き込む状態にしておく
-		&depthClearValue, // Clear最適値
-		IID_PPV_ARGS(&resource));
+#pragma region SoftwareTexture関数
+// SoftwareRasterizerで読めるように、ScratchImageの全Mipを指す。ピクセルはmipImagesが持ったまま
+SoftwareTexture MakeSoftwareTexture(const DirectX::ScratchImage& mipImages) {
+	const DirectX::TexMetadata& metadata = mipImages.GetMetadata();
+	assert(metadata.format == DXGI_FORMAT_R8G8B8A8_UNORM || metadata.format == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB);
+	SoftwareTexture texture{};
+	texture.srgb = metadata.format == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+	for (size_t mipLevel = 0; mipLevel < metadata.mipLevels; ++mipLevel) {
+		const DirectX::Image* img = mipImages.GetImage(mipLevel, 0, 0);
+		texture.mips.push_back({ img->pixels, uint32_t(img->width), uint32_t(img->height), uint32_t(img->rowPitch) });
+	}
+	return texture;
+}
 
+// SoftwareRasterizerで描いた画像をPNGで書き出す
+void SaveSoftwareRender(const SoftwareRasterizer& rasterizer, const std::string& filePath) {
+	DirectX::Image image{};
+	image.width = rasterizer.GetWidth();
+	image.height = rasterizer.GetHeight();
+	image.format = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+	image.rowPitch = size_t(rasterizer.GetRowPitch()) * sizeof(uint32_t);
+	image.slicePitch = image.rowPitch * image.height;
+	image.pixels = reinterpret_cast<uint8_t*>(const_cast<uint32_t*>(rasterizer.GetPixels()));
+	Utf16Text<MAX_PATH> filePathW(filePath);
+	HRESULT hr = DirectX::SaveToWICFile(image, DirectX::WIC_FLAGS_FORCE_SRGB, DirectX::GetWICCodec(DirectX::WIC_CODEC_PNG), filePathW.c_str());
 	assert(SUCCEEDED(hr));
-
-	return resource;
 }
-#pragma endregion CreateDepthStencilTexture関数
+#pragma endregion SoftwareTexture関数
 
 #pragma region GetCPUDescriptorHandle関数
 D3D12_CPU_DESCRIPTOR_HANDLE GetCPUDescriptorHandle(ID3D12DescriptorHeap* descriptorHeap, uint32_t descriptorSize, uint32_t index) {
@@ -352,26 +266,49 @@ D3D12_GPU_DESCRIPTOR_HANDLE GetGPUDescriptorHandle(ID3D12DescriptorHeap* descrip
 }
 #pragma endregion GetGPUDescriptorHandle関数
 
+#pragma region 行の読み取り
+// textの先頭の空白を飛ばして次の空白までを返し、textをその後ろに進める。無ければ空
+std::string_view ReadToken(std::string_view& text) {
+	const size_t begin = text.find_first_not_of(" \t\r");
+	if (begin == std::string_view::npos) {
+		text = {};
+		return {};
+	}
+	const size_t end = (std::min)(text.find_first_of(" \t\r", begin), text.size());
+	const std::string_view token = text.substr(begin, end - begin);
+	text.remove_prefix(end);
+	return token;
+}
+
+// 次の語を数として読む。読めなければ0
+template<typename T>
+T ReadNumber(std::string_view& text) {
+	const std::string_view token = ReadToken(text);
+	T value{};
+	std::from_chars(token.data(), token.data() + token.size(), value);
+	return value;
+}
+#pragma endregion 行の読み取り
+
 #pragma region mtlファイル
 MaterialData LoadMaterialTemplateFile(const std::string& directoryPath, const std::string& filemane) {
 	// 1. 中で必要となる変数の宣言
+	ScratchScope scratch;
 	MaterialData materialData; //!< 構築するMaterialData
-	std::string line; //!< ファイルから読み込んだ1行を格納するもの
+	ScratchString line; //!< ファイルから読み込んだ1行を格納するもの
 	// 2. ファイルを開く
 	std::ifstream file(directoryPath + "/" + filemane);
 	assert(file.is_open());
 	// 3. 実際にファイルを読み、MaterialDataを構築していく
 	while (std::getline(file, line)) {
-		std::string identifier;
-		std::istringstream s(line);
-		s >> identifier;
+		std::string_view s(line);
+		const std::string_view identifier = ReadToken(s);
 
 		// identifierに応じた処置
 		if (identifier == "map_Kd") {
-			std::string textureFilename;
-			s >> textureFilename;
+			const std::string_view textureFilename = ReadToken(s);
 			// 連結してファイルパスにする
-			materialData.textureFilePath = directoryPath + "/" + textureFilename;
+			materialData.textureFilePath = directoryPath + "/" + std::string(textureFilename);
 		}
 	}
 	// 4. MateriarDataを返す
@@ -381,36 +318,43 @@ MaterialData LoadMaterialTemplateFile(const std::string& directoryPath, const st
 
 #pragma region Objファイル読み込み
 ModelData LoadObjFile(const std::string& directoryPath, const std::string& filename) {
+	PROFILE_SCOPE("LoadObjFile");
+	// 読み終えたら要らない配列と1行の文字列は、このスレッドの作業用のアリーナから確保する
+	ScratchScope scratch;
 	ModelData modelData; //!< 構築するModelData
-	std::vector<Vector4> positions; //!< 位置
-	std::vector<Vector3> normals; //!< 法線
-	std::vector<Vector2> texcoords; //!< テクスチャ座標
-	std::string line; //!< ファイルから読み込んだ1行を格納するもの
+	ScratchVector<Vector4> positions; //!< 位置
+	ScratchVector<Vector3> normals; //!< 法線
+	ScratchVector<Vector2> texcoords; //!< テクスチャ座標
+	ScratchString line; //!< ファイルから読み込んだ1行を格納するもの
 
 	std::ifstream file(directoryPath + "/" + filename); //!< ファイルを開く
 	assert(file.is_open()); //!< とりあえず開けなかったら止める
 
 	while (std::getline(file, line)) {
-		std::string indentifier;
-		std::istringstream s(line);
-		s >> indentifier; //!< 先頭の識別子を読む
+		std::string_view s(line);
+		const std::string_view indentifier = ReadToken(s); //!< 先頭の識別子を読む
 
 		// identifierに応じた処理
 		if (indentifier == "v") {
 			Vector4 position;
-			s >> position.x >> position.y >> position.z;
+			position.x = ReadNumber<float>(s);
+			position.y = ReadNumber<float>(s);
+			position.z = ReadNumber<float>(s);
 			position.z *= -1.0f;
 			position.w = 1.0f;
 			positions.push_back(position);
 		}
 		else if (indentifier == "vt") {
 			Vector2 texcood;
-			s >> texcood.u >> texcood.v;
+			texcood.u = ReadNumber<float>(s);
+			texcood.v = ReadNumber<float>(s);
 			texcoords.push_back(texcood);
 		}
 		else if (indentifier == "vn") {
 			Vector3 normal;
-			s >> normal.x >> normal.y >> normal.z;
+			normal.x = ReadNumber<float>(s);
+			normal.y = ReadNumber<float>(s);
+			normal.z = ReadNumber<float>(s);
 			normal.z *= -1.0f;
 			normals.push_back(normal);
 		}
@@ -418,16 +362,16 @@ ModelData LoadObjFile(const std::string& directoryPath, const std::string& filen
 			VertexData triangle[3];
 			// 面は三角形限定。その他は未対応
 			for (int32_t faceVertex = 0; faceVertex < 3; ++faceVertex) {
-				std::string vertexDefinion;
-				s >> vertexDefinion;
+				std::string_view vertexDefinion = ReadToken(s);
 				// 頂点の要素へのIndexは「位置 / UV / 法線」で格納されているので、
 				// 分解してIndexを取得する
-				std::istringstream v(vertexDefinion);
 				uint32_t elementIdices[3];
 				for (int32_t element = 0; element < 3; ++element) {
-					std::string index;
-					std::getline(v, index, '/'); //!< /区切りでインデックスを読んでいく
-					elementIdices[element] = std::stoi(index);
+					const size_t separator = (std::min)(vertexDefinion.find('/'), vertexDefinion.size());
+					auto result = std::from_chars(vertexDefinion.data(), vertexDefinion.data() + separator, elementIdices[element]); //!< /区切りでインデックスを読んでいく
+					assert(result.ec == std::errc());
+					(void)result;
+					vertexDefinion.remove_prefix((std::min)(separator + 1, vertexDefinion.size()));
 				}
 				// 要素へのIndexから、実際の要素の値を取得して、頂点を構築する
 				Vector4 position = positions[elementIdices[0] - 1];
@@ -445,12 +389,12 @@ ModelData LoadObjFile(const std::string& directoryPath, const std::string& filen
 		}
 		else if (indentifier == "mtllib") {
 			// materialTemplateLibraryファイルの名前を取得する
-			std::string materialFilename;
-			s >> materialFilename;
+			const std::string materialFilename(ReadToken(s));
 			// 基本的にobjファイルと同一階層にmtlは存在させているので、ディレクトリ名と、ファイル名を渡す
 			modelData.material = LoadMaterialTemplateFile(directoryPath,materialFilename);
 		}
 	}
+	modelData.bounds = ComputeMeshBounds(modelData.vertices.data(), modelData.vertices.size());
 	return modelData;
 }
 #pragma endregion Objファイル読み込み
@@ -458,10 +402,18 @@ ModelData LoadObjFile(const std::string& directoryPath, const std::string& filen
 //Windowsアプリでのエントリーポイント(main関数)
 int WINAPI WinMain(_In_ HINSTANCE, _In_opt_ HINSTANCE, _In_ LPSTR, _In_ int) {
 #pragma region Windows初期化処理
+	//ログは別スレッドで出力ウィンドウに書き出す
+	GetLogger().AddSink(std::make_unique<DebuggerLogSink>());
+	GetLogger().Start();
+	GetProfiler().SetThreadName("Main");
+	//並列の処理は全てJobSystemのワーカーで行う。メインスレッドが0番のワーカーになる
+	GetJobSystem().Start(0);
+	//1フレームだけ使うメモリ。足りなければ次から増える
+	GetFrameArena().Initialize(1024 * 1024);
 	//出力ウィンドウへの文字出力
 	OutputDebugStringA("Hello,DirectX\n");
 	//変数から型を推論してくれる
-	Log(std::format("enemyHP:{},texturePath:{}\n", 50, 70));
+	LOG_INFO(LogCategory::General, "enemyHP:{},texturePath:{}\n", 50, 70);
 
 	WNDCLASS wc{};
 	//ウィンドウプロシージャ
@@ -526,7 +478,7 @@ int WINAPI WinMain(_In_ HINSTANCE, _In_opt_ HINSTANCE, _In_ LPSTR, _In_ int) {
 		//ソフトウェアアダプタで無ければ採用!
 		if (!(adapterDesc.Flags & DXGI_ADAPTER_FLAG3_SOFTWARE)) {
 			//採用したアダプタの情報をログに出力。wstringの方なので注意
-			Log(std::format(L"Use Adapter:{}\n", adapterDesc.Description));
+			LOG_INFO(LogCategory::Graphics, L"Use Adapter:{}\n", adapterDesc.Description);
 			break;
 		}
 		useAdapter = nullptr;//ソフトウェアアダプタの場合は見なかったことにする
@@ -546,13 +498,13 @@ int WINAPI WinMain(_In_ HINSTANCE, _In_opt_ HINSTANCE, _In_ LPSTR, _In_ int) {
 		hr = D3D12CreateDevice(useAdapter, featureLevels[i], IID_PPV_ARGS(&device));
 		if (SUCCEEDED(hr)) {
 			//生成出来たのでログ出力を行ってループを抜ける
-			Log(std::format("FeatureLevel :	{}\n", featureLevelString[i]));
+			LOG_INFO(LogCategory::Graphics, "FeatureLevel :	{}\n", featureLevelString[i]);
 			break;
 		}
 	}
 	//デバイスの生成がうまくいかなかったので起動できない
 	assert(device != nullptr);
-	Log("Complete create D3D12Device!!\n");//初期化完了のログをだす
+	LOG_INFO(LogCategory::Graphics, "Complete create D3D12Device!!\n");//初期化完了のログをだす
 
 #ifdef _DEBUG
 	ID3D12InfoQueue* infoQueue = nullptr;
@@ -592,17 +544,11 @@ int WINAPI WinMain(_In_ HINSTANCE, _In_opt_ HINSTANCE, _In_ LPSTR, _In_ int) {
 	// コマンドキューの生成がうまくいかなかったので起動できない
 	assert(SUCCEEDED(hr));
 
-	// コマンドアローケータを生成する
-	ID3D12CommandAllocator* commandAllocator = nullptr;
-	hr = device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&commandAllocator));
-	// コマンドアローケータの生成がうまくいかなかったので起動できない
-	assert(SUCCEEDED(hr));
-
-	// コマンドリストを生成する
+	// コマンドアロケータとコマンドリストはParallelCommandRecorderが必要な数だけ作る
+	D3D12CommandListBackend commandListBackend;
+	commandListBackend.Initialize(device, commandQueue);
+	// 今積んでいるコマンドリスト。フレームの中で描画を並列に積むと次のリストに切り替わる
 	ID3D12GraphicsCommandList* commandList = nullptr;
-	hr = device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, commandAllocator, nullptr, IID_PPV_ARGS(&commandList));
-	// コマンドリストの生成がうまくいかなかったので起動できない
-	assert(SUCCEEDED(hr));
 
 	// 初期値0でFenceを作る
 	ID3D12Fence* fence = nullptr;
@@ -660,23 +606,43 @@ int WINAPI WinMain(_In_ HINSTANCE, _In_opt_ HINSTANCE, _In_ LPSTR, _In_ int) {
 #pragma endregion DirectX初期化処理
 #pragma region dxcCompilerを初期化
 	//dxcCompilerを初期化
-	IDxcUtils* dxcUtils = nullptr;
-	IDxcCompiler3* dxcCompiler = nullptr;
-	hr = DxcCreateInstance(CLSID_DxcUtils, IID_PPV_ARGS(&dxcUtils));
-	assert(SUCCEEDED(hr));
-	hr = DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&dxcCompiler));
-	assert(SUCCEEDED(hr));
+	//起動時はシェーダーを並列にコンパイルする。DXCのインスタンスはスレッドをまたいで使えないのでワーカーの数だけ作る
+	const uint32_t kStartupWorkerCount = GetJobSystem().GetWorkerCount();
+	std::vector<IDxcUtils*> dxcUtils(kStartupWorkerCount, nullptr);
+	std::vector<IDxcCompiler3*> dxcCompilers(kStartupWorkerCount, nullptr);
+	std::vector<IDxcIncludeHandler*> includeHandlers(kStartupWorkerCount, nullptr);
+	for (uint32_t worker = 0; worker < kStartupWorkerCount; ++worker) {
+		hr = DxcCreateInstance(CLSID_DxcUtils, IID_PPV_ARGS(&dxcUtils[worker]));
+		assert(SUCCEEDED(hr));
+		hr = DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&dxcCompilers[worker]));
+		assert(SUCCEEDED(hr));
 
-	//現時点でincludeはしないが、includeに対応するための設定を行っている
-	IDxcIncludeHandler* includeHandler = nullptr;
-	hr = dxcUtils->CreateDefaultIncludeHandler(&includeHandler);
-	assert(SUCCEEDED(hr));
+		//includeに対応するための設定を行っている
+		hr = dxcUtils[worker]->CreateDefaultIncludeHandler(&includeHandlers[worker]);
+		assert(SUCCEEDED(hr));
+	}
+
+	//コンパイル済みのシェーダーを保存しておく。DXCのバージョンが変わったら作り直す
+	uint64_t shaderCacheSalt = 0;
+	IDxcVersionInfo* dxcVersionInfo = nullptr;
+	if (SUCCEEDED(dxcCompilers[0]->QueryInterface(IID_PPV_ARGS(&dxcVersionInfo)))) {
+		uint32_t dxcMajor = 0;
+		uint32_t dxcMinor = 0;
+		dxcVersionInfo->GetVersion(&dxcMajor, &dxcMinor);
+		shaderCacheSalt = (uint64_t(dxcMajor) << 32) | dxcMinor;
+		dxcVersionInfo->Release();
+	}
+	FileShaderCacheStorage shaderCacheStorage(L"shaderCache");
+	ShaderCache shaderCache;
+	shaderCache.Initialize(&shaderCacheStorage, shaderCacheSalt);
 #pragma endregion dxcCompilerを初期化
+	// 描画のコマンドも同じ数のスレッドで積む。少ない描画は分けても速くならないので、1つのリストに64個以上積む
+	ParallelCommandRecorder commandRecorder;
+	commandRecorder.Initialize(&commandListBackend, &GetJobSystem(), 64);
 #pragma region 描画初期化処理
 	// DescriptorSizeを取得しておく
 	const uint32_t descriptorSizeSRV = device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
 	const uint32_t descriptorSizeRTV = device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
-	const uint32_t descriptorSizeDSV = device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_DSV);
 
 	//Rootsignature生成	
 	D3D12_ROOT_SIGNATURE_DESC descriptionRootSignature{};
@@ -703,7 +669,7 @@ int WINAPI WinMain(_In_ HINSTANCE, _In_opt_ HINSTANCE, _In_ LPSTR, _In_ int) {
 
 
 	//RootParameter生成。
-	D3D12_ROOT_PARAMETER rootParamers[4] = {};
+	D3D12_ROOT_PARAMETER rootParamers[7] = {};
 	rootParamers[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;//CBVを使う
 	rootParamers[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;//PixelShaderで使う
 	rootParamers[0].Descriptor.ShaderRegister = 0;//レジスタ番号0とバインド
@@ -721,6 +687,19 @@ int WINAPI WinMain(_In_ HINSTANCE, _In_opt_ HINSTANCE, _In_ LPSTR, _In_ int) {
 	rootParamers[3].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;	// PixelShaderを使う
 	rootParamers[3].Descriptor.ShaderRegister = 1;	// レジスタ番号1を使う
 
+	rootParamers[4].ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;	// StructuredBufferをSRVで使う
+	rootParamers[4].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;	// VertexShaderで使う
+	rootParamers[4].Descriptor.ShaderRegister = 0;	// レジスタ番号0を使う(インスタンシング用)
+
+	rootParamers[5].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;	// ルート定数を使う
+	rootParamers[5].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;	// VertexShaderで使う
+	rootParamers[5].Constants.ShaderRegister = 1;	// レジスタ番号1を使う(オブジェクト番号)
+	rootParamers[5].Constants.Num32BitValues = 1;	// uint32_t 1つ分
+
+	rootParamers[6].ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;	// StructuredBufferをSRVで使う
+	rootParamers[6].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;	// PixelShaderで使う
+	rootParamers[6].Descriptor.ShaderRegister = 1;	// レジスタ番号1を使う(インスタンスごとのマテリアル)
+
 	descriptionRootSignature.pParameters = rootParamers;//ルートパラメータ配列はのポインタ
 	descriptionRootSignature.NumParameters = _countof(rootParamers);//配列の長さ
 
@@ -730,7 +709,7 @@ int WINAPI WinMain(_In_ HINSTANCE, _In_opt_ HINSTANCE, _In_ LPSTR, _In_ int) {
 	hr = D3D12SerializeRootSignature(&descriptionRootSignature,
 		D3D_ROOT_SIGNATURE_VERSION_1, &signatureBlob, &errorBlob);
 	if (FAILED(hr)) {
-		Log(reinterpret_cast<char*>(errorBlob->GetBufferPointer()));
+		LOG_ERROR(LogCategory::Graphics, std::string_view(reinterpret_cast<char*>(errorBlob->GetBufferPointer())));
 		assert(false);
 	}
 	//バイナリを元に生成
@@ -739,6 +718,11 @@ int WINAPI WinMain(_In_ HINSTANCE, _In_opt_ HINSTANCE, _In_ LPSTR, _In_ int) {
 		signatureBlob->GetBufferSize(), IID_PPV_ARGS(&rootSignature));
 	assert(SUCCEEDED(hr));
 
+	//PSOは設定のハッシュで使い回し、PipelineLibraryに保存して次の起動ではドライバのコンパイルを省く
+	PipelineStateCache pipelineStateCache;
+	pipelineStateCache.Initialize(device, L"shaderCache/pipelineLibrary.bin");
+	pipelineStateCache.RegisterRootSignature(rootSignature, signatureBlob->GetBufferPointer(), signatureBlob->GetBufferSize());
+
 	//InputLayout
 	D3D12_INPUT_ELEMENT_DESC inputElementDescs[3] = {};
 	inputElementDescs[0].SemanticName = "POSITION";
@@ -770,27 +754,50 @@ int WINAPI WinMain(_In_ HINSTANCE, _In_opt_ HINSTANCE, _In_ LPSTR, _In_ int) {
 	//三角形の中を塗りつぶす
 	rasterizerDesc.FillMode = D3D12_FILL_MODE_SOLID;
 
-	//Shaderをコンパイルする
-	IDxcBlob* vertexShaderBlob = CompileShader(L"Object3d.VS.hlsl",
-		L"vs_6_0", dxcUtils, dxcCompiler, includeHandler);
-	assert(vertexShaderBlob != nullptr);
+	//シェーダーのコンパイルとPSOの生成はTaskGraphに積んでおき、最後にまとめて並列に実行する
+	//PSOは使うシェーダーのコンパイルが終わってから作られる
+	TaskGraph startupTaskGraph;
+
+	//Shaderをコンパイルする。機能の組み合わせごとにdefineを変えて作り、
+	//VSとPSで関係ない機能のビットが立った組み合わせは同じものを使う
+	IDxcBlob* vertexShaderBlobs[kShaderPermutationCount] = {};
+	IDxcBlob* pixelShaderBlobs[kShaderPermutationCount] = {};
+	uint32_t vertexShaderTasks[kShaderPermutationCount] = {};
+	uint32_t pixelShaderTasks[kShaderPermutationCount] = {};
+	for (uint32_t features = 0; features < kShaderPermutationCount; ++features) {
+		if ((features & kVertexShaderFeatureMask) == features) {
+			vertexShaderTasks[features] = startupTaskGraph.AddTask(std::format("Object3d.VS features:{}", features),
+				[&, features](uint32_t worker) {
+					vertexShaderBlobs[features] = CompileShader(L"Object3d.VS.hlsl",
+						L"vs_6_0", GetVertexShaderDefines(features), dxcUtils[worker], dxcCompilers[worker], includeHandlers[worker], &shaderCache);
+					assert(vertexShaderBlobs[features] != nullptr);
+				});
+		}
+		if ((features & kPixelShaderFeatureMask) == features) {
+			pixelShaderTasks[features] = startupTaskGraph.AddTask(std::format("Object3d.PS features:{}", features),
+				[&, features](uint32_t worker) {
+					pixelShaderBlobs[features] = CompileShader(L"Object3d.PS.hlsl",
+						L"ps_6_0", GetPixelShaderDefines(features), dxcUtils[worker], dxcCompilers[worker], includeHandlers[worker], &shaderCache);
+					assert(pixelShaderBlobs[features] != nullptr);
+				});
+		}
+	}
 
-	IDxcBlob* pixelShaderBlob = CompileShader(L"Object3d.PS.hlsl",
-		L"ps_6_0", dxcUtils, dxcCompiler, includeHandler);
-	assert(pixelShaderBlob != nullptr);
+	//テクスチャを使わないVertexShaderはtexcoordを読まないので、VertexDataのnormalだけを拾う
+	D3D12_INPUT_ELEMENT_DESC positionNormalInputElementDescs[2] = {};
+	positionNormalInputElementDescs[0] = inputElementDescs[0];
+	positionNormalInputElementDescs[0].AlignedByteOffset = offsetof(VertexData, position);
+	positionNormalInputElementDescs[1] = inputElementDescs[2];
+	positionNormalInputElementDescs[1].AlignedByteOffset = offsetof(VertexData, normal);
+	D3D12_INPUT_LAYOUT_DESC positionNormalInputLayoutDesc{};
+	positionNormalInputLayoutDesc.pInputElementDescs = positionNormalInputElementDescs;
+	positionNormalInputLayoutDesc.NumElements = _countof(positionNormalInputElementDescs);
 
 	//PSO生成
 	D3D12_GRAPHICS_PIPELINE_STATE_DESC graphicPipelineStateDesc{};
 	graphicPipelineStateDesc.pRootSignature = rootSignature;//RootSignature
 	graphicPipelineStateDesc.InputLayout = inputLayoutDesc;//InputLayout
-	graphicPipelineStateDesc.VS = {
-		vertexShaderBlob->GetBufferPointer(),
-		vertexShaderBlob->GetBufferSize()
-	};//vertexShader
-	graphicPipelineStateDesc.PS = {
-		pixelShaderBlob->GetBufferPointer(),
-		pixelShaderBlob->GetBufferSize()
-	};//pixelShader
+	//vertexShaderとpixelShaderは組み合わせごとに設定する
 	graphicPipelineStateDesc.BlendState = blendDesc;//BlendState
 	graphicPipelineStateDesc.RasterizerState = rasterizerDesc;//Rasterizer
 	//書き込むRTVの情報
@@ -815,116 +822,101 @@ int WINAPI WinMain(_In_ HINSTANCE, _In_opt_ HINSTANCE, _In_ LPSTR, _In_ int) {
 	graphicPipelineStateDesc.DepthStencilState = depthStencilDesc;
 	graphicPipelineStateDesc.DSVFormat = DXGI_FORMAT_D24_UNORM_S8_UINT;
 
-	//実際に生成
-	ID3D12PipelineState* graphicPipelineState = nullptr;
-	hr = device->CreateGraphicsPipelineState(&graphicPipelineStateDesc,
-		IID_PPV_ARGS(&graphicPipelineState));
-	assert(SUCCEEDED(hr));
+	//機能の組み合わせごとのPSOの設定。シェーダー以外はここで決めておき、ホットリロードでも使う
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC object3dPipelineStateDescs[kShaderPermutationCount] = {};
+	for (uint32_t features = 0; features < kShaderPermutationCount; ++features) {
+		object3dPipelineStateDescs[features] = graphicPipelineStateDesc;
+		if (GetVertexFormat(features) == VertexFormat::PositionNormal) {
+			object3dPipelineStateDescs[features].InputLayout = positionNormalInputLayoutDesc;
+		}
+	}
 
-	// 分割数 球
-	const uint32_t kSubdivision = 16;
+	//実際に生成。機能の組み合わせごとに1つ作り、マテリアルの設定から選んで使う
+	ID3D12PipelineState* object3dPipelineStates[kShaderPermutationCount] = {};
+	for (uint32_t features = 0; features < kShaderPermutationCount; ++features) {
+		const uint32_t pipelineStateTask = startupTaskGraph.AddTask(std::format("Object3d PSO features:{}", features),
+			[&, features](uint32_t) {
+				D3D12_GRAPHICS_PIPELINE_STATE_DESC pipelineStateDesc = object3dPipelineStateDescs[features];
+				IDxcBlob* vertexShaderBlob = vertexShaderBlobs[features & kVertexShaderFeatureMask];
+				IDxcBlob* pixelShaderBlob = pixelShaderBlobs[features & kPixelShaderFeatureMask];
+				pipelineStateDesc.VS = { vertexShaderBlob->GetBufferPointer(), vertexShaderBlob->GetBufferSize() };
+				pipelineStateDesc.PS = { pixelShaderBlob->GetBufferPointer(), pixelShaderBlob->GetBufferSize() };
+				object3dPipelineStates[features] = pipelineStateCache.GetGraphicsPipelineState(pipelineStateDesc);
+			});
+		startupTaskGraph.AddDependency(vertexShaderTasks[features & kVertexShaderFeatureMask], pipelineStateTask);
+		startupTaskGraph.AddDependency(pixelShaderTasks[features & kPixelShaderFeatureMask], pipelineStateTask);
+	}
 
-	//頂点リソースを作成
-	ID3D12Resource* vertexResource = CreateBufferResource(device, sizeof(VertexData) * kSubdivision * kSubdivision * 6);
-	//頂点バッファビューを作成する
-	D3D12_VERTEX_BUFFER_VIEW vertexBufferView{};
-	//リソースの先頭のアドレスから使う
-	vertexBufferView.BufferLocation = vertexResource->GetGPUVirtualAddress();
-	
-	//使用するリソースのサイズは頂点3つ分のサイズ
-	vertexBufferView.SizeInBytes = sizeof(VertexData) * kSubdivision * kSubdivision * 6;
-	//1頂点当たりのサイズ
-	vertexBufferView.StrideInBytes = sizeof(VertexData);
+	// SpriteBatch用のShader
+	IDxcBlob* spriteVertexShaderBlob = nullptr;
+	IDxcBlob* spritePixelShaderBlob = nullptr;
+	const uint32_t spriteVertexShaderTask = startupTaskGraph.AddTask("Sprite.VS", [&](uint32_t worker) {
+		spriteVertexShaderBlob = CompileShader(L"Sprite.VS.hlsl",
+			L"vs_6_0", {}, dxcUtils[worker], dxcCompilers[worker], includeHandlers[worker], &shaderCache);
+		assert(spriteVertexShaderBlob != nullptr);
+	});
+	const uint32_t spritePixelShaderTask = startupTaskGraph.AddTask("Sprite.PS", [&](uint32_t worker) {
+		spritePixelShaderBlob = CompileShader(L"Sprite.PS.hlsl",
+			L"ps_6_0", {}, dxcUtils[worker], dxcCompilers[worker], includeHandlers[worker], &shaderCache);
+		assert(spritePixelShaderBlob != nullptr);
+	});
+
+	// SpriteBatch用のInputLayout。SpriteVertexと合わせる
+	D3D12_INPUT_ELEMENT_DESC spriteInputElementDescs[3] = {};
+	spriteInputElementDescs[0].SemanticName = "POSITION";
+	spriteInputElementDescs[0].Format = DXGI_FORMAT_R32G32_FLOAT;
+	spriteInputElementDescs[0].AlignedByteOffset = D3D12_APPEND_ALIGNED_ELEMENT;
+	spriteInputElementDescs[1].SemanticName = "TEXCOORD";
+	spriteInputElementDescs[1].Format = DXGI_FORMAT_R32G32_FLOAT;
+	spriteInputElementDescs[1].AlignedByteOffset = D3D12_APPEND_ALIGNED_ELEMENT;
+	spriteInputElementDescs[2].SemanticName = "COLOR";
+	spriteInputElementDescs[2].Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	spriteInputElementDescs[2].AlignedByteOffset = D3D12_APPEND_ALIGNED_ELEMENT;
+
+	// SpriteBatch用のPSO。αブレンドして、深度は使わない
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC spritePipelineStateDesc = graphicPipelineStateDesc;
+	spritePipelineStateDesc.InputLayout = { spriteInputElementDescs, _countof(spriteInputElementDescs) };
+	spritePipelineStateDesc.BlendState.RenderTarget[0].BlendEnable = true;
+	spritePipelineStateDesc.BlendState.RenderTarget[0].SrcBlend = D3D12_BLEND_SRC_ALPHA;
+	spritePipelineStateDesc.BlendState.RenderTarget[0].DestBlend = D3D12_BLEND_INV_SRC_ALPHA;
+	spritePipelineStateDesc.BlendState.RenderTarget[0].BlendOp = D3D12_BLEND_OP_ADD;
+	spritePipelineStateDesc.BlendState.RenderTarget[0].SrcBlendAlpha = D3D12_BLEND_ONE;
+	spritePipelineStateDesc.BlendState.RenderTarget[0].DestBlendAlpha = D3D12_BLEND_ZERO;
+	spritePipelineStateDesc.BlendState.RenderTarget[0].BlendOpAlpha = D3D12_BLEND_OP_ADD;
+	spritePipelineStateDesc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
+	spritePipelineStateDesc.DepthStencilState.DepthEnable = false;
+	spritePipelineStateDesc.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ZERO;
+	ID3D12PipelineState* spritePipelineState = nullptr;
+	const uint32_t spritePipelineStateTask = startupTaskGraph.AddTask("Sprite PSO", [&](uint32_t) {
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC pipelineStateDesc = spritePipelineStateDesc;
+		pipelineStateDesc.VS = { spriteVertexShaderBlob->GetBufferPointer(), spriteVertexShaderBlob->GetBufferSize() };
+		pipelineStateDesc.PS = { spritePixelShaderBlob->GetBufferPointer(), spritePixelShaderBlob->GetBufferSize() };
+		spritePipelineState = pipelineStateCache.GetGraphicsPipelineState(pipelineStateDesc);
+	});
+	startupTaskGraph.AddDependency(spriteVertexShaderTask, spritePipelineStateTask);
+	startupTaskGraph.AddDependency(spritePixelShaderTask, spritePipelineStateTask);
+
+	//積んだタスクを全て実行し、それぞれにかかった時間をログに出す
+	startupTaskGraph.Execute();
+	for (uint32_t task = 0; task < startupTaskGraph.GetTaskCount(); ++task) {
+		LOG_INFO(LogCategory::General, "Startup {}: {:.2f}ms (worker {})\n", startupTaskGraph.GetTaskName(task),
+			startupTaskGraph.GetTaskMilliseconds(task), startupTaskGraph.GetTaskWorker(task));
+	}
+	LOG_INFO(LogCategory::General, "Startup total: {:.2f}ms, {} tasks, {} workers\n",
+		startupTaskGraph.GetTotalMilliseconds(), startupTaskGraph.GetTaskCount(), kStartupWorkerCount);
+	LOG_INFO(LogCategory::Shader, "ShaderCache hit:{} miss:{}\n", shaderCache.GetHitCount(), shaderCache.GetMissCount());
+	LOG_INFO(LogCategory::Graphics, "PipelineStateCache request:{} dedupe:{} library:{} create:{}\n",
+		pipelineStateCache.GetRequestCount(), pipelineStateCache.GetDedupeCount(),
+		pipelineStateCache.GetLibraryLoadCount(), pipelineStateCache.GetCreateCount());
 
-	//頂点リソースにデータを書き込む
-	VertexData* vertexData = nullptr;
-	//書き込むためのアドレスを取得
-	vertexResource->Map(0, nullptr, reinterpret_cast<void**>(&vertexData));
-	
-	// 経度分割1つ分の角度
-	const float kLonEvery = static_cast<float>(M_PI) * 2.0f / kSubdivision;
-	// 緯度分割1つ分の角度
-	const float kLatEvery = static_cast<float>(M_PI) / kSubdivision;
-
-	// 緯度の方向に分割 -M_PI/2 ~ M_PI/2
-	for (uint32_t latIndex = 0; latIndex < kSubdivision; ++latIndex) {
-		//現在の緯度
-		float lat = static_cast<float>(-M_PI) / 2.0f + kLatEvery * latIndex;
-		// 経度の方向に分割 0 ~ 2*M_PI
-		for (uint32_t lonIndex = 0; lonIndex < kSubdivision; ++lonIndex) {
-			uint32_t strat = (latIndex * kSubdivision + lonIndex) * 6;
-			// 現在の経度
-			float lon = lonIndex * kLonEvery;
-			// 頂点データを入力する。基準点a
-			// a
-			vertexData[strat].position.x = std::cos(lat) * std::cos(lon);
-			vertexData[strat].position.y = std::sin(lat);
-			vertexData[strat].position.z = std::cos(lat) * std::sin(lon);
-			vertexData[strat].position.w = 1.0f;
-			vertexData[strat].texcoord.u = float(lonIndex) / float(kSubdivision);
-			vertexData[strat].texcoord.v = 1.0f - float(latIndex) / float(kSubdivision);
-			vertexData[strat].normal.x = vertexData[strat].position.x;
-			vertexData[strat].normal.y = vertexData[strat].position.y;
-			vertexData[strat].normal.z = vertexData[strat].position.z;
-
-			// b
-			vertexData[strat + 1].position.x = std::cos(lat + kLatEvery) * std::cos(lon);
-			vertexData[strat + 1].position.y = std::sin(lat + kLatEvery);
-			vertexData[strat + 1].position.z = std::cos(lat + kLatEvery) * std::sin(lon);
-			vertexData[strat + 1].position.w = 1.0f;
-			vertexData[strat + 1].texcoord.u = float(lonIndex) / float(kSubdivision);
-			vertexData[strat + 1].texcoord.v = 1.0f - float(latIndex + 1) / float(kSubdivision);
-			vertexData[strat + 1].normal.x = vertexData[strat + 1].position.x;
-			vertexData[strat + 1].normal.y = vertexData[strat + 1].position.y;
-			vertexData[strat + 1].normal.z = vertexData[strat + 1].position.z;
-
-			// c
-			vertexData[strat + 2].position.x = std::cos(lat) * std::cos(lon + kLonEvery);
-			vertexData[strat + 2].position.y = std::sin(lat);
-			vertexData[strat + 2].position.z = std::cos(lat) * std::sin(lon + kLonEvery);
-			vertexData[strat + 2].position.w = 1.0f;
-			vertexData[strat + 2].texcoord.u = float(lonIndex + 1) / float(kSubdivision);
-			vertexData[strat + 2].texcoord.v = 1.0f - float(latIndex) / float(kSubdivision);
-			vertexData[strat + 2].normal.x = vertexData[strat + 2].position.x;
-			vertexData[strat + 2].normal.y = vertexData[strat + 2].position.y;
-			vertexData[strat + 2].normal.z = vertexData[strat + 2].position.z;
-
-			// c
-			vertexData[strat + 3].position.x = std::cos(lat) * std::cos(lon + kLonEvery);
-			vertexData[strat + 3].position.y = std::sin(lat);
-			vertexData[strat + 3].position.z = std::cos(lat) * std::sin(lon + kLonEvery);
-			vertexData[strat + 3].position.w = 1.0f;
-			vertexData[strat + 3].texcoord.u = float(lonIndex + 1) / float(kSubdivision);
-			vertexData[strat + 3].texcoord.v = 1.0f - float(latIndex) / float(kSubdivision);
-			vertexData[strat + 3].normal.x = vertexData[strat + 3].position.x;
-			vertexData[strat + 3].normal.y = vertexData[strat + 3].position.y;
-			vertexData[strat + 3].normal.z = vertexData[strat + 3].position.z;
-
-			// b
-			vertexData[strat + 4].position.x = std::cos(lat + kLatEvery) * std::cos(lon);
-			vertexData[strat + 4].position.y = std::sin(lat + kLatEvery);
-			vertexData[strat + 4].position.z = std::cos(lat + kLatEvery) * std::sin(lon);
-			vertexData[strat + 4].position.w = 1.0f;
-			vertexData[strat + 4].texcoord.u = float(lonIndex) / float(kSubdivision);
-			vertexData[strat + 4].texcoord.v = 1.0f - float(latIndex + 1) / float(kSubdivision);
-			vertexData[strat + 4].normal.x = vertexData[strat + 4].position.x;
-			vertexData[strat + 4].normal.y = vertexData[strat + 4].position.y;
-			vertexData[strat + 4].normal.z = vertexData[strat + 4].position.z;
-
-
-			// d
-			vertexData[strat + 5].position.x = std::cos(lat + kLatEvery) * std::cos(lon + kLonEvery);
-			vertexData[strat + 5].position.y = std::sin(lat + kLatEvery);
-			vertexData[strat + 5].position.z = std::cos(lat + kLatEvery) * std::sin(lon + kLonEvery);
-			vertexData[strat + 5].position.w = 1.0f;
-			vertexData[strat + 5].texcoord.u = float(lonIndex + 1) / float(kSubdivision);
-			vertexData[strat + 5].texcoord.v = 1.0f - float(latIndex + 1) / float(kSubdivision);
-			vertexData[strat + 5].normal.x = vertexData[strat + 5].position.x;
-			vertexData[strat + 5].normal.y = vertexData[strat + 5].position.y;
-			vertexData[strat + 5].normal.z = vertexData[strat + 5].position.z;
+	// インスタンシング用のPSO。ライティングとテクスチャは通常のモデルと同じ
+	ID3D12PipelineState* instancingPipelineState = object3dPipelineStates[SelectShaderFeatures(true, true, true)];
 
-		}
-	}
+	// 球。緯度経度の交点ごとに1頂点だけ作り、インデックスで共有する
+	const uint32_t kSubdivision = 16;
+	const PrimitiveDesc sphereDesc{ PrimitiveType::Sphere, kSubdivision, 0.0f };
+	const uint32_t kSphereVertexCount = GetPrimitiveVertexCount(sphereDesc);
+	const uint32_t kSphereIndexCount = GetPrimitiveIndexCount(sphereDesc);
 
 	//マテリアル用のリソースを作る。今回はcolor1つ分のサイズを用意する
 	ID3D12Resource* materialResource = CreateBufferResource(device, sizeof(Material));
@@ -960,14 +952,20 @@ int WINAPI WinMain(_In_ HINSTANCE, _In_opt_ HINSTANCE, _In_ LPSTR, _In_ int) {
 	directionalLightData->direction = { 0.0f,-1.0f,0.0f };
 	directionalLightData->intensiy = 1.0f;
 
-	//Textureを読み込んで転送する
-	DirectX::ScratchImage mipImages = LoadTexture("resources/uvChecker.png");
+	//Textureの読み込みとミップマップの作成は2枚を並列に行う
+	DirectX::ScratchImage mipImages;
+	DirectX::ScratchImage mipImages2;
+	JobCounter textureLoadCounter;
+	GetJobSystem().Run(textureLoadCounter, [&](uint32_t) { mipImages = LoadTexture("resources/uvChecker.png"); });
+	GetJobSystem().Run(textureLoadCounter, [&](uint32_t) { mipImages2 = LoadTexture("resources/monsterBall.png"); });
+	GetJobSystem().Wait(textureLoadCounter);
+
+	//Textureを転送する
 	const DirectX::TexMetadata& metadata = mipImages.GetMetadata();
 	ID3D12Resource* textureResourec = CreateTextureResourec(device, metadata);
 	UploadTextureData(textureResourec, mipImages);
 
-	// 2枚目のTextureを読み込んで転送する
-	DirectX::ScratchImage mipImages2 = LoadTexture("resources/monsterBall.png");
+	// 2枚目のTextureを転送する
 	const DirectX::TexMetadata& matedata2 = mipImages2.GetMetadata();
 	ID3D12Resource* textureResource2 = CreateTextureResourec(device, matedata2);
 	UploadTextureData(textureResource2, mipImages2);
@@ -1000,19 +998,19 @@ int WINAPI WinMain(_In_ HINSTANCE, _In_opt_ HINSTANCE, _In_ LPSTR, _In_ int) {
 	D3D12_GPU_DESCRIPTOR_HANDLE textureSrvHandleGPU2 = GetGPUDescriptorHandle(srvDescriptorHeap, descriptorSizeSRV, 2);
 	device->CreateShaderResourceView(textureResource2, &srvDesc2, textureSrvHandleCPU2);
 	
-	// DepthStemcilTextureをウィンドウのサイズで作成
-	ID3D12Resource* depthStencilResource = CreateDepthStencilTextureResource(device,kClientWidth,kClientHeight);
-	
-	// DSV用のヒープでディスクリプタの数は1。DSVはShader内で触るものではないにで、ShaderVisibleはfalse
-	ID3D12DescriptorHeap* dsvDescriptorHeap = CreateDescriptorHeap(device, D3D12_DESCRIPTOR_HEAP_TYPE_DSV, 1, false);
-
-	// DSVの設定
-	D3D12_DEPTH_STENCIL_VIEW_DESC dsvDesc{};
-	dsvDesc.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;// Format。基本的にはResourceに合わせる
-	dsvDesc.ViewDimension = D3D12_DSV_DIMENSION_TEXTURE2D; // 2DTexture
-	
-	// DSVHeapの先頭にDSVを作る
-	device->CreateDepthStencilView(depthStencilResource, &dsvDesc, dsvDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
+	// 描画のパスはRenderGraphで毎フレーム組み立てる。バリアと深度バッファなどの一時テクスチャはRenderGraphが用意する
+	RenderGraph renderGraph;
+	D3D12RenderGraphExecutor renderGraphExecutor;
+	renderGraphExecutor.Initialize(device, 16);
+	// パスごとのGPUの時間をタイムスタンプクエリで測る。結果はバックバッファの数のフレームを輪番で使って読む
+	const uint32_t kMaxGpuQueriesPerFrame = 64;
+	D3D12GpuQuerySource gpuQuerySource;
+	gpuQuerySource.Initialize(device, commandQueue, swapChainDesc.BufferCount * kMaxGpuQueriesPerFrame);
+	GpuProfiler gpuProfiler;
+	gpuProfiler.Initialize(&gpuQuerySource, swapChainDesc.BufferCount, kMaxGpuQueriesPerFrame);
+	renderGraphExecutor.SetGpuProfiler(&gpuProfiler, &gpuQuerySource);
+	// 深度バッファはウィンドウのサイズで、1.0f(最大値)でクリアする
+	const RenderGraphTextureDesc depthBufferDesc = { uint32_t(kClientWidth), uint32_t(kClientHeight), DXGI_FORMAT_D24_UNORM_S8_UINT, { 1.0f } };
 
 	// Sprite用の頂点リソースを作る
 	ID3D12Resource* vertexResourceSprite = CreateBufferResource(device, sizeof(VertexData) * 6);
@@ -1076,14 +1074,15 @@ int WINAPI WinMain(_In_ HINSTANCE, _In_opt_ HINSTANCE, _In_ LPSTR, _In_ int) {
 	// matrixの初期化
 	materialData->uvTransform = MakeIdentity4x4();
 
-	// Sprite用のTransformationMarix用のリソースを作る。Matrix4x4 一つ分のサイズを用意する
-	ID3D12Resource* transformMatrixResourceSprite = CreateBufferResource(device, sizeof(mat4x4));
+	// Sprite用のTransformationMarix用のリソースを作る。VertexShaderはWVPとWorldを読むのでTransformationMatrix分用意する
+	ID3D12Resource* transformMatrixResourceSprite = CreateBufferResource(device, sizeof(TransformationMatrix));
 	// データを書き込む
-	mat4x4* transformationMatrixDataSprite = nullptr;
+	TransformationMatrix* transformationMatrixDataSprite = nullptr;
 	// 書き込むためのアドレスを取得
 	transformMatrixResourceSprite->Map(0, nullptr, reinterpret_cast<void**>(&transformationMatrixDataSprite));
 	// 単位行列を書き込んでおく
-	*transformationMatrixDataSprite = MakeIdentity4x4();
+	transformationMatrixDataSprite->WVP = MakeIdentity4x4();
+	transformationMatrixDataSprite->world = MakeIdentity4x4();
 
 	WorldTransform transforSprite{ {1.0f,1.0f,1.0f},{0.0f,0.0f,0.0f},{0.0f,0.0f,0.0f} };
 
@@ -1138,6 +1137,259 @@ int WINAPI WinMain(_In_ HINSTANCE, _In_opt_ HINSTANCE, _In_ LPSTR, _In_ int) {
 	D3D12_GPU_DESCRIPTOR_HANDLE textureSrvHandleGPUModel = GetGPUDescriptorHandle(srvDescriptorHeap, descriptorSizeSRV, 3);
 	device->CreateShaderResourceView(textureResourceModel, &srvDescModel, textureSrvHandleCPUModel);
 
+	// インスタンシングとExecuteIndirectで使うマテリアル。InstanceData::materialIndexで引く
+	// 色はmaterialDataの色にそれぞれの色を掛けたものを毎フレーム書き込む
+	const Vector4 kInstanceMaterialColors[] = {
+		{ 1.0f,1.0f,1.0f,1.0f },
+		{ 1.0f,0.4f,0.4f,1.0f },
+		{ 0.4f,1.0f,0.4f,1.0f },
+		{ 0.4f,0.4f,1.0f,1.0f },
+	};
+	const uint32_t kNumInstanceMaterial = _countof(kInstanceMaterialColors);
+	ID3D12Resource* instanceMaterialResource = CreateBufferResource(device, sizeof(Material) * kNumInstanceMaterial);
+	Material* instanceMaterialData = nullptr;
+	instanceMaterialResource->Map(0, nullptr, reinterpret_cast<void**>(&instanceMaterialData));
+
+	// インスタンシング描画用のリソースを作る。1ドローでkNumInstance個描画する
+	const uint32_t kNumInstance = 1000;
+	ID3D12Resource* instancingResource = CreateBufferResource(device, sizeof(InstanceData) * kNumInstance);
+	InstanceData* instancingData = nullptr;
+	instancingResource->Map(0, nullptr, reinterpret_cast<void**>(&instancingData));
+	// 10x10x10の格子状に並べ、層ごとにマテリアルを変える
+	std::vector<WorldTransform> instanceTransforms(kNumInstance);
+	std::vector<uint32_t> instanceMaterialIndices(kNumInstance);
+	for (uint32_t index = 0; index < kNumInstance; ++index) {
+		instanceMaterialIndices[index] = (index / 100) % kNumInstanceMaterial;
+		instanceTransforms[index].scale = { 0.2f,0.2f,0.2f };
+		instanceTransforms[index].rotate = { 0.0f,0.0f,0.0f };
+		instanceTransforms[index].translate = {
+			float(index % 10) - 4.5f,
+			float((index / 10) % 10) - 4.5f,
+			float(index / 100) * 2.0f
+		};
+	}
+
+	// ExecuteIndirect用のCommandSignature。ルート定数(オブジェクト番号) -> DrawIndexedの順に並べる
+	D3D12_INDIRECT_ARGUMENT_DESC indirectArgumentDescs[2] = {};
+	indirectArgumentDescs[0].Type = D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT;
+	indirectArgumentDescs[0].Constant.RootParameterIndex = 5;
+	indirectArgumentDescs[0].Constant.DestOffsetIn32BitValues = 0;
+	indirectArgumentDescs[0].Constant.Num32BitValuesToSet = 1;
+	indirectArgumentDescs[1].Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED;
+	D3D12_COMMAND_SIGNATURE_DESC commandSignatureDesc{};
+	commandSignatureDesc.ByteStride = sizeof(IndirectCommand);
+	commandSignatureDesc.NumArgumentDescs = _countof(indirectArgumentDescs);
+	commandSignatureDesc.pArgumentDescs = indirectArgumentDescs;
+	// ルート定数を書き換えるのでRootSignatureを渡す
+	ID3D12CommandSignature* commandSignature = nullptr;
+	hr = device->CreateCommandSignature(&commandSignatureDesc, rootSignature, IID_PPV_ARGS(&commandSignature));
+	assert(SUCCEEDED(hr));
+
+	// ExecuteIndirectでは頂点バッファを切り替えられないので、球とモデルを1つのバッファにまとめる
+	const uint32_t kIndirectVertexCount = kSphereVertexCount + uint32_t(modelData.vertices.size());
+	ID3D12Resource* indirectVertexResource = CreateBufferResource(device, sizeof(VertexData) * kIndirectVertexCount);
+	D3D12_VERTEX_BUFFER_VIEW indirectVertexBufferView{};
+	indirectVertexBufferView.BufferLocation = indirectVertexResource->GetGPUVirtualAddress();
+	indirectVertexBufferView.SizeInBytes = UINT(sizeof(VertexData) * kIndirectVertexCount);
+	indirectVertexBufferView.StrideInBytes = sizeof(VertexData);
+	VertexData* indirectVertexData = nullptr;
+	indirectVertexResource->Map(0, nullptr, reinterpret_cast<void**>(&indirectVertexData));
+	std::memcpy(indirectVertexData + kSphereVertexCount, vertexDataModel, sizeof(VertexData) * modelData.vertices.size());
+
+	// 球は生成したインデックスをそのまま使い、インデックスを持たないモデルには連番を書き込む
+	const uint32_t kIndirectIndexCount = kSphereIndexCount + uint32_t(modelData.vertices.size());
+	ID3D12Resource* indirectIndexResource = CreateBufferResource(device, sizeof(uint32_t) * kIndirectIndexCount);
+	D3D12_INDEX_BUFFER_VIEW indirectIndexBufferView{};
+	indirectIndexBufferView.BufferLocation = indirectIndexResource->GetGPUVirtualAddress();
+	indirectIndexBufferView.SizeInBytes = UINT(sizeof(uint32_t) * kIndirectIndexCount);
+	indirectIndexBufferView.Format = DXGI_FORMAT_R32_UINT;
+	uint32_t* indirectIndexData = nullptr;
+	indirectIndexResource->Map(0, nullptr, reinterpret_cast<void**>(&indirectIndexData));
+	WritePrimitive(sphereDesc, indirectVertexData, indirectIndexData);
+	for (uint32_t index = 0; index < uint32_t(modelData.vertices.size()); ++index) {
+		indirectIndexData[kSphereIndexCount + index] = index;
+	}
+
+	IndirectDrawBuilder indirectDrawBuilder;
+	const uint32_t kIndirectMeshSphere = indirectDrawBuilder.AddMesh({ kSphereIndexCount, 0, 0 });
+	const uint32_t kIndirectMeshModel = indirectDrawBuilder.AddMesh({ uint32_t(modelData.vertices.size()), kSphereIndexCount, int32_t(kSphereVertexCount) });
+	// ExecuteIndirectで使えるPSO。IndirectDrawObject::pipelineはこの配列の番号
+	ID3D12PipelineState* indirectPipelineStates[] = { instancingPipelineState };
+
+	// ExecuteIndirectで描画するオブジェクト
+	const uint32_t kNumIndirectObject = 512;
+	std::vector<WorldTransform> indirectTransforms(kNumIndirectObject);
+	std::vector<uint32_t> indirectMaterialIndices(kNumIndirectObject);
+	for (uint32_t index = 0; index < kNumIndirectObject; ++index) {
+		indirectMaterialIndices[index] = index % kNumInstanceMaterial;
+		indirectTransforms[index].scale = { 0.3f,0.3f,0.3f };
+		indirectTransforms[index].rotate = { 0.0f,0.0f,0.0f };
+		indirectTransforms[index].translate = {
+			float(index % 8) * 1.5f - 5.25f,
+			float((index / 8) % 8) * 1.5f - 5.25f,
+			float(index / 64) * 1.5f
+		};
+	}
+	// オブジェクトのワールド座標のAABB。偶数番目は球、奇数番目はモデル
+	const MeshBounds indirectSphereBounds = GetPrimitiveBounds(sphereDesc);
+	auto getIndirectBounds = [&](uint32_t index) {
+		const WorldTransform& indirectTransform = indirectTransforms[index];
+		const MeshBounds& meshBounds = (index % 2 == 0) ? indirectSphereBounds : modelData.bounds;
+		return TransformAABB(meshBounds.aabb, MakeAffineMatrix(indirectTransform.scale, indirectTransform.rotate, indirectTransform.translate));
+	};
+	// オブジェクトをBVHに入れておき、カリングやピッキングで使う。BVHの物体の番号はオブジェクトの番号と同じ
+	SceneBVH sceneBVH;
+	for (uint32_t index = 0; index < kNumIndirectObject; ++index) {
+		sceneBVH.AddObject(getIndirectBounds(index));
+	}
+	sceneBVH.Build();
+	// 手前の1列(z方向の最初の64個)を遮蔽物にして、CPUで描いた深度で奥のオブジェクトが隠れているかを調べる
+	const uint32_t kNumOccluderObject = 64;
+	OcclusionBuffer occlusionBuffer;
+	occlusionBuffer.Initialize(kClientWidth / 4, kClientHeight / 4);
+	// 遮蔽物の球は描画用より粗く作ったCPU側のメッシュを使う
+	const PrimitiveDesc occluderSphereDesc{ PrimitiveType::Sphere, 8, 0.0f };
+	std::vector<VertexData> occluderSphereVertices(GetPrimitiveVertexCount(occluderSphereDesc));
+	std::vector<uint32_t> occluderSphereIndices(GetPrimitiveIndexCount(occluderSphereDesc));
+	WritePrimitive(occluderSphereDesc, occluderSphereVertices.data(), occluderSphereIndices.data());
+	ID3D12Resource* indirectInstanceResource = CreateBufferResource(device, sizeof(InstanceData) * kNumIndirectObject);
+	InstanceData* indirectInstanceData = nullptr;
+	indirectInstanceResource->Map(0, nullptr, reinterpret_cast<void**>(&indirectInstanceData));
+	// CPUで毎フレーム書き込む引数バッファ
+	ID3D12Resource* indirectArgumentResource = CreateBufferResource(device, sizeof(IndirectCommand) * kNumIndirectObject);
+	IndirectCommand* indirectArgumentData = nullptr;
+	indirectArgumentResource->Map(0, nullptr, reinterpret_cast<void**>(&indirectArgumentData));
+	std::vector<IndirectBatch> indirectBatches;
+	uint32_t indirectCommandCount = 0;
+
+	// RenderDeviceで作るバッファとテクスチャは、大きなヒープを切り分けたPlacedResourceにする
+	D3D12GpuMemoryAllocator gpuMemoryAllocator;
+	gpuMemoryAllocator.Initialize(device);
+	// RenderQueueの描画はRenderDeviceを通して積む。ディスクリプタヒープの後ろ半分をRenderDeviceで作るSRVに使う
+	D3D12RenderDevice renderDevice;
+	renderDevice.Initialize(device, rootSignature, srvDescriptorHeap, 64, 64, &gpuMemoryAllocator);
+	// RenderQueueで使う状態を登録しておく。DrawItemはここで返る番号で状態を指定する
+	// 既に作ってあるリソースはRenderDeviceにImportして番号を付ける
+	DeviceRenderQueueExecutor renderQueueExecutor;
+	// Object3dのPSOは組み合わせごとに登録し、featuresで引けるようにする
+	RenderPipelineHandle object3dPipelineHandles[kShaderPermutationCount] = {};
+	uint32_t object3dPipelines[kShaderPermutationCount] = {};
+	for (uint32_t features = 0; features < kShaderPermutationCount; ++features) {
+		object3dPipelineHandles[features] = renderDevice.ImportPipeline(object3dPipelineStates[features]);
+		object3dPipelines[features] = renderQueueExecutor.AddPipeline(object3dPipelineHandles[features]);
+	}
+	const uint32_t kMaterialObject = renderQueueExecutor.AddMaterial(renderDevice.ImportBuffer(materialResource, RenderHeapType::Upload));
+	const uint32_t kMaterialSprite = renderQueueExecutor.AddMaterial(renderDevice.ImportBuffer(materialResourceSprite, RenderHeapType::Upload));
+	const uint32_t kTextureUvChecker = renderQueueExecutor.AddTexture(renderDevice.ImportTextureView(textureSrvHandleGPU));
+	const uint32_t kTextureMonsterBall = renderQueueExecutor.AddTexture(renderDevice.ImportTextureView(textureSrvHandleGPU2));
+	const uint32_t kTextureModel = renderQueueExecutor.AddTexture(renderDevice.ImportTextureView(textureSrvHandleGPUModel));
+	const RenderBufferHandle vertexBufferModel = renderDevice.ImportBuffer(vertexResourceModel, RenderHeapType::Upload);
+	const uint32_t kMeshModel = renderQueueExecutor.AddMesh({ vertexBufferModel, 0, vertexBufferViewModel.SizeInBytes, vertexBufferViewModel.StrideInBytes,
+		{}, 0, 0, uint32_t(modelData.vertices.size()) });
+	const RenderBufferHandle vertexBufferSprite = renderDevice.ImportBuffer(vertexResourceSprite, RenderHeapType::Upload);
+	const RenderBufferHandle indexBufferSprite = renderDevice.ImportBuffer(indexResourceSprite, RenderHeapType::Upload);
+	const uint32_t kMeshSprite = renderQueueExecutor.AddMesh({ vertexBufferSprite, 0, vertexBufferViewSprite.SizeInBytes, vertexBufferViewSprite.StrideInBytes,
+		indexBufferSprite, 0, indexBufferViewSprite.SizeInBytes, 6 });
+	const uint32_t kTransformSphere = renderQueueExecutor.AddTransform(renderDevice.ImportBuffer(wvpResource, RenderHeapType::Upload));
+	const uint32_t kTransformModel = renderQueueExecutor.AddTransform(renderDevice.ImportBuffer(wvpResourceModel, RenderHeapType::Upload));
+	const uint32_t kTransformSprite = renderQueueExecutor.AddTransform(renderDevice.ImportBuffer(transformMatrixResourceSprite, RenderHeapType::Upload));
+	// 球などの形状は初めて使うときに1度だけ生成し、以降は登録済みのメッシュを使い回す
+	PrimitiveMeshCache primitiveMeshCache;
+	// 形状と分割数をUIで変えるたびに増えるので、使っていないものから外す
+	primitiveMeshCache.Initialize(&renderDevice, &renderQueueExecutor, 16);
+	primitiveMeshCache.GetMesh(sphereDesc);
+	// シェーダーのホットリロード。hlslやincludeしているファイルが保存されたら作り直したPSOに差し替える
+	ShaderHotReload shaderHotReload;
+	shaderHotReload.Initialize(device, &shaderCache);
+	{
+		uint32_t vertexShaders[kShaderPermutationCount] = {};
+		uint32_t pixelShaders[kShaderPermutationCount] = {};
+		for (uint32_t features = 0; features < kShaderPermutationCount; ++features) {
+			if ((features & kVertexShaderFeatureMask) == features) {
+				vertexShaders[features] = shaderHotReload.AddShader(L"Object3d.VS.hlsl", L"vs_6_0", GetVertexShaderDefines(features), vertexShaderBlobs[features]);
+			}
+			if ((features & kPixelShaderFeatureMask) == features) {
+				pixelShaders[features] = shaderHotReload.AddShader(L"Object3d.PS.hlsl", L"ps_6_0", GetPixelShaderDefines(features), pixelShaderBlobs[features]);
+			}
+		}
+		const uint32_t kInstancingFeatures = SelectShaderFeatures(true, true, true);
+		for (uint32_t features = 0; features < kShaderPermutationCount; ++features) {
+			shaderHotReload.AddPipeline(object3dPipelineStateDescs[features],
+				vertexShaders[features & kVertexShaderFeatureMask], pixelShaders[features & kPixelShaderFeatureMask],
+				[&, features, kInstancingFeatures](ID3D12PipelineState* pipelineState) {
+					object3dPipelineStates[features] = pipelineState;
+					renderDevice.ReplacePipeline(object3dPipelineHandles[features], pipelineState);
+					if (features == kInstancingFeatures) {
+						instancingPipelineState = pipelineState;
+						indirectPipelineStates[0] = pipelineState;
+					}
+				});
+		}
+		const uint32_t spriteVertexShader = shaderHotReload.AddShader(L"Sprite.VS.hlsl", L"vs_6_0", {}, spriteVertexShaderBlob);
+		const uint32_t spritePixelShader = shaderHotReload.AddShader(L"Sprite.PS.hlsl", L"ps_6_0", {}, spritePixelShaderBlob);
+		shaderHotReload.AddPipeline(spritePipelineStateDesc, spriteVertexShader, spritePixelShader,
+			[&](ID3D12PipelineState* pipelineState) { spritePipelineState = pipelineState; });
+	}
+	shaderHotReload.Start();
+	// SpriteBatch。頂点はスワップチェーンのバッファ数分のリングバッファに書き込む
+	const uint32_t kMaxBatchSprite = 20000;
+	SpriteBatch spriteBatch;
+	spriteBatch.Initialize(device, kMaxBatchSprite, swapChainDesc.BufferCount);
+	// SpriteBatchで使うテクスチャ。Sprite::textureIndexはこの配列の番号
+	D3D12_GPU_DESCRIPTOR_HANDLE spriteBatchTextures[] = { textureSrvHandleGPU, textureSrvHandleGPU2 };
+	// スクリーン座標からクリップ空間への変換行列
+	ID3D12Resource* spriteBatchConstantResource = CreateBufferResource(device, sizeof(mat4x4));
+	mat4x4* spriteBatchConstantData = nullptr;
+	spriteBatchConstantResource->Map(0, nullptr, reinterpret_cast<void**>(&spriteBatchConstantData));
+	*spriteBatchConstantData = MakeOrthographicMatrix(0.0f, 0.0f, float(kClientWidth), float(kClientHeight), 0.0f, 1.0f);
+
+	// 作ったリソースを用途ごとにMemoryTrackerで数える。テクスチャとモデルはCPUに残しているデータも含める
+	TrackD3D12Resource(device, materialResource, MemoryCategory::Constant, "material");
+	TrackD3D12Resource(device, wvpResource, MemoryCategory::Constant, "wvp");
+	TrackD3D12Resource(device, directionalLightResource, MemoryCategory::Constant, "directionalLight");
+	TrackD3D12Resource(device, textureResourec, MemoryCategory::Texture, "resources/uvChecker.png", mipImages.GetPixelsSize());
+	TrackD3D12Resource(device, textureResource2, MemoryCategory::Texture, "resources/monsterBall.png", mipImages2.GetPixelsSize());
+	TrackD3D12Resource(device, textureResourceModel, MemoryCategory::Texture, modelData.material.textureFilePath, mipImagesModel.GetPixelsSize());
+	TrackD3D12Resource(device, vertexResourceSprite, MemoryCategory::Mesh, "sprite vertices");
+	TrackD3D12Resource(device, indexResourceSprite, MemoryCategory::Mesh, "sprite indices");
+	TrackD3D12Resource(device, materialResourceSprite, MemoryCategory::Constant, "sprite material");
+	TrackD3D12Resource(device, transformMatrixResourceSprite, MemoryCategory::Constant, "sprite transform");
+	TrackD3D12Resource(device, vertexResourceModel, MemoryCategory::Mesh, "resources/axis.obj",
+		sizeof(VertexData) * modelData.vertices.size());
+	TrackD3D12Resource(device, wvpResourceModel, MemoryCategory::Constant, "model wvp");
+	TrackD3D12Resource(device, instancingResource, MemoryCategory::Constant, "instancing");
+	TrackD3D12Resource(device, instanceMaterialResource, MemoryCategory::Constant, "instance materials");
+	TrackD3D12Resource(device, indirectVertexResource, MemoryCategory::Mesh, "indirect vertices");
+	TrackD3D12Resource(device, indirectIndexResource, MemoryCategory::Mesh, "indirect indices");
+	TrackD3D12Resource(device, indirectInstanceResource, MemoryCategory::Constant, "indirect instances");
+	TrackD3D12Resource(device, indirectArgumentResource, MemoryCategory::Other, "indirect arguments");
+	TrackD3D12Resource(device, spriteBatchConstantResource, MemoryCategory::Constant, "spriteBatch constant");
+	// 確認用に画面中へばらまくスプライト
+	std::vector<Sprite> batchSprites(kMaxBatchSprite);
+	for (uint32_t index = 0; index < kMaxBatchSprite; ++index) {
+		// 簡単な疑似乱数で配置を決める
+		uint32_t random = index * 2654435761u;
+		Sprite& sprite = batchSprites[index];
+		sprite.x = float(random % uint32_t(kClientWidth));
+		sprite.y = float((random >> 12) % uint32_t(kClientHeight));
+		sprite.width = 16.0f;
+		sprite.height = 16.0f;
+		sprite.rotation = float(index) * 0.1f;
+		sprite.uvLeft = 0.0f;
+		sprite.uvTop = 0.0f;
+		sprite.uvRight = 1.0f;
+		sprite.uvBottom = 1.0f;
+		sprite.color = { 1.0f,1.0f,1.0f,0.8f };
+		sprite.textureIndex = index % uint32_t(_countof(spriteBatchTextures));
+		sprite.layer = 0;
+	}
+	int32_t batchSpriteCount = 1000;
+
+	// 描画パス。SortKeyの最上位に入るので小さいものから描画される
+	const uint32_t kPassOpaque = 0;
+	const uint32_t kPassSprite = 1;
+	RenderQueue renderQueue;
+
 	//ビューポート
 	D3D12_VIEWPORT viewport{};
 	//クライアント領域のサイズと一緒にして画面全体を表示
@@ -1180,7 +1432,8 @@ int WINAPI WinMain(_In_ HINSTANCE, _In_opt_ HINSTANCE, _In_ LPSTR, _In_ int) {
 	mat4x4 viewMatrixSprite = MakeIdentity4x4();
 	mat4x4 projectionMatrixSprite = MakeOrthographicMatrix(0.0f, 0.0f, float(kClientWidth), float(kClientHeight), 0.0f, 1000.0f);
 	mat4x4 worldViewProjectionMatrixSprite= Mul(worldMatrixSprite, Mul(viewMatrixSprite, projectionMatrixSprite));
-	*transformationMatrixDataSprite = worldViewProjectionMatrixSprite;
+	transformationMatrixDataSprite->WVP = worldViewProjectionMatrixSprite;
+	transformationMatrixDataSprite->world = worldMatrixSprite;
 	
 	// UVTransform用
 	WorldTransform uvTransformSprite{
@@ -1192,6 +1445,45 @@ int WINAPI WinMain(_In_ HINSTANCE, _In_opt_ HINSTANCE, _In_ LPSTR, _In_ int) {
 	mat4x4 uvMatWorld = MakeAffineMatrix(uvTransformSprite.scale, uvTransformSprite.rotate, uvTransformSprite.translate);
 	materialDataSprite->uvTransform = uvMatWorld;
 	bool useMonsterBall = true;
+	bool useInstancing = false;
+	bool useExecuteIndirect = false;
+	bool drawSphere = false;
+	// drawSphereで描画する形状。PrimitiveMeshCacheから取り出す
+	int32_t primitiveType = int32_t(PrimitiveType::Sphere);
+	int32_t primitiveSubdivision = int32_t(kSubdivision);
+	bool drawSprite = false;
+	bool useSpriteBatch = false;
+	// 負荷確認用に、モデルの描画をRenderQueueへ余分に積む数
+	int32_t stressDrawCount = 0;
+	// 視錐台カリング。境界はワールド座標にして毎フレーム詰め直す
+	bool useFrustumCulling = true;
+	CullingBounds cullingBounds;
+	std::vector<uint32_t> visibleIndices;
+	std::vector<uint8_t> sceneVisible; //!< cullingBoundsの番号ごとに描画するか
+	uint32_t sceneVisibleCount = 0;
+	FrustumCullingBenchmark cullingBenchmark{};
+	bool useSceneBVH = true;
+	bool useOcclusionCulling = false;
+	bool animateIndirect = false;
+	int32_t pickedObject = -1; //!< マウスの下にあるExecuteIndirectのオブジェクト
+	SceneBVHBenchmark sceneBVHBenchmark{};
+	SpriteBatchBenchmark spriteBatchBenchmark{};
+	LoggerBenchmark loggerBenchmark{};
+	UnicodeConversionBenchmark unicodeBenchmark{};
+	HeadlessRenderQueueBenchmark headlessBenchmark{};
+	// GPUの結果と見比べるための、同じシーンをCPUで描いた画像
+	SoftwareRasterizer softwareRasterizer;
+	softwareRasterizer.Initialize(kClientWidth, kClientHeight, &GetJobSystem());
+	const SoftwareTexture softwareTextureUvChecker = MakeSoftwareTexture(mipImages);
+	const SoftwareTexture softwareTextureMonsterBall = MakeSoftwareTexture(mipImages2);
+	const SoftwareTexture softwareTextureModel = MakeSoftwareTexture(mipImagesModel);
+	std::vector<VertexData> softwareSphereVertices;
+	std::vector<uint32_t> softwareSphereIndices;
+	SoftwareRasterizerBenchmark softwareBenchmark{};
+	JobSystemBenchmark jobBenchmark{};
+	ArenaBenchmark arenaBenchmark{};
+	GpuAllocatorBenchmark gpuAllocatorBenchmark{};
+	D3D12ResourceCreationBenchmark resourceCreationBenchmark{};
 
 	//Transform変数を作る
 	WorldTransform transformModel{ {0.5f,0.5f,0.5f},{0.0f,0.0f,0.0f},{0.0f,0.0f,0.0f} };
@@ -1229,26 +1521,28 @@ int WINAPI WinMain(_In_ HINSTANCE, _In_opt_ HINSTANCE, _In_ LPSTR, _In_ int) {
 			ImGui_ImplWin32_NewFrame();
 			ImGui::NewFrame();
 #pragma endregion ImGuiにフレームが始まることを知らせる
+			// 2フレーム前にFrameArenaから取ったメモリをまとめて空にする
+			GetFrameArena().BeginFrame();
+			// 作り直したPSOがあればこのフレームから使う。前のフレームは待ち終えているので古いPSOもここで解放される
+			PROFILE_BEGIN("ShaderHotReload");
+			shaderHotReload.Update(fence->GetCompletedValue(), fenceValue);
+			primitiveMeshCache.Update(fence->GetCompletedValue(), fenceValue);
+			PROFILE_END();
+			// GPUが使い終わったPlacedResourceを解放し、空いたヒープを破棄する
+			gpuMemoryAllocator.Update(fence->GetCompletedValue());
+			// このフレームのコマンドリストを開く。GPUが使い終わったアロケーターだけを使い回す
+			commandList = commandListBackend.GetCommandList(commandRecorder.Begin(fence->GetCompletedValue()));
+			renderGraphExecutor.SetCommandList(commandList);
+			// GPUが終えたフレームの時間を読み、このフレーム全体を測り始める
+			gpuQuerySource.SetCommandList(commandList);
+			gpuProfiler.BeginFrame(fence->GetCompletedValue());
+			gpuProfiler.BeginZone("Frame");
 #pragma region DirectX毎フレームの処理
 			//ゲームの処理
+			PROFILE_BEGIN("Update");
 			//これから書き込むバックバッファのインデックスを取得
 			UINT backBufferIndex = swapChain->GetCurrentBackBufferIndex();
 
-			//TransitionBarrierの設定
-			D3D12_RESOURCE_BARRIER barrier{};
-			//今回のバリアはTransition
-			barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-			//Noneにしておく
-			barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
-			//バリアを張る対象のリソース。現在のバックバッファに対して行う
-			barrier.Transition.pResource = swapChainResource[backBufferIndex];
-			//遷移前(現在)のResourceState
-			barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_PRESENT;
-			//遷移後のResourceSteta
-			barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_RENDER_TARGET;
-			//TransitionBarrierを張る
-			commandList->ResourceBarrier(1, &barrier);
-
 			transform.rotate.y += 0.03f;
 			mat4x4 worldMatrix = MakeAffineMatrix(transform.scale, transform.rotate, transform.translate);
 			wvpData->world = worldMatrix;
@@ -1263,7 +1557,8 @@ int WINAPI WinMain(_In_ HINSTANCE, _In_opt_ HINSTANCE, _In_ LPSTR, _In_ int) {
 			*materialData = material;
 			worldMatrixSprite = MakeAffineMatrix(transforSprite.scale, transforSprite.rotate, transforSprite.translate);
 			worldViewProjectionMatrixSprite = Mul(worldMatrixSprite, Mul(viewMatrixSprite, projectionMatrixSprite));
-			*transformationMatrixDataSprite = worldViewProjectionMatrixSprite;
+			transformationMatrixDataSprite->WVP = worldViewProjectionMatrixSprite;
+			transformationMatrixDataSprite->world = worldMatrixSprite;
 
 			ImGui::Begin("camera");
 			ImGui::DragFloat3("cameraRotate", &cameraTransform.rotate.x, 0.01f);
@@ -1274,9 +1569,271 @@ int WINAPI WinMain(_In_ HINSTANCE, _In_opt_ HINSTANCE, _In_ LPSTR, _In_ int) {
 			projectionMatrix = MakePerspectiveFovMatrix(0.45f, float(kClientWidth) / float(kClientHeight), 0.1f, 100.0f);
 			worldViewProjectionMatrix = Mul(worldMatrix, Mul(viewMatrix, projectionMatrix));
 			wvpData->WVP = worldViewProjectionMatrix;
+			const Frustum frustum = ExtractFrustum(Mul(viewMatrix, projectionMatrix));
 
 			ImGui::Begin("flag");
 			ImGui::Checkbox("useMonsterBall", &useMonsterBall);
+			ImGui::Checkbox("useInstancing", &useInstancing);
+			ImGui::Checkbox("useExecuteIndirect", &useExecuteIndirect);
+			ImGui::Checkbox("drawSphere", &drawSphere);
+			if (drawSphere) {
+				const char* primitiveNames[] = { "Sphere", "Cube", "Plane", "Cylinder", "Torus" };
+				ImGui::Combo("primitive", &primitiveType, primitiveNames, int32_t(PrimitiveType::Count));
+				ImGui::SliderInt("subdivision", &primitiveSubdivision, 3, 256);
+				ImGui::Text("primitiveMeshCache: %u meshes, %u retired, %u evicted",
+					primitiveMeshCache.GetMeshCount(), primitiveMeshCache.GetRetiredCount(), primitiveMeshCache.GetEvictedCount());
+			}
+			ImGui::SliderInt("stressDrawCount", &stressDrawCount, 0, 20000);
+			ImGui::Checkbox("useFrustumCulling", &useFrustumCulling);
+			ImGui::Text("frustumCulling: %u / %u scene objects visible", sceneVisibleCount, cullingBounds.GetCount());
+			if (ImGui::Button("cullingBenchmark")) {
+				// 今のカメラの周りに10万個置いて測る
+				cullingBenchmark = MeasureFrustumCulling(frustum, cameraTransform.translate, 100000, 10, CullingShape::Box);
+			}
+			if (cullingBenchmark.objectCount > 0) {
+				ImGui::Text("%u objects, %u visible: scalar %.3f ms, SIMD %.3f ms",
+					cullingBenchmark.objectCount, cullingBenchmark.visibleCount, cullingBenchmark.scalarMilliseconds, cullingBenchmark.simdMilliseconds);
+			}
+			ImGui::Checkbox("drawSprite", &drawSprite);
+			ImGui::Checkbox("useSpriteBatch", &useSpriteBatch);
+			if (useSpriteBatch) {
+				ImGui::SliderInt("batchSpriteCount", &batchSpriteCount, 0, int32_t(kMaxBatchSprite));
+				ImGui::Text("spriteBatch: %u sprites, %u draws", spriteBatch.GetSpriteCount(), spriteBatch.GetDrawCallCount());
+				if (ImGui::Button("spriteBatchBenchmark")) {
+					spriteBatchBenchmark = MeasureSpriteBatch(kMaxBatchSprite, _countof(spriteBatchTextures), 10);
+				}
+				if (spriteBatchBenchmark.spriteCount > 0) {
+					ImGui::Text("per sprite: %.3f ms, %u draws / batch: %.3f ms, %u draws",
+						spriteBatchBenchmark.perSpriteMilliseconds, spriteBatchBenchmark.perSpriteDrawCallCount,
+						spriteBatchBenchmark.batchMilliseconds, spriteBatchBenchmark.batchDrawCallCount);
+				}
+			}
+			const RenderQueueStats& renderQueueStats = renderQueue.GetStats();
+			ImGui::Text("renderQueue: %u draws, %u state changes, %u elided",
+				renderQueueStats.drawCount, renderQueueStats.stateChangeCount, renderQueueStats.elidedStateChangeCount);
+			if (useExecuteIndirect) {
+				ImGui::Text("indirect: %u draws, %u batches, %u culled, %u overflow",
+					indirectCommandCount, uint32_t(indirectBatches.size()), uint32_t(indirectDrawBuilder.GetCulledCount()),
+					uint32_t(indirectDrawBuilder.GetOverflowCount()));
+				ImGui::Checkbox("useSceneBVH", &useSceneBVH);
+				ImGui::Checkbox("animateIndirect", &animateIndirect);
+				const SceneBVHStats& sceneBVHStats = sceneBVH.GetStats();
+				ImGui::Text("sceneBVH: %u nodes, %u leaves, %u builds, %u refits, cost %.2f (%.2f at build)",
+					sceneBVHStats.nodeCount, sceneBVHStats.leafCount, sceneBVHStats.buildCount, sceneBVHStats.refitCount, sceneBVHStats.cost, sceneBVHStats.buildCost);
+				ImGui::Text("picked: %d", pickedObject);
+				ImGui::Checkbox("useOcclusionCulling", &useOcclusionCulling);
+				if (useOcclusionCulling) {
+					const OcclusionStats& occlusionStats = occlusionBuffer.GetStats();
+					ImGui::Text("occlusion: %u / %u triangles rasterized, %u / %u occluded",
+						occlusionStats.rasterizedTriangleCount, occlusionStats.occluderTriangleCount, occlusionStats.occludedCount, occlusionStats.testedCount);
+				}
+			}
+			if (ImGui::Button("sceneBVHBenchmark")) {
+				sceneBVHBenchmark = MeasureSceneBVH(frustum, cameraTransform.translate, 100000, 10);
+			}
+			if (sceneBVHBenchmark.objectCount > 0) {
+				ImGui::Text("%u objects: build %.2f ms, refit %.2f ms, %u mismatches",
+					sceneBVHBenchmark.objectCount, sceneBVHBenchmark.buildMilliseconds, sceneBVHBenchmark.refitMilliseconds, sceneBVHBenchmark.mismatchCount);
+				ImGui::Text("frustum: BVH %.3f ms, flat %.3f ms (%u visible)",
+					sceneBVHBenchmark.frustumMilliseconds, sceneBVHBenchmark.flatFrustumMilliseconds, sceneBVHBenchmark.visibleCount);
+				ImGui::Text("ray: BVH %.2f us, brute force %.2f us", sceneBVHBenchmark.rayMicroseconds, sceneBVHBenchmark.bruteForceRayMicroseconds);
+			}
+			const CommandRecorderStats& commandRecorderStats = commandRecorder.GetStats();
+			ImGui::Text("commandRecorder: %u lists (%u parallel), %u allocators",
+				commandRecorderStats.commandListCount, commandRecorderStats.parallelListCount, commandRecorderStats.allocatorCount);
+			ImGui::Text("shaderHotReload: %u reloads, %u errors", shaderHotReload.GetReloadCount(), shaderHotReload.GetErrorCount());
+			// 前のフレームで組み立てたRenderGraphの結果
+			const RenderGraphStats& renderGraphStats = renderGraph.GetStats();
+			ImGui::Text("renderGraph: %u passes (%u culled), %u barriers in %u batches",
+				renderGraphStats.passCount, renderGraphStats.culledPassCount, renderGraphStats.barrierCount, renderGraphStats.barrierBatchCount);
+			ImGui::Text("renderGraph transient: %u KB (%u KB without aliasing)",
+				uint32_t(renderGraphStats.transientMemory / 1024), uint32_t(renderGraphStats.unaliasedTransientMemory / 1024));
+			ImGui::Text("logger: %llu written, %llu dropped", GetLogger().GetWrittenCount(), GetLogger().GetDroppedCount());
+			if (ImGui::Button("loggerBenchmark")) {
+				loggerBenchmark = MeasureLogger(8, 100000);
+			}
+			if (loggerBenchmark.threadCount > 0) {
+				ImGui::Text("%u threads: %.1f ns/message, %.1f M messages/s, %llu dropped",
+					loggerBenchmark.threadCount, loggerBenchmark.nanosecondsPerMessage, loggerBenchmark.messagesPerSecond / 1000000.0, loggerBenchmark.droppedCount);
+			}
+			if (ImGui::Button("unicodeBenchmark")) {
+				unicodeBenchmark = MeasureUnicodeConversion(30000);
+			}
+			if (unicodeBenchmark.caseCount > 0) {
+				ImGui::Text("unicode: %.2f us (Win32 %.2f us), %u / %u mismatches",
+					unicodeBenchmark.convertMicroseconds, unicodeBenchmark.win32Microseconds, unicodeBenchmark.mismatchCount, unicodeBenchmark.caseCount);
+			}
+			const RenderDeviceStats renderDeviceStats = renderDevice.GetStats();
+			ImGui::Text("renderDevice: %u buffers (%llu KB), %u descriptors, %u pipelines",
+				renderDeviceStats.bufferCount, renderDeviceStats.bufferBytes / 1024, renderDeviceStats.descriptorCount, renderDeviceStats.pipelineCount);
+			if (ImGui::Button("headlessBenchmark")) {
+				headlessBenchmark = MeasureHeadlessRenderQueue(20000, 20);
+			}
+			if (headlessBenchmark.drawCount > 0) {
+				ImGui::Text("headless: %u draws, %u state changes, sort %.1f us, record %.1f us, %.1f ns/draw",
+					headlessBenchmark.drawCount, headlessBenchmark.stateChangeCount, headlessBenchmark.sortMicroseconds,
+					headlessBenchmark.recordMicroseconds, headlessBenchmark.nanosecondsPerDraw);
+				ImGui::Text("headless: peak %llu KB, %llu validation errors", headlessBenchmark.peakBytes / 1024, headlessBenchmark.validationErrorCount);
+			}
+			if (ImGui::Button("softwareRender")) {
+				// 球とモデルを今のカメラとマテリアルで描き、software.pngに書き出す
+				softwareRasterizer.Clear({ 0.1f, 0.25f, 0.5f, 1.0f }, 1.0f);
+				softwareRasterizer.SetDirectionalLight(directionalLightData->color, directionalLightData->direction, directionalLightData->intensiy);
+				SoftwareDrawDesc desc{};
+				desc.color = materialData->color;
+				desc.uvTransform = materialData->uvTransform;
+				desc.lighting = materialData->enableLighting != 0;
+				if (drawSphere) {
+					const PrimitiveDesc softwareSphereDesc{ PrimitiveType(primitiveType), uint32_t(primitiveSubdivision), 0.25f };
+					softwareSphereVertices.resize(GetPrimitiveVertexCount(softwareSphereDesc));
+					softwareSphereIndices.resize(GetPrimitiveIndexCount(softwareSphereDesc));
+					WritePrimitive(softwareSphereDesc, softwareSphereVertices.data(), softwareSphereIndices.data());
+					desc.vertices = softwareSphereVertices.data();
+					desc.vertexCount = uint32_t(softwareSphereVertices.size());
+					desc.indices = softwareSphereIndices.data();
+					desc.indexCount = uint32_t(softwareSphereIndices.size());
+					desc.wvp = wvpData->WVP;
+					desc.world = wvpData->world;
+					desc.texture = useMonsterBall ? &softwareTextureMonsterBall : &softwareTextureUvChecker;
+					softwareRasterizer.Draw(desc);
+				}
+				desc.vertices = modelData.vertices.data();
+				desc.vertexCount = uint32_t(modelData.vertices.size());
+				desc.indices = nullptr;
+				desc.indexCount = 0;
+				desc.wvp = wvpDataModel->WVP;
+				desc.world = wvpDataModel->world;
+				desc.texture = &softwareTextureModel;
+				softwareRasterizer.Draw(desc);
+				softwareRasterizer.Execute();
+				SaveSoftwareRender(softwareRasterizer, "software.png");
+			}
+			const SoftwareRasterizerStats& softwareStats = softwareRasterizer.GetStats();
+			if (softwareStats.drawCount > 0) {
+				ImGui::Text("software: %u / %u triangles (%u culled, %u clipped), %llu pixels",
+					softwareStats.rasterizedTriangleCount, softwareStats.triangleCount, softwareStats.culledTriangleCount,
+					softwareStats.clippedTriangleCount, softwareStats.shadedPixelCount);
+				ImGui::Text("software: geometry %.2f ms, raster %.2f ms", softwareStats.geometryMilliseconds, softwareStats.rasterMilliseconds);
+			}
+			if (ImGui::Button("softwareBenchmark")) {
+				softwareBenchmark = MeasureSoftwareRasterizer(kClientWidth, kClientHeight, kStartupWorkerCount, 5);
+			}
+			if (softwareBenchmark.threadCount > 0) {
+				ImGui::Text("software: %u triangles, 1 thread %.2f ms, %u threads %.2f ms, %u mismatches",
+					softwareBenchmark.triangleCount, softwareBenchmark.singleThreadMilliseconds, softwareBenchmark.threadCount,
+					softwareBenchmark.multiThreadMilliseconds, softwareBenchmark.mismatchCount);
+			}
+			const JobSystemStats jobStats = GetJobSystem().GetStats();
+			ImGui::Text("jobs: %u workers, %llu executed, %llu stolen, %llu sleeps",
+				jobStats.workerCount, jobStats.executedCount, jobStats.stealCount, jobStats.sleepCount);
+			if (ImGui::Button("jobBenchmark")) {
+				jobBenchmark = MeasureJobSystem(kStartupWorkerCount, 100000);
+			}
+			if (jobBenchmark.workerCount > 0) {
+				ImGui::Text("jobs: run %.1f ns/job, std::thread %.1f ns/thread", jobBenchmark.runNanoseconds, jobBenchmark.threadNanoseconds);
+				for (uint32_t step = 0; step < jobBenchmark.scalingStepCount; ++step) {
+					ImGui::Text("jobs: %u workers %.2f ms (x%.2f)", jobBenchmark.scalingWorkerCounts[step], jobBenchmark.scalingMilliseconds[step],
+						jobBenchmark.scalingMilliseconds[0] / jobBenchmark.scalingMilliseconds[step]);
+				}
+			}
+			const ArenaStats& frameArenaStats = GetFrameArena().GetStats();
+			const ArenaStats scratchStats = GetScratchArena().GetStats();
+			ImGui::Text("arena: frame %llu / %llu KB (peak %llu KB, %llu allocs, %llu overflows)",
+				frameArenaStats.usedBytes / 1024, frameArenaStats.capacity / 1024, frameArenaStats.peakBytes / 1024,
+				frameArenaStats.allocationCount, frameArenaStats.overflowCount);
+			ImGui::Text("arena: main scratch peak %llu / %llu KB, %llu overflows",
+				scratchStats.peakBytes / 1024, scratchStats.capacity / 1024, scratchStats.overflowCount);
+			if (ImGui::Button("arenaBenchmark")) {
+				arenaBenchmark = MeasureArenaAllocators(1000);
+			}
+			if (arenaBenchmark.frameCount > 0) {
+				ImGui::Text("arena: std::allocator %.1f us (max %.1f), frame %.1f us (max %.1f), scratch %.1f us (max %.1f), %llu KB/frame",
+					arenaBenchmark.heapMicroseconds, arenaBenchmark.heapMaxMicroseconds, arenaBenchmark.frameArenaMicroseconds,
+					arenaBenchmark.frameArenaMaxMicroseconds, arenaBenchmark.scratchMicroseconds, arenaBenchmark.scratchMaxMicroseconds,
+					arenaBenchmark.frameArenaBytes / 1024);
+			}
+			ImGui::End();
+
+			// 数フレーム分の平均で、時間の長い区間から並べる
+			const Profiler& profiler = GetProfiler();
+			ImGui::Begin("profiler");
+			ImGui::Text("frame: %.2f ms, %llu zones dropped", profiler.GetFrameMilliseconds(), profiler.GetDroppedCount());
+			if (profiler.IsCapturing()) {
+				ImGui::Text("capturing...");
+			} else if (ImGui::Button("captureTrace")) {
+				// chrome://tracingかPerfettoで開く
+				GetProfiler().CaptureFrames(60, "profile.json");
+			}
+			const std::vector<ProfileZoneStats>& zoneStats = profiler.GetZoneStats();
+			for (size_t index = 0; index < (std::min)(zoneStats.size(), size_t(20)); ++index) {
+				const ProfileZoneStats& zone = zoneStats[index];
+				ImGui::Text("%-20s %7.3f ms (self %7.3f, max %7.3f) x%.1f",
+					zone.name, zone.milliseconds, zone.selfMilliseconds, zone.maxMilliseconds, zone.callCount);
+			}
+			// GPUはRenderGraphのパスごと。数フレーム遅れて届く
+			ImGui::Separator();
+			ImGui::Text("GPU: %llu zones dropped", gpuProfiler.GetDroppedCount());
+			for (const ProfileZoneStats& zone : gpuProfiler.GetZoneStats()) {
+				ImGui::Text("%-20s %7.3f ms (self %7.3f, max %7.3f)", zone.name, zone.milliseconds, zone.selfMilliseconds, zone.maxMilliseconds);
+			}
+			ImGui::End();
+
+			// 用途ごとのメモリと、OSが割り当てたGPUメモリの予算
+			UpdateD3D12MemoryBudget(useAdapter);
+			const MemoryTracker& memoryTracker = GetMemoryTracker();
+			ImGui::Begin("memory");
+			for (uint32_t segment = 0; segment < uint32_t(MemorySegment::Count); ++segment) {
+				const MemoryBudget budget = memoryTracker.GetBudget(MemorySegment(segment));
+				ImGui::Text("%-8s usage %llu / %llu MB (peak %llu), tracked %llu MB (peak %llu)%s",
+					GetMemorySegmentName(MemorySegment(segment)), budget.usage >> 20, budget.budget >> 20, budget.peakUsage >> 20,
+					budget.trackedBytes >> 20, budget.trackedPeakBytes >> 20, memoryTracker.IsNearBudget(MemorySegment(segment)) ? " NEAR BUDGET" : "");
+			}
+			ImGui::Separator();
+			ImGui::Text("%-12s %5s %12s %12s %12s %12s", "category", "count", "gpu KB", "gpu peak", "cpu KB", "cpu peak");
+			for (uint32_t category = 0; category < uint32_t(MemoryCategory::Count); ++category) {
+				const MemoryCategoryStats stats = memoryTracker.GetCategoryStats(MemoryCategory(category));
+				ImGui::Text("%-12s %5u %12llu %12llu %12llu %12llu", GetMemoryCategoryName(MemoryCategory(category)), stats.allocationCount,
+					stats.gpuBytes >> 10, stats.gpuPeakBytes >> 10, stats.cpuBytes >> 10, stats.cpuPeakBytes >> 10);
+			}
+			const MemoryCategoryStats memoryTotal = memoryTracker.GetTotalStats();
+			ImGui::Text("%-12s %5u %12llu %12llu %12llu %12llu", "Total", memoryTotal.allocationCount,
+				memoryTotal.gpuBytes >> 10, memoryTotal.gpuPeakBytes >> 10, memoryTotal.cpuBytes >> 10, memoryTotal.cpuPeakBytes >> 10);
+			if (ImGui::Button("resetPeaks")) {
+				GetMemoryTracker().ResetPeaks();
+			}
+			ImGui::Separator();
+			for (const MemoryAllocationInfo& allocation : memoryTracker.GetLargestAllocations(10)) {
+				ImGui::Text("%-32s %-12s gpu %llu KB, cpu %llu KB", allocation.name.c_str(), GetMemoryCategoryName(allocation.category),
+					allocation.gpuBytes >> 10, allocation.cpuBytes >> 10);
+			}
+			ImGui::End();
+
+			// PlacedResourceを置くヒープの使い方
+			const GpuMemoryAllocator& heapAllocator = gpuMemoryAllocator.GetAllocator();
+			ImGui::Begin("gpuHeap");
+			ImGui::Text("%-5s %5s %6s %10s %10s %10s %6s", "pool", "heaps", "allocs", "reserved", "used KB", "largest", "frag");
+			for (uint32_t pool = 0; pool < heapAllocator.GetPoolCount(); ++pool) {
+				const GpuMemoryStats stats = heapAllocator.GetStats(pool);
+				ImGui::Text("%-5u %5u %6u %10llu %10llu %10llu %6.2f", pool, stats.heapCount, stats.allocationCount,
+					stats.reservedBytes >> 10, stats.usedBytes >> 10, stats.largestFreeBytes >> 10, stats.fragmentation);
+			}
+			if (ImGui::Button("gpuAllocatorBenchmark")) {
+				gpuAllocatorBenchmark = MeasureGpuMemoryAllocator(10000);
+			}
+			if (gpuAllocatorBenchmark.allocationCount > 0) {
+				ImGui::Text("alloc %.1f ns, free %.1f ns, committed %llu MB -> placed %llu MB", gpuAllocatorBenchmark.allocateNanoseconds,
+					gpuAllocatorBenchmark.freeNanoseconds, gpuAllocatorBenchmark.dedicatedBytes >> 20, gpuAllocatorBenchmark.reservedBytes >> 20);
+				ImGui::Text("defragment heaps %u -> %u, frag %.2f -> %.2f, moved %llu MB in %.2f ms", gpuAllocatorBenchmark.heapCountBefore,
+					gpuAllocatorBenchmark.heapCountAfter, gpuAllocatorBenchmark.fragmentationBefore, gpuAllocatorBenchmark.fragmentationAfter,
+					gpuAllocatorBenchmark.movedBytes >> 20, gpuAllocatorBenchmark.defragmentMilliseconds);
+			}
+			if (ImGui::Button("resourceCreationBenchmark")) {
+				resourceCreationBenchmark = MeasureD3D12ResourceCreation(device, 1000);
+			}
+			if (resourceCreationBenchmark.resourceCount > 0) {
+				ImGui::Text("committed %.2f ms %llu KB, placed %.2f ms %llu KB", resourceCreationBenchmark.committedMilliseconds,
+					resourceCreationBenchmark.committedBytes >> 10, resourceCreationBenchmark.placedMilliseconds, resourceCreationBenchmark.placedBytes >> 10);
+			}
 			ImGui::End();
 
 			ImGui::Begin("directionalLight");
@@ -1302,79 +1859,300 @@ int WINAPI WinMain(_In_ HINSTANCE, _In_opt_ HINSTANCE, _In_ LPSTR, _In_ int) {
 			worldViewProjectionMatrixModel = Mul(worldMatrixModel, Mul(viewMatrix, projectionMatrix));
 			wvpDataModel->WVP = worldViewProjectionMatrixModel;
 
-			//描画先のRTVとDSVを設定する
-			D3D12_CPU_DESCRIPTOR_HANDLE dsvHandle = GetCPUDescriptorHandle(dsvDescriptorHeap, descriptorSizeDSV, 0);
-			commandList->OMSetRenderTargets(1, &rtvHandles[backBufferIndex], false, &dsvHandle);
-			// 指定した深度で画面全体をクリアする
-			commandList->ClearDepthStencilView(dsvHandle, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
-			//指定した色で画面全体をクリアする
-			float clearColor[] = { 0.1f,0.25f,0.5f,1.0f };//青っぽい色(背景)
-			commandList->ClearRenderTargetView(rtvHandles[backBufferIndex], clearColor, 0, nullptr);
-
-			// 描画用のDescriptorHeapの設定
-			ID3D12DescriptorHeap* descriptorHeaps[] = { srvDescriptorHeap };
-			commandList->SetDescriptorHeaps(1, descriptorHeaps);
-
-			commandList->RSSetViewports(1, &viewport);//Viewportを設定
-			commandList->RSSetScissorRects(1, &scissorRect);//Scissorを設定
-
-			//RootSignatureを設定。PSOに設定しているけど別途設定が必要
-			commandList->SetGraphicsRootSignature(rootSignature);
-			commandList->SetPipelineState(graphicPipelineState);//PSOを設定
-			commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-			
-			// マテリアルCBufferの場所を設定
-			commandList->SetGraphicsRootConstantBufferView(0, materialResource->GetGPUVirtualAddress());
-			// wvp用のCBufferの場所を設定
-			commandList->SetGraphicsRootConstantBufferView(1, wvpResource->GetGPUVirtualAddress());
-			// DirectionalLight用のCBufferの場所を設定
-			commandList->SetGraphicsRootConstantBufferView(3, directionalLightResource->GetGPUVirtualAddress());
-			// SRVのDescriptorTabkeの先頭を設定。2はrootParam[2]である
-			commandList->SetGraphicsRootDescriptorTable(2, useMonsterBall ? textureSrvHandleGPU2 : textureSrvHandleGPU);
-			commandList->IASetVertexBuffers(0, 1, &vertexBufferView);//VBVを設定
-			//描画!(DrawCall/ドローコール)。3頂点で1つのインスタンス。インスタンスについては今後
-			//commandList->DrawInstanced(kSubdivision * kSubdivision * 6, 1, 0, 0);
-			
-			// モデル用
-			// wvp用のCBufferの場所を設定
-			commandList->SetGraphicsRootConstantBufferView(1, wvpResourceModel->GetGPUVirtualAddress());
-			commandList->IASetVertexBuffers(0, 1, &vertexBufferViewModel);//VBVを設定
-			commandList->SetGraphicsRootDescriptorTable(2,textureSrvHandleGPUModel);
-			//描画!(DrawCall/ドローコール)。3頂点で1つのインスタンス。インスタンスについては今後
-			commandList->DrawInstanced(UINT(modelData.vertices.size()), 1, 0, 0);
-
-			// Spriteの描画。変更が必要なものだけに変更する
-			commandList->SetGraphicsRootDescriptorTable(2, textureSrvHandleGPU);
-			commandList->IASetVertexBuffers(0, 1, &vertexBufferViewSprite);
-			commandList->IASetIndexBuffer(&indexBufferViewSprite);
-			//マテリアルCBufferの場所を設定
-			commandList->SetGraphicsRootConstantBufferView(0, materialResourceSprite->GetGPUVirtualAddress());
-			// TransformmationMatrixBufferの場所を設定
-			commandList->SetGraphicsRootConstantBufferView(1, transformMatrixResourceSprite->GetGPUVirtualAddress());
-			//描画!(DrawCall/ドローコール)。3頂点で1つのインスタンス。インスタンスについては今後
-			//commandList->DrawIndexedInstanced(6, 1, 0, 0, 0);
+			if (useInstancing) {
+				// 全インスタンスの行列をまとめて計算してStructuredBufferに書き込む
+				for (WorldTransform& instanceTransform : instanceTransforms) {
+					instanceTransform.rotate.y += 0.01f;
+				}
+				UpdateInstanceData(instanceTransforms.data(), instanceMaterialIndices.data(), kNumInstance, Mul(viewMatrix, projectionMatrix), instancingData);
+			}
+			if (useInstancing || useExecuteIndirect) {
+				for (uint32_t index = 0; index < kNumInstanceMaterial; ++index) {
+					Material& instanceMaterial = instanceMaterialData[index];
+					instanceMaterial = *materialData;
+					instanceMaterial.color.x *= kInstanceMaterialColors[index].x;
+					instanceMaterial.color.y *= kInstanceMaterialColors[index].y;
+					instanceMaterial.color.z *= kInstanceMaterialColors[index].z;
+					instanceMaterial.color.w *= kInstanceMaterialColors[index].w;
+				}
+			}
+
+			if (useSpriteBatch) {
+				// このフレームの頂点領域に積む
+				spriteBatch.Begin(backBufferIndex);
+				for (int32_t index = 0; index < batchSpriteCount; ++index) {
+					batchSprites[index].rotation += 0.02f;
+					spriteBatch.Draw(batchSprites[index]);
+				}
+			}
+
+			if (useExecuteIndirect) {
+				PROFILE_SCOPE("UpdateIndirect");
+				mat4x4 viewProjectionMatrix = Mul(viewMatrix, projectionMatrix);
+				if (animateIndirect) {
+					for (WorldTransform& indirectTransform : indirectTransforms) {
+						indirectTransform.rotate.y += 0.01f;
+					}
+				}
+				UpdateInstanceData(indirectTransforms.data(), indirectMaterialIndices.data(), kNumIndirectObject, viewProjectionMatrix, indirectInstanceData);
+				// メッシュの境界をワールド座標のAABBにして、視錐台の外にあるものをまとめて外す
+				// 動いたものはBVHの境界だけを更新し、品質が落ちたらBVHを作り直す
+				cullingBounds.Clear();
+				for (uint32_t index = 0; index < kNumIndirectObject; ++index) {
+					const AABB bounds = getIndirectBounds(index);
+					cullingBounds.Add(bounds);
+					sceneBVH.UpdateObject(index, bounds);
+				}
+				sceneBVH.Update();
+				if (useSceneBVH) {
+					sceneBVH.QueryFrustum(frustum, visibleIndices);
+					std::sort(visibleIndices.begin(), visibleIndices.end());
+				} else {
+					FrustumCull(frustum, cullingBounds, CullingShape::Box, visibleIndices);
+				}
+				if (useOcclusionCulling) {
+					// モデルと手前の列を遮蔽物として描く
+					occlusionBuffer.Begin(viewProjectionMatrix);
+					if (!useInstancing) {
+						occlusionBuffer.DrawOccluder(modelData.vertices.data(), uint32_t(modelData.vertices.size()), nullptr, 0, worldMatrixModel);
+					}
+					for (uint32_t index = 0; index < kNumOccluderObject; ++index) {
+						const WorldTransform& occluderTransform = indirectTransforms[index];
+						const mat4x4 occluderWorld = MakeAffineMatrix(occluderTransform.scale, occluderTransform.rotate, occluderTransform.translate);
+						if (index % 2 == 0) {
+							occlusionBuffer.DrawOccluder(occluderSphereVertices.data(), uint32_t(occluderSphereVertices.size()),
+								occluderSphereIndices.data(), uint32_t(occluderSphereIndices.size()), occluderWorld);
+						} else {
+							occlusionBuffer.DrawOccluder(modelData.vertices.data(), uint32_t(modelData.vertices.size()), nullptr, 0, occluderWorld);
+						}
+					}
+					occlusionBuffer.BuildHierarchy();
+				}
+				uint32_t visibleCursor = 0;
+				indirectDrawBuilder.Clear();
+				for (uint32_t index = 0; index < kNumIndirectObject; ++index) {
+					// クリップ空間のwがカメラからの距離
+					const Vector3& center = indirectTransforms[index].translate;
+					float w = center.x * viewProjectionMatrix.m[0][3] + center.y * viewProjectionMatrix.m[1][3] +
+						center.z * viewProjectionMatrix.m[2][3] + viewProjectionMatrix.m[3][3];
+					// visibleIndicesは小さい順なので先頭から順に突き合わせる
+					bool inFrustum = visibleCursor < visibleIndices.size() && visibleIndices[visibleCursor] == index;
+					if (inFrustum) {
+						++visibleCursor;
+					}
+					IndirectDrawObject object{};
+					object.pipeline = 0;
+					object.mesh = (index % 2 == 0) ? kIndirectMeshSphere : kIndirectMeshModel;
+					object.objectIndex = index;
+					object.depth = w;
+					// カリングしないときもカメラの後ろにあるものは外す
+					object.visible = useFrustumCulling ? inFrustum : w > 0.0f;
+					// 遮蔽物自身は調べない
+					if (object.visible && useOcclusionCulling && index >= kNumOccluderObject) {
+						object.visible = occlusionBuffer.TestAABB(sceneBVH.GetObjectBounds(index));
+					}
+					indirectDrawBuilder.Add(object);
+				}
+				indirectCommandCount = indirectDrawBuilder.Build(indirectArgumentData, kNumIndirectObject, indirectBatches);
+				if (indirectDrawBuilder.GetOverflowCount() > 0) {
+					LOG_WARNING(LogCategory::Graphics, "indirect argument buffer overflow: {} objects dropped", indirectDrawBuilder.GetOverflowCount());
+				}
+
+				// マウスの下のオブジェクトを探す。近クリップ面から遠クリップ面までの線分をBVHに飛ばす
+				pickedObject = -1;
+				if (!ImGui::GetIO().WantCaptureMouse && ImGui::IsMousePosValid()) {
+					const ImVec2 mousePosition = ImGui::GetIO().MousePos;
+					const float ndcX = mousePosition.x / float(kClientWidth) * 2.0f - 1.0f;
+					const float ndcY = 1.0f - mousePosition.y / float(kClientHeight) * 2.0f;
+					const mat4x4 inverseViewProjection = Inverse(viewProjectionMatrix);
+					const Vector3 nearPoint = Transform({ ndcX, ndcY, 0.0f }, inverseViewProjection);
+					const Vector3 farPoint = Transform({ ndcX, ndcY, 1.0f }, inverseViewProjection);
+					RayHit hit{};
+					if (sceneBVH.RayCast({ nearPoint, farPoint - nearPoint }, 1.0f, hit)) {
+						pickedObject = int32_t(hit.object);
+					}
+				}
+			}
+
+			// RenderQueueに積む描画も、視錐台の外にあるものは積まない
+			const PrimitiveDesc primitiveDesc{ PrimitiveType(primitiveType), uint32_t(primitiveSubdivision), 0.25f };
+			cullingBounds.Clear();
+			const uint32_t kBoundsSphere = cullingBounds.Add(TransformAABB(GetPrimitiveBounds(primitiveDesc).aabb, worldMatrix));
+			const uint32_t kBoundsModel = cullingBounds.Add(TransformAABB(modelData.bounds.aabb, worldMatrixModel));
+			sceneVisible.assign(cullingBounds.GetCount(), uint8_t(useFrustumCulling ? 0 : 1));
+			sceneVisibleCount = cullingBounds.GetCount();
+			if (useFrustumCulling) {
+				sceneVisibleCount = FrustumCull(frustum, cullingBounds, CullingShape::Box, visibleIndices);
+				for (uint32_t index : visibleIndices) {
+					sceneVisible[index] = 1;
+				}
+			}
+			PROFILE_END();
+
+			// このフレームのパスを組み立てる。バックバッファはPresentの状態で受け取り、Presentの状態に戻す
+			renderGraph.Reset();
+			const uint32_t backBuffer = renderGraph.ImportTexture("BackBuffer", kRenderGraphStateCommon, kRenderGraphStateCommon);
+			const uint32_t depthBuffer = renderGraph.CreateTexture("DepthBuffer", depthBufferDesc);
+
+			const uint32_t scenePass = renderGraph.AddPass("Scene", [&]() {
+				PROFILE_SCOPE("ScenePass");
+				D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle = renderGraphExecutor.GetRenderTargetView(backBuffer);
+				D3D12_CPU_DESCRIPTOR_HANDLE dsvHandle = renderGraphExecutor.GetDepthStencilView(depthBuffer);
+				// 描画に共通の設定。コマンドリストをまたいで引き継がれないので、新しく開いたリストごとに設定する
+				auto setupCommandList = [&](ID3D12GraphicsCommandList* list) {
+					//描画先のRTVとDSVを設定する
+					list->OMSetRenderTargets(1, &rtvHandle, false, &dsvHandle);
+					// 描画用のDescriptorHeapの設定
+					ID3D12DescriptorHeap* descriptorHeaps[] = { srvDescriptorHeap };
+					list->SetDescriptorHeaps(1, descriptorHeaps);
+
+					list->RSSetViewports(1, &viewport);//Viewportを設定
+					list->RSSetScissorRects(1, &scissorRect);//Scissorを設定
+
+					//RootSignatureを設定。PSOに設定しているけど別途設定が必要
+					list->SetGraphicsRootSignature(rootSignature);
+					list->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+					// DirectionalLight用のCBufferの場所を設定。全描画で共通
+					list->SetGraphicsRootConstantBufferView(3, directionalLightResource->GetGPUVirtualAddress());
+				};
+				setupCommandList(commandList);
+				// 指定した深度で画面全体をクリアする。深度バッファは他の一時テクスチャとメモリを共有するので必ずクリアする
+				commandList->ClearDepthStencilView(dsvHandle, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
+				//指定した色で画面全体をクリアする
+				float clearColor[] = { 0.1f,0.25f,0.5f,1.0f };//青っぽい色(背景)
+				commandList->ClearRenderTargetView(rtvHandle, clearColor, 0, nullptr);
+
+				if (useInstancing) {
+					// インスタンシング用のPSOに切り替えて、1回のDrawCallで全インスタンスを描画
+					commandList->SetPipelineState(instancingPipelineState);
+					commandList->SetGraphicsRootConstantBufferView(0, materialResource->GetGPUVirtualAddress());
+					commandList->SetGraphicsRootShaderResourceView(4, instancingResource->GetGPUVirtualAddress());
+					commandList->SetGraphicsRootShaderResourceView(6, instanceMaterialResource->GetGPUVirtualAddress());
+					commandList->SetGraphicsRoot32BitConstant(5, 0, 0);
+					commandList->SetGraphicsRootDescriptorTable(2, textureSrvHandleGPUModel);
+					commandList->IASetVertexBuffers(0, 1, &vertexBufferViewModel);
+					commandList->DrawInstanced(UINT(modelData.vertices.size()), kNumInstance, 0, 0);
+				}
+
+				if (useExecuteIndirect) {
+					// CPUで作った引数バッファをPSOごとに1回のExecuteIndirectで描画する
+					commandList->SetGraphicsRootConstantBufferView(0, materialResource->GetGPUVirtualAddress());
+					commandList->SetGraphicsRootShaderResourceView(4, indirectInstanceResource->GetGPUVirtualAddress());
+					commandList->SetGraphicsRootShaderResourceView(6, instanceMaterialResource->GetGPUVirtualAddress());
+					commandList->SetGraphicsRootDescriptorTable(2, textureSrvHandleGPU);
+					commandList->IASetVertexBuffers(0, 1, &indirectVertexBufferView);
+					commandList->IASetIndexBuffer(&indirectIndexBufferView);
+					for (const IndirectBatch& batch : indirectBatches) {
+						commandList->SetPipelineState(indirectPipelineStates[batch.pipeline]);
+						commandList->ExecuteIndirect(
+							commandSignature,
+							batch.commandCount,
+							indirectArgumentResource,
+							sizeof(IndirectCommand) * batch.commandOffset,
+							nullptr,
+							0);
+					}
+				}
+
+				// 通常の描画はRenderQueueに積み、ソートキー順に変更が必要な状態だけ設定して描画する
+				renderQueue.Clear();
+				if (drawSphere && sceneVisible[kBoundsSphere]) {
+					DrawItem item{};
+					item.pipeline = object3dPipelines[SelectShaderFeatures(materialData->enableLighting != 0, true, false)];
+					item.material = kMaterialObject;
+					item.texture = useMonsterBall ? kTextureMonsterBall : kTextureUvChecker;
+					item.mesh = primitiveMeshCache.GetMesh(primitiveDesc);
+					item.transform = kTransformSphere;
+					item.instanceCount = 1;
+					// マテリアルとテクスチャを合わせてキーのmaterial欄に入れる
+					item.sortKey = SortKey::Make(kPassOpaque, item.pipeline, (item.material << 8) | item.texture, Transform(transform.translate, viewMatrix).z);
+					renderQueue.Push(item);
+				}
+				if (!useInstancing && sceneVisible[kBoundsModel]) {
+					DrawItem item{};
+					item.pipeline = object3dPipelines[SelectShaderFeatures(materialData->enableLighting != 0, true, false)];
+					item.material = kMaterialObject;
+					item.texture = kTextureModel;
+					item.mesh = kMeshModel;
+					item.transform = kTransformModel;
+					item.instanceCount = 1;
+					item.sortKey = SortKey::Make(kPassOpaque, item.pipeline, (item.material << 8) | item.texture, Transform(transformModel.translate, viewMatrix).z);
+					renderQueue.Push(item);
+					for (int32_t index = 0; index < stressDrawCount; ++index) {
+						renderQueue.Push(item);
+					}
+				}
+				if (drawSprite) {
+					DrawItem item{};
+					item.pipeline = object3dPipelines[SelectShaderFeatures(materialDataSprite->enableLighting != 0, true, false)];
+					item.material = kMaterialSprite;
+					item.texture = kTextureUvChecker;
+					item.mesh = kMeshSprite;
+					item.transform = kTransformSprite;
+					item.instanceCount = 1;
+					item.sortKey = SortKey::Make(kPassSprite, item.pipeline, (item.material << 8) | item.texture, transforSprite.translate.z);
+					renderQueue.Push(item);
+				}
+				// 並べ替えた描画を連続した範囲に分け、スレッドごとのコマンドリストに積む
+				renderQueue.Sort();
+				commandRecorder.RecordParallel(renderQueue.GetItemCount(),
+					[&](uint32_t list) { setupCommandList(commandListBackend.GetCommandList(list)); },
+					[&](uint32_t list, uint32_t begin, uint32_t end) {
+						PROFILE_SCOPE("RecordRenderQueue");
+						// 登録した状態をコピーして、積む先のリストだけを変える
+						D3D12RenderCommandList renderCommandList(commandListBackend.GetCommandList(list), renderDevice);
+						DeviceRenderQueueExecutor executor = renderQueueExecutor;
+						executor.SetCommandList(&renderCommandList);
+						renderQueue.ExecuteRange(executor, begin, end);
+					});
+				// 続きは並列に積んだリストの後ろのリストに積む
+				commandList = commandListBackend.GetCommandList(commandRecorder.GetCurrentList());
+				renderGraphExecutor.SetCommandList(commandList);
+
+				if (useSpriteBatch) {
+					// SpriteBatchはテクスチャごとにまとめて描画する
+					commandList->SetPipelineState(spritePipelineState);
+					commandList->SetGraphicsRootConstantBufferView(1, spriteBatchConstantResource->GetGPUVirtualAddress());
+					spriteBatch.End(commandList, spriteBatchTextures, _countof(spriteBatchTextures), 2);
+				}
+			});
+			renderGraph.Write(scenePass, backBuffer, kRenderGraphStateRenderTarget);
+			renderGraph.Write(scenePass, depthBuffer, kRenderGraphStateDepthWrite);
 
 			// ImGuiの内部コマンドを生成する
+			PROFILE_BEGIN("ImGuiRender");
 			ImGui::Render();
-			// 実際のcommandListのImGuiの描画コマンドを積む
-			ImGui_ImplDX12_RenderDrawData(ImGui::GetDrawData(), commandList);
-
-			//画面に描く処理は全て終わり、画面に映すので、状態を遷移
-			//今回はRebderTargetからPresentにする
-			barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_RENDER_TARGET;
-			barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_PRESENT;
-
-			//TransitionBarrierを張る
-			commandList->ResourceBarrier(1, &barrier);
-
-			//コマンドリストの内容を確定させる。全てのコマンドを積んでからCloseすること
-			hr = commandList->Close();
-			assert(SUCCEEDED(hr));
-			//GPUにコマンドリストの実行を行わせる
-			ID3D12CommandList* commandLists[] = { commandList };
-			commandQueue->ExecuteCommandLists(1, commandLists);
+			PROFILE_END();
+			const uint32_t imguiPass = renderGraph.AddPass("ImGui", [&]() {
+				// 実際のcommandListのImGuiの描画コマンドを積む
+				D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle = renderGraphExecutor.GetRenderTargetView(backBuffer);
+				commandList->OMSetRenderTargets(1, &rtvHandle, false, nullptr);
+				ImGui_ImplDX12_RenderDrawData(ImGui::GetDrawData(), commandList);
+			});
+			renderGraph.Write(imguiPass, backBuffer, kRenderGraphStateRenderTarget);
+
+			// 実行順とバリア、一時テクスチャの配置を決めてから、パスを順に積む
+			// 画面に描く処理が全て終わったら、バックバッファはPresentの状態に戻る
+			PROFILE_BEGIN("RenderGraph");
+			renderGraph.Compile([&](const RenderGraphTextureDesc& desc, uint32_t usage) { return renderGraphExecutor.GetAllocationInfo(desc, usage); });
+			renderGraphExecutor.SetImportedTexture(backBuffer, swapChainResource[backBufferIndex], rtvHandles[backBufferIndex]);
+			renderGraphExecutor.Prepare(renderGraph, fence->GetCompletedValue(), fenceValue);
+			renderGraph.Execute(renderGraphExecutor);
+			PROFILE_END();
+
+			//コマンドリストの内容を確定させ、積んだ順に1回でGPUに実行させる
+			//使ったアロケーターは次にSignalする値までGPUが進んだら使い回す
+			// フレーム全体の区間を閉じ、このフレームの時刻を読み戻すコマンドを最後のリストに積む
+			gpuQuerySource.SetCommandList(commandList);
+			gpuProfiler.EndZone();
+			gpuProfiler.EndFrame(fenceValue + 1);
+			PROFILE_BEGIN("Submit");
+			commandRecorder.Submit(fenceValue + 1);
+			PROFILE_END();
 			//GPUとOSに画面の交換を行うよう通知する
+			PROFILE_BEGIN("Present");
 			swapChain->Present(1, 0);
+			PROFILE_END();
 
 			//Fenceの値を更新
 			fenceValue++;
@@ -1387,13 +2165,11 @@ int WINAPI WinMain(_In_ HINSTANCE, _In_opt_ HINSTANCE, _In_ LPSTR, _In_ int) {
 				//指定したSignalにたどり着いていないので、たどり着くまで待つようにイベントを指定する
 				fence->SetEventOnCompletion(fenceValue, fenceEvent);
 				//イベント待つ
+				PROFILE_SCOPE("WaitForGPU");
 				WaitForSingleObject(fenceEvent, INFINITE);
 			}
-			//次のフレーム用のコマンドリストを準備
-			hr = commandAllocator->Reset();
-			assert(SUCCEEDED(hr));
-			hr = commandList->Reset(commandAllocator, nullptr);
-			assert(SUCCEEDED(hr));
+			// このフレームの区間を全スレッドから集める
+			GetProfiler().EndFrame();
 		}
 #pragma endregion DirectX毎フレームの処理
 	}
@@ -1401,35 +2177,60 @@ int WINAPI WinMain(_In_ HINSTANCE, _In_opt_ HINSTANCE, _In_ LPSTR, _In_ int) {
 	ImGui_ImplDX12_Shutdown();
 	ImGui_ImplWin32_Shutdown();
 	ImGui::DestroyContext();
+	spriteBatchConstantResource->Release();
+	spriteBatch.Finalize();
+	indirectArgumentResource->Release();
+	indirectInstanceResource->Release();
+	indirectIndexResource->Release();
+	indirectVertexResource->Release();
+	commandSignature->Release();
+	instancingResource->Release();
+	instanceMaterialResource->Release();
 	textureResourceModel->Release();
 	transformMatrixResourceSprite->Release();
 	materialResourceSprite->Release();
 	indexResourceSprite->Release();
 	vertexResourceModel->Release();
 	vertexResourceSprite->Release();
-	depthStencilResource->Release();
+	renderGraphExecutor.Finalize();
+	gpuQuerySource.Finalize();
 	textureResource2->Release();
 	textureResourec->Release();
 	wvpResource->Release();
 	materialResource->Release();
-	vertexResource->Release();
-	graphicPipelineState->Release();
+	primitiveMeshCache.Finalize();
+	renderDevice.Finalize();
+	gpuMemoryAllocator.Finalize();
+	//起動時のPSOはPipelineStateCacheが、作り直したPSOはShaderHotReloadが持っている
+	shaderHotReload.Finalize();
+	pipelineStateCache.Finalize();
 	if (errorBlob) {
 		errorBlob->Release();
 	}
 	rootSignature->Release();
-	pixelShaderBlob->Release();
-	vertexShaderBlob->Release();
+	spritePixelShaderBlob->Release();
+	spriteVertexShaderBlob->Release();
+	for (uint32_t features = 0; features < kShaderPermutationCount; ++features) {
+		if (vertexShaderBlobs[features]) {
+			vertexShaderBlobs[features]->Release();
+		}
+		if (pixelShaderBlobs[features]) {
+			pixelShaderBlobs[features]->Release();
+		}
+	}
+	for (uint32_t worker = 0; worker < kStartupWorkerCount; ++worker) {
+		includeHandlers[worker]->Release();
+		dxcCompilers[worker]->Release();
+		dxcUtils[worker]->Release();
+	}
 	CloseHandle(fenceEvent);
 	fence->Release();
-	dsvDescriptorHeap->Release();
 	rtvDescriptorHeap->Release();
 	srvDescriptorHeap->Release();
 	swapChainResource[0]->Release();
 	swapChainResource[1]->Release();
 	swapChain->Release();
-	commandList->Release();
-	commandAllocator->Release();
+	commandListBackend.Finalize();
 	commandQueue->Release();
 	device->Release();
 	useAdapter->Release();
@@ -1449,6 +2250,9 @@ int WINAPI WinMain(_In_ HINSTANCE, _In_opt_ HINSTANCE, _In_ LPSTR, _In_ int) {
 	}
 
 	EnableShaderBasedValidation();
+	GetJobSystem().Stop();
+	//残ったログを書き出してからスレッドを止める
+	GetLogger().Stop();
 #pragma endregion 解放処理
 	return 0;
 }
\ No newline at end of file
@@ -0,0 +1,199 @@
+#include <cstring>
+#include <string>
+#include "ArenaAllocator.h"
+#include "TestUtil.h"
+
+namespace {
+	bool IsFilled(const void* pointer, size_t size, uint8_t value) {
+		const uint8_t* bytes = static_cast<const uint8_t*>(pointer);
+		for (size_t index = 0; index < size; ++index) {
+			if (bytes[index] != value) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void TestLinearArenaBlocks() {
+		LinearArena arena(1024);
+		void* first = arena.Allocate(600, 16);
+		std::memset(first, 1, 600);
+		const LinearArena::Marker marker = arena.GetMarker();
+		// 残りに入らないので次のブロックに移る
+		void* second = arena.Allocate(600, 16);
+		std::memset(second, 2, 600);
+		TEST_CHECK(arena.GetStats().capacity == 2048);
+		TEST_CHECK(arena.GetStats().overflowCount == 1);
+		// ブロックより大きいものは、それが入るブロックを作る
+		void* large = arena.Allocate(4000, 64);
+		TEST_CHECK(reinterpret_cast<uintptr_t>(large) % 64 == 0);
+		TEST_CHECK(arena.GetStats().capacity == 2048 + 4000 + 63);
+		TEST_CHECK(arena.GetStats().usedBytes >= 600 + 600 + 4000);
+
+		// ブロックをまたいで戻す。前に確保したものは残り、次の確保は足したブロックを使い回す
+		arena.Rewind(marker);
+		TEST_CHECK(arena.GetStats().usedBytes == 600);
+		TEST_CHECK(IsFilled(first, 600, 1));
+		void* again = arena.Allocate(600, 16);
+		TEST_CHECK(again == second);
+		arena.Allocate(4000, 64);
+		TEST_CHECK(arena.GetStats().capacity == 2048 + 4000 + 63);
+		TEST_CHECK(arena.GetStats().peakBytes >= 600 + 600 + 4000);
+
+		arena.Reset();
+		TEST_CHECK(arena.GetStats().usedBytes == 0 && arena.GetStats().allocationCount == 0);
+		TEST_CHECK(arena.Allocate(8, 8) == first);
+	}
+
+	void TestNestedScratchScope() {
+		LinearArena& arena = GetScratchArena();
+		const uint64_t usedBefore = arena.GetStats().usedBytes;
+		{
+			ScratchScope outer;
+			ScratchVector<uint32_t> outerValues;
+			for (uint32_t index = 0; index < 100; ++index) {
+				outerValues.push_back(index);
+			}
+			const uint64_t usedOuter = arena.GetStats().usedBytes;
+			{
+				ScratchScope inner;
+				ScratchString text;
+				for (uint32_t index = 0; index < 200; ++index) {
+					text += "inner";
+				}
+				TEST_CHECK(text.size() == 1000);
+				TEST_CHECK(arena.GetStats().usedBytes > usedOuter);
+			}
+			// 内側の分だけ戻り、外側のものは残る
+			TEST_CHECK(arena.GetStats().usedBytes == usedOuter);
+			bool intact = outerValues.size() == 100;
+			for (uint32_t index = 0; index < outerValues.size(); ++index) {
+				intact &= outerValues[index] == index;
+			}
+			TEST_CHECK(intact);
+		}
+		TEST_CHECK(arena.GetStats().usedBytes == usedBefore);
+	}
+
+	void TestDeallocateBelowScope() {
+		// Scopeの外で確保したものをScopeの中で解放しても、Scopeが戻る位置より前へは戻さない
+		LinearArena& arena = GetScratchArena();
+		const LinearArena::Marker start = arena.GetMarker();
+		void* outside = arena.Allocate(64, 8);
+		{
+			ScratchScope scope;
+			const uint64_t usedAtScope = arena.GetStats().usedBytes;
+			arena.Deallocate(outside, 64);
+			TEST_CHECK(arena.GetStats().usedBytes == usedAtScope);
+			void* inside = arena.Allocate(16, 8);
+			TEST_CHECK(static_cast<uint8_t*>(inside) >= static_cast<uint8_t*>(outside) + 64);
+			// Scopeの中で確保したものは戻せる
+			arena.Deallocate(inside, 16);
+			TEST_CHECK(arena.GetStats().usedBytes == usedAtScope);
+		}
+		// Scopeの外ではまた戻せる
+		arena.Deallocate(outside, 64);
+		TEST_CHECK(arena.GetMarker().offset == start.offset && arena.GetMarker().block == start.block);
+
+		// 外のScratchVectorをScopeの中で捨てる
+		ScratchScope outer;
+		ScratchVector<uint32_t> values(32, 7);
+		{
+			ScratchScope scope;
+			ScratchVector<uint32_t>().swap(values);
+			ScratchVector<uint32_t> inner(8, 3);
+			TEST_CHECK(inner.size() == 8 && inner[7] == 3);
+		}
+		TEST_CHECK(values.empty());
+	}
+
+	void TestFrameArenaLifetime() {
+		FrameArena arena;
+		arena.Initialize(1024);
+		arena.BeginFrame();
+		// フレームNで確保したものは、フレームN+1の間も使える
+		void* frameN = arena.Allocate(256, 16);
+		std::memset(frameN, 0xA5, 256);
+		arena.BeginFrame();
+		void* frameN1 = arena.Allocate(256, 16);
+		std::memset(frameN1, 0x5A, 256);
+		TEST_CHECK(frameN1 != frameN);
+		TEST_CHECK(IsFilled(frameN, 256, 0xA5));
+		TEST_CHECK(arena.GetStats().usedBytes == 256 + 15);
+		TEST_CHECK(arena.GetStats().allocationCount == 1);
+		// N+2ではNの側を空にして使い直す。N+1のものはまだ残る
+		arena.BeginFrame();
+		TEST_CHECK(arena.Allocate(256, 16) == frameN);
+		TEST_CHECK(IsFilled(frameN1, 256, 0x5A));
+	}
+
+	void TestFrameArenaOverflow() {
+		FrameArena arena;
+		arena.Initialize(256);
+		arena.BeginFrame();
+		void* small = arena.Allocate(128, 8);
+		// 容量を超えた分は別に確保する。同じフレームの中では前に確保したものも使える
+		void* large = arena.Allocate(1000, 8);
+		std::memset(small, 1, 128);
+		std::memset(large, 2, 1000);
+		TEST_CHECK(IsFilled(small, 128, 1) && IsFilled(large, 1000, 2));
+		arena.BeginFrame();
+		ArenaStats stats = arena.GetStats();
+		TEST_CHECK(stats.overflowCount == 1);
+		TEST_CHECK(stats.usedBytes >= 128 + 1000);
+		TEST_CHECK(IsFilled(large, 1000, 2));
+		// 溢れた側を次に使うときは、使った分が入る大きさになっている
+		arena.BeginFrame();
+		arena.Allocate(128, 8);
+		arena.Allocate(1000, 8);
+		arena.BeginFrame();
+		stats = arena.GetStats();
+		TEST_CHECK(stats.overflowCount == 0);
+		TEST_CHECK(stats.capacity >= 128 + 1000);
+		TEST_CHECK(stats.peakBytes >= 128 + 1000);
+	}
+
+	void TestVectorReallocation() {
+		// 伸びるたびに古い配列を解放するので、最後の配列の分を大きく超えて使わない
+		LinearArena arena(64 * 1024);
+		{
+			std::vector<uint32_t, ArenaAllocator<uint32_t, LinearArena>> values{ ArenaAllocator<uint32_t, LinearArena>(arena) };
+			for (uint32_t index = 0; index < 5000; ++index) {
+				values.push_back(index * 3);
+			}
+			bool correct = values.size() == 5000;
+			for (uint32_t index = 0; index < values.size(); ++index) {
+				correct &= values[index] == index * 3;
+			}
+			TEST_CHECK(correct);
+			TEST_CHECK(arena.GetStats().usedBytes <= values.capacity() * sizeof(uint32_t) * 2);
+		}
+		arena.Reset();
+
+		FrameArena frameArena;
+		frameArena.Initialize(64 * 1024);
+		frameArena.BeginFrame();
+		std::vector<uint64_t, ArenaAllocator<uint64_t, FrameArena>> frameValues{ ArenaAllocator<uint64_t, FrameArena>(frameArena) };
+		for (uint64_t index = 0; index < 1000; ++index) {
+			frameValues.push_back(index * index);
+		}
+		TEST_CHECK(frameValues.size() == 1000 && frameValues[999] == 999 * 999);
+	}
+
+	void TestBenchmark() {
+		const ArenaBenchmark result = MeasureArenaAllocators(4);
+		TEST_CHECK(result.frameCount == 4);
+		TEST_CHECK(result.frameArenaBytes > 0);
+	}
+}
+
+int main() {
+	TestLinearArenaBlocks();
+	TestNestedScratchScope();
+	TestDeallocateBelowScope();
+	TestFrameArenaLifetime();
+	TestFrameArenaOverflow();
+	TestVectorReallocation();
+	TestBenchmark();
+	return FinishTests("ArenaAllocatorTest");
+}
\ No newline at end of file
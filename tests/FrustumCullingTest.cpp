@@ -0,0 +1,69 @@
+#include <random>
+#include <vector>
+#include "FrustumCulling.h"
+#include "TestUtil.h"
+
+namespace {
+	// -1〜1の立方体を内側から囲む視錐台
+	Frustum MakeUnitBoxFrustum() {
+		Frustum frustum{};
+		const Vector3 normals[6] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+		for (int index = 0; index < 6; ++index) {
+			frustum.planes[index] = { normals[index], 1.0f };
+		}
+		return frustum;
+	}
+
+	void TestInsideIsAlwaysWritten() {
+		const Frustum frustum = MakeUnitBoxFrustum();
+		bool inside = false;
+		TEST_CHECK(TestFrustumAABB(frustum, { { -0.5f, -0.5f, -0.5f }, { 0.5f, 0.5f, 0.5f } }, &inside));
+		TEST_CHECK(inside);
+		// 外のものは、前の呼び出しでtrueになっていてもfalseにする
+		TEST_CHECK(!TestFrustumAABB(frustum, { { 2.0f, 2.0f, 2.0f }, { 3.0f, 3.0f, 3.0f } }, &inside));
+		TEST_CHECK(!inside);
+		inside = true;
+		TEST_CHECK(!TestFrustumAABB(frustum, { { -0.5f, -0.5f, -3.0f }, { 0.5f, 0.5f, -2.0f } }, &inside));
+		TEST_CHECK(!inside);
+		// 面をまたぐものは重なるが中ではない
+		inside = true;
+		TEST_CHECK(TestFrustumAABB(frustum, { { 0.5f, -0.5f, -0.5f }, { 1.5f, 0.5f, 0.5f } }, &inside));
+		TEST_CHECK(!inside);
+		// insideを渡さなくてもよい
+		TEST_CHECK(TestFrustumAABB(frustum, { { -0.5f, -0.5f, -0.5f }, { 0.5f, 0.5f, 0.5f } }));
+	}
+
+	void TestMatchesFrustumCull() {
+		const Frustum frustum = MakeUnitBoxFrustum();
+		std::mt19937 random(12345);
+		std::uniform_real_distribution<float> position(-3.0f, 3.0f);
+		std::uniform_real_distribution<float> size(0.0f, 1.0f);
+		std::vector<AABB> boxes;
+		CullingBounds bounds;
+		for (int index = 0; index < 1000; ++index) {
+			const Vector3 min{ position(random), position(random), position(random) };
+			const AABB box{ min, { min.x + size(random), min.y + size(random), min.z + size(random) } };
+			boxes.push_back(box);
+			bounds.Add(box);
+		}
+		std::vector<uint32_t> visible;
+		FrustumCull(frustum, bounds, CullingShape::Box, visible);
+		std::vector<uint32_t> expected;
+		for (uint32_t index = 0; index < boxes.size(); ++index) {
+			bool inside = true;
+			const bool overlaps = TestFrustumAABB(frustum, boxes[index], &inside);
+			if (overlaps) {
+				expected.push_back(index);
+			}
+			TEST_CHECK(overlaps || !inside);
+		}
+		TEST_CHECK(visible == expected);
+		TEST_CHECK(!visible.empty() && visible.size() < boxes.size());
+	}
+}
+
+int main() {
+	TestInsideIsAlwaysWritten();
+	TestMatchesFrustumCull();
+	return FinishTests("FrustumCullingTest");
+}
\ No newline at end of file
@@ -0,0 +1,235 @@
+#include <random>
+#include <vector>
+#include "GpuMemoryAllocator.h"
+#include "TestUtil.h"
+
+namespace {
+	const uint64_t kKilobyte = 1024;
+	const uint64_t kMegabyte = 1024 * 1024;
+	const uint64_t kHeapAlignment = 64 * kKilobyte;
+
+	// 作ったヒープの大きさを覚える。同じ番号を2回作ったり、無いものを破棄したりすれば数える
+	class FakeHeapBackend : public GpuHeapBackend {
+	public:
+		void CreateHeap(uint32_t heap, const GpuHeapDesc& desc) override {
+			if (heapSizes.size() <= heap) {
+				heapSizes.resize(heap + 1, 0);
+			}
+			errorCount += heapSizes[heap] != 0 || desc.size % desc.alignment != 0;
+			heapSizes[heap] = desc.size;
+			++heapCount;
+		}
+		void DestroyHeap(uint32_t heap) override {
+			errorCount += heap >= heapSizes.size() || heapSizes[heap] == 0;
+			if (heap < heapSizes.size()) {
+				heapSizes[heap] = 0;
+			}
+			--heapCount;
+		}
+		std::vector<uint64_t> heapSizes; //!< 破棄したものは0
+		uint32_t heapCount = 0;
+		uint32_t errorCount = 0;
+	};
+
+	void TestTlsfNearCapacity() {
+		// 4MBの手前は128KBごとのリストなので、4MB - 64KBの空きは切り上げた大きさのリストに入っていない
+		TlsfAllocator allocator;
+		allocator.Initialize(4 * kMegabyte);
+		const uint32_t first = allocator.Allocate(kHeapAlignment, kHeapAlignment);
+		const uint32_t rest = allocator.Allocate(4 * kMegabyte - kHeapAlignment, kHeapAlignment);
+		TEST_CHECK(rest != TlsfAllocator::kInvalidBlock);
+		TEST_CHECK(rest != TlsfAllocator::kInvalidBlock && allocator.GetOffset(rest) == kHeapAlignment);
+		TEST_CHECK(allocator.GetUsedBytes() == 4 * kMegabyte);
+		TEST_CHECK(allocator.Allocate(1, 1) == TlsfAllocator::kInvalidBlock);
+		TEST_CHECK(allocator.Validate());
+
+		// 揃えると入らないものは、同じリストにあっても入れない
+		allocator.Free(rest);
+		allocator.Free(first);
+		const uint32_t small = allocator.Allocate(4 * kKilobyte, 4 * kKilobyte);
+		TEST_CHECK(allocator.Allocate(4 * kMegabyte - kHeapAlignment, kHeapAlignment) != TlsfAllocator::kInvalidBlock);
+		TEST_CHECK(allocator.Allocate(kHeapAlignment - 4 * kKilobyte, kHeapAlignment) == TlsfAllocator::kInvalidBlock);
+		TEST_CHECK(allocator.Allocate(kHeapAlignment - 4 * kKilobyte, 4 * kKilobyte) != TlsfAllocator::kInvalidBlock);
+		TEST_CHECK(allocator.GetOffset(small) == 0);
+		TEST_CHECK(allocator.GetUsedBytes() == 4 * kMegabyte);
+		TEST_CHECK(allocator.Validate());
+
+		// 全体を1つにする確保は、大きさがリストの区切りに無くても入る
+		TlsfAllocator whole;
+		whole.Initialize(4 * kMegabyte + kHeapAlignment);
+		const uint32_t block = whole.AllocateAll();
+		TEST_CHECK(whole.GetOffset(block) == 0 && whole.GetSize(block) == 4 * kMegabyte + kHeapAlignment);
+		TEST_CHECK(whole.GetFreeBlockCount() == 0 && whole.GetLargestFreeBytes() == 0);
+		TEST_CHECK(whole.Validate());
+		whole.Free(block);
+		TEST_CHECK(whole.IsEmpty() && whole.GetLargestFreeBytes() == 4 * kMegabyte + kHeapAlignment);
+		TEST_CHECK(whole.Validate());
+	}
+
+	void TestTlsfRandom() {
+		// 確保と解放を混ぜても、並びが崩れず、確保したものが重ならない
+		TlsfAllocator allocator;
+		allocator.Initialize(16 * kMegabyte);
+		std::mt19937 random(12345);
+		std::vector<uint32_t> blocks;
+		for (uint32_t step = 0; step < 4000; ++step) {
+			if (blocks.empty() || random() % 3 != 0) {
+				const uint64_t alignment = uint64_t(1) << (random() % 17);
+				const uint64_t size = 1 + random() % (256 * kKilobyte);
+				const uint32_t block = allocator.Allocate(size, alignment);
+				if (block != TlsfAllocator::kInvalidBlock) {
+					TEST_CHECK(allocator.GetOffset(block) % alignment == 0 && allocator.GetSize(block) == size);
+					blocks.push_back(block);
+				}
+			} else {
+				const size_t index = random() % blocks.size();
+				allocator.Free(blocks[index]);
+				blocks[index] = blocks.back();
+				blocks.pop_back();
+			}
+			if (step % 100 == 0) {
+				TEST_CHECK(allocator.Validate());
+			}
+		}
+		for (uint32_t block : blocks) {
+			allocator.Free(block);
+		}
+		TEST_CHECK(allocator.IsEmpty() && allocator.GetFreeBlockCount() == 1 && allocator.Validate());
+	}
+
+	void TestDedicatedHeaps() {
+		FakeHeapBackend backend;
+		GpuMemoryAllocator allocator;
+		allocator.Initialize(&backend);
+		const uint32_t pool = allocator.AddPool({ 4 * kMegabyte, kHeapAlignment });
+
+		// ヒープの大きさを少し超えると、それだけのヒープを64KBに切り上げて作る
+		const uint64_t sizes[] = { 4 * kMegabyte + 1, 4 * kMegabyte + kHeapAlignment + 1, 6 * kMegabyte - 1 };
+		for (uint64_t size : sizes) {
+			const GpuAllocationHandle allocation = allocator.Allocate(pool, size, kHeapAlignment, true);
+			const GpuAllocationInfo info = allocator.GetInfo(allocation);
+			TEST_CHECK(info.offset == 0 && info.size == size);
+			TEST_CHECK(backend.heapSizes[info.heap] == (size + kHeapAlignment - 1) / kHeapAlignment * kHeapAlignment);
+			TEST_CHECK(backend.heapCount == 1);
+			// 空いたヒープはすぐに破棄する
+			allocator.Free(allocation);
+			TEST_CHECK(backend.heapCount == 0);
+		}
+
+		// ちょうどヒープの大きさなら普通のヒープに入る
+		const GpuAllocationHandle exact = allocator.Allocate(pool, 4 * kMegabyte, kHeapAlignment, true);
+		TEST_CHECK(backend.heapCount == 1);
+		TEST_CHECK(backend.heapSizes[allocator.GetInfo(exact).heap] == 4 * kMegabyte);
+		allocator.Free(exact);
+		allocator.Finalize();
+		TEST_CHECK(backend.heapCount == 0 && backend.errorCount == 0);
+	}
+
+	void TestHeapNearCapacity() {
+		FakeHeapBackend backend;
+		GpuMemoryAllocator allocator;
+		allocator.Initialize(&backend);
+		const uint32_t pool = allocator.AddPool({ 4 * kMegabyte, kHeapAlignment });
+
+		// 残りにちょうど入る大きさは、新しいヒープを作らずに同じヒープへ入れる
+		const GpuAllocationHandle first = allocator.Allocate(pool, kHeapAlignment, kHeapAlignment, true);
+		const GpuAllocationHandle rest = allocator.Allocate(pool, 4 * kMegabyte - kHeapAlignment, kHeapAlignment, true);
+		TEST_CHECK(backend.heapCount == 1);
+		TEST_CHECK(allocator.GetInfo(rest).heap == allocator.GetInfo(first).heap);
+		TEST_CHECK(allocator.GetInfo(rest).offset == kHeapAlignment);
+		GpuMemoryStats stats = allocator.GetStats(pool);
+		TEST_CHECK(stats.usedBytes == 4 * kMegabyte && stats.freeBytes == 0);
+
+		// 満杯なら次のヒープを作る
+		const GpuAllocationHandle next = allocator.Allocate(pool, 4 * kKilobyte, 4 * kKilobyte, true);
+		TEST_CHECK(backend.heapCount == 2);
+		TEST_CHECK(allocator.GetInfo(next).heap != allocator.GetInfo(first).heap);
+
+		// GPUが使い終わるまでは解放しない
+		allocator.Free(rest, 5);
+		allocator.Update(4);
+		TEST_CHECK(allocator.GetStats(pool).usedBytes == 4 * kMegabyte + 4 * kKilobyte);
+		allocator.Update(5);
+		stats = allocator.GetStats(pool);
+		TEST_CHECK(stats.usedBytes == kHeapAlignment + 4 * kKilobyte);
+		TEST_CHECK(stats.allocationCount == 2);
+		allocator.Finalize();
+		TEST_CHECK(backend.heapCount == 0 && backend.errorCount == 0);
+	}
+
+	void TestDefragment() {
+		FakeHeapBackend backend;
+		GpuMemoryAllocator allocator;
+		allocator.Initialize(&backend);
+		const uint32_t pool = allocator.AddPool({ 1 * kMegabyte, kHeapAlignment });
+
+		// 256KBを8個で2つのヒープを埋め、1つ目は3つ、2つ目は1つだけ残す
+		std::vector<GpuAllocationHandle> allocations;
+		for (uint32_t index = 0; index < 8; ++index) {
+			allocations.push_back(allocator.Allocate(pool, 256 * kKilobyte, kHeapAlignment, index != 1));
+		}
+		TEST_CHECK(backend.heapCount == 2);
+		const uint32_t fullHeap = allocator.GetInfo(allocations[0]).heap;
+		const uint32_t sparseHeap = allocator.GetInfo(allocations[4]).heap;
+		allocator.Free(allocations[2]);
+		allocator.Free(allocations[4]);
+		allocator.Free(allocations[5]);
+		allocator.Free(allocations[6]);
+		const GpuAllocationInfo before = allocator.GetInfo(allocations[7]);
+
+		const std::vector<GpuMove> moves = allocator.Defragment(pool, UINT64_MAX, 10);
+		TEST_CHECK(moves.size() == 1);
+		if (moves.size() == 1) {
+			const GpuMove& move = moves[0];
+			TEST_CHECK(move.allocation.id == allocations[7].id);
+			TEST_CHECK(move.sourceHeap == sparseHeap && move.sourceOffset == before.offset);
+			TEST_CHECK(move.destinationHeap == fullHeap && move.size == 256 * kKilobyte);
+			// 確保は既に新しい場所を指している
+			const GpuAllocationInfo after = allocator.GetInfo(allocations[7]);
+			TEST_CHECK(after.heap == move.destinationHeap && after.offset == move.destinationOffset);
+			// 1つ目のヒープで空いているのは3番目だけ
+			TEST_CHECK(move.destinationOffset == 2 * 256 * kKilobyte);
+		}
+		// 古い場所はfenceValueまで残るので、空いたヒープもそれまでは破棄しない
+		TEST_CHECK(backend.heapCount == 2);
+		allocator.Update(9);
+		TEST_CHECK(backend.heapCount == 2);
+		allocator.Update(10);
+		TEST_CHECK(backend.heapCount == 1);
+		GpuMemoryStats stats = allocator.GetStats(pool);
+		TEST_CHECK(stats.allocationCount == 4 && stats.usedBytes == kMegabyte && stats.fragmentation == 0.0f);
+
+		// 動かせないものと、maxBytesを超える分は動かさない
+		allocator.Free(allocations[0]);
+		allocator.Free(allocations[3]);
+		TEST_CHECK(allocator.Defragment(pool, 128 * kKilobyte, 11).empty());
+		const std::vector<GpuMove> compact = allocator.Defragment(pool, UINT64_MAX, 11);
+		for (const GpuMove& move : compact) {
+			TEST_CHECK(move.allocation.id != allocations[1].id);
+			TEST_CHECK(move.destinationHeap == move.sourceHeap && move.destinationOffset < move.sourceOffset);
+		}
+		allocator.Update(11);
+		stats = allocator.GetStats(pool);
+		TEST_CHECK(stats.allocationCount == 2 && stats.heapCount == 1);
+		allocator.Finalize();
+		TEST_CHECK(backend.heapCount == 0 && backend.errorCount == 0);
+	}
+
+	void TestBenchmark() {
+		const GpuAllocatorBenchmark result = MeasureGpuMemoryAllocator(2000);
+		TEST_CHECK(result.allocationCount == 2000);
+		TEST_CHECK(result.reservedBytes > 0 && result.reservedBytes <= result.dedicatedBytes);
+		TEST_CHECK(result.heapCountAfter <= result.heapCountBefore);
+		TEST_CHECK(result.fragmentationAfter <= result.fragmentationBefore);
+	}
+}
+
+int main() {
+	TestTlsfNearCapacity();
+	TestTlsfRandom();
+	TestDedicatedHeaps();
+	TestHeapNearCapacity();
+	TestDefragment();
+	TestBenchmark();
+	return FinishTests("GpuMemoryAllocatorTest");
+}
\ No newline at end of file
@@ -0,0 +1,257 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include "GpuProfiler.h"
+#include "TestUtil.h"
+
+namespace {
+	// クエリに決まった間隔で進む時刻を書く。読み戻しはSubmitで渡したFenceの値をGPUが終えるまで反映しない
+	class FakeGpuQuerySource : public GpuQuerySource {
+	public:
+		explicit FakeGpuQuerySource(uint32_t queryCount) : queries_(queryCount, 0), readback_(queryCount, 0) {}
+
+		void WriteTimestamp(uint32_t query) override {
+			TEST_CHECK(query < queries_.size());
+			if (query < queries_.size()) {
+				clock_ += tickStep;
+				queries_[query] = clock_;
+			}
+			writtenQueries.push_back(query);
+		}
+		void ResolveTimestamps(uint32_t first, uint32_t count) override {
+			TEST_CHECK(first + count <= queries_.size());
+			// 書き出すのはGPUがここまで進んだとき
+			unsubmitted_.push_back({ first, 0, std::vector<uint64_t>(queries_.begin() + first, queries_.begin() + first + count) });
+			++resolveCount;
+		}
+		void ReadTimestamps(uint32_t first, uint32_t count, uint64_t* timestamps) override {
+			TEST_CHECK(first + count <= readback_.size());
+			std::memcpy(timestamps, readback_.data() + first, count * sizeof(uint64_t));
+			++readCount;
+		}
+		uint64_t GetTimestampFrequency() const override { return kFrequency; }
+		bool GetClockCalibration(uint64_t&, int64_t&) override { return false; }
+
+		// EndFrameの後に呼び、積んだ書き出しにFenceの値を付ける
+		void Submit(uint64_t fenceValue) {
+			for (Resolve& resolve : unsubmitted_) {
+				resolve.fenceValue = fenceValue;
+				submitted_.push_back(std::move(resolve));
+			}
+			unsubmitted_.clear();
+		}
+		// GPUがfenceValueまで終えたことにする
+		void Complete(uint64_t fenceValue) {
+			auto it = submitted_.begin();
+			for (; it != submitted_.end() && it->fenceValue <= fenceValue; ++it) {
+				std::copy(it->timestamps.begin(), it->timestamps.end(), readback_.begin() + it->first);
+			}
+			submitted_.erase(submitted_.begin(), it);
+		}
+		// まだ書き出していないクエリの時刻を書き換える
+		void OverwriteTimestamp(uint32_t query, uint64_t timestamp) { queries_[query] = timestamp; }
+
+		// 1秒あたり100万。1ティックが1マイクロ秒
+		static const uint64_t kFrequency = 1000000;
+		uint64_t tickStep = 1000; //!< WriteTimestampのたびに進める時刻
+		std::vector<uint32_t> writtenQueries;
+		uint32_t resolveCount = 0;
+		uint32_t readCount = 0;
+
+	private:
+		struct Resolve {
+			uint32_t first;
+			uint64_t fenceValue;
+			std::vector<uint64_t> timestamps;
+		};
+		uint64_t clock_ = 0;
+		std::vector<uint64_t> queries_;
+		std::vector<uint64_t> readback_;
+		std::vector<Resolve> unsubmitted_;
+		std::vector<Resolve> submitted_;
+	};
+
+	bool IsNear(double value, double expected) {
+		return std::fabs(value - expected) < 1e-9;
+	}
+
+	const ProfileZoneStats* FindStats(const GpuProfiler& profiler, const char* name) {
+		for (const ProfileZoneStats& stats : profiler.GetZoneStats()) {
+			if (std::strcmp(stats.name, name) == 0) {
+				return &stats;
+			}
+		}
+		return nullptr;
+	}
+
+	void TestNestedZones() {
+		FakeGpuQuerySource source(2 * 16);
+		GpuProfiler profiler;
+		profiler.Initialize(&source, 2, 16);
+		// 1ミリ秒ごとに時刻を書くので、区間の時間は間に書いた数で決まる
+		uint64_t completed = 0;
+		for (uint64_t fenceValue = 1; fenceValue <= Profiler::kStatsFrameCount + 1; ++fenceValue) {
+			profiler.BeginFrame(completed);
+			profiler.BeginZone("A");
+			profiler.BeginZone("B");
+			profiler.BeginZone("C");
+			profiler.EndZone();
+			profiler.EndZone();
+			profiler.BeginZone("D");
+			profiler.EndZone();
+			profiler.EndZone();
+			profiler.BeginZone("E");
+			profiler.EndZone();
+			profiler.EndFrame(fenceValue);
+			source.Submit(fenceValue);
+			source.Complete(fenceValue);
+			completed = fenceValue;
+		}
+
+		const std::vector<GpuZoneResult>& results = profiler.GetLastResults();
+		TEST_CHECK(results.size() == 5);
+		if (results.size() == 5) {
+			const char* names[5] = { "A", "B", "C", "D", "E" };
+			const uint32_t depths[5] = { 0, 1, 2, 1, 0 };
+			const double begins[5] = { 0.0, 1.0, 2.0, 5.0, 8.0 };
+			const double durations[5] = { 7.0, 3.0, 1.0, 1.0, 1.0 };
+			for (uint32_t index = 0; index < 5; ++index) {
+				TEST_CHECK(std::strcmp(results[index].name, names[index]) == 0);
+				TEST_CHECK(results[index].depth == depths[index]);
+				TEST_CHECK(IsNear(results[index].beginMilliseconds, begins[index]));
+				TEST_CHECK(IsNear(results[index].milliseconds, durations[index]));
+			}
+		}
+
+		// 中の区間を除いた時間。長い順に並ぶ
+		const std::vector<ProfileZoneStats>& stats = profiler.GetZoneStats();
+		TEST_CHECK(stats.size() == 5);
+		TEST_CHECK(!stats.empty() && std::strcmp(stats.front().name, "A") == 0);
+		const ProfileZoneStats* a = FindStats(profiler, "A");
+		const ProfileZoneStats* b = FindStats(profiler, "B");
+		const ProfileZoneStats* c = FindStats(profiler, "C");
+		TEST_CHECK(a && IsNear(a->milliseconds, 7.0) && IsNear(a->selfMilliseconds, 3.0) && IsNear(a->callCount, 1.0));
+		TEST_CHECK(b && IsNear(b->milliseconds, 3.0) && IsNear(b->selfMilliseconds, 2.0));
+		TEST_CHECK(c && IsNear(c->selfMilliseconds, 1.0) && IsNear(c->maxMilliseconds, 1.0));
+		TEST_CHECK(profiler.GetDroppedCount() == 0);
+	}
+
+	void TestRingWrap() {
+		// 3フレーム分のクエリを輪番で使う。GPUは3フレーム遅れて終えるので、使う直前に前の周回の結果を読む
+		const uint32_t kFrameCount = 3;
+		const uint32_t kQueriesPerFrame = 4;
+		FakeGpuQuerySource source(kFrameCount * kQueriesPerFrame);
+		GpuProfiler profiler;
+		profiler.Initialize(&source, kFrameCount, kQueriesPerFrame);
+		uint32_t wrongRangeCount = 0;
+		uint32_t wrongResultCount = 0;
+		for (uint64_t fenceValue = 1; fenceValue <= 20; ++fenceValue) {
+			const uint64_t completed = fenceValue > kFrameCount ? fenceValue - kFrameCount : 0;
+			source.Complete(completed);
+			profiler.BeginFrame(completed);
+			// completedのフレームは、fenceValueミリ秒かかったことにしている
+			if (completed > 0 && (profiler.GetLastResults().size() != 1 || !IsNear(profiler.GetLastResults()[0].milliseconds, double(completed)))) {
+				++wrongResultCount;
+			}
+			source.tickStep = fenceValue * 1000;
+			source.writtenQueries.clear();
+			profiler.BeginZone("Pass");
+			profiler.EndZone();
+			profiler.EndFrame(fenceValue);
+			source.Submit(fenceValue);
+			// フレームごとに自分の範囲のクエリだけを使う
+			const uint32_t first = uint32_t((fenceValue - 1) % kFrameCount) * kQueriesPerFrame;
+			for (uint32_t query : source.writtenQueries) {
+				if (query < first || query >= first + kQueriesPerFrame) {
+					++wrongRangeCount;
+				}
+			}
+		}
+		TEST_CHECK(wrongRangeCount == 0);
+		TEST_CHECK(wrongResultCount == 0);
+		TEST_CHECK(source.resolveCount == 20);
+		TEST_CHECK(source.readCount == 20 - kFrameCount);
+		TEST_CHECK(profiler.GetDroppedCount() == 0);
+	}
+
+	void TestDisjointFrames() {
+		// GPUが止まって前の周回の結果が読めないフレームは測らず、読めるようになったらまとめて古い順に読む
+		FakeGpuQuerySource source(2 * 8);
+		GpuProfiler profiler;
+		profiler.Initialize(&source, 2, 8);
+		auto recordFrame = [&](uint64_t fenceValue, uint64_t completed, uint64_t tickStep) {
+			source.tickStep = tickStep;
+			profiler.BeginFrame(completed);
+			profiler.BeginZone("Outer");
+			profiler.BeginZone("Inner");
+			profiler.EndZone();
+			profiler.EndZone();
+			profiler.EndFrame(fenceValue);
+			source.Submit(fenceValue);
+		};
+		recordFrame(1, 0, 1000);
+		recordFrame(2, 0, 2000);
+		TEST_CHECK(source.resolveCount == 2);
+		// 3と4は場所が空かないので測らない。クエリも書かない
+		source.writtenQueries.clear();
+		recordFrame(3, 0, 3000);
+		recordFrame(4, 0, 4000);
+		TEST_CHECK(source.writtenQueries.empty());
+		TEST_CHECK(source.resolveCount == 2);
+		TEST_CHECK(profiler.GetDroppedCount() == 4);
+		TEST_CHECK(source.readCount == 0);
+
+		// 1と2が一度に終わる。最後に読んだ2の結果が残る
+		source.Complete(4);
+		recordFrame(5, 4, 5000);
+		TEST_CHECK(source.readCount == 2);
+		const std::vector<GpuZoneResult>& results = profiler.GetLastResults();
+		TEST_CHECK(results.size() == 2);
+		TEST_CHECK(results.size() == 2 && IsNear(results[0].milliseconds, 6.0) && IsNear(results[1].milliseconds, 2.0));
+		TEST_CHECK(results.size() == 2 && results[1].depth == 1);
+
+		// 5は測れている
+		source.Complete(5);
+		recordFrame(6, 5, 1000);
+		TEST_CHECK(profiler.GetLastResults().size() == 2 && IsNear(profiler.GetLastResults()[0].milliseconds, 15.0));
+		TEST_CHECK(profiler.GetDroppedCount() == 4);
+	}
+
+	void TestQueryOverflowAndReversedTimestamps() {
+		// 1フレームに4クエリまでなので、3つ目の区間は測らずに数える。中の区間は外の区間の子のまま
+		FakeGpuQuerySource source(4);
+		GpuProfiler profiler;
+		profiler.Initialize(&source, 1, 4);
+		profiler.BeginFrame(0);
+		profiler.BeginZone("Outer");
+		profiler.BeginZone("Middle");
+		profiler.BeginZone("Dropped");
+		profiler.EndZone();
+		profiler.EndZone();
+		profiler.EndZone();
+		// 読めなかったなどで終わりが始まりより前になった区間は0ミリ秒
+		source.OverwriteTimestamp(3, 0);
+		profiler.EndFrame(1);
+		source.Submit(1);
+		source.Complete(1);
+		TEST_CHECK(profiler.GetDroppedCount() == 1);
+		profiler.BeginFrame(1);
+		const std::vector<GpuZoneResult>& results = profiler.GetLastResults();
+		TEST_CHECK(results.size() == 2);
+		if (results.size() == 2) {
+			TEST_CHECK(std::strcmp(results[0].name, "Outer") == 0 && IsNear(results[0].milliseconds, 3.0));
+			TEST_CHECK(std::strcmp(results[1].name, "Middle") == 0 && results[1].depth == 1);
+			TEST_CHECK(results[1].milliseconds == 0.0);
+		}
+		profiler.EndFrame(2);
+	}
+}
+
+int main() {
+	TestNestedZones();
+	TestRingWrap();
+	TestDisjointFrames();
+	TestQueryOverflowAndReversedTimestamps();
+	return FinishTests("GpuProfilerTest");
+}
\ No newline at end of file
@@ -0,0 +1,121 @@
+#include <vector>
+#include "IndirectDraw.h"
+#include "TestUtil.h"
+
+namespace {
+	IndirectDrawObject MakeObject(uint32_t pipeline, uint32_t mesh, uint32_t objectIndex, float depth, bool visible) {
+		IndirectDrawObject object{};
+		object.pipeline = pipeline;
+		object.mesh = mesh;
+		object.objectIndex = objectIndex;
+		object.depth = depth;
+		object.visible = visible;
+		return object;
+	}
+
+	void TestSortAndBatches() {
+		IndirectDrawBuilder builder;
+		const uint32_t sphere = builder.AddMesh({ 36, 0, 0 });
+		const uint32_t model = builder.AddMesh({ 12, 36, 24 });
+		builder.Clear();
+		builder.Add(MakeObject(1, sphere, 0, 5.0f, true));
+		builder.Add(MakeObject(0, model, 1, 3.0f, true));
+		builder.Add(MakeObject(0, model, 2, 1.0f, true));
+		builder.Add(MakeObject(1, sphere, 3, 2.0f, false));
+		builder.Add(MakeObject(0, sphere, 4, 9.0f, true));
+
+		IndirectCommand commands[8] = {};
+		std::vector<IndirectBatch> batches;
+		TEST_CHECK(builder.Build(commands, 8, batches) == 4);
+		TEST_CHECK(builder.GetCulledCount() == 1);
+		TEST_CHECK(builder.GetOverflowCount() == 0);
+		// PSO -> メッシュ -> 手前から
+		TEST_CHECK(commands[0].objectIndex == 4);
+		TEST_CHECK(commands[1].objectIndex == 2);
+		TEST_CHECK(commands[2].objectIndex == 1);
+		TEST_CHECK(commands[3].objectIndex == 0);
+		TEST_CHECK(commands[1].drawArguments.indexCountPerInstance == 12);
+		TEST_CHECK(commands[1].drawArguments.startIndexLocation == 36);
+		TEST_CHECK(commands[1].drawArguments.baseVertexLocation == 24);
+		TEST_CHECK(batches.size() == 2);
+		TEST_CHECK(batches.size() == 2 && batches[0].pipeline == 0 && batches[0].commandOffset == 0 && batches[0].commandCount == 3);
+		TEST_CHECK(batches.size() == 2 && batches[1].pipeline == 1 && batches[1].commandOffset == 3 && batches[1].commandCount == 1);
+
+		// もう一度Buildしてもカリングの数は積み上がらない
+		TEST_CHECK(builder.Build(commands, 8, batches) == 4);
+		TEST_CHECK(builder.GetCulledCount() == 1);
+	}
+
+	void TestOverflow() {
+		IndirectDrawBuilder builder;
+		const uint32_t mesh = builder.AddMesh({ 6, 0, 0 });
+		for (uint32_t index = 0; index < 10; ++index) {
+			builder.Add(MakeObject(0, mesh, index, float(index), index != 3));
+		}
+		IndirectCommand commands[4] = {};
+		std::vector<IndirectBatch> batches;
+		// 可視の9個のうち手前の4個だけが入り、残りは溢れた数として返る
+		TEST_CHECK(builder.Build(commands, 4, batches) == 4);
+		TEST_CHECK(builder.GetOverflowCount() == 5);
+		TEST_CHECK(builder.GetCulledCount() == 1);
+		TEST_CHECK(commands[3].objectIndex == 4);
+		TEST_CHECK(batches.size() == 1 && batches[0].commandCount == 4);
+
+		// 足りる大きさで作り直せば溢れない
+		IndirectCommand moreCommands[16] = {};
+		TEST_CHECK(builder.Build(moreCommands, 16, batches) == 9);
+		TEST_CHECK(builder.GetOverflowCount() == 0);
+
+		builder.Clear();
+		TEST_CHECK(builder.GetObjectCount() == 0);
+		TEST_CHECK(builder.Build(moreCommands, 16, batches) == 0);
+		TEST_CHECK(batches.empty());
+	}
+
+	void TestOverflowPerPipeline() {
+		IndirectDrawBuilder builder;
+		const uint32_t mesh = builder.AddMesh({ 6, 0, 0 });
+		// PSO0に10個、PSO1に3個。objectIndexは PSO * 100 + 手前からの順番
+		for (uint32_t index = 0; index < 10; ++index) {
+			builder.Add(MakeObject(0, mesh, index, float(index), true));
+		}
+		for (uint32_t index = 0; index < 3; ++index) {
+			builder.Add(MakeObject(1, mesh, 100 + index, float(index), true));
+		}
+		IndirectCommand commands[16] = {};
+		std::vector<IndirectBatch> batches;
+		// 先のPSOだけで埋めず、PSO1も全て入る。PSO0は残りの分だけ手前から入る
+		TEST_CHECK(builder.Build(commands, 6, batches) == 6);
+		TEST_CHECK(builder.GetOverflowCount() == 7);
+		TEST_CHECK(batches.size() == 2);
+		TEST_CHECK(batches.size() == 2 && batches[0].pipeline == 0 && batches[0].commandOffset == 0 && batches[0].commandCount == 3);
+		TEST_CHECK(batches.size() == 2 && batches[1].pipeline == 1 && batches[1].commandOffset == 3 && batches[1].commandCount == 3);
+		TEST_CHECK(commands[0].objectIndex == 0 && commands[2].objectIndex == 2);
+		TEST_CHECK(commands[3].objectIndex == 100 && commands[5].objectIndex == 102);
+
+		// 少ないPSOが使わなかった分は他のPSOで分ける
+		for (uint32_t index = 0; index < 10; ++index) {
+			builder.Add(MakeObject(2, mesh, 200 + index, float(index), true));
+		}
+		TEST_CHECK(builder.Build(commands, 11, batches) == 11);
+		TEST_CHECK(builder.GetOverflowCount() == 12);
+		TEST_CHECK(batches.size() == 3);
+		TEST_CHECK(batches.size() == 3 && batches[0].commandCount == 4 && batches[1].commandCount == 3 && batches[2].commandCount == 4);
+		TEST_CHECK(batches.size() == 3 && batches[2].pipeline == 2 && batches[2].commandOffset == 7);
+		TEST_CHECK(commands[7].objectIndex == 200 && commands[10].objectIndex == 203);
+
+		// PSOの数より容量が少なければ、先のPSOから1つずつ入り、空のバッチは返さない
+		TEST_CHECK(builder.Build(commands, 2, batches) == 2);
+		TEST_CHECK(batches.size() == 2);
+		TEST_CHECK(batches.size() == 2 && batches[0].pipeline == 0 && batches[1].pipeline == 1 && batches[1].commandOffset == 1);
+		TEST_CHECK(builder.Build(commands, 0, batches) == 0);
+		TEST_CHECK(batches.empty() && builder.GetOverflowCount() == 23);
+	}
+}
+
+int main() {
+	TestSortAndBatches();
+	TestOverflow();
+	TestOverflowPerPipeline();
+	return FinishTests("IndirectDrawTest");
+}
\ No newline at end of file
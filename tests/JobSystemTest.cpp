@@ -0,0 +1,144 @@
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "JobSystem.h"
+#include "TestUtil.h"
+
+namespace {
+	void TestManyJobsWithStealing() {
+		// 0番のワーカーが積んだものを他のワーカーが盗んでも、全て1回ずつ実行する
+		JobSystem jobSystem;
+		jobSystem.Start(4);
+		const uint32_t kJobCount = 3000;
+		std::unique_ptr<std::atomic<uint32_t>[]> runCounts(new std::atomic<uint32_t>[kJobCount]);
+		for (uint32_t index = 0; index < kJobCount; ++index) {
+			runCounts[index] = 0;
+		}
+		std::atomic<uint32_t>* counts = runCounts.get();
+		JobCounter counter;
+		for (uint32_t index = 0; index < kJobCount; ++index) {
+			jobSystem.Run(counter, [counts, index](uint32_t) {
+				// 少し重くして、積んでいる間に盗まれるようにする
+				volatile uint32_t sum = 0;
+				for (uint32_t step = 0; step < 200; ++step) {
+					sum = sum + step;
+				}
+				counts[index].fetch_add(1, std::memory_order_relaxed);
+			});
+		}
+		jobSystem.Wait(counter);
+		TEST_CHECK(counter.IsDone());
+		uint32_t wrongCount = 0;
+		for (uint32_t index = 0; index < kJobCount; ++index) {
+			wrongCount += counts[index].load() != 1;
+		}
+		TEST_CHECK(wrongCount == 0);
+		const JobSystemStats stats = jobSystem.GetStats();
+		TEST_CHECK(stats.workerCount == 4);
+		TEST_CHECK(stats.executedCount == kJobCount);
+		jobSystem.Stop();
+	}
+
+	void TestMoreJobsThanQueue() {
+		// ワーカーが1つだけなら誰も取らないので、置き場が一周した分はRunの中で実行する
+		JobSystem jobSystem;
+		jobSystem.Start(1);
+		const uint32_t kJobCount = JobSystem::kMaxJobsPerWorker + 100;
+		std::atomic<uint32_t> executedCount{ 0 };
+		JobCounter counter;
+		for (uint32_t index = 0; index < kJobCount; ++index) {
+			jobSystem.Run(counter, [&executedCount](uint32_t workerIndex) {
+				TEST_CHECK(workerIndex == 0);
+				executedCount.fetch_add(1, std::memory_order_relaxed);
+			});
+		}
+		TEST_CHECK(executedCount == 100);
+		TEST_CHECK(!counter.IsDone());
+		jobSystem.Wait(counter);
+		TEST_CHECK(executedCount == kJobCount);
+		TEST_CHECK(counter.IsDone());
+		jobSystem.Stop();
+	}
+
+	void TestNestedParallelFor() {
+		JobSystem jobSystem;
+		jobSystem.Start(4);
+		const uint32_t kOuterCount = 64;
+		const uint32_t kInnerCount = 1000;
+		std::atomic<uint64_t> sum{ 0 };
+		std::atomic<uint32_t> invalidWorkerCount{ 0 };
+		JobSystem* system = &jobSystem;
+		jobSystem.ParallelFor(kOuterCount, 1, [&](uint32_t begin, uint32_t end, uint32_t) {
+			for (uint32_t outer = begin; outer < end; ++outer) {
+				// 外側の範囲の中からも分ける。待つ間に他の範囲を実行する
+				system->ParallelFor(kInnerCount, 16, [&, outer](uint32_t innerBegin, uint32_t innerEnd, uint32_t workerIndex) {
+					invalidWorkerCount += workerIndex >= system->GetWorkerCount();
+					uint64_t partial = 0;
+					for (uint32_t inner = innerBegin; inner < innerEnd; ++inner) {
+						partial += uint64_t(outer) * kInnerCount + inner;
+					}
+					sum.fetch_add(partial, std::memory_order_relaxed);
+				});
+			}
+		});
+		const uint64_t total = uint64_t(kOuterCount) * kInnerCount;
+		TEST_CHECK(sum == total * (total - 1) / 2);
+		TEST_CHECK(invalidWorkerCount == 0);
+		jobSystem.Stop();
+	}
+
+	void TestStopRunsQueuedJobs() {
+		// 待たずに止めても、積んだものは全て実行する
+		for (uint32_t workerCount : { 1u, 3u }) {
+			JobSystem jobSystem;
+			jobSystem.Start(workerCount);
+			std::atomic<uint32_t> executedCount{ 0 };
+			JobCounter counter;
+			for (uint32_t index = 0; index < 500; ++index) {
+				jobSystem.Run(counter, [&executedCount](uint32_t) { executedCount.fetch_add(1, std::memory_order_relaxed); });
+			}
+			// ワーカーでないスレッドが積んだものも残さない
+			std::thread([&]() {
+				for (uint32_t index = 0; index < 100; ++index) {
+					jobSystem.Run(counter, [&executedCount](uint32_t) { executedCount.fetch_add(1, std::memory_order_relaxed); });
+				}
+			}).join();
+			jobSystem.Stop();
+			TEST_CHECK(executedCount == 600);
+			TEST_CHECK(counter.IsDone());
+		}
+	}
+
+	void TestExternalWait() {
+		// ワーカーが0番だけで0番が他の処理をしていても、ワーカーでないスレッドは自分で実行して待ち終える
+		JobSystem jobSystem;
+		jobSystem.Start(1);
+		std::atomic<uint32_t> executedCount{ 0 };
+		std::atomic<uint32_t> invalidWorkerCount{ 0 };
+		std::thread([&]() {
+			JobCounter counter;
+			for (uint32_t index = 0; index < JobSystem::kMaxJobsPerWorker; ++index) {
+				jobSystem.Run(counter, [&](uint32_t workerIndex) {
+					invalidWorkerCount += workerIndex == JobSystem::kInvalidWorker;
+					executedCount.fetch_add(1, std::memory_order_relaxed);
+				});
+			}
+			jobSystem.Wait(counter);
+			TEST_CHECK(counter.IsDone());
+		}).join();
+		TEST_CHECK(executedCount == JobSystem::kMaxJobsPerWorker);
+		TEST_CHECK(invalidWorkerCount == JobSystem::kMaxJobsPerWorker);
+		TEST_CHECK(jobSystem.GetStats().executedCount == JobSystem::kMaxJobsPerWorker);
+		jobSystem.Stop();
+	}
+}
+
+int main() {
+	TestManyJobsWithStealing();
+	TestMoreJobsThanQueue();
+	TestNestedParallelFor();
+	TestStopRunsQueuedJobs();
+	TestExternalWait();
+	return FinishTests("JobSystemTest");
+}
\ No newline at end of file
@@ -0,0 +1,140 @@
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Logger.h"
+#include "TestUtil.h"
+
+namespace {
+	// 受け取った本文を前置きを除いて覚える
+	class CaptureLogSink : public LogSink {
+	public:
+		void Write(const char* line, size_t length) override {
+			std::lock_guard<std::mutex> lock(mutex_);
+			std::string text(line, length);
+			// "[秒.ミリ秒][重要度][分類] "の後ろが本文
+			const size_t prefixEnd = text.find("] ", text.find("][", text.find("][") + 2));
+			messages_.push_back(prefixEnd == std::string::npos ? text : text.substr(prefixEnd + 2));
+		}
+		std::vector<std::string> GetMessages() {
+			std::lock_guard<std::mutex> lock(mutex_);
+			return messages_;
+		}
+
+	private:
+		std::mutex mutex_;
+		std::vector<std::string> messages_;
+	};
+
+	bool IsValidUtf8Boundary(const std::string& text) {
+		return text.empty() || (uint8_t(text[0]) & 0xC0) != 0x80;
+	}
+
+	void TestLongMessagesAreSplit() {
+		Logger logger;
+		auto sink = std::make_unique<CaptureLogSink>();
+		CaptureLogSink* capture = sink.get();
+		logger.AddSink(std::move(sink));
+
+		// 3バイトの文字を並べると512バイトの区切りが文字の途中になる
+		std::string narrow;
+		for (int index = 0; index < 400; ++index) {
+			narrow += "\xE3\x81\x82";
+		}
+		logger.Write(LogLevel::Info, LogCategory::General, std::string_view(narrow));
+		logger.Flush();
+		std::vector<std::string> messages = capture->GetMessages();
+		std::string joined;
+		for (const std::string& message : messages) {
+			TEST_CHECK(message.size() <= Logger::kMaxMessageLength);
+			TEST_CHECK(IsValidUtf8Boundary(message));
+			joined += message;
+		}
+		TEST_CHECK(messages.size() == 3);
+		TEST_CHECK(joined == narrow);
+
+		// UTF-16も切り捨てずに分ける
+		std::u16string wide;
+		std::string expected;
+		for (int index = 0; index < 700; ++index) {
+			wide += u"aあ";
+			expected += "a\xE3\x81\x82";
+		}
+		logger.Write(LogLevel::Info, LogCategory::General, Utf16StringView(reinterpret_cast<const Utf16Char*>(wide.data()), wide.size()));
+		logger.Flush();
+		messages = capture->GetMessages();
+		joined.clear();
+		for (size_t index = 3; index < messages.size(); ++index) {
+			TEST_CHECK(IsValidUtf8Boundary(messages[index]));
+			joined += messages[index];
+		}
+		TEST_CHECK(messages.size() > 4);
+		TEST_CHECK(joined == expected);
+
+		// 整形したものは入る分だけ
+		logger.Write(LogLevel::Warning, LogCategory::Shader, "value:{} name:{}", 42, "shader");
+		logger.Flush();
+		TEST_CHECK(capture->GetMessages().back() == "value:42 name:shader");
+	}
+
+	void TestFlushWithoutThread() {
+		// 書き出しスレッドが無いときに複数のスレッドからFlushしても、1件ずつ1回だけ書き出す
+		Logger logger;
+		auto sink = std::make_unique<CaptureLogSink>();
+		CaptureLogSink* capture = sink.get();
+		logger.AddSink(std::move(sink));
+		const uint32_t kPerThread = 500;
+		std::vector<std::thread> threads;
+		for (uint32_t thread = 0; thread < 4; ++thread) {
+			threads.emplace_back([&logger, thread]() {
+				for (uint32_t index = 0; index < kPerThread; ++index) {
+					logger.Write(LogLevel::Info, LogCategory::General, "{}:{}", thread, index);
+					logger.Flush();
+				}
+			});
+		}
+		for (std::thread& thread : threads) {
+			thread.join();
+		}
+		logger.Flush();
+		TEST_CHECK(capture->GetMessages().size() == 4 * kPerThread);
+		TEST_CHECK(logger.GetWrittenCount() == 4 * kPerThread);
+		TEST_CHECK(logger.GetDroppedCount() == 0);
+	}
+
+	void TestDropWhenFull() {
+		// 書き出さないまま容量を超えた分は捨てて数える
+		Logger logger;
+		for (uint32_t index = 0; index < Logger::kCapacity + 10; ++index) {
+			logger.Write(LogLevel::Info, LogCategory::General, "x");
+		}
+		TEST_CHECK(logger.GetDroppedCount() == 10);
+		logger.Flush();
+		TEST_CHECK(logger.GetWrittenCount() == Logger::kCapacity);
+	}
+
+	void TestThreadDrainsOnStop() {
+		Logger logger;
+		auto sink = std::make_unique<CaptureLogSink>();
+		CaptureLogSink* capture = sink.get();
+		logger.AddSink(std::move(sink));
+		logger.Write(LogLevel::Info, LogCategory::General, "before start");
+		logger.Start();
+		for (uint32_t index = 0; index < 1000; ++index) {
+			logger.Write(LogLevel::Debug, LogCategory::Asset, "{}", index);
+		}
+		logger.Stop();
+		const std::vector<std::string> messages = capture->GetMessages();
+		TEST_CHECK(messages.size() == 1001);
+		TEST_CHECK(!messages.empty() && messages.front() == "before start");
+		TEST_CHECK(!messages.empty() && messages.back() == "999");
+	}
+}
+
+int main() {
+	TestLongMessagesAreSplit();
+	TestFlushWithoutThread();
+	TestDropWhenFull();
+	TestThreadDrainsOnStop();
+	return FinishTests("LoggerTest");
+}
\ No newline at end of file
@@ -0,0 +1,124 @@
+#include "MemoryTracker.h"
+#include "TestUtil.h"
+
+namespace {
+	const uint64_t kMegabyte = 1024 * 1024;
+
+	void TestTrackAndUntrack() {
+		MemoryTracker tracker;
+		int mesh = 0;
+		int texture = 0;
+		int upload = 0;
+		tracker.Track(&mesh, MemoryCategory::Mesh, "mesh", 100, 4000);
+		tracker.Track(&texture, MemoryCategory::Texture, "texture", 0, 16000);
+		tracker.Track(&upload, MemoryCategory::Staging, "upload", 0, 2000, MemorySegment::NonLocal);
+
+		MemoryCategoryStats total = tracker.GetTotalStats();
+		TEST_CHECK(total.allocationCount == 3);
+		TEST_CHECK(total.cpuBytes == 100 && total.gpuBytes == 22000);
+		TEST_CHECK(tracker.GetCategoryStats(MemoryCategory::Mesh).gpuBytes == 4000);
+		TEST_CHECK(tracker.GetCategoryStats(MemoryCategory::Texture).allocationCount == 1);
+		TEST_CHECK(tracker.GetCategoryStats(MemoryCategory::Other).allocationCount == 0);
+		// セグメントごとに分けて数える
+		TEST_CHECK(tracker.GetBudget(MemorySegment::Local).trackedBytes == 20000);
+		TEST_CHECK(tracker.GetBudget(MemorySegment::NonLocal).trackedBytes == 2000);
+
+		const std::vector<MemoryAllocationInfo> largest = tracker.GetLargestAllocations(2);
+		TEST_CHECK(largest.size() == 2);
+		TEST_CHECK(largest.size() == 2 && largest[0].name == "texture" && largest[1].name == "mesh");
+		TEST_CHECK(tracker.GetLargestAllocations(10).size() == 3);
+
+		TEST_CHECK(tracker.Untrack(&texture));
+		// 2回目と追跡していないものはfalse
+		TEST_CHECK(!tracker.Untrack(&texture));
+		int unknown = 0;
+		TEST_CHECK(!tracker.Untrack(&unknown));
+		total = tracker.GetTotalStats();
+		TEST_CHECK(total.allocationCount == 2);
+		TEST_CHECK(total.gpuBytes == 6000);
+		TEST_CHECK(tracker.GetCategoryStats(MemoryCategory::Texture).gpuBytes == 0);
+		TEST_CHECK(tracker.GetBudget(MemorySegment::Local).trackedBytes == 4000);
+
+		TEST_CHECK(tracker.Untrack(&mesh));
+		TEST_CHECK(tracker.Untrack(&upload));
+		total = tracker.GetTotalStats();
+		TEST_CHECK(total.allocationCount == 0 && total.cpuBytes == 0 && total.gpuBytes == 0);
+		TEST_CHECK(tracker.GetLargestAllocations(10).empty());
+	}
+
+	void TestPeaks() {
+		MemoryTracker tracker;
+		int first = 0;
+		int second = 0;
+		tracker.Track(&first, MemoryCategory::Constant, "first", 10, 3000);
+		tracker.Track(&second, MemoryCategory::Constant, "second", 20, 5000);
+		tracker.Untrack(&second);
+
+		// 解放しても一番多く使ったときの値は残る
+		MemoryCategoryStats stats = tracker.GetCategoryStats(MemoryCategory::Constant);
+		TEST_CHECK(stats.allocationCount == 1 && stats.peakAllocationCount == 2);
+		TEST_CHECK(stats.cpuBytes == 10 && stats.cpuPeakBytes == 30);
+		TEST_CHECK(stats.gpuBytes == 3000 && stats.gpuPeakBytes == 8000);
+		TEST_CHECK(tracker.GetTotalStats().gpuPeakBytes == 8000);
+		TEST_CHECK(tracker.GetBudget(MemorySegment::Local).trackedPeakBytes == 8000);
+		tracker.SetBudget(MemorySegment::Local, 0, 700);
+		tracker.SetBudget(MemorySegment::Local, 0, 400);
+		TEST_CHECK(tracker.GetBudget(MemorySegment::Local).peakUsage == 700);
+
+		// ResetPeaksで今の値に戻り、その後はまた増えた分だけ上がる
+		tracker.ResetPeaks();
+		stats = tracker.GetCategoryStats(MemoryCategory::Constant);
+		TEST_CHECK(stats.peakAllocationCount == 1 && stats.cpuPeakBytes == 10 && stats.gpuPeakBytes == 3000);
+		TEST_CHECK(tracker.GetTotalStats().gpuPeakBytes == 3000);
+		MemoryBudget budget = tracker.GetBudget(MemorySegment::Local);
+		TEST_CHECK(budget.peakUsage == 400 && budget.trackedPeakBytes == 3000);
+		tracker.Track(&second, MemoryCategory::Constant, "second", 0, 1000);
+		TEST_CHECK(tracker.GetCategoryStats(MemoryCategory::Constant).gpuPeakBytes == 4000);
+		TEST_CHECK(tracker.GetBudget(MemorySegment::Local).trackedPeakBytes == 4000);
+	}
+
+	void TestBudgetWarning() {
+		MemoryTracker tracker;
+		// 予算が分からない間は警告しない
+		tracker.SetBudget(MemorySegment::Local, 0, 1000 * kMegabyte);
+		TEST_CHECK(!tracker.IsNearBudget(MemorySegment::Local));
+		TEST_CHECK(tracker.GetBudget(MemorySegment::Local).warningCount == 0);
+
+		tracker.SetBudget(MemorySegment::Local, 100 * kMegabyte, 50 * kMegabyte);
+		TEST_CHECK(!tracker.IsNearBudget(MemorySegment::Local));
+		tracker.SetBudget(MemorySegment::Local, 100 * kMegabyte, 95 * kMegabyte);
+		TEST_CHECK(tracker.IsNearBudget(MemorySegment::Local));
+		TEST_CHECK(tracker.GetBudget(MemorySegment::Local).warningCount == 1);
+
+		// 90%の境目を行き来しても、80%を下回るまでは警告を繰り返さない
+		for (uint32_t frame = 0; frame < 10; ++frame) {
+			tracker.SetBudget(MemorySegment::Local, 100 * kMegabyte, (frame % 2 ? 95 : 85) * kMegabyte);
+			TEST_CHECK(tracker.IsNearBudget(MemorySegment::Local) == (frame % 2 == 1));
+		}
+		TEST_CHECK(tracker.GetBudget(MemorySegment::Local).warningCount == 1);
+		tracker.SetBudget(MemorySegment::Local, 100 * kMegabyte, 70 * kMegabyte);
+		tracker.SetBudget(MemorySegment::Local, 100 * kMegabyte, 95 * kMegabyte);
+		TEST_CHECK(tracker.GetBudget(MemorySegment::Local).warningCount == 2);
+
+		// OSの使用量より追跡している量が多ければそちらで判断する。他のセグメントには影響しない
+		tracker.SetBudget(MemorySegment::Local, 100 * kMegabyte, 10 * kMegabyte);
+		int texture = 0;
+		tracker.Track(&texture, MemoryCategory::Texture, "texture", 0, 92 * kMegabyte);
+		TEST_CHECK(tracker.IsNearBudget(MemorySegment::Local));
+		TEST_CHECK(tracker.GetBudget(MemorySegment::Local).warningCount == 3);
+		TEST_CHECK(!tracker.IsNearBudget(MemorySegment::NonLocal));
+		TEST_CHECK(tracker.GetBudget(MemorySegment::NonLocal).warningCount == 0);
+		// 解放して80%を下回れば、次に超えたときにまた警告する
+		tracker.Untrack(&texture);
+		TEST_CHECK(!tracker.IsNearBudget(MemorySegment::Local));
+		tracker.Track(&texture, MemoryCategory::Texture, "texture", 0, 92 * kMegabyte);
+		TEST_CHECK(tracker.GetBudget(MemorySegment::Local).warningCount == 4);
+	}
+}
+
+int main() {
+	TestTrackAndUntrack();
+	TestPeaks();
+	TestBudgetWarning();
+	return FinishTests("MemoryTrackerTest");
+}
\ No newline at end of file
@@ -0,0 +1,165 @@
+#include <cstring>
+#include "DeviceRenderQueueExecutor.h"
+#include "NullRenderDevice.h"
+#include "TestUtil.h"
+
+namespace {
+	const uint32_t kR8G8B8A8Unorm = 28;
+	const uint32_t kBC1Unorm = 71;
+	const uint8_t kShaderBytecode[4] = {};
+
+	RenderPipelineDesc MakePipelineDesc() {
+		RenderPipelineDesc desc{};
+		desc.vertexShader = kShaderBytecode;
+		desc.vertexShaderSize = sizeof(kShaderBytecode);
+		desc.renderTargetFormat = kR8G8B8A8Unorm;
+		return desc;
+	}
+
+	void TestHandlePoolGenerations() {
+		RenderHandlePool<int> pool;
+		const uint32_t first = pool.Add(1);
+		TEST_CHECK(pool.Get(first) && *pool.Get(first) == 1);
+		TEST_CHECK(pool.Remove(first));
+		TEST_CHECK(!pool.Get(first));
+		TEST_CHECK(!pool.Remove(first));
+
+		// 1つの場所だけを使い回しても、世代が一周するまでは古い番号は通らない
+		uint32_t id = pool.Add(2);
+		for (uint32_t reuse = 0; reuse < 4000; ++reuse) {
+			pool.Remove(id);
+			id = pool.Add(int(reuse));
+			TEST_CHECK(!pool.Get(first) || id == first);
+		}
+		pool.Remove(id);
+
+		// 空いた場所は古く空いたものから使うので、すぐ後に同じ場所が返らない
+		const uint32_t a = pool.Add(10);
+		const uint32_t b = pool.Add(11);
+		pool.Remove(a);
+		pool.Remove(b);
+		const uint32_t c = pool.Add(12);
+		TEST_CHECK((c & 0xFFFFF) != (b & 0xFFFFF));
+		TEST_CHECK(!pool.Get(a) && !pool.Get(b));
+		TEST_CHECK(pool.GetCount() == 1);
+	}
+
+	void TestResources() {
+		NullRenderDevice device;
+		const RenderBufferHandle upload = device.CreateBuffer({ 1024, RenderHeapType::Upload, MemoryCategory::Constant });
+		const RenderBufferHandle gpuOnly = device.CreateBuffer({ 4096, RenderHeapType::Default, MemoryCategory::Mesh });
+		void* data = device.Map(upload);
+		TEST_CHECK(data != nullptr);
+		std::memset(data, 0xCD, 1024);
+		device.Unmap(upload);
+		TEST_CHECK(device.GetStats().validationErrorCount == 0);
+
+		// DefaultHeapはMapできない
+		TEST_CHECK(device.Map(gpuOnly) == nullptr);
+		TEST_CHECK(device.GetStats().validationErrorCount == 1);
+
+		const RenderTextureHandle texture = device.CreateTexture({ 256, 256, 9, kR8G8B8A8Unorm });
+		TEST_CHECK(texture.id != 0);
+		TEST_CHECK(device.GetStats().textureBytes == GetRenderTextureBytes({ 256, 256, 9, kR8G8B8A8Unorm }));
+		// 256x256のMipは9段まで
+		TEST_CHECK(device.CreateTexture({ 256, 256, 10, kR8G8B8A8Unorm }).id == 0);
+		TEST_CHECK(device.GetStats().validationErrorCount == 2);
+
+		std::vector<uint8_t> pixels(256 * 256 * 4);
+		device.WriteTexture(texture, 0, pixels.data(), 256 * 4, 256 * 256 * 4);
+		device.WriteTexture(texture, 1, pixels.data(), 128 * 4, 128 * 128 * 4);
+		TEST_CHECK(device.GetStats().validationErrorCount == 2);
+		device.WriteTexture(texture, 0, pixels.data(), 16, 256 * 256 * 4);
+		TEST_CHECK(device.GetStats().validationErrorCount == 3);
+
+		// ビューが残っているテクスチャを破棄するのは誤り
+		const RenderDescriptorHandle view = device.CreateTextureView(texture);
+		device.DestroyTexture(texture);
+		TEST_CHECK(device.GetStats().validationErrorCount == 4);
+		device.DestroyDescriptor(view);
+		TEST_CHECK(device.GetStats().validationErrorCount == 4);
+
+		// 破棄した番号は使えない
+		device.DestroyBuffer(upload);
+		device.DestroyBuffer(upload);
+		TEST_CHECK(device.GetStats().validationErrorCount == 5);
+		device.DestroyBuffer(gpuOnly);
+
+		const RenderDeviceStats stats = device.GetStats();
+		TEST_CHECK(stats.bufferCount == 0 && stats.bufferBytes == 0);
+		TEST_CHECK(stats.textureCount == 0 && stats.textureBytes == 0);
+		TEST_CHECK(stats.descriptorCount == 0);
+		TEST_CHECK(device.GetPeakBytes() >= 1024 + 4096 + GetRenderTextureBytes({ 256, 256, 9, kR8G8B8A8Unorm }));
+	}
+
+	void TestFormats() {
+		TEST_CHECK(GetRenderImageBytes(kR8G8B8A8Unorm, 3, 5) == 60);
+		// ブロック圧縮は4x4に切り上げる
+		TEST_CHECK(GetRenderImageBytes(kBC1Unorm, 1, 1) == 8);
+		TEST_CHECK(GetRenderImageBytes(kBC1Unorm, 5, 4) == 16);
+		TEST_CHECK(GetRenderTextureBytes({ 4, 4, 3, kR8G8B8A8Unorm }) == 64 + 16 + 4);
+	}
+
+	void TestCommandListValidation() {
+		NullRenderDevice device;
+		const RenderPipelineHandle pipeline = device.CreatePipeline(MakePipelineDesc());
+		RenderPipelineDesc depthWithoutFormat = MakePipelineDesc();
+		depthWithoutFormat.depthTest = true;
+		TEST_CHECK(device.CreatePipeline(depthWithoutFormat).id == 0);
+		const RenderBufferHandle vertices = device.CreateBuffer({ 32 * 3, RenderHeapType::Upload, MemoryCategory::Mesh });
+		const RenderBufferHandle indices = device.CreateBuffer({ 4 * 6, RenderHeapType::Upload, MemoryCategory::Mesh });
+		const RenderBufferHandle constants = device.CreateBuffer({ 512, RenderHeapType::Upload, MemoryCategory::Constant });
+		uint64_t errors = device.GetStats().validationErrorCount;
+		TEST_CHECK(errors == 1);
+
+		NullRenderCommandList commandList(device);
+		// PSOも頂点も無い描画
+		commandList.Draw(3, 1);
+		TEST_CHECK(device.GetStats().validationErrorCount == ++errors);
+		commandList.SetPipeline(pipeline);
+		commandList.SetVertexBuffer(vertices, 0, 32 * 3, 32);
+		commandList.Draw(3, 2);
+		commandList.Draw(4, 1);
+		TEST_CHECK(device.GetStats().validationErrorCount == ++errors);
+		commandList.DrawIndexed(6, 1);
+		TEST_CHECK(device.GetStats().validationErrorCount == ++errors);
+		commandList.SetIndexBuffer(indices, 0, 4 * 6);
+		commandList.DrawIndexed(6, 1);
+		// CBVの先頭は256バイト単位
+		commandList.SetConstantBuffer(0, constants, 256);
+		commandList.SetConstantBuffer(0, constants, 128);
+		TEST_CHECK(device.GetStats().validationErrorCount == ++errors);
+
+		const NullRenderCommandListStats& stats = commandList.GetStats();
+		TEST_CHECK(stats.drawCount == 2);
+		TEST_CHECK(stats.instanceCount == 3);
+		TEST_CHECK(stats.vertexCount == 3 * 2 + 6);
+		TEST_CHECK(stats.stateChangeCount == 5);
+		commandList.Reset();
+		TEST_CHECK(commandList.GetStats().drawCount == 0);
+
+		device.DestroyBuffer(vertices);
+		device.DestroyBuffer(indices);
+		device.DestroyBuffer(constants);
+		device.DestroyPipeline(pipeline);
+		TEST_CHECK(device.GetStats().validationErrorCount == errors);
+	}
+
+	void TestHeadlessRenderQueue() {
+		// RenderQueueの並べ替えから記録までを、誤った呼び出し無しで全て積めるか
+		const HeadlessRenderQueueBenchmark result = MeasureHeadlessRenderQueue(2000, 2);
+		TEST_CHECK(result.drawCount == 2000);
+		TEST_CHECK(result.validationErrorCount == 0);
+		TEST_CHECK(result.stateChangeCount > 0 && result.stateChangeCount < 2000 * 5);
+		TEST_CHECK(result.peakBytes > 0);
+	}
+}
+
+int main() {
+	TestHandlePoolGenerations();
+	TestResources();
+	TestFormats();
+	TestCommandListValidation();
+	TestHeadlessRenderQueue();
+	return FinishTests("NullRenderDeviceTest");
+}
\ No newline at end of file
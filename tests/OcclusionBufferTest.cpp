@@ -0,0 +1,161 @@
+#include <cmath>
+#include <string>
+#include <vector>
+#include "OcclusionBuffer.h"
+#include "TestUtil.h"
+
+namespace {
+	const uint32_t kWidth = 16;
+	const uint32_t kHeight = 8;
+
+	// 深度バッファのピクセルの位置(x, y)と深度を、単位行列で描いたときの頂点にする
+	VertexData MakeScreenVertex(float x, float y, float depth) {
+		VertexData vertex{};
+		vertex.position = { x / float(kWidth) * 2.0f - 1.0f, 1.0f - y / float(kHeight) * 2.0f, depth, 1.0f };
+		return vertex;
+	}
+
+	// 遮蔽物を描いたピクセルを'#'、描いていないピクセルを'.'にして1行ずつ並べる
+	std::vector<std::string> GetCoverage(const OcclusionBuffer& buffer) {
+		std::vector<std::string> rows;
+		const float* depth = buffer.GetDepth(0);
+		for (uint32_t y = 0; y < buffer.GetHeight(); ++y) {
+			std::string row;
+			for (uint32_t x = 0; x < buffer.GetWidth(); ++x) {
+				row += depth[y * buffer.GetWidth() + x] < 1.0f ? '#' : '.';
+			}
+			rows.push_back(row);
+		}
+		return rows;
+	}
+
+	void TestTriangleCoversWholePixelsOnly() {
+		OcclusionBuffer buffer;
+		buffer.Initialize(kWidth, kHeight);
+		buffer.Begin(MakeIdentity4x4());
+		// 斜めの辺はx + 2y = 16。辺をまたぐピクセルは中心が入っていても描かない
+		const VertexData vertices[3] = { MakeScreenVertex(2, 1, 0.5f), MakeScreenVertex(14, 1, 0.5f), MakeScreenVertex(2, 7, 0.5f) };
+		buffer.DrawOccluder(vertices, 3, nullptr, 0, MakeIdentity4x4());
+		const std::vector<std::string> expected = {
+			"................",
+			"..##########....",
+			"..########......",
+			"..######........",
+			"..####..........",
+			"..##............",
+			"................",
+			"................",
+		};
+		TEST_CHECK(GetCoverage(buffer) == expected);
+		TEST_CHECK(buffer.GetStats().rasterizedTriangleCount == 1);
+
+		// 裏向きは描かない
+		buffer.Begin(MakeIdentity4x4());
+		const VertexData back[3] = { vertices[0], vertices[2], vertices[1] };
+		buffer.DrawOccluder(back, 3, nullptr, 0, MakeIdentity4x4());
+		TEST_CHECK(GetCoverage(buffer) == std::vector<std::string>(kHeight, std::string(kWidth, '.')));
+	}
+
+	void TestQuadHasNoSeam() {
+		// 2つの三角形で作った四角形は、対角線の上のピクセルも描く。外周は半端なピクセルを描かない
+		const VertexData vertices[4] = {
+			MakeScreenVertex(2.0f, 1.0f, 0.5f), MakeScreenVertex(13.5f, 1.0f, 0.5f),
+			MakeScreenVertex(13.5f, 6.5f, 0.5f), MakeScreenVertex(2.0f, 6.5f, 0.5f),
+		};
+		const uint32_t indices[6] = { 0, 1, 3, 1, 2, 3 };
+		const std::vector<std::string> expected = {
+			"................",
+			"..###########...",
+			"..###########...",
+			"..###########...",
+			"..###########...",
+			"..###########...",
+			"................",
+			"................",
+		};
+		OcclusionBuffer buffer;
+		buffer.Initialize(kWidth, kHeight);
+		buffer.Begin(MakeIdentity4x4());
+		buffer.DrawOccluder(vertices, 4, indices, 6, MakeIdentity4x4());
+		TEST_CHECK(GetCoverage(buffer) == expected);
+
+		// インデックスが無くても、同じ位置の頂点を使う辺は共有する
+		const VertexData unindexed[6] = { vertices[0], vertices[1], vertices[3], vertices[1], vertices[2], vertices[3] };
+		buffer.Begin(MakeIdentity4x4());
+		buffer.DrawOccluder(unindexed, 6, nullptr, 0, MakeIdentity4x4());
+		TEST_CHECK(GetCoverage(buffer) == expected);
+
+		// 別々に描くと辺を共有しないので、対角線の上のピクセルは描かない
+		buffer.Begin(MakeIdentity4x4());
+		buffer.DrawOccluder(unindexed, 3, nullptr, 0, MakeIdentity4x4());
+		buffer.DrawOccluder(unindexed + 3, 3, nullptr, 0, MakeIdentity4x4());
+		uint32_t coveredCount = 0;
+		for (const std::string& row : GetCoverage(buffer)) {
+			for (char pixel : row) {
+				coveredCount += pixel == '#' ? 1 : 0;
+			}
+		}
+		TEST_CHECK(coveredCount < 11 * 5);
+	}
+
+	void TestDepthIsFarthestInPixel() {
+		// 深度はxに沿って0.25から0.75まで変わる。各ピクセルの深度はピクセルの右端の深度になる
+		const VertexData vertices[4] = {
+			MakeScreenVertex(0.0f, 0.0f, 0.25f), MakeScreenVertex(16.0f, 0.0f, 0.75f),
+			MakeScreenVertex(16.0f, 8.0f, 0.75f), MakeScreenVertex(0.0f, 8.0f, 0.25f),
+		};
+		const uint32_t indices[6] = { 0, 1, 3, 1, 2, 3 };
+		OcclusionBuffer buffer;
+		buffer.Initialize(kWidth, kHeight);
+		buffer.Begin(MakeIdentity4x4());
+		buffer.DrawOccluder(vertices, 4, indices, 6, MakeIdentity4x4());
+		const float* depth = buffer.GetDepth(0);
+		for (uint32_t y = 0; y < kHeight; ++y) {
+			for (uint32_t x = 0; x < kWidth; ++x) {
+				const float expected = 0.25f + 0.5f * float(x + 1) / float(kWidth);
+				TEST_CHECK(std::fabs(depth[y * kWidth + x] - expected) < 1e-5f);
+			}
+		}
+		// 縮小した段は2x2の一番奥
+		buffer.BuildHierarchy();
+		TEST_CHECK(std::fabs(buffer.GetDepth(1)[0] - (0.25f + 0.5f * 2.0f / float(kWidth))) < 1e-5f);
+	}
+
+	void TestAABBAgainstOccluder() {
+		// x = 2〜13.5の四角形の後ろに置いたAABB
+		const VertexData vertices[4] = {
+			MakeScreenVertex(2.0f, 0.0f, 0.5f), MakeScreenVertex(13.5f, 0.0f, 0.5f),
+			MakeScreenVertex(13.5f, 8.0f, 0.5f), MakeScreenVertex(2.0f, 8.0f, 0.5f),
+		};
+		const uint32_t indices[6] = { 0, 1, 3, 1, 2, 3 };
+		OcclusionBuffer buffer;
+		buffer.Initialize(kWidth, kHeight);
+		buffer.Begin(MakeIdentity4x4());
+		buffer.DrawOccluder(vertices, 4, indices, 6, MakeIdentity4x4());
+		buffer.BuildHierarchy();
+
+		auto makeBox = [](float beginX, float endX, float nearDepth, float farDepth) {
+			const Vector4 begin = MakeScreenVertex(beginX, 3.2f, nearDepth).position;
+			const Vector4 end = MakeScreenVertex(endX, 4.8f, farDepth).position;
+			return AABB{ { begin.x, end.y, begin.z }, { end.x, begin.y, end.z } };
+		};
+		// 遮蔽物の後ろは隠れる
+		TEST_CHECK(!buffer.TestAABB(makeBox(4.2f, 9.8f, 0.6f, 0.7f)));
+		// 手前は見える
+		TEST_CHECK(buffer.TestAABB(makeBox(4.2f, 9.8f, 0.3f, 0.4f)));
+		// 遮蔽物の縁が半分だけ覆うピクセルの中にあるものは、後ろでも見える
+		TEST_CHECK(buffer.TestAABB(makeBox(13.6f, 13.9f, 0.6f, 0.7f)));
+		// 遮蔽物の外は見える
+		TEST_CHECK(buffer.TestAABB(makeBox(14.2f, 15.8f, 0.6f, 0.7f)));
+		TEST_CHECK(buffer.GetStats().testedCount == 4);
+		TEST_CHECK(buffer.GetStats().occludedCount == 1);
+	}
+}
+
+int main() {
+	TestTriangleCoversWholePixelsOnly();
+	TestQuadHasNoSeam();
+	TestDepthIsFarthestInPixel();
+	TestAABBAgainstOccluder();
+	return FinishTests("OcclusionBufferTest");
+}
\ No newline at end of file
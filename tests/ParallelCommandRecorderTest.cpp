@@ -0,0 +1,199 @@
+#include <map>
+#include <mutex>
+#include <vector>
+#include "ArenaAllocator.h"
+#include "ParallelCommandRecorder.h"
+#include "TestUtil.h"
+
+namespace {
+	// 呼び出しを記録する偽のコマンドリスト。積んだ項目はリストごとに覚える
+	class RecordingBackend : public CommandListBackend {
+	public:
+		void CreateAllocator(uint32_t allocator) override {
+			TEST_CHECK(allocator == allocatorFences.size());
+			allocatorFences.push_back(0);
+			++createCount;
+		}
+		void ResetAllocator(uint32_t allocator) override {
+			// GPUが使い終わっていないアロケーターを使い回すのは誤り
+			TEST_CHECK(allocator < allocatorFences.size() && allocatorFences[allocator] <= completedFenceValue);
+			++resetCount;
+		}
+		void OpenCommandList(uint32_t list, uint32_t allocator) override {
+			TEST_CHECK(open.count(list) == 0 || !open[list]);
+			open[list] = true;
+			listAllocators[list] = allocator;
+			std::lock_guard<std::mutex> lock(mutex);
+			items[list].clear();
+			setupCount[list] = 0;
+		}
+		void CloseCommandList(uint32_t list) override {
+			TEST_CHECK(open[list]);
+			open[list] = false;
+		}
+		void ExecuteCommandLists(const uint32_t* lists, uint32_t count) override {
+			executed.assign(lists, lists + count);
+			for (uint32_t index = 0; index < count; ++index) {
+				TEST_CHECK(!open[lists[index]]);
+				// 実行したリストのアロケーターは、この後Signalする値までGPUが使う
+				allocatorFences[listAllocators[lists[index]]] = submittedFenceValue;
+			}
+		}
+
+		void Record(uint32_t list, uint32_t begin, uint32_t end) {
+			std::lock_guard<std::mutex> lock(mutex);
+			TEST_CHECK(open[list]);
+			for (uint32_t item = begin; item < end; ++item) {
+				items[list].push_back(item);
+			}
+		}
+		void Setup(uint32_t list) {
+			std::lock_guard<std::mutex> lock(mutex);
+			++setupCount[list];
+		}
+
+		uint64_t completedFenceValue = 0;
+		uint64_t submittedFenceValue = 0;
+		std::vector<uint64_t> allocatorFences; //!< アロケーターごとに、GPUが使い終わるFenceの値
+		std::map<uint32_t, bool> open;
+		std::map<uint32_t, uint32_t> listAllocators;
+		std::vector<uint32_t> executed;
+		uint32_t createCount = 0;
+		uint32_t resetCount = 0;
+
+		std::mutex mutex;
+		std::map<uint32_t, std::vector<uint32_t>> items;
+		std::map<uint32_t, uint32_t> setupCount;
+	};
+
+	void TestPartitionWork() {
+		TEST_CHECK(PartitionWork(0, 4, 1).empty());
+		// 最小数に満たなければ1つにまとめる
+		std::vector<WorkRange> ranges = PartitionWork(10, 4, 64);
+		TEST_CHECK(ranges.size() == 1 && ranges[0].begin == 0 && ranges[0].end == 10);
+		// 割り切れない分は前から1つずつ
+		ranges = PartitionWork(10, 4, 1);
+		TEST_CHECK(ranges.size() == 4);
+		const uint32_t expected[] = { 3, 3, 2, 2 };
+		uint32_t begin = 0;
+		for (uint32_t index = 0; index < ranges.size() && index < 4; ++index) {
+			TEST_CHECK(ranges[index].begin == begin);
+			TEST_CHECK(ranges[index].end - ranges[index].begin == expected[index]);
+			begin = ranges[index].end;
+		}
+		ranges = PartitionWork(100, 8, 30);
+		TEST_CHECK(ranges.size() == 3 && ranges.back().end == 100);
+	}
+
+	void TestListsExecuteInRecordOrder() {
+		JobSystem jobSystem;
+		jobSystem.Start(4);
+		RecordingBackend backend;
+		ParallelCommandRecorder recorder;
+		recorder.Initialize(&backend, &jobSystem, 16);
+		auto setup = [&](uint32_t list) { backend.Setup(list); };
+		auto record = [&](uint32_t list, uint32_t begin, uint32_t end) { backend.Record(list, begin, end); };
+
+		GetFrameArena().BeginFrame();
+		const uint32_t first = recorder.Begin(0);
+		TEST_CHECK(first == recorder.GetCurrentList());
+		// 最初のパスは呼び出したスレッドで積む
+		backend.Record(recorder.GetCurrentList(), 0, 5);
+		// 分けるほどの量が無ければ今のリストに積む
+		recorder.RecordParallel(10, setup, record);
+		TEST_CHECK(recorder.GetCurrentList() == first);
+		recorder.RecordParallel(1000, setup, record);
+		const uint32_t continued = recorder.GetCurrentList();
+		TEST_CHECK(continued != first);
+		backend.Record(continued, 1000, 1003);
+		backend.submittedFenceValue = 1;
+		recorder.Submit(1);
+
+		// 開いた順に1回で実行する。Begin、スレッドごとのリスト、続きのリストの順
+		const CommandRecorderStats& stats = recorder.GetStats();
+		TEST_CHECK(stats.parallelListCount == 4);
+		TEST_CHECK(stats.commandListCount == 6);
+		TEST_CHECK(backend.executed.size() == 6);
+		for (uint32_t index = 0; index < backend.executed.size(); ++index) {
+			TEST_CHECK(backend.executed[index] == index);
+		}
+		TEST_CHECK(backend.executed.back() == continued);
+
+		// 実行順に並べた項目が、積もうとした順と一致する
+		std::vector<uint32_t> expected;
+		for (uint32_t item = 0; item < 5; ++item) {
+			expected.push_back(item);
+		}
+		for (uint32_t item = 0; item < 10; ++item) {
+			expected.push_back(item);
+		}
+		for (uint32_t item = 0; item < 1003; ++item) {
+			expected.push_back(item);
+		}
+		std::vector<uint32_t> recorded;
+		for (uint32_t list : backend.executed) {
+			recorded.insert(recorded.end(), backend.items[list].begin(), backend.items[list].end());
+		}
+		TEST_CHECK(recorded == expected);
+
+		// 引き継がれない状態は、スレッドごとのリストと続きのリストで1回ずつ設定する
+		TEST_CHECK(backend.setupCount[first] == 0);
+		for (uint32_t list = 1; list < backend.executed.size(); ++list) {
+			TEST_CHECK(backend.setupCount[list] == 1);
+		}
+		jobSystem.Stop();
+	}
+
+	void TestAllocatorsWaitForFence() {
+		JobSystem jobSystem;
+		jobSystem.Start(2);
+		RecordingBackend backend;
+		ParallelCommandRecorder recorder;
+		recorder.Initialize(&backend, &jobSystem, 1);
+		auto setup = [&](uint32_t list) { backend.Setup(list); };
+		auto record = [&](uint32_t list, uint32_t begin, uint32_t end) { backend.Record(list, begin, end); };
+		auto runFrame = [&](uint64_t completed, uint64_t fence) {
+			GetFrameArena().BeginFrame();
+			backend.completedFenceValue = completed;
+			backend.submittedFenceValue = fence;
+			recorder.Begin(completed);
+			recorder.RecordParallel(8, setup, record);
+			recorder.Submit(fence);
+		};
+
+		// 1フレームで4つ(Begin、2スレッド、続き)
+		runFrame(0, 1);
+		TEST_CHECK(recorder.GetStats().createdAllocatorCount == 4);
+		TEST_CHECK(backend.resetCount == 0);
+		// GPUがまだ1を終えていないので、前のアロケーターは使い回さずに作る
+		runFrame(0, 2);
+		TEST_CHECK(recorder.GetStats().createdAllocatorCount == 4);
+		TEST_CHECK(recorder.GetStats().allocatorCount == 8);
+		TEST_CHECK(backend.resetCount == 0);
+		// 1まで終わったので、1フレーム目の分だけを使い回す
+		runFrame(1, 3);
+		TEST_CHECK(recorder.GetStats().createdAllocatorCount == 0);
+		TEST_CHECK(backend.resetCount == 4);
+		for (uint32_t allocator = 0; allocator < 4; ++allocator) {
+			TEST_CHECK(backend.allocatorFences[allocator] == 3);
+		}
+		for (uint32_t allocator = 4; allocator < 8; ++allocator) {
+			TEST_CHECK(backend.allocatorFences[allocator] == 2);
+		}
+		// GPUが追いつけば、それ以上は増えない
+		for (uint64_t fence = 4; fence < 10; ++fence) {
+			runFrame(fence - 2, fence);
+			TEST_CHECK(recorder.GetStats().createdAllocatorCount == 0);
+		}
+		TEST_CHECK(backend.createCount == 8);
+		jobSystem.Stop();
+	}
+}
+
+int main() {
+	GetFrameArena().Initialize(64 * 1024);
+	TestPartitionWork();
+	TestListsExecuteInRecordOrder();
+	TestAllocatorsWaitForFence();
+	return FinishTests("ParallelCommandRecorderTest");
+}
\ No newline at end of file
@@ -0,0 +1,105 @@
+#include <cstring>
+#include <vector>
+#include "PipelineStateKey.h"
+#include "TestUtil.h"
+
+namespace {
+	const uint8_t kVertexShader[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+	const uint8_t kPixelShader[8] = { 8, 7, 6, 5, 4, 3, 2, 1 };
+
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC MakeDesc(const D3D12_INPUT_ELEMENT_DESC* elements, uint32_t elementCount) {
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC desc;
+		std::memset(&desc, 0, sizeof(desc));
+		desc.VS = { kVertexShader, sizeof(kVertexShader) };
+		desc.PS = { kPixelShader, sizeof(kPixelShader) };
+		desc.BlendState.RenderTarget[0].RenderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_ALL;
+		desc.RasterizerState.FillMode = D3D12_FILL_MODE_SOLID;
+		desc.RasterizerState.CullMode = D3D12_CULL_MODE_BACK;
+		desc.InputLayout = { elements, elementCount };
+		desc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+		desc.NumRenderTargets = 1;
+		desc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+		desc.SampleDesc.Count = 1;
+		desc.SampleMask = D3D12_DEFAULT_SAMPLE_MASK;
+		return desc;
+	}
+
+	std::vector<uint8_t> GetKey(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureHash = 1) {
+		std::vector<uint8_t> bytes;
+		WriteGraphicsPipelineStateKey(desc, rootSignatureHash, bytes);
+		return bytes;
+	}
+
+	void TestEquivalentDescsShareKey() {
+		const D3D12_INPUT_ELEMENT_DESC appended[] = {
+			{ "POSITION", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+			{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+			{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		};
+		// オフセットを直接書いても、セマンティクス名の大文字小文字が違っても同じ
+		const D3D12_INPUT_ELEMENT_DESC explicitOffsets[] = {
+			{ "position", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+			{ "TexCoord", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 16, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+			{ "Normal", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 24, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		};
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC a = MakeDesc(appended, 3);
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC b = MakeDesc(explicitOffsets, 3);
+		// 使われないブレンドの設定や、別のアドレスにある同じシェーダーは結果に関わらない
+		b.BlendState.RenderTarget[0].SrcBlend = D3D12_BLEND_SRC_ALPHA;
+		b.BlendState.RenderTarget[1].BlendEnable = TRUE;
+		const std::vector<uint8_t> copiedShader(kVertexShader, kVertexShader + sizeof(kVertexShader));
+		b.VS = { copiedShader.data(), copiedShader.size() };
+		TEST_CHECK(GetKey(a) == GetKey(b));
+		TEST_CHECK(HashGraphicsPipelineStateDesc(a, 1) == HashGraphicsPipelineStateDesc(b, 1));
+	}
+
+	void TestDifferentDescsHaveDifferentKeys() {
+		const D3D12_INPUT_ELEMENT_DESC elements[] = {
+			{ "POSITION", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		};
+		const D3D12_GRAPHICS_PIPELINE_STATE_DESC base = MakeDesc(elements, 1);
+		const std::vector<uint8_t> baseKey = GetKey(base);
+
+		// キャッシュはハッシュが一致してもこのバイト列を比べるので、結果に関わる違いは全て残っている必要がある
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = base;
+		desc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
+		TEST_CHECK(GetKey(desc) != baseKey);
+		desc = base;
+		desc.BlendState.RenderTarget[0].BlendEnable = TRUE;
+		TEST_CHECK(GetKey(desc) != baseKey);
+		desc = base;
+		desc.DepthStencilState.DepthEnable = TRUE;
+		TEST_CHECK(GetKey(desc) != baseKey);
+		desc = base;
+		desc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
+		TEST_CHECK(GetKey(desc) != baseKey);
+		const uint8_t otherShader[8] = { 1, 2, 3, 4, 5, 6, 7, 9 };
+		desc = base;
+		desc.VS = { otherShader, sizeof(otherShader) };
+		TEST_CHECK(GetKey(desc) != baseKey);
+		TEST_CHECK(GetKey(base, 2) != baseKey);
+
+		// 前の中身は消して書き直す
+		std::vector<uint8_t> reused = GetKey(desc);
+		WriteGraphicsPipelineStateKey(base, 1, reused);
+		TEST_CHECK(reused == baseKey);
+	}
+
+	void TestFormatByteSize() {
+		TEST_CHECK(GetFormatByteSize(DXGI_FORMAT_R32G32B32A32_FLOAT) == 16);
+		TEST_CHECK(GetFormatByteSize(DXGI_FORMAT_R32G32B32_FLOAT) == 12);
+		TEST_CHECK(GetFormatByteSize(DXGI_FORMAT_R32G32_FLOAT) == 8);
+		TEST_CHECK(GetFormatByteSize(DXGI_FORMAT_R16G16B16A16_SINT) == 8);
+		TEST_CHECK(GetFormatByteSize(DXGI_FORMAT_R8G8B8A8_UNORM) == 4);
+		TEST_CHECK(GetFormatByteSize(DXGI_FORMAT_R11G11B10_FLOAT) == 4);
+		TEST_CHECK(GetFormatByteSize(DXGI_FORMAT_R16_FLOAT) == 2);
+		TEST_CHECK(GetFormatByteSize(DXGI_FORMAT_R8_UINT) == 1);
+	}
+}
+
+int main() {
+	TestEquivalentDescsShareKey();
+	TestDifferentDescsHaveDifferentKeys();
+	TestFormatByteSize();
+	return FinishTests("PipelineStateKeyTest");
+}
\ No newline at end of file
@@ -0,0 +1,124 @@
+#include <cmath>
+#include <vector>
+#include "NullRenderDevice.h"
+#include "PrimitiveMeshCache.h"
+#include "TestUtil.h"
+
+namespace {
+	bool SamePosition(const VertexData& a, const VertexData& b) {
+		return std::fabs(a.position.x - b.position.x) < 1e-6f &&
+			std::fabs(a.position.y - b.position.y) < 1e-6f &&
+			std::fabs(a.position.z - b.position.z) < 1e-6f;
+	}
+
+	void TestPrimitiveTriangles() {
+		for (uint32_t type = 0; type < uint32_t(PrimitiveType::Count); ++type) {
+			for (uint32_t subdivision = 2; subdivision <= 9; ++subdivision) {
+				const PrimitiveDesc desc{ PrimitiveType(type), subdivision, 0.25f };
+				std::vector<VertexData> vertices(GetPrimitiveVertexCount(desc));
+				std::vector<uint32_t> indices(GetPrimitiveIndexCount(desc));
+				WritePrimitive(desc, vertices.data(), indices.data());
+				TEST_CHECK(indices.size() % 3 == 0);
+				uint32_t degenerateCount = 0;
+				for (size_t index = 0; index < indices.size(); index += 3) {
+					TEST_CHECK(indices[index] < vertices.size() && indices[index + 1] < vertices.size() && indices[index + 2] < vertices.size());
+					const VertexData& a = vertices[indices[index]];
+					const VertexData& b = vertices[indices[index + 1]];
+					const VertexData& c = vertices[indices[index + 2]];
+					if (SamePosition(a, b) || SamePosition(b, c) || SamePosition(c, a)) {
+						++degenerateCount;
+					}
+				}
+				// 極でも潰れた三角形を出さない
+				TEST_CHECK(degenerateCount == 0);
+			}
+		}
+
+		// 球の極の行は1区間に三角形1つ
+		const PrimitiveDesc sphere{ PrimitiveType::Sphere, 8, 0.0f };
+		TEST_CHECK(GetPrimitiveIndexCount(sphere) == (8 * 8 * 2 - 8 * 2) * 3);
+	}
+
+	void TestCacheReusesMesh() {
+		NullRenderDevice device;
+		DeviceRenderQueueExecutor executor;
+		PrimitiveMeshCache cache;
+		cache.Initialize(&device, &executor, 2);
+		cache.Update(0, 0);
+		const uint32_t sphere = cache.GetMesh({ PrimitiveType::Sphere, 8, 0.0f });
+		TEST_CHECK(cache.GetMesh({ PrimitiveType::Sphere, 8, 0.0f }) == sphere);
+		TEST_CHECK(cache.GetMesh({ PrimitiveType::Sphere, 9, 0.0f }) != sphere);
+		TEST_CHECK(cache.GetMeshCount() == 2);
+		TEST_CHECK(device.GetStats().bufferCount == 4);
+		cache.Finalize();
+		TEST_CHECK(device.GetStats().bufferCount == 0);
+		TEST_CHECK(device.GetStats().validationErrorCount == 0);
+	}
+
+	void TestCacheEvictsAfterFence() {
+		NullRenderDevice device;
+		DeviceRenderQueueExecutor executor;
+		PrimitiveMeshCache cache;
+		cache.Initialize(&device, &executor, 2);
+		const PrimitiveDesc a{ PrimitiveType::Cube, 2, 0.0f };
+		const PrimitiveDesc b{ PrimitiveType::Plane, 2, 0.0f };
+		const PrimitiveDesc c{ PrimitiveType::Torus, 4, 0.25f };
+
+		// フレーム1でA、フレーム2でB、フレーム3でAを使ってからCを作る
+		cache.Update(0, 0);
+		const uint32_t meshA = cache.GetMesh(a);
+		cache.Update(0, 1);
+		const uint32_t meshB = cache.GetMesh(b);
+		cache.Update(1, 2);
+		TEST_CHECK(cache.GetMesh(a) == meshA);
+		cache.GetMesh(c);
+		// 最も長く使っていないBが外れる。フレーム2の描画が終わるまではバッファを残す
+		TEST_CHECK(cache.GetMeshCount() == 2);
+		TEST_CHECK(cache.GetEvictedCount() == 1);
+		TEST_CHECK(cache.GetRetiredCount() == 1);
+		TEST_CHECK(device.GetStats().bufferCount == 6);
+
+		cache.Update(1, 3);
+		TEST_CHECK(cache.GetRetiredCount() == 1);
+		TEST_CHECK(device.GetStats().bufferCount == 6);
+		cache.Update(2, 3);
+		TEST_CHECK(cache.GetRetiredCount() == 0);
+		TEST_CHECK(device.GetStats().bufferCount == 4);
+
+		// 破棄した後はBの番号を使い回す
+		cache.Update(3, 3);
+		const uint32_t meshB2 = cache.GetMesh(b);
+		TEST_CHECK(meshB2 == meshB);
+		cache.Finalize();
+		TEST_CHECK(device.GetStats().bufferCount == 0);
+		TEST_CHECK(device.GetStats().validationErrorCount == 0);
+	}
+
+	void TestCacheKeepsMeshesUsedThisFrame() {
+		NullRenderDevice device;
+		DeviceRenderQueueExecutor executor;
+		PrimitiveMeshCache cache;
+		cache.Initialize(&device, &executor, 1);
+		cache.Update(0, 0);
+		// 同じフレームで使ったものは既に積まれているので、数を超えても外さない
+		const uint32_t first = cache.GetMesh({ PrimitiveType::Sphere, 4, 0.0f });
+		const uint32_t second = cache.GetMesh({ PrimitiveType::Sphere, 5, 0.0f });
+		TEST_CHECK(first != second);
+		TEST_CHECK(cache.GetMeshCount() == 2);
+		TEST_CHECK(cache.GetEvictedCount() == 0);
+		// 次のフレームの最初に超えた分を外す
+		cache.Update(0, 1);
+		TEST_CHECK(cache.GetMeshCount() == 1);
+		TEST_CHECK(cache.GetEvictedCount() == 1);
+		cache.Finalize();
+		TEST_CHECK(device.GetStats().bufferCount == 0);
+	}
+}
+
+int main() {
+	TestPrimitiveTriangles();
+	TestCacheReusesMesh();
+	TestCacheEvictsAfterFence();
+	TestCacheKeepsMeshesUsedThisFrame();
+	return FinishTests("PrimitiveMeshCacheTest");
+}
\ No newline at end of file
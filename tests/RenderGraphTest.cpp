@@ -0,0 +1,192 @@
+#include <string>
+#include <vector>
+#include "RenderGraph.h"
+#include "TestUtil.h"
+
+namespace {
+	// 張られたバリアとパスの順を覚える
+	class RecordingExecutor : public RenderGraphExecutor {
+	public:
+		struct Batch {
+			std::string pass; //!< 全てのパスの後なら空
+			std::vector<RenderGraphBarrier> barriers;
+		};
+
+		void ResourceBarriers(const RenderGraphBarrier* barriers, uint32_t count) override {
+			TEST_CHECK(count > 0);
+			batches.push_back({ currentPass, std::vector<RenderGraphBarrier>(barriers, barriers + count) });
+		}
+		void BeginPass(std::string_view name) override {
+			currentPass = name;
+			passes.emplace_back(name);
+		}
+		void EndPass() override {
+			currentPass.clear();
+		}
+
+		// passの前に張ったバリア。無ければnullptr
+		const std::vector<RenderGraphBarrier>* Find(const std::string& pass) const {
+			for (const Batch& batch : batches) {
+				if (batch.pass == pass) {
+					return &batch.barriers;
+				}
+			}
+			return nullptr;
+		}
+
+		std::string currentPass;
+		std::vector<std::string> passes;
+		std::vector<Batch> batches;
+	};
+
+	const RenderGraphTextureDesc kColorDesc = { 1280, 720, 28, { 0.0f, 0.0f, 0.0f, 1.0f } };
+
+	// テクスチャは全て1MBで64KB揃え、同じヒープに置く
+	RenderGraphAllocationInfo GetFixedAllocationInfo(const RenderGraphTextureDesc&, uint32_t) {
+		return { 1 << 20, 1 << 16, 0 };
+	}
+
+	size_t CountBarriers(const std::vector<RenderGraphBarrier>& barriers, RenderGraphBarrier::Type type, uint32_t resource) {
+		size_t count = 0;
+		for (const RenderGraphBarrier& barrier : barriers) {
+			if (barrier.type == type && barrier.resource == resource) {
+				++count;
+			}
+		}
+		return count;
+	}
+
+	void TestAliasingBarrierOnFirstUse() {
+		RenderGraph graph;
+		const uint32_t backBuffer = graph.ImportTexture("BackBuffer", kRenderGraphStateCommon, kRenderGraphStateCommon);
+		const uint32_t first = graph.CreateTexture("First", kColorDesc);
+		const uint32_t second = graph.CreateTexture("Second", kColorDesc);
+		const uint32_t third = graph.CreateTexture("Third", kColorDesc);
+
+		// FirstはSecondを書き終えた時点で使い終わるので、ThirdがFirstのメモリを使える
+		const uint32_t passA = graph.AddPass("A", nullptr);
+		graph.Write(passA, first, kRenderGraphStateRenderTarget);
+		const uint32_t passB = graph.AddPass("B", nullptr);
+		graph.Read(passB, first, kRenderGraphStateShaderResource);
+		graph.Write(passB, second, kRenderGraphStateRenderTarget);
+		const uint32_t passC = graph.AddPass("C", nullptr);
+		graph.Read(passC, second, kRenderGraphStateShaderResource);
+		graph.Write(passC, third, kRenderGraphStateRenderTarget);
+		const uint32_t passD = graph.AddPass("D", nullptr);
+		graph.Read(passD, third, kRenderGraphStateShaderResource);
+		graph.Write(passD, backBuffer, kRenderGraphStateRenderTarget);
+		graph.Compile(GetFixedAllocationInfo);
+
+		TEST_CHECK(graph.GetHeap(first) == 0 && graph.GetHeap(third) == 0);
+		TEST_CHECK(graph.GetHeapOffset(first) == graph.GetHeapOffset(third));
+		TEST_CHECK(graph.GetHeapOffset(first) != graph.GetHeapOffset(second));
+		TEST_CHECK(graph.GetStats().transientMemory == 2 << 20);
+		TEST_CHECK(graph.GetStats().unaliasedTransientMemory == 3 << 20);
+
+		RecordingExecutor executor;
+		graph.Execute(executor);
+		TEST_CHECK(executor.passes == std::vector<std::string>({ "A", "B", "C", "D" }));
+
+		// 重なるものが無いSecondも含め、置いたテクスチャは全て最初に使うパスでだけAliasingを張る
+		const uint32_t transients[] = { first, second, third };
+		const char* firstPasses[] = { "A", "B", "C" };
+		for (uint32_t index = 0; index < 3; ++index) {
+			size_t total = 0;
+			for (const RecordingExecutor::Batch& batch : executor.batches) {
+				const size_t count = CountBarriers(batch.barriers, RenderGraphBarrier::Type::Aliasing, transients[index]);
+				TEST_CHECK(count == 0 || batch.pass == firstPasses[index]);
+				total += count;
+			}
+			TEST_CHECK(total == 1);
+		}
+		// 前のフレームに何がメモリを使っていたかは分からないので、前のリソースは指定しない
+		for (const RecordingExecutor::Batch& batch : executor.batches) {
+			for (const RenderGraphBarrier& barrier : batch.barriers) {
+				if (barrier.type == RenderGraphBarrier::Type::Aliasing) {
+					TEST_CHECK(barrier.resourceBefore == kRenderGraphInvalid);
+				}
+			}
+		}
+		// 取り込んだリソースにはAliasingを張らない
+		for (const RecordingExecutor::Batch& batch : executor.batches) {
+			TEST_CHECK(CountBarriers(batch.barriers, RenderGraphBarrier::Type::Aliasing, backBuffer) == 0);
+		}
+
+		// Cの前は、Firstを最初の状態へ戻す、ThirdのAliasing、SecondのTransitionの順
+		const std::vector<RenderGraphBarrier>* barriersC = executor.Find("C");
+		TEST_CHECK(barriersC != nullptr && barriersC->size() == 3);
+		if (barriersC != nullptr && barriersC->size() == 3) {
+			const RenderGraphBarrier& restore = (*barriersC)[0];
+			TEST_CHECK(restore.type == RenderGraphBarrier::Type::Transition && restore.resource == first);
+			TEST_CHECK(restore.stateBefore == kRenderGraphStateShaderResource && restore.stateAfter == kRenderGraphStateRenderTarget);
+			TEST_CHECK((*barriersC)[1].type == RenderGraphBarrier::Type::Aliasing && (*barriersC)[1].resource == third);
+			const RenderGraphBarrier& transition = (*barriersC)[2];
+			TEST_CHECK(transition.type == RenderGraphBarrier::Type::Transition && transition.resource == second);
+			TEST_CHECK(transition.stateBefore == kRenderGraphStateRenderTarget && transition.stateAfter == kRenderGraphStateShaderResource);
+		}
+	}
+
+	void TestTransitionsAndCulling() {
+		RenderGraph graph;
+		const uint32_t backBuffer = graph.ImportTexture("BackBuffer", kRenderGraphStateCommon, kRenderGraphStateCommon);
+		const uint32_t depth = graph.CreateTexture("Depth", { 1280, 720, 40, { 1.0f } });
+		const uint32_t unused = graph.CreateTexture("Unused", kColorDesc);
+
+		const uint32_t depthPrepass = graph.AddPass("DepthPrepass", nullptr);
+		graph.Write(depthPrepass, depth, kRenderGraphStateDepthWrite);
+		// 結果をどこでも読まないので省かれる
+		const uint32_t debug = graph.AddPass("Debug", nullptr);
+		graph.Write(debug, unused, kRenderGraphStateRenderTarget);
+		const uint32_t opaque = graph.AddPass("Opaque", nullptr);
+		graph.Read(opaque, depth, kRenderGraphStateDepthRead);
+		graph.Write(opaque, backBuffer, kRenderGraphStateRenderTarget);
+		// 続けて読むパスの状態はまとめて1回で遷移する
+		const uint32_t fog = graph.AddPass("Fog", nullptr);
+		graph.Read(fog, depth, kRenderGraphStateShaderResource);
+		graph.Write(fog, backBuffer, kRenderGraphStateRenderTarget);
+		graph.Compile(GetFixedAllocationInfo);
+
+		TEST_CHECK(graph.GetStats().passCount == 3);
+		TEST_CHECK(graph.GetStats().culledPassCount == 1);
+		TEST_CHECK(graph.GetHeap(unused) == kRenderGraphInvalid);
+		TEST_CHECK(graph.GetInitialState(depth) == kRenderGraphStateDepthWrite);
+
+		RecordingExecutor executor;
+		graph.Execute(executor);
+		TEST_CHECK(executor.passes == std::vector<std::string>({ "DepthPrepass", "Opaque", "Fog" }));
+		TEST_CHECK(executor.Find("Fog") == nullptr);
+
+		const std::vector<RenderGraphBarrier>* barriersOpaque = executor.Find("Opaque");
+		TEST_CHECK(barriersOpaque != nullptr && barriersOpaque->size() == 2);
+		if (barriersOpaque != nullptr) {
+			for (const RenderGraphBarrier& barrier : *barriersOpaque) {
+				if (barrier.resource == depth) {
+					TEST_CHECK(barrier.stateAfter == (kRenderGraphStateDepthRead | kRenderGraphStateShaderResource));
+				} else {
+					TEST_CHECK(barrier.resource == backBuffer && barrier.stateAfter == kRenderGraphStateRenderTarget);
+				}
+			}
+		}
+
+		// 最後にバックバッファを戻し、深度は最初の状態へ戻す
+		TEST_CHECK(!executor.batches.empty() && executor.batches.back().pass.empty());
+		if (!executor.batches.empty()) {
+			const std::vector<RenderGraphBarrier>& finalBarriers = executor.batches.back().barriers;
+			TEST_CHECK(CountBarriers(finalBarriers, RenderGraphBarrier::Type::Transition, backBuffer) == 1);
+			TEST_CHECK(CountBarriers(finalBarriers, RenderGraphBarrier::Type::Transition, depth) == 1);
+		}
+		TEST_CHECK(graph.GetStats().barrierBatchCount == uint32_t(executor.batches.size()));
+
+		// Resetの後は前の宣言が残らない
+		graph.Reset();
+		graph.Compile(GetFixedAllocationInfo);
+		TEST_CHECK(graph.GetStats().passCount == 0 && graph.GetStats().barrierCount == 0);
+	}
+}
+
+int main() {
+	GetFrameArena().Initialize(64 * 1024);
+	TestAliasingBarrierOnFirstUse();
+	TestTransitionsAndCulling();
+	return FinishTests("RenderGraphTest");
+}
\ No newline at end of file
@@ -0,0 +1,193 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+#include "RenderQueue.h"
+#include "TestUtil.h"
+
+namespace {
+	// 呼ばれた順に覚える。Drawの前に設定された状態がその描画のものと一致するかも確かめる
+	class RecordingExecutor : public RenderQueueExecutor {
+	public:
+		void SetPipeline(uint32_t value) override { Set(0, value); }
+		void SetMaterial(uint32_t value) override { Set(1, value); }
+		void SetTexture(uint32_t value) override { Set(2, value); }
+		void SetMesh(uint32_t value) override { Set(3, value); }
+		void SetTransform(uint32_t value) override { Set(4, value); }
+		void Draw(const DrawItem& item) override {
+			const uint32_t expected[5] = { item.pipeline, item.material, item.texture, item.mesh, item.transform };
+			for (uint32_t state = 0; state < 5; ++state) {
+				mismatchCount += !hasState[state] || current[state] != expected[state];
+			}
+			draws.push_back(item);
+		}
+
+		uint32_t setCount = 0;
+		uint32_t mismatchCount = 0;
+		std::vector<uint32_t> setsBeforeFirstDraw; //!< 最初のDrawの前に設定された状態の種類
+		std::vector<DrawItem> draws;
+
+	private:
+		void Set(uint32_t state, uint32_t value) {
+			// 同じ値を続けて設定するのは無駄な状態変更
+			mismatchCount += hasState[state] && current[state] == value;
+			current[state] = value;
+			hasState[state] = true;
+			++setCount;
+			if (draws.empty()) {
+				setsBeforeFirstDraw.push_back(state);
+			}
+		}
+
+		uint32_t current[5] = {};
+		bool hasState[5] = {};
+	};
+
+	bool IsSorted(const std::vector<SortKey::Item>& items) {
+		for (size_t index = 1; index < items.size(); ++index) {
+			if (items[index - 1].key > items[index].key) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// RadixSortの結果がstd::stable_sortと一致するか
+	bool MatchesStableSort(std::vector<SortKey::Item> items) {
+		std::vector<SortKey::Item> expected = items;
+		std::stable_sort(expected.begin(), expected.end(), [](const SortKey::Item& a, const SortKey::Item& b) { return a.key < b.key; });
+		std::vector<SortKey::Item> scratch(items.size());
+		SortKey::RadixSort(items.data(), scratch.data(), items.size());
+		for (size_t index = 0; index < items.size(); ++index) {
+			if (items[index].key != expected[index].key || items[index].index != expected[index].index) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void TestDepthOrder() {
+		const float depths[] = { -std::numeric_limits<float>::infinity(), -1e30f, -100.0f, -1.0f, -1e-30f, -0.0f, 0.0f, 1e-30f, 0.5f, 1.0f,
+			100.0f, 1e30f, std::numeric_limits<float>::infinity() };
+		const size_t depthCount = sizeof(depths) / sizeof(depths[0]);
+		for (size_t index = 1; index < depthCount; ++index) {
+			TEST_CHECK(SortKey::DepthToBits(depths[index - 1]) < SortKey::DepthToBits(depths[index]));
+		}
+
+		// 逆順に積んでも、同じpass/pipeline/materialの中では深度の小さい順に並ぶ
+		std::vector<SortKey::Item> items;
+		for (size_t index = depthCount; index-- > 0;) {
+			items.push_back({ SortKey::Make(1, 2, 3, depths[index]), uint32_t(index) });
+		}
+		std::vector<SortKey::Item> scratch(items.size());
+		SortKey::RadixSort(items.data(), scratch.data(), items.size());
+		bool ordered = true;
+		for (size_t index = 0; index < items.size(); ++index) {
+			ordered &= items[index].index == index;
+			ordered &= SortKey::GetPass(items[index].key) == 1 && SortKey::GetPipeline(items[index].key) == 2 &&
+				SortKey::GetMaterial(items[index].key) == 3;
+		}
+		TEST_CHECK(ordered);
+		// 深度より前の桁が優先される
+		TEST_CHECK(SortKey::Make(0, 1, 0, -1000.0f) > SortKey::Make(0, 0, 5, 1000.0f));
+	}
+
+	void TestStableAndSkippedDigits() {
+		// 同じキーは積んだ順のまま
+		std::vector<SortKey::Item> items;
+		for (uint32_t index = 0; index < 100; ++index) {
+			items.push_back({ SortKey::Make(0, index % 3, 0, 1.0f), index });
+		}
+		TEST_CHECK(MatchesStableSort(items));
+
+		std::mt19937 random(12345);
+		// 違いが1桁だけ(7桁を飛ばす)、2桁だけ、深度だけ、全桁ばらばら。飛ばす桁の数で結果がscratch側に残る場合も通る
+		const uint64_t masks[] = { 0xFF, 0xFF00FF00000000ull, 0xFFFFFFFFull, ~0ull };
+		for (uint64_t mask : masks) {
+			for (size_t count : { size_t(0), size_t(1), size_t(2), size_t(7), size_t(1000) }) {
+				items.clear();
+				const uint64_t base = 0x1234567890ABCDEFull & ~mask;
+				for (size_t index = 0; index < count; ++index) {
+					// 同じキーが出やすいように値の幅を狭める
+					const uint64_t noise = (uint64_t(random()) << 32 | random()) & mask & 0x0303030303030303ull;
+					items.push_back({ base | noise, uint32_t(index) });
+				}
+				TEST_CHECK(MatchesStableSort(items));
+			}
+		}
+		// 全て同じキーなら全桁を飛ばし、並びを変えない
+		items.assign(50, { SortKey::Make(3, 4, 5, 6.0f), 0 });
+		for (uint32_t index = 0; index < items.size(); ++index) {
+			items[index].index = index;
+		}
+		TEST_CHECK(MatchesStableSort(items));
+		std::vector<SortKey::Item> scratch(items.size());
+		SortKey::RadixSort(items.data(), scratch.data(), items.size());
+		TEST_CHECK(IsSorted(items));
+	}
+
+	DrawItem MakeDrawItem(uint32_t index) {
+		DrawItem item{};
+		item.pipeline = index % 2;
+		item.material = (index / 2) % 3;
+		item.texture = (index / 6) % 2;
+		item.mesh = index % 5 == 0 ? 1 : 0;
+		item.transform = index;
+		item.instanceCount = 1;
+		item.sortKey = SortKey::Make(0, item.pipeline, item.material, float(index % 4));
+		return item;
+	}
+
+	void TestStateChanges() {
+		RenderQueue queue;
+		const uint32_t kItemCount = 60;
+		for (uint32_t index = 0; index < kItemCount; ++index) {
+			queue.Push(MakeDrawItem(index));
+		}
+		RecordingExecutor executor;
+		queue.Execute(executor);
+		RenderQueueStats stats = queue.GetStats();
+		TEST_CHECK(stats.drawCount == kItemCount && executor.draws.size() == kItemCount);
+		TEST_CHECK(executor.mismatchCount == 0);
+		TEST_CHECK(stats.stateChangeCount == executor.setCount);
+		TEST_CHECK(stats.stateChangeCount + stats.elidedStateChangeCount == kItemCount * 5);
+		bool sorted = true;
+		for (size_t index = 1; index < executor.draws.size(); ++index) {
+			sorted &= executor.draws[index - 1].sortKey <= executor.draws[index].sortKey;
+		}
+		TEST_CHECK(sorted);
+		// pipelineは2回だけ変わる
+		TEST_CHECK(stats.elidedStateChangeCount >= kItemCount - 2);
+
+		// 範囲に分けると、各範囲の最初で全ての状態を設定し直す
+		queue.Sort();
+		RecordingExecutor first;
+		RecordingExecutor second;
+		const uint32_t middle = 31;
+		queue.ExecuteRange(first, 0, middle);
+		queue.ExecuteRange(second, middle, kItemCount);
+		stats = queue.GetStats();
+		TEST_CHECK(first.mismatchCount == 0 && second.mismatchCount == 0);
+		TEST_CHECK(second.setsBeforeFirstDraw.size() == 5);
+		TEST_CHECK(stats.drawCount == kItemCount);
+		TEST_CHECK(stats.stateChangeCount == first.setCount + second.setCount);
+		TEST_CHECK(stats.stateChangeCount + stats.elidedStateChangeCount == kItemCount * 5);
+		// 分けた分だけ省ける状態変更は減る
+		TEST_CHECK(stats.stateChangeCount > executor.setCount);
+		TEST_CHECK(stats.stateChangeCount <= executor.setCount + 5);
+
+		// Clearの後は空
+		queue.Clear();
+		RecordingExecutor empty;
+		queue.Execute(empty);
+		TEST_CHECK(queue.GetStats().drawCount == 0 && empty.setCount == 0);
+	}
+}
+
+int main() {
+	TestDepthOrder();
+	TestStableAndSkippedDigits();
+	TestStateChanges();
+	return FinishTests("RenderQueueTest");
+}
\ No newline at end of file
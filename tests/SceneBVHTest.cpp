@@ -0,0 +1,160 @@
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+#include "SceneBVH.h"
+#include "TestUtil.h"
+
+namespace {
+	// -size〜sizeの立方体を内側から囲む視錐台
+	Frustum MakeBoxFrustum(float size) {
+		Frustum frustum{};
+		const Vector3 normals[6] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+		for (int index = 0; index < 6; ++index) {
+			frustum.planes[index] = { normals[index], size };
+		}
+		return frustum;
+	}
+
+	bool Overlaps(const AABB& a, const AABB& b) {
+		return a.min.x <= b.max.x && b.min.x <= a.max.x && a.min.y <= b.max.y && b.min.y <= a.max.y && a.min.z <= b.max.z && b.min.z <= a.max.z;
+	}
+
+	// 総当たりで、視錐台、AABB、半直線の結果がBVHと一致するか確かめる
+	void CheckQueries(const SceneBVH& bvh, const std::vector<uint32_t>& objects, const Frustum& frustum, const AABB& query) {
+		std::vector<uint32_t> visible;
+		bvh.QueryFrustum(frustum, visible);
+		std::sort(visible.begin(), visible.end());
+		std::vector<uint32_t> expected;
+		for (uint32_t object : objects) {
+			if (TestFrustumAABB(frustum, bvh.GetObjectBounds(object))) {
+				expected.push_back(object);
+			}
+		}
+		std::sort(expected.begin(), expected.end());
+		TEST_CHECK(visible == expected);
+
+		std::vector<uint32_t> overlapping;
+		bvh.QueryOverlap(query, overlapping);
+		std::sort(overlapping.begin(), overlapping.end());
+		expected.clear();
+		for (uint32_t object : objects) {
+			if (Overlaps(bvh.GetObjectBounds(object), query)) {
+				expected.push_back(object);
+			}
+		}
+		std::sort(expected.begin(), expected.end());
+		TEST_CHECK(overlapping == expected);
+	}
+
+	void TestMatchesBruteForce() {
+		std::mt19937 random(12345);
+		std::uniform_real_distribution<float> position(-50.0f, 50.0f);
+		std::uniform_real_distribution<float> size(0.1f, 3.0f);
+		SceneBVH bvh;
+		std::vector<uint32_t> objects;
+		for (int index = 0; index < 3000; ++index) {
+			const Vector3 min{ position(random), position(random), position(random) };
+			objects.push_back(bvh.AddObject({ min, { min.x + size(random), min.y + size(random), min.z + size(random) } }));
+		}
+		bvh.Update();
+		const SceneBVHStats& stats = bvh.GetStats();
+		TEST_CHECK(stats.objectCount == 3000 && stats.buildCount == 1);
+		TEST_CHECK(stats.depth > 1 && stats.nodeCount > 1);
+		CheckQueries(bvh, objects, MakeBoxFrustum(20.0f), { { -5.0f, -5.0f, -5.0f }, { 10.0f, 5.0f, 5.0f } });
+
+		// 半直線は一番手前のものを返す
+		const Ray ray{ { -100.0f, 0.5f, 0.5f }, { 1.0f, 0.0f, 0.0f } };
+		RayHit hit{};
+		const bool found = bvh.RayCast(ray, 1000.0f, hit);
+		float nearest = 1000.0f;
+		for (uint32_t object : objects) {
+			const AABB& bounds = bvh.GetObjectBounds(object);
+			if (bounds.min.y <= 0.5f && 0.5f <= bounds.max.y && bounds.min.z <= 0.5f && 0.5f <= bounds.max.z) {
+				nearest = (std::min)(nearest, bounds.min.x + 100.0f);
+			}
+		}
+		TEST_CHECK(found == (nearest < 1000.0f));
+		TEST_CHECK(!found || std::fabs(hit.distance - nearest) < 1e-3f);
+		TEST_CHECK(!bvh.RayCast(ray, 1.0f, hit));
+
+		// ベンチマークも総当たりと比べている
+		const SceneBVHBenchmark benchmark = MeasureSceneBVH(MakeBoxFrustum(30.0f), { 0.0f, 0.0f, 0.0f }, 2000, 1);
+		TEST_CHECK(benchmark.mismatchCount == 0);
+	}
+
+	void TestRefitAndRebuild() {
+		SceneBVH bvh;
+		std::vector<uint32_t> objects;
+		for (int index = 0; index < 100; ++index) {
+			const float x = float(index) * 2.0f;
+			objects.push_back(bvh.AddObject({ { x, 0.0f, 0.0f }, { x + 1.0f, 1.0f, 1.0f } }));
+		}
+		bvh.Update();
+		TEST_CHECK(bvh.GetStats().buildCount == 1);
+
+		// 境界が変わっただけならrefitする
+		bvh.UpdateObject(objects[10], { { 500.0f, 0.0f, 0.0f }, { 501.0f, 1.0f, 1.0f } });
+		bvh.Update();
+		TEST_CHECK(bvh.GetStats().refitCount == 1);
+		const AABB query{ { 499.0f, -1.0f, -1.0f }, { 502.0f, 2.0f, 2.0f } };
+		std::vector<uint32_t> found;
+		bvh.QueryOverlap(query, found);
+		TEST_CHECK(found.size() == 1 && found[0] == objects[10]);
+		CheckQueries(bvh, objects, MakeBoxFrustum(50.0f), query);
+
+		// 削除すれば作り直し、消したものは返らない
+		bvh.RemoveObject(objects[10]);
+		objects.erase(objects.begin() + 10);
+		bvh.Update();
+		TEST_CHECK(bvh.GetStats().buildCount == 2);
+		bvh.QueryOverlap(query, found);
+		TEST_CHECK(found.empty());
+		CheckQueries(bvh, objects, MakeBoxFrustum(50.0f), { { 0.0f, 0.0f, 0.0f }, { 30.0f, 1.0f, 1.0f } });
+
+		// refitが続いたら作り直す
+		bvh.SetRebuildPolicy(1000.0f, 3);
+		for (int frame = 1; frame <= 3; ++frame) {
+			bvh.UpdateObject(objects[0], { { float(frame), 0.0f, 0.0f }, { float(frame) + 1.0f, 1.0f, 1.0f } });
+			bvh.Update();
+		}
+		TEST_CHECK(bvh.GetStats().buildCount == 3);
+	}
+
+	void TestSkewedTree() {
+		// 中心が軸ごとに17倍ずつ離れていると、SAHのビンでは毎回1つずつしか切り離せず深い木になる
+		SceneBVH bvh;
+		std::vector<uint32_t> objects;
+		float coordinate = 1.0f;
+		for (int index = 0; index < 14; ++index) {
+			coordinate *= 17.0f;
+			for (int axis = 0; axis < 3; ++axis) {
+				Vector3 center{ 0.0f, 0.0f, 0.0f };
+				(axis == 0 ? center.x : axis == 1 ? center.y : center.z) = coordinate;
+				const float half = coordinate * 0.1f;
+				objects.push_back(bvh.AddObject({ { center.x - half, center.y - half, center.z - half }, { center.x + half, center.y + half, center.z + half } }));
+			}
+		}
+		bvh.Update();
+		const SceneBVHStats& stats = bvh.GetStats();
+		// 釣り合った4分木なら3段で足りる
+		TEST_CHECK(stats.depth > 10);
+		const float far = coordinate * 2.0f;
+		CheckQueries(bvh, objects, MakeBoxFrustum(far), { { -far, -far, -far }, { far, far, far } });
+		std::vector<uint32_t> visible;
+		bvh.QueryFrustum(MakeBoxFrustum(far), visible);
+		TEST_CHECK(visible.size() == objects.size());
+		// 一番深いところにあるものも半直線で見つかる
+		RayHit hit{};
+		TEST_CHECK(bvh.RayCast({ { far, 0.0f, 0.0f }, { -1.0f, 0.0f, 0.0f } }, far, hit));
+		TEST_CHECK(hit.object == objects[objects.size() - 3]);
+		TEST_CHECK(std::fabs(hit.distance - coordinate * 0.9f) < coordinate * 1e-5f);
+	}
+}
+
+int main() {
+	TestMatchesBruteForce();
+	TestRefitAndRebuild();
+	TestSkewedTree();
+	return FinishTests("SceneBVHTest");
+}
\ No newline at end of file
@@ -0,0 +1,138 @@
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include "ShaderCache.h"
+#include "TestUtil.h"
+
+namespace {
+	// ソースとDXILをメモリ上に持つ
+	class MemoryShaderCacheStorage : public ShaderCacheStorage {
+	public:
+		bool ReadSource(const std::wstring& filePath, std::string& source) override {
+			auto it = sources.find(std::filesystem::path(filePath).lexically_normal().wstring());
+			if (it == sources.end()) {
+				return false;
+			}
+			source = it->second;
+			return true;
+		}
+		bool Load(uint64_t key, std::vector<uint8_t>& blob) override {
+			auto it = blobs.find(key);
+			if (it == blobs.end()) {
+				return false;
+			}
+			blob = it->second;
+			return true;
+		}
+		void Store(uint64_t key, const void* blob, size_t size) override {
+			const uint8_t* bytes = static_cast<const uint8_t*>(blob);
+			blobs[key].assign(bytes, bytes + size);
+		}
+
+		std::map<std::wstring, std::string> sources;
+		std::map<uint64_t, std::vector<uint8_t>> blobs;
+	};
+
+	std::wstring MakePath(const char* path) {
+		return std::filesystem::path(path).lexically_normal().wstring();
+	}
+
+	void TestFindIncludes() {
+		const std::string source =
+			"#include \"a.hlsli\"\n"
+			"  # include \"b.hlsli\"\r\n"
+			"#\tinclude <c.hlsli>\n"
+			"#include<d.hlsli>\n"
+			"// #include \"comment.hlsli\" は行頭でないので読まない\n"
+			"#define INCLUDE \"x.hlsli\"\n"
+			"#includes \"e.hlsli\"\n"
+			"#include \"unterminated.hlsli\n"
+			"float4 main() : SV_TARGET { return 0; }";
+		const std::vector<std::string> includes = FindShaderIncludes(source);
+		TEST_CHECK(includes.size() == 4);
+		TEST_CHECK(includes.size() == 4 && includes[0] == "a.hlsli");
+		TEST_CHECK(includes.size() == 4 && includes[1] == "b.hlsli");
+		TEST_CHECK(includes.size() == 4 && includes[2] == "c.hlsli");
+		TEST_CHECK(includes.size() == 4 && includes[3] == "d.hlsli");
+	}
+
+	void TestKeyFollowsIncludes() {
+		MemoryShaderCacheStorage storage;
+		storage.sources[MakePath("shaders/main.hlsl")] = "#include \"common.hlsli\"\n# include <lib/light.hlsli>\n";
+		storage.sources[MakePath("shaders/common.hlsli")] = "#include \"main.hlsl\"\nfloat a;\n";
+		storage.sources[MakePath("shaders/lib/light.hlsli")] = "float b;\n";
+		ShaderCache cache;
+		cache.Initialize(&storage, 1);
+		const wchar_t* arguments[] = { L"-O3" };
+		const std::wstring mainPath = MakePath("shaders/main.hlsl");
+		const uint64_t key = cache.ComputeKey(mainPath, L"ps_6_0", L"main", arguments, 1);
+		TEST_CHECK(key == cache.ComputeKey(mainPath, L"ps_6_0", L"main", arguments, 1));
+		TEST_CHECK(key != cache.ComputeKey(mainPath, L"vs_6_0", L"main", arguments, 1));
+		TEST_CHECK(key != cache.ComputeKey(mainPath, L"ps_6_0", L"main", nullptr, 0));
+
+		// <...>と"# include"で辿ったファイルが変わってもキーが変わる
+		storage.sources[MakePath("shaders/lib/light.hlsli")] = "float c;\n";
+		const uint64_t changedKey = cache.ComputeKey(mainPath, L"ps_6_0", L"main", arguments, 1);
+		TEST_CHECK(key != changedKey);
+
+		const std::vector<std::wstring> files = cache.CollectSourceFiles(mainPath);
+		TEST_CHECK(files.size() == 3);
+
+		// saltが変われば全て作り直す
+		ShaderCache otherCache;
+		otherCache.Initialize(&storage, 2);
+		TEST_CHECK(otherCache.ComputeKey(mainPath, L"ps_6_0", L"main", arguments, 1) != changedKey);
+
+		std::vector<uint8_t> blob;
+		TEST_CHECK(!cache.Load(changedKey, blob));
+		const uint8_t dxil[] = { 1, 2, 3 };
+		cache.Store(changedKey, dxil, sizeof(dxil));
+		TEST_CHECK(cache.Load(changedKey, blob) && blob.size() == 3);
+		TEST_CHECK(cache.GetHitCount() == 1 && cache.GetMissCount() == 1);
+	}
+
+	void TestFileStorage() {
+		const std::filesystem::path directory = std::filesystem::temp_directory_path() / "ShaderCacheTest";
+		std::filesystem::remove_all(directory);
+		FileShaderCacheStorage storage(directory.wstring());
+		std::vector<uint8_t> dxil(1000);
+		for (size_t index = 0; index < dxil.size(); ++index) {
+			dxil[index] = uint8_t(index * 7);
+		}
+		const uint64_t key = 0x1234;
+		storage.Store(key, dxil.data(), dxil.size());
+		std::vector<uint8_t> blob;
+		TEST_CHECK(storage.Load(key, blob) && blob == dxil);
+		TEST_CHECK(!storage.Load(key + 1, blob));
+
+		// 本体の1バイトが変わったら読まない
+		const std::filesystem::path path = directory / "0000000000001234.dxil";
+		TEST_CHECK(std::filesystem::exists(path));
+		{
+			std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+			file.seekp(-10, std::ios::end);
+			file.put(char(0xFF));
+		}
+		TEST_CHECK(!storage.Load(key, blob));
+		// 途中で切れていても読まない
+		storage.Store(key, dxil.data(), dxil.size());
+		std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+		TEST_CHECK(!storage.Load(key, blob));
+
+		// 置き換えに失敗したときは一時ファイルを残さない
+		const uint64_t blockedKey = 0x5678;
+		const std::filesystem::path blockedPath = directory / "0000000000005678.dxil";
+		std::filesystem::create_directories(blockedPath / "child");
+		storage.Store(blockedKey, dxil.data(), dxil.size());
+		TEST_CHECK(!std::filesystem::exists(directory / "0000000000005678.dxil.tmp"));
+		TEST_CHECK(!std::filesystem::exists(directory / "0000000000001234.dxil.tmp"));
+		std::filesystem::remove_all(directory);
+	}
+}
+
+int main() {
+	TestFindIncludes();
+	TestKeyFollowsIncludes();
+	TestFileStorage();
+	return FinishTests("ShaderCacheTest");
+}
\ No newline at end of file
@@ -0,0 +1,180 @@
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include "FileWatcher.h"
+#include "ShaderCache.h"
+#include "ShaderDependencyGraph.h"
+#include "TestUtil.h"
+
+namespace {
+	// 更新時刻をテストから書き換える
+	struct FakeFileTimes {
+		std::map<std::wstring, int64_t> times;
+
+		FileWatcher::TimeFunction GetFunction() {
+			return [this](const std::wstring& path) -> int64_t {
+				auto it = times.find(path);
+				return it != times.end() ? it->second : -1;
+			};
+		}
+	};
+
+	// ソースだけをメモリ上に持つ
+	class MemorySourceStorage : public ShaderCacheStorage {
+	public:
+		bool ReadSource(const std::wstring& filePath, std::string& source) override {
+			auto it = sources.find(std::filesystem::path(filePath).lexically_normal().wstring());
+			if (it == sources.end()) {
+				return false;
+			}
+			source = it->second;
+			return true;
+		}
+		bool Load(uint64_t, std::vector<uint8_t>&) override { return false; }
+		void Store(uint64_t, const void*, size_t) override {}
+
+		std::map<std::wstring, std::string> sources;
+	};
+
+	std::wstring MakePath(const char* path) {
+		return std::filesystem::path(path).lexically_normal().wstring();
+	}
+
+	bool Contains(const std::vector<std::wstring>& files, const std::wstring& file) {
+		return std::find(files.begin(), files.end(), file) != files.end();
+	}
+
+	void TestFileWatcher() {
+		FakeFileTimes fake;
+		fake.times[L"a.hlsl"] = 10;
+		fake.times[L"b.hlsli"] = 20;
+		FileWatcher watcher(fake.GetFunction());
+		watcher.Watch(L"a.hlsl");
+		watcher.Watch(L"b.hlsli");
+		// 2回目のWatchで時刻を取り直さない。その間の変更を見逃さないため
+		fake.times[L"a.hlsl"] = 11;
+		watcher.Watch(L"a.hlsl");
+		TEST_CHECK(watcher.IsWatching(L"a.hlsl") && !watcher.IsWatching(L"c.hlsli"));
+
+		std::vector<std::wstring> changed = watcher.Poll();
+		TEST_CHECK(changed.size() == 1 && changed[0] == L"a.hlsl");
+		// 変わっていなければ何も返さない
+		TEST_CHECK(watcher.Poll().empty());
+
+		// 時刻が戻っても変更として扱う(元に戻したファイルなど)
+		fake.times[L"b.hlsli"] = 5;
+		changed = watcher.Poll();
+		TEST_CHECK(changed.size() == 1 && changed[0] == L"b.hlsli");
+
+		// 消えたら1回だけ返し、作り直されたらもう一度返す
+		fake.times.erase(L"b.hlsli");
+		TEST_CHECK(watcher.Poll().size() == 1);
+		TEST_CHECK(watcher.Poll().empty());
+		fake.times[L"b.hlsli"] = 30;
+		TEST_CHECK(watcher.Poll().size() == 1);
+
+		// 監視を始めた時点で無いファイルも、できたら返す
+		watcher.Watch(L"c.hlsli");
+		fake.times[L"c.hlsli"] = 40;
+		changed = watcher.Poll();
+		TEST_CHECK(changed.size() == 1 && changed[0] == L"c.hlsli");
+	}
+
+	void TestFileWatcherOnDisk() {
+		const std::filesystem::path directory = std::filesystem::temp_directory_path() / "ShaderHotReloadTest";
+		std::filesystem::remove_all(directory);
+		std::filesystem::create_directories(directory);
+		const std::filesystem::path path = directory / "Object3d.PS.hlsl";
+		std::ofstream(path) << "float4 main() : SV_TARGET { return 0; }\n";
+
+		FileWatcher watcher;
+		watcher.Watch(path.wstring());
+		TEST_CHECK(watcher.Poll().empty());
+		// 書き込みの間隔によっては時刻が変わらないので、時刻を直接進める
+		std::filesystem::last_write_time(path, std::filesystem::last_write_time(path) + std::chrono::seconds(2));
+		const std::vector<std::wstring> changed = watcher.Poll();
+		TEST_CHECK(changed.size() == 1 && changed[0] == path.wstring());
+		std::filesystem::remove(path);
+		TEST_CHECK(watcher.Poll().size() == 1);
+		std::filesystem::remove_all(directory);
+	}
+
+	void TestDependencyGraph() {
+		ShaderDependencyGraph graph;
+		graph.SetDependencies(2, { L"b.hlsl", L"common.hlsli" });
+		graph.SetDependencies(0, { L"a.hlsl", L"common.hlsli", L"light.hlsli" });
+		graph.SetDependencies(1, { L"a.hlsl" });
+
+		// 番号順で、同じシェーダーは1回だけ
+		std::vector<uint32_t> shaders = graph.GetDependentShaders({ L"common.hlsli", L"a.hlsl" });
+		TEST_CHECK(shaders == std::vector<uint32_t>({ 0, 1, 2 }));
+		shaders = graph.GetDependentShaders({ L"light.hlsli" });
+		TEST_CHECK(shaders == std::vector<uint32_t>({ 0 }));
+		TEST_CHECK(graph.GetDependentShaders({ L"unknown.hlsli" }).empty());
+
+		// includeが外れたら、そのファイルが変わってもコンパイルし直さない
+		graph.SetDependencies(0, { L"a.hlsl", L"shadow.hlsli" });
+		TEST_CHECK(graph.GetDependentShaders({ L"light.hlsli" }).empty());
+		TEST_CHECK(graph.GetDependentShaders({ L"shadow.hlsli" }) == std::vector<uint32_t>({ 0 }));
+		TEST_CHECK(graph.GetDependentShaders({ L"common.hlsli" }) == std::vector<uint32_t>({ 2 }));
+		TEST_CHECK(graph.GetDependencies(0).size() == 2);
+		TEST_CHECK(graph.GetDependencies(5).empty());
+	}
+
+	void TestIncludeChangeFollowsDependencies() {
+		// ShaderHotReloadがAddShaderとコンパイルし直した後に行う、監視対象と依存の更新を同じ手順でなぞる
+		MemorySourceStorage storage;
+		const std::wstring pixelShader = MakePath("shaders/Object3d.PS.hlsl");
+		const std::wstring vertexShader = MakePath("shaders/Object3d.VS.hlsl");
+		const std::wstring common = MakePath("shaders/Object3d.hlsli");
+		const std::wstring light = MakePath("shaders/Light.hlsli");
+		storage.sources[pixelShader] = "#include \"Object3d.hlsli\"\n";
+		storage.sources[vertexShader] = "#include \"Object3d.hlsli\"\n";
+		storage.sources[common] = "float a;\n";
+		storage.sources[light] = "float b;\n";
+		ShaderCache cache;
+		cache.Initialize(&storage, 1);
+
+		FakeFileTimes fake;
+		for (auto& [path, source] : storage.sources) {
+			fake.times[path] = 1;
+		}
+		FileWatcher watcher(fake.GetFunction());
+		ShaderDependencyGraph graph;
+		auto addShader = [&](uint32_t shader, const std::wstring& filePath) {
+			const std::vector<std::wstring> files = cache.CollectSourceFiles(filePath);
+			for (const std::wstring& file : files) {
+				watcher.Watch(file);
+			}
+			graph.SetDependencies(shader, files);
+		};
+		addShader(0, vertexShader);
+		addShader(1, pixelShader);
+		TEST_CHECK(watcher.IsWatching(common) && !watcher.IsWatching(light));
+
+		// 共通のincludeが変われば両方
+		fake.times[common] = 2;
+		TEST_CHECK(graph.GetDependentShaders(watcher.Poll()) == std::vector<uint32_t>({ 0, 1 }));
+
+		// PSが新しいincludeを読むようになったら、コンパイルし直した後に監視が増える
+		storage.sources[pixelShader] = "#include \"Object3d.hlsli\"\n#include \"Light.hlsli\"\n";
+		fake.times[pixelShader] = 2;
+		const std::vector<uint32_t> changed = graph.GetDependentShaders(watcher.Poll());
+		TEST_CHECK(changed == std::vector<uint32_t>({ 1 }));
+		addShader(1, pixelShader);
+		TEST_CHECK(watcher.IsWatching(light));
+		TEST_CHECK(Contains(graph.GetDependencies(1), light));
+		fake.times[light] = 2;
+		TEST_CHECK(graph.GetDependentShaders(watcher.Poll()) == std::vector<uint32_t>({ 1 }));
+	}
+}
+
+int main() {
+	TestFileWatcher();
+	TestFileWatcherOnDisk();
+	TestDependencyGraph();
+	TestIncludeChangeFollowsDependencies();
+	return FinishTests("ShaderHotReloadTest");
+}
\ No newline at end of file
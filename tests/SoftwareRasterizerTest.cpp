@@ -0,0 +1,166 @@
+#include <string>
+#include <vector>
+#include "SoftwareRasterizer.h"
+#include "TestUtil.h"
+
+namespace {
+	const uint32_t kRed = 0xFF0000FF;
+	const uint32_t kGreen = 0xFF00FF00;
+	const uint32_t kBlue = 0xFFFF0000;
+	const uint32_t kBlack = 0xFF000000;
+
+	// 画面のピクセルの位置(x, y)を、単位行列で描いたときの頂点にする。法線は手前向き
+	VertexData MakeScreenVertex(uint32_t width, uint32_t height, float x, float y, float u, float v) {
+		VertexData vertex{};
+		vertex.position = { x / float(width) * 2.0f - 1.0f, 1.0f - y / float(height) * 2.0f, 0.5f, 1.0f };
+		vertex.texcoord = { u, v };
+		vertex.normal = { 0.0f, 0.0f, -1.0f };
+		return vertex;
+	}
+
+	SoftwareDrawDesc MakeDrawDesc(const VertexData* vertices, uint32_t vertexCount, const Vector4& color) {
+		SoftwareDrawDesc desc{};
+		desc.vertices = vertices;
+		desc.vertexCount = vertexCount;
+		desc.wvp = MakeIdentity4x4();
+		desc.world = MakeIdentity4x4();
+		desc.color = color;
+		desc.uvTransform = MakeIdentity4x4();
+		return desc;
+	}
+
+	// 赤、緑、青、黒をR、G、B、'.'にして1行ずつ並べる。それ以外は'?'
+	std::vector<std::string> GetImage(const SoftwareRasterizer& rasterizer) {
+		std::vector<std::string> rows;
+		for (uint32_t y = 0; y < rasterizer.GetHeight(); ++y) {
+			std::string row;
+			for (uint32_t x = 0; x < rasterizer.GetWidth(); ++x) {
+				const uint32_t pixel = rasterizer.GetPixels()[size_t(y) * rasterizer.GetRowPitch() + x];
+				row += pixel == kRed ? 'R' : pixel == kGreen ? 'G' : pixel == kBlue ? 'B' : pixel == kBlack ? '.' : '?';
+			}
+			rows.push_back(row);
+		}
+		return rows;
+	}
+
+	void TestEdgesAndFillRule() {
+		JobSystem jobSystem;
+		jobSystem.Start(2);
+		const uint32_t kWidth = 40;
+		const uint32_t kHeight = 12;
+		SoftwareRasterizer rasterizer;
+		rasterizer.Initialize(kWidth, kHeight, &jobSystem);
+		rasterizer.Clear({ 0.0f, 0.0f, 0.0f, 1.0f }, 1.0f);
+		auto vertex = [&](float x, float y) { return MakeScreenVertex(kWidth, kHeight, x, y, 0.0f, 0.0f); };
+		// 対角線がピクセルの中心を通る正方形。対角線の上のピクセルは左の辺になる右上の三角形だけが描く
+		const VertexData upperRight[3] = { vertex(2, 2), vertex(10, 2), vertex(10, 10) };
+		const VertexData lowerLeft[3] = { vertex(2, 2), vertex(10, 10), vertex(2, 10) };
+		// 辺がピクセルの中心を通る四角形。上と左の辺の上は描き、下と右の辺の上は描かない。x = 32でタイルをまたぐ
+		const VertexData rectangle[6] = {
+			vertex(30.5f, 2.5f), vertex(34.5f, 2.5f), vertex(34.5f, 6.5f),
+			vertex(30.5f, 2.5f), vertex(34.5f, 6.5f), vertex(30.5f, 6.5f),
+		};
+		// 反時計回りの裏面は描かない
+		const VertexData back[3] = { vertex(14, 2), vertex(14, 10), vertex(22, 2) };
+		rasterizer.Draw(MakeDrawDesc(upperRight, 3, { 1.0f, 0.0f, 0.0f, 1.0f }));
+		rasterizer.Draw(MakeDrawDesc(lowerLeft, 3, { 0.0f, 1.0f, 0.0f, 1.0f }));
+		rasterizer.Draw(MakeDrawDesc(rectangle, 6, { 0.0f, 0.0f, 1.0f, 1.0f }));
+		rasterizer.Draw(MakeDrawDesc(back, 3, { 1.0f, 0.0f, 0.0f, 1.0f }));
+		rasterizer.Execute();
+
+		const std::vector<std::string> expected = {
+			"........................................",
+			"........................................",
+			"..RRRRRRRR....................BBBB......",
+			"..GRRRRRRR....................BBBB......",
+			"..GGRRRRRR....................BBBB......",
+			"..GGGRRRRR....................BBBB......",
+			"..GGGGRRRR..............................",
+			"..GGGGGRRR..............................",
+			"..GGGGGGRR..............................",
+			"..GGGGGGGR..............................",
+			"........................................",
+			"........................................",
+		};
+		TEST_CHECK(GetImage(rasterizer) == expected);
+		// 辺を共有する三角形で同じピクセルを2回塗らない
+		TEST_CHECK(rasterizer.GetStats().shadedPixelCount == 64 + 16);
+		TEST_CHECK(rasterizer.GetStats().culledTriangleCount == 1);
+		jobSystem.Stop();
+	}
+
+	void TestTexturedObject3d() {
+		JobSystem jobSystem;
+		jobSystem.Start(2);
+		// 4x4のテクスチャを4x4ピクセルにちょうど貼ると、ピクセルの中心はテクセルの中心を読む
+		const uint32_t kSize = 4;
+		std::vector<uint8_t> texels(kSize * kSize * 4);
+		for (uint32_t index = 0; index < kSize * kSize; ++index) {
+			texels[index * 4 + 0] = uint8_t(index * 16);
+			texels[index * 4 + 1] = uint8_t(255 - index * 16);
+			texels[index * 4 + 2] = uint8_t((index % 2) * 255);
+			texels[index * 4 + 3] = 255;
+		}
+		SoftwareTexture texture;
+		texture.mips.push_back({ texels.data(), kSize, kSize, kSize * 4 });
+		texture.srgb = true;
+
+		SoftwareRasterizer rasterizer;
+		rasterizer.Initialize(kSize, kSize, &jobSystem);
+		auto vertex = [&](float x, float y) { return MakeScreenVertex(kSize, kSize, x, y, x / float(kSize), y / float(kSize)); };
+		const VertexData quad[6] = {
+			vertex(0, 0), vertex(4, 0), vertex(4, 4),
+			vertex(0, 0), vertex(4, 4), vertex(0, 4),
+		};
+		SoftwareDrawDesc desc = MakeDrawDesc(quad, 6, { 1.0f, 1.0f, 1.0f, 1.0f });
+		desc.texture = &texture;
+		rasterizer.Clear({ 0.0f, 0.0f, 0.0f, 1.0f }, 1.0f);
+		rasterizer.Draw(desc);
+		rasterizer.Execute();
+		// sRGBのテクスチャをリニアにして読み、sRGBに戻して書くので元の値に戻る
+		const uint32_t* expected = reinterpret_cast<const uint32_t*>(texels.data());
+		TEST_CHECK(CountDifferentPixels(rasterizer.GetPixels(), rasterizer.GetRowPitch(), expected, kSize, kSize, kSize, 1) == 0);
+
+		// uvTransformで1テクセルずらすと、右端は左端のテクセルにラップする
+		desc.uvTransform = MakeTranslateMatrix({ 0.25f, 0.0f, 0.0f });
+		rasterizer.Clear({ 0.0f, 0.0f, 0.0f, 1.0f }, 1.0f);
+		rasterizer.Draw(desc);
+		rasterizer.Execute();
+		std::vector<uint32_t> shifted(kSize * kSize);
+		for (uint32_t y = 0; y < kSize; ++y) {
+			for (uint32_t x = 0; x < kSize; ++x) {
+				shifted[y * kSize + x] = expected[y * kSize + (x + 1) % kSize];
+			}
+		}
+		TEST_CHECK(CountDifferentPixels(rasterizer.GetPixels(), rasterizer.GetRowPitch(), shifted.data(), kSize, kSize, kSize, 1) == 0);
+
+		// 光に正面を向けたhalf lambertは強さだけを掛ける。リニアの0.5はsRGBの188
+		const uint8_t white[4] = { 255, 255, 255, 255 };
+		SoftwareTexture whiteTexture;
+		whiteTexture.mips.push_back({ white, 1, 1, 4 });
+		whiteTexture.srgb = true;
+		desc.texture = &whiteTexture;
+		desc.uvTransform = MakeIdentity4x4();
+		desc.lighting = true;
+		rasterizer.SetDirectionalLight({ 1.0f, 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f, 1.0f }, 0.5f);
+		rasterizer.Clear({ 0.0f, 0.0f, 0.0f, 1.0f }, 1.0f);
+		rasterizer.Draw(desc);
+		rasterizer.Execute();
+		const std::vector<uint32_t> lit(kSize * kSize, 0x80BCBCBC);
+		TEST_CHECK(CountDifferentPixels(rasterizer.GetPixels(), rasterizer.GetRowPitch(), lit.data(), kSize, kSize, kSize, 1) == 0);
+		jobSystem.Stop();
+	}
+
+	void TestThreadCountDoesNotChangeImage() {
+		const SoftwareRasterizerBenchmark result = MeasureSoftwareRasterizer(96, 64, 4, 1);
+		TEST_CHECK(result.triangleCount > 0);
+		TEST_CHECK(result.mismatchCount == 0);
+	}
+}
+
+int main() {
+	TestEdgesAndFillRule();
+	TestTexturedObject3d();
+	TestThreadCountDoesNotChangeImage();
+	return FinishTests("SoftwareRasterizerTest");
+}
\ No newline at end of file
@@ -0,0 +1,91 @@
+#include <cmath>
+#include <vector>
+#include "SpriteQuad.h"
+#include "TestUtil.h"
+
+namespace {
+	Sprite MakeSprite(uint32_t index) {
+		Sprite sprite{};
+		sprite.x = 100.0f + float(index) * 13.0f;
+		sprite.y = 50.0f + float(index % 7) * 21.0f;
+		sprite.width = 16.0f + float(index % 5) * 4.0f;
+		sprite.height = 8.0f + float(index % 3) * 6.0f;
+		sprite.rotation = float(index) * 0.37f;
+		sprite.uvLeft = 0.0f;
+		sprite.uvTop = 0.25f;
+		sprite.uvRight = 0.5f;
+		sprite.uvBottom = 1.0f;
+		sprite.color = { 1.0f, 0.5f, 0.0f, 1.0f };
+		sprite.textureIndex = index % 3;
+		sprite.layer = index % 2;
+		return sprite;
+	}
+
+	bool NearlyEqual(float a, float b) {
+		return std::fabs(a - b) <= 1e-3f;
+	}
+
+	void TestExpandMatchesRotation() {
+		// 4枚ずつの展開と端数の展開のどちらも通るように枚数を変える
+		for (uint32_t count = 0; count <= 11; ++count) {
+			std::vector<SpriteQuad> quads;
+			std::vector<SortKey::Item> order;
+			for (uint32_t index = 0; index < count; ++index) {
+				quads.push_back(MakeSpriteQuad(MakeSprite(index)));
+				// 逆順に並べて、orderの順に書くことも確かめる
+				order.push_back({ 0, count - 1 - index });
+			}
+			std::vector<SpriteVertex> vertices(size_t(count) * 4 + 1);
+			vertices.back().color = 0xDEADBEEF;
+			ExpandSpriteQuads(quads.data(), order.data(), count, vertices.data());
+			TEST_CHECK(vertices.back().color == 0xDEADBEEF);
+
+			for (uint32_t slot = 0; slot < count; ++slot) {
+				const Sprite sprite = MakeSprite(order[slot].index);
+				const float c = std::cos(sprite.rotation);
+				const float s = std::sin(sprite.rotation);
+				// 左下, 左上, 右下, 右上
+				const float localX[4] = { -0.5f, -0.5f, 0.5f, 0.5f };
+				const float localY[4] = { 0.5f, -0.5f, 0.5f, -0.5f };
+				for (int corner = 0; corner < 4; ++corner) {
+					const float x = localX[corner] * sprite.width;
+					const float y = localY[corner] * sprite.height;
+					const SpriteVertex& vertex = vertices[slot * 4 + corner];
+					TEST_CHECK(NearlyEqual(vertex.x, sprite.x + x * c - y * s));
+					TEST_CHECK(NearlyEqual(vertex.y, sprite.y + x * s + y * c));
+					TEST_CHECK(vertex.u == (corner < 2 ? sprite.uvLeft : sprite.uvRight));
+					TEST_CHECK(vertex.v == (corner % 2 == 0 ? sprite.uvBottom : sprite.uvTop));
+					// R=255 G=128 B=0 A=255
+					TEST_CHECK(vertex.color == 0xFF0080FFu);
+				}
+			}
+		}
+	}
+
+	void TestSortKey() {
+		Sprite sprite = MakeSprite(0);
+		sprite.layer = 2;
+		sprite.textureIndex = 5;
+		TEST_CHECK(MakeSpriteSortKey(sprite) == ((uint64_t(2) << 32) | 5));
+		// layerが優先される
+		Sprite other = sprite;
+		other.layer = 1;
+		other.textureIndex = 9;
+		TEST_CHECK(MakeSpriteSortKey(other) < MakeSpriteSortKey(sprite));
+	}
+
+	void TestBenchmark() {
+		const SpriteBatchBenchmark result = MeasureSpriteBatch(1000, 2, 1);
+		TEST_CHECK(result.spriteCount == 1000);
+		TEST_CHECK(result.perSpriteDrawCallCount == 1000);
+		// 同じテクスチャの範囲ごとに1回
+		TEST_CHECK(result.batchDrawCallCount == 2);
+	}
+}
+
+int main() {
+	TestExpandMatchesRotation();
+	TestSortKey();
+	TestBenchmark();
+	return FinishTests("SpriteQuadTest");
+}
\ No newline at end of file
@@ -0,0 +1,109 @@
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "TaskGraph.h"
+#include "TestUtil.h"
+
+namespace {
+	// 起動時のシェーダーとPSOと同じ形の偽のタスクを積み、PSOが必ず両方のシェーダーの後に作られるか確かめる
+	void TestShaderPipelineGraph() {
+		JobSystem jobSystem;
+		jobSystem.Start(4);
+		const uint32_t kShaderCount = 8;
+		const uint32_t kPipelineCount = 16;
+		TaskGraph graph;
+		std::vector<std::atomic<uint32_t>> compiled(kShaderCount * 2);
+		std::vector<std::atomic<uint32_t>> created(kPipelineCount);
+		std::atomic<uint32_t> orderErrorCount{ 0 };
+		std::atomic<uint32_t> workerErrorCount{ 0 };
+		uint32_t shaderTasks[kShaderCount * 2] = {};
+		for (uint32_t shader = 0; shader < kShaderCount * 2; ++shader) {
+			shaderTasks[shader] = graph.AddTask("shader", [&, shader](uint32_t worker) {
+				if (worker >= jobSystem.GetWorkerCount()) {
+					++workerErrorCount;
+				}
+				// コンパイルの代わりに少し待つ
+				std::this_thread::sleep_for(std::chrono::microseconds(200));
+				compiled[shader].fetch_add(1);
+			});
+		}
+		for (uint32_t pipeline = 0; pipeline < kPipelineCount; ++pipeline) {
+			const uint32_t vertexShader = pipeline % kShaderCount;
+			const uint32_t pixelShader = kShaderCount + (pipeline / 2) % kShaderCount;
+			const uint32_t task = graph.AddTask("pipeline", [&, pipeline, vertexShader, pixelShader](uint32_t) {
+				if (compiled[vertexShader].load() != 1 || compiled[pixelShader].load() != 1) {
+					++orderErrorCount;
+				}
+				created[pipeline].fetch_add(1);
+			});
+			graph.AddDependency(shaderTasks[vertexShader], task);
+			graph.AddDependency(shaderTasks[pixelShader], task);
+		}
+		graph.Execute(jobSystem);
+
+		TEST_CHECK(orderErrorCount == 0);
+		TEST_CHECK(workerErrorCount == 0);
+		for (std::atomic<uint32_t>& count : compiled) {
+			TEST_CHECK(count == 1);
+		}
+		for (std::atomic<uint32_t>& count : created) {
+			TEST_CHECK(count == 1);
+		}
+		// 実行順は全タスクを1回ずつ含み、依存先より後ろにある
+		const std::vector<uint32_t>& order = graph.GetExecutionOrder();
+		TEST_CHECK(order.size() == graph.GetTaskCount());
+		std::vector<uint32_t> position(graph.GetTaskCount(), UINT32_MAX);
+		for (uint32_t index = 0; index < order.size(); ++index) {
+			TEST_CHECK(order[index] < graph.GetTaskCount() && position[order[index]] == UINT32_MAX);
+			if (order[index] < graph.GetTaskCount()) {
+				position[order[index]] = index;
+			}
+		}
+		for (uint32_t pipeline = 0; pipeline < kPipelineCount; ++pipeline) {
+			const uint32_t task = kShaderCount * 2 + pipeline;
+			TEST_CHECK(position[task] > position[shaderTasks[pipeline % kShaderCount]]);
+			TEST_CHECK(position[task] > position[shaderTasks[kShaderCount + (pipeline / 2) % kShaderCount]]);
+		}
+		// 全体の時間も測っている
+		TEST_CHECK(graph.GetTotalMilliseconds() > 0.0);
+
+		// もう一度実行しても全て1回ずつ
+		graph.Execute(jobSystem);
+		for (std::atomic<uint32_t>& count : created) {
+			TEST_CHECK(count == 2);
+		}
+		jobSystem.Stop();
+	}
+
+	void TestChainAndClear() {
+		JobSystem jobSystem;
+		jobSystem.Start(2);
+		TaskGraph graph;
+		std::vector<uint32_t> trace;
+		// 一列につなぐと積んだ順に走る
+		uint32_t previous = 0;
+		for (uint32_t index = 0; index < 10; ++index) {
+			const uint32_t task = graph.AddTask("chain", [&trace, index](uint32_t) { trace.push_back(index); });
+			if (index > 0) {
+				graph.AddDependency(previous, task);
+			}
+			previous = task;
+		}
+		graph.Execute(jobSystem);
+		TEST_CHECK(trace.size() == 10);
+		for (uint32_t index = 0; index < trace.size(); ++index) {
+			TEST_CHECK(trace[index] == index);
+		}
+		graph.Clear();
+		TEST_CHECK(graph.GetTaskCount() == 0);
+		// 空でも待たずに戻る
+		graph.Execute(jobSystem);
+		jobSystem.Stop();
+	}
+}
+
+int main() {
+	TestShaderPipelineGraph();
+	TestChainAndClear();
+	return FinishTests("TaskGraphTest");
+}
\ No newline at end of file
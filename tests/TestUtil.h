@@ -0,0 +1,27 @@
+#pragma once
+#include <cstdio>
+
+// テストで失敗した数。TEST_CHECKが増やし、FinishTestsが見る
+inline int& GetTestFailureCount() {
+	static int count = 0;
+	return count;
+}
+
+// 条件が偽なら場所を出して数える。assertと違いReleaseでも消えず、失敗しても続ける
+#define TEST_CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			std::fprintf(stderr, "%s(%d): TEST_CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+			++GetTestFailureCount(); \
+		} \
+	} while (0)
+
+// mainの最後で呼び、その戻り値をmainから返す
+inline int FinishTests(const char* name) {
+	if (GetTestFailureCount() > 0) {
+		std::fprintf(stderr, "%s: %d checks failed\n", name, GetTestFailureCount());
+		return 1;
+	}
+	std::printf("%s: all checks passed\n", name);
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,284 @@
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+#include "TestUtil.h"
+#include "Unicode.h"
+
+namespace {
+	const char16_t kReplacement = 0xFFFD;
+
+	// 比べる相手の変換。速さは考えず、全てのスカラー値を符号化した結果から並びの正しさを決める
+	// bytesに書いたバイト数を返す
+	size_t EncodeUtf8(uint32_t codePoint, uint8_t bytes[4]) {
+		if (codePoint < 0x80) {
+			bytes[0] = uint8_t(codePoint);
+			return 1;
+		}
+		if (codePoint < 0x800) {
+			bytes[0] = uint8_t(0xC0 | (codePoint >> 6));
+			bytes[1] = uint8_t(0x80 | (codePoint & 0x3F));
+			return 2;
+		}
+		if (codePoint < 0x10000) {
+			bytes[0] = uint8_t(0xE0 | (codePoint >> 12));
+			bytes[1] = uint8_t(0x80 | ((codePoint >> 6) & 0x3F));
+			bytes[2] = uint8_t(0x80 | (codePoint & 0x3F));
+			return 3;
+		}
+		bytes[0] = uint8_t(0xF0 | (codePoint >> 18));
+		bytes[1] = uint8_t(0x80 | ((codePoint >> 12) & 0x3F));
+		bytes[2] = uint8_t(0x80 | ((codePoint >> 6) & 0x3F));
+		bytes[3] = uint8_t(0x80 | (codePoint & 0x3F));
+		return 4;
+	}
+
+	std::string EncodeUtf8(uint32_t codePoint) {
+		uint8_t bytes[4];
+		return std::string(reinterpret_cast<const char*>(bytes), EncodeUtf8(codePoint, bytes));
+	}
+
+	bool IsScalarValue(uint32_t codePoint) {
+		return codePoint < 0xD800 || (codePoint >= 0xE000 && codePoint <= 0x10FFFF);
+	}
+
+	// 上位32ビットが長さ、下位32ビットがバイトを前から詰めたもの
+	uint64_t MakeSequenceKey(const uint8_t* bytes, size_t length) {
+		uint64_t key = uint64_t(length) << 32;
+		for (size_t index = 0; index < length; ++index) {
+			key |= uint64_t(bytes[index]) << (24 - 8 * index);
+		}
+		return key;
+	}
+
+	class ReferenceUtf8Decoder {
+	public:
+		ReferenceUtf8Decoder() {
+			for (uint32_t codePoint = 0; codePoint <= 0x10FFFF; ++codePoint) {
+				if (!IsScalarValue(codePoint)) {
+					continue;
+				}
+				uint8_t bytes[4];
+				const size_t byteCount = EncodeUtf8(codePoint, bytes);
+				// UTF-8はスカラー値の順に並ぶので、長さごとに直前と違うものだけ足せば並べ替えなくてよい
+				for (size_t length = 1; length < byteCount; ++length) {
+					const uint64_t prefix = MakeSequenceKey(bytes, length);
+					if (prefixes_[length].empty() || prefixes_[length].back() != prefix) {
+						prefixes_[length].push_back(prefix);
+					}
+				}
+				sequences_.push_back({ MakeSequenceKey(bytes, byteCount), codePoint });
+			}
+		}
+
+		// 正しい並びの先頭の一部として一番長いもの(最大部分)ごとにU+FFFDを1つ出す
+		std::u16string Decode(const std::string& source) const {
+			const uint8_t* data = reinterpret_cast<const uint8_t*>(source.data());
+			std::u16string result;
+			size_t position = 0;
+			while (position < source.size()) {
+				uint32_t codePoint = kReplacement;
+				size_t consumed = 1;
+				for (size_t length = 1; length <= 4 && position + length <= source.size(); ++length) {
+					const uint64_t key = MakeSequenceKey(data + position, length);
+					const auto sequence = std::lower_bound(sequences_.begin(), sequences_.end(), std::pair<uint64_t, uint32_t>(key, 0));
+					if (sequence != sequences_.end() && sequence->first == key) {
+						codePoint = sequence->second;
+						consumed = length;
+						break;
+					}
+					if (length == 4 || !std::binary_search(prefixes_[length].begin(), prefixes_[length].end(), key)) {
+						break;
+					}
+					consumed = length;
+				}
+				if (codePoint >= 0x10000) {
+					result += char16_t(0xD800 + ((codePoint - 0x10000) >> 10));
+					result += char16_t(0xDC00 + (codePoint & 0x3FF));
+				} else {
+					result += char16_t(codePoint);
+				}
+				position += consumed;
+			}
+			return result;
+		}
+
+	private:
+		std::vector<uint64_t> prefixes_[4]; //!< 正しい並びの途中までの全て。長さごとに分ける
+		std::vector<std::pair<uint64_t, uint32_t>> sequences_; //!< 正しい並びとそのスカラー値
+	};
+
+	// 対になっていないサロゲートはそれぞれU+FFFDにする
+	std::string ReferenceEncodeUtf16(const std::u16string& source) {
+		std::string result;
+		for (size_t index = 0; index < source.size(); ++index) {
+			uint32_t codePoint = source[index];
+			const bool high = codePoint >= 0xD800 && codePoint < 0xDC00;
+			const bool low = codePoint >= 0xDC00 && codePoint < 0xE000;
+			if (high && index + 1 < source.size() && source[index + 1] >= 0xDC00 && source[index + 1] < 0xE000) {
+				codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (source[index + 1] - 0xDC00);
+				++index;
+			} else if (high || low) {
+				codePoint = kReplacement;
+			}
+			result += EncodeUtf8(codePoint);
+		}
+		return result;
+	}
+
+	Utf16StringView ToView(const std::u16string& text) {
+		return Utf16StringView(reinterpret_cast<const Utf16Char*>(text.data()), text.size());
+	}
+
+	std::u16string ConvertToUtf16(const std::string& source, size_t capacity) {
+		std::u16string result(capacity, u'\0');
+		result.resize(ConvertUtf8ToUtf16(source, reinterpret_cast<Utf16Char*>(result.data()), capacity));
+		return result;
+	}
+
+	std::string ConvertToUtf8(const std::u16string& source, size_t capacity) {
+		std::string result(capacity, '\0');
+		result.resize(ConvertUtf16ToUtf8(ToView(source), result.data(), capacity));
+		return result;
+	}
+
+	void TestEveryScalarValueRoundTrips() {
+		uint32_t failureCount = 0;
+		for (uint32_t codePoint = 0; codePoint <= 0x10FFFF; ++codePoint) {
+			if (!IsScalarValue(codePoint)) {
+				continue;
+			}
+			std::u16string text;
+			if (codePoint >= 0x10000) {
+				text = { char16_t(0xD800 + ((codePoint - 0x10000) >> 10)), char16_t(0xDC00 + (codePoint & 0x3FF)) };
+			} else {
+				text = { char16_t(codePoint) };
+			}
+			const std::string bytes = EncodeUtf8(codePoint);
+			if (ConvertToUtf8(text, 4) != bytes || ConvertToUtf16(bytes, 2) != text ||
+				GetUtf8Length(ToView(text)) != bytes.size() || GetUtf16Length(bytes) != text.size()) {
+				++failureCount;
+			}
+		}
+		TEST_CHECK(failureCount == 0);
+	}
+
+	void TestMaximalSubparts() {
+		// Unicodeの規格の表3-8の例。最大部分ごとにU+FFFDになる
+		const std::string bytes = "\x61\xF1\x80\x80\xE1\x80\xC2\x62\x80\x63\x80\xBF\x64";
+		const std::u16string expected = u"\x0061\xFFFD\xFFFD\xFFFD\x0062\xFFFD\x0063\xFFFD\xFFFD\x0064";
+		TEST_CHECK(ConvertToUtf16(bytes, 64) == expected);
+		// 長すぎる表現、サロゲート、U+10FFFFを超えるものは1バイトずつ
+		TEST_CHECK(ConvertToUtf16("\xC0\xAF", 64) == u"\xFFFD\xFFFD");
+		TEST_CHECK(ConvertToUtf16("\xE0\x80\xAF", 64) == u"\xFFFD\xFFFD\xFFFD");
+		TEST_CHECK(ConvertToUtf16("\xED\xA0\x80", 64) == u"\xFFFD\xFFFD\xFFFD");
+		TEST_CHECK(ConvertToUtf16("\xF4\x90\x80\x80", 64) == u"\xFFFD\xFFFD\xFFFD\xFFFD");
+		// 途中で切れたものは1つ
+		TEST_CHECK(ConvertToUtf16("\xF0\x9F\x98", 64) == u"\xFFFD");
+		// 対になっていないサロゲート
+		TEST_CHECK(ConvertToUtf8(u"a\xD800" u"b\xDC00\xDBFF", 64) == "a\xEF\xBF\xBD" "b\xEF\xBF\xBD\xEF\xBF\xBD");
+	}
+
+	void TestRandomUtf8AgainstReference() {
+		const ReferenceUtf8Decoder reference;
+		// 不正な並びになりやすいバイトを多めに選ぶ
+		const uint8_t interesting[] = { 0x00, 0x41, 0x7F, 0x80, 0x8F, 0x90, 0x9F, 0xA0, 0xBF, 0xC0, 0xC1, 0xC2, 0xDF,
+			0xE0, 0xE1, 0xED, 0xEE, 0xEF, 0xF0, 0xF1, 0xF4, 0xF5, 0xFF };
+		std::mt19937 random(12345);
+		uint32_t mismatchCount = 0;
+		uint32_t truncateFailureCount = 0;
+		for (uint32_t iteration = 0; iteration < 5000; ++iteration) {
+			std::string bytes;
+			const uint32_t length = random() % 48;
+			for (uint32_t index = 0; index < length; ++index) {
+				const uint32_t choice = random() % 8;
+				if (choice < 3) {
+					bytes += char(interesting[random() % sizeof(interesting)]);
+				} else if (choice < 5) {
+					bytes += char(0x80 + random() % 0x40);
+				} else if (choice == 5) {
+					// 16バイトずつまとめて読む経路も通す
+					bytes += std::string(16 + random() % 8, char('a' + random() % 26));
+				} else {
+					bytes += char(random() % 0x100);
+				}
+			}
+			const std::u16string expected = reference.Decode(bytes);
+			if (ConvertToUtf16(bytes, bytes.size()) != expected || GetUtf16Length(bytes) != expected.size()) {
+				++mismatchCount;
+			}
+			// 入りきらなければサロゲートの対の途中で切らずに止める
+			const size_t capacity = expected.empty() ? 0 : random() % expected.size();
+			const std::u16string truncated = ConvertToUtf16(bytes, capacity);
+			const bool splitsPair = capacity > 0 && truncated.size() < capacity && expected[truncated.size()] < 0xD800;
+			if (truncated != expected.substr(0, truncated.size()) || truncated.size() + 1 < capacity || splitsPair) {
+				++truncateFailureCount;
+			}
+		}
+		TEST_CHECK(mismatchCount == 0);
+		TEST_CHECK(truncateFailureCount == 0);
+	}
+
+	void TestRandomUtf16AgainstReference() {
+		std::mt19937 random(12345);
+		uint32_t mismatchCount = 0;
+		uint32_t truncateFailureCount = 0;
+		for (uint32_t iteration = 0; iteration < 5000; ++iteration) {
+			std::u16string text;
+			const uint32_t length = random() % 48;
+			for (uint32_t index = 0; index < length; ++index) {
+				const uint32_t choice = random() % 6;
+				if (choice == 0) {
+					text += char16_t(0xD800 + random() % 0x400);
+				} else if (choice == 1) {
+					text += char16_t(0xDC00 + random() % 0x400);
+				} else if (choice == 2) {
+					text += std::u16string(16 + random() % 8, char16_t('a' + random() % 26));
+				} else {
+					text += char16_t(random() % 0x10000);
+				}
+			}
+			const std::string expected = ReferenceEncodeUtf16(text);
+			if (ConvertToUtf8(text, expected.size()) != expected || GetUtf8Length(ToView(text)) != expected.size()) {
+				++mismatchCount;
+			}
+			// 入りきらない文字は途中で切らない
+			const size_t capacity = expected.empty() ? 0 : random() % expected.size();
+			const std::string truncated = ConvertToUtf8(text, capacity);
+			const bool splitsCharacter = truncated.size() < expected.size() && (uint8_t(expected[truncated.size()]) & 0xC0) == 0x80;
+			if (truncated != expected.substr(0, truncated.size()) || truncated.size() + 3 < capacity || splitsCharacter) {
+				++truncateFailureCount;
+			}
+		}
+		TEST_CHECK(mismatchCount == 0);
+		TEST_CHECK(truncateFailureCount == 0);
+	}
+
+	void TestTextBuffers() {
+		// 中に持つ大きさを超えるものは確保して全て変換する
+		std::string bytes;
+		std::u16string text;
+		for (int index = 0; index < 100; ++index) {
+			bytes += "a\xE3\x81\x82\xF0\x9F\x98\x80";
+			text += u"a\x3042\xD83D\xDE00";
+		}
+		const Utf16Text<16> wide(bytes);
+		TEST_CHECK(wide.view() == ToView(text));
+		TEST_CHECK(wide.c_str()[wide.size()] == 0);
+		const Utf8Text<16> narrow(ToView(text));
+		TEST_CHECK(narrow.view() == bytes);
+		TEST_CHECK(narrow.c_str()[narrow.size()] == '\0');
+		// 中に入るものも同じ
+		const Utf16Text<16> shortWide(std::string_view("\xE3\x81\x82"));
+		TEST_CHECK(shortWide.size() == 1 && shortWide.c_str()[0] == 0x3042);
+	}
+}
+
+int main() {
+	TestEveryScalarValueRoundTrips();
+	TestMaximalSubparts();
+	TestRandomUtf8AgainstReference();
+	TestRandomUtf16AgainstReference();
+	TestTextBuffers();
+	return FinishTests("UnicodeTest");
+}
\ No newline at end of file